@@ -12,7 +12,8 @@
 ; 3. Load the Global Descriptor Table (GDT) with our segments
 ; 4. Reload segment registers with new selectors
 ; 5. Set up the kernel stack
-; 6. Jump to the C kernel entry point
+; 6. Zero the BSS section (the stack lives there, so before anything is pushed)
+; 7. Jump to the C kernel entry point
 ;
 ; Note: With Multiboot, A20 line is already enabled by GRUB.
 ;
@@ -29,6 +30,8 @@ extern kernel_main                          ; C kernel entry point
 extern gdt_descriptor                       ; GDT descriptor from gdt.asm
 extern GDT_CODE_SEG                         ; Code segment selector (0x08)
 extern GDT_DATA_SEG                         ; Data segment selector (0x10)
+extern _bss_start                           ; BSS bounds (memory_layout.ld)
+extern _bss_end
 
 ; ---------------------------------------------------------------------------
 ; Global Exports
@@ -118,7 +121,25 @@ _start:
     cld
 
     ; -----------------------------------------------------------------------
-    ; Step 7: Push Multiboot Info and Call Kernel
+    ; Step 7: Clear BSS
+    ; -----------------------------------------------------------------------
+    ; Zero uninitialized globals a dword at a time with REP STOSD, then any
+    ; trailing bytes. Done here rather than in C: the stack is in BSS, and
+    ; nothing has been pushed onto it yet.
+    ; -----------------------------------------------------------------------
+    mov edi, _bss_start
+    mov ecx, _bss_end
+    sub ecx, edi
+    mov edx, ecx
+    shr ecx, 2                              ; Whole dwords
+    xor eax, eax
+    rep stosd
+    mov ecx, edx
+    and ecx, 3                              ; Remaining bytes
+    rep stosb
+
+    ; -----------------------------------------------------------------------
+    ; Step 8: Push Multiboot Info and Call Kernel
     ; -----------------------------------------------------------------------
     ; Pass multiboot info pointer as first argument to kernel_main.
     ; Following cdecl calling convention (argument on stack).
@@ -129,7 +150,7 @@ _start:
     call kernel_main
 
     ; -----------------------------------------------------------------------
-    ; Step 8: Halt if kernel_main returns
+    ; Step 9: Halt if kernel_main returns
     ; -----------------------------------------------------------------------
     ; The kernel should never return, but if it does, halt safely.
     ; -----------------------------------------------------------------------
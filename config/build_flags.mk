@@ -12,6 +12,9 @@
 #   VERBOSE=1        - Show full compiler commands
 #   SCHEDULER=rr     - Use round-robin scheduler (default)
 #   SCHEDULER=prio   - Use priority-based scheduler
+#   SCHEDULER=bitmap - Use priority order with O(1) per-level bitmap queues
+#   SCHEDULER=fair   - Use weighted fair-share (vruntime) scheduling
+#   FRAME_ALLOCATOR=buddy - Back multi-page frame allocations with the buddy tree
 #
 # ===========================================================================
 
@@ -38,10 +41,21 @@ endif
 # ---------------------------------------------------------------------------
 ifeq ($(SCHEDULER),prio)
   CFLAGS += -DUSE_PRIORITY_SCHEDULER
+else ifeq ($(SCHEDULER),bitmap)
+  CFLAGS += -DUSE_BITMAP_SCHEDULER
+else ifeq ($(SCHEDULER),fair)
+  CFLAGS += -DUSE_FAIR_SCHEDULER
 else
   CFLAGS += -DUSE_ROUND_ROBIN_SCHEDULER
 endif
 
+# ---------------------------------------------------------------------------
+# Frame Allocator Backing
+# ---------------------------------------------------------------------------
+ifeq ($(FRAME_ALLOCATOR),buddy)
+  CFLAGS += -DUSE_BUDDY_FRAME_ALLOCATOR
+endif
+
 # ---------------------------------------------------------------------------
 # Architecture-Specific Flags
 # ---------------------------------------------------------------------------
@@ -30,11 +30,18 @@
 #define DEBUG_VERBOSE               0       /* Extra verbose output */
 #define DEBUG_MEMORY                0       /* Memory allocator debugging */
 #define DEBUG_SCHEDULER             0       /* Scheduler debugging */
+#define LOG_RING_SLOTS              64      /* Log records kept per CPU (power of two) */
+#define TRACE_RING_SLOTS            1024    /* Trace records kept per CPU (power of two) */
+#define PROFILE_SLOTS               2048    /* Distinct (pid, eip) profile samples (power of two) */
+#define PERF_MAX_COUNTERS           4       /* Hardware counters in one perf session */
+#define LOG_RATELIMIT_BURST         10      /* Messages per call site per interval */
+#define LOG_RATELIMIT_INTERVAL      (5 * SCHEDULER_TICK_HZ)  /* Rate-limit window (ticks) */
 
 /* ---------------------------------------------------------------------------
  * Memory Configuration
  * --------------------------------------------------------------------------- */
 #define PAGE_SIZE                   4096    /* 4KB pages */
+#define LARGE_PAGE_SIZE             (4 * 1024 * 1024)   /* 4MB PSE pages */
 #define KERNEL_HEAP_SIZE            (16 * 1024 * 1024)  /* 16MB kernel heap */
 #define KERNEL_STACK_SIZE           (16 * 1024)         /* 16KB kernel stack */
 #define MAX_PHYSICAL_MEMORY         (256 * 1024 * 1024) /* 256MB max RAM */
@@ -42,17 +49,41 @@
 /* Memory layout addresses */
 #define KERNEL_LOAD_ADDRESS         0x00100000  /* 1MB - kernel start */
 #define KERNEL_HEAP_START           0x01000000  /* 16MB - heap start */
+#define DMA_ZONE_LIMIT              0x01000000  /* 16MB - ISA DMA reach */
 #define VGA_BUFFER_ADDRESS          0x000B8000  /* VGA text mode buffer */
 
+/* Virtual memory (physical RAM is identity-mapped, below USER_MMAP_BASE) */
+#define PAGING_ENABLED              1           /* 1 = turn on paging at boot */
+#define USER_MMAP_BASE              0x80000000  /* Per-task mapping window start */
+#define USER_MMAP_END               0xC0000000  /* Per-task mapping window end */
+#define USER_HEAP_SIZE              0x04000000  /* 64MB - most sbrk() can grow a heap */
+#define KERNEL_STACK_WINDOW         0xC0000000  /* Task stacks, 4KB pages with guard pages */
+#define KERNEL_STACK_WINDOW_SIZE    0x00400000  /* 4MB - one page table */
+#define MMIO_WINDOW_BASE            0xFEC00000  /* IOAPIC/LAPIC, mapped uncached */
+
 /* ---------------------------------------------------------------------------
  * Scheduler Configuration
  * --------------------------------------------------------------------------- */
 #define SCHEDULER_PREEMPTIVE        1       /* 1 = preemptive, 0 = cooperative */
 #define SCHEDULER_TICK_HZ           100     /* Timer interrupts per second */
 #define SCHEDULER_TIME_SLICE        10      /* Ticks per time slice */
+#define SCHEDULER_TICKLESS_IDLE     1       /* 1 = one-shot PIT while idle */
+#define SCHEDULER_FAIR_LATENCY      20      /* Fair policy: period every task runs in (ticks) */
+#define SCHEDULER_FAIR_MIN_GRANULARITY 2    /* Fair policy: shortest slice (ticks) */
 #define MAX_TASKS                   64      /* Maximum concurrent tasks */
+#define TASK_STACK_POOL_PREFILL     8       /* Default stacks allocated at boot */
+#define TASK_STACK_POOL_MAX         32      /* Idle stacks kept for reuse */
+#define WORKQUEUE_SIZE              64      /* Pending kworker items (power of two) */
 #define MAX_PRIORITY_LEVELS         8       /* Priority queue levels */
 
+/* ---------------------------------------------------------------------------
+ * SMP Configuration
+ * --------------------------------------------------------------------------- */
+#define SMP_ENABLED                 1       /* 1 = start application processors */
+#define SMP_MAX_CPUS                8       /* Per-CPU data slots */
+#define SMP_TRAMPOLINE_ADDR         0x8000  /* AP real-mode entry (page aligned, < 1MB) */
+#define SMP_AP_STACK_SIZE           4096    /* Boot stack per application processor */
+
 /* ---------------------------------------------------------------------------
  * Interrupt Configuration
  * --------------------------------------------------------------------------- */
@@ -63,15 +94,31 @@
 /* ---------------------------------------------------------------------------
  * Device Driver Configuration
  * --------------------------------------------------------------------------- */
-#define KEYBOARD_BUFFER_SIZE        256     /* Keyboard input buffer */
+#define KEYBOARD_BUFFER_SIZE        512     /* Keyboard event ring (power of two) */
 #define SERIAL_BAUD_RATE            115200  /* Serial port baud rate */
+#define SERIAL_TX_RING_SIZE         4096    /* Queued serial output (power of two) */
+#define SERIAL_RX_RING_SIZE         256     /* Received serial input (power of two) */
+#define BLOCK_MAX_DEVICES           4       /* Registered disks */
+#define BLOCK_MERGE_MAX_SECTORS     128     /* Largest merged request */
 
 /* ---------------------------------------------------------------------------
  * Filesystem Configuration
  * --------------------------------------------------------------------------- */
-#define MAX_OPEN_FILES              32      /* Max open file descriptors */
+#define MAX_OPEN_FILES              32      /* Buckets in the RAMFS open-file table */
+#define VFS_FD_TABLE_INITIAL        32      /* Descriptors in a new per-task table */
+#define VFS_FD_TABLE_MAX            4096    /* Per-task descriptor limit */
 #define MAX_FILENAME_LENGTH         256     /* Maximum filename length */
 #define RAMFS_MAX_SIZE              (4 * 1024 * 1024)  /* 4MB for RAM FS */
+#define DCACHE_ENTRIES              256     /* Cached (parent, name) lookups */
+#define DCACHE_NAME_MAX             32      /* Longer names are not cached */
+#define RAMFS_DIR_INDEX_THRESHOLD   16      /* Children before a dir gets a hash index */
+#define VFS_IOV_MAX                 16      /* Buffers per readv/writev call */
+#define VFS_MAX_MOUNTS              8       /* Mounted filesystem instances */
+#define VFS_MOUNT_PATH_MAX          64      /* Longest mount point path */
+#define PIPE_RING_SLOTS             16      /* Page buffers per pipe (power of two) */
+#define BCACHE_BUFFERS              64      /* Cached disk blocks (one frame each) */
+#define BCACHE_READAHEAD            4       /* Blocks read ahead of a miss */
+#define BCACHE_WRITEBACK_BATCH      8       /* Dirty blocks flushed per eviction */
 
 /* ---------------------------------------------------------------------------
  * IPC Configuration
@@ -0,0 +1,383 @@
+/*
+ * ===========================================================================
+ * kernel/drivers/ata.c
+ * ===========================================================================
+ *
+ * ATA (IDE) Disk Driver
+ *
+ * This driver probes the two legacy IDE channels with IDENTIFY and
+ * registers each ATA disk it finds with the block layer. Transfers use
+ * PIO with LBA28 addressing and are interrupt driven: the command is issued
+ * from start(), and the channel's IRQ handler moves one sector per
+ * interrupt (REP INSW/OUTSW) until the merged request is done, then calls
+ * block_complete().
+ *
+ * The master and slave on a channel share its registers, so only one of
+ * them can have a command in flight. A drive whose queue starts while its
+ * sibling is busy is marked deferred and issued when the sibling finishes.
+ *
+ * Channel Layout:
+ * ┌───────────┬────────┬──────────┬───────┬─────────────────┐
+ * │ Channel   │ I/O    │ Control  │ IRQ   │ Disks           │
+ * ├───────────┼────────┼──────────┼───────┼─────────────────┤
+ * │ Primary   │ 0x1F0  │ 0x3F6    │ 14    │ hda (M) hdb (S) │
+ * │ Secondary │ 0x170  │ 0x376    │ 15    │ hdc (M) hdd (S) │
+ * └───────────┴────────┴──────────┴───────┴─────────────────┘
+ *
+ * ===========================================================================
+ */
+
+#include "drivers.h"
+#include "../interrupts/interrupts.h"
+
+/* ---------------------------------------------------------------------------
+ * External Functions (from startup.asm)
+ * --------------------------------------------------------------------------- */
+extern void outb(uint16_t port, uint8_t value);
+extern uint8_t inb(uint16_t port);
+
+/* ---------------------------------------------------------------------------
+ * Register Offsets (from the channel's I/O base)
+ * --------------------------------------------------------------------------- */
+#define ATA_REG_DATA            0   /* 16-bit data port (R/W) */
+#define ATA_REG_ERROR           1   /* Error (R) */
+#define ATA_REG_SECCOUNT        2   /* Sector count (R/W) */
+#define ATA_REG_LBA_LO          3   /* LBA bits 0-7 */
+#define ATA_REG_LBA_MID         4   /* LBA bits 8-15 */
+#define ATA_REG_LBA_HI          5   /* LBA bits 16-23 */
+#define ATA_REG_DRIVE           6   /* Drive select, LBA bits 24-27 */
+#define ATA_REG_STATUS          7   /* Status (R), reading acks the IRQ */
+#define ATA_REG_COMMAND         7   /* Command (W) */
+
+/* Control block register: alternate status (R) / device control (W) */
+#define ATA_CTRL_NIEN           0x02    /* Mask the channel's interrupt */
+
+/* Status bits */
+#define ATA_SR_ERR              0x01
+#define ATA_SR_DRQ              0x08
+#define ATA_SR_DF               0x20
+#define ATA_SR_BSY              0x80
+
+/* Commands */
+#define ATA_CMD_READ_SECTORS    0x20
+#define ATA_CMD_WRITE_SECTORS   0x30
+#define ATA_CMD_IDENTIFY        0xEC
+
+/* Polling bound for probe and command setup */
+#define ATA_POLL_LIMIT          100000
+
+#define ATA_WORDS_PER_SECTOR    (BLOCK_SECTOR_SIZE / 2)
+
+/* ---------------------------------------------------------------------------
+ * Driver State
+ * --------------------------------------------------------------------------- */
+struct ata_channel;
+
+typedef struct ata_drive {
+    block_device_t dev;             /* Registered with the block layer */
+    struct ata_channel *channel;
+    uint8_t slave;                  /* 0 = master, 1 = slave */
+    bool present;
+
+    /* Transfer in progress */
+    block_request_t *req;           /* Request in the chain being moved */
+    uint32_t req_offset;            /* Sectors of 'req' already moved */
+    uint32_t remaining;             /* Sectors left in the command */
+    bool deferred;                  /* Waiting for the sibling drive */
+} ata_drive_t;
+
+typedef struct ata_channel {
+    uint16_t io_base;
+    uint16_t ctrl_base;
+    uint8_t irq;
+    ata_drive_t *current;           /* Drive with a command in flight */
+    ata_drive_t drives[2];
+} ata_channel_t;
+
+static ata_channel_t channels[2] = {
+    { .io_base = 0x1F0, .ctrl_base = 0x3F6, .irq = IRQ14_ATA_PRIMARY },
+    { .io_base = 0x170, .ctrl_base = 0x376, .irq = IRQ15_ATA_SECONDARY },
+};
+
+/* ---------------------------------------------------------------------------
+ * Port Helpers
+ * --------------------------------------------------------------------------- */
+
+static inline void ata_read_sector(uint16_t port, void *buffer)
+{
+    uint32_t words = ATA_WORDS_PER_SECTOR;
+    __asm__ volatile("rep insw" : "+D"(buffer), "+c"(words) : "d"(port) : "memory");
+}
+
+static inline void ata_write_sector(uint16_t port, const void *buffer)
+{
+    uint32_t words = ATA_WORDS_PER_SECTOR;
+    __asm__ volatile("rep outsw" : "+S"(buffer), "+c"(words) : "d"(port) : "memory");
+}
+
+/* ~400ns: four reads of the alternate status register */
+static void ata_delay(ata_channel_t *ch)
+{
+    for (int i = 0; i < 4; i++) {
+        inb(ch->ctrl_base);
+    }
+}
+
+/* Wait for BSY to clear; returns the status, or 0xFF on timeout */
+static uint8_t ata_wait_ready(ata_channel_t *ch)
+{
+    for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+        uint8_t status = inb(ch->ctrl_base);
+        if (!(status & ATA_SR_BSY)) {
+            return status;
+        }
+    }
+    return 0xFF;
+}
+
+/* Wait for DRQ (data ready) or an error; true if data can be moved */
+static bool ata_wait_drq(ata_channel_t *ch)
+{
+    for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+        uint8_t status = inb(ch->ctrl_base);
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+            return false;
+        }
+        if (!(status & ATA_SR_BSY) && (status & ATA_SR_DRQ)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Buffer for the next sector of the transfer */
+static uint8_t *ata_cursor(ata_drive_t *drive)
+{
+    while (drive->req_offset == drive->req->count) {
+        drive->req = drive->req->chain;
+        drive->req_offset = 0;
+    }
+    return (uint8_t *)drive->req->buffer + drive->req_offset * BLOCK_SECTOR_SIZE;
+}
+
+/* ---------------------------------------------------------------------------
+ * Command Issue and Completion
+ * --------------------------------------------------------------------------- */
+
+/* Program the registers for drive->req's chain and start the command */
+static bool ata_issue(ata_drive_t *drive)
+{
+    ata_channel_t *ch = drive->channel;
+    block_request_t *req = drive->req;
+    uint32_t lba = req->sector;
+
+    if (ata_wait_ready(ch) & ATA_SR_BSY) {
+        return false;
+    }
+
+    outb(ch->io_base + ATA_REG_DRIVE, 0xE0 | (drive->slave << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(ch);
+    outb(ch->io_base + ATA_REG_SECCOUNT, (uint8_t)drive->remaining);  /* 0 = 256 */
+    outb(ch->io_base + ATA_REG_LBA_LO, (uint8_t)lba);
+    outb(ch->io_base + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
+    outb(ch->io_base + ATA_REG_LBA_HI, (uint8_t)(lba >> 16));
+
+    ch->current = drive;
+    outb(ch->io_base + ATA_REG_COMMAND,
+         req->write ? ATA_CMD_WRITE_SECTORS : ATA_CMD_READ_SECTORS);
+
+    if (req->write) {
+        /* The first sector goes out now; each IRQ then asks for the next */
+        if (!ata_wait_drq(ch)) {
+            ch->current = NULL;
+            return false;
+        }
+        ata_write_sector(ch->io_base + ATA_REG_DATA, ata_cursor(drive));
+        drive->req_offset++;
+    }
+    return true;
+}
+
+/* Complete the drive's request and hand the channel to a waiting sibling */
+static void ata_finish(ata_drive_t *drive, int status)
+{
+    ata_channel_t *ch = drive->channel;
+    ch->current = NULL;
+
+    /*
+     * The sibling goes first, before this drive's next request can take
+     * the channel again, so a busy drive cannot starve the other one.
+     */
+    ata_drive_t *sibling = &ch->drives[drive->slave ^ 1];
+    if (sibling->deferred) {
+        sibling->deferred = false;
+        if (!ata_issue(sibling)) {
+            ata_finish(sibling, BLOCK_STATUS_ERROR);
+        }
+    }
+
+    /* May start (or, with the sibling active, defer) this drive's next request */
+    block_complete(&drive->dev, status);
+}
+
+/* block_device_ops_t::start */
+static bool ata_start(block_device_t *dev, block_request_t *req)
+{
+    ata_drive_t *drive = (ata_drive_t *)dev->driver_data;
+    drive->req = req;
+    drive->req_offset = 0;
+    drive->remaining = req->chain_count;
+
+    if (drive->channel->current != NULL) {
+        drive->deferred = true;     /* Issued by ata_finish() */
+        return true;
+    }
+    return ata_issue(drive);
+}
+
+static const block_device_ops_t ata_ops = {
+    .start = ata_start,
+};
+
+/* ---------------------------------------------------------------------------
+ * ata_channel_irq - Move the next sector of the active transfer
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if the channel had a transfer in flight (the interrupt was ours)
+ * --------------------------------------------------------------------------- */
+static bool ata_channel_irq(ata_channel_t *ch)
+{
+    uint8_t status = inb(ch->io_base + ATA_REG_STATUS);   /* Acks the IRQ */
+    ata_drive_t *drive = ch->current;
+    if (drive == NULL) {
+        return false;   /* Spurious, or a probe leftover */
+    }
+
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+        ata_finish(drive, BLOCK_STATUS_ERROR);
+        return true;
+    }
+
+    if (!drive->req->write) {
+        if (!(status & ATA_SR_DRQ)) {
+            return true;
+        }
+        ata_read_sector(ch->io_base + ATA_REG_DATA, ata_cursor(drive));
+        drive->req_offset++;
+    }
+
+    /* For writes, this IRQ acknowledges the sector sent last */
+    if (--drive->remaining == 0) {
+        ata_finish(drive, BLOCK_STATUS_OK);
+        return true;
+    }
+
+    if (drive->req->write) {
+        ata_write_sector(ch->io_base + ATA_REG_DATA, ata_cursor(drive));
+        drive->req_offset++;
+    }
+    return true;
+}
+
+static bool ata_primary_irq(interrupt_frame_t *frame)
+{
+    UNUSED(frame);
+    return ata_channel_irq(&channels[0]);
+}
+
+static bool ata_secondary_irq(interrupt_frame_t *frame)
+{
+    UNUSED(frame);
+    return ata_channel_irq(&channels[1]);
+}
+
+/* ---------------------------------------------------------------------------
+ * Probing
+ * --------------------------------------------------------------------------- */
+
+/* Run IDENTIFY on one drive; returns its LBA28 sector count (0 = none) */
+static uint32_t ata_identify(ata_channel_t *ch, uint8_t slave)
+{
+    outb(ch->io_base + ATA_REG_DRIVE, 0xA0 | (slave << 4));
+    ata_delay(ch);
+    outb(ch->io_base + ATA_REG_SECCOUNT, 0);
+    outb(ch->io_base + ATA_REG_LBA_LO, 0);
+    outb(ch->io_base + ATA_REG_LBA_MID, 0);
+    outb(ch->io_base + ATA_REG_LBA_HI, 0);
+    outb(ch->io_base + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+
+    uint8_t status = inb(ch->io_base + ATA_REG_STATUS);
+    if (status == 0 || status == 0xFF) {
+        return 0;   /* No drive / floating bus */
+    }
+    if (ata_wait_ready(ch) & ATA_SR_BSY) {
+        return 0;
+    }
+
+    /* ATAPI and SATA devices identify themselves through the LBA registers */
+    if (inb(ch->io_base + ATA_REG_LBA_MID) != 0 || inb(ch->io_base + ATA_REG_LBA_HI) != 0) {
+        return 0;
+    }
+    if (!ata_wait_drq(ch)) {
+        return 0;
+    }
+
+    uint16_t identify[ATA_WORDS_PER_SECTOR];
+    ata_read_sector(ch->io_base + ATA_REG_DATA, identify);
+
+    /* Words 60-61: total addressable sectors in LBA28 mode */
+    return (uint32_t)identify[60] | ((uint32_t)identify[61] << 16);
+}
+
+/* ---------------------------------------------------------------------------
+ * ata_init - Probe both channels and register the disks found
+ * --------------------------------------------------------------------------- */
+int ata_init(void)
+{
+    static const irq_handler_t handlers[2] = { ata_primary_irq, ata_secondary_irq };
+    static const char *const names[2] = { "ata0", "ata1" };
+    int found = 0;
+
+    for (int c = 0; c < 2; c++) {
+        ata_channel_t *ch = &channels[c];
+        ch->current = NULL;
+
+        /* Probe with the channel's interrupt masked */
+        outb(ch->ctrl_base, ATA_CTRL_NIEN);
+
+        int on_channel = 0;
+        for (uint8_t s = 0; s < 2; s++) {
+            ata_drive_t *drive = &ch->drives[s];
+            drive->channel = ch;
+            drive->slave = s;
+            drive->present = false;
+            drive->deferred = false;
+
+            uint32_t sectors = ata_identify(ch, s);
+            if (sectors == 0) {
+                continue;
+            }
+
+            drive->dev.name[0] = 'h';
+            drive->dev.name[1] = 'd';
+            drive->dev.name[2] = (char)('a' + c * 2 + s);
+            drive->dev.name[3] = '\0';
+            drive->dev.sector_count = sectors;
+            drive->dev.ops = &ata_ops;
+            drive->dev.driver_data = drive;
+            if (block_register(&drive->dev)) {
+                drive->present = true;
+                on_channel++;
+            }
+        }
+
+        if (on_channel > 0) {
+            irq_register_handler(ch->irq, handlers[c], names[c]);
+            outb(ch->ctrl_base, 0);     /* Unmask the channel's interrupt */
+            irq_enable(ch->irq);
+            found += on_channel;
+        }
+    }
+
+    return found;
+}
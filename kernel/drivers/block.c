@@ -0,0 +1,282 @@
+/*
+ * ===========================================================================
+ * kernel/drivers/block.c
+ * ===========================================================================
+ *
+ * Block Device Layer
+ *
+ * This file keeps the table of registered disks and each disk's request
+ * queue. Submitting a request either merges it into a queued request that
+ * it continues (back merge) or that continues it (front merge), or inserts
+ * it in sector order. The elevator (C-LOOK) then picks the first queued
+ * request at or after the end of the last one, so the head sweeps upward
+ * and jumps back once.
+ *
+ *   queue:  [ 8..15 ]--[ 40..47 | 48..55 ]--[ 200..207 ]
+ *                        ^ one command, two requests (back merge)
+ *
+ * Requests are owned by the submitter; the layer only links them. Merged
+ * requests form a chain behind the request that sits in the queue, and the
+ * driver transfers the whole chain with one command.
+ *
+ * ===========================================================================
+ */
+
+#include "drivers.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+
+extern int strcmp(const char *s1, const char *s2);
+
+/* ---------------------------------------------------------------------------
+ * State
+ * --------------------------------------------------------------------------- */
+static block_device_t *devices[BLOCK_MAX_DEVICES];
+
+/* Tasks in block_read()/block_write() (each rechecks its own request) */
+static wait_queue_t block_waiters = WAIT_QUEUE_INIT(block_waiters);
+
+/* ---------------------------------------------------------------------------
+ * block_register - Add a disk to the device table
+ * --------------------------------------------------------------------------- */
+bool block_register(block_device_t *dev)
+{
+    if (dev == NULL || dev->ops == NULL || dev->ops->start == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < BLOCK_MAX_DEVICES; i++) {
+        if (devices[i] == NULL) {
+            list_init(&dev->queue);
+            dev->active = NULL;
+            dev->next_sector = 0;
+            dev->stats.submitted = 0;
+            dev->stats.merged = 0;
+            dev->stats.dispatched = 0;
+            dev->stats.errors = 0;
+            devices[i] = dev;
+            return true;
+        }
+    }
+    return false;
+}
+
+block_device_t *block_get(const char *name)
+{
+    for (int i = 0; i < BLOCK_MAX_DEVICES; i++) {
+        if (devices[i] != NULL && strcmp(devices[i]->name, name) == 0) {
+            return devices[i];
+        }
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Request Queue
+ * --------------------------------------------------------------------------- */
+
+/* Try to merge 'req' into a queued request; true if it was absorbed */
+static bool block_try_merge(block_device_t *dev, block_request_t *req)
+{
+    for (list_node_t *node = dev->queue.head; node != NULL; node = node->next) {
+        block_request_t *head = list_entry(node, block_request_t, node);
+        if (head->write != req->write ||
+            head->chain_count + req->count > BLOCK_MERGE_MAX_SECTORS) {
+            continue;
+        }
+
+        if (head->sector + head->chain_count == req->sector) {
+            /* Back merge: append to the end of the chain */
+            block_request_t *tail = head;
+            while (tail->chain != NULL) {
+                tail = tail->chain;
+            }
+            tail->chain = req;
+            head->chain_count += req->count;
+            return true;
+        }
+
+        if (req->sector + req->count == head->sector) {
+            /* Front merge: req takes the head's place in the queue */
+            req->chain = head;
+            req->chain_count = req->count + head->chain_count;
+            list_insert_before(&dev->queue, &head->node, &req->node);
+            list_remove(&dev->queue, &head->node);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Insert a chain head in sector order */
+static void block_enqueue(block_device_t *dev, block_request_t *req)
+{
+    for (list_node_t *node = dev->queue.head; node != NULL; node = node->next) {
+        if (list_entry(node, block_request_t, node)->sector > req->sector) {
+            list_insert_before(&dev->queue, node, &req->node);
+            return;
+        }
+    }
+    list_push_back(&dev->queue, &req->node);
+}
+
+/* ---------------------------------------------------------------------------
+ * block_dispatch - Start the next request if the device is idle (C-LOOK)
+ * ---------------------------------------------------------------------------
+ * Called with the kernel lock held.
+ * --------------------------------------------------------------------------- */
+static void block_dispatch(block_device_t *dev)
+{
+    while (dev->active == NULL && !list_is_empty(&dev->queue)) {
+        list_node_t *pick = dev->queue.head;
+        for (list_node_t *node = pick; node != NULL; node = node->next) {
+            if (list_entry(node, block_request_t, node)->sector >= dev->next_sector) {
+                pick = node;
+                break;
+            }
+        }
+
+        list_remove(&dev->queue, pick);
+        block_request_t *req = list_entry(pick, block_request_t, node);
+        dev->active = req;
+        dev->next_sector = req->sector + req->chain_count;
+        dev->stats.dispatched++;
+
+        if (!dev->ops->start(dev, req)) {
+            block_complete(dev, BLOCK_STATUS_ERROR);  /* Clears active */
+        }
+    }
+}
+
+bool block_submit(block_device_t *dev, block_request_t *req)
+{
+    if (dev == NULL || req == NULL || req->count == 0 ||
+        req->count > BLOCK_MERGE_MAX_SECTORS ||
+        req->sector >= dev->sector_count ||
+        req->count > dev->sector_count - req->sector) {
+        return false;
+    }
+
+    list_node_init(&req->node);
+    req->chain = NULL;
+    req->chain_count = req->count;
+    req->status = BLOCK_STATUS_PENDING;
+
+    uint32_t flags = kernel_lock_irqsave();
+    dev->stats.submitted++;
+    if (block_try_merge(dev, req)) {
+        dev->stats.merged++;
+    } else {
+        block_enqueue(dev, req);
+    }
+    block_dispatch(dev);
+    kernel_unlock_irqrestore(flags);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * block_complete - Finish the active chain and start the next request
+ * --------------------------------------------------------------------------- */
+void block_complete(block_device_t *dev, int status)
+{
+    block_request_t *req = dev->active;
+    dev->active = NULL;
+
+    while (req != NULL) {
+        /* Read the link first: the callback may release the request */
+        block_request_t *next = req->chain;
+        if (status != BLOCK_STATUS_OK) {
+            dev->stats.errors++;
+        }
+        req->status = status;
+        if (req->done != NULL) {
+            req->done(req);
+        }
+        req = next;
+    }
+
+    block_dispatch(dev);
+}
+
+/* ---------------------------------------------------------------------------
+ * Synchronous I/O
+ * --------------------------------------------------------------------------- */
+
+static void block_wake(block_request_t *req)
+{
+    UNUSED(req);
+    wait_queue_wake_all(&block_waiters);
+}
+
+static int block_transfer(block_device_t *dev, uint32_t sector, uint32_t count,
+                          void *buffer, bool write)
+{
+    block_request_t req;
+    req.sector = sector;
+    req.count = count;
+    req.buffer = buffer;
+    req.write = write;
+    req.done = block_wake;
+    req.private = NULL;
+
+    /*
+     * Queue and check under the kernel lock, which the completion IRQ also
+     * takes, so the wakeup cannot slip in between
+     */
+    uint32_t flags = kernel_lock_irqsave();
+    if (!block_submit(dev, &req)) {
+        kernel_unlock_irqrestore(flags);
+        return -1;
+    }
+    while (req.status == BLOCK_STATUS_PENDING) {
+        wait_queue_wait(&block_waiters);
+    }
+    kernel_unlock_irqrestore(flags);
+
+    return (req.status == BLOCK_STATUS_OK) ? 0 : -1;
+}
+
+int block_read(block_device_t *dev, uint32_t sector, uint32_t count, void *buffer)
+{
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    /* Split transfers larger than one request */
+    while (count > 0) {
+        uint32_t n = (count > BLOCK_MERGE_MAX_SECTORS) ? BLOCK_MERGE_MAX_SECTORS : count;
+        if (block_transfer(dev, sector, n, buffer, false) != 0) {
+            return -1;
+        }
+        sector += n;
+        count -= n;
+        buffer = (uint8_t *)buffer + n * BLOCK_SECTOR_SIZE;
+    }
+    return 0;
+}
+
+int block_write(block_device_t *dev, uint32_t sector, uint32_t count, const void *buffer)
+{
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    while (count > 0) {
+        uint32_t n = (count > BLOCK_MERGE_MAX_SECTORS) ? BLOCK_MERGE_MAX_SECTORS : count;
+        if (block_transfer(dev, sector, n, (void *)buffer, true) != 0) {
+            return -1;
+        }
+        sector += n;
+        count -= n;
+        buffer = (const uint8_t *)buffer + n * BLOCK_SECTOR_SIZE;
+    }
+    return 0;
+}
+
+void block_get_stats(const block_device_t *dev, block_stats_t *out)
+{
+    if (dev != NULL && out != NULL) {
+        *out = dev->stats;
+    }
+}
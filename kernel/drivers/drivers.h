@@ -9,6 +9,8 @@
  * - VGA text mode driver (console output)
  * - PIT timer driver (system tick)
  * - PS/2 keyboard driver (input)
+ * - Serial port (debug output)
+ * - Block device layer and the ATA disk driver
  *
  * ===========================================================================
  */
@@ -17,12 +19,14 @@
 #define DRIVERS_H
 
 #include "../../config/os_config.h"
+#include "../../lib/dsa/list.h"
 
 /* ===========================================================================
  * VGA Text Mode Driver (vga_text.c)
  * ===========================================================================
- * The VGA text mode driver provides console output by directly writing to
- * the VGA text buffer at 0xB8000. It supports:
+ * The VGA text mode driver provides console output through a shadow copy of
+ * the VGA text buffer at 0xB8000, copying dirty lines out in batches. It
+ * supports:
  * - Character and string output
  * - Cursor management
  * - Screen scrolling
@@ -153,6 +157,15 @@ void vga_get_cursor(int *x, int *y);
  */
 void vga_enable_cursor(bool enable);
 
+/*
+ * vga_flush - Copy pending shadow-buffer changes to video memory
+ * ---------------------------------------------------------------------------
+ * Output is drawn into a RAM copy of the screen; every call except a
+ * mid-line vga_putchar() flushes on return. The timer bottom half and the
+ * idle loop call this for the rest.
+ */
+void vga_flush(void);
+
 /*
  * vga_scroll - Scroll the screen up by one line
  * ---------------------------------------------------------------------------
@@ -206,6 +219,14 @@ void pit_init(void);
  */
 void pit_set_frequency(uint32_t hz);
 
+/*
+ * pit_get_frequency - Get the timer interrupt frequency
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Ticks per second actually programmed (after divisor rounding)
+ */
+uint32_t pit_get_frequency(void);
+
 /*
  * pit_get_ticks - Get the current tick count
  * ---------------------------------------------------------------------------
@@ -260,6 +281,87 @@ void pit_sleep_ticks(uint32_t ticks);
 typedef void (*pit_callback_t)(void);
 void pit_register_callback(pit_callback_t callback);
 
+/*
+ * pit_read_count - Read channel 0's current counter value
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Counter value (counts down towards 0 at PIT_BASE_FREQUENCY)
+ */
+uint16_t pit_read_count(void);
+
+/*
+ * pit_oneshot_max_ticks - Longest tickless interval (in ticks)
+ */
+uint32_t pit_oneshot_max_ticks(void);
+
+/*
+ * pit_start_oneshot - Replace periodic ticks with one deadline
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   ticks - Ticks until the next timer event
+ *
+ * Returns:
+ *   true if armed (call pit_stop_oneshot() after waking), false if not
+ *
+ * Must be called with interrupts disabled.
+ */
+bool pit_start_oneshot(uint32_t ticks);
+
+/*
+ * pit_stop_oneshot - Credit elapsed ticks and return to periodic mode
+ * ---------------------------------------------------------------------------
+ * Must be called with interrupts disabled.
+ */
+void pit_stop_oneshot(void);
+
+/*
+ * pit_get_irq_count - Timer interrupts taken since boot
+ */
+uint32_t pit_get_irq_count(void);
+
+/*
+ * pit_get_ticks_skipped - Ticks accounted without their own interrupt
+ */
+uint32_t pit_get_ticks_skipped(void);
+
+/*
+ * pit_uses_lapic_timer - Whether ticks come from the LAPIC timer (APIC mode)
+ */
+bool pit_uses_lapic_timer(void);
+
+/*
+ * pit_start_cpu_tick - Start the calling AP's LAPIC tick (false without one)
+ */
+bool pit_start_cpu_tick(void);
+
+/* ---------------------------------------------------------------------------
+ * High-Resolution Clock (TSC, calibrated against the PIT in pit_init)
+ * --------------------------------------------------------------------------- */
+
+/*
+ * clock_cycles - Raw CPU timestamp counter
+ */
+uint64_t clock_cycles(void);
+
+/*
+ * clock_cycles_to_ns - Convert a cycle delta to nanoseconds
+ * ---------------------------------------------------------------------------
+ * Returns 0 if the TSC could not be calibrated.
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/*
+ * clock_ns - Nanoseconds since boot-time calibration
+ * ---------------------------------------------------------------------------
+ * Falls back to tick resolution if the TSC could not be calibrated.
+ */
+uint64_t clock_ns(void);
+
+/*
+ * clock_get_khz - Calibrated TSC frequency in kHz (0 = uncalibrated)
+ */
+uint32_t clock_get_khz(void);
+
 /* ===========================================================================
  * PS/2 Keyboard Driver (keyboard.c)
  * ===========================================================================
@@ -377,6 +479,18 @@ bool keyboard_has_input(void);
  */
 void keyboard_clear_buffer(void);
 
+/*
+ * keyboard_poll - Readiness of keyboard input for kpoll()
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   wq - Output: wait queue the keyboard bottom half wakes on new input
+ *
+ * Returns:
+ *   POLLIN if a character is waiting, 0 otherwise
+ */
+struct wait_queue;
+uint32_t keyboard_poll(struct wait_queue **wq);
+
 /*
  * keyboard_get_modifiers - Get the current modifier key state
  * ---------------------------------------------------------------------------
@@ -413,19 +527,52 @@ void keyboard_register_callback(keyboard_callback_t callback);
  * ===========================================================================
  * The serial driver provides communication via the COM1 port. This is
  * primarily used for kernel debugging and logging to the host terminal.
+ * Output is polled until serial_enable_interrupts(); after that writes are
+ * queued in a TX ring and sent from the THRE interrupt, 16 bytes at a time.
  * =========================================================================== */
 
 #define SERIAL_COM1_PORT    0x3F8
 
+/**
+ * @brief Serial driver counters
+ */
+typedef struct serial_stats {
+    uint32_t tx_bytes;          /* Bytes written by callers */
+    uint32_t tx_queued;         /* Bytes waiting in the TX ring now */
+    uint32_t tx_interrupts;     /* THRE interrupts served */
+    uint32_t polled_bytes;      /* Bytes sent synchronously */
+    uint32_t bulk_switches;     /* Ring-full fallbacks to polling */
+    uint32_t rx_bytes;          /* Bytes moved into the RX ring */
+    uint32_t rx_interrupts;     /* Receive/timeout interrupts served */
+    uint32_t rx_dropped;        /* Bytes lost to a full RX ring */
+} serial_stats_t;
+
 /**
  * @brief Initialize the serial port
  * @return 0 on success, non-zero on failure
  */
 int serial_init(void);
 
+/**
+ * @brief Switch to interrupt-driven TX/RX (call after irq_init)
+ * @return true if interrupts are in use, false if no UART was found
+ */
+bool serial_enable_interrupts(void);
+
+/**
+ * @brief Force synchronous output (flushing the ring first), or stop forcing it
+ * @param polled true for polled mode
+ */
+void serial_set_polled(bool polled);
+
+/**
+ * @brief Send everything still queued synchronously (panic path, no locking)
+ */
+void serial_panic_flush(void);
+
 /**
  * @brief Write a character to the serial port
- * @param c Character to write
+ * @param c Character to write (queued when interrupt-driven)
  */
 void serial_putchar(char c);
 
@@ -435,6 +582,13 @@ void serial_putchar(char c);
  */
 void serial_write_string(const char *str);
 
+/**
+ * @brief Write a buffer to the serial port (one lock round trip)
+ * @param str Bytes to write (need not be NUL-terminated)
+ * @param len Number of bytes
+ */
+void serial_write(const char *str, size_t len);
+
 /**
  * @brief Check if serial port has received data
  * @return true if data is available
@@ -447,4 +601,134 @@ bool serial_received(void);
  */
 char serial_getchar(void);
 
+/**
+ * @brief Readiness of the port for kpoll()
+ * @param wq Output: queue woken when input arrives (NULL while polled)
+ * @return POLLOUT, plus POLLIN if a byte is waiting
+ */
+uint32_t serial_poll(struct wait_queue **wq);
+
+/**
+ * @brief Copy out the serial driver counters
+ * @param out Destination
+ */
+void serial_get_stats(serial_stats_t *out);
+
+/* ===========================================================================
+ * Block Device Layer (block.c)
+ * ===========================================================================
+ * Disks register a block_device_t with a start() operation. Requests are
+ * queued per device, sorted by sector; a request that continues (or is
+ * continued by) a queued request in the same direction is merged into it,
+ * so the driver issues one command for the whole run. The queue is served
+ * in C-LOOK order: the next request is the first one at or after the end
+ * of the previous one, wrapping to the lowest sector.
+ *
+ * The driver starts one merged request at a time and reports completion
+ * from its IRQ handler with block_complete(), which finishes every request
+ * in the chain and starts the next.
+ * =========================================================================== */
+
+#define BLOCK_SECTOR_SIZE       512
+
+/* block_request_t::status */
+#define BLOCK_STATUS_PENDING    1
+#define BLOCK_STATUS_OK         0
+#define BLOCK_STATUS_ERROR      (-1)
+
+struct block_device;
+struct block_request;
+
+/* Completion callback; runs in IRQ context with interrupts disabled */
+typedef void (*block_done_t)(struct block_request *req);
+
+typedef struct block_request {
+    list_node_t node;               /* Device queue link (chain heads only) */
+    struct block_request *chain;    /* Next request merged behind this one */
+    uint32_t sector;                /* First sector */
+    uint32_t count;                 /* Sectors in this request */
+    uint32_t chain_count;           /* Sectors in this request and its chain */
+    void *buffer;                   /* count * BLOCK_SECTOR_SIZE bytes */
+    bool write;
+    volatile int status;            /* BLOCK_STATUS_* */
+    block_done_t done;              /* Optional */
+    void *private;                  /* For the submitter */
+} block_request_t;
+
+typedef struct block_device_ops {
+    /*
+     * Start 'req' and its chain (chain_count sectors from req->sector).
+     * Returns false if the command could not be issued.
+     */
+    bool (*start)(struct block_device *dev, block_request_t *req);
+} block_device_ops_t;
+
+typedef struct block_stats {
+    uint32_t submitted;             /* Requests passed to block_submit() */
+    uint32_t merged;                /* ... that joined a queued request */
+    uint32_t dispatched;            /* Commands started on the device */
+    uint32_t errors;                /* Requests completed with an error */
+} block_stats_t;
+
+typedef struct block_device {
+    char name[8];                   /* e.g. "hda" */
+    uint32_t sector_count;
+    const block_device_ops_t *ops;
+    void *driver_data;
+    list_t queue;                   /* Pending chain heads, by sector */
+    block_request_t *active;        /* Request the device is working on */
+    uint32_t next_sector;           /* Elevator position */
+    block_stats_t stats;
+} block_device_t;
+
+/**
+ * @brief Register a disk (the caller keeps the storage)
+ * @return true on success, false if the device table is full
+ */
+bool block_register(block_device_t *dev);
+
+/**
+ * @brief Find a registered disk by name
+ */
+block_device_t *block_get(const char *name);
+
+/**
+ * @brief Queue a request without waiting for it
+ *
+ * Fills in the chain fields and sets status to BLOCK_STATUS_PENDING.
+ * @return false if the range is out of bounds (nothing queued)
+ */
+bool block_submit(block_device_t *dev, block_request_t *req);
+
+/**
+ * @brief Finish the active request (driver IRQ handler)
+ */
+void block_complete(block_device_t *dev, int status);
+
+/**
+ * @brief Read or write sectors, sleeping until the transfer is done
+ * @return 0 on success, -1 on error
+ */
+int block_read(block_device_t *dev, uint32_t sector, uint32_t count, void *buffer);
+int block_write(block_device_t *dev, uint32_t sector, uint32_t count, const void *buffer);
+
+/**
+ * @brief Copy a disk's request counters
+ */
+void block_get_stats(const block_device_t *dev, block_stats_t *out);
+
+/* ===========================================================================
+ * ATA Disk Driver (ata.c)
+ * ===========================================================================
+ * PIO driver for the primary and secondary IDE channels (LBA28). Each
+ * detected disk is registered as "hda".."hdd"; each sector of a transfer
+ * is moved by the channel's IRQ handler.
+ * =========================================================================== */
+
+/**
+ * @brief Probe both channels and register the disks found
+ * @return Number of disks registered
+ */
+int ata_init(void);
+
 #endif /* DRIVERS_H */
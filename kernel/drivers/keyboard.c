@@ -13,8 +13,11 @@
  * - Scancode set 1 support (default on PC)
  * - Shift, Ctrl, Alt modifier handling
  * - Caps Lock, Num Lock, Scroll Lock
- * - Keyboard buffer for asynchronous input
+ * - Key event ring (single producer: the bottom half) for asynchronous input
+ * - Blocking readers sleep on a wait queue; keyboard_poll() for kpoll()
  * - Optional callback for key events
+ * - Split IRQ handling: the top half only queues the raw scancode, the
+ *   SOFTIRQ_KEYBOARD bottom half decodes the batch
  *
  * PS/2 Controller Architecture:
  * ┌──────────────────────────────────────────────────────────────────────────┐
@@ -34,7 +37,10 @@
 
 #include "drivers.h"
 #include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
 #include "../../lib/cstd/stdio.h"
+#include "../scheduler/sync.h"
+#include "../ipc/poll.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions (from startup.asm)
@@ -148,54 +154,104 @@ static bool scroll_lock = false;
 static bool extended_key = false;
 
 /* ---------------------------------------------------------------------------
- * Keyboard Buffer (Circular Buffer)
+ * Key Event Ring
  * ---------------------------------------------------------------------------
- * Simple ring buffer for storing characters until they're read.
+ * Every decoded key press and release, in order. The bottom half is the
+ * only producer; readers take events under the kernel lock, so there
+ * is one consumer at a time. Free-running indices, power-of-two size.
  * --------------------------------------------------------------------------- */
-#define KB_BUFFER_SIZE  KEYBOARD_BUFFER_SIZE
+#define KB_EVENT_RING_SIZE  KEYBOARD_BUFFER_SIZE
 
-static char kb_buffer[KB_BUFFER_SIZE];
-static volatile uint32_t kb_head = 0;   /* Write position */
-static volatile uint32_t kb_tail = 0;   /* Read position */
+static key_event_t kb_events[KB_EVENT_RING_SIZE];
+static volatile uint32_t kb_head = 0;   /* Written by the bottom half */
+static volatile uint32_t kb_tail = 0;   /* Written by readers */
+static uint32_t kb_events_dropped = 0;
+
+/* Tasks sleeping in keyboard_getchar_blocking() or polling the keyboard */
+static wait_queue_t kb_waiters = WAIT_QUEUE_INIT(kb_waiters);
 
 /* Optional callback for key events */
 static keyboard_callback_t key_callback = NULL;
 
 /* ---------------------------------------------------------------------------
- * Buffer Helper Functions
+ * Raw Scancode Queue
+ * ---------------------------------------------------------------------------
+ * Filled by the IRQ top half, drained by the bottom half. One producer and
+ * one consumer, so the indices need no locking.
  * --------------------------------------------------------------------------- */
+#define KB_SCANCODE_QUEUE_SIZE  256     /* Power of two */
 
-/* Check if buffer is full */
-static bool kb_buffer_full(void)
-{
-    return ((kb_head + 1) % KB_BUFFER_SIZE) == kb_tail;
-}
+static uint8_t scancode_queue[KB_SCANCODE_QUEUE_SIZE];
+static volatile uint32_t scancode_head = 0;    /* Written by the top half */
+static volatile uint32_t scancode_tail = 0;    /* Written by the bottom half */
+static uint32_t scancodes_dropped = 0;
+
+/* ---------------------------------------------------------------------------
+ * Event Ring Helpers
+ * --------------------------------------------------------------------------- */
 
-/* Check if buffer is empty */
+#define kb_barrier()    __asm__ volatile("" ::: "memory")
+
+/* Check if the ring is empty */
 static bool kb_buffer_empty(void)
 {
     return kb_head == kb_tail;
 }
 
-/* Add a character to the buffer */
-static void kb_buffer_put(char c)
+/* Does this event carry a character for getchar()? */
+static inline bool kb_event_is_char(const key_event_t *event)
+{
+    return event->pressed && event->ascii != 0;
+}
+
+/* Append an event (bottom half only) */
+static void kb_event_put(const key_event_t *event)
+{
+    uint32_t head = kb_head;
+    if (head - kb_tail == KB_EVENT_RING_SIZE) {
+        kb_events_dropped++;
+        return;
+    }
+    kb_events[head & (KB_EVENT_RING_SIZE - 1)] = *event;
+    kb_barrier();
+    kb_head = head + 1;
+}
+
+/* Take the oldest event (kernel lock held) */
+static bool kb_event_get(key_event_t *event)
 {
-    if (!kb_buffer_full()) {
-        kb_buffer[kb_head] = c;
-        kb_head = (kb_head + 1) % KB_BUFFER_SIZE;
+    uint32_t tail = kb_tail;
+    if (tail == kb_head) {
+        return false;
     }
+    kb_barrier();
+    *event = kb_events[tail & (KB_EVENT_RING_SIZE - 1)];
+    kb_barrier();
+    kb_tail = tail + 1;
+    return true;
 }
 
-/* Get a character from the buffer */
+/* Take events up to and including the next character; 0 if there is none */
 static char kb_buffer_get(void)
 {
-    if (kb_buffer_empty()) {
-        return 0;
+    key_event_t event;
+    while (kb_event_get(&event)) {
+        if (kb_event_is_char(&event)) {
+            return (char)event.ascii;
+        }
     }
-    
-    char c = kb_buffer[kb_tail];
-    kb_tail = (kb_tail + 1) % KB_BUFFER_SIZE;
-    return c;
+    return 0;
+}
+
+/* Is a character queued (without consuming anything)? */
+static bool kb_char_pending(void)
+{
+    for (uint32_t i = kb_tail; i != kb_head; i++) {
+        if (kb_event_is_char(&kb_events[i & (KB_EVENT_RING_SIZE - 1)])) {
+            return true;
+        }
+    }
+    return false;
 }
 
 /* ---------------------------------------------------------------------------
@@ -352,12 +408,11 @@ static void process_scancode(uint8_t scancode)
             event.ascii = (uint8_t)c;
         }
 
-        /* Add to buffer if it's a printable character or control character */
-        if (c != 0) {
-            kb_buffer_put(c);
-        }
     }
 
+    /* Queue the event; getchar() takes the presses that carry a character */
+    kb_event_put(&event);
+
     /* Call the callback if registered */
     if (key_callback != NULL) {
         key_callback(&event);
@@ -371,15 +426,41 @@ static void process_scancode(uint8_t scancode)
  * ---------------------------------------------------------------------------
  * Called when the keyboard generates an interrupt (key press/release).
  * --------------------------------------------------------------------------- */
-static void keyboard_irq_handler(interrupt_frame_t *frame)
+static bool keyboard_irq_handler(interrupt_frame_t *frame)
 {
     UNUSED(frame);
 
-    /* Read the scancode from the data port */
+    /* Read the scancode from the data port (this acknowledges the byte) */
     uint8_t scancode = inb(KB_DATA_PORT);
 
-    /* Process the scancode */
-    process_scancode(scancode);
+    /* Queue it for the bottom half */
+    if (scancode_head - scancode_tail < KB_SCANCODE_QUEUE_SIZE) {
+        scancode_queue[scancode_head & (KB_SCANCODE_QUEUE_SIZE - 1)] = scancode;
+        scancode_head++;
+    } else {
+        scancodes_dropped++;
+    }
+
+    softirq_raise(SOFTIRQ_KEYBOARD);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * keyboard_bottom_half - SOFTIRQ_KEYBOARD handler
+ * ---------------------------------------------------------------------------
+ * Decodes every scancode queued since the last run, with interrupts enabled.
+ * --------------------------------------------------------------------------- */
+static void keyboard_bottom_half(void)
+{
+    while (scancode_tail != scancode_head) {
+        uint8_t scancode = scancode_queue[scancode_tail & (KB_SCANCODE_QUEUE_SIZE - 1)];
+        scancode_tail++;
+        process_scancode(scancode);
+    }
+
+    if (!kb_buffer_empty()) {
+        wait_queue_wake_all(&kb_waiters);
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -401,6 +482,9 @@ void keyboard_init(void)
     kb_head = 0;
     kb_tail = 0;
     key_callback = NULL;
+    scancode_head = 0;
+    scancode_tail = 0;
+    scancodes_dropped = 0;
 
     /* Enable the first PS/2 port */
     keyboard_wait_input();
@@ -417,8 +501,9 @@ void keyboard_init(void)
     /* Set up the keyboard LEDs */
     keyboard_set_leds(scroll_lock, num_lock, caps_lock);
 
-    /* Register our IRQ handler */
-    irq_register_handler(IRQ1_KEYBOARD, keyboard_irq_handler);
+    /* Register our IRQ top half and its bottom half */
+    softirq_register(SOFTIRQ_KEYBOARD, keyboard_bottom_half);
+    irq_register_handler(IRQ1_KEYBOARD, keyboard_irq_handler, "keyboard");
 
     /* Enable IRQ1 (keyboard) */
     irq_enable(IRQ1_KEYBOARD);
@@ -434,7 +519,10 @@ void keyboard_init(void)
  * --------------------------------------------------------------------------- */
 char keyboard_getchar(void)
 {
-    return kb_buffer_get();
+    uint32_t flags = kernel_lock_irqsave();
+    char c = kb_buffer_get();
+    kernel_unlock_irqrestore(flags);
+    return c;
 }
 
 /* ---------------------------------------------------------------------------
@@ -443,23 +531,24 @@ char keyboard_getchar(void)
  * Returns:
  *   ASCII character from keyboard input
  *
- * This function blocks until a key is pressed.
+ * This function blocks until a key is pressed. The calling task sleeps
+ * on a wait queue instead of spinning.
  * --------------------------------------------------------------------------- */
 char keyboard_getchar_blocking(void)
 {
-    while (kb_buffer_empty()) {
-        /* Hint to CPU that we're in a spin loop */
-        __asm__ volatile("pause");
+    /* Sleep until the bottom half has decoded a character */
+    uint32_t flags = kernel_lock_irqsave();
+    while (!kb_char_pending()) {
+        wait_queue_wait(&kb_waiters);
     }
-    return kb_buffer_get();
+    char c = kb_buffer_get();
+    kernel_unlock_irqrestore(flags);
+    return c;
 }
 
 /* ---------------------------------------------------------------------------
  * keyboard_get_event - Get a key event from the event queue
  * ---------------------------------------------------------------------------
- * Note: This simplified implementation doesn't maintain an event queue.
- * For full event support, you'd need a separate event buffer.
- *
  * Parameters:
  *   event - Pointer to key_event_t to fill
  *
@@ -468,20 +557,10 @@ char keyboard_getchar_blocking(void)
  * --------------------------------------------------------------------------- */
 bool keyboard_get_event(key_event_t *event)
 {
-    /* Simple implementation: get character and create minimal event */
-    char c = keyboard_getchar();
-    if (c == 0) {
-        return false;
-    }
-    
-    event->scancode = 0;  /* Not available in simple mode */
-    event->ascii = (uint8_t)c;
-    event->pressed = true;
-    event->shift = false;
-    event->ctrl = false;
-    event->alt = false;
-    
-    return true;
+    uint32_t flags = kernel_lock_irqsave();
+    bool got = kb_event_get(event);
+    kernel_unlock_irqrestore(flags);
+    return got;
 }
 
 /* ---------------------------------------------------------------------------
@@ -492,7 +571,7 @@ bool keyboard_get_event(key_event_t *event)
  * --------------------------------------------------------------------------- */
 bool keyboard_has_input(void)
 {
-    return !kb_buffer_empty();
+    return kb_char_pending();
 }
 
 /* ---------------------------------------------------------------------------
@@ -502,8 +581,18 @@ bool keyboard_has_input(void)
  * --------------------------------------------------------------------------- */
 void keyboard_clear_buffer(void)
 {
-    kb_head = 0;
-    kb_tail = 0;
+    uint32_t flags = kernel_lock_irqsave();
+    kb_tail = kb_head;
+    kernel_unlock_irqrestore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * keyboard_poll - Readiness of keyboard input for kpoll()
+ * --------------------------------------------------------------------------- */
+uint32_t keyboard_poll(wait_queue_t **wq)
+{
+    *wq = &kb_waiters;
+    return kb_char_pending() ? POLLIN : 0;
 }
 
 /* ---------------------------------------------------------------------------
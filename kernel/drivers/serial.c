@@ -9,16 +9,39 @@
  * It is primarily used for kernel debugging and logging to the host terminal
  * via the COM1 port (0x3F8).
  *
+ * Output:
+ *   Once serial_enable_interrupts() has run, serial_putchar() only copies
+ *   the byte into a TX ring and returns. The THRE (transmit holding register
+ *   empty) interrupt refills the 16-byte FIFO from the ring, so a log line
+ *   costs one interrupt per 16 bytes instead of a busy-wait per byte.
+ *
+ * Polled mode:
+ *   Before interrupts are up, after serial_set_polled(true), and whenever a
+ *   bulk dump outruns the wire and fills the ring, output is pushed
+ *   synchronously - still 16 bytes per THRE, since the FIFO is empty
+ *   whenever THRE is set. A full ring is drained down to half before the
+ *   writer continues, so bulk output never drops bytes.
+ *
+ * Input:
+ *   Received bytes are moved into an RX ring by the receive-data and
+ *   FIFO-timeout interrupts (14-byte trigger level), which then wake
+ *   serial_waiters for kpoll() and epoll watchers.
+ *
  * ===========================================================================
  */
 
 #include "drivers.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+#include "../ipc/poll.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions (from startup.asm)
  * --------------------------------------------------------------------------- */
 extern void outb(uint16_t port, uint8_t value);
 extern uint8_t inb(uint16_t port);
+extern void *memset(void *s, int c, size_t n);
 
 /* ---------------------------------------------------------------------------
  * Serial Port Registers (Offsets from Base)
@@ -43,11 +66,59 @@ extern uint8_t inb(uint16_t port);
 #define LSR_DATA_READY          0x01    /* Data available to read */
 #define LSR_TRANSMIT_EMPTY      0x20    /* Transmit holding register empty */
 
+/* ---------------------------------------------------------------------------
+ * Interrupt Enable / Identification Register Bits
+ * --------------------------------------------------------------------------- */
+#define IER_RX_DATA             0x01    /* Received data available */
+#define IER_TX_EMPTY            0x02    /* Transmit holding register empty */
+
+#define IIR_NO_PENDING          0x01    /* No interrupt pending */
+#define IIR_ID_MASK             0x0E
+#define IIR_MODEM_STATUS        0x00
+#define IIR_TX_EMPTY            0x02
+#define IIR_RX_DATA             0x04
+#define IIR_LINE_STATUS         0x06
+#define IIR_RX_TIMEOUT          0x0C
+
+#define SERIAL_FIFO_DEPTH       16      /* 16550A transmit FIFO */
+#define SERIAL_IRQ_MAX_LOOPS    16      /* Causes served per interrupt */
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * ---------------------------------------------------------------------------
+ * Ring indices are free-running; the sizes are powers of two.
+ * --------------------------------------------------------------------------- */
+static char tx_ring[SERIAL_TX_RING_SIZE];
+static uint32_t tx_head = 0;            /* Next byte to queue */
+static uint32_t tx_tail = 0;            /* Next byte to send */
+
+static char rx_ring[SERIAL_RX_RING_SIZE];
+static volatile uint32_t rx_head = 0;   /* Written by the IRQ handler */
+static volatile uint32_t rx_tail = 0;
+
+static wait_queue_t serial_waiters = WAIT_QUEUE_INIT(serial_waiters);
+static spinlock_t serial_lock = SPINLOCK_INIT;
+static uint8_t ier_shadow = 0;          /* Last value written to the IER */
+static bool serial_present = false;     /* Loopback test passed */
+static bool irq_mode = false;           /* THRE/RX interrupts in use */
+static bool polled_forced = false;      /* serial_set_polled(true) */
+static uint32_t fifo_room = 0;          /* Bytes the FIFO takes before the next THRE poll */
+static serial_stats_t stats;
+
 /* ---------------------------------------------------------------------------
  * serial_init - Initialize the COM1 serial port
  * --------------------------------------------------------------------------- */
 int serial_init(void)
 {
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+    ier_shadow = 0;
+    serial_present = false;
+    irq_mode = false;
+    polled_forced = false;
+    fifo_room = 0;
+    memset(&stats, 0, sizeof(stats));
+
     /* Disable all interrupts */
     outb(SERIAL_COM1_PORT + SERIAL_IER_REG, 0x00);
     
@@ -80,25 +151,231 @@ int serial_init(void)
     /* If serial is not faulty set it in normal operation mode
        (not-loopback with IRQs enabled and OUT#1 and OUT#2 bits enabled) */
     outb(SERIAL_COM1_PORT + SERIAL_MCR_REG, 0x0F);
+    serial_present = true;
     
     return 0;
 }
 
 /* ---------------------------------------------------------------------------
  * is_transmit_empty - Check if the transmit buffer is empty
+ * ---------------------------------------------------------------------------
+ * With the FIFO enabled, THRE means the whole transmit FIFO is empty.
  * --------------------------------------------------------------------------- */
 static int is_transmit_empty(void)
 {
     return inb(SERIAL_COM1_PORT + SERIAL_LSR_REG) & LSR_TRANSMIT_EMPTY;
 }
 
+/* ---------------------------------------------------------------------------
+ * Helpers (called with serial_lock held)
+ * --------------------------------------------------------------------------- */
+
+static void ier_write(uint8_t value)
+{
+    if (ier_shadow != value) {
+        ier_shadow = value;
+        outb(SERIAL_COM1_PORT + SERIAL_IER_REG, value);
+    }
+}
+
+/* Write one byte, waiting for THRE only once per FIFO's worth */
+static void tx_polled(char c)
+{
+    if (fifo_room == 0) {
+        while (is_transmit_empty() == 0);
+        fifo_room = SERIAL_FIFO_DEPTH;
+    }
+    outb(SERIAL_COM1_PORT + SERIAL_DATA_REG, c);
+    fifo_room--;
+    stats.polled_bytes++;
+}
+
+/* Move up to one FIFO's worth from the ring to the chip, if it is idle */
+static void tx_fill(void)
+{
+    if (is_transmit_empty() == 0) {
+        return;
+    }
+    for (uint32_t n = 0; n < SERIAL_FIFO_DEPTH && tx_tail != tx_head; n++) {
+        outb(SERIAL_COM1_PORT + SERIAL_DATA_REG,
+             tx_ring[tx_tail & (SERIAL_TX_RING_SIZE - 1)]);
+        tx_tail++;
+    }
+}
+
+/* Push queued bytes synchronously until at most 'keep' remain */
+static void tx_drain_polled(uint32_t keep)
+{
+    while (tx_head - tx_tail > keep) {
+        tx_polled(tx_ring[tx_tail & (SERIAL_TX_RING_SIZE - 1)]);
+        tx_tail++;
+    }
+}
+
+static void tx_put(char c)
+{
+    stats.tx_bytes++;
+
+    if (!irq_mode || polled_forced) {
+        tx_polled(c);
+        return;
+    }
+
+    if (tx_head - tx_tail == SERIAL_TX_RING_SIZE) {
+        /* Bulk output outran the wire: poll the ring down to half */
+        stats.bulk_switches++;
+        fifo_room = 0;
+        tx_drain_polled(SERIAL_TX_RING_SIZE / 2);
+    }
+
+    tx_ring[tx_head & (SERIAL_TX_RING_SIZE - 1)] = c;
+    tx_head++;
+
+    /* An armed THRE interrupt will pick the byte up; otherwise start it */
+    if ((ier_shadow & IER_TX_EMPTY) == 0) {
+        tx_fill();
+        if (tx_tail != tx_head) {
+            ier_write(ier_shadow | IER_TX_EMPTY);
+        }
+    }
+}
+
+static void rx_drain(void)
+{
+    while (inb(SERIAL_COM1_PORT + SERIAL_LSR_REG) & LSR_DATA_READY) {
+        char c = (char)inb(SERIAL_COM1_PORT + SERIAL_DATA_REG);
+        if (rx_head - rx_tail < SERIAL_RX_RING_SIZE) {
+            rx_ring[rx_head & (SERIAL_RX_RING_SIZE - 1)] = c;
+            rx_head++;
+            stats.rx_bytes++;
+        } else {
+            stats.rx_dropped++;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_irq_handler - COM1 interrupt (IRQ4)
+ * ---------------------------------------------------------------------------
+ * Serves every pending cause: refills the TX FIFO on THRE (and disarms THRE
+ * once the ring is empty), moves received bytes into the RX ring.
+ * --------------------------------------------------------------------------- */
+static bool serial_irq_handler(interrupt_frame_t *frame)
+{
+    UNUSED(frame);
+    bool handled = false;
+
+    spin_lock(&serial_lock);
+    uint32_t rx_start = rx_head;
+    for (int i = 0; i < SERIAL_IRQ_MAX_LOOPS; i++) {
+        uint8_t iir = inb(SERIAL_COM1_PORT + SERIAL_IIR_REG);
+        if (iir & IIR_NO_PENDING) {
+            break;
+        }
+        handled = true;
+
+        switch (iir & IIR_ID_MASK) {
+            case IIR_TX_EMPTY:
+                stats.tx_interrupts++;
+                tx_fill();
+                if (tx_tail == tx_head) {
+                    ier_write(ier_shadow & ~IER_TX_EMPTY);
+                }
+                break;
+            case IIR_RX_DATA:
+            case IIR_RX_TIMEOUT:
+                stats.rx_interrupts++;
+                rx_drain();
+                break;
+            case IIR_LINE_STATUS:
+                inb(SERIAL_COM1_PORT + SERIAL_LSR_REG);
+                break;
+            default:
+                inb(SERIAL_COM1_PORT + SERIAL_MSR_REG);
+                break;
+        }
+    }
+    bool received = (rx_head != rx_start);
+    spin_unlock(&serial_lock);
+
+    if (received) {
+        wait_queue_wake_all(&serial_waiters);
+    }
+    return handled;
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_enable_interrupts - Switch to interrupt-driven operation
+ * ---------------------------------------------------------------------------
+ * Called once the IRQ layer is up. Output written before this went out
+ * polled, so the TX ring starts empty.
+ *
+ * Returns:
+ *   true if interrupts are in use, false if no working UART was found
+ * --------------------------------------------------------------------------- */
+bool serial_enable_interrupts(void)
+{
+    if (!serial_present) {
+        return false;
+    }
+
+    irq_register_handler(IRQ4_COM1, serial_irq_handler, "serial");
+
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    rx_drain();
+    ier_write(IER_RX_DATA);
+    irq_mode = true;
+    spin_unlock_irqrestore(&serial_lock, flags);
+
+    irq_enable(IRQ4_COM1);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_set_polled - Force (or stop forcing) synchronous output
+ * ---------------------------------------------------------------------------
+ * Entering polled mode flushes the ring first, so output stays in order.
+ * Meant for long dumps that should not sit behind the ring, and for paths
+ * that run with interrupts off for good.
+ * --------------------------------------------------------------------------- */
+void serial_set_polled(bool polled)
+{
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    if (polled && !polled_forced) {
+        ier_write(ier_shadow & ~IER_TX_EMPTY);
+        fifo_room = 0;
+        tx_drain_polled(0);
+    }
+    polled_forced = polled;
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_panic_flush - Push out everything still queued, without locking
+ * ---------------------------------------------------------------------------
+ * For the panic path only: interrupts are off for good and the lock may be
+ * held by whatever just crashed, so take it if possible and go on anyway.
+ * --------------------------------------------------------------------------- */
+void serial_panic_flush(void)
+{
+    bool locked = spin_trylock(&serial_lock);
+    ier_write(ier_shadow & ~IER_TX_EMPTY);
+    fifo_room = 0;
+    tx_drain_polled(0);
+    polled_forced = true;
+    if (locked) {
+        spin_unlock(&serial_lock);
+    }
+}
+
 /* ---------------------------------------------------------------------------
  * serial_putchar - Write a character to the serial port
  * --------------------------------------------------------------------------- */
 void serial_putchar(char c)
 {
-    while (is_transmit_empty() == 0);
-    outb(SERIAL_COM1_PORT + SERIAL_DATA_REG, c);
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    tx_put(c);
+    spin_unlock_irqrestore(&serial_lock, flags);
 }
 
 /* ---------------------------------------------------------------------------
@@ -106,9 +383,23 @@ void serial_putchar(char c)
  * --------------------------------------------------------------------------- */
 void serial_write_string(const char *str)
 {
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
     while (*str) {
-        serial_putchar(*str++);
+        tx_put(*str++);
     }
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_write - Write a buffer with explicit length to the serial port
+ * --------------------------------------------------------------------------- */
+void serial_write(const char *str, size_t len)
+{
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    for (size_t i = 0; i < len; i++) {
+        tx_put(str[i]);
+    }
+    spin_unlock_irqrestore(&serial_lock, flags);
 }
 
 /* ---------------------------------------------------------------------------
@@ -116,6 +407,9 @@ void serial_write_string(const char *str)
  * --------------------------------------------------------------------------- */
 bool serial_received(void)
 {
+    if (irq_mode) {
+        return rx_head != rx_tail;
+    }
     return inb(SERIAL_COM1_PORT + SERIAL_LSR_REG) & LSR_DATA_READY;
 }
 
@@ -124,6 +418,51 @@ bool serial_received(void)
  * --------------------------------------------------------------------------- */
 char serial_getchar(void)
 {
-    while (serial_received() == 0);
-    return inb(SERIAL_COM1_PORT + SERIAL_DATA_REG);
+    if (!irq_mode) {
+        while (serial_received() == 0);
+        return inb(SERIAL_COM1_PORT + SERIAL_DATA_REG);
+    }
+
+    for (;;) {
+        uint32_t flags = spin_lock_irqsave(&serial_lock);
+        if (rx_head != rx_tail) {
+            char c = rx_ring[rx_tail & (SERIAL_RX_RING_SIZE - 1)];
+            rx_tail++;
+            spin_unlock_irqrestore(&serial_lock, flags);
+            return c;
+        }
+        if ((flags & 0x200) == 0) {
+            /* Caller has IF clear: nobody will run the RX interrupt for us */
+            rx_drain();
+        }
+        spin_unlock_irqrestore(&serial_lock, flags);
+        __asm__ volatile("pause");
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_poll - Readiness of the port for kpoll()
+ * ---------------------------------------------------------------------------
+ * Output never blocks (a full ring is drained synchronously), so POLLOUT is
+ * always set. Without interrupts there is nobody to wake a watcher, and
+ * *wq is left NULL; callers then only see input on their next check.
+ * --------------------------------------------------------------------------- */
+uint32_t serial_poll(wait_queue_t **wq)
+{
+    *wq = irq_mode ? &serial_waiters : NULL;
+    return POLLOUT | (serial_received() ? POLLIN : 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * serial_get_stats - Copy out the driver counters
+ * --------------------------------------------------------------------------- */
+void serial_get_stats(serial_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&serial_lock);
+    *out = stats;
+    out->tx_queued = tx_head - tx_tail;
+    spin_unlock_irqrestore(&serial_lock, flags);
 }
@@ -26,11 +26,42 @@
  * │  For 100 Hz: divisor = 1193182 / 100 = 11932                            │
  * └──────────────────────────────────────────────────────────────────────────┘
  *
+ * Tickless Idle:
+ *   When nothing is runnable, the idle task can switch channel 0 to mode 0
+ *   (interrupt on terminal count) with a count covering several ticks, up to
+ *   the next sleep deadline. The 16-bit counter limits one shot to ~54ms
+ *   (5 ticks at 100 Hz). If the one-shot fires, all of its ticks are credited
+ *   at once. If another interrupt wakes the CPU first, the elapsed part is
+ *   read back with pit_read_count() and credited. Either way, periodic mode 2
+ *   is restored afterwards. Sub-tick remainders are carried over, so
+ *   tick_count does not drift.
+ *
+ * LAPIC Timer:
+ *   When the APICs deliver interrupts (apic.c), pit_init() measures the
+ *   local APIC timer against the PIT and moves the tick there: the timer
+ *   fires on IRQ0's vector and is acknowledged with the LAPIC EOI, and the
+ *   PIT's I/O APIC line stays masked. Its 32-bit counter lets one tickless
+ *   shot cover seconds instead of ~54ms. All tick accounting below works in
+ *   "counts" of whichever timer is in charge.
+ *
+ *   Every CPU that runs tasks has a LAPIC timer of its own, started with
+ *   pit_start_cpu_tick(). Only the BSP's advances tick_count and goes
+ *   tickless; an AP's tick just drives its own scheduler tick.
+ *
+ * High-Resolution Clock:
+ *   pit_init() calibrates the CPU timestamp counter against a 10ms channel 2
+ *   one-shot. After that, clock_cycles() and clock_ns() give cycle- and
+ *   nanosecond-resolution timestamps. Converting cycles to ns is a
+ *   fixed-point multiply with no division. If calibration fails, clock_ns()
+ *   falls back to tick resolution.
+ *
  * ===========================================================================
  */
 
 #include "drivers.h"
 #include "../interrupts/interrupts.h"
+#include "../scheduler/smp.h"
+#include "../utils/profile.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions (from startup.asm)
@@ -99,6 +130,27 @@ extern uint8_t inb(uint16_t port);
 #define PIT_MIN_FREQUENCY   19      /* Minimum achievable frequency */
 #define PIT_MAX_FREQUENCY   1193182 /* Maximum (divisor = 1) */
 
+/*
+ * Largest one-shot count. Kept below 0xFFFF so a counter that has already
+ * hit terminal count (and wrapped to 0xFFFF..) can be told apart from one
+ * that is still running.
+ */
+#define PIT_ONESHOT_MAX_COUNT   0xF000
+
+/* TSC calibration: one channel 2 shot of this length */
+#define PIT_CALIBRATE_MS        10
+#define PIT_CALIBRATE_COUNT     (PIT_BASE_FREQUENCY / (1000 / PIT_CALIBRATE_MS))
+#define PIT_CALIBRATE_SPINS     1000000     /* Give up if OUT2 never rises */
+
+/* Port 0x61: bit 0 = channel 2 gate, bit 1 = speaker, bit 5 = OUT2 status */
+#define PIT_SPEAKER_PORT        0x61
+#define PIT_SPEAKER_GATE2       0x01
+#define PIT_SPEAKER_ENABLE      0x02
+#define PIT_SPEAKER_OUT2        0x20
+
+/* Fixed-point fraction bits of the cycles -> ns multiplier */
+#define CLOCK_SHIFT             22
+
 /* ---------------------------------------------------------------------------
  * Static Variables
  * --------------------------------------------------------------------------- */
@@ -112,27 +164,205 @@ static uint32_t timer_frequency = SCHEDULER_TICK_HZ;
 /* Milliseconds per tick (for uptime calculation) */
 static uint32_t ms_per_tick = 10;  /* Default: 1000ms / 100Hz = 10ms */
 
+/* Reload value programmed for periodic mode */
+static uint32_t pit_divisor = PIT_BASE_FREQUENCY / SCHEDULER_TICK_HZ;
+
+/* Tick source: PIT channel 0, or the LAPIC timer once calibrated */
+static bool lapic_ticks = false;
+static uint32_t lapic_hz = 0;           /* LAPIC timer counts per second */
+static uint32_t lapic_divisor = 0;      /* LAPIC timer counts per tick */
+
+/* One-shot (tickless) state */
+static volatile bool oneshot_armed = false;
+static uint32_t oneshot_ticks = 0;      /* Ticks the armed shot covers */
+static uint32_t oneshot_count = 0;      /* Counter value it was armed with */
+static uint32_t oneshot_residue = 0;    /* Sub-tick counts carried over */
+
+/* TSC clock calibration (tsc_khz == 0: not calibrated) */
+static uint32_t tsc_khz = 0;
+static uint32_t tsc_mult = 0;           /* ns = cycles * tsc_mult >> CLOCK_SHIFT */
+static uint64_t tsc_base = 0;           /* TSC value at calibration */
+
+/* Statistics */
+static uint32_t timer_irq_count = 0;    /* IRQ0 interrupts taken */
+static uint32_t ticks_skipped = 0;      /* Ticks accounted without an IRQ */
+
 /* Optional callback function for each tick */
 static pit_callback_t tick_callback = NULL;
 
+/* ---------------------------------------------------------------------------
+ * pit_program - Load channel 0 with a mode and a 16-bit count
+ * --------------------------------------------------------------------------- */
+static void pit_program(uint8_t mode, uint32_t count)
+{
+    outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_LOHI | mode | PIT_CMD_BINARY);
+    outb(PIT_CHANNEL0_DATA, (uint8_t)(count & 0xFF));         /* Low byte */
+    outb(PIT_CHANNEL0_DATA, (uint8_t)((count >> 8) & 0xFF));  /* High byte */
+}
+
+/* ---------------------------------------------------------------------------
+ * Tick Source Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Counts of the active timer per tick */
+static uint32_t tick_divisor(void)
+{
+    return lapic_ticks ? lapic_divisor : pit_divisor;
+}
+
+/* (Re)start periodic ticks */
+static void tick_start_periodic(void)
+{
+    if (lapic_ticks) {
+        lapic_timer_start(lapic_divisor, true, false);
+    } else {
+        pit_program(PIT_CMD_MODE2, pit_divisor);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * 64-bit Arithmetic Helpers
+ * ---------------------------------------------------------------------------
+ * The kernel links without libgcc, so 64-bit division is done by hand with
+ * two 32-bit DIVs and scaling with two 32x32->64 multiplies.
+ * --------------------------------------------------------------------------- */
+static uint64_t div_u64_u32(uint64_t dividend, uint32_t divisor)
+{
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quot_high = high / divisor;
+    uint32_t rem = high % divisor;
+    uint32_t quot_low;
+
+    __asm__("divl %4"
+            : "=a"(quot_low), "=d"(rem)
+            : "a"(low), "d"(rem), "rm"(divisor));
+
+    return ((uint64_t)quot_high << 32) | quot_low;
+}
+
+static uint64_t mul_u64_u32_shr(uint64_t value, uint32_t mult, uint32_t shift)
+{
+    uint64_t low = (uint64_t)(uint32_t)value * mult;
+    uint64_t high = (uint64_t)(uint32_t)(value >> 32) * mult;
+    return (low >> shift) + (high << (32 - shift));
+}
+
+/* ---------------------------------------------------------------------------
+ * Calibration Window
+ * ---------------------------------------------------------------------------
+ * Channel 2 is gated on with the speaker disconnected and loaded with a
+ * PIT_CALIBRATE_MS mode 0 count; OUT2 (port 0x61 bit 5) rises at terminal
+ * count. Runs before interrupts are enabled and leaves channel 0 untouched.
+ * --------------------------------------------------------------------------- */
+static uint8_t calibration_begin(void)
+{
+    uint8_t saved = inb(PIT_SPEAKER_PORT);
+    outb(PIT_SPEAKER_PORT, (saved & ~PIT_SPEAKER_ENABLE) | PIT_SPEAKER_GATE2);
+
+    outb(PIT_COMMAND, PIT_CMD_CHANNEL2 | PIT_CMD_LOHI | PIT_CMD_MODE0 | PIT_CMD_BINARY);
+    outb(PIT_CHANNEL2_DATA, (uint8_t)(PIT_CALIBRATE_COUNT & 0xFF));
+    outb(PIT_CHANNEL2_DATA, (uint8_t)((PIT_CALIBRATE_COUNT >> 8) & 0xFF));
+    return saved;
+}
+
+/* Wait for the window to close; false if OUT2 never rose */
+static bool calibration_wait(uint8_t saved)
+{
+    uint32_t spins = 0;
+    while (!(inb(PIT_SPEAKER_PORT) & PIT_SPEAKER_OUT2)) {
+        if (++spins > PIT_CALIBRATE_SPINS) {
+            break;
+        }
+    }
+
+    outb(PIT_SPEAKER_PORT, saved);
+    return spins <= PIT_CALIBRATE_SPINS;
+}
+
+/* ---------------------------------------------------------------------------
+ * clock_calibrate - Measure the TSC rate against PIT channel 2
+ * --------------------------------------------------------------------------- */
+static void clock_calibrate(void)
+{
+    uint8_t saved = calibration_begin();
+    uint64_t start = clock_cycles();
+    bool ok = calibration_wait(saved);
+    uint64_t end = clock_cycles();
+
+    uint64_t cycles = end - start;
+    if (!ok || (cycles >> 32) != 0 || cycles < PIT_CALIBRATE_MS * 1000) {
+        tsc_khz = 0;    /* No usable TSC/PIT: stay on tick resolution */
+        return;
+    }
+
+    tsc_khz = (uint32_t)cycles / PIT_CALIBRATE_MS;
+    tsc_mult = (uint32_t)div_u64_u32(1000000ULL << CLOCK_SHIFT, tsc_khz);
+    tsc_base = end;
+}
+
+/* ---------------------------------------------------------------------------
+ * lapic_calibrate - Measure the LAPIC timer rate against PIT channel 2
+ * ---------------------------------------------------------------------------
+ * The timer counts down masked from its maximum through one window.
+ *
+ * Returns:
+ *   true if the rate is usable for timer_frequency ticks
+ * --------------------------------------------------------------------------- */
+static bool lapic_calibrate(void)
+{
+    uint8_t saved = calibration_begin();
+    lapic_timer_start(0xFFFFFFFFu, false, true);
+    bool ok = calibration_wait(saved);
+    uint32_t counts = 0xFFFFFFFFu - lapic_timer_remaining();
+    lapic_timer_start(0, false, true);
+
+    if (!ok || counts < PIT_CALIBRATE_MS * 100 || counts > 0xFFFFFFFFu / (1000 / PIT_CALIBRATE_MS)) {
+        return false;
+    }
+
+    lapic_hz = counts * (1000 / PIT_CALIBRATE_MS);
+    lapic_divisor = lapic_hz / timer_frequency;
+    return true;
+}
+
 /* ---------------------------------------------------------------------------
  * pit_irq_handler - IRQ0 handler for timer interrupts
  * ---------------------------------------------------------------------------
  * Called by the IRQ subsystem when the PIT generates an interrupt.
  * This runs in interrupt context, so it should be fast and not block.
  * --------------------------------------------------------------------------- */
-static void pit_irq_handler(interrupt_frame_t *frame)
+static bool pit_irq_handler(interrupt_frame_t *frame)
 {
-    /* Suppress unused parameter warning */
-    UNUSED(frame);
+    /* An AP's LAPIC tick: time is kept by the BSP's */
+    if (smp_cpu_id() != 0) {
+        if (tick_callback != NULL) {
+            tick_callback();
+        }
+        return true;
+    }
+
+    timer_irq_count++;
 
-    /* Increment the tick counter */
-    tick_count++;
+    /* Sample the interrupted instruction before the scheduler switches */
+    PROFILE_TICK(frame);
+
+    if (oneshot_armed) {
+        /* Tickless shot expired: credit every tick it covered */
+        oneshot_armed = false;
+        tick_count += oneshot_ticks;
+        ticks_skipped += oneshot_ticks - 1;
+        tick_start_periodic();
+    } else {
+        /* Increment the tick counter */
+        tick_count++;
+    }
 
     /* Call the registered callback (usually the scheduler) */
     if (tick_callback != NULL) {
         tick_callback();
     }
+    return true;
 }
 
 /* ---------------------------------------------------------------------------
@@ -169,6 +399,7 @@ void pit_set_frequency(uint32_t hz)
     }
 
     /* Update frequency and ms_per_tick */
+    pit_divisor = divisor;
     timer_frequency = PIT_BASE_FREQUENCY / divisor;
     ms_per_tick = 1000 / timer_frequency;
     if (ms_per_tick == 0) {
@@ -182,12 +413,12 @@ void pit_set_frequency(uint32_t hz)
      * - Operating mode: rate generator (mode 2)
      * - Binary counter
      */
-    uint8_t command = PIT_CMD_CHANNEL0 | PIT_CMD_LOHI | PIT_CMD_MODE2 | PIT_CMD_BINARY;
-    outb(PIT_COMMAND, command);
-
-    /* Send the divisor (low byte first, then high byte) */
-    outb(PIT_CHANNEL0_DATA, (uint8_t)(divisor & 0xFF));         /* Low byte */
-    outb(PIT_CHANNEL0_DATA, (uint8_t)((divisor >> 8) & 0xFF));  /* High byte */
+    oneshot_armed = false;
+    oneshot_residue = 0;
+    if (lapic_ticks) {
+        lapic_divisor = lapic_hz / timer_frequency;
+    }
+    tick_start_periodic();
 }
 
 /* ---------------------------------------------------------------------------
@@ -201,15 +432,63 @@ void pit_init(void)
     /* Reset tick count */
     tick_count = 0;
     tick_callback = NULL;
+    timer_irq_count = 0;
+    ticks_skipped = 0;
 
     /* Set the timer frequency */
     pit_set_frequency(SCHEDULER_TICK_HZ);
 
+    /* Calibrate the high-resolution clock while interrupts are still off */
+    clock_calibrate();
+
     /* Register our IRQ handler */
-    irq_register_handler(IRQ0_TIMER, pit_irq_handler);
+    irq_register_handler(IRQ0_TIMER, pit_irq_handler, "timer");
+
+    /* Tick from the LAPIC timer where there is one, else enable IRQ0 */
+    lapic_ticks = apic_enabled() && lapic_calibrate();
+    if (lapic_ticks) {
+        irq_disable(IRQ0_TIMER);
+        tick_start_periodic();
+    } else {
+        irq_enable(IRQ0_TIMER);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_start_cpu_tick - Start periodic ticks on the calling AP
+ * ---------------------------------------------------------------------------
+ * Arms this CPU's LAPIC timer at the BSP's calibrated rate. APs cannot tick
+ * from the PIT, whose line goes to the BSP only.
+ *
+ * Returns:
+ *   true if the timer is running, false without LAPIC ticks
+ * --------------------------------------------------------------------------- */
+bool pit_start_cpu_tick(void)
+{
+    if (!lapic_ticks) {
+        return false;
+    }
+    lapic_timer_start(lapic_divisor, true, false);
+    return true;
+}
 
-    /* Enable IRQ0 (timer) */
-    irq_enable(IRQ0_TIMER);
+/* ---------------------------------------------------------------------------
+ * pit_uses_lapic_timer - Whether the LAPIC timer (not the PIT) ticks
+ * --------------------------------------------------------------------------- */
+bool pit_uses_lapic_timer(void)
+{
+    return lapic_ticks;
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_get_frequency - Get the timer interrupt frequency
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Ticks per second actually programmed (after divisor rounding)
+ * --------------------------------------------------------------------------- */
+uint32_t pit_get_frequency(void)
+{
+    return timer_frequency;
 }
 
 /* ---------------------------------------------------------------------------
@@ -326,3 +605,158 @@ uint16_t pit_read_count(void)
     
     return count;
 }
+
+/* ---------------------------------------------------------------------------
+ * pit_oneshot_max_ticks - Longest tickless interval the PIT can program
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Whole ticks that fit in one 16-bit one-shot count
+ * --------------------------------------------------------------------------- */
+uint32_t pit_oneshot_max_ticks(void)
+{
+    if (lapic_ticks) {
+        return 0xFFFFFFFFu / lapic_divisor;
+    }
+    return PIT_ONESHOT_MAX_COUNT / pit_divisor;
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_start_oneshot - Stop periodic ticks and arm a single deadline
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   ticks - Ticks until the next event (clamped to pit_oneshot_max_ticks())
+ *
+ * Returns:
+ *   true if the one-shot was armed, false if it would not save anything
+ *
+ * Must be called with interrupts disabled. Pair with pit_stop_oneshot()
+ * once the CPU wakes up.
+ * --------------------------------------------------------------------------- */
+bool pit_start_oneshot(uint32_t ticks)
+{
+    if (oneshot_armed) {
+        return true;
+    }
+
+    uint32_t max_ticks = pit_oneshot_max_ticks();
+    if (ticks > max_ticks) {
+        ticks = max_ticks;
+    }
+    if (ticks < 2) {
+        return false;   /* A periodic tick is just as good */
+    }
+
+    oneshot_ticks = ticks;
+    oneshot_count = ticks * tick_divisor();
+    oneshot_armed = true;
+    if (lapic_ticks) {
+        lapic_timer_start(oneshot_count, false, false);
+    } else {
+        pit_program(PIT_CMD_MODE0, oneshot_count);
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_stop_oneshot - Account for an interrupted one-shot, resume ticking
+ * ---------------------------------------------------------------------------
+ * If a different interrupt woke the CPU before the shot expired, credit the
+ * ticks that did elapse (read back from the counter) and go back to periodic
+ * mode. If the shot already expired, its IRQ is pending and will do both.
+ *
+ * Must be called with interrupts disabled.
+ * --------------------------------------------------------------------------- */
+void pit_stop_oneshot(void)
+{
+    if (!oneshot_armed) {
+        return;
+    }
+
+    /* Terminal count reached (the PIT wraps, the LAPIC stops at 0): IRQ pending */
+    uint32_t remaining = lapic_ticks ? lapic_timer_remaining() : pit_read_count();
+    if (lapic_ticks ? remaining == 0 : remaining > oneshot_count) {
+        return;
+    }
+
+    uint32_t divisor = tick_divisor();
+    uint32_t elapsed = oneshot_count - remaining + oneshot_residue;
+    uint32_t ticks = elapsed / divisor;
+    oneshot_residue = elapsed - ticks * divisor;
+
+    oneshot_armed = false;
+    tick_count += ticks;
+    ticks_skipped += ticks;
+    tick_start_periodic();
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_get_irq_count - Number of timer interrupts taken since boot
+ * --------------------------------------------------------------------------- */
+uint32_t pit_get_irq_count(void)
+{
+    return timer_irq_count;
+}
+
+/* ---------------------------------------------------------------------------
+ * pit_get_ticks_skipped - Ticks accounted while in tickless mode
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Ticks that advanced tick_count without a timer interrupt of their own
+ * --------------------------------------------------------------------------- */
+uint32_t pit_get_ticks_skipped(void)
+{
+    return ticks_skipped;
+}
+
+/* ---------------------------------------------------------------------------
+ * clock_cycles - Read the CPU timestamp counter
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Raw TSC value (CPU cycles, not serialized)
+ * --------------------------------------------------------------------------- */
+uint64_t clock_cycles(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* ---------------------------------------------------------------------------
+ * clock_cycles_to_ns - Convert a TSC cycle delta to nanoseconds
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Nanoseconds, or 0 if the TSC was not calibrated
+ * --------------------------------------------------------------------------- */
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+    if (tsc_khz == 0) {
+        return 0;
+    }
+    return mul_u64_u32_shr(cycles, tsc_mult, CLOCK_SHIFT);
+}
+
+/* ---------------------------------------------------------------------------
+ * clock_ns - Nanoseconds since the clock was calibrated
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   TSC-based nanoseconds, or tick-based (10ms steps at 100 Hz) if the TSC
+ *   could not be calibrated
+ * --------------------------------------------------------------------------- */
+uint64_t clock_ns(void)
+{
+    if (tsc_khz == 0) {
+        return (uint64_t)tick_count * ms_per_tick * 1000000ULL;
+    }
+    return clock_cycles_to_ns(clock_cycles() - tsc_base);
+}
+
+/* ---------------------------------------------------------------------------
+ * clock_get_khz - Calibrated TSC frequency
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   TSC rate in kHz, or 0 if calibration failed
+ * --------------------------------------------------------------------------- */
+uint32_t clock_get_khz(void)
+{
+    return tsc_khz;
+}
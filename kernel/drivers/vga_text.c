@@ -27,6 +27,18 @@
  * │  Screen coordinates: (0,0) = top-left, (79,24) = bottom-right            │
  * └──────────────────────────────────────────────────────────────────────────┘
  *
+ * Shadow Buffer:
+ *   All drawing goes to a copy of the screen in RAM; vga_flush() copies only
+ *   the lines marked dirty to 0xB8000, 32 bits at a time, and moves the
+ *   hardware cursor once. The shadow is a ring of rows, so scrolling just
+ *   advances the top-row offset and blanks one row - nothing is copied
+ *   until the next flush, and any number of scrolls cost one redraw.
+ *
+ *   Flushes happen at the end of every call except a mid-line
+ *   vga_putchar(), which waits for its newline, the next timer tick or the
+ *   idle loop. The shadow is authoritative: text written straight to
+ *   0xB8000 by someone else lasts until this driver redraws that line.
+ *
  * ===========================================================================
  */
 
@@ -63,6 +75,17 @@ extern uint8_t inb(uint16_t port);
 /* Pointer to VGA text buffer */
 static uint16_t *vga_buffer = (uint16_t *)VGA_BUFFER_ADDR;
 
+/* Shadow copy of the screen: a ring of VGA_HEIGHT rows */
+static uint16_t vga_shadow[VGA_SIZE] __attribute__((aligned(4)));
+static int vga_top = 0;                     /* Shadow row shown on screen row 0 */
+
+/* Flush state */
+static volatile uint32_t vga_dirty = 0;     /* Bit n: screen row n needs a copy */
+static volatile bool vga_cursor_dirty = false;
+static volatile bool vga_busy = false;      /* A writer is mid-update */
+
+#define VGA_ALL_LINES       ((1u << VGA_HEIGHT) - 1)
+
 /* Current cursor position */
 static int vga_col = 0;
 static int vga_row = 0;
@@ -89,6 +112,98 @@ static void update_cursor(void)
     outb(VGA_CRTC_DATA, (uint8_t)((pos >> 8) & 0xFF));
 }
 
+/* ---------------------------------------------------------------------------
+ * Shadow Buffer Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Shadow cells of screen row 'row' */
+static inline uint16_t *vga_line(int row)
+{
+    int line = vga_top + row;
+    if (line >= VGA_HEIGHT) {
+        line -= VGA_HEIGHT;
+    }
+    return &vga_shadow[line * VGA_WIDTH];
+}
+
+static inline void vga_mark(int row)
+{
+    vga_dirty |= 1u << row;
+}
+
+/* Fill one row with blanks, two cells per store */
+static void vga_blank_line(uint16_t *line)
+{
+    uint16_t blank = VGA_ENTRY(' ', vga_color);
+    uint32_t pair = ((uint32_t)blank << 16) | blank;
+    uint32_t count = VGA_WIDTH / 2;
+    __asm__ volatile("rep stosl"
+                     : "+D"(line), "+c"(count)
+                     : "a"(pair)
+                     : "memory");
+}
+
+/* Copy one row to video memory, two cells per store */
+static void vga_copy_line(uint16_t *dst, const uint16_t *src)
+{
+    uint32_t count = VGA_WIDTH / 2;
+    __asm__ volatile("rep movsl"
+                     : "+D"(dst), "+S"(src), "+c"(count)
+                     :
+                     : "memory");
+}
+
+/* Copy dirty rows out and move the cursor (writer or idle context) */
+static void vga_sync(void)
+{
+    uint32_t dirty = vga_dirty;
+    vga_dirty = 0;
+    
+    while (dirty != 0) {
+        int row = __builtin_ctz(dirty);
+        dirty &= dirty - 1;
+        vga_copy_line(&vga_buffer[row * VGA_WIDTH], vga_line(row));
+    }
+    
+    if (vga_cursor_dirty) {
+        vga_cursor_dirty = false;
+        update_cursor();
+    }
+}
+
+/* Writers bracket their updates so a timer-driven flush skips them */
+static inline void vga_begin(void)
+{
+    vga_busy = true;
+    __asm__ volatile("" ::: "memory");
+}
+
+static inline void vga_end(bool flush)
+{
+    if (flush) {
+        vga_sync();
+    }
+    __asm__ volatile("" ::: "memory");
+    vga_busy = false;
+}
+
+/* ---------------------------------------------------------------------------
+ * vga_flush - Copy pending changes to the screen
+ * ---------------------------------------------------------------------------
+ * Called from the timer bottom half and the idle loop so a partial line
+ * shows up without waiting for its newline. Does nothing while a writer is
+ * in the middle of an update; that writer's own flush or the next tick
+ * picks the changes up.
+ * --------------------------------------------------------------------------- */
+void vga_flush(void)
+{
+    if (vga_busy || (vga_dirty == 0 && !vga_cursor_dirty)) {
+        return;
+    }
+    vga_begin();
+    vga_end(true);
+}
+
 /* ---------------------------------------------------------------------------
  * vga_enable_cursor - Enable or disable the hardware cursor
  * ---------------------------------------------------------------------------
@@ -112,22 +227,18 @@ void vga_enable_cursor(bool enable)
 }
 
 /* ---------------------------------------------------------------------------
- * vga_scroll - Scroll the screen up by one line
+ * scroll_line - Scroll the shadow up by one line
  * ---------------------------------------------------------------------------
- * Moves all lines up by one and clears the bottom line.
+ * The old top row becomes the new (blank) bottom row; every screen row
+ * now shows different text, so all of them are redrawn at the next flush.
  * --------------------------------------------------------------------------- */
-void vga_scroll(void)
+static void scroll_line(void)
 {
-    /* Move all lines up by one */
-    for (int i = 0; i < VGA_SIZE - VGA_WIDTH; i++) {
-        vga_buffer[i] = vga_buffer[i + VGA_WIDTH];
-    }
-    
-    /* Clear the last line */
-    uint16_t blank = VGA_ENTRY(' ', vga_color);
-    for (int i = VGA_SIZE - VGA_WIDTH; i < VGA_SIZE; i++) {
-        vga_buffer[i] = blank;
+    vga_blank_line(vga_line(0));
+    if (++vga_top == VGA_HEIGHT) {
+        vga_top = 0;
     }
+    vga_dirty = VGA_ALL_LINES;
     
     /* Adjust cursor position */
     if (vga_row > 0) {
@@ -135,6 +246,19 @@ void vga_scroll(void)
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * vga_scroll - Scroll the screen up by one line
+ * ---------------------------------------------------------------------------
+ * Moves all lines up by one and clears the bottom line.
+ * --------------------------------------------------------------------------- */
+void vga_scroll(void)
+{
+    vga_begin();
+    scroll_line();
+    vga_cursor_dirty = true;
+    vga_end(true);
+}
+
 /* ---------------------------------------------------------------------------
  * vga_init - Initialize the VGA text mode driver
  * ---------------------------------------------------------------------------
@@ -158,15 +282,19 @@ void vga_init(void)
  * --------------------------------------------------------------------------- */
 void vga_clear(void)
 {
-    uint16_t blank = VGA_ENTRY(' ', vga_color);
+    vga_begin();
     
-    for (int i = 0; i < VGA_SIZE; i++) {
-        vga_buffer[i] = blank;
+    vga_top = 0;
+    for (int row = 0; row < VGA_HEIGHT; row++) {
+        vga_blank_line(vga_line(row));
     }
+    vga_dirty = VGA_ALL_LINES;
     
     vga_col = 0;
     vga_row = 0;
-    update_cursor();
+    vga_cursor_dirty = true;
+    
+    vga_end(true);
 }
 
 /* ---------------------------------------------------------------------------
@@ -181,14 +309,11 @@ void vga_set_color(uint8_t color)
 }
 
 /* ---------------------------------------------------------------------------
- * vga_putchar - Write a single character at the cursor position
+ * vga_emit - Place one character in the shadow
  * ---------------------------------------------------------------------------
- * Parameters:
- *   c - Character to write
- *
  * Handles special characters: '\n', '\r', '\t', '\b'
  * --------------------------------------------------------------------------- */
-void vga_putchar(char c)
+static void vga_emit(char c)
 {
     switch (c) {
         case '\n':  /* Newline */
@@ -213,12 +338,14 @@ void vga_putchar(char c)
             if (vga_col > 0) {
                 vga_col--;
                 /* Optionally clear the character */
-                vga_buffer[vga_row * VGA_WIDTH + vga_col] = VGA_ENTRY(' ', vga_color);
+                vga_line(vga_row)[vga_col] = VGA_ENTRY(' ', vga_color);
+                vga_mark(vga_row);
             }
             break;
             
         default:    /* Regular character */
-            vga_buffer[vga_row * VGA_WIDTH + vga_col] = VGA_ENTRY(c, vga_color);
+            vga_line(vga_row)[vga_col] = VGA_ENTRY(c, vga_color);
+            vga_mark(vga_row);
             vga_col++;
             
             /* Wrap to next line if needed */
@@ -231,11 +358,27 @@ void vga_putchar(char c)
     
     /* Scroll if we've gone past the bottom */
     while (vga_row >= VGA_HEIGHT) {
-        vga_scroll();
+        scroll_line();
         vga_row = VGA_HEIGHT - 1;
     }
     
-    update_cursor();
+    vga_cursor_dirty = true;
+}
+
+/* ---------------------------------------------------------------------------
+ * vga_putchar - Write a single character at the cursor position
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   c - Character to write
+ *
+ * Handles special characters: '\n', '\r', '\t', '\b'. The screen is only
+ * updated at the end of a line; see vga_flush() for partial lines.
+ * --------------------------------------------------------------------------- */
+void vga_putchar(char c)
+{
+    vga_begin();
+    vga_emit(c);
+    vga_end(vga_col == 0);
 }
 
 /* ---------------------------------------------------------------------------
@@ -250,9 +393,11 @@ void vga_write_string(const char *str)
         return;
     }
     
-    while (*str) {
-        vga_putchar(*str++);
+    size_t len = 0;
+    while (str[len]) {
+        len++;
     }
+    vga_write(str, len);
 }
 
 /* ---------------------------------------------------------------------------
@@ -261,16 +406,54 @@ void vga_write_string(const char *str)
  * Parameters:
  *   str - String to write (doesn't need to be null-terminated)
  *   len - Number of characters to write
+ *
+ * Renders the whole buffer into the shadow in one pass: runs of printable
+ * characters are stored straight into the current row, and the screen and
+ * hardware cursor are updated once at the end.
  * --------------------------------------------------------------------------- */
 void vga_write(const char *str, size_t len)
 {
-    if (str == NULL) {
+    if (str == NULL || len == 0) {
         return;
     }
     
-    for (size_t i = 0; i < len; i++) {
-        vga_putchar(str[i]);
+    vga_begin();
+    
+    size_t i = 0;
+    while (i < len) {
+        char c = str[i];
+        if (c == '\n' || c == '\r' || c == '\t' || c == '\b') {
+            vga_emit(c);
+            i++;
+            continue;
+        }
+        
+        /* Copy as much of the printable run as fits on this row */
+        uint16_t *cell = &vga_line(vga_row)[vga_col];
+        int room = VGA_WIDTH - vga_col;
+        int n = 0;
+        while (n < room && i < len) {
+            c = str[i];
+            if (c == '\n' || c == '\r' || c == '\t' || c == '\b') {
+                break;
+            }
+            cell[n++] = VGA_ENTRY((uint8_t)c, vga_color);
+            i++;
+        }
+        vga_mark(vga_row);
+        
+        vga_col += n;
+        if (vga_col >= VGA_WIDTH) {
+            vga_col = 0;
+            if (++vga_row >= VGA_HEIGHT) {
+                scroll_line();
+                vga_row = VGA_HEIGHT - 1;
+            }
+        }
     }
+    
+    vga_cursor_dirty = true;
+    vga_end(true);
 }
 
 /* ---------------------------------------------------------------------------
@@ -287,7 +470,10 @@ void vga_put_at(char c, int x, int y)
         return;
     }
     
-    vga_buffer[y * VGA_WIDTH + x] = VGA_ENTRY(c, vga_color);
+    vga_begin();
+    vga_line(y)[x] = VGA_ENTRY(c, vga_color);
+    vga_mark(y);
+    vga_end(true);
 }
 
 /* ---------------------------------------------------------------------------
@@ -304,9 +490,11 @@ void vga_set_cursor(int x, int y)
     if (y < 0) y = 0;
     if (y >= VGA_HEIGHT) y = VGA_HEIGHT - 1;
     
+    vga_begin();
     vga_col = x;
     vga_row = y;
-    update_cursor();
+    vga_cursor_dirty = true;
+    vga_end(true);
 }
 
 /* ---------------------------------------------------------------------------
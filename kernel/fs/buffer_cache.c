@@ -0,0 +1,446 @@
+/*
+ * ===========================================================================
+ * kernel/fs/buffer_cache.c
+ * ===========================================================================
+ *
+ * Block Buffer Cache
+ *
+ * A fixed pool of BCACHE_BUFFERS frame-sized buffers, found through a hash
+ * of (device, block) and ordered on an LRU list. Buffers move to the front
+ * whenever they are read; victims come from the back.
+ *
+ * Read-ahead:
+ *   A miss on block N also queues reads for blocks N+1..N+BCACHE_READAHEAD
+ *   that are not cached, using only clean idle buffers. Those requests are
+ *   adjacent on disk, so the block layer merges them into the miss's own
+ *   command when it is still queued, or into one follow-up command.
+ *
+ * Writeback:
+ *   Clean buffers are evicted first. When the victim search passes dirty
+ *   buffers at the cold end of the LRU list, up to BCACHE_WRITEBACK_BATCH
+ *   of them are written back in one go (so the elevator can sort and merge
+ *   them) and become clean victims later. Only when every idle buffer is
+ *   dirty does a miss wait for a writeback to finish.
+ *
+ * Reclaim:
+ *   bcache_reclaim() is registered with the frame allocator and runs when
+ *   frame_alloc() finds no free frame. A clock hand sweeps the pool with a
+ *   second chance: buffers used since the last pass (BUF_REFERENCED) only
+ *   lose the bit, idle clean unreferenced ones lose their block and their
+ *   frame. A frameless buffer takes a new frame when it is next chosen as a
+ *   victim, and is skipped while none is free.
+ *
+ * All cache state is changed under the kernel lock with interrupts
+ * disabled, since completions arrive from the disk IRQ handler.
+ *
+ * ===========================================================================
+ */
+
+#include "buffer_cache.h"
+#include "../memory/memory.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+#include "../../config/os_config.h"
+
+#define BCACHE_BUCKETS  BCACHE_BUFFERS      /* Power of two */
+
+/* ---------------------------------------------------------------------------
+ * State
+ * --------------------------------------------------------------------------- */
+static buffer_t buffers[BCACHE_BUFFERS];
+static buffer_t *buckets[BCACHE_BUCKETS];
+static list_t lru;
+static bcache_stats_t stats;
+static bool bcache_ready = false;
+
+/* Reclaim clock position in buffers[] */
+static uint32_t clock_hand = 0;
+
+/* Set while the cache allocates a frame itself (reclaiming would just trade frames) */
+static bool bcache_allocating = false;
+
+/* Tasks waiting for a buffer's I/O (each rechecks its own buffer) */
+static wait_queue_t bcache_waiters = WAIT_QUEUE_INIT(bcache_waiters);
+
+/* ---------------------------------------------------------------------------
+ * Hashing
+ * --------------------------------------------------------------------------- */
+
+static uint32_t bcache_bucket(const block_device_t *dev, uint32_t block)
+{
+    uint32_t hash = ((uint32_t)(uintptr_t)dev >> 4) ^ (block * 0x9E3779B1u);
+    return (hash ^ (hash >> 16)) & (BCACHE_BUCKETS - 1);
+}
+
+static buffer_t *bcache_find(const block_device_t *dev, uint32_t block)
+{
+    for (buffer_t *buf = buckets[bcache_bucket(dev, block)]; buf != NULL; buf = buf->hash_next) {
+        if (buf->dev == dev && buf->block == block) {
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+static void bcache_unhash(buffer_t *buf)
+{
+    if (buf->dev == NULL) {
+        return;
+    }
+
+    buffer_t **link = &buckets[bcache_bucket(buf->dev, buf->block)];
+    while (*link != NULL && *link != buf) {
+        link = &(*link)->hash_next;
+    }
+    if (*link != NULL) {
+        *link = buf->hash_next;
+    }
+    buf->hash_next = NULL;
+    buf->dev = NULL;
+}
+
+static void bcache_hash(buffer_t *buf, block_device_t *dev, uint32_t block)
+{
+    uint32_t bucket = bcache_bucket(dev, block);
+    buf->dev = dev;
+    buf->block = block;
+    buf->hash_next = buckets[bucket];
+    buckets[bucket] = buf;
+}
+
+static void bcache_touch(buffer_t *buf)
+{
+    buf->flags |= BUF_REFERENCED;
+    list_remove(&lru, &buf->lru_node);
+    list_push_front(&lru, &buf->lru_node);
+}
+
+/* ---------------------------------------------------------------------------
+ * I/O
+ * --------------------------------------------------------------------------- */
+
+/* block_request_t::done - runs in IRQ context */
+static void bcache_io_done(block_request_t *req)
+{
+    buffer_t *buf = (buffer_t *)req->private;
+
+    if (req->status == BLOCK_STATUS_OK) {
+        buf->flags = (buf->flags & ~(BUF_BUSY | BUF_ERROR)) | BUF_VALID;
+    } else if (req->write) {
+        buf->flags = (buf->flags & ~BUF_BUSY) | BUF_DIRTY | BUF_ERROR;
+    } else {
+        buf->flags = (buf->flags & ~(BUF_BUSY | BUF_VALID)) | BUF_ERROR;
+    }
+    wait_queue_wake_all(&bcache_waiters);
+}
+
+/* Queue a read or write of the whole buffer (kernel lock held) */
+static void bcache_start_io(buffer_t *buf, bool write)
+{
+    buf->req.sector = buf->block * BCACHE_BLOCK_SECTORS;
+    buf->req.count = BCACHE_BLOCK_SECTORS;
+    buf->req.buffer = buf->data;
+    buf->req.write = write;
+    buf->req.done = bcache_io_done;
+    buf->req.private = buf;
+
+    buf->flags |= BUF_BUSY;
+    if (write) {
+        buf->flags &= ~BUF_DIRTY;
+        stats.writebacks++;
+    }
+
+    if (!block_submit(buf->dev, &buf->req)) {
+        buf->req.status = BLOCK_STATUS_ERROR;
+        bcache_io_done(&buf->req);
+    }
+}
+
+/* Sleep until the buffer's I/O is done (kernel lock held) */
+static void bcache_wait(buffer_t *buf)
+{
+    while (buf->flags & BUF_BUSY) {
+        wait_queue_wait(&bcache_waiters);
+    }
+}
+
+/* Start writing back the coldest dirty idle buffers */
+static void bcache_writeback_lru(void)
+{
+    uint32_t started = 0;
+    for (list_node_t *node = lru.tail; node != NULL && started < BCACHE_WRITEBACK_BATCH;
+         node = node->prev) {
+        buffer_t *buf = list_entry(node, buffer_t, lru_node);
+        if (buf->ref_count == 0 && (buf->flags & (BUF_DIRTY | BUF_BUSY)) == BUF_DIRTY) {
+            bcache_start_io(buf, true);
+            started++;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * bcache_victim - Take an idle buffer for reuse (kernel lock held)
+ * ---------------------------------------------------------------------------
+ * With allow_dirty, dirty candidates are written back and waited for;
+ * without it (read-ahead) only clean buffers are taken.
+ *
+ * Returns:
+ *   An unhashed buffer, or NULL if none is available
+ * --------------------------------------------------------------------------- */
+static buffer_t *bcache_victim(bool allow_dirty)
+{
+    for (;;) {
+        buffer_t *dirty = NULL;
+        for (list_node_t *node = lru.tail; node != NULL; node = node->prev) {
+            buffer_t *buf = list_entry(node, buffer_t, lru_node);
+            if (buf->ref_count != 0 || (buf->flags & BUF_BUSY)) {
+                continue;
+            }
+            if (buf->data == NULL) {
+                /* Reclaimed earlier: only usable if a frame is free again */
+                bcache_allocating = true;
+                buf->data = (uint8_t *)frame_alloc();
+                bcache_allocating = false;
+                if (buf->data == NULL) {
+                    continue;
+                }
+            }
+            if (!(buf->flags & BUF_DIRTY)) {
+                /* Dirty buffers colder than the victim: start flushing them */
+                if (dirty != NULL && allow_dirty) {
+                    bcache_writeback_lru();
+                }
+                bcache_unhash(buf);
+                buf->flags = 0;
+                return buf;
+            }
+            if (dirty == NULL) {
+                dirty = buf;
+            }
+        }
+
+        if (!allow_dirty || dirty == NULL) {
+            return NULL;
+        }
+
+        /* Everything idle is dirty: flush a batch and retry once it lands */
+        bcache_writeback_lru();
+        dirty->ref_count++;
+        bcache_wait(dirty);
+        dirty->ref_count--;
+        if (dirty->flags & BUF_ERROR) {
+            return NULL;    /* Cannot drop data the disk refused */
+        }
+    }
+}
+
+/* Queue reads for the blocks after 'block' that are not cached */
+static void bcache_readahead(block_device_t *dev, uint32_t block)
+{
+    uint32_t blocks = dev->sector_count / BCACHE_BLOCK_SECTORS;
+
+    for (uint32_t i = 1; i <= BCACHE_READAHEAD && block + i < blocks; i++) {
+        if (bcache_find(dev, block + i) != NULL) {
+            continue;
+        }
+
+        buffer_t *buf = bcache_victim(false);
+        if (buf == NULL) {
+            return;
+        }
+        bcache_hash(buf, dev, block + i);
+        bcache_touch(buf);
+        bcache_start_io(buf, false);
+        stats.readahead++;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * bcache_reclaim - Free the frames of cold clean buffers (frame_reclaim_t)
+ * ---------------------------------------------------------------------------
+ * Runs from frame_alloc(), possibly with the kernel lock already held. Two
+ * sweeps of the clock at most: the first may only clear reference bits.
+ * --------------------------------------------------------------------------- */
+static size_t bcache_reclaim(size_t wanted)
+{
+    if (bcache_allocating) {
+        return 0;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+
+    size_t freed = 0;
+    for (uint32_t step = 0; step < 2 * BCACHE_BUFFERS && freed < wanted; step++) {
+        buffer_t *buf = &buffers[clock_hand];
+        clock_hand = (clock_hand + 1) % BCACHE_BUFFERS;
+
+        if (buf->data == NULL || buf->ref_count != 0 ||
+            (buf->flags & (BUF_BUSY | BUF_DIRTY))) {
+            continue;
+        }
+        if (buf->flags & BUF_REFERENCED) {
+            buf->flags &= ~BUF_REFERENCED;  /* Second chance */
+            continue;
+        }
+
+        bcache_unhash(buf);
+        buf->flags = 0;
+        frame_free((uintptr_t)buf->data);
+        buf->data = NULL;
+        freed++;
+    }
+    stats.reclaimed += freed;
+
+    kernel_unlock_irqrestore(flags);
+    return freed;
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API
+ * --------------------------------------------------------------------------- */
+
+bool bcache_init(void)
+{
+    if (bcache_ready) {
+        return true;
+    }
+
+    list_init(&lru);
+    for (int i = 0; i < BCACHE_BUCKETS; i++) {
+        buckets[i] = NULL;
+    }
+
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buffer_t *buf = &buffers[i];
+        uintptr_t frame = frame_alloc();
+        if (frame == 0) {
+            /* Run with what we have */
+            break;
+        }
+        buf->data = (uint8_t *)frame;
+        buf->dev = NULL;
+        buf->hash_next = NULL;
+        buf->ref_count = 0;
+        buf->flags = 0;
+        list_node_init(&buf->lru_node);
+        list_push_back(&lru, &buf->lru_node);
+    }
+
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.readahead = 0;
+    stats.writebacks = 0;
+    stats.reclaimed = 0;
+
+    bcache_ready = !list_is_empty(&lru);
+    if (bcache_ready) {
+        frame_register_reclaim(bcache_reclaim);
+    }
+    return bcache_ready;
+}
+
+buffer_t *bcache_read(block_device_t *dev, uint32_t block)
+{
+    if (!bcache_ready || dev == NULL || block >= dev->sector_count / BCACHE_BLOCK_SECTORS) {
+        return NULL;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+
+    buffer_t *buf = bcache_find(dev, block);
+    if (buf != NULL) {
+        stats.hits++;
+        buf->ref_count++;
+    } else {
+        stats.misses++;
+        buf = bcache_victim(true);
+        if (buf == NULL) {
+            kernel_unlock_irqrestore(flags);
+            return NULL;
+        }
+        bcache_hash(buf, dev, block);
+        buf->ref_count = 1;
+        bcache_start_io(buf, false);
+        bcache_readahead(dev, block);
+    }
+    bcache_touch(buf);
+
+    /* A hit may still be in flight (read-ahead) or have failed earlier */
+    bcache_wait(buf);
+    if (!(buf->flags & BUF_VALID)) {
+        bcache_start_io(buf, false);
+        bcache_wait(buf);
+    }
+
+    if (!(buf->flags & BUF_VALID)) {
+        buf->ref_count--;
+        kernel_unlock_irqrestore(flags);
+        return NULL;
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return buf;
+}
+
+void bcache_mark_dirty(buffer_t *buf)
+{
+    if (buf != NULL) {
+        uint32_t flags = kernel_lock_irqsave();
+        buf->flags |= BUF_DIRTY;
+        kernel_unlock_irqrestore(flags);
+    }
+}
+
+void bcache_release(buffer_t *buf)
+{
+    if (buf == NULL) {
+        return;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    if (buf->ref_count == 0) {
+        PANIC("bcache_release: buffer not referenced");
+    }
+    buf->ref_count--;
+    kernel_unlock_irqrestore(flags);
+}
+
+int bcache_sync(block_device_t *dev)
+{
+    if (!bcache_ready) {
+        return 0;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+
+    /* Queue everything first so the elevator sees the whole batch */
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buffer_t *buf = &buffers[i];
+        if (buf->dev != NULL && (dev == NULL || buf->dev == dev) &&
+            (buf->flags & (BUF_DIRTY | BUF_BUSY)) == BUF_DIRTY) {
+            bcache_start_io(buf, true);
+        }
+    }
+
+    int result = 0;
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buffer_t *buf = &buffers[i];
+        if (buf->dev != NULL && (dev == NULL || buf->dev == dev)) {
+            bcache_wait(buf);
+            if ((buf->flags & (BUF_DIRTY | BUF_ERROR)) == (BUF_DIRTY | BUF_ERROR)) {
+                result = -1;
+            }
+        }
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return result;
+}
+
+void bcache_get_stats(bcache_stats_t *out)
+{
+    if (out != NULL) {
+        *out = stats;
+    }
+}
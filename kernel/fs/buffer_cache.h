@@ -0,0 +1,87 @@
+/*
+ * ===========================================================================
+ * kernel/fs/buffer_cache.h
+ * ===========================================================================
+ *
+ * Block Buffer Cache Interface
+ *
+ * Caches disk blocks of BCACHE_BLOCK_SIZE bytes (one frame each) in front
+ * of the block layer. A buffer is returned referenced and valid; callers
+ * modify buf->data, mark it dirty, and release it. Dirty buffers are
+ * written back when they reach the cold end of the LRU list or on
+ * bcache_sync(). Under memory pressure the frames of idle clean buffers
+ * are handed back to the frame allocator; such buffers get a new frame
+ * when they are reused.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_BUFFER_CACHE_H
+#define NEXA_BUFFER_CACHE_H
+
+#include "../drivers/drivers.h"
+#include "../../config/os_config.h"
+
+#define BCACHE_BLOCK_SIZE       PAGE_SIZE
+#define BCACHE_BLOCK_SECTORS    (BCACHE_BLOCK_SIZE / BLOCK_SECTOR_SIZE)
+
+/* buffer_t::flags */
+#define BUF_VALID   (1 << 0)        /* data matches (or supersedes) the disk */
+#define BUF_DIRTY   (1 << 1)        /* data must be written back */
+#define BUF_BUSY    (1 << 2)        /* I/O in flight */
+#define BUF_ERROR   (1 << 3)        /* last I/O failed */
+#define BUF_REFERENCED (1 << 4)     /* used since the reclaim clock last passed */
+
+typedef struct buffer {
+    struct buffer *hash_next;       /* Bucket chain */
+    list_node_t lru_node;           /* Most recently used first */
+    block_device_t *dev;            /* NULL = unused */
+    uint32_t block;                 /* Block number on dev */
+    uint8_t *data;                  /* BCACHE_BLOCK_SIZE bytes (NULL = reclaimed) */
+    uint32_t ref_count;
+    volatile uint32_t flags;        /* BUF_* */
+    block_request_t req;            /* Used while BUF_BUSY */
+} buffer_t;
+
+typedef struct bcache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t readahead;             /* Blocks read ahead of a miss */
+    uint32_t writebacks;            /* Dirty blocks written */
+    uint32_t reclaimed;             /* Frames given back under memory pressure */
+} bcache_stats_t;
+
+/**
+ * @brief Allocate the buffer pool
+ * @return true on success
+ */
+bool bcache_init(void);
+
+/**
+ * @brief Get a referenced, valid buffer for a block (reads it on a miss)
+ * @return The buffer, or NULL on I/O error or if every buffer is in use
+ */
+buffer_t *bcache_read(block_device_t *dev, uint32_t block);
+
+/**
+ * @brief Note that buf->data was modified
+ */
+void bcache_mark_dirty(buffer_t *buf);
+
+/**
+ * @brief Drop a reference from bcache_read()
+ */
+void bcache_release(buffer_t *buf);
+
+/**
+ * @brief Write back every dirty buffer of a device (NULL = all devices)
+ * @return 0 on success, -1 if any write failed
+ */
+int bcache_sync(block_device_t *dev);
+
+/**
+ * @brief Copy the cache counters
+ */
+void bcache_get_stats(bcache_stats_t *out);
+
+#endif /* NEXA_BUFFER_CACHE_H */
@@ -13,7 +13,9 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <lib/dsa/tree.h>
+#include "../../config/os_config.h"
 
 /* Trie Wrapper */
 void fs_index_init(void);
@@ -33,4 +35,31 @@ bool file_table_add(const char *path, void *file_struct);
 void *file_table_get(const char *path);
 void file_table_remove(const char *path);
 
+/* Dentry Cache (parent, name) -> inode, NULL inode = negative entry */
+typedef struct dcache_stats {
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t misses;
+    uint32_t evictions;
+} dcache_stats_t;
+
+void dcache_init(void);
+bool dcache_lookup(const void *parent, const char *name, size_t len, void **inode);
+void dcache_add(const void *parent, const char *name, size_t len, void *inode);
+void dcache_invalidate(const void *parent, const char *name, size_t len);
+void dcache_purge_dir(const void *dir);
+void dcache_get_stats(dcache_stats_t *out);
+
+/* Per-Directory Hash Index */
+typedef struct dir_index dir_index_t;
+
+uint32_t fs_name_hash(const char *name, size_t len);
+dir_index_t *dir_index_create(uint32_t expected);
+void dir_index_destroy(dir_index_t *index);
+bool dir_index_insert(dir_index_t *index, uint32_t hash, void *entry);
+void *dir_index_lookup(dir_index_t *index, uint32_t hash, const char *name, size_t len,
+                       bool (*match)(void *entry, const char *name, size_t len));
+bool dir_index_remove(dir_index_t *index, uint32_t hash, void *entry);
+uint32_t dir_index_count(const dir_index_t *index);
+
 #endif /* NEXA_FS_DSA_H */
@@ -0,0 +1,212 @@
+#include "../dsa_structures.h"
+#include <lib/dsa/list.h>
+#include <lib/dsa/hashmap.h>
+
+/*
+ * kernel/fs/dsa_structures/dentry_cache.c
+ *
+ * Directory Entry Cache
+ *
+ * This file caches the result of looking up one path component: the pair
+ * (parent directory, component name) maps to the child inode, or to "does
+ * not exist" (a negative entry). Path walks check it before scanning a
+ * directory, so repeated lookups of the same names, including probes for
+ * files that are not there, skip the directory scan entirely.
+ *
+ * Entries come from a fixed pool. An open-addressing table with Robin Hood
+ * probing finds them: each slot holds the entry's full hash next to its
+ * pointer, so a probe only touches entries whose hash matches. The table
+ * has twice as many slots as the pool has entries, so it never needs to
+ * grow. An LRU list picks the victim when the pool is full. Names longer
+ * than DCACHE_NAME_MAX are not cached.
+ *
+ * The filesystem must call dcache_add() or dcache_invalidate() whenever an
+ * entry is created or removed, and dcache_purge_dir() before a directory's
+ * inode is freed, since entries are keyed by the parent's address.
+ */
+
+extern int memcmp(const void *s1, const void *s2, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+#define DCACHE_SLOTS    (DCACHE_ENTRIES * 2)    // Load factor at most 1/2
+
+typedef struct dentry {
+    list_node_t lru_node;               // In lru (most recent first) or free_list
+    const void *parent;
+    void *inode;                        // NULL = negative entry
+    uint32_t hash;
+    uint8_t len;
+    char name[DCACHE_NAME_MAX];
+    bool in_use;
+} dentry_t;
+
+typedef struct dcache_slot {
+    uint32_t hash;                      // Copy of entry->hash
+    dentry_t *entry;                    // NULL = empty
+} dcache_slot_t;
+
+static dentry_t dentries[DCACHE_ENTRIES];
+static dcache_slot_t slots[DCACHE_SLOTS];
+static list_t lru;
+static list_t free_list;
+static dcache_stats_t stats;
+
+/* xxHash32 over the name, seeded with the parent's address */
+static uint32_t dcache_hash(const void *parent, const char *name, size_t len) {
+    return hashmap_hash_bytes(name, len, (uint32_t)(uintptr_t)parent * 0x9E3779B1u);
+}
+
+/* Probe distance of the occupant of slot i from its home */
+static inline uint32_t slot_distance(uint32_t i, uint32_t hash) {
+    return (i - hash) & (DCACHE_SLOTS - 1);
+}
+
+static dentry_t *dcache_find(const void *parent, const char *name, size_t len, uint32_t hash) {
+    uint32_t i = hash & (DCACHE_SLOTS - 1);
+    for (uint32_t dist = 0; dist < DCACHE_SLOTS; dist++, i = (i + 1) & (DCACHE_SLOTS - 1)) {
+        dcache_slot_t *slot = &slots[i];
+        if (!slot->entry || slot_distance(i, slot->hash) < dist) return NULL;
+        if (slot->hash == hash) {
+            dentry_t *d = slot->entry;
+            if (d->parent == parent && d->len == len && memcmp(d->name, name, len) == 0) {
+                return d;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Robin Hood insert: a further-travelled entry takes the slot of a closer one */
+static void dcache_hash_insert(dentry_t *entry) {
+    dcache_slot_t carry = { entry->hash, entry };
+    uint32_t i = carry.hash & (DCACHE_SLOTS - 1);
+    uint32_t dist = 0;
+
+    while (slots[i].entry) {
+        uint32_t slot_dist = slot_distance(i, slots[i].hash);
+        if (slot_dist < dist) {
+            dcache_slot_t displaced = slots[i];
+            slots[i] = carry;
+            carry = displaced;
+            dist = slot_dist;
+        }
+        i = (i + 1) & (DCACHE_SLOTS - 1);
+        dist++;
+    }
+    slots[i] = carry;
+}
+
+/* Remove an entry's slot and shift the run after it back by one */
+static void dcache_unhash(dentry_t *entry) {
+    uint32_t i = entry->hash & (DCACHE_SLOTS - 1);
+    while (slots[i].entry != entry) {
+        if (!slots[i].entry) return;
+        i = (i + 1) & (DCACHE_SLOTS - 1);
+    }
+
+    for (;;) {
+        uint32_t next = (i + 1) & (DCACHE_SLOTS - 1);
+        if (!slots[next].entry || slot_distance(next, slots[next].hash) == 0) break;
+        slots[i] = slots[next];
+        i = next;
+    }
+    slots[i].entry = NULL;
+}
+
+static void dcache_release(dentry_t *entry) {
+    dcache_unhash(entry);
+    list_remove(&lru, &entry->lru_node);
+    entry->in_use = false;
+    list_push_back(&free_list, &entry->lru_node);
+}
+
+void dcache_init(void) {
+    list_init(&lru);
+    list_init(&free_list);
+    for (size_t i = 0; i < DCACHE_SLOTS; i++) slots[i].entry = NULL;
+    for (size_t i = 0; i < DCACHE_ENTRIES; i++) {
+        dentries[i].in_use = false;
+        list_node_init(&dentries[i].lru_node);
+        list_push_back(&free_list, &dentries[i].lru_node);
+    }
+    stats.hits = 0;
+    stats.negative_hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+}
+
+bool dcache_lookup(const void *parent, const char *name, size_t len, void **inode) {
+    if (len > DCACHE_NAME_MAX) {
+        stats.misses++;
+        return false;
+    }
+
+    dentry_t *entry = dcache_find(parent, name, len, dcache_hash(parent, name, len));
+    if (!entry) {
+        stats.misses++;
+        return false;
+    }
+
+    // Move to the front of the LRU list
+    list_remove(&lru, &entry->lru_node);
+    list_push_front(&lru, &entry->lru_node);
+
+    if (entry->inode) stats.hits++;
+    else stats.negative_hits++;
+    *inode = entry->inode;
+    return true;
+}
+
+void dcache_add(const void *parent, const char *name, size_t len, void *inode) {
+    if (len > DCACHE_NAME_MAX) return;
+
+    uint32_t hash = dcache_hash(parent, name, len);
+    dentry_t *entry = dcache_find(parent, name, len, hash);
+    if (entry) {
+        // Creation over a negative entry (or a refresh)
+        entry->inode = inode;
+        list_remove(&lru, &entry->lru_node);
+        list_push_front(&lru, &entry->lru_node);
+        return;
+    }
+
+    list_node_t *node = list_pop_front(&free_list);
+    if (!node) {
+        // Pool full: recycle the least recently used entry
+        node = lru.tail;
+        dcache_release(list_entry(node, dentry_t, lru_node));
+        node = list_pop_front(&free_list);
+        stats.evictions++;
+    }
+
+    entry = list_entry(node, dentry_t, lru_node);
+    entry->parent = parent;
+    entry->inode = inode;
+    entry->hash = hash;
+    entry->len = (uint8_t)len;
+    memcpy(entry->name, name, len);
+    entry->in_use = true;
+
+    dcache_hash_insert(entry);
+    list_push_front(&lru, &entry->lru_node);
+}
+
+void dcache_invalidate(const void *parent, const char *name, size_t len) {
+    if (len > DCACHE_NAME_MAX) return;
+
+    dentry_t *entry = dcache_find(parent, name, len, dcache_hash(parent, name, len));
+    if (entry) dcache_release(entry);
+}
+
+void dcache_purge_dir(const void *dir) {
+    for (size_t i = 0; i < DCACHE_ENTRIES; i++) {
+        dentry_t *entry = &dentries[i];
+        if (entry->in_use && (entry->parent == dir || entry->inode == dir)) {
+            dcache_release(entry);
+        }
+    }
+}
+
+void dcache_get_stats(dcache_stats_t *out) {
+    if (out) *out = stats;
+}
@@ -0,0 +1,145 @@
+#include "../dsa_structures.h"
+#include "../../memory/memory.h"
+#include <lib/dsa/hashmap.h>
+
+/*
+ * kernel/fs/dsa_structures/dir_index.c
+ *
+ * Per-Directory Hash Index
+ *
+ * This file provides an open-addressing hash table from entry name to
+ * directory entry, for directories too large to scan their sibling list on
+ * every lookup. Slots store the name hash next to the entry pointer, so a
+ * probe only dereferences an entry (to compare its name) when the hashes
+ * already match. The table doubles at 3/4 load and deletions shift later
+ * entries back, so no tombstones build up.
+ */
+
+extern void *memset(void *s, int c, size_t n);
+extern uint64_t clock_cycles(void);
+
+#define DIR_INDEX_MIN_CAPACITY  32
+
+typedef struct dir_slot {
+    uint32_t hash;
+    void *entry;                        // NULL = empty
+} dir_slot_t;
+
+struct dir_index {
+    dir_slot_t *slots;
+    uint32_t capacity;                  // Power of two
+    uint32_t count;
+};
+
+/* Per-boot seed, chosen on first use (stored hashes never outlive a boot) */
+static uint32_t name_hash_seed;
+static bool name_hash_seeded = false;
+
+/* Seeded xxHash32 of the component, straight from the path buffer */
+uint32_t fs_name_hash(const char *name, size_t len) {
+    if (!name_hash_seeded) {
+        name_hash_seed = (uint32_t)clock_cycles();
+        name_hash_seeded = true;
+    }
+    return hashmap_hash_bytes(name, len, name_hash_seed);
+}
+
+static void dir_index_place(dir_slot_t *slots, uint32_t capacity, uint32_t hash, void *entry) {
+    uint32_t mask = capacity - 1;
+    uint32_t i = hash & mask;
+    while (slots[i].entry) i = (i + 1) & mask;
+    slots[i].hash = hash;
+    slots[i].entry = entry;
+}
+
+static bool dir_index_resize(dir_index_t *index, uint32_t capacity) {
+    dir_slot_t *slots = (dir_slot_t *)kmalloc(capacity * sizeof(dir_slot_t));
+    if (!slots) return false;
+    memset(slots, 0, capacity * sizeof(dir_slot_t));
+
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        if (index->slots[i].entry) {
+            dir_index_place(slots, capacity, index->slots[i].hash, index->slots[i].entry);
+        }
+    }
+
+    if (index->slots) kfree(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    return true;
+}
+
+dir_index_t *dir_index_create(uint32_t expected) {
+    dir_index_t *index = (dir_index_t *)kmalloc(sizeof(dir_index_t));
+    if (!index) return NULL;
+
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+
+    uint32_t capacity = DIR_INDEX_MIN_CAPACITY;
+    while (capacity * 3 / 4 <= expected) capacity *= 2;
+    if (!dir_index_resize(index, capacity)) {
+        kfree(index);
+        return NULL;
+    }
+    return index;
+}
+
+void dir_index_destroy(dir_index_t *index) {
+    if (!index) return;
+    kfree(index->slots);
+    kfree(index);
+}
+
+bool dir_index_insert(dir_index_t *index, uint32_t hash, void *entry) {
+    if (!index || !entry) return false;
+    if ((index->count + 1) * 4 > index->capacity * 3 &&
+        !dir_index_resize(index, index->capacity * 2)) {
+        return false;
+    }
+    dir_index_place(index->slots, index->capacity, hash, entry);
+    index->count++;
+    return true;
+}
+
+void *dir_index_lookup(dir_index_t *index, uint32_t hash, const char *name, size_t len,
+                       bool (*match)(void *entry, const char *name, size_t len)) {
+    if (!index) return NULL;
+
+    uint32_t mask = index->capacity - 1;
+    for (uint32_t i = hash & mask; index->slots[i].entry; i = (i + 1) & mask) {
+        if (index->slots[i].hash == hash && match(index->slots[i].entry, name, len)) {
+            return index->slots[i].entry;
+        }
+    }
+    return NULL;
+}
+
+bool dir_index_remove(dir_index_t *index, uint32_t hash, void *entry) {
+    if (!index) return false;
+
+    uint32_t mask = index->capacity - 1;
+    uint32_t i = hash & mask;
+    while (index->slots[i].entry != entry) {
+        if (!index->slots[i].entry) return false;
+        i = (i + 1) & mask;
+    }
+
+    // Backward-shift: pull later members of the probe run into the hole
+    uint32_t hole = i;
+    for (uint32_t j = (i + 1) & mask; index->slots[j].entry; j = (j + 1) & mask) {
+        uint32_t home = index->slots[j].hash & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            index->slots[hole] = index->slots[j];
+            hole = j;
+        }
+    }
+    index->slots[hole].entry = NULL;
+    index->count--;
+    return true;
+}
+
+uint32_t dir_index_count(const dir_index_t *index) {
+    return index ? index->count : 0;
+}
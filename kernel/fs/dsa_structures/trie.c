@@ -9,6 +9,10 @@
  * This file adapts the generic Trie (Prefix Tree) data structure for fast file
  * indexing. It allows for efficient prefix-based searches and autocomplete-style
  * lookups for filenames within the file system.
+ *
+ * The underlying trie is an adaptive radix tree, so deep paths that share
+ * long prefixes (/var/log/...) cost a few small nodes rather than a
+ * 256-pointer node per character.
  */
 
 static trie_t file_index;
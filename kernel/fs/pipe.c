@@ -0,0 +1,497 @@
+/*
+ * ===========================================================================
+ * kernel/fs/pipe.c
+ * ===========================================================================
+ *
+ * Pipes and Splicing
+ *
+ * A pipe is a ring of PIPE_RING_SLOTS page buffers, each naming a frame
+ * plus the byte range of it still unread. write() copies into a page the
+ * pipe owns (appending to the last one while it has room); vfs_splice()
+ * can instead append a page borrowed from a filesystem's page cache by
+ * taking a frame reference, so moving a RAMFS file into a pipe copies
+ * nothing. Reading, or splicing out, drops each page's reference once its
+ * range is consumed.
+ *
+ * Splice paths:
+ *   file -> pipe     pages are lent (holes become zeroed pipe pages)
+ *   pipe -> pipe     buffers are lent on to the other pipe
+ *   pipe -> file     one copy, straight from the pipe pages
+ *   file -> file     one copy, straight from the source pages
+ *   file|pipe -> console/serial through vfs_splice_emit(), no copy
+ *
+ * A lent page is the file's live page: a write to that part of the file
+ * before the pipe is drained shows up in the pipe too.
+ *
+ * All pipe state is changed under the kernel lock. Readers and writers
+ * block on the pipe's wait queue, which is woken on every change and also
+ * serves kpoll()/epoll.
+ *
+ * ===========================================================================
+ */
+
+#include "vfs.h"
+#include "../memory/memory.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+#include "../ipc/poll.h"
+#include "../../lib/dsa/typed_ring.h"
+
+extern void *memcpy(void *dest, const void *src, size_t n);
+extern void *memset(void *s, int c, size_t n);
+
+/* ---------------------------------------------------------------------------
+ * Pipe Structures
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint8_t *page;                  /* Frame (identity mapped) */
+    uint16_t offset;                /* First unread byte */
+    uint16_t length;                /* Unread bytes */
+    bool owned;                     /* Allocated by the pipe (may be appended to) */
+} pipe_buffer_t;
+
+DEFINE_RING(pipe_ring, pipe_buffer_t, PIPE_RING_SLOTS)
+
+typedef struct {
+    pipe_ring_t ring;               /* Buffers, oldest first */
+    size_t bytes;                   /* Unread bytes in all slots */
+    uint32_t readers;               /* Open read ends */
+    uint32_t writers;               /* Open write ends */
+    wait_queue_t waiters;           /* Blocked readers/writers and pollers */
+} pipe_t;
+
+/* Sink for the splice walkers: takes up to 'length' bytes of 'page' at
+ * 'offset' (page == NULL means zeros) and returns how many it took */
+typedef size_t (*splice_actor_t)(void *ctx, uint8_t *page, size_t offset, size_t length);
+
+static const vfs_ops_t pipe_ops;
+static const uint8_t zero_chunk[64];
+
+/* ---------------------------------------------------------------------------
+ * Ring Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Appendable space in the newest buffer, if the pipe owns it */
+static size_t pipe_tail_room(pipe_t *pipe)
+{
+    pipe_buffer_t *buf = pipe_ring_back(&pipe->ring);
+    if (buf == NULL) {
+        return 0;
+    }
+    return buf->owned ? PAGE_SIZE - (buf->offset + buf->length) : 0;
+}
+
+static void pipe_push(pipe_t *pipe, uint8_t *page, size_t offset, size_t length, bool owned)
+{
+    pipe_ring_push(&pipe->ring, (pipe_buffer_t){
+        .page = page,
+        .offset = (uint16_t)offset,
+        .length = (uint16_t)length,
+        .owned = owned,
+    });
+    pipe->bytes += length;
+}
+
+/* Drop 'count' bytes from the oldest buffer, releasing it when empty */
+static void pipe_consume(pipe_t *pipe, size_t count)
+{
+    pipe_buffer_t *buf = pipe_ring_front(&pipe->ring);
+    buf->offset += (uint16_t)count;
+    buf->length -= (uint16_t)count;
+    pipe->bytes -= count;
+    if (buf->length == 0) {
+        frame_put((uintptr_t)buf->page);
+        pipe_ring_pop(&pipe->ring, NULL);
+    }
+}
+
+static void pipe_free(pipe_t *pipe)
+{
+    while (!pipe_ring_empty(&pipe->ring)) {
+        pipe_consume(pipe, pipe_ring_front(&pipe->ring)->length);
+    }
+    /* Nothing may stay linked on the queue once the pipe is gone */
+    wait_queue_hangup(&pipe->waiters);
+    kfree(pipe);
+}
+
+/* Copy 'size' bytes in, allocating pages as needed; returns bytes taken */
+static size_t pipe_fill(pipe_t *pipe, const uint8_t *data, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        size_t room = pipe_tail_room(pipe);
+        if (room == 0) {
+            if (pipe_ring_full(&pipe->ring)) {
+                break;
+            }
+            uintptr_t frame = frame_alloc();
+            if (frame == 0) {
+                break;
+            }
+            pipe_push(pipe, (uint8_t *)frame, 0, 0, true);
+            room = PAGE_SIZE;
+        }
+
+        size_t chunk = (size - done < room) ? size - done : room;
+        pipe_buffer_t *buf = pipe_ring_back(&pipe->ring);
+        if (data != NULL) {
+            memcpy(buf->page + buf->offset + buf->length, data + done, chunk);
+        } else {
+            memset(buf->page + buf->offset + buf->length, 0, chunk);
+        }
+        buf->length += (uint16_t)chunk;
+        pipe->bytes += chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+/* Sleep until data arrives or the last writer leaves; false at EOF */
+static bool pipe_wait_readable(pipe_t *pipe)
+{
+    while (pipe->bytes == 0) {
+        if (pipe->writers == 0) {
+            return false;
+        }
+        wait_queue_wait(&pipe->waiters);
+    }
+    return true;
+}
+
+/* Sleep until a slot frees up; false once nobody can read any more */
+static bool pipe_wait_writable(pipe_t *pipe)
+{
+    while (pipe_ring_full(&pipe->ring) && pipe_tail_room(pipe) == 0) {
+        if (pipe->readers == 0) {
+            return false;
+        }
+        wait_queue_wait(&pipe->waiters);
+    }
+    return pipe->readers > 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Pipe File Operations
+ * --------------------------------------------------------------------------- */
+
+static void pipe_release(vfs_file_t *file)
+{
+    pipe_t *pipe = (pipe_t *)file->node;
+
+    uint32_t flags = kernel_lock_irqsave();
+    if (file->mode & VFS_FILE_READ) {
+        pipe->readers--;
+    } else {
+        pipe->writers--;
+    }
+    wait_queue_wake_all(&pipe->waiters);
+    if (pipe->readers == 0 && pipe->writers == 0) {
+        pipe_free(pipe);
+    }
+    kernel_unlock_irqrestore(flags);
+}
+
+static ssize_t pipe_read(vfs_file_t *file, void *buffer, size_t size, size_t offset)
+{
+    UNUSED(offset);
+    pipe_t *pipe = (pipe_t *)file->node;
+    uint8_t *out = (uint8_t *)buffer;
+
+    uint32_t flags = kernel_lock_irqsave();
+    size_t done = 0;
+    if (size > 0 && pipe_wait_readable(pipe)) {
+        while (done < size && pipe->bytes > 0) {
+            pipe_buffer_t *buf = pipe_ring_front(&pipe->ring);
+            size_t chunk = (size - done < buf->length) ? size - done : buf->length;
+            memcpy(out + done, buf->page + buf->offset, chunk);
+            pipe_consume(pipe, chunk);
+            done += chunk;
+        }
+        wait_queue_wake_all(&pipe->waiters);
+    }
+    kernel_unlock_irqrestore(flags);
+
+    return (ssize_t)done;
+}
+
+/* Blocks until everything is queued; -1 (EPIPE) if no reader is left */
+static ssize_t pipe_write(vfs_file_t *file, const void *buffer, size_t size, size_t offset)
+{
+    UNUSED(offset);
+    pipe_t *pipe = (pipe_t *)file->node;
+    const uint8_t *in = (const uint8_t *)buffer;
+
+    uint32_t flags = kernel_lock_irqsave();
+    size_t done = 0;
+    while (done < size && pipe_wait_writable(pipe)) {
+        size_t chunk = pipe_fill(pipe, in + done, size - done);
+        if (chunk == 0) {
+            break;  /* Out of frames */
+        }
+        done += chunk;
+        wait_queue_wake_all(&pipe->waiters);
+    }
+    kernel_unlock_irqrestore(flags);
+
+    return (done == 0 && size > 0) ? -1 : (ssize_t)done;
+}
+
+static uint32_t pipe_poll(vfs_file_t *file, wait_queue_t **wq)
+{
+    pipe_t *pipe = (pipe_t *)file->node;
+    *wq = &pipe->waiters;
+
+    if (file->mode & VFS_FILE_READ) {
+        uint32_t mask = (pipe->bytes > 0) ? POLLIN : 0;
+        return (pipe->writers == 0) ? (mask | POLLHUP) : mask;
+    }
+    if (pipe->readers == 0) {
+        return POLLERR;
+    }
+    return (!pipe_ring_full(&pipe->ring) || pipe_tail_room(pipe) > 0) ? POLLOUT : 0;
+}
+
+static const vfs_ops_t pipe_ops = {
+    .name     = "pipe",
+    .release  = pipe_release,
+    .read     = pipe_read,
+    .write    = pipe_write,
+    .poll     = pipe_poll,
+};
+
+/* ---------------------------------------------------------------------------
+ * vfs_pipe - Create a pipe
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fds - Output: fds[0] = read end, fds[1] = write end
+ *
+ * Returns:
+ *   0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+int vfs_pipe(int fds[2])
+{
+    pipe_t *pipe = (pipe_t *)kcalloc(1, sizeof(pipe_t));
+    if (pipe == NULL) {
+        return -1;
+    }
+    pipe_ring_init(&pipe->ring);
+    wait_queue_init(&pipe->waiters);
+    pipe->readers = 1;
+    pipe->writers = 1;
+
+    int rfd = vfs_install(&pipe_ops, pipe, VFS_FILE_READ);
+    if (rfd < 0) {
+        kfree(pipe);
+        return -1;
+    }
+    int wfd = vfs_install(&pipe_ops, pipe, VFS_FILE_WRITE);
+    if (wfd < 0) {
+        pipe->writers = 0;
+        vfs_close(rfd);     /* Last end: frees the pipe */
+        return -1;
+    }
+
+    fds[0] = rfd;
+    fds[1] = wfd;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Splice Sources (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Walk a file's pages from its position, advancing it by what was taken */
+static ssize_t splice_from_file(vfs_file_t *in, size_t count, splice_actor_t actor, void *ctx)
+{
+    if (in->ops->page == NULL || in->ops->size == NULL) {
+        return -1;  /* EINVAL: no page cache to lend from */
+    }
+
+    size_t size = in->ops->size(in);
+    if (in->position >= size) {
+        return 0;
+    }
+    if (count > size - in->position) {
+        count = size - in->position;
+    }
+
+    size_t done = 0;
+    while (done < count) {
+        size_t pos = in->position + done;
+        size_t offset = pos % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > count - done) {
+            chunk = count - done;
+        }
+
+        size_t taken = actor(ctx, in->ops->page(in, pos / PAGE_SIZE), offset, chunk);
+        done += taken;
+        if (taken < chunk) {
+            break;
+        }
+    }
+
+    in->position += done;
+    return (ssize_t)done;
+}
+
+/* Walk a pipe's buffers, consuming what was taken */
+static ssize_t splice_from_pipe(pipe_t *pipe, size_t count, splice_actor_t actor, void *ctx)
+{
+    if (!pipe_wait_readable(pipe)) {
+        return 0;   /* EOF */
+    }
+
+    size_t done = 0;
+    while (done < count && pipe->bytes > 0) {
+        pipe_buffer_t *buf = pipe_ring_front(&pipe->ring);
+        size_t chunk = (count - done < buf->length) ? count - done : buf->length;
+
+        size_t taken = actor(ctx, buf->page, buf->offset, chunk);
+        if (taken == 0) {
+            break;
+        }
+        pipe_consume(pipe, taken);
+        done += taken;
+        if (taken < chunk) {
+            break;
+        }
+    }
+
+    wait_queue_wake_all(&pipe->waiters);
+    return (ssize_t)done;
+}
+
+static ssize_t splice_from(vfs_file_t *in, size_t count, splice_actor_t actor, void *ctx)
+{
+    if (in->ops == &pipe_ops) {
+        return splice_from_pipe((pipe_t *)in->node, count, actor, ctx);
+    }
+    return splice_from_file(in, count, actor, ctx);
+}
+
+/* ---------------------------------------------------------------------------
+ * Splice Sinks (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Lend the page to a pipe; holes are filled with a zeroed pipe page */
+static size_t sink_pipe(void *ctx, uint8_t *page, size_t offset, size_t length)
+{
+    pipe_t *pipe = (pipe_t *)ctx;
+    if (pipe->readers == 0) {
+        return 0;
+    }
+    if (page == NULL) {
+        return pipe_fill(pipe, NULL, length);
+    }
+    if (pipe_ring_full(&pipe->ring)) {
+        return 0;
+    }
+
+    frame_share((uintptr_t)page);
+    pipe_push(pipe, page, offset, length, false);
+    return length;
+}
+
+static size_t sink_file(void *ctx, uint8_t *page, size_t offset, size_t length)
+{
+    vfs_file_t *out = (vfs_file_t *)ctx;
+    size_t done = 0;
+
+    while (done < length) {
+        const uint8_t *data = (page != NULL) ? page + offset + done : zero_chunk;
+        size_t chunk = length - done;
+        if (page == NULL && chunk > sizeof(zero_chunk)) {
+            chunk = sizeof(zero_chunk);
+        }
+
+        ssize_t written = out->ops->write(out, data, chunk, out->position);
+        if (written <= 0) {
+            break;
+        }
+        out->position += (size_t)written;
+        done += (size_t)written;
+    }
+    return done;
+}
+
+typedef struct {
+    void (*emit)(const char *data, size_t len, void *ctx);
+    void *ctx;
+} splice_emit_t;
+
+static size_t sink_emit(void *ctx, uint8_t *page, size_t offset, size_t length)
+{
+    splice_emit_t *sink = (splice_emit_t *)ctx;
+    if (page != NULL) {
+        sink->emit((const char *)page + offset, length, sink->ctx);
+        return length;
+    }
+    for (size_t done = 0; done < length; done += sizeof(zero_chunk)) {
+        size_t chunk = (length - done < sizeof(zero_chunk)) ? length - done : sizeof(zero_chunk);
+        sink->emit((const char *)zero_chunk, chunk, sink->ctx);
+    }
+    return length;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_splice - Move data between two descriptors inside the kernel
+ * ---------------------------------------------------------------------------
+ * One side is read from its position (a pipe is drained), the other written
+ * at its position. Into a pipe, a RAMFS file's pages are lent rather than
+ * copied. Blocks like read() on an empty pipe and like write() on a full
+ * one, but only until the first bytes move.
+ *
+ * Returns:
+ *   Bytes moved (0 at end of file or of the pipe), -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t vfs_splice(int in_fd, int out_fd, size_t count)
+{
+    vfs_file_t *in = vfs_fget(in_fd, VFS_FILE_READ);
+    vfs_file_t *out = vfs_fget(out_fd, VFS_FILE_WRITE);
+    if (in == NULL || out == NULL || (in->mode & VFS_FILE_DIRECTORY) ||
+        out->ops->write == NULL || (in->ops == &pipe_ops && in->node == out->node)) {
+        return -1;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    ssize_t moved;
+    if (out->ops == &pipe_ops) {
+        pipe_t *pipe = (pipe_t *)out->node;
+        moved = pipe_wait_writable(pipe) ? splice_from(in, count, sink_pipe, pipe) : -1;
+        wait_queue_wake_all(&pipe->waiters);
+    } else {
+        moved = splice_from(in, count, sink_file, out);
+    }
+    kernel_unlock_irqrestore(flags);
+
+    return moved;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_splice_emit - Hand a descriptor's data to an output routine
+ * ---------------------------------------------------------------------------
+ * For the console and the serial port: 'emit' is called with pointers
+ * straight into the source's pages (or the pipe's), so nothing is copied
+ * before the device sees the bytes.
+ *
+ * Returns:
+ *   Bytes emitted (0 at end of file or of the pipe), -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t vfs_splice_emit(int in_fd, size_t count,
+                        void (*emit)(const char *data, size_t len, void *ctx), void *ctx)
+{
+    vfs_file_t *in = vfs_fget(in_fd, VFS_FILE_READ);
+    if (in == NULL || emit == NULL || (in->mode & VFS_FILE_DIRECTORY)) {
+        return -1;
+    }
+
+    splice_emit_t sink = { emit, ctx };
+    uint32_t flags = kernel_lock_irqsave();
+    ssize_t moved = splice_from(in, count, sink_emit, &sink);
+    kernel_unlock_irqrestore(flags);
+
+    return moved;
+}
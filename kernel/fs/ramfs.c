@@ -10,25 +10,31 @@
  *
  * - Trie: Fast path/filename lookup and indexing
  * - N-ary Tree: Directory hierarchy representation
- * - Hash Map: Open file descriptor table for O(1) lookups
+ * - Hash Map: Open file table (path -> inode) for O(1) lookups
+ * - Dentry Cache: Per-component (parent, name) lookups, including misses
+ * - Directory Index: Hashed child lookup for large directories
+ * - Page Radix Tree: File contents, mapped straight into callers by mmap
  *
  * Features:
  * - File and directory creation/deletion
  * - Read and write operations
  * - Path parsing and traversal
- * - File descriptor management
+ * - Mounted through the VFS (ramfs_ops); descriptors live in vfs.c
  * - Reference counting for safe deletion
  *
  * Memory Layout:
  * ┌─────────────────────────────────────────────────────────────────────────┐
- * │  All data resides in kernel heap (kmalloc/kfree). No disk I/O.          │
- * │  Each file's data is dynamically allocated and can grow on write.       │
+ * │  Inodes come from a slab cache, file data from the frame allocator.     │
+ * │  Each file is a radix tree of 4KB pages; pages are allocated on first   │
+ * │  write, so writes never copy existing data and holes read as zeros.     │
  * │  Directory entries link to child inodes via the tree structure.         │
  * └─────────────────────────────────────────────────────────────────────────┘
  *
  * ===========================================================================
  */
 
+#include "vfs.h"
+#include "ramfs_image.h"
 #include "dsa_structures.h"
 #include "../memory/memory.h"
 #include "../../config/os_config.h"
@@ -41,14 +47,15 @@ extern void *memcpy(void *dest, const void *src, size_t n);
 extern size_t strlen(const char *s);
 extern char *strcpy(char *dest, const char *src);
 extern int strcmp(const char *s1, const char *s2);
+extern int memcmp(const void *s1, const void *s2, size_t n);
 extern char *strncpy(char *dest, const char *src, size_t n);
 
 /* ---------------------------------------------------------------------------
  * Inode Types
  * --------------------------------------------------------------------------- */
 typedef enum {
-    INODE_TYPE_FILE = 0,        /* Regular file */
-    INODE_TYPE_DIRECTORY = 1    /* Directory */
+    INODE_TYPE_FILE = VFS_TYPE_FILE,            /* Regular file */
+    INODE_TYPE_DIRECTORY = VFS_TYPE_DIRECTORY   /* Directory */
 } inode_type_t;
 
 /* ---------------------------------------------------------------------------
@@ -60,27 +67,28 @@ typedef enum {
 typedef struct ramfs_inode {
     inode_type_t type;              /* File or directory */
     char name[MAX_FILENAME_LENGTH]; /* Entry name (filename or dirname) */
+    size_t name_len;                /* strlen(name) */
+    uint32_t name_hash;             /* fs_name_hash(name) for the parent's index */
     size_t size;                    /* Size in bytes (for files) */
-    void *data;                     /* File data pointer (for files) */
-    size_t capacity;                /* Allocated capacity (for files) */
+    uintptr_t pages;                /* Page radix tree root (for files) */
+    uint8_t page_height;            /* Radix levels above the data pages */
+    size_t page_frames;             /* Frames held: data pages + radix nodes */
     uint32_t ref_count;             /* Reference count (open file descriptors) */
     struct ramfs_inode *parent;     /* Parent directory */
     tree_node_t tree_node;          /* Embedded tree node for hierarchy */
     uint32_t inode_number;          /* Unique inode identifier */
+    uint32_t child_count;           /* Entries in this directory */
+    uint32_t dir_version;           /* Bumped on every link/unlink */
+    dir_index_t *index;             /* Name index once child_count is large */
 } ramfs_inode_t;
 
-/* ---------------------------------------------------------------------------
- * Open File Descriptor Structure
- * ---------------------------------------------------------------------------
- * Represents an open file with current read/write position.
- * --------------------------------------------------------------------------- */
-typedef struct {
-    int fd;                         /* File descriptor number */
-    ramfs_inode_t *inode;           /* Pointer to the inode */
-    size_t position;                /* Current read/write position */
-    bool read_only;                 /* Read-only flag */
-    bool valid;                     /* Is this descriptor valid? */
-} open_file_t;
+/*
+ * File pages form a radix tree whose inner nodes are themselves one frame of
+ * page addresses. Height 0 means the root is the single data page for offset
+ * 0; each extra level multiplies the reach by RAMFS_RADIX_SLOTS. A zero slot
+ * is a hole.
+ */
+#define RAMFS_RADIX_SLOTS   (PAGE_SIZE / sizeof(uintptr_t))
 
 /* ---------------------------------------------------------------------------
  * Static Variables
@@ -89,12 +97,6 @@ typedef struct {
 /* Root directory inode */
 static ramfs_inode_t *root_inode = NULL;
 
-/* File descriptor table (array-based for simplicity) */
-static open_file_t fd_table[MAX_OPEN_FILES];
-
-/* Next available file descriptor */
-static int next_fd = 3;  /* 0=stdin, 1=stdout, 2=stderr reserved */
-
 /* Next inode number */
 static uint32_t next_inode_number = 1;
 
@@ -104,6 +106,9 @@ static bool ramfs_initialized = false;
 /* Total bytes used by RAMFS */
 static size_t ramfs_total_bytes = 0;
 
+/* Object cache for inodes */
+static kmem_cache_t *inode_cache = NULL;
+
 /* ---------------------------------------------------------------------------
  * Forward Declarations
  * --------------------------------------------------------------------------- */
@@ -111,20 +116,102 @@ static ramfs_inode_t *create_inode(const char *name, inode_type_t type);
 static void destroy_inode(ramfs_inode_t *inode);
 static ramfs_inode_t *resolve_path(const char *path);
 static ramfs_inode_t *resolve_parent_path(const char *path, char *out_name);
-static int allocate_fd(void);
-static void free_fd(int fd);
-static open_file_t *get_open_file(int fd);
-static int compare_inode_name(void *a, void *b);
+static ramfs_inode_t *lookup_child(ramfs_inode_t *dir, const char *name, size_t len);
+static void link_child(ramfs_inode_t *dir, ramfs_inode_t *child);
+static void unlink_child(ramfs_inode_t *dir, ramfs_inode_t *child);
+
+/* ---------------------------------------------------------------------------
+ * Helper: Does a directory entry carry this (unterminated) name?
+ * --------------------------------------------------------------------------- */
+static bool inode_name_matches(void *entry, const char *name, size_t len)
+{
+    ramfs_inode_t *inode = (ramfs_inode_t *)entry;
+    return inode->name_len == len && memcmp(inode->name, name, len) == 0;
+}
 
 /* ---------------------------------------------------------------------------
- * Helper: Compare inode names for tree search
+ * Helper: Find a child of a directory by name
+ * ---------------------------------------------------------------------------
+ * The dentry cache answers repeated lookups, including ones for names that
+ * do not exist. On a miss, directories with an index are probed by hash and
+ * small ones are scanned; the result (found or not) is then cached.
  * --------------------------------------------------------------------------- */
-static int compare_inode_name(void *a, void *b)
+static ramfs_inode_t *lookup_child(ramfs_inode_t *dir, const char *name, size_t len)
 {
-    if (a == NULL || b == NULL) return -1;
-    ramfs_inode_t *inode_a = (ramfs_inode_t *)a;
-    const char *name_b = (const char *)b;
-    return strcmp(inode_a->name, name_b);
+    void *cached;
+    if (dcache_lookup(dir, name, len, &cached)) {
+        return (ramfs_inode_t *)cached;
+    }
+
+    ramfs_inode_t *found = NULL;
+    if (dir->index != NULL) {
+        found = (ramfs_inode_t *)dir_index_lookup(dir->index, fs_name_hash(name, len),
+                                                  name, len, inode_name_matches);
+    } else {
+        for (tree_node_t *child = dir->tree_node.first_child; child != NULL;
+             child = child->next_sibling) {
+            if (inode_name_matches(child->data, name, len)) {
+                found = (ramfs_inode_t *)child->data;
+                break;
+            }
+        }
+    }
+
+    dcache_add(dir, name, len, found);
+    return found;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Attach a child to a directory
+ * ---------------------------------------------------------------------------
+ * Keeps the tree, the directory's name index and the dentry cache in step.
+ * The index is built the first time the directory reaches the threshold.
+ * --------------------------------------------------------------------------- */
+static void link_child(ramfs_inode_t *dir, ramfs_inode_t *child)
+{
+    child->parent = dir;
+    tree_add_child(&dir->tree_node, &child->tree_node);
+    dir->child_count++;
+    dir->dir_version++;
+
+    if (dir->index != NULL) {
+        if (!dir_index_insert(dir->index, child->name_hash, child)) {
+            /* Out of memory: fall back to scanning the sibling list */
+            dir_index_destroy(dir->index);
+            dir->index = NULL;
+        }
+    } else if (dir->child_count >= RAMFS_DIR_INDEX_THRESHOLD) {
+        dir->index = dir_index_create(dir->child_count);
+        for (tree_node_t *node = dir->tree_node.first_child;
+             dir->index != NULL && node != NULL; node = node->next_sibling) {
+            ramfs_inode_t *entry = (ramfs_inode_t *)node->data;
+            if (!dir_index_insert(dir->index, entry->name_hash, entry)) {
+                dir_index_destroy(dir->index);
+                dir->index = NULL;
+            }
+        }
+    }
+
+    /* Replaces a negative entry if the name was looked up before */
+    dcache_add(dir, child->name, child->name_len, child);
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Detach a child from a directory
+ * ---------------------------------------------------------------------------
+ * Leaves a negative dentry behind, since a removed name is often probed again
+ * (e.g. by an existence check before it is recreated).
+ * --------------------------------------------------------------------------- */
+static void unlink_child(ramfs_inode_t *dir, ramfs_inode_t *child)
+{
+    tree_remove_child(&dir->tree_node, &child->tree_node);
+    dir->child_count--;
+    dir->dir_version++;
+    if (dir->index != NULL) {
+        dir_index_remove(dir->index, child->name_hash, child);
+    }
+    dcache_add(dir, child->name, child->name_len, NULL);
+    child->parent = NULL;
 }
 
 /* ---------------------------------------------------------------------------
@@ -132,7 +219,7 @@ static int compare_inode_name(void *a, void *b)
  * --------------------------------------------------------------------------- */
 static ramfs_inode_t *create_inode(const char *name, inode_type_t type)
 {
-    ramfs_inode_t *inode = (ramfs_inode_t *)kmalloc(sizeof(ramfs_inode_t));
+    ramfs_inode_t *inode = (ramfs_inode_t *)kmem_cache_alloc(inode_cache);
     if (inode == NULL) {
         return NULL;
     }
@@ -141,8 +228,9 @@ static ramfs_inode_t *create_inode(const char *name, inode_type_t type)
     
     inode->type = type;
     inode->size = 0;
-    inode->data = NULL;
-    inode->capacity = 0;
+    inode->pages = 0;
+    inode->page_height = 0;
+    inode->page_frames = 0;
     inode->ref_count = 0;
     inode->parent = NULL;
     inode->inode_number = next_inode_number++;
@@ -154,6 +242,8 @@ static ramfs_inode_t *create_inode(const char *name, inode_type_t type)
     } else {
         inode->name[0] = '\0';
     }
+    inode->name_len = strlen(inode->name);
+    inode->name_hash = fs_name_hash(inode->name, inode->name_len);
 
     /* Initialize the embedded tree node */
     tree_node_init(&inode->tree_node, inode);
@@ -162,6 +252,116 @@ static ramfs_inode_t *create_inode(const char *name, inode_type_t type)
     return inode;
 }
 
+/* ---------------------------------------------------------------------------
+ * Helper: Take a zeroed frame for file data, within the RAMFS size limit
+ * --------------------------------------------------------------------------- */
+static uintptr_t ramfs_frame_alloc(ramfs_inode_t *inode)
+{
+    if (ramfs_total_bytes + PAGE_SIZE > RAMFS_MAX_SIZE) {
+        return 0;  /* Filesystem full */
+    }
+
+    uintptr_t frame = frame_alloc();
+    if (frame == 0) {
+        return 0;
+    }
+
+    memset((void *)frame, 0, PAGE_SIZE);
+    ramfs_total_bytes += PAGE_SIZE;
+    inode->page_frames++;
+    return frame;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Free a radix subtree (level 0 = a data page)
+ * --------------------------------------------------------------------------- */
+static void ramfs_free_pages(ramfs_inode_t *inode, uintptr_t frame, uint8_t level)
+{
+    if (frame == 0) {
+        return;
+    }
+
+    if (level > 0) {
+        uintptr_t *node = (uintptr_t *)frame;
+        for (size_t i = 0; i < RAMFS_RADIX_SLOTS; i++) {
+            ramfs_free_pages(inode, node[i], level - 1);
+        }
+    }
+
+    /* A data page lent to a pipe stays alive until the pipe drops it */
+    frame_put(frame);
+    ramfs_total_bytes -= PAGE_SIZE;
+    inode->page_frames--;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Find the radix slot for a page index
+ * ---------------------------------------------------------------------------
+ * With create set, missing radix levels are allocated (the slot itself may
+ * still be a hole); otherwise a missing level returns NULL. Returns NULL on
+ * allocation failure too.
+ * --------------------------------------------------------------------------- */
+static uintptr_t *ramfs_page_slot(ramfs_inode_t *inode, size_t index, bool create)
+{
+    /* Pages reachable from a root of the current height */
+    size_t span = 1;
+    for (uint8_t level = 0; level < inode->page_height; level++) {
+        span *= RAMFS_RADIX_SLOTS;
+    }
+
+    /* Grow the tree upward until it reaches the index */
+    while (index >= span) {
+        if (!create) {
+            return NULL;
+        }
+        if (inode->pages != 0) {
+            uintptr_t node = ramfs_frame_alloc(inode);
+            if (node == 0) {
+                return NULL;
+            }
+            ((uintptr_t *)node)[0] = inode->pages;
+            inode->pages = node;
+        }
+        inode->page_height++;
+        span *= RAMFS_RADIX_SLOTS;
+    }
+
+    uintptr_t *slot = &inode->pages;
+    for (uint8_t level = inode->page_height; level > 0; level--) {
+        if (*slot == 0) {
+            if (!create) {
+                return NULL;
+            }
+            *slot = ramfs_frame_alloc(inode);
+            if (*slot == 0) {
+                return NULL;
+            }
+        }
+
+        span /= RAMFS_RADIX_SLOTS;
+        slot = &((uintptr_t *)*slot)[(index / span) % RAMFS_RADIX_SLOTS];
+    }
+    return slot;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Find the data page holding a page index
+ * ---------------------------------------------------------------------------
+ * With create set, missing radix levels and pages are allocated; otherwise a
+ * hole returns NULL. Returns NULL on allocation failure too.
+ * --------------------------------------------------------------------------- */
+static uint8_t *ramfs_page(ramfs_inode_t *inode, size_t index, bool create)
+{
+    uintptr_t *slot = ramfs_page_slot(inode, index, create);
+    if (slot == NULL) {
+        return NULL;
+    }
+    if (*slot == 0 && create) {
+        *slot = ramfs_frame_alloc(inode);
+    }
+    return (uint8_t *)*slot;
+}
+
 /* ---------------------------------------------------------------------------
  * Helper: Destroy an inode and free resources
  * --------------------------------------------------------------------------- */
@@ -177,10 +377,10 @@ static void destroy_inode(ramfs_inode_t *inode)
     }
 
     /* Free file data if it's a file */
-    if (inode->type == INODE_TYPE_FILE && inode->data != NULL) {
-        ramfs_total_bytes -= inode->capacity;
-        kfree(inode->data);
-        inode->data = NULL;
+    if (inode->type == INODE_TYPE_FILE) {
+        ramfs_free_pages(inode, inode->pages, inode->page_height);
+        inode->pages = 0;
+        inode->page_height = 0;
     }
 
     /* For directories, recursively destroy children */
@@ -190,17 +390,22 @@ static void destroy_inode(ramfs_inode_t *inode)
             tree_node_t *next = child->next_sibling;
             ramfs_inode_t *child_inode = (ramfs_inode_t *)child->data;
             /* Remove from parent first */
-            tree_remove_child(&inode->tree_node, child);
+            unlink_child(inode, child_inode);
             destroy_inode(child_inode);
             child = next;
         }
+
+        /* Cached entries are keyed by this inode's address */
+        dcache_purge_dir(inode);
+        dir_index_destroy(inode->index);
+        inode->index = NULL;
     }
 
     /* Remove from trie index */
     /* Note: Full path would be needed here - simplified for now */
 
     ramfs_total_bytes -= sizeof(ramfs_inode_t);
-    kfree(inode);
+    kmem_cache_free(inode_cache, inode);
 }
 
 /* ---------------------------------------------------------------------------
@@ -257,25 +462,16 @@ static ramfs_inode_t *resolve_parent_path(const char *path, char *out_name)
             continue;
         }
 
-        char component[MAX_FILENAME_LENGTH];
         if (len >= MAX_FILENAME_LENGTH) {
             len = MAX_FILENAME_LENGTH - 1;
         }
-        memcpy(component, start, len);
-        component[len] = '\0';
-
-        /* Find child with this name */
-        tree_node_t *child_node = tree_find_child(
-            &current->tree_node,
-            component,
-            compare_inode_name
-        );
 
-        if (child_node == NULL) {
+        /* Find child with this name, straight from the path string */
+        ramfs_inode_t *child_inode = lookup_child(current, start, len);
+        if (child_inode == NULL) {
             return NULL;  /* Path component not found */
         }
 
-        ramfs_inode_t *child_inode = (ramfs_inode_t *)child_node->data;
         if (child_inode->type != INODE_TYPE_DIRECTORY) {
             return NULL;  /* Not a directory */
         }
@@ -315,56 +511,7 @@ static ramfs_inode_t *resolve_path(const char *path)
     }
 
     /* Find the final component */
-    tree_node_t *child_node = tree_find_child(
-        &parent->tree_node,
-        name,
-        compare_inode_name
-    );
-
-    if (child_node == NULL) {
-        return NULL;
-    }
-
-    return (ramfs_inode_t *)child_node->data;
-}
-
-/* ---------------------------------------------------------------------------
- * Helper: Allocate a file descriptor
- * --------------------------------------------------------------------------- */
-static int allocate_fd(void)
-{
-    for (int i = 3; i < MAX_OPEN_FILES; i++) {
-        if (!fd_table[i].valid) {
-            return i;
-        }
-    }
-    return -1;  /* No free descriptors */
-}
-
-/* ---------------------------------------------------------------------------
- * Helper: Free a file descriptor
- * --------------------------------------------------------------------------- */
-static void free_fd(int fd)
-{
-    if (fd >= 0 && fd < MAX_OPEN_FILES) {
-        fd_table[fd].valid = false;
-        fd_table[fd].inode = NULL;
-        fd_table[fd].position = 0;
-    }
-}
-
-/* ---------------------------------------------------------------------------
- * Helper: Get open file structure by fd
- * --------------------------------------------------------------------------- */
-static open_file_t *get_open_file(int fd)
-{
-    if (fd < 0 || fd >= MAX_OPEN_FILES) {
-        return NULL;
-    }
-    if (!fd_table[fd].valid) {
-        return NULL;
-    }
-    return &fd_table[fd];
+    return lookup_child(parent, name, strlen(name));
 }
 
 /* ---------------------------------------------------------------------------
@@ -378,15 +525,21 @@ void ramfs_init(void)
         return;
     }
 
+    /* Inodes are fixed-size and numerous: give them their own cache */
+    if (inode_cache == NULL) {
+        inode_cache = kmem_cache_create("ramfs_inode", sizeof(ramfs_inode_t),
+                                        0, NULL);
+        if (inode_cache == NULL) {
+            return;  /* Fatal error - cannot initialize filesystem */
+        }
+    }
+
     /* Initialize DSA structures */
     fs_index_init();
+    dcache_init();
     fs_tree_init(NULL);
     file_table_init(MAX_OPEN_FILES);
 
-    /* Initialize file descriptor table */
-    memset(fd_table, 0, sizeof(fd_table));
-    next_fd = 3;
-
     /* Create root directory */
     root_inode = create_inode("/", INODE_TYPE_DIRECTORY);
     if (root_inode == NULL) {
@@ -442,8 +595,7 @@ int ramfs_create(const char *path, inode_type_t type)
     }
 
     /* Link to parent */
-    new_inode->parent = parent;
-    tree_add_child(&parent->tree_node, &new_inode->tree_node);
+    link_child(parent, new_inode);
 
     /* Add to trie index for fast lookup */
     fs_index_add(path, new_inode);
@@ -452,208 +604,232 @@ int ramfs_create(const char *path, inode_type_t type)
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_open - Open a file and return a file descriptor
+ * Helper: Copy file contents at an offset into a buffer
  * ---------------------------------------------------------------------------
- * Parameters:
- *   path - Absolute path to the file
- *
- * Returns:
- *   File descriptor (>= 0) on success, -1 on error
+ * Returns the number of bytes copied, 0 at or past EOF. Holes read as zeros.
  * --------------------------------------------------------------------------- */
-int ramfs_open(const char *path)
+static size_t inode_read_at(ramfs_inode_t *inode, void *buffer, size_t size, size_t pos)
 {
-    if (!ramfs_initialized || path == NULL) {
-        return -1;
+    if (pos >= inode->size) {
+        return 0;  /* EOF */
     }
 
-    /* Resolve the path to an inode */
-    ramfs_inode_t *inode = resolve_path(path);
-    if (inode == NULL) {
-        return -1;  /* File not found */
-    }
+    size_t available = inode->size - pos;
+    size_t to_read = (size < available) ? size : available;
 
-    /* Can only open files, not directories */
-    if (inode->type != INODE_TYPE_FILE) {
-        return -1;
-    }
+    /* Copy page by page */
+    size_t done = 0;
+    while (done < to_read) {
+        size_t offset = (pos + done) % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > to_read - done) {
+            chunk = to_read - done;
+        }
 
-    /* Allocate a file descriptor */
-    int fd = allocate_fd();
-    if (fd < 0) {
-        return -1;  /* No free descriptors */
+        uint8_t *page = ramfs_page(inode, (pos + done) / PAGE_SIZE, false);
+        if (page != NULL) {
+            memcpy((uint8_t *)buffer + done, page + offset, chunk);
+        } else {
+            memset((uint8_t *)buffer + done, 0, chunk);
+        }
+        done += chunk;
     }
 
-    /* Initialize the open file structure */
-    fd_table[fd].fd = fd;
-    fd_table[fd].inode = inode;
-    fd_table[fd].position = 0;
-    fd_table[fd].read_only = false;
-    fd_table[fd].valid = true;
-
-    /* Increment reference count */
-    inode->ref_count++;
-
-    /* Add to open file table (hash map) for tracking */
-    file_table_add(path, &fd_table[fd]);
-
-    return fd;
+    return to_read;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_read - Read data from an open file
+ * Helper: Copy a buffer into a file at an offset
  * ---------------------------------------------------------------------------
- * Parameters:
- *   fd     - File descriptor
- *   buffer - Buffer to read into
- *   size   - Number of bytes to read
- *
- * Returns:
- *   Number of bytes read (may be less than size), or -1 on error
+ * Returns the number of bytes stored, which is short (possibly 0) if the
+ * filesystem fills up. Extends the file size as needed.
  * --------------------------------------------------------------------------- */
-ssize_t ramfs_read(int fd, void *buffer, size_t size)
+static size_t inode_write_at(ramfs_inode_t *inode, const void *buffer, size_t size, size_t pos)
 {
-    if (!ramfs_initialized || buffer == NULL || size == 0) {
-        return -1;
-    }
-
-    open_file_t *file = get_open_file(fd);
-    if (file == NULL) {
-        return -1;  /* Invalid fd */
-    }
-
-    ramfs_inode_t *inode = file->inode;
-    if (inode == NULL || inode->type != INODE_TYPE_FILE) {
-        return -1;
-    }
+    /* Fill page by page; only untouched pages are allocated */
+    size_t done = 0;
+    while (done < size) {
+        size_t offset = (pos + done) % PAGE_SIZE;
+        size_t chunk = PAGE_SIZE - offset;
+        if (chunk > size - done) {
+            chunk = size - done;
+        }
 
-    /* Calculate how much we can read */
-    if (file->position >= inode->size) {
-        return 0;  /* EOF */
+        uint8_t *page = ramfs_page(inode, (pos + done) / PAGE_SIZE, true);
+        if (page == NULL) {
+            break;  /* Filesystem full or out of frames */
+        }
+        memcpy(page + offset, (const uint8_t *)buffer + done, chunk);
+        done += chunk;
     }
 
-    size_t available = inode->size - file->position;
-    size_t to_read = (size < available) ? size : available;
-
-    /* Copy data to buffer */
-    if (inode->data != NULL && to_read > 0) {
-        memcpy(buffer, (uint8_t *)inode->data + file->position, to_read);
+    if (pos + done > inode->size) {
+        inode->size = pos + done;
     }
 
-    /* Update position */
-    file->position += to_read;
-
-    return (ssize_t)to_read;
+    return done;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_write - Write data to an open file
- * ---------------------------------------------------------------------------
- * Parameters:
- *   fd     - File descriptor
- *   buffer - Buffer containing data to write
- *   size   - Number of bytes to write
- *
- * Returns:
- *   Number of bytes written, or -1 on error
+ * Helper: Drop the inode reference held by a mapping
  * --------------------------------------------------------------------------- */
-ssize_t ramfs_write(int fd, const void *buffer, size_t size)
+static void ramfs_mmap_release(void *owner)
 {
-    if (!ramfs_initialized || buffer == NULL) {
-        return -1;
+    ramfs_inode_t *inode = (ramfs_inode_t *)owner;
+    if (inode->ref_count > 0) {
+        inode->ref_count--;
     }
+}
 
-    if (size == 0) {
-        return 0;
-    }
+/* ===========================================================================
+ * VFS File Operations
+ * ===========================================================================
+ * The VFS owns descriptors and positions; an open file's node is the inode,
+ * which holds one reference per open file (and per mapping).
+ * =========================================================================== */
 
-    open_file_t *file = get_open_file(fd);
-    if (file == NULL) {
-        return -1;  /* Invalid fd */
+static bool ramfs_vfs_open(vfs_mount_t *mount, const char *path, vfs_file_t *file)
+{
+    UNUSED(mount);
+
+    ramfs_inode_t *inode = resolve_path(path);
+    inode_type_t wanted = (file->mode & VFS_FILE_DIRECTORY) ? INODE_TYPE_DIRECTORY
+                                                             : INODE_TYPE_FILE;
+    if (inode == NULL || inode->type != wanted) {
+        return false;  /* Not found, or the wrong kind of node */
     }
 
-    if (file->read_only) {
-        return -1;  /* Cannot write to read-only file */
+    inode->ref_count++;
+    file->node = inode;
+
+    if (inode->type == INODE_TYPE_DIRECTORY) {
+        file->dir_cursor = inode->tree_node.first_child;
+        file->dir_index = 0;
+        file->dir_version = inode->dir_version;
+        return true;
     }
 
-    ramfs_inode_t *inode = file->inode;
-    if (inode == NULL || inode->type != INODE_TYPE_FILE) {
-        return -1;
+    /* Add to open file table (hash map) for tracking */
+    file_table_add(path, inode);
+    return true;
+}
+
+static void ramfs_vfs_release(vfs_file_t *file)
+{
+    ramfs_inode_t *inode = (ramfs_inode_t *)file->node;
+    if (inode->ref_count > 0) {
+        inode->ref_count--;
     }
+}
+
+static ssize_t ramfs_vfs_read(vfs_file_t *file, void *buffer, size_t size, size_t offset)
+{
+    return (ssize_t)inode_read_at((ramfs_inode_t *)file->node, buffer, size, offset);
+}
 
-    /* Check RAMFS size limit */
-    if (ramfs_total_bytes + size > RAMFS_MAX_SIZE) {
+static ssize_t ramfs_vfs_write(vfs_file_t *file, const void *buffer, size_t size, size_t offset)
+{
+    size_t done = inode_write_at((ramfs_inode_t *)file->node, buffer, size, offset);
+    if (done == 0 && size != 0) {
         return -1;  /* Filesystem full */
     }
+    return (ssize_t)done;
+}
 
-    /* Calculate required capacity */
-    size_t required = file->position + size;
-
-    /* Expand buffer if needed */
-    if (required > inode->capacity) {
-        /* Allocate with some extra space for future writes */
-        size_t new_capacity = required + 256;
-        if (new_capacity > RAMFS_MAX_SIZE) {
-            new_capacity = required;
-        }
+static size_t ramfs_vfs_size(vfs_file_t *file)
+{
+    return ((ramfs_inode_t *)file->node)->size;
+}
 
-        void *new_data = kmalloc(new_capacity);
-        if (new_data == NULL) {
-            return -1;  /* Out of memory */
-        }
+/* Data frames are identity mapped, so the frame is the page */
+static uint8_t *ramfs_vfs_page(vfs_file_t *file, size_t index)
+{
+    return ramfs_page((ramfs_inode_t *)file->node, index, false);
+}
 
-        /* Copy existing data */
-        if (inode->data != NULL && inode->size > 0) {
-            memcpy(new_data, inode->data, inode->size);
-            ramfs_total_bytes -= inode->capacity;
-            kfree(inode->data);
-        }
+/* ---------------------------------------------------------------------------
+ * ramfs_vfs_mmap - Map a file's pages into the caller's address space
+ * ---------------------------------------------------------------------------
+ * The file's own frames are mapped, so reads and stores through the mapping
+ * touch the page cache directly and are seen by read/write. The whole range
+ * is backed before mapping (holes get zeroed pages) so both paths always
+ * share the same frames. The mapping holds an inode reference until it is
+ * unmapped, so the file cannot be unlinked under it. Stores past EOF do not
+ * change the file size.
+ *
+ * The VFS has already checked the arguments and the file's access mode.
+ *
+ * Returns:
+ *   Start address of the mapping, or NULL on error
+ * --------------------------------------------------------------------------- */
+static void *ramfs_vfs_mmap(vfs_file_t *file, size_t length, int prot, int flags, size_t offset)
+{
+    UNUSED(flags);
 
-        inode->data = new_data;
-        ramfs_total_bytes += new_capacity;
-        inode->capacity = new_capacity;
+    address_space_t *as = address_space_current(true);
+    if (as == NULL) {
+        return NULL;  /* Paging is off or out of memory */
     }
 
-    /* Write data */
-    memcpy((uint8_t *)inode->data + file->position, buffer, size);
+    ramfs_inode_t *inode = (ramfs_inode_t *)file->node;
+    uintptr_t start = vm_area_reserve(as, length, ramfs_mmap_release, inode);
+    if (start == 0) {
+        return NULL;
+    }
+    inode->ref_count++;
 
-    /* Update position and size */
-    file->position += size;
-    if (file->position > inode->size) {
-        inode->size = file->position;
+    size_t pages = ALIGN_UP(length, PAGE_SIZE) / PAGE_SIZE;
+    uint32_t pte_flags = PAGE_USER | ((prot & PROT_WRITE) ? PAGE_WRITABLE : 0);
+    for (size_t i = 0; i < pages; i++) {
+        uint8_t *page = ramfs_page(inode, offset / PAGE_SIZE + i, true);
+        if (page == NULL ||
+            !paging_map(as, start + i * PAGE_SIZE, (uintptr_t)page, pte_flags)) {
+            vm_area_release(as, start, 0);  /* Also drops the reference */
+            return NULL;
+        }
     }
 
-    return (ssize_t)size;
+    return (void *)start;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_close - Close an open file descriptor
+ * ramfs_vfs_getdents - Fill dirent records from a directory's child list
  * ---------------------------------------------------------------------------
- * Parameters:
- *   fd - File descriptor to close
- *
- * Returns:
- *   0 on success, -1 on error
+ * The file remembers the sibling it stopped at, so reading a directory
+ * batch by batch is linear overall. The cursor is only trusted while the
+ * directory is unchanged and the caller continues where it left off;
+ * otherwise (an entry was added or removed, or the descriptor was seeked)
+ * the list is walked from the start to entry 'index'.
  * --------------------------------------------------------------------------- */
-int ramfs_close(int fd)
+static ssize_t ramfs_vfs_getdents(vfs_file_t *file, vfs_dirent_t *entries, size_t count,
+                                  size_t index)
 {
-    if (!ramfs_initialized) {
-        return -1;
-    }
+    ramfs_inode_t *dir = (ramfs_inode_t *)file->node;
 
-    open_file_t *file = get_open_file(fd);
-    if (file == NULL) {
-        return -1;  /* Invalid fd */
+    tree_node_t *node;
+    if (file->dir_version == dir->dir_version && file->dir_index == index) {
+        node = (tree_node_t *)file->dir_cursor;
+    } else {
+        node = dir->tree_node.first_child;
+        for (size_t i = 0; i < index && node != NULL; i++) {
+            node = node->next_sibling;
+        }
     }
 
-    /* Decrement reference count on inode */
-    if (file->inode != NULL && file->inode->ref_count > 0) {
-        file->inode->ref_count--;
+    size_t done = 0;
+    for (; node != NULL && done < count; node = node->next_sibling, done++) {
+        ramfs_inode_t *child = (ramfs_inode_t *)node->data;
+        vfs_dirent_t *entry = &entries[done];
+        entry->inode = child->inode_number;
+        entry->type = (uint16_t)child->type;
+        entry->name_len = (uint16_t)child->name_len;
+        memcpy(entry->name, child->name, child->name_len + 1);
     }
 
-    /* Free the file descriptor */
-    free_fd(fd);
-
-    return 0;
+    file->dir_cursor = node;
+    file->dir_index = index + done;
+    file->dir_version = dir->dir_version;
+    return (ssize_t)done;
 }
 
 /* ---------------------------------------------------------------------------
@@ -695,11 +871,12 @@ int ramfs_unlink(const char *path)
 
     /* Remove from parent's children */
     if (inode->parent != NULL) {
-        tree_remove_child(&inode->parent->tree_node, &inode->tree_node);
+        unlink_child(inode->parent, inode);
     }
 
-    /* Remove from trie index */
+    /* Remove from trie index and the open file table */
     fs_index_remove(path);
+    file_table_remove(path);
 
     /* Destroy the inode */
     destroy_inode(inode);
@@ -724,141 +901,456 @@ int ramfs_touch(const char *path)
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_seek - Set the file position for an open file
+ * ramfs_stat - Get file/directory information
  * ---------------------------------------------------------------------------
  * Parameters:
- *   fd       - File descriptor
- *   offset   - Offset from origin
- *   whence   - SEEK_SET (0), SEEK_CUR (1), or SEEK_END (2)
+ *   path - Path to the file/directory
+ *   size - Output: size of the file (0 for directories)
+ *   type - Output: type (INODE_TYPE_FILE or INODE_TYPE_DIRECTORY)
  *
  * Returns:
- *   New position on success, -1 on error
+ *   0 on success, -1 on error
  * --------------------------------------------------------------------------- */
-#define RAMFS_SEEK_SET  0
-#define RAMFS_SEEK_CUR  1
-#define RAMFS_SEEK_END  2
-
-ssize_t ramfs_seek(int fd, ssize_t offset, int whence)
+int ramfs_stat(const char *path, size_t *size, inode_type_t *type)
 {
-    open_file_t *file = get_open_file(fd);
-    if (file == NULL) {
+    if (!ramfs_initialized || path == NULL) {
         return -1;
     }
 
-    ramfs_inode_t *inode = file->inode;
+    ramfs_inode_t *inode = resolve_path(path);
     if (inode == NULL) {
         return -1;
     }
 
-    ssize_t new_position;
-    switch (whence) {
-        case RAMFS_SEEK_SET:
-            new_position = offset;
-            break;
-        case RAMFS_SEEK_CUR:
-            new_position = (ssize_t)file->position + offset;
-            break;
-        case RAMFS_SEEK_END:
-            new_position = (ssize_t)inode->size + offset;
-            break;
-        default:
-            return -1;
+    if (size != NULL) {
+        *size = inode->size;
+    }
+    if (type != NULL) {
+        *type = inode->type;
     }
 
-    if (new_position < 0) {
-        return -1;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * ramfs_get_total_bytes - Get total bytes used by RAMFS
+ * --------------------------------------------------------------------------- */
+size_t ramfs_get_total_bytes(void)
+{
+    return ramfs_total_bytes;
+}
+
+/* ---------------------------------------------------------------------------
+ * ramfs_is_initialized - Check if RAMFS is initialized
+ * --------------------------------------------------------------------------- */
+bool ramfs_is_initialized(void)
+{
+    return ramfs_initialized;
+}
+
+/* ---------------------------------------------------------------------------
+ * Snapshot Images (format in ramfs_image.h)
+ * --------------------------------------------------------------------------- */
+
+#define IMAGE_PAGES(bytes)  (((bytes) + PAGE_SIZE - 1) / PAGE_SIZE)
+
+/* Totals for an image of the current tree */
+typedef struct {
+    size_t inodes;
+    size_t name_bytes;
+    size_t data_pages;
+} image_counts_t;
+
+/* Output cursor while saving */
+typedef struct {
+    ramfs_image_inode_t *entries;
+    char *names;
+    uint8_t *data;
+    uint32_t next_entry;
+    uint32_t next_name;
+    uint32_t next_page;
+} image_writer_t;
+
+static void image_count(ramfs_inode_t *inode, image_counts_t *counts)
+{
+    counts->inodes++;
+    if (inode != root_inode) {
+        counts->name_bytes += inode->name_len;
+    }
+    if (inode->type == INODE_TYPE_FILE) {
+        counts->data_pages += IMAGE_PAGES(inode->size);
     }
 
-    file->position = (size_t)new_position;
-    return new_position;
+    for (tree_node_t *child = inode->tree_node.first_child; child != NULL;
+         child = child->next_sibling) {
+        image_count((ramfs_inode_t *)child->data, counts);
+    }
+}
+
+static size_t image_data_offset(const image_counts_t *counts)
+{
+    size_t header = sizeof(ramfs_image_header_t) +
+                    counts->inodes * sizeof(ramfs_image_inode_t) + counts->name_bytes;
+    return IMAGE_PAGES(header) * PAGE_SIZE;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_stat - Get file/directory information
+ * Helper: Write one entry, then its children in name order (depth-first)
  * ---------------------------------------------------------------------------
- * Parameters:
- *   path - Path to the file/directory
- *   size - Output: size of the file (0 for directories)
- *   type - Output: type (INODE_TYPE_FILE or INODE_TYPE_DIRECTORY)
- *
- * Returns:
- *   0 on success, -1 on error
+ * Returns false if the sort buffer could not be allocated.
  * --------------------------------------------------------------------------- */
-int ramfs_stat(const char *path, size_t *size, inode_type_t *type)
+static bool image_emit(ramfs_inode_t *inode, uint32_t parent, image_writer_t *out)
 {
-    if (!ramfs_initialized || path == NULL) {
-        return -1;
+    uint32_t index = out->next_entry++;
+    ramfs_image_inode_t *entry = &out->entries[index];
+    size_t name_len = (inode == root_inode) ? 0 : inode->name_len;
+
+    entry->parent = parent;
+    entry->type = inode->type;
+    entry->name_offset = out->next_name;
+    entry->name_len = name_len;
+    entry->size = (inode->type == INODE_TYPE_FILE) ? inode->size : 0;
+    entry->data_page = out->next_page;
+    memcpy(out->names + out->next_name, inode->name, name_len);
+    out->next_name += name_len;
+
+    if (inode->type == INODE_TYPE_FILE) {
+        /* Holes and the tail of the last page are written as zeros */
+        for (size_t page = 0; page < IMAGE_PAGES(inode->size); page++) {
+            uint8_t *dest = out->data + (size_t)out->next_page++ * PAGE_SIZE;
+            uint8_t *src = ramfs_page(inode, page, false);
+            size_t valid = inode->size - page * PAGE_SIZE;
+            if (valid > PAGE_SIZE) {
+                valid = PAGE_SIZE;
+            }
+            if (src != NULL) {
+                memcpy(dest, src, valid);
+            } else {
+                valid = 0;
+            }
+            memset(dest + valid, 0, PAGE_SIZE - valid);
+        }
+        return true;
     }
 
-    ramfs_inode_t *inode = resolve_path(path);
-    if (inode == NULL) {
-        return -1;
+    if (inode->child_count == 0) {
+        return true;
     }
 
-    if (size != NULL) {
-        *size = inode->size;
+    /* Insertion-sort the children by name */
+    ramfs_inode_t **sorted = (ramfs_inode_t **)kmalloc(inode->child_count * sizeof(ramfs_inode_t *));
+    if (sorted == NULL) {
+        return false;
     }
-    if (type != NULL) {
-        *type = inode->type;
+    size_t count = 0;
+    for (tree_node_t *child = inode->tree_node.first_child; child != NULL;
+         child = child->next_sibling) {
+        ramfs_inode_t *entry_inode = (ramfs_inode_t *)child->data;
+        size_t pos = count++;
+        while (pos > 0 && strcmp(sorted[pos - 1]->name, entry_inode->name) > 0) {
+            sorted[pos] = sorted[pos - 1];
+            pos--;
+        }
+        sorted[pos] = entry_inode;
     }
 
-    return 0;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = image_emit(sorted[i], index, out);
+    }
+    kfree(sorted);
+    return ok;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_list_dir - List directory contents
+ * Helper: Build "/a/b/name" for an image entry (parents are already valid)
  * ---------------------------------------------------------------------------
- * Parameters:
- *   path       - Path to the directory
- *   names      - Output array of name pointers (user provides buffer)
- *   max_entries - Maximum entries to return
- *
- * Returns:
- *   Number of entries found, or -1 on error
+ * Returns a kmalloc'd string, or NULL if out of memory.
  * --------------------------------------------------------------------------- */
-int ramfs_list_dir(const char *path, char **names, size_t max_entries)
+static char *image_entry_path(const ramfs_image_inode_t *entries, const char *names,
+                              uint32_t index)
+{
+    size_t len = 0;
+    for (uint32_t i = index; i != 0; i = entries[i].parent) {
+        len += 1 + entries[i].name_len;
+    }
+
+    char *path = (char *)kmalloc(len + 1);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    path[len] = '\0';
+    for (uint32_t i = index; i != 0; i = entries[i].parent) {
+        len -= entries[i].name_len;
+        memcpy(path + len, names + entries[i].name_offset, entries[i].name_len);
+        path[--len] = '/';
+    }
+    return path;
+}
+
+/* Is an entry (other than the root) well-formed given the entries before it? */
+static bool image_entry_valid(const ramfs_image_header_t *header,
+                              const ramfs_image_inode_t *entries, const char *names,
+                              uint32_t index)
 {
-    if (!ramfs_initialized || path == NULL || names == NULL) {
+    const ramfs_image_inode_t *entry = &entries[index];
+
+    if (entry->parent >= index || entries[entry->parent].type != INODE_TYPE_DIRECTORY) {
+        return false;
+    }
+    if (entry->type != INODE_TYPE_FILE && entry->type != INODE_TYPE_DIRECTORY) {
+        return false;
+    }
+    if (entry->name_len == 0 || entry->name_len >= MAX_FILENAME_LENGTH ||
+        entry->name_offset > header->names_size ||
+        entry->name_len > header->names_size - entry->name_offset) {
+        return false;
+    }
+    for (uint32_t i = 0; i < entry->name_len; i++) {
+        char c = names[entry->name_offset + i];
+        if (c == '/' || c == '\0') {
+            return false;
+        }
+    }
+
+    if (entry->type == INODE_TYPE_FILE) {
+        size_t data_pages = (header->image_size - header->data_offset) / PAGE_SIZE;
+        if (entry->data_page > data_pages ||
+            IMAGE_PAGES(entry->size) > data_pages - entry->data_page) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Point a new file's page tree at its pages inside the image
+ * ---------------------------------------------------------------------------
+ * Only radix nodes are allocated. Returns false when the tree cannot grow or
+ * the pages would exceed RAMFS_MAX_SIZE; the file keeps what was attached.
+ * --------------------------------------------------------------------------- */
+static bool image_adopt_pages(ramfs_inode_t *inode, uint8_t *data, size_t size)
+{
+    size_t pages = IMAGE_PAGES(size);
+
+    for (size_t page = 0; page < pages; page++) {
+        uintptr_t *slot = ramfs_page_slot(inode, page, true);
+        if (slot == NULL || ramfs_total_bytes + PAGE_SIZE > RAMFS_MAX_SIZE) {
+            inode->size = page * PAGE_SIZE;
+            return false;
+        }
+        *slot = (uintptr_t)(data + page * PAGE_SIZE);
+        ramfs_total_bytes += PAGE_SIZE;
+        inode->page_frames++;
+    }
+
+    /* Bytes past EOF must read back as zeros if the file grows */
+    if (size % PAGE_SIZE != 0) {
+        memset(data + size, 0, PAGE_SIZE - size % PAGE_SIZE);
+    }
+    inode->size = size;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * ramfs_image_load - Adopt a snapshot image into the tree
+ * --------------------------------------------------------------------------- */
+int ramfs_image_load(void *image, size_t size)
+{
+    if (!ramfs_initialized || image == NULL || (uintptr_t)image % PAGE_SIZE != 0 ||
+        size < sizeof(ramfs_image_header_t)) {
         return -1;
     }
 
-    ramfs_inode_t *inode = resolve_path(path);
-    if (inode == NULL) {
+    /* Every offset is checked here so the loop below can trust them */
+    const ramfs_image_header_t *header = (const ramfs_image_header_t *)image;
+    if (header->magic != RAMFS_IMAGE_MAGIC || header->version != RAMFS_IMAGE_VERSION ||
+        header->image_size > size || header->image_size % PAGE_SIZE != 0 ||
+        header->data_offset % PAGE_SIZE != 0 || header->data_offset > header->image_size ||
+        header->inode_count == 0 ||
+        header->inode_count > (header->image_size - sizeof(ramfs_image_header_t)) /
+                              sizeof(ramfs_image_inode_t) ||
+        header->names_offset < sizeof(ramfs_image_header_t) +
+                               header->inode_count * sizeof(ramfs_image_inode_t) ||
+        header->names_offset > header->data_offset ||
+        header->names_size > header->data_offset - header->names_offset) {
         return -1;
     }
 
-    if (inode->type != INODE_TYPE_DIRECTORY) {
-        return -1;  /* Not a directory */
+    const ramfs_image_inode_t *entries = (const ramfs_image_inode_t *)(header + 1);
+    const char *names = (const char *)image + header->names_offset;
+    uint8_t *data = (uint8_t *)image + header->data_offset;
+
+    if (entries[0].type != INODE_TYPE_DIRECTORY) {
+        return -1;
     }
 
-    /* Iterate through children */
-    size_t count = 0;
-    tree_node_t *child = inode->tree_node.first_child;
-    
-    while (child != NULL && count < max_entries) {
-        ramfs_inode_t *child_inode = (ramfs_inode_t *)child->data;
-        if (child_inode != NULL) {
-            names[count] = child_inode->name;
-            count++;
+    /* Inode for each entry, so children can find their parent */
+    ramfs_inode_t **inodes = (ramfs_inode_t **)kmalloc(header->inode_count * sizeof(ramfs_inode_t *));
+    if (inodes == NULL) {
+        return -1;
+    }
+    inodes[0] = root_inode;
+
+    int added = 0;
+    for (uint32_t i = 1; i < header->inode_count; i++) {
+        const ramfs_image_inode_t *entry = &entries[i];
+        if (!image_entry_valid(header, entries, names, i)) {
+            added = -1;
+            break;
+        }
+
+        ramfs_inode_t *parent = inodes[entry->parent];
+        const char *name = names + entry->name_offset;
+        ramfs_inode_t *existing = lookup_child(parent, name, entry->name_len);
+        if (existing != NULL) {
+            if (existing->type != INODE_TYPE_DIRECTORY || entry->type != INODE_TYPE_DIRECTORY) {
+                added = -1;
+                break;
+            }
+            inodes[i] = existing;      /* Merge into the existing directory */
+            continue;
+        }
+
+        char name_buf[MAX_FILENAME_LENGTH];
+        memcpy(name_buf, name, entry->name_len);
+        name_buf[entry->name_len] = '\0';
+
+        char *path = image_entry_path(entries, names, i);
+        ramfs_inode_t *inode = (path != NULL) ? create_inode(name_buf, entry->type) : NULL;
+        if (inode == NULL) {
+            kfree(path);
+            added = -1;
+            break;
+        }
+        link_child(parent, inode);
+        fs_index_add(path, inode);
+        kfree(path);
+        inodes[i] = inode;
+        added++;
+
+        if (entry->type == INODE_TYPE_FILE &&
+            !image_adopt_pages(inode, data + (size_t)entry->data_page * PAGE_SIZE, entry->size)) {
+            added = -1;
+            break;
         }
-        child = child->next_sibling;
     }
 
-    return (int)count;
+    kfree(inodes);
+    return added;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_get_total_bytes - Get total bytes used by RAMFS
+ * ramfs_image_size - Bytes needed to serialize the current tree
  * --------------------------------------------------------------------------- */
-size_t ramfs_get_total_bytes(void)
+size_t ramfs_image_size(void)
 {
-    return ramfs_total_bytes;
+    if (!ramfs_initialized) {
+        return 0;
+    }
+
+    image_counts_t counts = {0, 0, 0};
+    image_count(root_inode, &counts);
+    return image_data_offset(&counts) + counts.data_pages * PAGE_SIZE;
 }
 
 /* ---------------------------------------------------------------------------
- * ramfs_is_initialized - Check if RAMFS is initialized
+ * ramfs_image_save - Serialize the current tree
  * --------------------------------------------------------------------------- */
-bool ramfs_is_initialized(void)
+ssize_t ramfs_image_save(void *buffer, size_t size)
+{
+    if (!ramfs_initialized || buffer == NULL) {
+        return -1;
+    }
+
+    image_counts_t counts = {0, 0, 0};
+    image_count(root_inode, &counts);
+    size_t data_offset = image_data_offset(&counts);
+    size_t image_size = data_offset + counts.data_pages * PAGE_SIZE;
+    if (size < image_size) {
+        return -1;
+    }
+
+    ramfs_image_header_t *header = (ramfs_image_header_t *)buffer;
+    header->magic = RAMFS_IMAGE_MAGIC;
+    header->version = RAMFS_IMAGE_VERSION;
+    header->inode_count = counts.inodes;
+    header->names_offset = sizeof(ramfs_image_header_t) +
+                           counts.inodes * sizeof(ramfs_image_inode_t);
+    header->names_size = counts.name_bytes;
+    header->data_offset = data_offset;
+    header->image_size = image_size;
+
+    image_writer_t out;
+    out.entries = (ramfs_image_inode_t *)(header + 1);
+    out.names = (char *)buffer + header->names_offset;
+    out.data = (uint8_t *)buffer + data_offset;
+    out.next_entry = 0;
+    out.next_name = 0;
+    out.next_page = 0;
+
+    /* Zero the padding before the first data page */
+    size_t names_end = header->names_offset + counts.name_bytes;
+    memset((uint8_t *)buffer + names_end, 0, data_offset - names_end);
+
+    if (!image_emit(root_inode, 0, &out)) {
+        return -1;
+    }
+    return (ssize_t)image_size;
+}
+
+/* ---------------------------------------------------------------------------
+ * VFS Namespace Operations (paths are relative to the mount, i.e. absolute
+ * within RAMFS)
+ * --------------------------------------------------------------------------- */
+
+static bool ramfs_vfs_mount(vfs_mount_t *mount)
 {
+    ramfs_init();
+    mount->fs_data = root_inode;
     return ramfs_initialized;
 }
+
+static int ramfs_vfs_create(vfs_mount_t *mount, const char *path, int type)
+{
+    UNUSED(mount);
+    return ramfs_create(path, (inode_type_t)type);
+}
+
+static int ramfs_vfs_unlink(vfs_mount_t *mount, const char *path)
+{
+    UNUSED(mount);
+    return ramfs_unlink(path);
+}
+
+static int ramfs_vfs_stat(vfs_mount_t *mount, const char *path, size_t *size, int *type)
+{
+    UNUSED(mount);
+    inode_type_t inode_type;
+    int result = ramfs_stat(path, size, &inode_type);
+    if (result == 0 && type != NULL) {
+        *type = (int)inode_type;
+    }
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * RAMFS operations table (mounted at "/" by vfs_init)
+ * --------------------------------------------------------------------------- */
+const vfs_ops_t ramfs_ops = {
+    .name     = "ramfs",
+    .mount    = ramfs_vfs_mount,
+    .unmount  = NULL,
+    .create   = ramfs_vfs_create,
+    .unlink   = ramfs_vfs_unlink,
+    .stat     = ramfs_vfs_stat,
+    .open     = ramfs_vfs_open,
+    .release  = ramfs_vfs_release,
+    .read     = ramfs_vfs_read,
+    .write    = ramfs_vfs_write,
+    .size     = ramfs_vfs_size,
+    .page     = ramfs_vfs_page,
+    .mmap     = ramfs_vfs_mmap,
+    .getdents = ramfs_vfs_getdents,
+};
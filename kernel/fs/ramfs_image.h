@@ -0,0 +1,81 @@
+/*
+ * ===========================================================================
+ * kernel/fs/ramfs_image.h
+ * ===========================================================================
+ *
+ * RAMFS Snapshot Image Format
+ *
+ * A serialized RAMFS tree that the kernel can adopt without copying file
+ * data: each file's contents are whole pages inside the image, and loading
+ * points the file's page tree straight at them. Images normally arrive as
+ * a multiboot module (the kernel asks GRUB for page-aligned modules).
+ *
+ * Layout (all offsets from the start of the image):
+ * ┌───────────────────────────────────────────────────────────────────────┐
+ * │ ramfs_image_header_t                                                  │
+ * │ ramfs_image_inode_t[inode_count]   depth-first, siblings sorted       │
+ * │ name table (names_size bytes)      names, unterminated, table order   │
+ * │ --- padding to a page boundary --- data_offset                        │
+ * │ file data, one page-aligned run per file, tails zero-filled           │
+ * └───────────────────────────────────────────────────────────────────────┘
+ *
+ * Entry 0 is the root directory (empty name). Every other entry's parent
+ * comes before it, so a loader only needs one pass.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_RAMFS_IMAGE_H
+#define NEXA_RAMFS_IMAGE_H
+
+#include "../../config/os_config.h"
+
+#define RAMFS_IMAGE_MAGIC       0x5346584Eu     /* "NXFS" little-endian */
+#define RAMFS_IMAGE_VERSION     1
+
+typedef struct ramfs_image_header {
+    uint32_t magic;                 /* RAMFS_IMAGE_MAGIC */
+    uint32_t version;               /* RAMFS_IMAGE_VERSION */
+    uint32_t inode_count;           /* Entries, including the root */
+    uint32_t names_offset;          /* Name table */
+    uint32_t names_size;
+    uint32_t data_offset;           /* First data page (page-aligned) */
+    uint32_t image_size;            /* Whole image (page multiple) */
+} ramfs_image_header_t;
+
+typedef struct ramfs_image_inode {
+    uint32_t parent;                /* Entry index of the parent directory */
+    uint32_t type;                  /* VFS_TYPE_FILE / VFS_TYPE_DIRECTORY */
+    uint32_t name_offset;           /* Into the name table */
+    uint32_t name_len;
+    uint32_t size;                  /* File size in bytes */
+    uint32_t data_page;             /* First page, counted from data_offset */
+} ramfs_image_inode_t;
+
+/**
+ * @brief Adopt an image into the mounted RAMFS tree
+ *
+ * The image must be page-aligned and stay resident: file pages become the
+ * files' pages (and go back to the frame allocator when the files are
+ * deleted). Directories that already exist are merged; an existing file
+ * with the same path is an error. Adopted pages count toward RAMFS_MAX_SIZE.
+ *
+ * @return Number of entries added, or -1 if the image is invalid or loading
+ *         stopped part way (entries added so far are kept)
+ */
+int ramfs_image_load(void *image, size_t size);
+
+/**
+ * @brief Bytes needed to serialize the current tree
+ */
+size_t ramfs_image_size(void);
+
+/**
+ * @brief Serialize the current tree into a buffer
+ *
+ * @param buffer Buffer of at least ramfs_image_size() bytes
+ * @return Bytes written, or -1 if the buffer is too small
+ */
+ssize_t ramfs_image_save(void *buffer, size_t size);
+
+#endif /* NEXA_RAMFS_IMAGE_H */
@@ -6,11 +6,24 @@
  * Virtual File System (VFS) Layer
  *
  * This file implements the VFS abstraction layer, which provides a unified
- * interface for accessing different file systems. It handles mounting, file
- * descriptor management, and routing calls to the appropriate filesystem driver.
+ * interface for accessing different file systems. It keeps the mount table
+ * and the descriptor tables, and routes each call to the filesystem through
+ * its vfs_ops_t.
+ *
+ * Path resolution picks the mount with the longest prefix that ends on a
+ * component boundary ("/mnt" matches "/mnt" and "/mnt/x", not "/mntx"); the
+ * filesystem sees the rest of the path. File operations skip resolution:
+ * the descriptor leads to a vfs_file_t, which already holds the ops table.
+ *
+ * Descriptors are per task. Each task's table is created on its first open
+ * and maps descriptor numbers to shared, reference-counted vfs_file_t
+ * objects. A two-level bitmap (lib/dsa/bitmap.c with a summary level) finds
+ * the lowest free descriptor with a couple of BSFs, and the table doubles
+ * when it fills, up to VFS_FD_TABLE_MAX. Code running outside any task
+ * (boot) uses a kernel table.
  *
  * Currently supports:
- * - RAMFS (in-memory filesystem) as the root filesystem
+ * - RAMFS (in-memory filesystem), mounted at "/" by vfs_init()
  *
  * Future support planned for:
  * - Block device filesystems (ext2, FAT)
@@ -20,45 +33,180 @@
  * ===========================================================================
  */
 
-#include "dsa_structures.h"
+#include "vfs.h"
 #include "../memory/memory.h"
+#include "../scheduler/task.h"
+#include <lib/dsa/bitmap.h>
 #include "../../config/os_config.h"
+#include "../ipc/poll.h"
+
+extern size_t strlen(const char *s);
+extern int memcmp(const void *s1, const void *s2, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/* Descriptors 0-2 are the console (handled by the syscall layer) */
+#define VFS_FIRST_FD    3
 
 /* ---------------------------------------------------------------------------
- * External RAMFS Functions
+ * VFS State
  * --------------------------------------------------------------------------- */
+static bool vfs_initialized = false;
+static vfs_mount_t mounts[VFS_MAX_MOUNTS];
+static kmem_cache_t *file_cache = NULL;
+static vfs_fd_table_t *kernel_fd_table = NULL;
+static vfs_mount_t anon_mount;          /* Owner of files without a path */
 
-/* Inode types - must match ramfs.c definitions */
-typedef enum {
-    VFS_TYPE_FILE = 0,
-    VFS_TYPE_DIRECTORY = 1
-} vfs_node_type_t;
+/* A task's descriptor table */
+struct vfs_fd_table {
+    vfs_file_t **files;             /* Indexed by fd - VFS_FIRST_FD */
+    bitmap_t used;                  /* Set = descriptor allocated */
+    void *bits;                     /* Storage for 'used' */
+    void *summary;                  /* Storage for its summary level */
+    size_t capacity;                /* Descriptors before the next grow */
+    size_t open;
+};
 
-/* External RAMFS function declarations */
-extern void ramfs_init(void);
-extern int ramfs_create(const char *path, int type);
-extern int ramfs_open(const char *path);
-extern ssize_t ramfs_read(int fd, void *buffer, size_t size);
-extern ssize_t ramfs_write(int fd, const void *buffer, size_t size);
-extern int ramfs_close(int fd);
-extern int ramfs_unlink(const char *path);
-extern int ramfs_mkdir(const char *path);
-extern int ramfs_touch(const char *path);
-extern ssize_t ramfs_seek(int fd, ssize_t offset, int whence);
-extern int ramfs_stat(const char *path, size_t *size, int *type);
-extern int ramfs_list_dir(const char *path, char **names, size_t max_entries);
-extern size_t ramfs_get_total_bytes(void);
-extern bool ramfs_is_initialized(void);
+/* ---------------------------------------------------------------------------
+ * Mount Table
+ * --------------------------------------------------------------------------- */
+
+/* Length of a mount path once any trailing '/' is dropped ("/" stays "/") */
+static size_t mount_path_length(const char *path)
+{
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    return len;
+}
 
 /* ---------------------------------------------------------------------------
- * VFS State
+ * vfs_resolve - Find the mount responsible for a path
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   path     - Absolute path
+ *   out_rel  - Output: path within the mount (points into 'path', or "/")
+ *
+ * Returns:
+ *   Mount with the longest matching prefix, or NULL
  * --------------------------------------------------------------------------- */
-static bool vfs_initialized = false;
+static vfs_mount_t *vfs_resolve(const char *path, const char **out_rel)
+{
+    if (path == NULL || path[0] != '/') {
+        return NULL;
+    }
+
+    vfs_mount_t *best = NULL;
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t *mount = &mounts[i];
+        if (!mount->in_use) {
+            continue;
+        }
+        if (best != NULL && mount->path_len <= best->path_len) {
+            continue;
+        }
+
+        if (mount->path_len == 1) {
+            best = mount;       /* "/" matches everything */
+        } else if (memcmp(path, mount->path, mount->path_len) == 0 &&
+                   (path[mount->path_len] == '\0' || path[mount->path_len] == '/')) {
+            best = mount;
+        }
+    }
+
+    if (best != NULL) {
+        const char *rel = (best->path_len == 1) ? path : path + best->path_len;
+        *out_rel = (rel[0] == '\0') ? "/" : rel;
+    }
+    return best;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_mount - Mount a filesystem at a path
+ * ---------------------------------------------------------------------------
+ * The mount point itself is not checked against the parent filesystem;
+ * once mounted, it shadows whatever the parent has under that path.
+ *
+ * Returns:
+ *   0 on success, -1 on error (bad path, already mounted, table full,
+ *   or the filesystem's mount op failed)
+ * --------------------------------------------------------------------------- */
+int vfs_mount(const char *path, const vfs_ops_t *ops)
+{
+    if (path == NULL || path[0] != '/' || ops == NULL) {
+        return -1;
+    }
+
+    size_t len = mount_path_length(path);
+    if (len >= VFS_MOUNT_PATH_MAX) {
+        return -1;
+    }
+
+    vfs_mount_t *slot = NULL;
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (!mounts[i].in_use) {
+            if (slot == NULL) {
+                slot = &mounts[i];
+            }
+        } else if (mounts[i].path_len == len && memcmp(mounts[i].path, path, len) == 0) {
+            return -1;  /* Already mounted */
+        }
+    }
+    if (slot == NULL) {
+        return -1;
+    }
+
+    memcpy(slot->path, path, len);
+    slot->path[len] = '\0';
+    slot->path_len = len;
+    slot->ops = ops;
+    slot->fs_data = NULL;
+    slot->open_files = 0;
+
+    if (ops->mount != NULL && !ops->mount(slot)) {
+        return -1;
+    }
+
+    slot->in_use = true;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_umount - Unmount the filesystem mounted at a path
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   0 on success, -1 if nothing is mounted there or files are still open
+ * --------------------------------------------------------------------------- */
+int vfs_umount(const char *path)
+{
+    if (path == NULL) {
+        return -1;
+    }
+
+    size_t len = mount_path_length(path);
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t *mount = &mounts[i];
+        if (!mount->in_use || mount->path_len != len ||
+            memcmp(mount->path, path, len) != 0) {
+            continue;
+        }
+
+        if (mount->open_files > 0) {
+            return -1;
+        }
+        if (mount->ops->unmount != NULL) {
+            mount->ops->unmount(mount);
+        }
+        mount->in_use = false;
+        return 0;
+    }
+    return -1;
+}
 
 /* ---------------------------------------------------------------------------
  * vfs_init - Initialize the Virtual File System
  * ---------------------------------------------------------------------------
- * Initializes all registered filesystems (currently only RAMFS).
+ * Clears the mount table, sets up the open file cache and mounts RAMFS as the root filesystem.
  * --------------------------------------------------------------------------- */
 void vfs_init(void)
 {
@@ -66,97 +214,602 @@ void vfs_init(void)
         return;
     }
 
-    /* Initialize the root filesystem (RAMFS) */
-    ramfs_init();
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        mounts[i].in_use = false;
+    }
+    if (file_cache == NULL) {
+        file_cache = kmem_cache_create("vfs_file", sizeof(vfs_file_t), 0, NULL);
+    }
+    if (file_cache == NULL) {
+        return;
+    }
+
+    vfs_initialized = (vfs_mount("/", &ramfs_ops) == 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * VFS Namespace Operations - Route to the owning mount
+ * --------------------------------------------------------------------------- */
+
+static int vfs_create_node(const char *path, int type)
+{
+    const char *rel;
+    vfs_mount_t *mount = vfs_resolve(path, &rel);
+    if (!vfs_initialized || mount == NULL || mount->ops->create == NULL) {
+        return -1;
+    }
+    return mount->ops->create(mount, rel, type);
+}
+
+int vfs_create(const char *path)
+{
+    return vfs_create_node(path, VFS_TYPE_FILE);
+}
+
+int vfs_mkdir(const char *path)
+{
+    return vfs_create_node(path, VFS_TYPE_DIRECTORY);
+}
+
+int vfs_unlink(const char *path)
+{
+    const char *rel;
+    vfs_mount_t *mount = vfs_resolve(path, &rel);
+    if (!vfs_initialized || mount == NULL || mount->ops->unlink == NULL) {
+        return -1;
+    }
+    return mount->ops->unlink(mount, rel);
+}
+
+int vfs_stat(const char *path, size_t *size, int *type)
+{
+    const char *rel;
+    vfs_mount_t *mount = vfs_resolve(path, &rel);
+    if (!vfs_initialized || mount == NULL || mount->ops->stat == NULL) {
+        return -1;
+    }
+    return mount->ops->stat(mount, rel, size, type);
+}
+
+/* ---------------------------------------------------------------------------
+ * Descriptor Tables
+ * --------------------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------------------
+ * fd_table_resize - Give a table room for 'capacity' descriptors
+ * ---------------------------------------------------------------------------
+ * Only called when every existing descriptor is in use, so the new bitmap
+ * is simply the old range marked used.
+ * --------------------------------------------------------------------------- */
+static bool fd_table_resize(vfs_fd_table_t *table, size_t capacity)
+{
+    vfs_file_t **files = (vfs_file_t **)krealloc(table->files,
+                                                 capacity * sizeof(vfs_file_t *));
+    if (files == NULL) {
+        return false;
+    }
+    table->files = files;
+
+    void *bits = kmalloc(BITMAP_BUFFER_SIZE(capacity));
+    void *summary = kmalloc(BITMAP_SUMMARY_SIZE(capacity));
+    if (bits == NULL || summary == NULL) {
+        kfree(bits);
+        kfree(summary);
+        return false;
+    }
+
+    bitmap_init(&table->used, capacity, bits);
+    if (table->capacity > 0) {
+        bitmap_set_range(&table->used, 0, table->capacity);
+    }
+    bitmap_enable_summary(&table->used, summary);
+
+    for (size_t i = table->capacity; i < capacity; i++) {
+        files[i] = NULL;
+    }
+
+    kfree(table->bits);
+    kfree(table->summary);
+    table->bits = bits;
+    table->summary = summary;
+    table->capacity = capacity;
+    return true;
+}
+
+static vfs_fd_table_t *fd_table_create(void)
+{
+    vfs_fd_table_t *table = (vfs_fd_table_t *)kcalloc(1, sizeof(vfs_fd_table_t));
+    if (table == NULL) {
+        return NULL;
+    }
+    if (!fd_table_resize(table, VFS_FD_TABLE_INITIAL)) {
+        kfree(table);
+        return NULL;
+    }
+    return table;
+}
+
+/* Descriptor table of the running task (or the kernel's) */
+static vfs_fd_table_t *fd_table_current(bool create)
+{
+    task_t *task = task_current();
+    vfs_fd_table_t **slot = (task != NULL) ? &task->files : &kernel_fd_table;
+
+    if (*slot == NULL && create) {
+        *slot = fd_table_create();
+    }
+    return *slot;
+}
+
+/* Lowest free descriptor index, growing the table if it is full */
+static int64_t fd_table_alloc(vfs_fd_table_t *table)
+{
+    int64_t index = bitmap_find_first_zero(&table->used);
+    if (index < 0) {
+        size_t capacity = table->capacity * 2;
+        if (capacity > VFS_FD_TABLE_MAX || !fd_table_resize(table, capacity)) {
+            return -1;
+        }
+        index = bitmap_find_first_zero(&table->used);
+    }
+
+    bitmap_set(&table->used, (size_t)index);
+    table->open++;
+    return index;
+}
+
+/* Drop one descriptor's reference to an open file */
+static void file_put(vfs_file_t *file)
+{
+    if (--file->ref_count > 0) {
+        return;
+    }
+
+    epoll_file_release(file);
+    if (file->ops->release != NULL) {
+        file->ops->release(file);
+    }
+    file->mount->open_files--;
+    kmem_cache_free(file_cache, file);
+}
+
+/* Open file for a descriptor that allows 'mode' access, or NULL */
+vfs_file_t *vfs_fget(int fd, uint32_t mode)
+{
+    vfs_fd_table_t *table = fd_table_current(false);
+    if (table == NULL || fd < VFS_FIRST_FD ||
+        (size_t)(fd - VFS_FIRST_FD) >= table->capacity) {
+        return NULL;
+    }
+
+    vfs_file_t *file = table->files[fd - VFS_FIRST_FD];
+    if (file == NULL || (file->mode & mode) != mode) {
+        return NULL;
+    }
+    return file;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_fd_table_destroy - Close every descriptor in a table and free it
+ * ---------------------------------------------------------------------------
+ * Called when a task exits; the table must no longer be reachable from it.
+ * --------------------------------------------------------------------------- */
+void vfs_fd_table_destroy(vfs_fd_table_t *table)
+{
+    if (table == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < table->capacity && table->open > 0; i++) {
+        if (table->files[i] != NULL) {
+            file_put(table->files[i]);
+            table->open--;
+        }
+    }
 
-    vfs_initialized = true;
+    kfree(table->files);
+    kfree(table->bits);
+    kfree(table->summary);
+    kfree(table);
 }
 
 /* ---------------------------------------------------------------------------
- * VFS File Operations - Route to appropriate filesystem
+ * vfs_fd_table_clone - Copy a descriptor table for fork
  * ---------------------------------------------------------------------------
- * These functions provide a unified interface. Currently, all operations
- * are routed to RAMFS since it's the only mounted filesystem.
+ * The copy refers to the same open files (and so shares their positions).
+ *
+ * Returns:
+ *   The new table, or NULL if out of memory (or table is NULL)
  * --------------------------------------------------------------------------- */
+vfs_fd_table_t *vfs_fd_table_clone(const vfs_fd_table_t *table)
+{
+    if (table == NULL) {
+        return NULL;
+    }
+
+    vfs_fd_table_t *copy = (vfs_fd_table_t *)kcalloc(1, sizeof(vfs_fd_table_t));
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (!fd_table_resize(copy, table->capacity)) {
+        kfree(copy);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        vfs_file_t *file = table->files[i];
+        if (file != NULL) {
+            file->ref_count++;
+            copy->files[i] = file;
+            bitmap_set(&copy->used, i);
+            copy->open++;
+        }
+    }
+    return copy;
+}
+
+/* Number of descriptors the running task has open */
+size_t vfs_open_count(void)
+{
+    vfs_fd_table_t *table = fd_table_current(false);
+    return table ? table->open : 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_open_mode - Open a file or directory with the given access mode
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Lowest free descriptor on success, -1 on error
+ * --------------------------------------------------------------------------- */
+static int vfs_open_mode(const char *path, uint32_t mode)
+{
+    const char *rel;
+    vfs_mount_t *mount = vfs_resolve(path, &rel);
+    if (!vfs_initialized || mount == NULL || mount->ops->open == NULL) {
+        return -1;
+    }
+
+    vfs_fd_table_t *table = fd_table_current(true);
+    if (table == NULL) {
+        return -1;
+    }
+
+    vfs_file_t *file = (vfs_file_t *)kmem_cache_alloc(file_cache);
+    if (file == NULL) {
+        return -1;
+    }
+
+    file->ops = mount->ops;
+    file->mount = mount;
+    file->node = NULL;
+    file->position = 0;
+    file->mode = mode;
+    file->ref_count = 1;
+    file->dir_cursor = NULL;
+    file->dir_index = 0;
+    file->dir_version = 0;
+    if (!mount->ops->open(mount, rel, file)) {
+        kmem_cache_free(file_cache, file);
+        return -1;
+    }
+    mount->open_files++;
+
+    int64_t index = fd_table_alloc(table);
+    if (index < 0) {
+        file_put(file);
+        return -1;  /* Descriptor limit reached */
+    }
+
+    table->files[index] = file;
+    return VFS_FIRST_FD + (int)index;
+}
+
+/* ---------------------------------------------------------------------------
+ * vfs_install - Give an already-built object a descriptor
+ * ---------------------------------------------------------------------------
+ * For files that are not reached through a path (pipe ends). The file
+ * belongs to an internal mount, so ops->release still runs on last close.
+ *
+ * Returns:
+ *   Lowest free descriptor, or -1 (the caller still owns 'node')
+ * --------------------------------------------------------------------------- */
+int vfs_install(const vfs_ops_t *ops, void *node, uint32_t mode)
+{
+    vfs_fd_table_t *table = fd_table_current(true);
+    if (!vfs_initialized || table == NULL) {
+        return -1;
+    }
+
+    vfs_file_t *file = (vfs_file_t *)kmem_cache_alloc(file_cache);
+    if (file == NULL) {
+        return -1;
+    }
+    int64_t index = fd_table_alloc(table);
+    if (index < 0) {
+        kmem_cache_free(file_cache, file);
+        return -1;
+    }
+
+    file->ops = ops;
+    file->mount = &anon_mount;
+    file->node = node;
+    file->position = 0;
+    file->mode = mode;
+    file->ref_count = 1;
+    file->dir_cursor = NULL;
+    file->dir_index = 0;
+    file->dir_version = 0;
+    anon_mount.open_files++;
+
+    table->files[index] = file;
+    return VFS_FIRST_FD + (int)index;
+}
 
 int vfs_open(const char *path)
 {
-    if (!vfs_initialized || path == NULL) {
+    return vfs_open_mode(path, VFS_FILE_READ | VFS_FILE_WRITE);
+}
+
+/* Directory descriptors only support getdents, seek and close */
+int vfs_opendir(const char *path)
+{
+    return vfs_open_mode(path, VFS_FILE_DIRECTORY);
+}
+
+int vfs_close(int fd)
+{
+    vfs_file_t *file = vfs_fget(fd, 0);
+    if (file == NULL) {
         return -1;
     }
-    return ramfs_open(path);
+
+    vfs_fd_table_t *table = fd_table_current(false);
+    size_t index = (size_t)(fd - VFS_FIRST_FD);
+    table->files[index] = NULL;
+    bitmap_clear(&table->used, index);
+    table->open--;
+
+    file_put(file);
+    return 0;
 }
 
+/* ---------------------------------------------------------------------------
+ * VFS File Operations - One indirect call per request
+ * --------------------------------------------------------------------------- */
+
 ssize_t vfs_read(int fd, void *buffer, size_t size)
 {
-    if (!vfs_initialized) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_READ);
+    if (file == NULL || buffer == NULL) {
         return -1;
     }
-    return ramfs_read(fd, buffer, size);
+
+    ssize_t done = file->ops->read(file, buffer, size, file->position);
+    if (done > 0) {
+        file->position += (size_t)done;
+    }
+    return done;
 }
 
 ssize_t vfs_write(int fd, const void *buffer, size_t size)
 {
-    if (!vfs_initialized) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_WRITE);
+    if (file == NULL || buffer == NULL) {
         return -1;
     }
-    return ramfs_write(fd, buffer, size);
+
+    ssize_t done = file->ops->write(file, buffer, size, file->position);
+    if (done > 0) {
+        file->position += (size_t)done;
+    }
+    return done;
 }
 
-int vfs_close(int fd)
+/* pread/pwrite: explicit offset, position unchanged */
+ssize_t vfs_pread(int fd, void *buffer, size_t size, size_t offset)
 {
-    if (!vfs_initialized) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_READ);
+    if (file == NULL || buffer == NULL) {
         return -1;
     }
-    return ramfs_close(fd);
+    return file->ops->read(file, buffer, size, offset);
 }
 
-int vfs_unlink(const char *path)
+ssize_t vfs_pwrite(int fd, const void *buffer, size_t size, size_t offset)
 {
-    if (!vfs_initialized || path == NULL) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_WRITE);
+    if (file == NULL || buffer == NULL) {
         return -1;
     }
-    return ramfs_unlink(path);
+    return file->ops->write(file, buffer, size, offset);
 }
 
-int vfs_mkdir(const char *path)
+/* ---------------------------------------------------------------------------
+ * vfs_readv / vfs_writev - Scatter/gather I/O at the current position
+ * ---------------------------------------------------------------------------
+ * The descriptor is looked up once for the whole vector. A short transfer
+ * ends the call; the bytes moved so far are returned.
+ * --------------------------------------------------------------------------- */
+ssize_t vfs_readv(int fd, const struct iovec *iov, int iovcnt)
 {
-    if (!vfs_initialized || path == NULL) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_READ);
+    if (file == NULL || iov == NULL || iovcnt < 0 || iovcnt > VFS_IOV_MAX) {
         return -1;
     }
-    return ramfs_mkdir(path);
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        if (iov[i].iov_base == NULL) {
+            return total ? (ssize_t)total : -1;
+        }
+
+        ssize_t done = file->ops->read(file, iov[i].iov_base, iov[i].iov_len, file->position);
+        if (done < 0) {
+            return total ? (ssize_t)total : -1;
+        }
+        file->position += (size_t)done;
+        total += (size_t)done;
+        if ((size_t)done < iov[i].iov_len) {
+            break;  /* EOF */
+        }
+    }
+    return (ssize_t)total;
 }
 
-int vfs_create(const char *path)
+ssize_t vfs_writev(int fd, const struct iovec *iov, int iovcnt)
 {
-    if (!vfs_initialized || path == NULL) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_WRITE);
+    if (file == NULL || iov == NULL || iovcnt < 0 || iovcnt > VFS_IOV_MAX) {
         return -1;
     }
-    return ramfs_touch(path);
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        if (iov[i].iov_base == NULL) {
+            return total ? (ssize_t)total : -1;
+        }
+
+        ssize_t done = file->ops->write(file, iov[i].iov_base, iov[i].iov_len, file->position);
+        if (done < 0) {
+            return total ? (ssize_t)total : -1;
+        }
+        file->position += (size_t)done;
+        total += (size_t)done;
+        if ((size_t)done < iov[i].iov_len) {
+            break;  /* Filesystem full */
+        }
+    }
+    return (ssize_t)total;
 }
 
+/* ---------------------------------------------------------------------------
+ * vfs_seek - Change the position of an open file
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   New position, or -1 on error (bad fd/whence, or a negative result)
+ * --------------------------------------------------------------------------- */
 ssize_t vfs_seek(int fd, ssize_t offset, int whence)
 {
-    if (!vfs_initialized) {
+    vfs_file_t *file = vfs_fget(fd, 0);
+    if (file == NULL) {
+        return -1;
+    }
+
+    ssize_t base;
+    switch (whence) {
+        case VFS_SEEK_SET:
+            base = 0;
+            break;
+        case VFS_SEEK_CUR:
+            base = (ssize_t)file->position;
+            break;
+        case VFS_SEEK_END:
+            if (file->ops->size == NULL) {
+                return -1;
+            }
+            base = (ssize_t)file->ops->size(file);
+            break;
+        default:
+            return -1;
+    }
+
+    ssize_t position = base + offset;
+    if (position < 0) {
         return -1;
     }
-    return ramfs_seek(fd, offset, whence);
+    file->position = (size_t)position;
+    return position;
 }
 
-int vfs_stat(const char *path, size_t *size, int *type)
+/* ---------------------------------------------------------------------------
+ * vfs_getdents - Read the next batch of directory entries
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Entries stored (0 at the end of the directory), or -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t vfs_getdents(int fd, vfs_dirent_t *entries, size_t count)
 {
-    if (!vfs_initialized || path == NULL) {
+    vfs_file_t *file = vfs_fget(fd, VFS_FILE_DIRECTORY);
+    if (file == NULL || entries == NULL || file->ops->getdents == NULL) {
         return -1;
     }
-    return ramfs_stat(path, size, type);
+
+    ssize_t done = file->ops->getdents(file, entries, count, file->position);
+    if (done > 0) {
+        file->position += (size_t)done;
+    }
+    return done;
 }
 
-int vfs_list_dir(const char *path, char **names, size_t max_entries)
+/* ---------------------------------------------------------------------------
+ * vfs_mmap - Map part of an open file into the caller's address space
+ * ---------------------------------------------------------------------------
+ * offset must be page-aligned and the mapping must be readable. Writable
+ * mappings must be MAP_SHARED (private ones would need copy-on-write) and
+ * the file must be open for writing.
+ *
+ * Returns:
+ *   Start address of the mapping, or NULL on error
+ * --------------------------------------------------------------------------- */
+void *vfs_mmap(int fd, size_t length, int prot, int flags, size_t offset)
 {
-    if (!vfs_initialized || path == NULL || names == NULL) {
-        return -1;
+    if (length == 0 || (offset % PAGE_SIZE) != 0 || !(prot & PROT_READ)) {
+        return NULL;
+    }
+
+    bool writable = (prot & PROT_WRITE) != 0;
+    if (writable && !(flags & MAP_SHARED)) {
+        return NULL;
+    }
+
+    vfs_file_t *file = vfs_fget(fd, writable ? (VFS_FILE_READ | VFS_FILE_WRITE)
+                                                 : VFS_FILE_READ);
+    if (file == NULL || file->ops->mmap == NULL) {
+        return NULL;
+    }
+    return file->ops->mmap(file, length, prot, flags, offset);
+}
+
+/* Mappings are owned by the address space, not by a filesystem */
+int vfs_munmap(void *addr, size_t length)
+{
+    address_space_t *as = address_space_current(false);
+    return vm_area_release(as, (uintptr_t)addr, length) ? 0 : -1;
+}
+
+/* Readiness for kpoll(); files without a poll op never block */
+uint32_t vfs_poll(int fd, struct wait_queue **wq)
+{
+    *wq = NULL;
+    vfs_file_t *file = vfs_fget(fd, 0);
+    if (file == NULL) {
+        return POLLNVAL;
+    }
+    return vfs_file_poll(file, wq);
+}
+
+/* Same for an open file held without a descriptor (epoll items) */
+uint32_t vfs_file_poll(vfs_file_t *file, struct wait_queue **wq)
+{
+    *wq = NULL;
+    if (file->ops->poll != NULL) {
+        return file->ops->poll(file, wq);
+    }
+
+    uint32_t mask = 0;
+    if (file->mode & VFS_FILE_READ) {
+        mask |= POLLIN;
+    }
+    if (file->mode & VFS_FILE_WRITE) {
+        mask |= POLLOUT;
     }
-    return ramfs_list_dir(path, names, max_entries);
+    return mask;
 }
 
 /* ---------------------------------------------------------------------------
@@ -164,5 +817,5 @@ int vfs_list_dir(const char *path, char **names, size_t max_entries)
  * --------------------------------------------------------------------------- */
 bool vfs_is_initialized(void)
 {
-    return vfs_initialized && ramfs_is_initialized();
+    return vfs_initialized;
 }
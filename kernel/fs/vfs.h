@@ -0,0 +1,176 @@
+/*
+ * ===========================================================================
+ * kernel/fs/vfs.h
+ * ===========================================================================
+ *
+ * Virtual File System Interface
+ *
+ * A filesystem plugs into the VFS by filling in a vfs_ops_t and being
+ * mounted at a path. Path calls are routed to the mount with the longest
+ * matching prefix and receive the remainder of the path (always starting
+ * with '/', pointing into the caller's string - nothing is copied).
+ *
+ * Opening a file produces a vfs_file_t: the VFS keeps the position and
+ * access mode, and the filesystem keeps whatever it needs in file->node
+ * (RAMFS stores its inode there). Each file operation is then a single
+ * indirect call through file->ops with an explicit offset. Descriptors
+ * live in per-task tables and point at these objects.
+ *
+ * Directories are opened with vfs_opendir() and read in batches of
+ * fixed-size vfs_dirent_t records through vfs_getdents(); the position of
+ * a directory descriptor counts entries, so seeking to 0 rewinds it.
+ *
+ * Files that have no path (pipe ends) are installed straight into the
+ * descriptor table with vfs_install(). vfs_splice() moves data between
+ * descriptors inside the kernel: filesystems that expose their page cache
+ * through the page op lend those pages to pipes without copying.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_VFS_H
+#define NEXA_VFS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../config/os_config.h"
+
+/* Node types reported by stat */
+#define VFS_TYPE_FILE       0
+#define VFS_TYPE_DIRECTORY  1
+
+/* Seek origins */
+#define VFS_SEEK_SET        0
+#define VFS_SEEK_CUR        1
+#define VFS_SEEK_END        2
+
+/* vfs_file_t access mode */
+#define VFS_FILE_READ       (1 << 0)
+#define VFS_FILE_WRITE      (1 << 1)
+#define VFS_FILE_DIRECTORY  (1 << 2)    /* Opened with vfs_opendir() */
+
+/* One directory entry returned by getdents */
+typedef struct vfs_dirent {
+    uint32_t inode;                 /* Filesystem's inode number */
+    uint16_t type;                  /* VFS_TYPE_* */
+    uint16_t name_len;              /* Not counting the terminator */
+    char name[MAX_FILENAME_LENGTH]; /* NUL-terminated */
+} vfs_dirent_t;
+
+/* I/O vector for readv/writev */
+struct iovec {
+    void *iov_base;                 /* Buffer start */
+    size_t iov_len;                 /* Buffer length in bytes */
+};
+
+struct vfs_ops;
+struct wait_queue;
+
+/* A mounted filesystem instance */
+typedef struct vfs_mount {
+    char path[VFS_MOUNT_PATH_MAX];  /* Mount point, no trailing '/' (except "/") */
+    size_t path_len;
+    const struct vfs_ops *ops;
+    void *fs_data;                  /* Set by ops->mount */
+    uint32_t open_files;            /* Files open through this mount */
+    bool in_use;
+} vfs_mount_t;
+
+/* An open file */
+typedef struct vfs_file {
+    const struct vfs_ops *ops;      /* == mount->ops, cached for dispatch */
+    vfs_mount_t *mount;
+    void *node;                     /* Filesystem's object for the file */
+    size_t position;                /* Offset for read/write/readv/writev */
+    uint32_t mode;                  /* VFS_FILE_* */
+    uint32_t ref_count;             /* Descriptors referring to this file */
+
+    /* Directory read cursor, owned by the filesystem (see getdents) */
+    void *dir_cursor;               /* Next entry at position dir_index */
+    size_t dir_index;
+    uint32_t dir_version;           /* Directory version the cursor is for */
+} vfs_file_t;
+
+/* Per-task descriptor table (private to vfs.c) */
+typedef struct vfs_fd_table vfs_fd_table_t;
+
+/*
+ * Filesystem operations. Paths are relative to the mount point. Optional
+ * operations may be NULL; the VFS then fails the call.
+ */
+typedef struct vfs_ops {
+    const char *name;
+
+    /* Instance setup/teardown (optional) */
+    bool (*mount)(vfs_mount_t *mount);
+    void (*unmount)(vfs_mount_t *mount);
+
+    /* Namespace */
+    int (*create)(vfs_mount_t *mount, const char *path, int type);
+    int (*unlink)(vfs_mount_t *mount, const char *path);
+    int (*stat)(vfs_mount_t *mount, const char *path, size_t *size, int *type);
+
+    /* Files: open fills file->node, release drops it. file->mode has
+     * VFS_FILE_DIRECTORY set when a directory is being opened. */
+    bool (*open)(vfs_mount_t *mount, const char *path, vfs_file_t *file);
+    void (*release)(vfs_file_t *file);
+    ssize_t (*read)(vfs_file_t *file, void *buffer, size_t size, size_t offset);
+    ssize_t (*write)(vfs_file_t *file, const void *buffer, size_t size, size_t offset);
+    size_t (*size)(vfs_file_t *file);
+    uint32_t (*poll)(vfs_file_t *file, struct wait_queue **wq);    /* NULL = always ready */
+    uint8_t *(*page)(vfs_file_t *file, size_t index);   /* Cached data page, NULL = hole */
+    void *(*mmap)(vfs_file_t *file, size_t length, int prot, int flags, size_t offset);
+
+    /* Directories: up to count entries starting at entry 'index' */
+    ssize_t (*getdents)(vfs_file_t *file, vfs_dirent_t *entries, size_t count, size_t index);
+} vfs_ops_t;
+
+/* Filesystems */
+extern const vfs_ops_t ramfs_ops;
+
+/* Setup and mounts */
+void vfs_init(void);
+bool vfs_is_initialized(void);
+int vfs_mount(const char *path, const vfs_ops_t *ops);
+int vfs_umount(const char *path);
+
+/* Namespace */
+int vfs_create(const char *path);
+int vfs_mkdir(const char *path);
+int vfs_unlink(const char *path);
+int vfs_stat(const char *path, size_t *size, int *type);
+
+/* File descriptors (per task; the lowest free number is used) */
+void vfs_fd_table_destroy(vfs_fd_table_t *table);
+vfs_fd_table_t *vfs_fd_table_clone(const vfs_fd_table_t *table);
+size_t vfs_open_count(void);
+int vfs_open(const char *path);
+int vfs_opendir(const char *path);
+int vfs_close(int fd);
+ssize_t vfs_read(int fd, void *buffer, size_t size);
+ssize_t vfs_write(int fd, const void *buffer, size_t size);
+ssize_t vfs_pread(int fd, void *buffer, size_t size, size_t offset);
+ssize_t vfs_pwrite(int fd, const void *buffer, size_t size, size_t offset);
+ssize_t vfs_readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t vfs_writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t vfs_seek(int fd, ssize_t offset, int whence);
+ssize_t vfs_getdents(int fd, vfs_dirent_t *entries, size_t count);
+void *vfs_mmap(int fd, size_t length, int prot, int flags, size_t offset);
+int vfs_munmap(void *addr, size_t length);
+uint32_t vfs_poll(int fd, struct wait_queue **wq);
+uint32_t vfs_file_poll(vfs_file_t *file, struct wait_queue **wq);
+
+/* Descriptors for files without a path, and in-kernel lookups */
+int vfs_install(const vfs_ops_t *ops, void *node, uint32_t mode);
+vfs_file_t *vfs_fget(int fd, uint32_t mode);
+
+/* Pipes and splicing (pipe.c) */
+#define VFS_SPLICE_SERIAL   0x1     /* Console output goes to COM1 instead */
+
+int vfs_pipe(int fds[2]);
+ssize_t vfs_splice(int in_fd, int out_fd, size_t count);
+ssize_t vfs_splice_emit(int in_fd, size_t count,
+                        void (*emit)(const char *data, size_t len, void *ctx), void *ctx);
+
+#endif /* NEXA_VFS_H */
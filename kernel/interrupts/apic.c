@@ -0,0 +1,356 @@
+/*
+ * ===========================================================================
+ * kernel/interrupts/apic.c
+ * ===========================================================================
+ *
+ * Local APIC and I/O APIC Interrupt Controller
+ *
+ * When the CPU has a local APIC and the MP table lists an I/O APIC, device
+ * interrupts are taken through them instead of the 8259 pair:
+ *
+ * ┌─────────────────────────────────────────────────────────────────────────┐
+ * │  device ──> I/O APIC pin ──(redirection entry)──> LAPIC of one CPU      │
+ * │             vector = IRQ_TO_VECTOR(irq), fixed delivery, physical dest  │
+ * │                                                                         │
+ * │  EOI:      one store to the LAPIC EOI register (no port I/O)            │
+ * │  Spurious: LAPIC spurious vector 0xFF, which is never acknowledged      │
+ * │  Timer:    LAPIC timer on vector IRQ_TO_VECTOR(0) (see timer.c)         │
+ * │  Wakeup:   IPI on APIC_WAKEUP_VECTOR, only acknowledged: it ends a HLT  │
+ * └─────────────────────────────────────────────────────────────────────────┘
+ *
+ * ISA IRQs keep their vectors 32-47, so the IRQ stubs, irq_handler() and
+ * every driver work unchanged; only the mask, EOI and routing primitives
+ * differ. The MP table's interrupt entries give each ISA IRQ its I/O APIC
+ * pin and polarity/trigger (the PIT, for one, is usually on pin 2).
+ *
+ * Without a local APIC or an I/O APIC, apic_init() leaves the PIC in
+ * charge and nothing else changes. Application processors enable their own
+ * local APIC with apic_ap_init(); device interrupts stay routed to the BSP.
+ *
+ * ===========================================================================
+ */
+
+#include "interrupts.h"
+#include "../scheduler/smp.h"
+
+/* ---------------------------------------------------------------------------
+ * External Functions (from startup.asm)
+ * --------------------------------------------------------------------------- */
+extern void outb(uint16_t port, uint8_t value);
+
+/* ---------------------------------------------------------------------------
+ * Local APIC Registers (offsets from the MMIO base)
+ * --------------------------------------------------------------------------- */
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_TPR           0x080   /* Task priority */
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0   /* Spurious vector, software enable */
+#define LAPIC_REG_LVT_TIMER     0x320
+#define LAPIC_REG_TIMER_INITIAL 0x380
+#define LAPIC_REG_TIMER_CURRENT 0x390
+#define LAPIC_REG_TIMER_DIVIDE  0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_TIMER_PERIODIC    0x20000
+#define LAPIC_TIMER_DIVIDE_16   0x3
+
+#define LAPIC_SPURIOUS_VECTOR   0xFF    /* Low nibble must be 1111 on P6 */
+
+#define MSR_APIC_BASE           0x1B
+#define MSR_APIC_BASE_ENABLE    (1u << 11)
+#define CPUID_FEAT_EDX_APIC     (1u << 9)
+
+/* ---------------------------------------------------------------------------
+ * I/O APIC Registers
+ * --------------------------------------------------------------------------- */
+#define IOAPIC_REGSEL           0x00    /* Index register (MMIO offset) */
+#define IOAPIC_WINDOW           0x10    /* Data register (MMIO offset) */
+
+#define IOAPIC_REG_VERSION      0x01    /* Bits 16-23: highest redirection entry */
+#define IOAPIC_REG_REDIR(pin)   (0x10 + 2 * (pin))
+
+#define IOAPIC_REDIR_LOW_ACTIVE 0x2000  /* Polarity: active low */
+#define IOAPIC_REDIR_LEVEL      0x8000  /* Trigger: level */
+#define IOAPIC_REDIR_MASKED     0x10000
+
+/* MP table interrupt flags (polarity bits 0-1, trigger bits 2-3) */
+#define MP_POLARITY_LOW         0x3
+#define MP_TRIGGER_LEVEL        (0x3 << 2)
+
+/* IMCR: route the PIC output through the APIC (MP spec, PIC mode) */
+#define IMCR_SELECT             0x22
+#define IMCR_DATA               0x23
+#define IMCR_REGISTER           0x70
+#define IMCR_APIC_MODE          0x01
+
+/* IDT gate for the spurious vector */
+#define KERNEL_CS               0x08
+#define IDT_GATE_INTERRUPT      0x8E
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+static volatile uint32_t *lapic __attribute__((used)) = NULL;  /* Local APIC MMIO base */
+static volatile uint32_t *ioapic = NULL;    /* I/O APIC MMIO base */
+static uint8_t ioapic_pins = 0;             /* Redirection entries */
+static bool apic_active = false;
+
+/* Per ISA IRQ: I/O APIC pin and redirection entry (vector, polarity, trigger) */
+static uint8_t irq_pin[IRQ_COUNT];
+static uint32_t irq_redir[IRQ_COUNT];
+static uint8_t irq_dest[IRQ_COUNT];         /* Destination APIC ID */
+
+/* Counted by the spurious stub itself */
+static volatile uint32_t apic_spurious_hits __attribute__((used)) = 0;
+
+/* ---------------------------------------------------------------------------
+ * apic_spurious_entry - LAPIC spurious vector
+ * ---------------------------------------------------------------------------
+ * A spurious interrupt sets no in-service bit, so it must not get an EOI;
+ * counting it is all there is to do.
+ * --------------------------------------------------------------------------- */
+__asm__(
+    ".pushsection .text\n"
+    "apic_spurious_entry:\n"
+    "    lock incl apic_spurious_hits\n"
+    "    iret\n"
+    ".popsection\n"
+);
+
+extern void apic_spurious_entry(void);
+
+/* ---------------------------------------------------------------------------
+ * apic_wakeup_entry - Wakeup IPI (APIC_WAKEUP_VECTOR)
+ * ---------------------------------------------------------------------------
+ * Sent to a halted CPU when work is queued for it; returning from the
+ * interrupt is all the idle loop needs, so the stub only writes the EOI.
+ * --------------------------------------------------------------------------- */
+__asm__(
+    ".pushsection .text\n"
+    "apic_wakeup_entry:\n"
+    "    pushl %eax\n"
+    "    movl lapic, %eax\n"
+    "    movl $0, 0xB0(%eax)\n"
+    "    popl %eax\n"
+    "    iret\n"
+    ".popsection\n"
+);
+
+extern void apic_wakeup_entry(void);
+
+/* ---------------------------------------------------------------------------
+ * Register Access
+ * --------------------------------------------------------------------------- */
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic[reg / 4] = value;
+}
+
+static uint32_t ioapic_read(uint8_t reg)
+{
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    return ioapic[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(uint8_t reg, uint32_t value)
+{
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    ioapic[IOAPIC_WINDOW / 4] = value;
+}
+
+/* Write an ISA IRQ's redirection entry (destination first, then the rest) */
+static void ioapic_program(uint8_t irq, bool masked)
+{
+    uint8_t pin = irq_pin[irq];
+    ioapic_write(IOAPIC_REG_REDIR(pin) + 1, (uint32_t)irq_dest[irq] << 24);
+    ioapic_write(IOAPIC_REG_REDIR(pin), irq_redir[irq] | (masked ? IOAPIC_REDIR_MASKED : 0));
+}
+
+/* ---------------------------------------------------------------------------
+ * apic_init - Switch interrupt delivery from the PIC to the APICs
+ * ---------------------------------------------------------------------------
+ * Every ISA IRQ is routed to the boot CPU and left masked; irq_enable()
+ * unmasks lines as drivers register. Must run with interrupts disabled,
+ * after pic_init() (which remaps the PIC so a stray 8259 interrupt cannot
+ * land on an exception vector) and with the MMIO window mapped.
+ *
+ * Returns:
+ *   true if the APICs now deliver interrupts, false if the PIC still does
+ * --------------------------------------------------------------------------- */
+bool apic_init(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_FEAT_EDX_APIC)) {
+        return false;
+    }
+
+    smp_ioapic_config_t config;
+    if (!smp_ioapic_config(&config)) {
+        return false;  /* No I/O APIC to route devices through */
+    }
+
+    /* Local APIC: globally enabled at its MSR base, software enabled */
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(MSR_APIC_BASE));
+    lo |= MSR_APIC_BASE_ENABLE;
+    __asm__ volatile("wrmsr" :: "a"(lo), "d"(hi), "c"(MSR_APIC_BASE));
+    lapic = (volatile uint32_t *)(uintptr_t)(lo & 0xFFFFF000);
+
+    idt_set_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)(uintptr_t)apic_spurious_entry,
+                 KERNEL_CS, IDT_GATE_INTERRUPT);
+    idt_set_gate(APIC_WAKEUP_VECTOR, (uint32_t)(uintptr_t)apic_wakeup_entry,
+                 KERNEL_CS, IDT_GATE_INTERRUPT);
+    apic_ap_init();
+
+    /* I/O APIC: every ISA IRQ masked, vector 32 + irq, to this CPU */
+    ioapic = (volatile uint32_t *)(uintptr_t)config.address;
+    ioapic_pins = (uint8_t)(((ioapic_read(IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1);
+
+    uint8_t bsp = (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24);
+    for (uint8_t pin = 0; pin < ioapic_pins; pin++) {
+        ioapic_write(IOAPIC_REG_REDIR(pin), IOAPIC_REDIR_MASKED);
+    }
+    for (uint8_t irq = 0; irq < IRQ_COUNT; irq++) {
+        uint16_t flags = config.isa_flags[irq];
+        irq_pin[irq] = config.isa_pin[irq];
+        irq_dest[irq] = bsp;
+        irq_redir[irq] = IRQ_TO_VECTOR(irq);
+        if ((flags & 0x3) == MP_POLARITY_LOW) {
+            irq_redir[irq] |= IOAPIC_REDIR_LOW_ACTIVE;
+        }
+        if ((flags & (0x3 << 2)) == MP_TRIGGER_LEVEL) {
+            irq_redir[irq] |= IOAPIC_REDIR_LEVEL;
+        }
+        if (irq_pin[irq] < ioapic_pins && irq != IRQ2_CASCADE) {
+            ioapic_program(irq, true);
+        }
+    }
+
+    /* The 8259s stay remapped but silent; the IMCR disconnects them fully */
+    pic_disable();
+    if (config.imcr) {
+        outb(IMCR_SELECT, IMCR_REGISTER);
+        outb(IMCR_DATA, IMCR_APIC_MODE);
+    }
+
+    apic_active = true;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * apic_ap_init - Software-enable the calling CPU's local APIC
+ * ---------------------------------------------------------------------------
+ * Accept every priority, keep the timer masked until timer.c arms it.
+ * apic_init() does this for the BSP; each AP calls it on the way up, after
+ * loading the shared IDT.
+ * --------------------------------------------------------------------------- */
+void apic_ap_init(void)
+{
+    if (lapic == NULL) {
+        return;
+    }
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+/* ---------------------------------------------------------------------------
+ * apic_enabled - Whether the APICs (not the PIC) deliver interrupts
+ * --------------------------------------------------------------------------- */
+bool apic_enabled(void)
+{
+    return apic_active;
+}
+
+/* ---------------------------------------------------------------------------
+ * apic_eoi - Acknowledge the interrupt in service on this CPU
+ * --------------------------------------------------------------------------- */
+void apic_eoi(void)
+{
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * ioapic_set_masked - Mask or unmask an ISA IRQ at the I/O APIC
+ * --------------------------------------------------------------------------- */
+void ioapic_set_masked(uint8_t irq, bool masked)
+{
+    if (!apic_active || irq >= IRQ_COUNT || irq_pin[irq] >= ioapic_pins) {
+        return;
+    }
+    ioapic_program(irq, masked);
+}
+
+/* ---------------------------------------------------------------------------
+ * ioapic_set_destination - Deliver an ISA IRQ to another CPU
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   irq     - ISA IRQ (0-15)
+ *   apic_id - Local APIC ID of the target CPU
+ *   masked  - Current mask state of the line (kept as is)
+ *
+ * Returns:
+ *   true if the line was rerouted
+ * --------------------------------------------------------------------------- */
+bool ioapic_set_destination(uint8_t irq, uint8_t apic_id, bool masked)
+{
+    if (!apic_active || irq >= IRQ_COUNT || irq_pin[irq] >= ioapic_pins) {
+        return false;
+    }
+
+    /* Mask while the two halves of the entry disagree */
+    ioapic_program(irq, true);
+    irq_dest[irq] = apic_id;
+    ioapic_program(irq, masked);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * apic_get_spurious_count - LAPIC spurious interrupts taken
+ * --------------------------------------------------------------------------- */
+uint32_t apic_get_spurious_count(void)
+{
+    return apic_spurious_hits;
+}
+
+/* ---------------------------------------------------------------------------
+ * LAPIC Timer
+ * ---------------------------------------------------------------------------
+ * Counts down at the bus clock / 16 and interrupts on vector
+ * IRQ_TO_VECTOR(0), the PIT's, so irq_handler() treats it as IRQ0. Its rate
+ * is not architectural: timer.c measures it against the PIT.
+ * --------------------------------------------------------------------------- */
+
+/*
+ * lapic_timer_start - (Re)arm the timer
+ *
+ * Parameters:
+ *   count    - Initial count (0 stops the timer)
+ *   periodic - Reload on expiry instead of stopping
+ *   masked   - Count without interrupting (for calibration)
+ */
+void lapic_timer_start(uint32_t count, bool periodic, bool masked)
+{
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, IRQ_TO_VECTOR(IRQ0_TIMER) |
+                                     (periodic ? LAPIC_TIMER_PERIODIC : 0) |
+                                     (masked ? LAPIC_LVT_MASKED : 0));
+    lapic_write(LAPIC_REG_TIMER_INITIAL, count);
+}
+
+/*
+ * lapic_timer_remaining - Current count (0 once a one-shot has expired)
+ */
+uint32_t lapic_timer_remaining(void)
+{
+    return lapic_read(LAPIC_REG_TIMER_CURRENT);
+}
@@ -88,6 +88,9 @@
 /* Syscall interrupt vector (Linux uses 0x80) */
 #define SYSCALL_VECTOR              0x80
 
+/* Inter-processor wakeup for a halted CPU (local APIC fixed IPI) */
+#define APIC_WAKEUP_VECTOR          0xF0
+
 /* ---------------------------------------------------------------------------
  * Type Definitions
  * --------------------------------------------------------------------------- */
@@ -139,8 +142,46 @@ typedef struct interrupt_frame {
  * ---------------------------------------------------------------------------
  * Callback function type for IRQ handlers.
  * The frame parameter provides access to the CPU state at interrupt time.
+ * Returns true if its device raised the interrupt; a line may be shared by
+ * several handlers, and every one of them is called.
  */
-typedef void (*irq_handler_t)(interrupt_frame_t *frame);
+typedef bool (*irq_handler_t)(interrupt_frame_t *frame);
+
+/*
+ * IRQ Handler Accounting
+ * ---------------------------------------------------------------------------
+ * Per registered handler, timed with the TSC around each call. A call that
+ * switched tasks (the timer's, when it preempts) includes another task's
+ * run time, so it is counted but not timed.
+ */
+#define IRQ_MAX_SHARED      4   /* Handlers per IRQ line */
+#define IRQ_LAT_BUCKETS     16  /* Bucket i: < 2^(i + 9) cycles; last: the rest */
+
+typedef struct irq_handler_stats {
+    const char *name;               /* Given at registration */
+    uint32_t calls;
+    uint32_t handled;               /* Calls that returned true */
+    uint32_t timed;                 /* Calls included in the times below */
+    uint64_t total_cycles;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint32_t avg_cycles;            /* Filled in by irq_get_handler_stats() */
+    uint32_t histogram[IRQ_LAT_BUCKETS];
+} irq_handler_stats_t;
+
+/* One handler's accounting as copied to user space (SYS_IRQSTAT) */
+typedef struct irq_handler_info {
+    uint32_t irq;
+    uint32_t calls;
+    uint32_t handled;
+    uint32_t timed;
+    uint32_t min_cycles;
+    uint32_t avg_cycles;
+    uint32_t max_cycles;
+    uint32_t unhandled;             /* Interrupts on the line no handler claimed */
+    uint32_t histogram[IRQ_LAT_BUCKETS];
+    char name[16];                  /* Truncated handler name */
+} irq_handler_info_t;
 
 /*
  * ISR Handler Function Pointer
@@ -149,6 +190,35 @@ typedef void (*irq_handler_t)(interrupt_frame_t *frame);
  */
 typedef void (*isr_handler_t)(interrupt_frame_t *frame);
 
+/*
+ * Softirq Numbers
+ * ---------------------------------------------------------------------------
+ * Pending bottom halves run lowest number first.
+ */
+#define SOFTIRQ_TIMER       0   /* Timer tick bookkeeping (sleep wheel) */
+#define SOFTIRQ_KEYBOARD    1   /* Scancode decoding */
+#define SOFTIRQ_TASKLET     2   /* Queued tasklets */
+#define SOFTIRQ_COUNT       8
+
+/*
+ * Softirq Handler Function Pointer
+ * ---------------------------------------------------------------------------
+ * Bottom halves run with interrupts enabled and must not block.
+ */
+typedef void (*softirq_handler_t)(void);
+
+/*
+ * Tasklet
+ * ---------------------------------------------------------------------------
+ * A deferred callback owned by the caller (usually a static in a driver).
+ */
+typedef struct tasklet {
+    struct tasklet *next;       /* Link in the pending list */
+    void (*func)(void *arg);    /* Callback */
+    void *arg;                  /* Callback argument */
+    bool scheduled;             /* Queued and not yet run */
+} tasklet_t;
+
 /* ---------------------------------------------------------------------------
  * IDT Functions (idt.c)
  * --------------------------------------------------------------------------- */
@@ -214,24 +284,27 @@ void isr_handler(interrupt_frame_t *frame);
 void irq_init(void);
 
 /*
- * irq_register_handler - Register an IRQ handler
+ * irq_register_handler - Add a handler to an IRQ line
  * ---------------------------------------------------------------------------
  * Parameters:
  *   irq     - IRQ number (0-15)
  *   handler - Function to call when IRQ occurs
+ *   name    - Device name for the statistics (kept, not copied)
  *
  * Returns:
- *   0 on success, -1 on error (invalid IRQ or handler already registered)
+ *   0 on success, -1 on error (invalid IRQ, handler already on the line,
+ *   or IRQ_MAX_SHARED handlers already registered)
  */
-int irq_register_handler(uint8_t irq, irq_handler_t handler);
+int irq_register_handler(uint8_t irq, irq_handler_t handler, const char *name);
 
 /*
- * irq_unregister_handler - Remove an IRQ handler
+ * irq_unregister_handler - Remove a handler from an IRQ line
  * ---------------------------------------------------------------------------
  * Parameters:
- *   irq - IRQ number (0-15)
+ *   irq     - IRQ number (0-15)
+ *   handler - Handler passed to irq_register_handler()
  */
-void irq_unregister_handler(uint8_t irq);
+void irq_unregister_handler(uint8_t irq, irq_handler_t handler);
 
 /*
  * irq_handler - Common IRQ handler called from assembly
@@ -277,6 +350,96 @@ bool irq_is_spurious(uint8_t irq);
  */
 uint32_t irq_get_count(uint8_t irq);
 
+/*
+ * irq_set_affinity - Deliver an IRQ to a specific CPU
+ * ---------------------------------------------------------------------------
+ * Only possible with the I/O APIC; the PIC always interrupts the boot CPU.
+ *
+ * Parameters:
+ *   irq - IRQ number (0-15)
+ *   cpu - Logical CPU number (smp.h), must be online
+ *
+ * Returns:
+ *   0 on success, -1 on error
+ */
+int irq_set_affinity(uint8_t irq, uint32_t cpu);
+
+/*
+ * irq_get_handler_stats - Accounting of one handler on a line
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   irq   - IRQ number (0-15)
+ *   index - Handler position on the line (registration order)
+ *   stats - Output
+ *
+ * Returns:
+ *   false once index is past the last handler
+ */
+bool irq_get_handler_stats(uint8_t irq, uint32_t index, irq_handler_stats_t *stats);
+
+/*
+ * irq_get_unhandled_count - Interrupts on a line no handler claimed
+ */
+uint32_t irq_get_unhandled_count(uint8_t irq);
+
+/* ---------------------------------------------------------------------------
+ * Softirq Functions (softirq.c)
+ * --------------------------------------------------------------------------- */
+
+/*
+ * softirq_init - Reset the softirq table
+ * ---------------------------------------------------------------------------
+ * Called by irq_init(), before any driver registers its handlers.
+ */
+void softirq_init(void);
+
+/*
+ * softirq_register - Install the bottom half for a softirq number
+ */
+void softirq_register(uint8_t nr, softirq_handler_t handler);
+
+/*
+ * softirq_raise - Mark a bottom half as pending
+ * ---------------------------------------------------------------------------
+ * Cheap and safe from top halves; raising a pending softirq is a no-op.
+ */
+void softirq_raise(uint8_t nr);
+
+/*
+ * softirq_run - Run pending bottom halves with interrupts enabled
+ * ---------------------------------------------------------------------------
+ * Called on IRQ exit and from the idle loop. Never nests.
+ */
+void softirq_run(void);
+
+/*
+ * softirq_in_progress - Check if bottom halves are currently running
+ */
+bool softirq_in_progress(void);
+
+/*
+ * softirq_has_pending - Check if any bottom half is waiting to run
+ */
+bool softirq_has_pending(void);
+
+/*
+ * softirq_get_count - Number of times a bottom half has run
+ */
+uint32_t softirq_get_count(uint8_t nr);
+
+/*
+ * tasklet_init - Prepare a tasklet for tasklet_schedule()
+ */
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *), void *arg);
+
+/*
+ * tasklet_schedule - Run a tasklet from the next softirq pass
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if queued, false if already pending
+ */
+bool tasklet_schedule(tasklet_t *tasklet);
+
 /* ---------------------------------------------------------------------------
  * PIC Functions (irq.c)
  * --------------------------------------------------------------------------- */
@@ -304,6 +467,66 @@ void pic_send_eoi(uint8_t irq);
  */
 void pic_disable(void);
 
+/* ---------------------------------------------------------------------------
+ * APIC Functions (apic.c)
+ * --------------------------------------------------------------------------- */
+
+/*
+ * apic_init - Take over interrupt delivery from the PIC
+ * ---------------------------------------------------------------------------
+ * Routes the ISA IRQs through the I/O APIC (masked) to the boot CPU.
+ * Called by irq_init(); the PIC stays in charge if it returns false.
+ */
+bool apic_init(void);
+
+/*
+ * apic_ap_init - Enable the calling CPU's local APIC (APs and apic_init)
+ */
+void apic_ap_init(void);
+
+/*
+ * apic_enabled - Whether the APICs deliver interrupts
+ */
+bool apic_enabled(void);
+
+/*
+ * apic_eoi - Acknowledge the interrupt in service (one MMIO store)
+ */
+void apic_eoi(void);
+
+/*
+ * ioapic_set_masked - Mask or unmask an ISA IRQ at the I/O APIC
+ */
+void ioapic_set_masked(uint8_t irq, bool masked);
+
+/*
+ * ioapic_set_destination - Deliver an ISA IRQ to another local APIC
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if rerouted, false without an I/O APIC line for irq
+ */
+bool ioapic_set_destination(uint8_t irq, uint8_t apic_id, bool masked);
+
+/*
+ * apic_get_spurious_count - LAPIC spurious interrupts taken
+ */
+uint32_t apic_get_spurious_count(void);
+
+/*
+ * lapic_timer_start - Arm the LAPIC timer on the IRQ0 vector
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   count    - Initial count in bus clocks / 16 (0 = stop)
+ *   periodic - Reload on expiry
+ *   masked   - Count without interrupting
+ */
+void lapic_timer_start(uint32_t count, bool periodic, bool masked);
+
+/*
+ * lapic_timer_remaining - Current LAPIC timer count
+ */
+uint32_t lapic_timer_remaining(void);
+
 /* ---------------------------------------------------------------------------
  * Utility Functions
  * --------------------------------------------------------------------------- */
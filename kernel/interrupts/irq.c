@@ -9,8 +9,13 @@
  * timer, keyboard, disk controllers, etc. It includes:
  *
  * 1. PIC (Programmable Interrupt Controller) initialization and control
- * 2. IRQ handler registration and dispatch
+ * 2. IRQ handler registration and dispatch (shared lines)
  * 3. Spurious interrupt detection
+ * 4. Per-handler time accounting
+ *
+ * When apic_init() succeeds (apic.c), the I/O APIC takes over masking and
+ * the local APIC takes EOIs; the vectors below stay the same, and the PIC
+ * code here is only the fallback.
  *
  * 8259 PIC Architecture:
  * ┌─────────────────────────────────────────────────────────────────────────┐
@@ -29,6 +34,16 @@
  * │  └─────────────────┘           └─────────────────┘                      │
  * └─────────────────────────────────────────────────────────────────────────┘
  *
+ * Shared Lines:
+ *   Each line has up to IRQ_MAX_SHARED handlers, called in registration
+ *   order; each says whether its device raised the interrupt. An interrupt
+ *   no handler claims is counted as unhandled for the line.
+ *
+ * Handler Accounting:
+ *   Every call is timed with clock_cycles() into the handler's min/max,
+ *   total and a log2 histogram (irq_get_handler_stats(); shell irqstat), so
+ *   the top half that eats interrupt time shows up directly.
+ *
  * PIC Remapping:
  *   By default, the BIOS maps IRQs 0-7 to vectors 0x08-0x0F, which conflicts
  *   with CPU exceptions. We remap them to vectors 0x20-0x2F (32-47).
@@ -37,6 +52,9 @@
  */
 
 #include "interrupts.h"
+#include "../scheduler/smp.h"
+#include "../scheduler/spinlock.h"
+#include "../utils/trace.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions (from startup.asm)
@@ -45,6 +63,9 @@ extern void outb(uint16_t port, uint8_t value);
 extern uint8_t inb(uint16_t port);
 extern void io_wait(void);
 
+/* TSC timestamps (from timer.c) */
+extern uint64_t clock_cycles(void);
+
 /* ---------------------------------------------------------------------------
  * PIC I/O Ports
  * --------------------------------------------------------------------------- */
@@ -79,8 +100,15 @@ extern void io_wait(void);
  * Static Variables
  * --------------------------------------------------------------------------- */
 
-/* Array of IRQ handler function pointers */
-static irq_handler_t irq_handlers[IRQ_COUNT] = { NULL };
+/* A handler on a line, with its accounting */
+typedef struct irq_action {
+    irq_handler_t handler;
+    irq_handler_stats_t stats;
+} irq_action_t;
+
+/* Handlers per line; irq_action_count[irq] slots are in use */
+static irq_action_t irq_actions[IRQ_COUNT][IRQ_MAX_SHARED];
+static uint8_t irq_action_count[IRQ_COUNT] = { 0 };
 
 /* IRQ mask (1 = disabled, 0 = enabled) */
 static uint16_t irq_mask = 0xFFFF;  /* All IRQs disabled initially */
@@ -88,6 +116,7 @@ static uint16_t irq_mask = 0xFFFF;  /* All IRQs disabled initially */
 /* Statistics for debugging */
 static uint32_t irq_counts[IRQ_COUNT] = { 0 };
 static uint32_t spurious_count = 0;
+static uint32_t unhandled_counts[IRQ_COUNT] = { 0 };
 
 /* ---------------------------------------------------------------------------
  * pic_init - Initialize and remap the 8259 PIC
@@ -235,6 +264,11 @@ void irq_enable(uint8_t irq)
 
     irq_mask &= ~(1 << irq);
 
+    if (apic_enabled()) {
+        ioapic_set_masked(irq, false);
+        return;
+    }
+
     if (irq < 8) {
         /* IRQ on master PIC */
         outb(PIC1_DATA, (uint8_t)(irq_mask & 0xFF));
@@ -263,6 +297,11 @@ void irq_disable(uint8_t irq)
 
     irq_mask |= (1 << irq);
 
+    if (apic_enabled()) {
+        ioapic_set_masked(irq, true);
+        return;
+    }
+
     if (irq < 8) {
         outb(PIC1_DATA, (uint8_t)(irq_mask & 0xFF));
     } else {
@@ -305,40 +344,127 @@ bool irq_is_spurious(uint8_t irq)
 }
 
 /* ---------------------------------------------------------------------------
- * irq_register_handler - Register an IRQ handler
+ * irq_register_handler - Add a handler to an IRQ line
  * ---------------------------------------------------------------------------
  * Parameters:
  *   irq     - IRQ number (0-15)
  *   handler - Function to call when IRQ occurs
+ *   name    - Device name for the statistics
  *
  * Returns:
  *   0 on success, -1 on error
  * --------------------------------------------------------------------------- */
-int irq_register_handler(uint8_t irq, irq_handler_t handler)
+int irq_register_handler(uint8_t irq, irq_handler_t handler, const char *name)
 {
-    if (irq >= IRQ_COUNT) {
+    if (irq >= IRQ_COUNT || handler == NULL) {
         return -1;  /* Invalid IRQ number */
     }
 
-    if (irq_handlers[irq] != NULL) {
-        return -1;  /* Handler already registered */
+    uint32_t flags = kernel_lock_irqsave();
+    uint8_t count = irq_action_count[irq];
+    for (uint8_t i = 0; i < count; i++) {
+        if (irq_actions[irq][i].handler == handler) {
+            kernel_unlock_irqrestore(flags);
+            return -1;  /* Handler already registered */
+        }
+    }
+    if (count == IRQ_MAX_SHARED) {
+        kernel_unlock_irqrestore(flags);
+        return -1;  /* Line full */
     }
 
-    irq_handlers[irq] = handler;
+    irq_action_t *action = &irq_actions[irq][count];
+    action->handler = handler;
+    action->stats = (irq_handler_stats_t){ 0 };
+    action->stats.name = (name != NULL) ? name : "?";
+    action->stats.min_cycles = 0xFFFFFFFFu;
+    irq_action_count[irq] = count + 1;
+
+    kernel_unlock_irqrestore(flags);
     return 0;
 }
 
 /* ---------------------------------------------------------------------------
- * irq_unregister_handler - Remove an IRQ handler
+ * irq_unregister_handler - Remove a handler from an IRQ line
  * ---------------------------------------------------------------------------
  * Parameters:
- *   irq - IRQ number (0-15)
+ *   irq     - IRQ number (0-15)
+ *   handler - Handler to remove (the others keep their order)
+ * --------------------------------------------------------------------------- */
+void irq_unregister_handler(uint8_t irq, irq_handler_t handler)
+{
+    if (irq >= IRQ_COUNT) {
+        return;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    uint8_t count = irq_action_count[irq];
+    for (uint8_t i = 0; i < count; i++) {
+        if (irq_actions[irq][i].handler == handler) {
+            for (uint8_t j = i + 1; j < count; j++) {
+                irq_actions[irq][j - 1] = irq_actions[irq][j];
+            }
+            irq_action_count[irq] = count - 1;
+            break;
+        }
+    }
+    kernel_unlock_irqrestore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * irq_account - Add one timed call to a handler's statistics
  * --------------------------------------------------------------------------- */
-void irq_unregister_handler(uint8_t irq)
+static void irq_account(irq_handler_stats_t *stats, uint32_t cycles)
 {
-    if (irq < IRQ_COUNT) {
-        irq_handlers[irq] = NULL;
+    stats->timed++;
+    stats->total_cycles += cycles;
+    if (cycles < stats->min_cycles) {
+        stats->min_cycles = cycles;
+    }
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+
+    /* Bucket by the highest set bit: < 512 cycles, < 1024, ... */
+    uint32_t bit;
+    __asm__("bsrl %1, %0" : "=r"(bit) : "rm"(cycles | 1));
+    uint32_t bucket = (bit < 9) ? 0 : bit - 8;
+    if (bucket >= IRQ_LAT_BUCKETS) {
+        bucket = IRQ_LAT_BUCKETS - 1;
+    }
+    stats->histogram[bucket]++;
+}
+
+/* ---------------------------------------------------------------------------
+ * irq_dispatch - Run every handler on a line
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if any handler claimed the interrupt
+ * --------------------------------------------------------------------------- */
+static bool irq_dispatch(uint8_t irq, interrupt_frame_t *frame)
+{
+    bool claimed = false;
+
+    for (uint8_t i = 0; i < irq_action_count[irq]; i++) {
+        irq_action_t *action = &irq_actions[irq][i];
+        cpu_local_t *cpu = smp_this_cpu();
+        uint32_t switches = cpu->context_switches;
+
+        uint64_t start = clock_cycles();
+        bool handled = action->handler(frame);
+        uint64_t cycles = clock_cycles() - start;
+
+        action->stats.calls++;
+        if (handled) {
+            action->stats.handled++;
+            claimed = true;
+        }
+        if (cpu->context_switches == switches) {
+            irq_account(&action->stats, (cycles >> 32) ? 0xFFFFFFFFu : (uint32_t)cycles);
+        }
     }
+
+    return claimed;
 }
 
 /* ---------------------------------------------------------------------------
@@ -369,11 +495,13 @@ void irq_handler(interrupt_frame_t *frame)
     /* -----------------------------------------------------------------------
      * Handle spurious interrupts
      * -----------------------------------------------------------------------
-     * Spurious IRQs can occur on IRQ7 and IRQ15. We must:
+     * Spurious IRQs can occur on IRQ7 and IRQ15 of the PIC. We must:
      * - NOT send EOI for spurious IRQ7
      * - Send EOI to master only for spurious IRQ15
+     * The local APIC reports its spurious interrupts on a vector of their
+     * own (apic.c), so nothing arriving here needs the ISR check.
      * ----------------------------------------------------------------------- */
-    if (irq == 7 || irq == 15) {
+    if ((irq == 7 || irq == 15) && !apic_enabled()) {
         if (irq_is_spurious(irq)) {
             spurious_count++;
             
@@ -388,6 +516,7 @@ void irq_handler(interrupt_frame_t *frame)
 
     /* Update statistics */
     irq_counts[irq]++;
+    TRACE(TRACE_IRQ_ENTER, irq, 0);
 
     /* 
      * Send End-Of-Interrupt to PIC BEFORE calling the handler.
@@ -396,12 +525,32 @@ void irq_handler(interrupt_frame_t *frame)
      * before switching, the PIC will block further interrupts until the
      * original task is eventually scheduled back and finishes this function.
      */
-    pic_send_eoi(irq);
+    if (apic_enabled()) {
+        apic_eoi();
+    } else {
+        pic_send_eoi(irq);
+    }
 
-    /* Call the registered handler */
-    if (irq_handlers[irq] != NULL) {
-        irq_handlers[irq](frame);
+    /*
+     * Call the registered handlers (top halves) under the kernel lock. The
+     * timer tick is the exception on every CPU: it only touches the tick
+     * count (BSP), the profiler (its own lock) and the scheduling state
+     * (sched_lock), so ticks never serialise on the kernel lock.
+     */
+    bool locked = (irq != IRQ0_TIMER);
+    if (locked) {
+        kernel_lock();
+    }
+    if (!irq_dispatch(irq, frame)) {
+        unhandled_counts[irq]++;
+    }
+    if (locked) {
+        kernel_unlock();
     }
+
+    /* Run whatever bottom halves the top halves raised */
+    softirq_run();
+    TRACE(TRACE_IRQ_EXIT, irq, 0);
 }
 
 /* ---------------------------------------------------------------------------
@@ -423,12 +572,79 @@ uint32_t irq_get_count(uint8_t irq)
     return irq_counts[irq];
 }
 
+/* ---------------------------------------------------------------------------
+ * irq_get_handler_stats - Accounting of one handler on a line
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   irq   - IRQ number (0-15)
+ *   index - Handler position on the line
+ *   stats - Output (a consistent snapshot)
+ *
+ * Returns:
+ *   false if there is no handler at index
+ * --------------------------------------------------------------------------- */
+bool irq_get_handler_stats(uint8_t irq, uint32_t index, irq_handler_stats_t *stats)
+{
+    if (irq >= IRQ_COUNT || stats == NULL) {
+        return false;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    bool found = index < irq_action_count[irq];
+    if (found) {
+        *stats = irq_actions[irq][index].stats;
+    }
+    kernel_unlock_irqrestore(flags);
+
+    /* The mean never exceeds max_cycles, so one 64/32 DIV cannot overflow */
+    stats->avg_cycles = 0;
+    if (found && stats->timed != 0) {
+        uint32_t rem;
+        __asm__("divl %4"
+                : "=a"(stats->avg_cycles), "=d"(rem)
+                : "a"((uint32_t)stats->total_cycles),
+                  "d"((uint32_t)(stats->total_cycles >> 32)), "rm"(stats->timed));
+    }
+    return found;
+}
+
+/* ---------------------------------------------------------------------------
+ * irq_get_unhandled_count - Interrupts on a line no handler claimed
+ * --------------------------------------------------------------------------- */
+uint32_t irq_get_unhandled_count(uint8_t irq)
+{
+    return (irq < IRQ_COUNT) ? unhandled_counts[irq] : 0;
+}
+
 /* ---------------------------------------------------------------------------
  * irq_get_spurious_count - Get the number of spurious interrupts
  * --------------------------------------------------------------------------- */
 uint32_t irq_get_spurious_count(void)
 {
-    return spurious_count;
+    return spurious_count + apic_get_spurious_count();
+}
+
+/* ---------------------------------------------------------------------------
+ * irq_set_affinity - Deliver an IRQ to a specific CPU
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   irq - IRQ number (0-15)
+ *   cpu - Logical CPU number
+ *
+ * Returns:
+ *   0 on success, -1 without an I/O APIC or for an offline CPU
+ * --------------------------------------------------------------------------- */
+int irq_set_affinity(uint8_t irq, uint32_t cpu)
+{
+    cpu_local_t *target = smp_get_cpu(cpu);
+    if (irq >= IRQ_COUNT || target == NULL || !target->online) {
+        return -1;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    bool ok = ioapic_set_destination(irq, target->apic_id, (irq_mask & (1 << irq)) != 0);
+    kernel_unlock_irqrestore(flags);
+    return ok ? 0 : -1;
 }
 
 /* ---------------------------------------------------------------------------
@@ -436,21 +652,27 @@ uint32_t irq_get_spurious_count(void)
  * ---------------------------------------------------------------------------
  * This function:
  * 1. Initializes and remaps the PIC
- * 2. Clears all IRQ handlers
- * 3. Masks all IRQs (drivers will enable them when they register)
+ * 2. Switches to the APICs where the machine has them
+ * 3. Clears all IRQ handlers
+ * 4. Masks all IRQs (drivers will enable them when they register)
  *
  * Must be called after idt_init() but before enabling interrupts.
  * --------------------------------------------------------------------------- */
 void irq_init(void)
 {
-    /* Initialize the PIC */
+    /* Initialize the PIC, then hand delivery to the APICs if present */
     pic_init();
+    apic_init();
 
     /* Clear all handlers */
     for (int i = 0; i < IRQ_COUNT; i++) {
-        irq_handlers[i] = NULL;
+        irq_action_count[i] = 0;
         irq_counts[i] = 0;
+        unhandled_counts[i] = 0;
     }
 
     spurious_count = 0;
+
+    /* Bottom halves must exist before any top half can raise one */
+    softirq_init();
 }
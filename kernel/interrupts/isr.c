@@ -32,11 +32,17 @@
  */
 
 #include "interrupts.h"
+#include "../utils/crashdump.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions
  * --------------------------------------------------------------------------- */
 extern void cpu_halt(void);     /* Halt CPU (from startup.asm) */
+extern bool task_fpu_handle_trap(void);  /* Lazy FPU switch (from task.c) */
+extern bool paging_handle_fault(uintptr_t addr, uint32_t error);  /* paging.c */
+extern void task_exit(int32_t exit_code);
+extern bool task_stack_guard_hit(uintptr_t addr);  /* task.c */
+extern void syscall_fault_state(interrupt_frame_t *frame);  /* syscall.c */
 
 /* ---------------------------------------------------------------------------
  * Exception Names Table
@@ -285,6 +291,33 @@ static void dump_page_fault_info(interrupt_frame_t *frame)
     }
     
     exc_print(")\n");
+
+    if (task_stack_guard_hit(cr2)) {
+        exc_print("    Kernel stack overflow (guard page)\n");
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * dump_double_fault_info - Display double fault specific information
+ * ---------------------------------------------------------------------------
+ * The usual cause is a #PF on a stack guard page: CR2 still holds it.
+ * --------------------------------------------------------------------------- */
+static void dump_double_fault_info(void)
+{
+    uint32_t cr2;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(cr2));
+
+    exc_set_color(VGA_COLOR_ADDR);
+    exc_print("\n  Double Fault Details:\n");
+    exc_set_color(VGA_COLOR_INFO);
+
+    exc_print("    Last Page Fault Address: ");
+    exc_print_hex(cr2);
+    exc_print("\n");
+
+    if (task_stack_guard_hit(cr2)) {
+        exc_print("    Kernel stack overflow (guard page)\n");
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -323,10 +356,11 @@ static void dump_gp_fault_info(interrupt_frame_t *frame)
  * default_exception_handler - Default handler for CPU exceptions
  * ---------------------------------------------------------------------------
  * This handler:
- * 1. Displays detailed exception information
- * 2. Dumps CPU register state
- * 3. Shows exception-specific details
- * 4. Halts the system
+ * 1. Saves a crash dump for the next boot
+ * 2. Displays detailed exception information
+ * 3. Dumps CPU register state
+ * 4. Shows exception-specific details
+ * 5. Halts the system
  *
  * This is called when no custom handler is registered for an exception.
  * --------------------------------------------------------------------------- */
@@ -334,6 +368,9 @@ static void default_exception_handler(interrupt_frame_t *frame)
 {
     uint32_t int_no = frame->int_no;
     
+    crashdump_capture(CRASHDUMP_EXCEPTION, NULL, 0,
+                      int_no < 32 ? exception_names[int_no] : "Unknown", frame);
+    
     /* Clear screen and display error header */
     exc_clear_screen();
     exc_set_color(VGA_COLOR_ERROR);
@@ -373,6 +410,8 @@ static void default_exception_handler(interrupt_frame_t *frame)
     /* Show exception-specific details */
     if (int_no == ISR_PAGE_FAULT) {
         dump_page_fault_info(frame);
+    } else if (int_no == ISR_DOUBLE_FAULT) {
+        dump_double_fault_info();
     } else if (int_no == ISR_GENERAL_PROTECTION) {
         dump_gp_fault_info(frame);
     }
@@ -390,6 +429,68 @@ static void default_exception_handler(interrupt_frame_t *frame)
     while (1) { }
 }
 
+/* ---------------------------------------------------------------------------
+ * device_not_available_handler - #NM handler for lazy FPU switching
+ * ---------------------------------------------------------------------------
+ * CR0.TS is set whenever a task that does not own the FPU is switched in.
+ * Its first FPU/SSE instruction faults here; the task code swaps the FPU
+ * state and the instruction is restarted. A #NM with no usable FPU is fatal.
+ * --------------------------------------------------------------------------- */
+static void device_not_available_handler(interrupt_frame_t *frame)
+{
+    if (!task_fpu_handle_trap()) {
+        default_exception_handler(frame);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * user_exception - Kill a ring 3 process that raised an exception
+ * ---------------------------------------------------------------------------
+ * A fault in user code is the process's problem, not the kernel's: it is
+ * terminated and the rest of the system keeps running.
+ * --------------------------------------------------------------------------- */
+static void user_exception(interrupt_frame_t *frame)
+{
+    if ((frame->cs & 3) != 3) {
+        default_exception_handler(frame);
+    }
+    task_exit(-1);
+}
+
+/* ---------------------------------------------------------------------------
+ * page_fault_handler - #PF handler for demand-zero and copy-on-write pages
+ * ---------------------------------------------------------------------------
+ * First touches of anonymous memory and writes to COW pages are resolved by
+ * paging_handle_fault and the instruction is restarted; any other fault is
+ * treated as an error.
+ * --------------------------------------------------------------------------- */
+static void page_fault_handler(interrupt_frame_t *frame)
+{
+    uint32_t cr2;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(cr2));
+
+    if (!paging_handle_fault(cr2, frame->err_code)) {
+        user_exception(frame);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * isr_double_fault_task - #DF handler, entered through a task gate
+ * ---------------------------------------------------------------------------
+ * Runs on the double-fault TSS's own stack (see syscall.c), so a fault on
+ * a stack guard page is reported instead of resetting the machine. The
+ * faulting registers are read back from the CPU's TSS. Never returns.
+ * --------------------------------------------------------------------------- */
+void isr_double_fault_task(void)
+{
+    __asm__ volatile("clts");   /* The task switch set CR0.TS */
+
+    interrupt_frame_t frame = { 0 };
+    syscall_fault_state(&frame);
+    frame.int_no = ISR_DOUBLE_FAULT;
+    default_exception_handler(&frame);
+}
+
 /* ---------------------------------------------------------------------------
  * isr_register_handler - Register a custom exception handler
  * ---------------------------------------------------------------------------
@@ -422,8 +523,8 @@ void isr_handler(interrupt_frame_t *frame)
         /* Call the custom handler */
         isr_handlers[int_no](frame);
     } else {
-        /* Use the default exception handler */
-        default_exception_handler(frame);
+        /* Use the default exception handler (user processes are killed) */
+        user_exception(frame);
     }
 }
 
@@ -444,11 +545,16 @@ void isr_init(void)
         isr_handlers[i] = NULL;
     }
     
+    /* Lazy FPU context switching */
+    isr_register_handler(ISR_DEVICE_NOT_AVAILABLE, device_not_available_handler);
+
+    /* Copy-on-write pages of forked processes */
+    isr_register_handler(ISR_PAGE_FAULT, page_fault_handler);
+    
     /*
      * Future enhancement: Register custom handlers for recoverable exceptions
      * 
      * Example:
-     *   isr_register_handler(ISR_PAGE_FAULT, page_fault_handler);
-     *   isr_register_handler(ISR_BREAKPOINT, breakpoint_handler);
+         *   isr_register_handler(ISR_BREAKPOINT, breakpoint_handler);
      */
 }
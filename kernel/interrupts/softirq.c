@@ -0,0 +1,260 @@
+/*
+ * ===========================================================================
+ * kernel/interrupts/softirq.c
+ * ===========================================================================
+ *
+ * Deferred Interrupt Work (Softirqs and Tasklets)
+ *
+ * IRQ handlers are split in two. The top half runs with interrupts disabled,
+ * acknowledges the device and raises a softirq. The bottom half runs later
+ * with interrupts enabled, straight after the outermost IRQ handler returns
+ * (or from the idle loop), and does the actual processing.
+ *
+ * Softirq Flow:
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │  IRQ n ──► top half ──► softirq_raise(nr) ──► pending |= 1 << nr         │
+ * │                                                                          │
+ * │  irq_handler() exit ──► softirq_run():                                   │
+ * │      snapshot pending, clear it, STI                                     │
+ * │      run every handler whose bit was set (lowest number first)           │
+ * │      CLI; repeat while new bits were raised (bounded by                  │
+ * │      SOFTIRQ_MAX_RESTART, leftovers wait for the next IRQ exit)          │
+ * │                                                                          │
+ * │  Raising an already-pending softirq is free, so a burst of interrupts    │
+ * │  is handled by a single bottom-half pass over the whole batch.           │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * Bottom halves never nest: an IRQ that arrives while they run only raises
+ * bits, which the running pass picks up on its next restart. They must not
+ * block. Work that needs to sleep goes to a work queue instead (see
+ * kernel/scheduler/workqueue.c).
+ *
+ * Tasklets are one-shot callbacks run from SOFTIRQ_TASKLET. Scheduling a
+ * tasklet that is already queued does nothing, so it runs once per batch.
+ *
+ * The pending mask and the running flag are updated atomically, so raising
+ * and running bottom halves never takes the kernel lock; only the tasklet
+ * list is still kept under it.
+ *
+ * ===========================================================================
+ */
+
+#include "interrupts.h"
+#include "../scheduler/spinlock.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+/* Passes over newly raised bits before yielding back to the interrupted code */
+#define SOFTIRQ_MAX_RESTART     8
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+/* Registered bottom halves */
+static softirq_handler_t softirq_handlers[SOFTIRQ_COUNT];
+
+/* Bit n set = softirq n raised and not yet run */
+static volatile uint32_t softirq_pending = 0;
+
+/* True while softirq_run() is executing handlers */
+static volatile bool softirq_active = false;
+
+/* Tasklet FIFO */
+static tasklet_t *tasklet_head = NULL;
+static tasklet_t *tasklet_tail = NULL;
+
+/* Statistics */
+static uint32_t softirq_counts[SOFTIRQ_COUNT];
+
+/* ---------------------------------------------------------------------------
+ * Tasklet Bottom Half
+ * --------------------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------------------
+ * tasklet_action - Run every tasklet queued so far
+ * ---------------------------------------------------------------------------
+ * The list is detached in one step so tasklets scheduled while it runs go
+ * into the next batch.
+ * --------------------------------------------------------------------------- */
+static void tasklet_action(void)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    tasklet_t *tasklet = tasklet_head;
+    tasklet_head = NULL;
+    tasklet_tail = NULL;
+    kernel_unlock_irqrestore(flags);
+
+    while (tasklet != NULL) {
+        tasklet_t *next = tasklet->next;
+
+        /* Clear first so the callback may reschedule itself */
+        tasklet->next = NULL;
+        tasklet->scheduled = false;
+        tasklet->func(tasklet->arg);
+
+        tasklet = next;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API
+ * --------------------------------------------------------------------------- */
+
+/* ---------------------------------------------------------------------------
+ * softirq_init - Reset the softirq table and install the tasklet handler
+ * --------------------------------------------------------------------------- */
+void softirq_init(void)
+{
+    for (uint32_t i = 0; i < SOFTIRQ_COUNT; i++) {
+        softirq_handlers[i] = NULL;
+        softirq_counts[i] = 0;
+    }
+    softirq_pending = 0;
+    softirq_active = false;
+    tasklet_head = NULL;
+    tasklet_tail = NULL;
+
+    softirq_register(SOFTIRQ_TASKLET, tasklet_action);
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_register - Install a bottom-half handler
+ * --------------------------------------------------------------------------- */
+void softirq_register(uint8_t nr, softirq_handler_t handler)
+{
+    if (nr < SOFTIRQ_COUNT) {
+        softirq_handlers[nr] = handler;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_raise - Mark a bottom half as pending
+ * ---------------------------------------------------------------------------
+ * Safe from any context. The handler runs at the next IRQ exit.
+ * --------------------------------------------------------------------------- */
+void softirq_raise(uint8_t nr)
+{
+    if (nr >= SOFTIRQ_COUNT) {
+        return;
+    }
+
+    __atomic_or_fetch(&softirq_pending, 1U << nr, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_run - Run pending bottom halves
+ * ---------------------------------------------------------------------------
+ * Called from irq_handler() on the way out and from the idle loop. Returns
+ * immediately if nothing is pending or a pass is already running further
+ * up the stack or on another CPU. Handlers run with interrupts enabled and
+ * without the kernel lock, taking whatever locks they need themselves; the
+ * caller's interrupt state is restored on return.
+ * --------------------------------------------------------------------------- */
+void softirq_run(void)
+{
+    if (softirq_pending == 0 || softirq_active) {
+        return;
+    }
+
+    uint32_t flags = interrupts_save_and_disable();
+    if (__atomic_exchange_n(&softirq_active, true, __ATOMIC_ACQUIRE)) {
+        interrupts_restore(flags);
+        return;
+    }
+
+    for (uint32_t pass = 0;
+         softirq_pending != 0 && pass < SOFTIRQ_MAX_RESTART; pass++) {
+        uint32_t pending = __atomic_exchange_n(&softirq_pending, 0, __ATOMIC_ACQ_REL);
+
+        interrupts_enable();
+        while (pending != 0) {
+            uint32_t nr = (uint32_t)__builtin_ctz(pending);
+            pending &= pending - 1;
+
+            if (softirq_handlers[nr] != NULL) {
+                softirq_handlers[nr]();
+                softirq_counts[nr]++;
+            }
+        }
+        interrupts_disable();
+    }
+
+    __atomic_store_n(&softirq_active, false, __ATOMIC_RELEASE);
+    interrupts_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_in_progress - Check if bottom halves are running
+ * ---------------------------------------------------------------------------
+ * The scheduler uses this to postpone preemption until the pass finishes.
+ * --------------------------------------------------------------------------- */
+bool softirq_in_progress(void)
+{
+    return softirq_active;
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_has_pending - Check if any bottom half is waiting to run
+ * --------------------------------------------------------------------------- */
+bool softirq_has_pending(void)
+{
+    return softirq_pending != 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * softirq_get_count - Number of times a bottom half has run
+ * --------------------------------------------------------------------------- */
+uint32_t softirq_get_count(uint8_t nr)
+{
+    return (nr < SOFTIRQ_COUNT) ? softirq_counts[nr] : 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * tasklet_init - Prepare a tasklet
+ * --------------------------------------------------------------------------- */
+void tasklet_init(tasklet_t *tasklet, void (*func)(void *), void *arg)
+{
+    if (tasklet == NULL) {
+        return;
+    }
+    tasklet->next = NULL;
+    tasklet->func = func;
+    tasklet->arg = arg;
+    tasklet->scheduled = false;
+}
+
+/* ---------------------------------------------------------------------------
+ * tasklet_schedule - Queue a tasklet to run from SOFTIRQ_TASKLET
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if queued, false if it was already queued (or invalid)
+ * --------------------------------------------------------------------------- */
+bool tasklet_schedule(tasklet_t *tasklet)
+{
+    if (tasklet == NULL || tasklet->func == NULL) {
+        return false;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    if (tasklet->scheduled) {
+        kernel_unlock_irqrestore(flags);
+        return false;
+    }
+
+    tasklet->scheduled = true;
+    tasklet->next = NULL;
+    if (tasklet_tail != NULL) {
+        tasklet_tail->next = tasklet;
+    } else {
+        tasklet_head = tasklet;
+    }
+    tasklet_tail = tasklet;
+    kernel_unlock_irqrestore(flags);
+
+    softirq_raise(SOFTIRQ_TASKLET);
+
+    return true;
+}
@@ -0,0 +1,494 @@
+/*
+ * ===========================================================================
+ * kernel/io_ring.c
+ * ===========================================================================
+ *
+ * Batched System Call Rings (SYS_IORING)
+ *
+ * A task that makes many small read/write/message calls pays the kernel
+ * entry cost for every one of them. An I/O ring lets it queue the requests
+ * in memory it shares with the kernel and hand over the whole batch with a
+ * single IORING_ENTER; the results come back the same way.
+ *
+ * Ring Layout (one page-aligned run, mapped into the task's mmap window):
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │ io_ring_shared_t     sizes, offsets, and the four ring indices           │
+ * │ io_sqe_t[sq_entries] submission queue: task fills, kernel consumes       │
+ * │ io_cqe_t[cq_entries] completion queue: kernel fills, task consumes       │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ *   The indices run freely and are masked with (entries - 1). The task only
+ *   writes sq_tail and cq_head; the kernel keeps its own copies of sq_head
+ *   and cq_tail and only publishes them. The sizes and offsets in the
+ *   header are for the task: the kernel keeps its own copy from setup and
+ *   never reads them back, so a scribbled header can not make it read or
+ *   write outside the ring.
+ *
+ * Asynchronous Requests:
+ *   Requests that can not finish yet (a sleep, a receive on an empty queue,
+ *   a send to a full one) are copied to the ring's pending list and retried
+ *   on every later IORING_ENTER, so a task can keep them outstanding while
+ *   it does other work. An entry that asks for completions waits for them
+ *   a tick at a time, retrying the pending list as it goes. Everything runs
+ *   in the submitting task, so user buffers are always addressed in the
+ *   address space (and descriptor table) they were submitted from.
+ *
+ *   The CQ has twice as many entries as the SQ and a request is only taken
+ *   from the SQ while the CQ has room for it and everything still pending,
+ *   so completions are never dropped.
+ *
+ * ===========================================================================
+ */
+
+#include "../config/os_config.h"
+#include "memory/memory.h"
+#include "drivers/drivers.h"
+#include "scheduler/task.h"
+#include "fs/vfs.h"
+
+/* ---------------------------------------------------------------------------
+ * External Function Declarations
+ * --------------------------------------------------------------------------- */
+
+extern void *memset(void *s, int c, size_t n);
+
+/* Console output (kernel/syscall.c) */
+extern void console_write(int fd, const char *buffer, size_t count);
+
+/* Message queues (kernel/ipc/message_queue.c) */
+extern int msgq_send(int qid, const void *data, size_t size, uint32_t type);
+extern ssize_t msgq_receive(int qid, void *buffer, size_t size, uint32_t type);
+extern int msgq_peek(int qid);
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+#define IORING_MAX_RINGS    16          /* Rings in the whole system */
+#define IORING_MAX_ENTRIES  256         /* Largest SQ (power of two) */
+#define IORING_MAGIC        0x474E5249u /* "IRNG" */
+
+#define IORING_MSG_MAX      256         /* Largest message (MAX_MSG_SIZE) */
+
+/* Request opcodes (io_sqe_t.opcode) */
+#define IORING_OP_NOP           0       /* Complete with 0 */
+#define IORING_OP_READ          1       /* fd, addr, len, offset */
+#define IORING_OP_WRITE         2       /* fd, addr, len, offset */
+#define IORING_OP_MSGQ_SEND     3       /* fd = qid, addr, len, arg = type */
+#define IORING_OP_MSGQ_RECEIVE  4       /* fd = qid, addr, len, arg = type */
+#define IORING_OP_SLEEP         5       /* timeout = ticks */
+
+/* io_sqe_t.offset for READ/WRITE: use (and advance) the file position */
+#define IORING_OFFSET_CURRENT   0xFFFFFFFFu
+
+/* io_sqe_t.timeout for message requests */
+#define IORING_NO_WAIT          0
+#define IORING_WAIT_FOREVER     0xFFFFFFFFu
+
+/* ---------------------------------------------------------------------------
+ * Shared Structures (must match userland/lib/syscall_wrappers.c)
+ * --------------------------------------------------------------------------- */
+typedef struct io_sqe {
+    uint8_t opcode;                     /* IORING_OP_* */
+    uint8_t flags;                      /* Reserved, 0 */
+    uint16_t reserved;
+    int32_t fd;                         /* Descriptor or queue ID */
+    uint32_t addr;                      /* Buffer */
+    uint32_t len;                       /* Buffer length */
+    uint32_t offset;                    /* File offset or IORING_OFFSET_CURRENT */
+    uint32_t arg;                       /* Message type */
+    uint32_t timeout;                   /* Ticks to keep trying */
+    uint32_t user_data;                 /* Copied to the completion */
+} io_sqe_t;
+
+typedef struct io_cqe {
+    uint32_t user_data;                 /* From the request */
+    int32_t result;                     /* What the plain call would return */
+} io_cqe_t;
+
+typedef struct io_ring_shared {
+    uint32_t magic;                     /* IORING_MAGIC */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sqe_offset;                /* From the start of the ring */
+    uint32_t cqe_offset;
+    volatile uint32_t sq_head;          /* Kernel: next request to take */
+    volatile uint32_t sq_tail;          /* Task: next free request slot */
+    volatile uint32_t cq_head;          /* Task: next completion to read */
+    volatile uint32_t cq_tail;          /* Kernel: next free completion slot */
+} io_ring_shared_t;
+
+/* ---------------------------------------------------------------------------
+ * Kernel Ring State
+ * --------------------------------------------------------------------------- */
+typedef struct io_ring_pending {
+    io_sqe_t sqe;                       /* Kernel copy of the request */
+    uint32_t deadline;                  /* Tick when it gives up */
+} io_ring_pending_t;
+
+typedef struct io_ring {
+    bool valid;
+    io_ring_shared_t *shared;           /* Kernel view of the frames */
+    uintptr_t user_addr;                /* Where the task sees them */
+    address_space_t *as;                /* NULL when paging is off */
+    size_t pages;
+    io_sqe_t *sqes;                     /* Geometry from setup; the copy */
+    io_cqe_t *cqes;                     /* in the shared page is never read */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_head;                   /* Authoritative indices */
+    uint32_t cq_tail;
+    io_ring_pending_t *pending;         /* sq_entries slots */
+    uint32_t pending_count;
+} io_ring_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+static io_ring_t rings[IORING_MAX_RINGS];
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * --------------------------------------------------------------------------- */
+
+static void ring_free(io_ring_t *ring)
+{
+    frame_free_contiguous((uintptr_t)ring->shared, ring->pages);
+    kfree(ring->pending);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/* vm_release_t: the mapping went away (destroy or address space teardown) */
+static void ring_area_release(void *owner)
+{
+    ring_free((io_ring_t *)owner);
+}
+
+static io_ring_t *ring_lookup(uintptr_t user_addr)
+{
+    address_space_t *as = address_space_current(false);
+    for (size_t i = 0; i < IORING_MAX_RINGS; i++) {
+        if (rings[i].valid && rings[i].user_addr == user_addr && rings[i].as == as) {
+            return &rings[i];
+        }
+    }
+    return NULL;
+}
+
+/* Completions the task has not read yet (a corrupt cq_head counts as full) */
+static uint32_t ring_cq_ready(io_ring_t *ring)
+{
+    uint32_t ready = ring->cq_tail - ring->shared->cq_head;
+    return (ready > ring->cq_entries) ? ring->cq_entries : ready;
+}
+
+static void ring_complete(io_ring_t *ring, uint32_t user_data, int32_t result)
+{
+    io_cqe_t *cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+    cqe->user_data = user_data;
+    cqe->result = result;
+    ring->cq_tail++;
+    __atomic_store_n(&ring->shared->cq_tail, ring->cq_tail, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------------------
+ * ring_execute - Try one request
+ * ---------------------------------------------------------------------------
+ * The buffer of a ring in a user address space is checked like a system
+ * call argument (user_access_ok) every time the request is tried.
+ *
+ * Returns:
+ *   true with *result set when the request is finished, false if it has to
+ *   stay pending (only for requests that can wait)
+ * --------------------------------------------------------------------------- */
+static bool ring_buffer_ok(const io_ring_t *ring, const io_sqe_t *sqe)
+{
+    bool write;
+    switch (sqe->opcode) {
+    case IORING_OP_READ:
+    case IORING_OP_MSGQ_RECEIVE:
+        write = true;
+        break;
+    case IORING_OP_WRITE:
+    case IORING_OP_MSGQ_SEND:
+        write = false;
+        break;
+    default:
+        return true;  /* No buffer */
+    }
+    if (ring->as == NULL || sqe->addr == 0) {
+        return true;  /* Kernel ring, or a NULL the operation itself refuses */
+    }
+    return user_access_ok((const void *)(uintptr_t)sqe->addr, sqe->len, write);
+}
+
+static bool ring_execute(const io_ring_t *ring, const io_sqe_t *sqe, bool expired,
+                         int32_t *result)
+{
+    void *buffer = (void *)(uintptr_t)sqe->addr;
+    int fd = sqe->fd;
+
+    if (!ring_buffer_ok(ring, sqe)) {
+        *result = -1;  /* EFAULT */
+        return true;
+    }
+
+    switch (sqe->opcode) {
+    case IORING_OP_NOP:
+        *result = 0;
+        return true;
+
+    case IORING_OP_READ:
+        /* Console input is line-based and blocking: only plain read() */
+        if (buffer == NULL || fd <= 2) {
+            *result = -1;
+        } else if (sqe->offset == IORING_OFFSET_CURRENT) {
+            *result = (int32_t)vfs_read(fd, buffer, sqe->len);
+        } else {
+            *result = (int32_t)vfs_pread(fd, buffer, sqe->len, sqe->offset);
+        }
+        return true;
+
+    case IORING_OP_WRITE:
+        if (buffer == NULL || fd == 0) {
+            *result = -1;
+        } else if (fd <= 2) {
+            console_write(fd, (const char *)buffer, sqe->len);
+            *result = (int32_t)sqe->len;
+        } else if (sqe->offset == IORING_OFFSET_CURRENT) {
+            *result = (int32_t)vfs_write(fd, buffer, sqe->len);
+        } else {
+            *result = (int32_t)vfs_pwrite(fd, buffer, sqe->len, sqe->offset);
+        }
+        return true;
+
+    case IORING_OP_MSGQ_SEND:
+        if (buffer == NULL || sqe->len == 0 || sqe->len > IORING_MSG_MAX ||
+            msgq_peek(fd) < 0) {
+            *result = -1;
+            return true;
+        }
+        /* With valid arguments the only failure left is a full queue */
+        if (msgq_send(fd, buffer, sqe->len, sqe->arg) == 0) {
+            *result = 0;
+            return true;
+        }
+        *result = -1;
+        return expired;
+
+    case IORING_OP_MSGQ_RECEIVE:
+        *result = (int32_t)msgq_receive(fd, buffer, sqe->len, sqe->arg);
+        return *result != 0 || expired;
+
+    case IORING_OP_SLEEP:
+        *result = 0;
+        return expired;
+
+    default:
+        *result = -1;
+        return true;
+    }
+}
+
+/* Time is up for a request with this deadline (WAIT_FOREVER never is) */
+static bool ring_expired(const io_sqe_t *sqe, uint32_t deadline)
+{
+    if (sqe->timeout == IORING_WAIT_FOREVER) {
+        return false;
+    }
+    return (int32_t)(pit_get_ticks() - deadline) >= 0;
+}
+
+/* Retry the pending list, keeping the survivors in submission order */
+static void ring_retry_pending(io_ring_t *ring)
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < ring->pending_count; i++) {
+        io_ring_pending_t *entry = &ring->pending[i];
+        int32_t result;
+        if (ring_execute(ring, &entry->sqe, ring_expired(&entry->sqe, entry->deadline), &result)) {
+            ring_complete(ring, entry->sqe.user_data, result);
+        } else {
+            ring->pending[kept++] = *entry;
+        }
+    }
+    ring->pending_count = kept;
+}
+
+/* Take requests from the SQ; returns how many were consumed */
+static uint32_t ring_submit(io_ring_t *ring)
+{
+    io_ring_shared_t *shared = ring->shared;
+    uint32_t tail = __atomic_load_n(&shared->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t available = tail - ring->sq_head;
+    if (available > ring->sq_entries) {
+        available = 0;  /* Corrupt tail: take nothing */
+    }
+
+    uint32_t consumed = 0;
+    while (consumed < available &&
+           ring_cq_ready(ring) + ring->pending_count < ring->cq_entries &&
+           ring->pending_count < ring->sq_entries) {
+        /* Copy first: the task may rewrite the slot once sq_head moves */
+        io_sqe_t sqe = ring->sqes[ring->sq_head & (ring->sq_entries - 1)];
+        ring->sq_head++;
+        consumed++;
+
+        uint32_t deadline = pit_get_ticks() + sqe.timeout;
+        int32_t result;
+        if (ring_execute(ring, &sqe, sqe.timeout == IORING_NO_WAIT, &result)) {
+            ring_complete(ring, sqe.user_data, result);
+        } else {
+            ring->pending[ring->pending_count].sqe = sqe;
+            ring->pending[ring->pending_count].deadline = deadline;
+            ring->pending_count++;
+        }
+    }
+
+    __atomic_store_n(&shared->sq_head, ring->sq_head, __ATOMIC_RELEASE);
+    return consumed;
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_setup - Create a ring and map it into the calling task
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   entries - SQ size (power of two, 1..IORING_MAX_ENTRIES)
+ *
+ * Returns:
+ *   Address of the ring (io_ring_shared_t) on success, 0 on error
+ * --------------------------------------------------------------------------- */
+uintptr_t io_ring_setup(uint32_t entries)
+{
+    if (entries == 0 || entries > IORING_MAX_ENTRIES || (entries & (entries - 1)) != 0) {
+        return 0;
+    }
+
+    io_ring_t *ring = NULL;
+    for (size_t i = 0; i < IORING_MAX_RINGS; i++) {
+        if (!rings[i].valid) {
+            ring = &rings[i];
+            break;
+        }
+    }
+    if (ring == NULL) {
+        return 0;
+    }
+
+    size_t sqe_offset = ALIGN_UP(sizeof(io_ring_shared_t), 32);
+    size_t cqe_offset = sqe_offset + entries * sizeof(io_sqe_t);
+    size_t size = ALIGN_UP(cqe_offset + 2 * entries * sizeof(io_cqe_t), PAGE_SIZE);
+    size_t pages = size / PAGE_SIZE;
+
+    uintptr_t frames = frame_alloc_contiguous(pages);
+    if (frames == 0) {
+        return 0;
+    }
+    io_ring_pending_t *pending = kmalloc(entries * sizeof(io_ring_pending_t));
+    if (pending == NULL) {
+        frame_free_contiguous(frames, pages);
+        return 0;
+    }
+
+    io_ring_shared_t *shared = (io_ring_shared_t *)frames;
+    memset(shared, 0, size);
+    shared->magic = IORING_MAGIC;
+    shared->sq_entries = entries;
+    shared->cq_entries = 2 * entries;
+    shared->sqe_offset = sqe_offset;
+    shared->cqe_offset = cqe_offset;
+
+    ring->shared = shared;
+    ring->sqes = (io_sqe_t *)(frames + sqe_offset);
+    ring->cqes = (io_cqe_t *)(frames + cqe_offset);
+    ring->sq_entries = entries;
+    ring->cq_entries = 2 * entries;
+    ring->pages = pages;
+    ring->pending = pending;
+    ring->pending_count = 0;
+    ring->sq_head = 0;
+    ring->cq_tail = 0;
+
+    /* Map it like a shared memory attachment; without paging use it directly */
+    address_space_t *as = address_space_current(true);
+    uintptr_t user_addr = frames;
+    if (as != NULL) {
+        user_addr = vm_area_reserve(as, size, ring_area_release, ring);
+        if (user_addr == 0) {
+            ring_free(ring);
+            return 0;
+        }
+    }
+    ring->valid = true;
+    ring->user_addr = user_addr;
+    ring->as = as;
+
+    if (as != NULL) {
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            if (!paging_map(as, user_addr + offset, frames + offset,
+                            PAGE_USER | PAGE_WRITABLE)) {
+                vm_area_release(as, user_addr, 0);  /* Frees the ring */
+                return 0;
+            }
+        }
+    }
+
+    return user_addr;
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_enter - Submit queued requests and optionally wait for results
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   user_addr    - Ring address returned by io_ring_setup()
+ *   min_complete - Return once this many completions are unread
+ *   timeout      - Ticks to wait for them at most (IORING_WAIT_FOREVER)
+ *
+ * Returns:
+ *   Number of requests taken from the SQ, or -1 if the ring is unknown
+ *
+ * The wait also ends early when nothing is pending any more, since no
+ * further completion could arrive.
+ * --------------------------------------------------------------------------- */
+int io_ring_enter(uintptr_t user_addr, uint32_t min_complete, uint32_t timeout)
+{
+    io_ring_t *ring = ring_lookup(user_addr);
+    if (ring == NULL) {
+        return -1;
+    }
+
+    ring_retry_pending(ring);
+    uint32_t consumed = ring_submit(ring);
+
+    uint32_t start = pit_get_ticks();
+    while (ring_cq_ready(ring) < min_complete && ring->pending_count > 0) {
+        if (timeout != IORING_WAIT_FOREVER && pit_get_ticks() - start >= timeout) {
+            break;
+        }
+        task_sleep(1);
+        ring_retry_pending(ring);
+        consumed += ring_submit(ring);  /* Room may have opened in the CQ */
+    }
+
+    return (int)consumed;
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_destroy - Unmap a ring; pending requests are dropped
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   0 on success, -1 if the ring is unknown
+ * --------------------------------------------------------------------------- */
+int io_ring_destroy(uintptr_t user_addr)
+{
+    io_ring_t *ring = ring_lookup(user_addr);
+    if (ring == NULL) {
+        return -1;
+    }
+
+    if (ring->as != NULL) {
+        vm_area_release(ring->as, ring->user_addr, 0);  /* Frees the ring */
+    } else {
+        ring_free(ring);
+    }
+    return 0;
+}
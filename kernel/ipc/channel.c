@@ -0,0 +1,377 @@
+/*
+ * ===========================================================================
+ * kernel/ipc/channel.c
+ * ===========================================================================
+ *
+ * IPC Ring Channels
+ *
+ * This file implements a lock-free channel for high-rate producer/consumer
+ * pipelines. The whole channel - indices and message slots - lives in a
+ * shared memory region, so any task that has it attached can send and
+ * receive with plain loads and stores. The kernel is only entered to sleep
+ * when the ring is empty (receiver) or full (sender), and to wake a sleeper.
+ *
+ * Features:
+ * - Power-of-two ring of fixed-size slots in a shm_create() region
+ * - Single producer (SPSC) or multiple producers (MPSC), one consumer
+ * - Acquire/release ordering only; no locks on the fast path
+ * - Futex wait/wake on the slot words for the slow path
+ *
+ * Layout (offsets from the start of the region):
+ * ┌──────────────────────────────────────────────────────────────┐
+ * │ line 0: magic, flags, slot_count, slot_size   (read-only)    │
+ * │ line 1: tail, tx_waiters                       (producers)   │
+ * │ line 2: head, rx_waiters                       (consumer)    │
+ * │ slot[0] .. slot[slot_count - 1]: seq, size, data             │
+ * └──────────────────────────────────────────────────────────────┘
+ *   Producer and consumer indices sit on their own cache lines so the two
+ *   sides do not keep stealing each other's line.
+ *
+ * Slot sequence numbers:
+ *   Positions count up forever; slot (pos & mask) serves position pos.
+ *   seq == pos                  - free for the producer of pos
+ *   seq == pos + 1              - holds the message of pos
+ *   seq == pos + slot_count     - consumed, free for the next lap
+ *   A producer claims a position by advancing tail (a compare-and-swap
+ *   when there may be several producers), fills the slot and publishes it
+ *   with a release store of seq; the consumer reads seq with acquire. The
+ *   seq word is also what a blocked side sleeps on.
+ *
+ * Blocking:
+ *   A side that has to wait bumps its waiter count, rechecks the slot and
+ *   sleeps on the slot's seq word; futex_wait() sleeps only if the word
+ *   still holds the value seen, so a publish between the check and the
+ *   sleep is never lost. The other side calls futex_wake() only when the
+ *   waiter count is non-zero. Futexes are keyed by physical address, so
+ *   tasks that attach the region at different addresses still meet.
+ *
+ * ===========================================================================
+ */
+
+#include "../../config/os_config.h"
+#include "../memory/memory.h"
+#include "../drivers/drivers.h"
+
+/* ---------------------------------------------------------------------------
+ * External Functions
+ * --------------------------------------------------------------------------- */
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/* Shared memory (kernel/ipc/shared_memory.c) */
+extern int shm_create(uint32_t key, size_t size);
+extern int shm_get(uint32_t key);
+extern void *shm_attach(int shm_id, void *addr);
+extern int shm_detach(void *addr);
+extern int shm_destroy(int shm_id);
+
+/* Futexes (kernel/ipc/futex.c) */
+extern int futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout);
+extern int futex_wake(volatile uint32_t *addr, uint32_t count);
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+#define CHANNEL_MAGIC           0x4E414843u /* "CHAN" little-endian */
+#define CHANNEL_CACHE_LINE      64
+#define CHANNEL_MAX_SLOTS       4096
+#define CHANNEL_MAX_SLOT_SIZE   4096
+
+/* channel_create() flags */
+#define CHANNEL_SPSC            (1 << 0)    /* Exactly one producer */
+
+/* Timeout values (in timer ticks) */
+#define CHANNEL_NO_WAIT         0
+#define CHANNEL_WAIT_FOREVER    0xFFFFFFFFu
+
+/* ---------------------------------------------------------------------------
+ * Channel Structures (shared memory layout)
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    volatile uint32_t seq;              /* See "Slot sequence numbers" */
+    uint32_t size;                      /* Message bytes */
+    uint8_t data[];                     /* slot_size bytes */
+} channel_slot_t;
+
+typedef struct channel {
+    /* Set once by channel_create() */
+    uint32_t magic;
+    uint32_t flags;                     /* CHANNEL_* */
+    uint32_t slot_count;                /* Power of two */
+    uint32_t slot_size;                 /* Largest message */
+    uint32_t slot_stride;               /* Bytes per slot */
+    uint8_t pad0[CHANNEL_CACHE_LINE - 5 * sizeof(uint32_t)];
+
+    /* Producer side */
+    volatile uint32_t tail;             /* Next position to claim */
+    volatile uint32_t tx_waiters;       /* Producers sleeping on a full ring */
+    uint8_t pad1[CHANNEL_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    /* Consumer side */
+    volatile uint32_t head;             /* Next position to read */
+    volatile uint32_t rx_waiters;       /* Consumer sleeping on an empty ring */
+    uint8_t pad2[CHANNEL_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    uint8_t slots[];
+} channel_t;
+
+/* ---------------------------------------------------------------------------
+ * Ring Helpers
+ * --------------------------------------------------------------------------- */
+
+static inline channel_slot_t *channel_slot(channel_t *ch, uint32_t pos)
+{
+    return (channel_slot_t *)(ch->slots + (size_t)(pos & (ch->slot_count - 1)) * ch->slot_stride);
+}
+
+/* Wake the other side if it announced that it is sleeping */
+static inline void channel_kick(volatile uint32_t *waiters, volatile uint32_t *word,
+                                uint32_t count)
+{
+    /* Order the seq store before the waiter check (pairs with channel_block) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_RELAXED) != 0) {
+        futex_wake(word, count);
+    }
+}
+
+/* Sleep on a slot until its seq moves away from 'seen'; false on timeout */
+static bool channel_block(volatile uint32_t *waiters, channel_slot_t *slot, uint32_t seen,
+                          uint32_t timeout, uint32_t deadline)
+{
+    uint32_t ticks = timeout;
+    if (timeout != CHANNEL_WAIT_FOREVER) {
+        int32_t left = (int32_t)(deadline - pit_get_ticks());
+        if (left <= 0) {
+            return false;
+        }
+        ticks = (uint32_t)left;
+    }
+
+    __atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+    bool ok = true;
+    if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == seen) {
+        ok = (futex_wait(&slot->seq, seen, ticks) == 0);
+    }
+    __atomic_sub_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+    return ok;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_create - Create a channel in a new shared memory region
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   key        - Shared memory key for the region
+ *   slot_size  - Largest message in bytes
+ *   slot_count - Ring slots (power of two)
+ *   flags      - CHANNEL_SPSC if there will only ever be one producer
+ *
+ * Returns:
+ *   The channel, attached for the caller, or NULL on error (also if the
+ *   key is already in use)
+ * --------------------------------------------------------------------------- */
+channel_t *channel_create(uint32_t key, size_t slot_size, uint32_t slot_count, uint32_t flags)
+{
+    if (slot_size == 0 || slot_size > CHANNEL_MAX_SLOT_SIZE ||
+        slot_count < 2 || slot_count > CHANNEL_MAX_SLOTS ||
+        (slot_count & (slot_count - 1)) != 0) {
+        return NULL;
+    }
+    if (shm_get(key) >= 0) {
+        return NULL;
+    }
+
+    size_t stride = ALIGN_UP(sizeof(channel_slot_t) + slot_size, sizeof(uint32_t));
+    size_t size = sizeof(channel_t) + slot_count * stride;
+    int shm_id = shm_create(key, size);
+    if (shm_id < 0) {
+        return NULL;
+    }
+    channel_t *ch = (channel_t *)shm_attach(shm_id, NULL);
+    if (ch == NULL) {
+        shm_destroy(shm_id);
+        return NULL;
+    }
+
+    /* The region comes zeroed; only the non-zero fields need setting */
+    ch->flags = flags;
+    ch->slot_count = slot_count;
+    ch->slot_size = (uint32_t)slot_size;
+    ch->slot_stride = (uint32_t)stride;
+    for (uint32_t pos = 0; pos < slot_count; pos++) {
+        channel_slot(ch, pos)->seq = pos;
+    }
+    __atomic_store_n(&ch->magic, CHANNEL_MAGIC, __ATOMIC_RELEASE);
+    return ch;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_open - Attach to an existing channel
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   The channel, or NULL if the key has no channel
+ * --------------------------------------------------------------------------- */
+channel_t *channel_open(uint32_t key)
+{
+    int shm_id = shm_get(key);
+    if (shm_id < 0) {
+        return NULL;
+    }
+
+    channel_t *ch = (channel_t *)shm_attach(shm_id, NULL);
+    if (ch == NULL) {
+        return NULL;
+    }
+    if (__atomic_load_n(&ch->magic, __ATOMIC_ACQUIRE) != CHANNEL_MAGIC) {
+        shm_detach(ch);
+        return NULL;
+    }
+    return ch;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_close - Detach from a channel
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+int channel_close(channel_t *ch)
+{
+    return (ch != NULL) ? shm_detach(ch) : -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_try_send - Send a message if a slot is free
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true on success, false if the ring is full or the message is too big
+ * --------------------------------------------------------------------------- */
+bool channel_try_send(channel_t *ch, const void *data, size_t size)
+{
+    if (ch == NULL || data == NULL || size == 0 || size > ch->slot_size) {
+        return false;
+    }
+
+    uint32_t pos = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+    channel_slot_t *slot;
+    for (;;) {
+        slot = channel_slot(ch, pos);
+        int32_t dif = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (ch->flags & CHANNEL_SPSC) {
+                __atomic_store_n(&ch->tail, pos + 1, __ATOMIC_RELAXED);
+                break;
+            }
+            /* On failure pos is reloaded with the current tail */
+            if (__atomic_compare_exchange_n(&ch->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return false;   /* Slot still holds last lap's message */
+        } else {
+            pos = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(slot->data, data, size);
+    slot->size = (uint32_t)size;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    channel_kick(&ch->rx_waiters, &slot->seq, 1);           /* One consumer */
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_try_receive - Receive a message if one is ready
+ * ---------------------------------------------------------------------------
+ * Only one task may receive from a channel.
+ *
+ * Returns:
+ *   Message size (> 0, cut to 'size'), 0 if the ring is empty, -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t channel_try_receive(channel_t *ch, void *buffer, size_t size)
+{
+    if (ch == NULL || buffer == NULL || size == 0) {
+        return -1;
+    }
+
+    uint32_t pos = ch->head;
+    channel_slot_t *slot = channel_slot(ch, pos);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+        return 0;
+    }
+
+    size_t copy_size = (slot->size < size) ? slot->size : size;
+    memcpy(buffer, slot->data, copy_size);
+    __atomic_store_n(&ch->head, pos + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, pos + ch->slot_count, __ATOMIC_RELEASE);
+
+    channel_kick(&ch->tx_waiters, &slot->seq, 0xFFFFFFFFu); /* Any producers */
+    return (ssize_t)copy_size;
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_send - Send a message, sleeping while the ring is full
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   timeout - Ticks to wait for a slot (CHANNEL_NO_WAIT, CHANNEL_WAIT_FOREVER)
+ *
+ * Returns:
+ *   0 on success, -1 on error or timeout
+ * --------------------------------------------------------------------------- */
+int channel_send(channel_t *ch, const void *data, size_t size, uint32_t timeout)
+{
+    uint32_t deadline = pit_get_ticks() + timeout;
+
+    for (;;) {
+        if (channel_try_send(ch, data, size)) {
+            return 0;
+        }
+        if (ch == NULL || data == NULL || size == 0 || size > ch->slot_size ||
+            timeout == CHANNEL_NO_WAIT) {
+            return -1;
+        }
+
+        /* Full: the slot at tail still holds the message from one lap ago */
+        uint32_t pos = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+        channel_slot_t *slot = channel_slot(ch, pos);
+        uint32_t seen = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if ((int32_t)(seen - pos) >= 0) {
+            continue;       /* Freed meanwhile */
+        }
+        if (!channel_block(&ch->tx_waiters, slot, seen, timeout, deadline)) {
+            return -1;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * channel_receive - Receive a message, sleeping while the ring is empty
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   timeout - Ticks to wait (CHANNEL_NO_WAIT, CHANNEL_WAIT_FOREVER)
+ *
+ * Returns:
+ *   Message size (> 0), 0 if none arrived in time, -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t channel_receive(channel_t *ch, void *buffer, size_t size, uint32_t timeout)
+{
+    uint32_t deadline = pit_get_ticks() + timeout;
+
+    for (;;) {
+        ssize_t result = channel_try_receive(ch, buffer, size);
+        if (result != 0 || timeout == CHANNEL_NO_WAIT) {
+            return result;
+        }
+
+        uint32_t pos = ch->head;
+        channel_slot_t *slot = channel_slot(ch, pos);
+        uint32_t seen = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seen == pos + 1) {
+            continue;       /* Published meanwhile */
+        }
+        if (!channel_block(&ch->rx_waiters, slot, seen, timeout, deadline)) {
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,182 @@
+/*
+ * ===========================================================================
+ * kernel/ipc/futex.c
+ * ===========================================================================
+ *
+ * Futexes - Fast User-space Locking Support
+ *
+ * A futex is just a 32-bit word in memory that tasks agree on. Locks,
+ * condition variables and ring channels built on it do all their work with
+ * atomic operations on the word and only enter the kernel to sleep until
+ * the word changes (futex_wait) or to wake the sleepers (futex_wake).
+ *
+ * Keys:
+ *   Waiters are keyed by the word's physical address, so tasks that map
+ *   the same shared memory frame at different virtual addresses still meet
+ *   on the same futex.
+ *
+ * DSA Usage:
+ *   Hash table of FUTEX_BUCKETS lists; each waiter is a node on its bucket
+ *   list (living on the waiter's stack) with a private wait queue, so
+ *   futex_wake() wakes exactly the waiters of its key, oldest first.
+ *
+ * Each bucket has its own spinlock, and futexes never take the kernel
+ * lock. Reading the word and queueing the waiter happen under the bucket
+ * lock, which futex_wake() takes too, so a wake issued after the caller
+ * saw the expected value is never missed. The key is looked up first,
+ * outside the lock, since faulting the page in may allocate a frame.
+ *
+ * ===========================================================================
+ */
+
+#include "../../config/os_config.h"
+#include "../memory/memory.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+#define FUTEX_BUCKETS       64          /* Hash buckets (power of two) */
+
+/* Timeout values (in timer ticks) */
+#define FUTEX_WAIT_FOREVER  0xFFFFFFFFu
+
+/* ---------------------------------------------------------------------------
+ * Waiter Structure
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    list_node_t node;                   /* Link in its bucket */
+    uintptr_t key;                      /* Physical address of the word */
+    bool woken;                         /* Set (and unlinked) by futex_wake */
+    wait_queue_t wait;                  /* Only this waiter sleeps here */
+} futex_waiter_t;
+
+/* One hash chain; the lock covers its list and its waiters' flags */
+typedef struct {
+    spinlock_t lock;
+    list_t waiters;                     /* futex_waiter_t */
+} futex_bucket_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * ---------------------------------------------------------------------------
+ * All zero is a released lock and an empty list, so no init pass is needed.
+ * --------------------------------------------------------------------------- */
+static futex_bucket_t futex_buckets[FUTEX_BUCKETS];
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * --------------------------------------------------------------------------- */
+
+/*
+ * Physical address of a word in the running task's address space; 0 if
+ * unmapped. Demand-zero pages get their own frame first, since every
+ * untouched page would otherwise share the zero page's key.
+ */
+static uintptr_t futex_key(volatile uint32_t *addr)
+{
+    if (addr == NULL || ((uintptr_t)addr & 3) != 0) {
+        return 0;
+    }
+    paging_fault_in((uintptr_t)addr, true);
+    return paging_translate(address_space_current(false), (uintptr_t)addr);
+}
+
+static futex_bucket_t *futex_bucket(uintptr_t key)
+{
+    uint32_t hash = ((uint32_t)key >> 2) * 0x9E3779B1u;
+    return &futex_buckets[(hash >> 16) & (FUTEX_BUCKETS - 1)];
+}
+
+/* ---------------------------------------------------------------------------
+ * futex_wait - Sleep while a word holds an expected value
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   addr     - Word to wait on (4-byte aligned)
+ *   expected - Value the caller last saw in *addr
+ *   timeout  - Ticks to sleep at most (FUTEX_WAIT_FOREVER = no limit)
+ *
+ * Returns:
+ *   0 when woken or if *addr no longer equals expected (callers recheck
+ *   their condition either way), -1 on timeout or a bad address
+ * --------------------------------------------------------------------------- */
+int futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout)
+{
+    uintptr_t key = futex_key(addr);
+    if (key == 0) {
+        return -1;  /* EFAULT */
+    }
+
+    futex_bucket_t *bucket = futex_bucket(key);
+    uint32_t flags = spin_lock_irqsave(&bucket->lock);
+    if (*addr != expected) {
+        spin_unlock_irqrestore(&bucket->lock, flags);
+        return 0;   /* EAGAIN: changed before we slept */
+    }
+    if (timeout == 0) {
+        spin_unlock_irqrestore(&bucket->lock, flags);
+        return -1;
+    }
+
+    futex_waiter_t waiter;
+    list_node_init(&waiter.node);
+    waiter.key = key;
+    waiter.woken = false;
+    wait_queue_init(&waiter.wait);
+
+    list_push_back(&bucket->waiters, &waiter.node);
+
+    if (timeout == FUTEX_WAIT_FOREVER) {
+        while (!waiter.woken) {
+            wait_queue_wait_unlock(&waiter.wait, &bucket->lock, WAIT_FOREVER);
+        }
+    } else {
+        wait_queue_wait_unlock(&waiter.wait, &bucket->lock, timeout);
+    }
+
+    if (!waiter.woken) {
+        list_remove(&bucket->waiters, &waiter.node);  /* Timed out */
+    }
+
+    spin_unlock_irqrestore(&bucket->lock, flags);
+    return waiter.woken ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * futex_wake - Wake tasks waiting on a word
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   addr  - Word the waiters are sleeping on
+ *   count - Most tasks to wake (0xFFFFFFFF = all)
+ *
+ * Returns:
+ *   Number of tasks woken, or -1 on a bad address
+ * --------------------------------------------------------------------------- */
+int futex_wake(volatile uint32_t *addr, uint32_t count)
+{
+    uintptr_t key = futex_key(addr);
+    if (key == 0) {
+        return -1;  /* EFAULT */
+    }
+
+    futex_bucket_t *bucket = futex_bucket(key);
+    uint32_t flags = spin_lock_irqsave(&bucket->lock);
+    uint32_t woken = 0;
+    list_node_t *node = bucket->waiters.head;
+    while (node != NULL && woken < count) {
+        list_node_t *next = node->next;
+        futex_waiter_t *waiter = list_entry(node, futex_waiter_t, node);
+        if (waiter->key == key) {
+            list_remove(&bucket->waiters, node);
+            waiter->woken = true;
+            wait_queue_wake_one(&waiter->wait);
+            woken++;
+        }
+        node = next;
+    }
+
+    spin_unlock_irqrestore(&bucket->lock, flags);
+    return (int)woken;
+}
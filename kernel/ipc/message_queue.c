@@ -12,17 +12,64 @@
  * Features:
  * - Multiple independent message queues
  * - Variable-size messages with type filtering
- * - Non-blocking and blocking send/receive
+ * - Non-blocking and blocking send/receive (with timeouts)
+ * - Zero-copy transfer of large payloads by page reference
  * - Reference counting for safe cleanup
  *
  * DSA Usage:
- * - Circular buffer for message storage within each queue
+ * - Byte ring of variable-length records within each queue
+ * - Open-addressed hash of type -> intrusive FIFO of that type's records
+ * - FIFO list of blocked receivers, each with its own wait queue
+ *
+ * Storage:
+ *   Each queue owns a byte ring that is allocated on the first send,
+ *   doubled (and compacted) when a record does not fit, up to
+ *   MSGQ_RING_MAX, and dropped back to nothing when it drains after having
+ *   grown. A record is a 20-byte header followed by the payload, padded to
+ *   MSGQ_ALIGN; a record never wraps - a pad record fills the end instead.
+ *   Typed receives may take a record from the middle: it is marked dead and
+ *   its bytes are reclaimed when the head reaches it, so nothing moves.
+ *
+ * Type index:
+ *   Records of each non-zero type are chained oldest first through their
+ *   headers, and a small per-queue hash maps the type to its chain. A typed
+ *   receive takes the front of its chain and an untyped one takes the ring
+ *   head (always the front of its own chain), so both are O(1). When more
+ *   than MSGQ_TYPE_SLOTS types are queued at once, the extra types share an
+ *   overflow chain that typed receives have to walk until it drains.
+ *
+ *   ┌──────────────────────────────────────────────────────────────┐
+ *   │ [dead][msg 7B][msg 200B][ref → pages] ....free.... [pad]     │
+ *   │  ^head                               ^tail                   │
+ *   └──────────────────────────────────────────────────────────────┘
+ *
+ * Zero-copy:
+ *   msgq_send_ref() queues a reference to a run of frames instead of the
+ *   bytes; msgq_receive_ref() hands the frames to the receiver, who then
+ *   owns them. A by-value receive of a reference copies once and frees
+ *   the frames; a by-reference receive of an inline message copies once
+ *   into new frames. Ownership always moves with the message.
+ *
+ * Blocking:
+ *   A receiver that finds nothing suitable records its destination and type
+ *   filter on the queue's receiver list and sleeps. A sender first looks
+ *   for such a receiver: the message is delivered straight to it and that
+ *   one task is woken, so the data never touches the ring and the receiver
+ *   returns as soon as it runs. Senders that find the ring full sleep on
+ *   the queue's sender wait queue until a receive frees space. Queue state
+ *   is changed under the kernel lock.
  *
  * ===========================================================================
  */
 
 #include "../../config/os_config.h"
 #include "../memory/memory.h"
+#include "../drivers/drivers.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/sync.h"
+#include "poll.h"
+#include "../utils/trace.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions
@@ -34,18 +81,67 @@ extern void *memcpy(void *dest, const void *src, size_t n);
  * Configuration
  * --------------------------------------------------------------------------- */
 #define MAX_QUEUES          16          /* Maximum number of message queues */
-#define MAX_MESSAGES        32          /* Maximum messages per queue */
-#define MAX_MSG_SIZE        256         /* Maximum message data size in bytes */
+#define MAX_MSG_SIZE        256         /* Largest message sent by value */
+#define MSGQ_REF_MAX        (1024*1024) /* Largest message sent by reference */
+#define MSGQ_RING_INITIAL   512         /* First ring allocation (bytes) */
+#define MSGQ_RING_MAX       16384       /* Ring never grows past this */
+#define MSGQ_ALIGN          4           /* Record alignment */
+#define MSGQ_TYPE_SLOTS     32          /* Indexed types per queue (power of two) */
+
+/* Timeout values for the *_timeout calls (in timer ticks) */
+#define MSGQ_NO_WAIT        0
+#define MSGQ_WAIT_FOREVER   0xFFFFFFFFu
 
 /* ---------------------------------------------------------------------------
- * Message Structure
+ * Record Structure
+ * ---------------------------------------------------------------------------
+ * Header of one record in a queue's byte ring. The payload follows: the
+ * message bytes, or for MSGQ_REC_REF the address of the referenced frames.
  * --------------------------------------------------------------------------- */
+#define MSGQ_REC_PAD        (1 << 0)    /* Filler up to the end of the ring */
+#define MSGQ_REC_DEAD       (1 << 1)    /* Already received */
+#define MSGQ_REC_REF        (1 << 2)    /* Payload is a frame address */
+
 typedef struct {
-    uint32_t sender_pid;                /* Sender task PID */
+    uint16_t length;                    /* Bytes in the ring, header included */
+    uint16_t flags;                     /* MSGQ_REC_* */
     uint32_t type;                      /* Message type (for filtering) */
-    size_t size;                        /* Actual data size */
-    uint8_t data[MAX_MSG_SIZE];         /* Message data buffer */
-} message_t;
+    uint32_t sender_pid;                /* Sender task PID */
+    uint32_t size;                      /* Message size in bytes */
+    uint16_t type_next;                 /* Next record of this chain, or MSGQ_NONE */
+    uint16_t reserved;
+} msgq_record_t;
+
+#define MSGQ_NONE           0xFFFF      /* No record (ring offsets are smaller) */
+
+/* ---------------------------------------------------------------------------
+ * Type Chain
+ * ---------------------------------------------------------------------------
+ * Oldest and newest record of one type, as ring offsets. A hash slot with
+ * first == MSGQ_NONE is empty.
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t type;
+    uint16_t first;
+    uint16_t last;
+} msgq_chain_t;
+
+/* ---------------------------------------------------------------------------
+ * Blocked Receiver
+ * ---------------------------------------------------------------------------
+ * Lives on the receiver's stack while it sleeps. A sender that serves it
+ * delivers the message, sets result and done, and unlinks it.
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    list_node_t node;                   /* Link in msgq_t::receivers */
+    uint32_t type;                      /* Type filter (0 = any) */
+    void *buffer;                       /* By-value destination */
+    size_t size;
+    void **pages;                       /* By-reference destination, or NULL */
+    ssize_t result;                     /* Bytes delivered, or -1 (destroyed) */
+    bool done;
+    wait_queue_t wait;                  /* Only this receiver sleeps here */
+} msgq_receiver_t;
 
 /* ---------------------------------------------------------------------------
  * Message Queue Structure
@@ -54,12 +150,24 @@ typedef struct {
     bool valid;                         /* Is this queue slot in use? */
     uint32_t key;                       /* Queue identifier key */
     uint32_t ref_count;                 /* Reference count */
-    
-    /* Circular buffer for messages */
-    message_t messages[MAX_MESSAGES];
-    size_t head;                        /* Next message to read */
-    size_t tail;                        /* Next slot to write */
+
+    /* Byte ring of records (NULL until the first send) */
+    uint8_t *ring;
+    size_t capacity;                    /* Ring size in bytes */
+    size_t head;                        /* Oldest record */
+    size_t tail;                        /* Where the next record goes */
+    size_t used;                        /* Bytes from head to tail (incl. dead/pad) */
+    size_t live_bytes;                  /* Bytes of records not yet received */
     size_t count;                       /* Current message count */
+
+    /* Type index over the ring */
+    msgq_chain_t types[MSGQ_TYPE_SLOTS];
+    msgq_chain_t overflow;              /* Types that found no free slot */
+
+    /* Blocked tasks */
+    list_t receivers;                   /* msgq_receiver_t, oldest first */
+    wait_queue_t senders;               /* Waiting for ring space */
+    wait_queue_t pollers;               /* kpoll() watchers (woken on every change) */
 } msgq_t;
 
 /* ---------------------------------------------------------------------------
@@ -68,6 +176,355 @@ typedef struct {
 static msgq_t queues[MAX_QUEUES];
 static bool msgq_initialized = false;
 
+/* ---------------------------------------------------------------------------
+ * Byte Ring Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+static inline msgq_record_t *ring_record(msgq_t *q, size_t offset)
+{
+    return (msgq_record_t *)(q->ring + offset);
+}
+
+static inline void *record_payload(msgq_record_t *rec)
+{
+    return rec + 1;
+}
+
+/* Ring bytes needed for a message */
+static size_t record_length(size_t size, bool by_ref)
+{
+    size_t payload = by_ref ? sizeof(uintptr_t) : size;
+    return ALIGN_UP(sizeof(msgq_record_t) + payload, MSGQ_ALIGN);
+}
+
+static inline size_t ring_next(msgq_t *q, size_t offset)
+{
+    offset += ring_record(q, offset)->length;
+    return (offset == q->capacity) ? 0 : offset;
+}
+
+/* Frames behind a reference record */
+static inline size_t record_pages(const msgq_record_t *rec)
+{
+    return ALIGN_UP(rec->size, PAGE_SIZE) / PAGE_SIZE;
+}
+
+/* Find room for a record of 'length' bytes without moving anything */
+static msgq_record_t *ring_alloc(msgq_t *q, size_t length)
+{
+    if (q->ring == NULL) {
+        return NULL;
+    }
+    if (q->used == 0) {
+        q->head = 0;
+        q->tail = 0;
+    }
+
+    bool full = (q->used == q->capacity);
+    if (!full && q->tail >= q->head) {
+        /* Free space is [tail, capacity) and [0, head) */
+        if (q->capacity - q->tail >= length) {
+            return ring_record(q, q->tail);
+        }
+        if (q->head >= length) {
+            msgq_record_t *pad = ring_record(q, q->tail);
+            pad->length = (uint16_t)(q->capacity - q->tail);
+            pad->flags = MSGQ_REC_PAD;
+            q->used += pad->length;
+            q->tail = 0;
+            return ring_record(q, 0);
+        }
+    } else if (!full && q->head - q->tail >= length) {
+        return ring_record(q, q->tail);
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Type Index Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+static inline uint32_t type_hash(uint32_t type)
+{
+    uint32_t hash = type * 0x9E3779B1u;
+    return (hash ^ (hash >> 16)) & (MSGQ_TYPE_SLOTS - 1);
+}
+
+static inline uint16_t ring_offset(msgq_t *q, msgq_record_t *rec)
+{
+    return (uint16_t)((uint8_t *)rec - q->ring);
+}
+
+static void index_reset(msgq_t *q)
+{
+    for (size_t i = 0; i < MSGQ_TYPE_SLOTS; i++) {
+        q->types[i].first = MSGQ_NONE;
+        q->types[i].last = MSGQ_NONE;
+    }
+    q->overflow.first = MSGQ_NONE;
+    q->overflow.last = MSGQ_NONE;
+}
+
+/* The hash slot of a type with queued records, or NULL */
+static msgq_chain_t *index_find(msgq_t *q, uint32_t type)
+{
+    uint32_t i = type_hash(type);
+    for (size_t n = 0; n < MSGQ_TYPE_SLOTS; n++) {
+        msgq_chain_t *chain = &q->types[i];
+        if (chain->first == MSGQ_NONE) {
+            return NULL;
+        }
+        if (chain->type == type) {
+            return chain;
+        }
+        i = (i + 1) & (MSGQ_TYPE_SLOTS - 1);
+    }
+    return NULL;
+}
+
+/* The chain a queued record of this type is on */
+static msgq_chain_t *index_chain(msgq_t *q, uint32_t type)
+{
+    msgq_chain_t *chain = index_find(q, type);
+    return (chain != NULL) ? chain : &q->overflow;
+}
+
+/* Empty a hash slot, shifting later entries of the probe run back into it */
+static void index_clear_slot(msgq_t *q, uint32_t hole)
+{
+    uint32_t i = hole;
+    for (size_t n = 1; n < MSGQ_TYPE_SLOTS; n++) {
+        i = (i + 1) & (MSGQ_TYPE_SLOTS - 1);
+        msgq_chain_t *chain = &q->types[i];
+        if (chain->first == MSGQ_NONE) {
+            break;
+        }
+        /* Entries whose probe starts at or before the hole may move into it */
+        uint32_t home = type_hash(chain->type);
+        if (((i - home) & (MSGQ_TYPE_SLOTS - 1)) >= ((i - hole) & (MSGQ_TYPE_SLOTS - 1))) {
+            q->types[hole] = *chain;
+            hole = i;
+        }
+    }
+    q->types[hole].first = MSGQ_NONE;
+    q->types[hole].last = MSGQ_NONE;
+}
+
+/* Chain a newly written record behind the others of its type */
+static void index_append(msgq_t *q, msgq_record_t *rec)
+{
+    rec->type_next = MSGQ_NONE;
+    if (rec->type == 0) {
+        return;     /* Only untyped receives can ask for it: found at the head */
+    }
+
+    msgq_chain_t *chain = index_find(q, rec->type);
+    if (chain == NULL) {
+        /*
+         * New types share the overflow chain while it is in use; a type
+         * that is on it must stay there until it drains to keep its order.
+         */
+        chain = &q->overflow;
+        if (q->overflow.first == MSGQ_NONE) {
+            uint32_t i = type_hash(rec->type);
+            for (size_t n = 0; n < MSGQ_TYPE_SLOTS; n++) {
+                if (q->types[i].first == MSGQ_NONE) {
+                    chain = &q->types[i];
+                    chain->type = rec->type;
+                    break;
+                }
+                i = (i + 1) & (MSGQ_TYPE_SLOTS - 1);
+            }
+        }
+    }
+
+    uint16_t offset = ring_offset(q, rec);
+    if (chain->first == MSGQ_NONE) {
+        chain->first = offset;
+    } else {
+        ring_record(q, chain->last)->type_next = offset;
+    }
+    chain->last = offset;
+}
+
+/* Unlink a record from its chain; 'prev' is the record before it, or NULL */
+static void index_unlink(msgq_t *q, msgq_chain_t *chain, msgq_record_t *prev,
+                         msgq_record_t *rec)
+{
+    if (prev == NULL) {
+        if (chain->first != ring_offset(q, rec)) {
+            PANIC("msgq: type index out of order");
+        }
+        chain->first = rec->type_next;
+    } else {
+        prev->type_next = rec->type_next;
+    }
+    if (rec->type_next == MSGQ_NONE) {
+        chain->last = (prev != NULL) ? ring_offset(q, prev) : MSGQ_NONE;
+    }
+
+    if (chain->first == MSGQ_NONE && chain != &q->overflow) {
+        index_clear_slot(q, (uint32_t)(chain - q->types));
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * ring_resize - Move the live records into a fresh ring of 'capacity' bytes
+ * ---------------------------------------------------------------------------
+ * Dead and pad records are dropped on the way, so this also compacts. The
+ * type index holds ring offsets, so it is rebuilt for the new ring.
+ * --------------------------------------------------------------------------- */
+static bool ring_resize(msgq_t *q, size_t capacity)
+{
+    uint8_t *ring = (uint8_t *)kmalloc(capacity);
+    if (ring == NULL) {
+        return false;
+    }
+
+    size_t out = 0;
+    for (size_t offset = q->head, seen = 0; seen < q->used; ) {
+        msgq_record_t *rec = ring_record(q, offset);
+        if (!(rec->flags & (MSGQ_REC_PAD | MSGQ_REC_DEAD))) {
+            memcpy(ring + out, rec, rec->length);
+            out += rec->length;
+        }
+        seen += rec->length;
+        offset = ring_next(q, offset);
+    }
+
+    kfree(q->ring);
+    q->ring = ring;
+    q->capacity = capacity;
+    q->head = 0;
+    q->tail = (out == capacity) ? 0 : out;
+    q->used = out;
+
+    index_reset(q);
+    for (size_t offset = 0; offset < out; offset += ring_record(q, offset)->length) {
+        index_append(q, ring_record(q, offset));
+    }
+    return true;
+}
+
+/* Room for a record, compacting or doubling the ring if needed */
+static msgq_record_t *ring_reserve(msgq_t *q, size_t length)
+{
+    msgq_record_t *rec = ring_alloc(q, length);
+    if (rec != NULL) {
+        return rec;
+    }
+
+    size_t capacity = (q->capacity > 0) ? q->capacity : MSGQ_RING_INITIAL;
+    while (capacity < q->live_bytes + length) {
+        capacity *= 2;
+    }
+    if (capacity > MSGQ_RING_MAX) {
+        return NULL;
+    }
+    if (capacity == q->capacity && q->live_bytes == q->used) {
+        return NULL;  /* Nothing to reclaim and no room to grow */
+    }
+    if (!ring_resize(q, capacity)) {
+        return NULL;
+    }
+    return ring_alloc(q, length);
+}
+
+/* Account for a record written at the tail */
+static void ring_commit(msgq_t *q, msgq_record_t *rec)
+{
+    index_append(q, rec);
+    q->tail += rec->length;
+    if (q->tail == q->capacity) {
+        q->tail = 0;
+    }
+    q->used += rec->length;
+    q->live_bytes += rec->length;
+    q->count++;
+}
+
+/* Mark a record received and reclaim whatever the head can now skip */
+static void ring_consume(msgq_t *q, msgq_record_t *rec)
+{
+    rec->flags |= MSGQ_REC_DEAD;
+    q->live_bytes -= rec->length;
+    q->count--;
+
+    while (q->used > 0) {
+        msgq_record_t *head = ring_record(q, q->head);
+        if (!(head->flags & (MSGQ_REC_PAD | MSGQ_REC_DEAD))) {
+            break;
+        }
+        q->used -= head->length;
+        q->head = ring_next(q, q->head);
+    }
+
+    /* Drained after a burst: give the grown ring back */
+    if (q->used == 0 && q->capacity > MSGQ_RING_INITIAL) {
+        kfree(q->ring);
+        q->ring = NULL;
+        q->capacity = 0;
+    }
+}
+
+/* Free the frames of every unreceived reference record, then the ring */
+static void ring_free(msgq_t *q)
+{
+    for (size_t offset = q->head, seen = 0; seen < q->used; ) {
+        msgq_record_t *rec = ring_record(q, offset);
+        if ((rec->flags & (MSGQ_REC_REF | MSGQ_REC_DEAD | MSGQ_REC_PAD)) == MSGQ_REC_REF) {
+            frame_free_contiguous(*(uintptr_t *)record_payload(rec), record_pages(rec));
+        }
+        seen += rec->length;
+        offset = ring_next(q, offset);
+    }
+
+    kfree(q->ring);
+    q->ring = NULL;
+    q->capacity = 0;
+    q->head = 0;
+    q->tail = 0;
+    q->used = 0;
+    q->live_bytes = 0;
+    q->count = 0;
+    index_reset(q);
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_deliver - Give one message to a receiver's destination
+ * ---------------------------------------------------------------------------
+ * 'data' is the message bytes, or for by_ref the referenced frames, which
+ * are either handed over (pages != NULL) or copied and freed.
+ *
+ * Returns:
+ *   Bytes delivered, or -1 if frames for a by-reference receive of an
+ *   inline message could not be allocated (nothing is consumed then)
+ * --------------------------------------------------------------------------- */
+static ssize_t msgq_deliver(const void *data, size_t size, bool by_ref,
+                            void *buffer, size_t buffer_size, void **pages)
+{
+    if (pages != NULL) {
+        if (by_ref) {
+            *pages = (void *)data;
+            return (ssize_t)size;
+        }
+        uintptr_t frames = frame_alloc_contiguous(ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE);
+        if (frames == 0) {
+            return -1;
+        }
+        memcpy((void *)frames, data, size);
+        *pages = (void *)frames;
+        return (ssize_t)size;
+    }
+
+    size_t copy_size = (size < buffer_size) ? size : buffer_size;
+    memcpy(buffer, data, copy_size);
+    if (by_ref) {
+        frame_free_contiguous((uintptr_t)data, ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE);
+    }
+    return (ssize_t)copy_size;
+}
+
 /* ---------------------------------------------------------------------------
  * msgq_init - Initialize the message queue subsystem
  * --------------------------------------------------------------------------- */
@@ -76,19 +533,22 @@ void msgq_init(void)
     if (msgq_initialized) {
         return;
     }
-    
+
     /* Clear all queue slots */
     memset(queues, 0, sizeof(queues));
-    
+
     for (size_t i = 0; i < MAX_QUEUES; i++) {
         queues[i].valid = false;
         queues[i].key = 0;
         queues[i].ref_count = 0;
-        queues[i].head = 0;
-        queues[i].tail = 0;
-        queues[i].count = 0;
+        queues[i].ring = NULL;
+        queues[i].capacity = 0;
+        index_reset(&queues[i]);
+        list_init(&queues[i].receivers);
+        wait_queue_init(&queues[i].senders);
+        wait_queue_init(&queues[i].pollers);
     }
-    
+
     msgq_initialized = true;
 }
 
@@ -106,7 +566,7 @@ int msgq_create(uint32_t key)
     if (!msgq_initialized) {
         return -1;
     }
-    
+
     /* Check if queue with this key already exists */
     for (size_t i = 0; i < MAX_QUEUES; i++) {
         if (queues[i].valid && queues[i].key == key) {
@@ -115,21 +575,17 @@ int msgq_create(uint32_t key)
             return (int)i;
         }
     }
-    
-    /* Find an empty slot */
+
+    /* Find an empty slot (its ring is allocated on the first send) */
     for (size_t i = 0; i < MAX_QUEUES; i++) {
         if (!queues[i].valid) {
             queues[i].valid = true;
             queues[i].key = key;
             queues[i].ref_count = 1;
-            queues[i].head = 0;
-            queues[i].tail = 0;
-            queues[i].count = 0;
-            memset(queues[i].messages, 0, sizeof(queues[i].messages));
             return (int)i;
         }
     }
-    
+
     return -1;  /* No free slots */
 }
 
@@ -147,14 +603,14 @@ int msgq_get(uint32_t key)
     if (!msgq_initialized) {
         return -1;
     }
-    
+
     for (size_t i = 0; i < MAX_QUEUES; i++) {
         if (queues[i].valid && queues[i].key == key) {
             queues[i].ref_count++;
             return (int)i;
         }
     }
-    
+
     return -1;
 }
 
@@ -172,145 +628,372 @@ int msgq_destroy(int qid)
     if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES) {
         return -1;
     }
-    
+
     msgq_t *q = &queues[qid];
     if (!q->valid) {
         return -1;
     }
-    
+
     /* Decrement reference count */
     if (q->ref_count > 0) {
         q->ref_count--;
     }
-    
+
     /* Only destroy if no references remain */
     if (q->ref_count == 0) {
+        uint32_t flags = kernel_lock_irqsave();
         q->valid = false;
         q->key = 0;
-        q->head = 0;
-        q->tail = 0;
-        q->count = 0;
+        ring_free(q);
+
+        /* Blocked tasks fail instead of sleeping on a dead queue */
+        list_node_t *node;
+        while ((node = list_pop_front(&q->receivers)) != NULL) {
+            msgq_receiver_t *rx = list_entry(node, msgq_receiver_t, node);
+            rx->result = -1;
+            rx->done = true;
+            wait_queue_wake_one(&rx->wait);
+        }
+        wait_queue_wake_all(&q->senders);
+        wait_queue_wake_all(&q->pollers);
+        kernel_unlock_irqrestore(flags);
     }
-    
+
     return 0;
 }
 
 /* ---------------------------------------------------------------------------
- * msgq_send - Send a message to a queue
+ * Blocking Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Ticks left until a deadline; 0 once it has passed */
+static uint32_t msgq_ticks_left(uint32_t deadline)
+{
+    int32_t left = (int32_t)(deadline - pit_get_ticks());
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+/* Sleep on a wait queue until woken or the deadline; false once it passed */
+static bool msgq_wait(wait_queue_t *wq, uint32_t timeout, uint32_t deadline)
+{
+    if (timeout == MSGQ_WAIT_FOREVER) {
+        wait_queue_wait(wq);
+        return true;
+    }
+
+    uint32_t left = msgq_ticks_left(deadline);
+    if (left == 0) {
+        return false;
+    }
+    wait_queue_wait_timeout(wq, left);
+    return true;
+}
+
+/* Hand a message to the oldest receiver whose filter accepts it */
+static bool msgq_handoff(msgq_t *q, const void *data, size_t size, uint32_t type,
+                         bool by_ref)
+{
+    for (list_node_t *node = q->receivers.head; node != NULL; node = node->next) {
+        msgq_receiver_t *rx = list_entry(node, msgq_receiver_t, node);
+        if (rx->type != 0 && rx->type != type) {
+            continue;
+        }
+
+        ssize_t result = msgq_deliver(data, size, by_ref, rx->buffer, rx->size, rx->pages);
+        if (result < 0) {
+            return false;   /* Queue it instead */
+        }
+        rx->result = result;
+        rx->done = true;
+        list_remove(&q->receivers, node);
+        wait_queue_wake_one(&rx->wait);
+        return true;
+    }
+    return false;
+}
+
+/* Deliver the first queued message accepted by the filter; -1 if none */
+static ssize_t msgq_take(msgq_t *q, void *buffer, size_t size, void **pages, uint32_t type)
+{
+    if (q->count == 0) {
+        return -1;
+    }
+
+    msgq_record_t *rec;
+    msgq_record_t *prev = NULL;
+    msgq_chain_t *chain = NULL;
+    if (type == 0) {
+        /* The head is live while anything is queued, and oldest of its type */
+        rec = ring_record(q, q->head);
+        if (rec->type != 0) {
+            chain = index_chain(q, rec->type);
+        }
+    } else {
+        chain = index_chain(q, type);
+        rec = NULL;
+        for (uint16_t offset = chain->first; offset != MSGQ_NONE; ) {
+            msgq_record_t *candidate = ring_record(q, offset);
+            if (candidate->type == type) {
+                rec = candidate;
+                break;
+            }
+            prev = candidate;               /* Only on the overflow chain */
+            offset = candidate->type_next;
+        }
+        if (rec == NULL) {
+            return -1;
+        }
+    }
+
+    bool by_ref = (rec->flags & MSGQ_REC_REF) != 0;
+    const void *data = by_ref ? (const void *)*(uintptr_t *)record_payload(rec)
+                              : record_payload(rec);
+    ssize_t result = msgq_deliver(data, rec->size, by_ref, buffer, size, pages);
+    if (result >= 0) {
+        if (chain != NULL) {
+            index_unlink(q, chain, prev, rec);
+        }
+        ring_consume(q, rec);
+    }
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_post - Common send path
+ * ---------------------------------------------------------------------------
+ * 'data' is the message bytes or, for by_ref, the frames being handed over.
+ * --------------------------------------------------------------------------- */
+static int msgq_post(int qid, const void *data, size_t size, uint32_t type,
+                     bool by_ref, uint32_t timeout)
+{
+    msgq_t *q = &queues[qid];
+    size_t length = record_length(size, by_ref);
+    uint32_t deadline = pit_get_ticks() + timeout;
+    TRACE(TRACE_MSGQ_SEND, qid, size);
+    uint32_t flags = kernel_lock_irqsave();
+
+    msgq_record_t *rec;
+    for (;;) {
+        if (!q->valid) {
+            kernel_unlock_irqrestore(flags);
+            return -1;
+        }
+
+        /* A receiver is already waiting for this: skip the ring */
+        if (msgq_handoff(q, data, size, type, by_ref)) {
+            kernel_unlock_irqrestore(flags);
+            return 0;
+        }
+
+        rec = ring_reserve(q, length);
+        if (rec != NULL) {
+            break;
+        }
+
+        /* Queue full */
+        if (timeout == MSGQ_NO_WAIT || !msgq_wait(&q->senders, timeout, deadline)) {
+            kernel_unlock_irqrestore(flags);
+            return -1;
+        }
+    }
+
+    /* Append the record */
+    task_t *self = task_current();
+    rec->length = (uint16_t)length;
+    rec->flags = by_ref ? MSGQ_REC_REF : 0;
+    rec->type = type;
+    rec->sender_pid = (self != NULL) ? self->pid : 0;
+    rec->size = (uint32_t)size;
+    if (by_ref) {
+        *(uintptr_t *)record_payload(rec) = (uintptr_t)data;
+    } else {
+        memcpy(record_payload(rec), data, size);
+    }
+    ring_commit(q, rec);
+    wait_queue_wake_all(&q->pollers);
+
+    kernel_unlock_irqrestore(flags);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_send_timeout - Send a message, waiting for space if the queue is full
  * ---------------------------------------------------------------------------
  * Parameters:
- *   qid    - Queue ID
- *   data   - Message data to send
- *   size   - Size of message data
- *   type   - Message type (for filtering on receive)
+ *   qid     - Queue ID
+ *   data    - Message data to send
+ *   size    - Size of message data (up to MAX_MSG_SIZE)
+ *   type    - Message type (for filtering on receive)
+ *   timeout - Ticks to wait for space (MSGQ_NO_WAIT, MSGQ_WAIT_FOREVER)
  *
  * Returns:
+ *   0 on success, -1 on error (timed out, queue destroyed, invalid params)
+ * --------------------------------------------------------------------------- */
+int msgq_send_timeout(int qid, const void *data, size_t size, uint32_t type,
+                      uint32_t timeout)
+{
+    if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES) {
+        return -1;
+    }
+
+    if (data == NULL || size == 0 || size > MAX_MSG_SIZE) {
+        return -1;
+    }
+
+    return msgq_post(qid, data, size, type, false, timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_send - Send a message to a queue without waiting
+ * ---------------------------------------------------------------------------
+ * Returns:
  *   0 on success, -1 on error (queue full, invalid params)
  * --------------------------------------------------------------------------- */
 int msgq_send(int qid, const void *data, size_t size, uint32_t type)
+{
+    return msgq_send_timeout(qid, data, size, type, MSGQ_NO_WAIT);
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_send_ref - Send a large payload by handing over its frames
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   pages   - Page-aligned run from frame_alloc_contiguous() holding the
+ *             message; on success it belongs to the queue (and then to the
+ *             receiver) and the sender must not touch it again
+ *   size    - Message size in bytes (up to MSGQ_REF_MAX)
+ *
+ * Returns:
+ *   0 on success, -1 on error (the sender still owns the frames)
+ * --------------------------------------------------------------------------- */
+int msgq_send_ref(int qid, void *pages, size_t size, uint32_t type, uint32_t timeout)
 {
     if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES) {
         return -1;
     }
-    
-    if (data == NULL || size == 0 || size > MAX_MSG_SIZE) {
+
+    if (pages == NULL || ((uintptr_t)pages % PAGE_SIZE) != 0 ||
+        size == 0 || size > MSGQ_REF_MAX) {
         return -1;
     }
-    
+
+    return msgq_post(qid, pages, size, type, true, timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_fetch - Common receive path (exactly one of buffer / pages is used)
+ * --------------------------------------------------------------------------- */
+static ssize_t msgq_fetch(int qid, void *buffer, size_t size, void **pages, uint32_t type,
+                          uint32_t timeout)
+{
     msgq_t *q = &queues[qid];
+    uint32_t flags = kernel_lock_irqsave();
     if (!q->valid) {
+        kernel_unlock_irqrestore(flags);
         return -1;
     }
-    
-    /* Check if queue is full */
-    if (q->count >= MAX_MESSAGES) {
-        return -1;  /* Queue full - non-blocking */
-    }
-    
-    /* Add message to queue */
-    message_t *msg = &q->messages[q->tail];
-    msg->sender_pid = 0;  /* TODO: Get current task PID */
-    msg->type = type;
-    msg->size = size;
-    memcpy(msg->data, data, size);
-    
-    /* Advance tail with wrap-around */
-    q->tail = (q->tail + 1) % MAX_MESSAGES;
-    q->count++;
-    
-    return 0;
+
+    ssize_t result = msgq_take(q, buffer, size, pages, type);
+    if (result >= 0) {
+        wait_queue_wake_one(&q->senders);   /* Space just opened */
+        wait_queue_wake_all(&q->pollers);
+        kernel_unlock_irqrestore(flags);
+        return result;
+    }
+    if (timeout == MSGQ_NO_WAIT) {
+        kernel_unlock_irqrestore(flags);
+        return 0;  /* No messages - non-blocking */
+    }
+
+    /* Wait for a sender to hand a message over */
+    msgq_receiver_t rx;
+    list_node_init(&rx.node);
+    rx.type = type;
+    rx.buffer = buffer;
+    rx.size = size;
+    rx.pages = pages;
+    rx.result = 0;
+    rx.done = false;
+    wait_queue_init(&rx.wait);
+    list_push_back(&q->receivers, &rx.node);
+
+    /* Senders blocked on a full ring may hold what this filter wants */
+    wait_queue_wake_all(&q->senders);
+
+    uint32_t deadline = pit_get_ticks() + timeout;
+    while (!rx.done) {
+        if (!msgq_wait(&rx.wait, timeout, deadline)) {
+            break;
+        }
+    }
+    if (!rx.done) {
+        list_remove(&q->receivers, &rx.node);   /* Timed out */
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return rx.result;
 }
 
 /* ---------------------------------------------------------------------------
- * msgq_receive - Receive a message from a queue
+ * msgq_receive_timeout - Receive a message, waiting for one to arrive
  * ---------------------------------------------------------------------------
  * Parameters:
- *   qid    - Queue ID
- *   buffer - Buffer to receive message data
- *   size   - Size of buffer
- *   type   - Message type filter (0 = any type)
+ *   qid     - Queue ID
+ *   buffer  - Buffer to receive message data (longer messages are cut)
+ *   size    - Size of buffer
+ *   type    - Message type filter (0 = any type)
+ *   timeout - Ticks to wait (MSGQ_NO_WAIT, MSGQ_WAIT_FOREVER)
  *
  * Returns:
- *   Size of received message (> 0) on success, 0 if no message, -1 on error
+ *   Size of received message (> 0) on success, 0 if none arrived in time,
+ *   -1 on error (including the queue being destroyed while waiting)
  * --------------------------------------------------------------------------- */
-ssize_t msgq_receive(int qid, void *buffer, size_t size, uint32_t type)
+ssize_t msgq_receive_timeout(int qid, void *buffer, size_t size, uint32_t type,
+                             uint32_t timeout)
 {
     if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES) {
         return -1;
     }
-    
+
     if (buffer == NULL || size == 0) {
         return -1;
     }
-    
-    msgq_t *q = &queues[qid];
-    if (!q->valid) {
+
+    ssize_t result = msgq_fetch(qid, buffer, size, NULL, type, timeout);
+    TRACE(TRACE_MSGQ_RECEIVE, qid, result);
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_receive - Receive a message from a queue without waiting
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Size of received message (> 0) on success, 0 if no message, -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t msgq_receive(int qid, void *buffer, size_t size, uint32_t type)
+{
+    return msgq_receive_timeout(qid, buffer, size, type, MSGQ_NO_WAIT);
+}
+
+/* ---------------------------------------------------------------------------
+ * msgq_receive_ref - Receive a message as frames owned by the caller
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   pages - Output: page-aligned message data; free it with
+ *           frame_free_contiguous(addr, ALIGN_UP(size, PAGE_SIZE) / PAGE_SIZE)
+ *
+ * Returns:
+ *   Message size (> 0), 0 if none arrived in time, -1 on error
+ * --------------------------------------------------------------------------- */
+ssize_t msgq_receive_ref(int qid, void **pages, uint32_t type, uint32_t timeout)
+{
+    if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES || pages == NULL) {
         return -1;
     }
-    
-    /* Check if queue is empty */
-    if (q->count == 0) {
-        return 0;  /* No messages - non-blocking */
-    }
-    
-    /* If type filter specified, search for matching message */
-    if (type != 0) {
-        size_t idx = q->head;
-        for (size_t i = 0; i < q->count; i++) {
-            if (q->messages[idx].type == type) {
-                /* Found matching message - copy it */
-                message_t *msg = &q->messages[idx];
-                size_t copy_size = (msg->size < size) ? msg->size : size;
-                memcpy(buffer, msg->data, copy_size);
-                
-                /* Remove message by shifting (simple approach) */
-                /* Note: In production, use a more efficient removal */
-                for (size_t j = idx; j != q->tail; ) {
-                    size_t next = (j + 1) % MAX_MESSAGES;
-                    if (next == q->tail) break;
-                    q->messages[j] = q->messages[next];
-                    j = next;
-                }
-                q->tail = (q->tail + MAX_MESSAGES - 1) % MAX_MESSAGES;
-                q->count--;
-                
-                return (ssize_t)copy_size;
-            }
-            idx = (idx + 1) % MAX_MESSAGES;
-        }
-        return 0;  /* No matching message */
-    }
-    
-    /* No type filter - get message from head (FIFO) */
-    message_t *msg = &q->messages[q->head];
-    size_t copy_size = (msg->size < size) ? msg->size : size;
-    memcpy(buffer, msg->data, copy_size);
-    
-    /* Advance head with wrap-around */
-    q->head = (q->head + 1) % MAX_MESSAGES;
-    q->count--;
-    
-    return (ssize_t)copy_size;
+
+    ssize_t result = msgq_fetch(qid, NULL, 0, pages, type, timeout);
+    TRACE(TRACE_MSGQ_RECEIVE, qid, result);
+    return result;
 }
 
 /* ---------------------------------------------------------------------------
@@ -327,15 +1010,46 @@ int msgq_peek(int qid)
     if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES) {
         return -1;
     }
-    
+
     msgq_t *q = &queues[qid];
     if (!q->valid) {
         return -1;
     }
-    
+
     return (int)q->count;
 }
 
+/* ---------------------------------------------------------------------------
+ * msgq_poll - Readiness of a queue for kpoll()
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   qid - Queue ID
+ *   wq  - Output: wait queue woken when the queue's state changes
+ *
+ * Returns:
+ *   POLLIN if a message is queued, POLLOUT if the ring still has room,
+ *   POLLNVAL for a bad or destroyed queue
+ * --------------------------------------------------------------------------- */
+uint32_t msgq_poll(int qid, wait_queue_t **wq)
+{
+    *wq = NULL;
+    if (!msgq_initialized || qid < 0 || qid >= MAX_QUEUES || !queues[qid].valid) {
+        return POLLNVAL;
+    }
+
+    msgq_t *q = &queues[qid];
+    *wq = &q->pollers;
+
+    uint32_t mask = 0;
+    if (q->count > 0) {
+        mask |= POLLIN;
+    }
+    if (q->used < MSGQ_RING_MAX) {
+        mask |= POLLOUT;
+    }
+    return mask;
+}
+
 /* ---------------------------------------------------------------------------
  * msgq_count - Get number of active message queues
  * --------------------------------------------------------------------------- */
@@ -344,7 +1058,7 @@ size_t msgq_count(void)
     if (!msgq_initialized) {
         return 0;
     }
-    
+
     size_t count = 0;
     for (size_t i = 0; i < MAX_QUEUES; i++) {
         if (queues[i].valid) {
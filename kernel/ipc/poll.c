@@ -0,0 +1,496 @@
+/*
+ * ===========================================================================
+ * kernel/ipc/poll.c
+ * ===========================================================================
+ *
+ * Readiness Polling
+ *
+ * kpoll() asks each source for its ready mask. When nothing is ready it
+ * puts one wait entry (on its own stack) on every source's wait queue and
+ * sleeps once; whichever producer wakes first makes the task runnable,
+ * the entries are taken off again and the sources re-checked.
+ *
+ * The check and the queueing happen under the kernel lock, so readiness
+ * that appears after the check always finds the entries in place.
+ *
+ * epoll instances keep their items on the source queues between calls as
+ * callback entries (see wait_queue_add_callback). A wake only links the
+ * item onto its instance's ready list and wakes the instance's waiters;
+ * epoll_wait() then re-checks just the items on that list.
+ *
+ * DSA Usage:
+ *   Items come from a fixed pool kept on a free list; each instance has a
+ *   list of all its items (the interest set) and a FIFO ready list.
+ *
+ * ===========================================================================
+ */
+
+#include "poll.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../drivers/drivers.h"
+#include "../fs/vfs.h"
+
+/* ---------------------------------------------------------------------------
+ * External Functions
+ * --------------------------------------------------------------------------- */
+extern uint32_t msgq_poll(int qid, wait_queue_t **wq);
+
+/* Bits reported whether or not they were asked for */
+#define POLL_ALWAYS         (POLLERR | POLLHUP | POLLNVAL)
+
+/* ---------------------------------------------------------------------------
+ * epoll Structures
+ * --------------------------------------------------------------------------- */
+struct epoll_instance;
+
+typedef struct {
+    list_node_t node;                   /* Interest set, or the free list */
+    list_node_t ready_node;             /* Instance ready list */
+    bool queued;                        /* On the ready list */
+    struct epoll_instance *ep;
+    int32_t source;
+    int32_t id;
+    vfs_file_t *file;                   /* POLL_SRC_FILE: the file watched */
+    uint32_t events;                    /* Requested bits, EPOLLET */
+    uint32_t data;                      /* Caller's cookie */
+    wait_queue_t *wq;                   /* Source queue watched (NULL = none) */
+    wait_entry_t entry;                 /* Callback entry on 'wq' */
+} epoll_item_t;
+
+typedef struct epoll_instance {
+    bool valid;
+    list_t items;                       /* epoll_item_t::node */
+    list_t ready;                       /* epoll_item_t::ready_node */
+    wait_queue_t waiters;               /* Tasks in epoll_wait() */
+} epoll_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+static epoll_t epolls[EPOLL_MAX_INSTANCES];
+static epoll_item_t epoll_items[EPOLL_MAX_ITEMS];
+static list_t epoll_free;
+static bool epoll_ready = false;
+static uint32_t epoll_file_items = 0;   /* Items with a file, for file_put() */
+
+/* ---------------------------------------------------------------------------
+ * Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Ready mask of one source, and the queue to watch for changes */
+static uint32_t poll_source(int32_t source, int32_t id, wait_queue_t **wq)
+{
+    *wq = NULL;
+    switch (source) {
+        case POLL_SRC_KEYBOARD:
+            return keyboard_poll(wq);
+        case POLL_SRC_MSGQ:
+            return msgq_poll(id, wq);
+        case POLL_SRC_SERIAL:
+            return serial_poll(wq);
+        case POLL_SRC_FILE:
+            return vfs_poll(id, wq);
+        default:
+            return POLLNVAL;
+    }
+}
+
+/* Fill in revents; returns how many entries are ready */
+static int poll_scan(kpollfd_t *fds, uint32_t count, wait_queue_t **queues)
+{
+    int ready = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t mask = poll_source(fds[i].source, fds[i].id, &queues[i]);
+        fds[i].revents = (uint16_t)(mask & (fds[i].events | POLL_ALWAYS));
+        if (fds[i].revents != 0) {
+            ready++;
+        }
+    }
+    return ready;
+}
+
+/* ---------------------------------------------------------------------------
+ * kpoll - Wait until at least one source is ready
+ * --------------------------------------------------------------------------- */
+int kpoll(kpollfd_t *fds, uint32_t count, uint32_t timeout)
+{
+    if (count > POLL_MAX_ENTRIES || (fds == NULL && count > 0)) {
+        return -1;  /* EINVAL */
+    }
+
+    wait_queue_t *queues[POLL_MAX_ENTRIES];
+    wait_entry_t entries[POLL_MAX_ENTRIES];
+    uint32_t deadline = pit_get_ticks() + timeout;
+
+    uint32_t flags = kernel_lock_irqsave();
+
+    int ready = poll_scan(fds, count, queues);
+    while (ready == 0 && timeout != 0) {
+        uint32_t left = POLL_WAIT_FOREVER;
+        if (timeout != POLL_WAIT_FOREVER) {
+            int32_t remaining = (int32_t)(deadline - pit_get_ticks());
+            if (remaining <= 0) {
+                break;
+            }
+            left = (uint32_t)remaining;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (queues[i] != NULL) {
+                wait_queue_add(queues[i], &entries[i]);
+            }
+        }
+        bool in_time = wait_entries_sleep(left);
+        for (uint32_t i = 0; i < count; i++) {
+            if (queues[i] != NULL) {
+                wait_queue_remove(&entries[i]);
+            }
+        }
+
+        ready = poll_scan(fds, count, queues);
+        if (!in_time) {
+            break;
+        }
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return ready;
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll Helpers (called with the kernel lock held)
+ * --------------------------------------------------------------------------- */
+
+static void epoll_init(void)
+{
+    list_init(&epoll_free);
+    for (size_t i = 0; i < EPOLL_MAX_ITEMS; i++) {
+        list_node_init(&epoll_items[i].node);
+        list_push_back(&epoll_free, &epoll_items[i].node);
+    }
+    for (size_t i = 0; i < EPOLL_MAX_INSTANCES; i++) {
+        epolls[i].valid = false;
+        list_init(&epolls[i].items);
+        list_init(&epolls[i].ready);
+        wait_queue_init(&epolls[i].waiters);
+    }
+    epoll_ready = true;
+}
+
+static epoll_t *epoll_lookup(int epfd)
+{
+    if (!epoll_ready || epfd < 0 || epfd >= EPOLL_MAX_INSTANCES || !epolls[epfd].valid) {
+        return NULL;
+    }
+    return &epolls[epfd];
+}
+
+/* Files are matched by the open file, so a reused descriptor is not */
+static epoll_item_t *epoll_find(epoll_t *ep, int32_t source, int32_t id,
+                                const vfs_file_t *file)
+{
+    list_node_t *node;
+    list_for_each(node, &ep->items) {
+        epoll_item_t *item = list_entry(node, epoll_item_t, node);
+        if (item->source != source) {
+            continue;
+        }
+        if (source == POLL_SRC_FILE ? item->file == file : item->id == id) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/* Ready mask of an item's source */
+static uint32_t epoll_poll_item(epoll_item_t *item, wait_queue_t **wq)
+{
+    if (item->file != NULL) {
+        return vfs_file_poll(item->file, wq);
+    }
+    return poll_source(item->source, item->id, wq);
+}
+
+static void epoll_queue(epoll_item_t *item)
+{
+    if (!item->queued) {
+        list_push_back(&item->ep->ready, &item->ready_node);
+        item->queued = true;
+    }
+}
+
+/* Source woke its queue: the item may have become ready */
+static void epoll_notify(wait_entry_t *entry)
+{
+    epoll_item_t *item = list_entry(entry, epoll_item_t, entry);
+    epoll_queue(item);
+    wait_queue_wake_all(&item->ep->waiters);
+}
+
+static void epoll_release(epoll_t *ep, epoll_item_t *item)
+{
+    if (item->wq != NULL) {
+        wait_queue_remove(&item->entry);
+    }
+    if (item->queued) {
+        list_remove(&ep->ready, &item->ready_node);
+    }
+    if (item->file != NULL) {
+        item->file = NULL;
+        epoll_file_items--;
+    }
+    list_remove(&ep->items, &item->node);
+    list_push_back(&epoll_free, &item->node);
+}
+
+/* Report ready items; level-triggered ones that are still ready go back
+ * on the list behind those not yet looked at */
+static int epoll_harvest(epoll_t *ep, kepoll_event_t *events, uint32_t max)
+{
+    list_t again;
+    list_init(&again);
+
+    uint32_t count = 0;
+    list_node_t *node;
+    while (count < max && (node = list_pop_front(&ep->ready)) != NULL) {
+        epoll_item_t *item = list_entry(node, epoll_item_t, ready_node);
+        item->queued = false;
+
+        wait_queue_t *wq;
+        uint32_t mask = epoll_poll_item(item, &wq) &
+                        (item->events | POLL_ALWAYS) & ~EPOLLET;
+        if (mask == 0) {
+            continue;   /* Woken, but consumed by someone else */
+        }
+
+        events[count].events = mask;
+        events[count].data = item->data;
+        count++;
+
+        if ((item->events & EPOLLET) == 0) {
+            list_push_back(&again, &item->ready_node);
+            item->queued = true;
+        }
+    }
+
+    while ((node = list_pop_front(&again)) != NULL) {
+        list_push_back(&ep->ready, node);
+    }
+    return (int)count;
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_create - Create an epoll instance
+ * --------------------------------------------------------------------------- */
+int epoll_create(void)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    if (!epoll_ready) {
+        epoll_init();
+    }
+
+    for (int i = 0; i < EPOLL_MAX_INSTANCES; i++) {
+        if (!epolls[i].valid) {
+            epolls[i].valid = true;
+            kernel_unlock_irqrestore(flags);
+            return i;
+        }
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return -1;  /* EMFILE */
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_ctl - Add, change or remove a watched source
+ * --------------------------------------------------------------------------- */
+int epoll_ctl(int epfd, int op, int32_t source, int32_t id, const kepoll_event_t *event)
+{
+    if (op != EPOLL_CTL_DEL && event == NULL) {
+        return -1;  /* EINVAL */
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    epoll_t *ep = epoll_lookup(epfd);
+    if (ep == NULL) {
+        kernel_unlock_irqrestore(flags);
+        return -1;  /* EBADF */
+    }
+
+    vfs_file_t *file = NULL;
+    if (source == POLL_SRC_FILE) {
+        file = vfs_fget(id, 0);
+        if (file == NULL) {
+            kernel_unlock_irqrestore(flags);
+            return -1;  /* EBADF */
+        }
+    }
+
+    epoll_item_t *item = epoll_find(ep, source, id, file);
+    int result = 0;
+
+    switch (op) {
+        case EPOLL_CTL_ADD: {
+            list_node_t *node = (item == NULL) ? list_pop_front(&epoll_free) : NULL;
+            if (node == NULL) {
+                result = -1;    /* EEXIST or ENOSPC */
+                break;
+            }
+            item = list_entry(node, epoll_item_t, node);
+            item->source = source;
+            item->id = id;
+            item->file = file;
+
+            wait_queue_t *wq;
+            uint32_t mask = epoll_poll_item(item, &wq);
+            if (mask & POLLNVAL) {
+                item->file = NULL;
+                list_push_back(&epoll_free, node);
+                result = -1;    /* EBADF */
+                break;
+            }
+
+            item->ep = ep;
+            if (file != NULL) {
+                epoll_file_items++;
+            }
+            item->events = event->events;
+            item->data = event->data;
+            item->queued = false;
+            item->wq = wq;
+            if (wq != NULL) {
+                wait_queue_add_callback(wq, &item->entry, epoll_notify);
+            }
+            list_push_back(&ep->items, &item->node);
+
+            if (mask & (item->events | POLL_ALWAYS)) {
+                epoll_queue(item);
+            }
+            break;
+        }
+
+        case EPOLL_CTL_MOD: {
+            if (item == NULL) {
+                result = -1;    /* ENOENT */
+                break;
+            }
+            item->events = event->events;
+            item->data = event->data;
+
+            wait_queue_t *wq;
+            if (epoll_poll_item(item, &wq) & (item->events | POLL_ALWAYS)) {
+                epoll_queue(item);
+            }
+            break;
+        }
+
+        case EPOLL_CTL_DEL:
+            if (item == NULL) {
+                result = -1;    /* ENOENT */
+                break;
+            }
+            epoll_release(ep, item);
+            break;
+
+        default:
+            result = -1;        /* EINVAL */
+            break;
+    }
+
+    if (result == 0 && !list_is_empty(&ep->ready)) {
+        wait_queue_wake_all(&ep->waiters);
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_wait - Wait for ready sources
+ * --------------------------------------------------------------------------- */
+int epoll_wait(int epfd, kepoll_event_t *events, uint32_t max, uint32_t timeout)
+{
+    if (events == NULL || max == 0) {
+        return -1;  /* EINVAL */
+    }
+
+    uint32_t deadline = pit_get_ticks() + timeout;
+    uint32_t flags = kernel_lock_irqsave();
+
+    int ready = -1;
+    for (;;) {
+        epoll_t *ep = epoll_lookup(epfd);
+        if (ep == NULL) {
+            ready = -1;     /* EBADF, or closed while we slept */
+            break;
+        }
+
+        ready = epoll_harvest(ep, events, max);
+        if (ready > 0 || timeout == 0) {
+            break;
+        }
+
+        if (timeout == POLL_WAIT_FOREVER) {
+            wait_queue_wait(&ep->waiters);
+            continue;
+        }
+        int32_t remaining = (int32_t)(deadline - pit_get_ticks());
+        if (remaining <= 0) {
+            break;
+        }
+        wait_queue_wait_timeout(&ep->waiters, (uint32_t)remaining);
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return ready;
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_close - Destroy an instance
+ * --------------------------------------------------------------------------- */
+int epoll_close(int epfd)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    epoll_t *ep = epoll_lookup(epfd);
+    if (ep == NULL) {
+        kernel_unlock_irqrestore(flags);
+        return -1;  /* EBADF */
+    }
+
+    list_node_t *node;
+    while ((node = ep->items.head) != NULL) {
+        epoll_release(ep, list_entry(node, epoll_item_t, node));
+    }
+    ep->valid = false;
+    wait_queue_wake_all(&ep->waiters);
+
+    kernel_unlock_irqrestore(flags);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_file_release - Stop watching a file whose last reference is going
+ * ---------------------------------------------------------------------------
+ * Called from file_put() before the filesystem releases the file, so no
+ * item keeps a callback entry on a queue the release may free.
+ * --------------------------------------------------------------------------- */
+void epoll_file_release(struct vfs_file *file)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    for (size_t i = 0; i < EPOLL_MAX_INSTANCES && epoll_file_items > 0; i++) {
+        if (!epolls[i].valid) {
+            continue;
+        }
+        list_node_t *node = epolls[i].items.head;
+        while (node != NULL) {
+            list_node_t *next = node->next;
+            epoll_item_t *item = list_entry(node, epoll_item_t, node);
+            if (item->file == file) {
+                epoll_release(&epolls[i], item);
+            }
+            node = next;
+        }
+    }
+    kernel_unlock_irqrestore(flags);
+}
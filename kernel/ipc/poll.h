@@ -0,0 +1,137 @@
+/*
+ * ===========================================================================
+ * kernel/ipc/poll.h
+ * ===========================================================================
+ *
+ * Readiness Polling Interface
+ *
+ * kpoll() waits until at least one of several event sources (the keyboard,
+ * the serial port, message queues, open files) is ready, so a task can
+ * wait for input and IPC at the same time instead of spinning over
+ * non-blocking calls.
+ *
+ * Each pollable source provides a poll function that reports its ready
+ * mask and the wait queue its producers wake with wait_queue_wake_all().
+ * kpoll() checks every source; if none is ready it watches all their
+ * queues at once and sleeps until one of them is woken.
+ *
+ * epoll:
+ *   kpoll() re-checks every source on each call. An epoll instance instead
+ *   keeps an interest set whose items sit on their sources' wait queues as
+ *   callback entries; a wake puts the item on the instance's ready list.
+ *   epoll_wait() only looks at that list, so its cost follows the number
+ *   of ready sources, not the number watched. Items are level-triggered
+ *   (re-queued while still ready) unless EPOLLET asks for one report per
+ *   wake-up.
+ *
+ *   A POLL_SRC_FILE item watches the open file its descriptor named when
+ *   it was added, not the descriptor number: a descriptor closed and
+ *   reused for another file does not match it. Releasing the last
+ *   reference to a file drops its items from every instance.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_POLL_H
+#define NEXA_POLL_H
+
+#include "../../config/os_config.h"
+#include "../scheduler/sync.h"
+
+/* ---------------------------------------------------------------------------
+ * Event Bits
+ * --------------------------------------------------------------------------- */
+#define POLLIN              0x0001  /* Data to read */
+#define POLLOUT             0x0004  /* Room to write */
+#define POLLERR             0x0008  /* Error (always reported) */
+#define POLLHUP             0x0010  /* Peer gone (always reported) */
+#define POLLNVAL            0x0020  /* Invalid source (always reported) */
+
+/* ---------------------------------------------------------------------------
+ * Sources
+ * --------------------------------------------------------------------------- */
+#define POLL_SRC_KEYBOARD   0       /* id unused */
+#define POLL_SRC_MSGQ       1       /* id = queue ID */
+#define POLL_SRC_SERIAL     2       /* id unused (COM1) */
+#define POLL_SRC_FILE       3       /* id = file descriptor (files, pipe ends) */
+
+#define POLL_MAX_ENTRIES    16      /* Sources per kpoll() call */
+#define POLL_WAIT_FOREVER   WAIT_FOREVER
+
+/* One watched source (shared with user space) */
+typedef struct kpollfd {
+    int32_t source;                 /* POLL_SRC_* */
+    int32_t id;                     /* Object within the source */
+    uint16_t events;                /* Requested POLL* bits */
+    uint16_t revents;               /* Returned POLL* bits */
+} kpollfd_t;
+
+/**
+ * @brief Wait until at least one source is ready
+ *
+ * @param fds     Sources to watch; revents is filled in for each
+ * @param count   Number of entries (at most POLL_MAX_ENTRIES)
+ * @param timeout Ticks to wait at most (0 = just check, POLL_WAIT_FOREVER)
+ * @return Number of entries with revents != 0 (0 on timeout), -1 on error
+ */
+int kpoll(kpollfd_t *fds, uint32_t count, uint32_t timeout);
+
+/* ---------------------------------------------------------------------------
+ * epoll
+ * --------------------------------------------------------------------------- */
+#define EPOLLET             0x8000  /* Edge-triggered: report once per wake */
+
+#define EPOLL_CTL_ADD       1
+#define EPOLL_CTL_DEL       2
+#define EPOLL_CTL_MOD       3
+
+#define EPOLL_MAX_INSTANCES 16      /* epoll instances system-wide */
+#define EPOLL_MAX_ITEMS     128     /* Watched sources system-wide */
+
+/* Requested events on entry to epoll_ctl(), ready events from epoll_wait() */
+typedef struct kepoll_event {
+    uint32_t events;                /* POLL* bits (plus EPOLLET for ctl) */
+    uint32_t data;                  /* Caller's cookie, returned as is */
+} kepoll_event_t;
+
+/**
+ * @brief Create an epoll instance
+ * @return Instance descriptor, or -1 if none are free
+ */
+int epoll_create(void);
+
+/**
+ * @brief Add, change or remove a watched source
+ *
+ * @param epfd   Instance from epoll_create()
+ * @param op     EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL
+ * @param source POLL_SRC_*
+ * @param id     Object within the source (for files, resolved to the open file)
+ * @param event  Events and cookie (ignored for EPOLL_CTL_DEL)
+ * @return 0 on success, -1 on error (bad source, duplicate, no room)
+ */
+int epoll_ctl(int epfd, int op, int32_t source, int32_t id, const kepoll_event_t *event);
+
+/**
+ * @brief Wait for ready sources
+ *
+ * @param epfd      Instance from epoll_create()
+ * @param events    Output array
+ * @param max       Entries in 'events'
+ * @param timeout   Ticks to wait at most (0 = just check, POLL_WAIT_FOREVER)
+ * @return Number of events stored (0 on timeout), -1 on error
+ */
+int epoll_wait(int epfd, kepoll_event_t *events, uint32_t max, uint32_t timeout);
+
+/**
+ * @brief Destroy an instance and stop watching all of its sources
+ * @return 0 on success, -1 on a bad descriptor
+ */
+int epoll_close(int epfd);
+
+struct vfs_file;
+
+/** @brief Drop the items watching an open file that is being released (vfs.c) */
+void epoll_file_release(struct vfs_file *file);
+
+#endif /* NEXA_POLL_H */
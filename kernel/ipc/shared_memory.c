@@ -15,15 +15,23 @@
  * - Reference counting for safe cleanup
  * - Key-based identification
  *
- * Memory is allocated from the kernel heap. In a more advanced implementation,
- * this would use virtual memory mapping to share physical pages between
- * address spaces.
+ * Memory:
+ *   A region is a run of whole frames from frame_alloc_contiguous(), so
+ *   large buffers never touch the kernel heap. Attaching maps those frames
+ *   into the caller's mmap window (at the requested address, or wherever
+ *   there is room). Tasks without paging get the identity-mapped frames.
+ *
+ * Attachments:
+ *   Each mapped attachment is the owner of its vm area, so when a task
+ *   exits without detaching, address space teardown drops exactly that
+ *   attachment - no search of the attachment table.
  *
  * ===========================================================================
  */
 
 #include "../../config/os_config.h"
 #include "../memory/memory.h"
+#include "../scheduler/task.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions
@@ -44,8 +52,8 @@ extern void *memset(void *s, int c, size_t n);
 typedef struct {
     bool valid;                         /* Is this slot in use? */
     uint32_t key;                       /* Region identifier key */
-    void *data;                         /* Pointer to allocated memory */
-    size_t size;                        /* Size of region in bytes */
+    void *data;                         /* First frame (identity-mapped) */
+    size_t size;                        /* Size of region in bytes (whole pages) */
     uint32_t ref_count;                 /* Number of current attachments */
     uint32_t creator_pid;               /* PID of creating task */
 } shm_region_t;
@@ -60,6 +68,7 @@ typedef struct {
     int shm_id;                         /* Shared memory region ID */
     uint32_t task_pid;                  /* Task that attached */
     void *attached_addr;                /* Address where attached */
+    address_space_t *as;                /* Mapped into (NULL = identity) */
 } shm_attachment_t;
 
 /* ---------------------------------------------------------------------------
@@ -69,6 +78,42 @@ static shm_region_t shm_regions[MAX_SHM_REGIONS];
 static shm_attachment_t attachments[MAX_ATTACHMENTS];
 static bool shm_initialized = false;
 
+/* ---------------------------------------------------------------------------
+ * Helper: PID of the running task (0 = kernel)
+ * --------------------------------------------------------------------------- */
+static uint32_t current_pid(void)
+{
+    task_t *task = task_current();
+    return (task != NULL) ? task->pid : 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Drop one attachment
+ * --------------------------------------------------------------------------- */
+static void attachment_drop(shm_attachment_t *attachment)
+{
+    int shm_id = attachment->shm_id;
+
+    attachment->valid = false;
+    attachment->shm_id = 0;
+    attachment->task_pid = 0;
+    attachment->attached_addr = NULL;
+    attachment->as = NULL;
+
+    /* Decrement reference count */
+    if (shm_id >= 0 && shm_id < MAX_SHM_REGIONS) {
+        if (shm_regions[shm_id].ref_count > 0) {
+            shm_regions[shm_id].ref_count--;
+        }
+    }
+}
+
+/* vm_release_t: the mapping went away (detach or address space teardown) */
+static void shm_area_release(void *owner)
+{
+    attachment_drop((shm_attachment_t *)owner);
+}
+
 /* ---------------------------------------------------------------------------
  * shm_init - Initialize the shared memory subsystem
  * --------------------------------------------------------------------------- */
@@ -77,7 +122,7 @@ void shm_init(void)
     if (shm_initialized) {
         return;
     }
-    
+
     /* Clear all region slots */
     memset(shm_regions, 0, sizeof(shm_regions));
     for (size_t i = 0; i < MAX_SHM_REGIONS; i++) {
@@ -88,13 +133,13 @@ void shm_init(void)
         shm_regions[i].ref_count = 0;
         shm_regions[i].creator_pid = 0;
     }
-    
+
     /* Clear all attachment slots */
     memset(attachments, 0, sizeof(attachments));
     for (size_t i = 0; i < MAX_ATTACHMENTS; i++) {
         attachments[i].valid = false;
     }
-    
+
     shm_initialized = true;
 }
 
@@ -103,7 +148,7 @@ void shm_init(void)
  * ---------------------------------------------------------------------------
  * Parameters:
  *   key  - Unique identifier for the region
- *   size - Size of the region in bytes
+ *   size - Size of the region in bytes (rounded up to whole pages)
  *
  * Returns:
  *   Shared memory ID (>= 0) on success, -1 on error
@@ -113,12 +158,12 @@ int shm_create(uint32_t key, size_t size)
     if (!shm_initialized) {
         return -1;
     }
-    
+
     /* Validate size */
     if (size < SHM_MIN_SIZE || size > SHM_MAX_SIZE) {
         return -1;
     }
-    
+
     /* Check if region with this key already exists */
     for (size_t i = 0; i < MAX_SHM_REGIONS; i++) {
         if (shm_regions[i].valid && shm_regions[i].key == key) {
@@ -129,7 +174,7 @@ int shm_create(uint32_t key, size_t size)
             return -1;  /* Size mismatch */
         }
     }
-    
+
     /* Find an empty slot */
     int slot = -1;
     for (size_t i = 0; i < MAX_SHM_REGIONS; i++) {
@@ -138,31 +183,31 @@ int shm_create(uint32_t key, size_t size)
             break;
         }
     }
-    
+
     if (slot < 0) {
         return -1;  /* No free slots */
     }
-    
-    /* Align size to page boundary for efficiency */
-    size_t aligned_size = ALIGN_UP(size, 64);
-    
-    /* Allocate memory */
-    void *data = kmalloc(aligned_size);
-    if (data == NULL) {
+
+    /* Whole frames, so the region can be mapped page by page */
+    size_t aligned_size = ALIGN_UP(size, PAGE_SIZE);
+
+    uintptr_t frames = frame_alloc_contiguous(aligned_size / PAGE_SIZE);
+    if (frames == 0) {
         return -1;  /* Out of memory */
     }
-    
+    void *data = (void *)frames;
+
     /* Initialize the memory to zero */
     memset(data, 0, aligned_size);
-    
+
     /* Initialize the region */
     shm_regions[slot].valid = true;
     shm_regions[slot].key = key;
     shm_regions[slot].data = data;
     shm_regions[slot].size = aligned_size;
     shm_regions[slot].ref_count = 0;
-    shm_regions[slot].creator_pid = 0;  /* TODO: Get current task PID */
-    
+    shm_regions[slot].creator_pid = current_pid();
+
     return slot;
 }
 
@@ -180,13 +225,13 @@ int shm_get(uint32_t key)
     if (!shm_initialized) {
         return -1;
     }
-    
+
     for (size_t i = 0; i < MAX_SHM_REGIONS; i++) {
         if (shm_regions[i].valid && shm_regions[i].key == key) {
             return (int)i;
         }
     }
-    
+
     return -1;
 }
 
@@ -195,28 +240,27 @@ int shm_get(uint32_t key)
  * ---------------------------------------------------------------------------
  * Parameters:
  *   shm_id - Shared memory ID
- *   addr   - Preferred address (NULL for any) - currently ignored
+ *   addr   - Page-aligned address in the mmap window, or NULL for any
  *
  * Returns:
- *   Pointer to shared memory on success, NULL on error
+ *   Pointer to shared memory on success, NULL on error (including addr
+ *   overlapping an existing mapping)
  *
- * Note: In a full virtual memory implementation, this would map the physical
- * pages into the calling task's address space. In this simplified version,
- * we return the kernel heap pointer directly (works for kernel tasks).
+ * Note: The region's frames are mapped into the calling task's address
+ * space. When paging is off the frames are returned directly (identity
+ * mapped), which only kernel tasks can use; addr must be NULL then.
  * --------------------------------------------------------------------------- */
 void *shm_attach(int shm_id, void *addr)
 {
-    UNUSED(addr);  /* Address hint not used in this implementation */
-    
     if (!shm_initialized || shm_id < 0 || shm_id >= MAX_SHM_REGIONS) {
         return NULL;
     }
-    
+
     shm_region_t *region = &shm_regions[shm_id];
     if (!region->valid || region->data == NULL) {
         return NULL;
     }
-    
+
     /* Find an attachment slot */
     int attach_slot = -1;
     for (size_t i = 0; i < MAX_ATTACHMENTS; i++) {
@@ -225,28 +269,55 @@ void *shm_attach(int shm_id, void *addr)
             break;
         }
     }
-    
+
     if (attach_slot < 0) {
         return NULL;  /* No attachment slots */
     }
-    
+    shm_attachment_t *attachment = &attachments[attach_slot];
+
+    address_space_t *as = address_space_current(true);
+    void *mapped = region->data;
+    if (as != NULL) {
+        uintptr_t start = (addr != NULL)
+            ? vm_area_reserve_at(as, (uintptr_t)addr, region->size, shm_area_release, attachment)
+            : vm_area_reserve(as, region->size, shm_area_release, attachment);
+        if (start == 0) {
+            return NULL;  /* Address taken or window full */
+        }
+        mapped = (void *)start;
+    } else if (addr != NULL) {
+        return NULL;  /* No address space to place it in */
+    }
+
     /* Record the attachment */
-    attachments[attach_slot].valid = true;
-    attachments[attach_slot].shm_id = shm_id;
-    attachments[attach_slot].task_pid = 0;  /* TODO: Get current task PID */
-    attachments[attach_slot].attached_addr = region->data;
-    
+    attachment->valid = true;
+    attachment->shm_id = shm_id;
+    attachment->task_pid = current_pid();
+    attachment->attached_addr = mapped;
+    attachment->as = as;
+
     /* Increment reference count */
     region->ref_count++;
-    
-    return region->data;
+
+    if (as != NULL) {
+        for (size_t offset = 0; offset < region->size; offset += PAGE_SIZE) {
+            if (!paging_map(as, (uintptr_t)mapped + offset,
+                            (uintptr_t)region->data + offset,
+                            PAGE_USER | PAGE_WRITABLE)) {
+                vm_area_release(as, (uintptr_t)mapped, 0);  /* Drops the attachment */
+                return NULL;
+            }
+        }
+    }
+
+    return mapped;
 }
 
 /* ---------------------------------------------------------------------------
  * shm_detach - Detach from a shared memory region
  * ---------------------------------------------------------------------------
  * Parameters:
- *   addr - Address previously returned by shm_attach()
+ *   addr - Address previously returned by shm_attach() in this task
  *
  * Returns:
  *   0 on success, -1 on error
@@ -256,29 +327,24 @@ int shm_detach(void *addr)
     if (!shm_initialized || addr == NULL) {
         return -1;
     }
-    
+
+    address_space_t *as = address_space_current(false);
+
     /* Find the attachment by address */
     for (size_t i = 0; i < MAX_ATTACHMENTS; i++) {
-        if (attachments[i].valid && attachments[i].attached_addr == addr) {
-            int shm_id = attachments[i].shm_id;
-            
-            /* Clear the attachment */
-            attachments[i].valid = false;
-            attachments[i].shm_id = 0;
-            attachments[i].task_pid = 0;
-            attachments[i].attached_addr = NULL;
-            
-            /* Decrement reference count */
-            if (shm_id >= 0 && shm_id < MAX_SHM_REGIONS) {
-                if (shm_regions[shm_id].ref_count > 0) {
-                    shm_regions[shm_id].ref_count--;
-                }
+        shm_attachment_t *attachment = &attachments[i];
+        if (attachment->valid && attachment->attached_addr == addr &&
+            attachment->as == as) {
+            if (as != NULL) {
+                /* Unmaps, then drops the attachment through the area owner */
+                vm_area_release(as, (uintptr_t)addr, 0);
+            } else {
+                attachment_drop(attachment);
             }
-            
             return 0;
         }
     }
-    
+
     return -1;  /* Attachment not found */
 }
 
@@ -298,30 +364,30 @@ int shm_destroy(int shm_id)
     if (!shm_initialized || shm_id < 0 || shm_id >= MAX_SHM_REGIONS) {
         return -1;
     }
-    
+
     shm_region_t *region = &shm_regions[shm_id];
     if (!region->valid) {
         return -1;
     }
-    
+
     /* Cannot destroy if there are active attachments */
     if (region->ref_count > 0) {
         return -1;
     }
-    
-    /* Free the memory */
+
+    /* Give the frames back */
     if (region->data != NULL) {
-        kfree(region->data);
+        frame_free_contiguous((uintptr_t)region->data, region->size / PAGE_SIZE);
         region->data = NULL;
     }
-    
+
     /* Clear the region */
     region->valid = false;
     region->key = 0;
     region->size = 0;
     region->ref_count = 0;
     region->creator_pid = 0;
-    
+
     return 0;
 }
 
@@ -339,12 +405,12 @@ size_t shm_get_size(int shm_id)
     if (!shm_initialized || shm_id < 0 || shm_id >= MAX_SHM_REGIONS) {
         return 0;
     }
-    
+
     shm_region_t *region = &shm_regions[shm_id];
     if (!region->valid) {
         return 0;
     }
-    
+
     return region->size;
 }
 
@@ -356,7 +422,7 @@ size_t shm_count(void)
     if (!shm_initialized) {
         return 0;
     }
-    
+
     size_t count = 0;
     for (size_t i = 0; i < MAX_SHM_REGIONS; i++) {
         if (shm_regions[i].valid) {
@@ -15,18 +15,33 @@
  * 3. Initialize memory management (frame allocator, heap)
  * 4. Initialize interrupt handling (IDT, PIC, ISR, IRQ)
  * 5. Initialize device drivers (timer, keyboard)
- * 6. Initialize scheduler (TODO)
- * 7. Enter main loop or start first process
+ * 6. Initialize scheduler, create the main and init tasks
+ * 7. Start the scheduler
+ *
+ * The init task then loads RAMFS images and prints the boot timeline, the
+ * time from kernel entry to the end of each phase. The demo self-tests
+ * run only with "selftest" on the kernel command line.
  *
  * ===========================================================================
  */
 
+#include <lib/cstd/stdio.h>
 #include "../config/os_config.h"
 #include "memory/memory.h"
+#include "memory/dsa_structures/buddy.h"
+#include "memory/dsa_structures/freelist.h"
 #include "interrupts/interrupts.h"
 #include "drivers/drivers.h"
 #include "scheduler/scheduler.h"
 #include "scheduler/task.h"
+#include "fs/vfs.h"
+#include "fs/buffer_cache.h"
+#include "fs/ramfs_image.h"
+#include "utils/logging.h"
+#include "utils/bench.h"
+#include "utils/perf.h"
+#include "utils/crashdump.h"
+#include "ipc/poll.h"
 
 /* ---------------------------------------------------------------------------
  * Multiboot Information Structure
@@ -42,9 +57,36 @@ typedef struct multiboot_info {
     uint32_t cmdline;           /* Kernel command line */
     uint32_t mods_count;        /* Number of modules loaded */
     uint32_t mods_addr;         /* Address of module structures */
+    uint32_t syms[4];           /* a.out / ELF symbol information */
+    uint32_t mmap_length;       /* Bytes of memory map entries */
+    uint32_t mmap_addr;         /* Address of the first entry */
     /* ... more fields we don't use yet ... */
 } __attribute__((packed)) multiboot_info_t;
 
+/* Multiboot flag bits */
+#define MULTIBOOT_FLAG_MEM      0x001   /* mem_lower/mem_upper valid */
+#define MULTIBOOT_FLAG_CMDLINE  0x004   /* cmdline valid */
+#define MULTIBOOT_FLAG_MODS     0x008   /* mods_count/mods_addr valid */
+#define MULTIBOOT_FLAG_MMAP     0x040   /* mmap_length/mmap_addr valid */
+
+/* One memory map entry; 'size' does not count itself */
+typedef struct multiboot_mmap_entry {
+    uint32_t size;
+    uint64_t base_addr;
+    uint64_t length;
+    uint32_t type;              /* MULTIBOOT_MEMORY_AVAILABLE = usable RAM */
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+/* One boot module (page-aligned: the header sets MULTIBOOT_ALIGN) */
+typedef struct multiboot_module {
+    uint32_t mod_start;
+    uint32_t mod_end;           /* One past the last byte */
+    uint32_t cmdline;
+    uint32_t pad;
+} __attribute__((packed)) multiboot_module_t;
+
 /* ---------------------------------------------------------------------------
  * External Functions (from assembly)
  * --------------------------------------------------------------------------- */
@@ -52,12 +94,18 @@ extern void cpu_halt(void);         /* Halt the CPU */
 extern void cpu_cli(void);          /* Disable interrupts */
 extern void cpu_sti(void);          /* Enable interrupts */
 extern uint32_t cpu_get_flags(void); /* Get EFLAGS */
+extern void outb(uint16_t port, uint8_t value);
 
 /* ---------------------------------------------------------------------------
  * External Functions (from syscall.c)
  * --------------------------------------------------------------------------- */
 extern void syscall_init(void);     /* Initialize syscall handler (INT 0x80) */
 
+/* ---------------------------------------------------------------------------
+ * External Functions (from lib/cstd/memory.c)
+ * --------------------------------------------------------------------------- */
+extern void mem_init(void);         /* Pick memcpy/memset variants from CPUID */
+
 /* ---------------------------------------------------------------------------
  * Forward Declarations
  * --------------------------------------------------------------------------- */
@@ -65,8 +113,8 @@ static void early_console_init(void);
 static void early_console_print(const char *str);
 static void early_console_print_hex(uint32_t value);
 static void early_console_print_dec(uint32_t value);
+static void early_console_print_cell(const char *text, size_t width);
 static void early_console_update_cursor(void);
-static void clear_bss(void);
 static void init_memory(multiboot_info_t *mb_info);
 static void init_interrupts(void);
 static void init_drivers(void);
@@ -74,6 +122,50 @@ static void init_scheduler_subsystem(void);
 static void memory_test(void);
 static void interrupt_test(void);
 static void scheduler_test(void);
+static bool cmdline_has(multiboot_info_t *mb_info, const char *word);
+static void save_boot_modules(multiboot_info_t *mb_info);
+static void load_ramfs_images(multiboot_info_t *mb_info);
+static void boot_mark(const char *phase);
+
+/* Columns of the value cell and of a whole row on the boxed stats screens */
+#define STATS_CELL_WIDTH    26
+#define STATS_ROW_WIDTH     60
+
+/* QEMU isa-debug-exit port (make bench adds the device) */
+#define QEMU_DEBUG_EXIT_PORT    0xF4
+
+/* "bench" on the command line: run the benchmarks instead of the demo */
+static bool boot_bench = false;
+
+/* "selftest" on the command line: run the boot-time subsystem tests */
+static bool boot_selftest = false;
+
+/* ---------------------------------------------------------------------------
+ * Boot Timeline
+ * ---------------------------------------------------------------------------
+ * boot_mark() stamps the end of each boot phase with the TSC, counted from
+ * kernel_main() entry. The post-boot init task prints the table once the
+ * system is ready, by which time the TSC has been calibrated.
+ * --------------------------------------------------------------------------- */
+#define BOOT_MAX_MARKS      16
+
+typedef struct {
+    const char *phase;
+    uint64_t tsc;
+} boot_mark_t;
+
+static uint64_t boot_entry_tsc;
+static boot_mark_t boot_marks[BOOT_MAX_MARKS];
+static uint32_t boot_mark_count = 0;
+
+/*
+ * Boot modules, copied out of the Multiboot structures (which live in
+ * memory the kernel does not reserve) for the post-boot init task.
+ */
+#define BOOT_MAX_MODULES    8
+
+static multiboot_module_t boot_modules[BOOT_MAX_MODULES];
+static multiboot_info_t boot_module_info;
 
 /* ---------------------------------------------------------------------------
  * VGA Text Mode Constants
@@ -93,8 +185,6 @@ static int vga_col = 0;
 /* ---------------------------------------------------------------------------
  * BSS Section Symbols (from linker script)
  * --------------------------------------------------------------------------- */
-extern char _bss_start[];
-extern char _bss_end[];
 extern char _kernel_start[];
 extern char _kernel_end[];
 
@@ -112,14 +202,21 @@ void kernel_main(multiboot_info_t *multiboot_info)
     /* Ensure interrupts are disabled during initialization */
     cpu_cli();
 
+    /* BSS was zeroed by bootloader.asm; time the boot from here */
+    boot_entry_tsc = clock_cycles();
+
     /* Initialize serial port for early debugging output to terminal */
     serial_init();
 
-    /* Clear BSS section (uninitialized globals should be zero) */
-    clear_bss();
+    /* Report the crash that ended the previous boot, if it left a dump */
+    bool had_crashdump = crashdump_export();
+
+    /* Choose string-instruction and non-temporal copy paths for this CPU */
+    mem_init();
 
     /* Initialize early console for output */
     early_console_init();
+    boot_mark("early console");
 
     /* Print welcome banner */
     early_console_print("\n");
@@ -136,6 +233,10 @@ void kernel_main(multiboot_info_t *multiboot_info)
     early_console_print("                      |\n");
     early_console_print("+========================================================+\n\n");
 
+    if (had_crashdump) {
+        early_console_print("[BOOT] Crash dump from the previous boot sent to serial\n");
+    }
+
     /* Display boot information */
     early_console_print("[BOOT] Kernel loaded at: 0x");
     early_console_print_hex((uint32_t)(uintptr_t)_kernel_start);
@@ -169,6 +270,10 @@ void kernel_main(multiboot_info_t *multiboot_info)
             early_console_print_dec(multiboot_info->mem_upper / 1024);
             early_console_print(" MB)\n");
         }
+
+        boot_bench = cmdline_has(multiboot_info, "bench");
+        boot_selftest = cmdline_has(multiboot_info, "selftest");
+        save_boot_modules(multiboot_info);
     }
 
     /* -----------------------------------------------------------------------
@@ -178,6 +283,7 @@ void kernel_main(multiboot_info_t *multiboot_info)
     early_console_print("|  Initializing physical frame allocator and kernel heap   |\n");
     early_console_print("+----------------------------------------------------------+\n");
     init_memory(multiboot_info);
+    boot_mark("memory");
 
     /* -----------------------------------------------------------------------
      * Phase 2: Interrupt Handling
@@ -186,6 +292,7 @@ void kernel_main(multiboot_info_t *multiboot_info)
     early_console_print("| Setting up IDT, ISR handlers, IRQ handlers, and PIC     |\n");
     early_console_print("+----------------------------------------------------------+\n");
     init_interrupts();
+    boot_mark("interrupts");
 
     /* -----------------------------------------------------------------------
      * Phase 3: Device Drivers
@@ -194,6 +301,7 @@ void kernel_main(multiboot_info_t *multiboot_info)
     early_console_print("| Initializing VGA, PIT Timer, and PS/2 Keyboard drivers  |\n");
     early_console_print("+----------------------------------------------------------+\n");
     init_drivers();
+    boot_mark("drivers");
 
     /* -----------------------------------------------------------------------
      * Phase 4: Scheduler
@@ -202,30 +310,26 @@ void kernel_main(multiboot_info_t *multiboot_info)
     early_console_print("| Initializing round-robin scheduler and creating tasks   |\n");
     early_console_print("+----------------------------------------------------------+\n");
     init_scheduler_subsystem();
-
-    /* -----------------------------------------------------------------------
-     * Memory Test (optional - demonstrates working allocation)
-     * ----------------------------------------------------------------------- */
-    early_console_print("\n+-------------- TEST: HEAP MEMORY ALLOCATOR ---------------+\n");
-    early_console_print("| Demonstrating kmalloc(), kfree(), kcalloc() operations   |\n");
-    early_console_print("+----------------------------------------------------------+\n");
-    memory_test();
-
-    /* -----------------------------------------------------------------------
-     * Interrupt Test (demonstrates working interrupt handling)
-     * ----------------------------------------------------------------------- */
-    early_console_print("\n+-------------- TEST: INTERRUPT SUBSYSTEM -----------------+\n");
-    early_console_print("| Verifying IDT, PIC remapping, and IRQ handlers          |\n");
-    early_console_print("+----------------------------------------------------------+\n");
-    interrupt_test();
-
-    /* -----------------------------------------------------------------------
-     * Scheduler Test (demonstrates working multitasking)
-     * ----------------------------------------------------------------------- */
-    early_console_print("\n+------------ TEST: MULTITASKING SCHEDULER ----------------+\n");
-    early_console_print("| Creating demo tasks to demonstrate context switching     |\n");
-    early_console_print("+----------------------------------------------------------+\n");
-    scheduler_test();
+    boot_mark("scheduler");
+
+    if (boot_selftest) {
+        /* -------------------------------------------------------------------
+         * Memory Test (demonstrates working allocation)
+         * ------------------------------------------------------------------- */
+        early_console_print("\n+-------------- TEST: HEAP MEMORY ALLOCATOR ---------------+\n");
+        early_console_print("| Demonstrating kmalloc(), kfree(), kcalloc() operations   |\n");
+        early_console_print("+----------------------------------------------------------+\n");
+        memory_test();
+
+        /* -------------------------------------------------------------------
+         * Interrupt Test (demonstrates working interrupt handling)
+         * ------------------------------------------------------------------- */
+        early_console_print("\n+-------------- TEST: INTERRUPT SUBSYSTEM -----------------+\n");
+        early_console_print("| Verifying IDT, PIC remapping, and IRQ handlers          |\n");
+        early_console_print("+----------------------------------------------------------+\n");
+        interrupt_test();
+        boot_mark("self-tests");
+    }
 
     early_console_print("\n+========================================================+\n");
     early_console_print("|              BOOT SEQUENCE COMPLETE!                   |\n");
@@ -243,6 +347,7 @@ void kernel_main(multiboot_info_t *multiboot_info)
      * After this point, execution continues via scheduled tasks.
      */
     early_console_print("[SCHED] Entering scheduler...\n");
+    boot_mark("scheduler start");
     scheduler_start();
 
     /*
@@ -280,6 +385,208 @@ void kernel_main(multiboot_info_t *multiboot_info)
     }
 }
 
+/* Print one line per frame allocator zone */
+static void print_frame_zones(void)
+{
+    early_console_print("\n  MEMORY ZONES:\n");
+    for (int z = 0; z < FRAME_ZONE_COUNT; z++) {
+        frame_zone_stats_t zone;
+        if (!frame_get_zone_stats((frame_zone_t)z, &zone) || zone.total_frames == 0) {
+            continue;
+        }
+        early_console_print("  ");
+        early_console_print(zone.name);
+        early_console_print("\t0x");
+        early_console_print_hex(zone.start);
+        early_console_print("-0x");
+        early_console_print_hex(zone.end);
+        early_console_print("  free ");
+        early_console_print_dec(zone.free_frames);
+        early_console_print("/");
+        early_console_print_dec(zone.total_frames);
+        early_console_print("  reserved ");
+        early_console_print_dec(zone.reserved_frames);
+        early_console_print("  watermark ");
+        early_console_print_dec(zone.watermark);
+        if (zone.fallback_allocs) {
+            early_console_print("  fallbacks ");
+            early_console_print_dec(zone.fallback_allocs);
+        }
+        if (zone.has_buddy) {
+            early_console_print("  [buddy]");
+        }
+        early_console_print("\n");
+    }
+}
+
+/* True if 'word' appears as a whole word on the kernel command line */
+static bool cmdline_has(multiboot_info_t *mb_info, const char *word)
+{
+    if (!(mb_info->flags & MULTIBOOT_FLAG_CMDLINE) || mb_info->cmdline == 0) {
+        return false;
+    }
+
+    const char *p = (const char *)(uintptr_t)mb_info->cmdline;
+    while (*p != '\0') {
+        while (*p == ' ') {
+            p++;
+        }
+        const char *w = word;
+        while (*w != '\0' && *p == *w) {
+            p++;
+            w++;
+        }
+        if (*w == '\0' && (*p == ' ' || *p == '\0')) {
+            return true;
+        }
+        while (*p != ' ' && *p != '\0') {
+            p++;
+        }
+    }
+    return false;
+}
+
+/* ---------------------------------------------------------------------------
+ * Multiboot Memory Map Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Iterate over the entries of the multiboot memory map */
+#define mmap_for_each(entry, mb_info)                                          \
+    for (multiboot_mmap_entry_t *entry =                                       \
+             (multiboot_mmap_entry_t *)(uintptr_t)(mb_info)->mmap_addr;        \
+         (uintptr_t)entry < (mb_info)->mmap_addr + (mb_info)->mmap_length;     \
+         entry = (multiboot_mmap_entry_t *)((uintptr_t)entry + entry->size + 4))
+
+/* End of the highest usable RAM range below 4GB, or 0 if none */
+static uint64_t mmap_highest_usable(multiboot_info_t *mb_info)
+{
+    uint64_t top = 0;
+
+    mmap_for_each(entry, mb_info) {
+        uint64_t end = entry->base_addr + entry->length;
+        if (entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->base_addr < 0x100000000ULL) {
+            if (end > 0x100000000ULL) {
+                end = 0x100000000ULL;
+            }
+            if (end > top) {
+                top = end;
+            }
+        }
+    }
+    return top;
+}
+
+/*
+ * Exclude every part of [start, end) that no usable entry covers - firmware
+ * areas and holes alike. The map is not guaranteed to be sorted, so each
+ * step looks for an entry covering the cursor, or else the nearest one
+ * above it. Returns the number of bytes excluded.
+ */
+static uint32_t exclude_memory_holes(multiboot_info_t *mb_info, uint64_t start, uint64_t end)
+{
+    uint64_t cursor = start;
+    uint32_t excluded = 0;
+
+    while (cursor < end) {
+        uint64_t covered_to = cursor;
+        uint64_t next_base = end;
+
+        mmap_for_each(entry, mb_info) {
+            if (entry->type != MULTIBOOT_MEMORY_AVAILABLE) {
+                continue;
+            }
+            uint64_t base = entry->base_addr;
+            uint64_t top = base + entry->length;
+
+            if (base <= cursor && top > covered_to) {
+                covered_to = top;
+            } else if (base > cursor && base < next_base) {
+                next_base = base;
+            }
+        }
+
+        if (covered_to > cursor) {
+            cursor = covered_to;
+            continue;
+        }
+
+        frame_exclude((uintptr_t)cursor, (size_t)(next_base - cursor));
+        excluded += (uint32_t)(next_base - cursor);
+        cursor = next_base;
+    }
+
+    return excluded;
+}
+
+/* ---------------------------------------------------------------------------
+ * Multiboot Module Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Iterate over the boot modules (none unless MULTIBOOT_FLAG_MODS is set) */
+#define modules_for_each(mod, mb_info)                                         \
+    for (multiboot_module_t *mod = (multiboot_module_t *)(uintptr_t)(mb_info)->mods_addr; \
+         ((mb_info)->flags & MULTIBOOT_FLAG_MODS) &&                           \
+         mod < (multiboot_module_t *)(uintptr_t)(mb_info)->mods_addr + (mb_info)->mods_count; \
+         mod++)
+
+/* Keep the frame allocator away from module contents */
+static void reserve_modules(multiboot_info_t *mb_info)
+{
+    modules_for_each(mod, mb_info) {
+        if (mod->mod_end > mod->mod_start) {
+            frame_reserve(mod->mod_start, mod->mod_end - mod->mod_start);
+        }
+    }
+}
+
+/* Keep the module list for the init task (modules past BOOT_MAX_MODULES stay reserved) */
+static void save_boot_modules(multiboot_info_t *mb_info)
+{
+    uint32_t count = 0;
+    modules_for_each(mod, mb_info) {
+        if (count == BOOT_MAX_MODULES) {
+            break;
+        }
+        boot_modules[count++] = *mod;
+    }
+    boot_module_info.flags = MULTIBOOT_FLAG_MODS;
+    boot_module_info.mods_count = count;
+    boot_module_info.mods_addr = (uint32_t)(uintptr_t)boot_modules;
+}
+
+/*
+ * Adopt every module that is a RAMFS snapshot image. File pages stay in
+ * place and belong to RAMFS from then on; the header, inode and name pages
+ * are only read while loading, so they go back to the frame allocator.
+ */
+static void load_ramfs_images(multiboot_info_t *mb_info)
+{
+    modules_for_each(mod, mb_info) {
+        size_t size = mod->mod_end - mod->mod_start;
+        ramfs_image_header_t *header = (ramfs_image_header_t *)(uintptr_t)mod->mod_start;
+        if (mod->mod_end <= mod->mod_start || size < sizeof(ramfs_image_header_t) ||
+            header->magic != RAMFS_IMAGE_MAGIC) {
+            continue;
+        }
+
+        uint32_t data_offset = header->data_offset;
+        int entries = ramfs_image_load(header, size);
+        early_console_print("  RAMFS image at 0x");
+        early_console_print_hex(mod->mod_start);
+        if (entries < 0) {
+            early_console_print(": invalid or only partly loaded\n");
+            continue;
+        }
+        early_console_print(": ");
+        early_console_print_dec((uint32_t)entries);
+        early_console_print(" entries\n");
+
+        for (uint32_t offset = 0; offset < data_offset; offset += PAGE_SIZE) {
+            frame_free(mod->mod_start + offset);
+        }
+    }
+}
+
 /* ---------------------------------------------------------------------------
  * init_memory - Initialize memory management subsystem
  * ---------------------------------------------------------------------------
@@ -291,8 +598,14 @@ static void init_memory(multiboot_info_t *mb_info)
     uint32_t usable_memory_start;
     uint32_t usable_memory_size;
 
-    /* Determine total memory from multiboot info */
-    if (mb_info != NULL && (mb_info->flags & 0x1)) {
+    bool have_mmap = mb_info != NULL && (mb_info->flags & MULTIBOOT_FLAG_MMAP) &&
+                     mb_info->mmap_length != 0;
+    uint64_t mmap_top = have_mmap ? mmap_highest_usable(mb_info) : 0;
+
+    /* Determine total memory from multiboot info (memory map preferred) */
+    if (mmap_top > 0x200000) {
+        total_memory = mmap_top > MAX_PHYSICAL_MEMORY ? MAX_PHYSICAL_MEMORY : (uint32_t)mmap_top;
+    } else if (mb_info != NULL && (mb_info->flags & MULTIBOOT_FLAG_MEM)) {
         /* mem_upper is KB of memory starting at 1MB */
         total_memory = (mb_info->mem_upper + 1024) * 1024;  /* Convert to bytes */
     } else {
@@ -318,7 +631,11 @@ static void init_memory(multiboot_info_t *mb_info)
 
     early_console_print("\n  MEMORY DETECTION:\n");
     early_console_print("  +----------------------------------------------------------+\n");
-    early_console_print("  | Source: Multiboot (from GRUB bootloader)                 |\n");
+    if (have_mmap) {
+        early_console_print("  | Source: Multiboot memory map (from GRUB bootloader)      |\n");
+    } else {
+        early_console_print("  | Source: Multiboot (from GRUB bootloader)                 |\n");
+    }
     early_console_print("  | Total Physical Memory: ");
     early_console_print_dec(total_memory / (1024 * 1024));
     early_console_print(" MB                             |\n");
@@ -355,11 +672,25 @@ static void init_memory(multiboot_info_t *mb_info)
         /* Reserve kernel memory region */
         frame_reserve((uintptr_t)_kernel_start, 
                       (size_t)(_kernel_end - _kernel_start));
+        if (mb_info != NULL) {
+            reserve_modules(mb_info);
+        }
         
         early_console_print("\n  After reserving kernel region:\n");
         early_console_print("        1111111111111111111111111100000000000000000000000000000000000000\n");
         early_console_print("        ^~~~~~~~~~~~~~~~~~~~~~~~^\n");
         early_console_print("        Kernel code/data (RESERVED)\n");
+
+        /* Firmware areas and holes inside the managed range are not RAM */
+        if (have_mmap) {
+            uint32_t excluded = exclude_memory_holes(mb_info, usable_memory_start,
+                                                     (uint64_t)usable_memory_start + usable_memory_size);
+            early_console_print("\n  Memory map holes excluded: ");
+            early_console_print_dec(excluded / 1024);
+            early_console_print(" KB\n");
+        }
+
+        print_frame_zones();
     } else {
         early_console_print("  | Status:         FAILED                                  |\n");
         early_console_print("  +----------------------------------------------------------+\n");
@@ -412,6 +743,47 @@ static void init_memory(multiboot_info_t *mb_info)
         PANIC("Failed to allocate memory for kernel heap");
     }
 
+#ifdef USE_BUDDY_FRAME_ALLOCATOR
+    /* Hand what is left after the kernel and heap to the buddy tree */
+    early_console_print("\n  BUDDY FRAME ALLOCATOR:\n");
+    if (frame_enable_buddy()) {
+        buddy_stats_t buddy_stats;
+        buddy_get_stats(&buddy_stats);
+        early_console_print("  Multi-page requests served by buddy tree (");
+        early_console_print_dec(buddy_stats.total_memory / (1024 * 1024));
+        early_console_print(" MB managed)\n");
+    } else {
+        early_console_print("  Not enough aligned free memory - using bitmap only\n");
+    }
+#endif
+
+    /* Identity-map physical memory and turn on paging */
+    early_console_print("\n  PAGING:\n");
+    if (paging_init(total_memory)) {
+        paging_stats_t paging;
+        paging_get_stats(NULL, &paging);
+        early_console_print(paging.pse ? "  Enabled - RAM identity-mapped with 4MB pages"
+                                       : "  Enabled - RAM identity-mapped with 4KB pages");
+        early_console_print(", per-task mmap window at 0x");
+        early_console_print_hex(USER_MMAP_BASE);
+        early_console_print("\n");
+    } else {
+        early_console_print("  Disabled - running on flat physical addresses\n");
+    }
+
+    /* Mount the root filesystem (RAMFS lives in heap and frame memory) */
+    early_console_print("\n  VFS:\n");
+    vfs_init();
+    if (vfs_is_initialized()) {
+        early_console_print("  RAMFS mounted at /");
+        if (boot_module_info.mods_count != 0) {
+            early_console_print(" (images load after boot)");
+        }
+        early_console_print("\n");
+    } else {
+        early_console_print("  Root mount failed - file syscalls unavailable\n");
+    }
+
     /* Print memory summary */
     early_console_print("\n  MEMORY SUMMARY:\n");
     early_console_print("  +-------------------------------+---------------------------+\n");
@@ -492,6 +864,11 @@ static void init_interrupts(void)
     early_console_print("  | WHY REMAP? Default vectors 8-15 conflict with CPU        |\n");
     early_console_print("  | exceptions! (e.g., IRQ0 = vector 8 = Double Fault)       |\n");
     early_console_print("  +----------------------------------------------------------+\n");
+    if (apic_enabled()) {
+        early_console_print("  | APIC MODE: I/O APIC routes IRQs, local APIC takes EOIs   |\n");
+        early_console_print("  |   (same vectors; the PIC stays masked as a fallback)     |\n");
+        early_console_print("  +----------------------------------------------------------+\n");
+    }
 
     /* -----------------------------------------------------------------------
      * Initialize System Call Handler (INT 0x80)
@@ -502,6 +879,25 @@ static void init_interrupts(void)
     early_console_print("  | Vector: 0x80 (128) - Same as Linux for familiarity       |\n");
     early_console_print("  | Usage:  INT 0x80 with syscall number in EAX              |\n");
     early_console_print("  +----------------------------------------------------------+\n");
+
+    /* -----------------------------------------------------------------------
+     * Detect Hardware Performance Counters (CPUID leaf 0xA)
+     * ----------------------------------------------------------------------- */
+    perf_init();
+    early_console_print("\n  PERFORMANCE COUNTERS:\n");
+    if (perf_available()) {
+        perf_info_t info;
+        perf_get_info(&info);
+        early_console_print("  | Architectural perfmon v");
+        early_console_print_dec(info.version);
+        early_console_print(": ");
+        early_console_print_dec(info.counters);
+        early_console_print(" counters x ");
+        early_console_print_dec(info.width);
+        early_console_print(" bits\n");
+    } else {
+        early_console_print("  | Not available (no CPUID leaf 0xA)\n");
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -543,6 +939,9 @@ static void init_drivers(void)
     early_console_print("  |   0x40: Channel 0 data (read/write counter)              |\n");
     early_console_print("  |   0x43: Mode/Command register                            |\n");
     early_console_print("  | IRQ: 0 (mapped to vector 32)                             |\n");
+    if (pit_uses_lapic_timer()) {
+        early_console_print("  | Tick source: LAPIC timer (calibrated against the PIT)    |\n");
+    }
     early_console_print("  | Status: INITIALIZED at ");
     early_console_print_dec(SCHEDULER_TICK_HZ);
     early_console_print(" Hz                          |\n");
@@ -588,6 +987,38 @@ static void init_drivers(void)
     early_console_print("                                     | read 0x60      |\n");
     early_console_print("                                     | translate->buf |\n");
     early_console_print("                                     +----------------+\n");
+
+    /* -----------------------------------------------------------------------
+     * Switch the Serial Port to Interrupt-Driven Output
+     * Log output is queued and sent 16 bytes per THRE interrupt (IRQ4)
+     * ----------------------------------------------------------------------- */
+    early_console_print("\n  SERIAL PORT (COM1): ");
+    if (serial_enable_interrupts()) {
+        early_console_print("IRQ4, ");
+        early_console_print_dec(SERIAL_TX_RING_SIZE);
+        early_console_print("-byte TX ring, 16-byte FIFO bursts\n");
+    } else {
+        early_console_print("not present, output stays polled\n");
+    }
+
+    /* -----------------------------------------------------------------------
+     * Probe ATA Disks and Set Up the Buffer Cache
+     * Completions arrive on IRQ14/IRQ15
+     * ----------------------------------------------------------------------- */
+    early_console_print("\n  BLOCK DEVICES:\n");
+    int disks = ata_init();
+    early_console_print("  ATA disks found: ");
+    early_console_print_dec((uint32_t)disks);
+    early_console_print("\n");
+    if (bcache_init()) {
+        early_console_print("  Buffer cache: ");
+        early_console_print_dec(BCACHE_BUFFERS);
+        early_console_print(" x 4KB blocks, LRU writeback, read-ahead ");
+        early_console_print_dec(BCACHE_READAHEAD);
+        early_console_print("\n");
+    } else {
+        early_console_print("  Buffer cache: no memory\n");
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -687,6 +1118,281 @@ static void demo_task_c(void *arg)
     early_console_print("  +**********************************************************+\n");
 }
 
+/* Free list benchmark: trace length, live slots and scratch heap size */
+#define FL_BENCH_OPS        20000
+#define FL_BENCH_SLOTS      1024
+#define FL_BENCH_SCRATCH    (1024 * 1024)
+
+/* Replay a synthetic trace under every free list policy and print a table */
+static void run_freelist_benchmark(void)
+{
+    static const char *fit_names[FREELIST_FIT_COUNT] = { "first", "next ", "best " };
+    static const char *order_names[FREELIST_ORDER_COUNT] = { "address", "lifo   " };
+    freelist_bench_result_t results[FREELIST_FIT_COUNT * FREELIST_ORDER_COUNT];
+
+    arena_t *arena = arena_create(0);
+    freelist_trace_op_t *ops = (freelist_trace_op_t *)
+        arena_alloc(arena, FL_BENCH_OPS * sizeof(freelist_trace_op_t));
+    void *scratch = arena_alloc(arena, FL_BENCH_SCRATCH);
+    if (!ops || !scratch) {
+        early_console_print("[FREELIST] Not enough memory for the benchmark\n");
+        arena_destroy(arena);
+        return;
+    }
+
+    freelist_trace_generate(ops, FL_BENCH_OPS, FL_BENCH_SLOTS, pit_get_ticks());
+    size_t n = freelist_benchmark(scratch, FL_BENCH_SCRATCH, ops, FL_BENCH_OPS,
+                                  FL_BENCH_SLOTS, results);
+
+    early_console_print("\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("|              FREE LIST POLICY BENCHMARK                    |\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("| Ops: ");
+    early_console_print_dec(FL_BENCH_OPS);
+    early_console_print("  Slots: ");
+    early_console_print_dec(FL_BENCH_SLOTS);
+    early_console_print("  Heap: ");
+    early_console_print_dec(FL_BENCH_SCRATCH / 1024);
+    early_console_print(" KB\n");
+    early_console_print("| fit   order    cyc/op  frag% peak%  blocks  failed\n");
+    for (size_t i = 0; i < n; i++) {
+        early_console_print("| ");
+        early_console_print(fit_names[results[i].policy.fit]);
+        early_console_print(" ");
+        early_console_print(order_names[results[i].policy.order]);
+        early_console_print("  ");
+        early_console_print_dec(results[i].cycles_per_op);
+        early_console_print("\t");
+        early_console_print_dec(results[i].final_fragmentation);
+        early_console_print("\t");
+        early_console_print_dec(results[i].peak_fragmentation);
+        early_console_print("\t");
+        early_console_print_dec(results[i].peak_free_blocks);
+        early_console_print("\t");
+        early_console_print_dec(results[i].failed_allocs);
+        early_console_print("\n");
+    }
+    early_console_print("+============================================================+\n\n");
+
+    arena_destroy(arena);
+}
+
+/* memprof: print the heap profiler's top sites and size histogram */
+static void print_heap_profile(void)
+{
+    static heap_profile_t profile;
+
+    if (!heap_profile_enabled()) {
+        heap_profile_enable(true);
+        early_console_print("\n[MEMPROF] Heap profiler enabled. Press P again for a report.\n\n");
+        return;
+    }
+    heap_get_profile(&profile);
+
+    early_console_print("\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("|                 HEAP ALLOCATION PROFILE                    |\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("| Site        Live bytes  Peak bytes  Allocs  Frees\n");
+    for (uint32_t i = 0; i < profile.sites_used && i < 10; i++) {
+        heap_prof_site_t *site = &profile.sites[i];
+        early_console_print("| ");
+        if (site->caller) {
+            early_console_print("0x");
+            early_console_print_hex(site->caller);
+        } else {
+            early_console_print("(other)   ");
+        }
+        early_console_print("  ");
+        early_console_print_dec(site->live_bytes);
+        early_console_print("\t");
+        early_console_print_dec(site->peak_bytes);
+        early_console_print("\t");
+        early_console_print_dec(site->allocs);
+        early_console_print("\t");
+        early_console_print_dec(site->frees);
+        early_console_print("\n");
+    }
+    early_console_print("| Sizes:");
+    uint32_t limit = 16;
+    for (int i = 0; i < HEAP_PROF_BUCKETS; i++, limit <<= 1) {
+        if (profile.histogram[i] == 0) {
+            continue;
+        }
+        early_console_print(" ");
+        if (i == HEAP_PROF_BUCKETS - 1) {
+            early_console_print("big");
+        } else {
+            early_console_print("<=");
+            early_console_print_dec(limit);
+        }
+        early_console_print(":");
+        early_console_print_dec(profile.histogram[i]);
+    }
+    early_console_print("\n+============================================================+\n\n");
+}
+
+/* irqlat: per-handler top-half time (cycles) and its histogram */
+static void print_irq_latency(void)
+{
+    irq_handler_stats_t stats;
+
+    early_console_print("\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("|                IRQ HANDLER TIME (CPU CYCLES)               |\n");
+    early_console_print("+============================================================+\n");
+    early_console_print("| IRQ Handler    Calls     Min       Avg       Max\n");
+    for (uint8_t irq = 0; irq < IRQ_COUNT; irq++) {
+        for (uint32_t i = 0; irq_get_handler_stats(irq, i, &stats); i++) {
+            early_console_print("| ");
+            early_console_print_dec(irq);
+            early_console_print(irq < 10 ? "   " : "  ");
+            early_console_print(stats.name);
+            early_console_print("\t");
+            early_console_print_dec(stats.calls);
+            early_console_print("\t");
+            if (stats.timed == 0) {
+                early_console_print("-\n");
+                continue;
+            }
+            early_console_print_dec(stats.min_cycles);
+            early_console_print("\t");
+            early_console_print_dec(stats.avg_cycles);
+            early_console_print("\t");
+            early_console_print_dec(stats.max_cycles);
+            early_console_print("\n|      <cycles:count>");
+            uint32_t limit = 512;
+            for (int b = 0; b < IRQ_LAT_BUCKETS; b++, limit <<= 1) {
+                if (stats.histogram[b] == 0) {
+                    continue;
+                }
+                early_console_print(" ");
+                if (b == IRQ_LAT_BUCKETS - 1) {
+                    early_console_print("more");
+                } else {
+                    early_console_print("<");
+                    early_console_print_dec(limit);
+                }
+                early_console_print(":");
+                early_console_print_dec(stats.histogram[b]);
+            }
+            early_console_print("\n");
+        }
+        if (irq_get_unhandled_count(irq) != 0) {
+            early_console_print("| ");
+            early_console_print_dec(irq);
+            early_console_print("   (unclaimed)\t");
+            early_console_print_dec(irq_get_unhandled_count(irq));
+            early_console_print("\n");
+        }
+    }
+    early_console_print("+============================================================+\n\n");
+}
+
+/* dmesg: the kernel log records still held in the log rings */
+static void print_dmesg(void)
+{
+    early_console_print("\n--- KERNEL LOG (dmesg) ---\n");
+    log_dump(early_console_print);
+    early_console_print("--- ");
+    early_console_print_dec(log_get_lost_count());
+    early_console_print(" records overwritten before reaching the console ---\n\n");
+}
+
+/* ---------------------------------------------------------------------------
+ * Boot Timeline
+ * --------------------------------------------------------------------------- */
+
+/* Record that a boot phase ended now */
+static void boot_mark(const char *phase)
+{
+    if (boot_mark_count < BOOT_MAX_MARKS) {
+        boot_marks[boot_mark_count].phase = phase;
+        boot_marks[boot_mark_count].tsc = clock_cycles();
+        boot_mark_count++;
+    }
+}
+
+/* cycles * 1000 / kHz with one 64/32 DIV; 0 if uncalibrated */
+static uint32_t boot_cycles_to_us(uint64_t cycles)
+{
+    uint32_t khz = clock_get_khz();
+    uint64_t n = cycles * 1000;
+    if (khz == 0 || (uint32_t)(n >> 32) >= khz) {
+        return 0;
+    }
+    uint32_t quot, rem;
+    __asm__("divl %4"
+            : "=a"(quot), "=d"(rem)
+            : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(khz));
+    return quot;
+}
+
+/* Microseconds as milliseconds with three decimals */
+static void print_us_as_ms(uint32_t us)
+{
+    uint32_t frac = us % 1000;
+    early_console_print_dec(us / 1000);
+    early_console_print(frac < 100 ? (frac < 10 ? ".00" : ".0") : ".");
+    early_console_print_dec(frac);
+}
+
+static void print_boot_timeline(void)
+{
+    uint64_t prev = boot_entry_tsc;
+
+    early_console_print("\n  BOOT TIMELINE (ms since kernel entry):\n");
+    early_console_print("  Phase               At          Took\n");
+    for (uint32_t i = 0; i < boot_mark_count; i++) {
+        const char *phase = boot_marks[i].phase;
+        uint32_t len = 0;
+
+        early_console_print("  ");
+        early_console_print(phase);
+        while (phase[len] != '\0') {
+            len++;
+        }
+        for (; len < 20; len++) {
+            early_console_print(" ");
+        }
+        print_us_as_ms(boot_cycles_to_us(boot_marks[i].tsc - boot_entry_tsc));
+        early_console_print("\t");
+        print_us_as_ms(boot_cycles_to_us(boot_marks[i].tsc - prev));
+        early_console_print("\n");
+        prev = boot_marks[i].tsc;
+    }
+    early_console_print("[BOOT] Ready after ");
+    print_us_as_ms(boot_cycles_to_us(prev - boot_entry_tsc));
+    early_console_print(" ms\n\n");
+}
+
+/*
+ * Init task: boot work nothing else waits for, moved off the path to the
+ * scheduler. Loads the RAMFS images, starts the demo tasks when self-tests
+ * were asked for, then reports the boot timeline.
+ */
+static void init_task_entry(void *arg)
+{
+    UNUSED(arg);
+
+    if (vfs_is_initialized() && boot_module_info.mods_count != 0) {
+        load_ramfs_images(&boot_module_info);
+        boot_mark("ramfs images");
+    }
+
+    if (boot_selftest && !boot_bench) {
+        early_console_print("\n+------------ TEST: MULTITASKING SCHEDULER ----------------+\n");
+        early_console_print("| Creating demo tasks to demonstrate context switching     |\n");
+        early_console_print("+----------------------------------------------------------+\n");
+        scheduler_test();
+        boot_mark("demo tasks");
+    }
+
+    boot_mark("ready");
+    print_boot_timeline();
+}
+
 /* Main task: Interactive shell with demonstration commands */
 static void main_task_entry(void *arg)
 {
@@ -713,6 +1419,16 @@ static void main_task_entry(void *arg)
     early_console_print("|                                                            |\n");
     early_console_print("|   [D] DSA         - Show data structures used in kernel    |\n");
     early_console_print("|                                                            |\n");
+    early_console_print("|   [F] FREELIST    - Benchmark free list fit policies       |\n");
+    early_console_print("|                                                            |\n");
+    early_console_print("|   [P] MEMPROF     - Heap allocation sites and sizes        |\n");
+    early_console_print("|                                                            |\n");
+    early_console_print("|   [B] BENCH       - Kernel microbenchmarks (cycles/op)     |\n");
+    early_console_print("|                                                            |\n");
+    early_console_print("|   [L] IRQLAT      - Time spent in each IRQ handler         |\n");
+    early_console_print("|                                                            |\n");
+    early_console_print("|   [K] DMESG       - Kernel log ring (timestamped records)  |\n");
+    early_console_print("|                                                            |\n");
     early_console_print("|   [H] HELP        - Show this command reference            |\n");
     early_console_print("|                                                            |\n");
     early_console_print("|   [Any other key] - Echo keypress (keyboard driver demo)   |\n");
@@ -729,6 +1445,13 @@ static void main_task_entry(void *arg)
         early_console_print("\n[STATUS] Interrupts: DISABLED - Enabling now...\n");
         cpu_sti();
     }
+    /* make bench: report over serial, then leave QEMU */
+    if (boot_bench) {
+        bench_report(NULL);
+        outb(QEMU_DEBUG_EXIT_PORT, 0);
+        early_console_print("[BENCH] No isa-debug-exit device, continuing\n");
+    }
+
     early_console_print("[STATUS] Main task (PID 1) running. Awaiting keyboard input...\n");
     early_console_print("[STATUS] System heartbeat every 10 seconds.\n\n");
     
@@ -773,6 +1496,9 @@ static void main_task_entry(void *arg)
                     early_console_print("| Ready Queue Size              |     ");
                     early_console_print_dec(scheduler_ready_count());
                     early_console_print("                     |\n");
+                    early_console_print("| Sleeping Tasks                |     ");
+                    early_console_print_dec(scheduler_sleeping_count());
+                    early_console_print("                     |\n");
                     early_console_print("| Idle Task Time (ticks)        | ");
                     uint32_t it = scheduler_get_idle_time();
                     if (it < 10) early_console_print(" ");
@@ -784,6 +1510,28 @@ static void main_task_entry(void *arg)
                     early_console_print("| Total Active Tasks            |     ");
                     early_console_print_dec(task_count());
                     early_console_print("                     |\n");
+                    {
+                        char cell[32];
+                        scheduler_latency_stats_t lat;
+                        workqueue_stats_t work;
+                        scheduler_get_latency_stats(&lat);
+                        workqueue_get_stats(&work);
+
+                        early_console_print("| Timer IRQs / Tickless Ticks   | ");
+                        ksnprintf(cell, sizeof(cell), "%u / %u",
+                                  pit_get_irq_count(), pit_get_ticks_skipped());
+                        early_console_print_cell(cell, STATS_CELL_WIDTH);
+                        early_console_print("| Max Wakeup / Switch (ns)      | ");
+                        ksnprintf(cell, sizeof(cell), "%u / %u",
+                                  lat.wakeup_max_ns, lat.switch_max_ns);
+                        early_console_print_cell(cell, STATS_CELL_WIDTH);
+                        early_console_print("| TSC Clock (kHz)               | ");
+                        ksnprintf(cell, sizeof(cell), "%u", lat.clock_khz);
+                        early_console_print_cell(cell, STATS_CELL_WIDTH);
+                        early_console_print("| Work Items Run / Dropped      | ");
+                        ksnprintf(cell, sizeof(cell), "%u / %u", work.executed, work.dropped);
+                        early_console_print_cell(cell, STATS_CELL_WIDTH);
+                    }
                     early_console_print("| Timer Tick Rate               |   100 Hz                  |\n");
                     early_console_print("| Time Slice Duration           |    10 ticks (100ms)       |\n");
                     early_console_print("+-------------------------------+---------------------------+\n");
@@ -896,6 +1644,25 @@ static void main_task_entry(void *arg)
                     early_console_print_dec(fm);
                     early_console_print(" MB                   |\n");
                     early_console_print("+-------------------------------+---------------------------+\n");
+                    print_frame_zones();
+                    early_console_print("+-------------------------------+---------------------------+\n");
+                    if (frame_buddy_enabled()) {
+                        buddy_stats_t bs;
+                        buddy_get_stats(&bs);
+                        early_console_print("| BUDDY TREE free blocks per order (0=4KB .. 10=4MB):        |\n");
+                        char cell[STATS_ROW_WIDTH + 1];
+                        size_t used = ksnprintf(cell, sizeof(cell), "  ");
+                        for (int order = 0; order <= BUDDY_MAX_ORDER && used < sizeof(cell); order++) {
+                            used += ksnprintf(cell + used, sizeof(cell) - used, " %u",
+                                              bs.blocks_per_order[order]);
+                        }
+                        early_console_print("|");
+                        early_console_print_cell(cell, STATS_ROW_WIDTH);
+                        early_console_print("| External Fragmentation        | ");
+                        ksnprintf(cell, sizeof(cell), "%u%%", bs.fragmentation);
+                        early_console_print_cell(cell, STATS_CELL_WIDTH);
+                        early_console_print("+-------------------------------+---------------------------+\n");
+                    }
                     early_console_print("| HEAP ALLOCATOR (Free-list, first-fit)                      |\n");
                     early_console_print("+-------------------------------+---------------------------+\n");
                     early_console_print("| Total Allocations (kmalloc)   | ");
@@ -971,7 +1738,7 @@ static void main_task_entry(void *arg)
                     early_console_print("| 2. FREE LIST (kernel/memory/dsa_structures/freelist.c)    |\n");
                     early_console_print("|    Used by: Kernel Heap Allocator                         |\n");
                     early_console_print("|    Purpose: Manage variable-size memory blocks            |\n");
-                    early_console_print("|    Ops: O(n) first-fit alloc, O(1) free + coalescing      |\n");
+                    early_console_print("|    Ops: O(n) first/next/best fit, O(1) boundary-tag free  |\n");
                     early_console_print("|                                                            |\n");
                     early_console_print("| 3. CIRCULAR QUEUE (scheduler/dsa_structures/)             |\n");
                     early_console_print("|    Used by: Round-Robin Scheduler                         |\n");
@@ -985,7 +1752,7 @@ static void main_task_entry(void *arg)
                     early_console_print("|                                                            |\n");
                     early_console_print("| 5. TRIE (kernel/fs/dsa_structures/trie.c)                 |\n");
                     early_console_print("|    Used by: Filesystem path lookup                        |\n");
-                    early_console_print("|    Purpose: Fast prefix-based path resolution             |\n");
+                    early_console_print("|    Purpose: Path index, adaptive radix tree (4/16/48/256) |\n");
                     early_console_print("|    Ops: O(k) lookup where k = path length                 |\n");
                     early_console_print("|                                                            |\n");
                     early_console_print("| 6. HASH MAP (kernel/fs/dsa_structures/hashmap.c)          |\n");
@@ -994,6 +1761,22 @@ static void main_task_entry(void *arg)
                     early_console_print("|                                                            |\n");
                     early_console_print("+============================================================+\n\n");
                     
+                } else if (c == 'f' || c == 'F') {
+                    run_freelist_benchmark();
+
+                } else if (c == 'p' || c == 'P') {
+                    print_heap_profile();
+
+                } else if (c == 'b' || c == 'B') {
+                    early_console_print("\n[BENCH] Running microbenchmarks...\n");
+                    bench_report(NULL);
+
+                } else if (c == 'l' || c == 'L') {
+                    print_irq_latency();
+
+                } else if (c == 'k' || c == 'K') {
+                    print_dmesg();
+
                 } else if (c == 'h' || c == 'H') {
                     /* Show help */
                     early_console_print("\n");
@@ -1006,6 +1789,11 @@ static void main_task_entry(void *arg)
                     early_console_print("| [M] MEMORY      - Frame allocator, heap, memory map        |\n");
                     early_console_print("| [T] TASKS       - Process list, states, priorities         |\n");
                     early_console_print("| [D] DSA         - Data structures used in kernel           |\n");
+                    early_console_print("| [F] FREELIST    - Free list fit policy benchmark           |\n");
+                    early_console_print("| [P] MEMPROF     - Heap profiler (first press enables it)   |\n");
+                    early_console_print("| [B] BENCH       - Microbenchmarks: min/median/p99 cyc/op   |\n");
+                    early_console_print("| [L] IRQLAT      - Per-handler IRQ time (min/avg/max/hist)  |\n");
+                    early_console_print("| [K] DMESG       - Kernel log records, oldest first         |\n");
                     early_console_print("| [H] HELP        - This command reference                   |\n");
                     early_console_print("|                                                            |\n");
                     early_console_print("| Any other key will echo the keypress, demonstrating        |\n");
@@ -1050,8 +1838,9 @@ static void main_task_entry(void *arg)
             early_console_print("+------------------------------------------------------------+\n\n");
         }
 
-        /* Yield to let other tasks run */
-        task_yield();
+        /* Sleep until a key arrives (or a second passes, for the heartbeat) */
+        kpollfd_t input = { POLL_SRC_KEYBOARD, 0, POLLIN, 0 };
+        kpoll(&input, 1, SCHEDULER_TICK_HZ);
     }
 }
 
@@ -1103,6 +1892,10 @@ static void init_scheduler_subsystem(void)
         early_console_print("  | Policy: ");
         if (scheduler_get_policy() == SCHED_POLICY_ROUND_ROBIN) {
             early_console_print("Round-Robin (FIFO with time slicing)            |\n");
+        } else if (scheduler_get_policy() == SCHED_POLICY_BITMAP) {
+            early_console_print("Priority-based (O(1) level bitmap)              |\n");
+        } else if (scheduler_get_policy() == SCHED_POLICY_FAIR) {
+            early_console_print("Fair-share (vruntime red-black tree)            |\n");
         } else {
             early_console_print("Priority-based (min-heap)                       |\n");
         }
@@ -1138,6 +1931,19 @@ static void init_scheduler_subsystem(void)
         PANIC("Failed to create main task");
     }
 
+    /* Deferred boot work runs as the first task after main */
+    task_t *init = task_create("init", init_task_entry, NULL, TASK_PRIORITY_NORMAL, 0);
+    if (init != NULL) {
+        scheduler_add_task(init);
+    } else {
+        early_console_print("  init: not started, RAMFS images not loaded\n");
+    }
+
+    /* Log records reach the consoles from the klogd task from now on */
+    if (!log_start_drain()) {
+        early_console_print("  klogd: not started, log calls print synchronously\n");
+    }
+
     /* Print scheduler state */
     early_console_print("\n  SCHEDULER READY STATE:\n");
     early_console_print("  +----------------------------------------------------------+\n");
@@ -1493,21 +2299,6 @@ static void interrupt_test(void)
     early_console_print("  +------------------------+--------+\n");
 }
 
-/* ---------------------------------------------------------------------------
- * clear_bss - Zero out the BSS section
- * ---------------------------------------------------------------------------
- * The BSS section contains uninitialized global variables. By C standard,
- * they should be zero-initialized. The bootloader might not do this, so
- * we do it ourselves.
- * --------------------------------------------------------------------------- */
-static void clear_bss(void)
-{
-    char *ptr = _bss_start;
-    while (ptr < _bss_end) {
-        *ptr++ = 0;
-    }
-}
-
 /* ---------------------------------------------------------------------------
  * early_console_init - Initialize VGA text mode console
  * ---------------------------------------------------------------------------
@@ -1651,3 +2442,22 @@ static void early_console_print_dec(uint32_t value)
     
     early_console_print(&buffer[i + 1]);
 }
+
+/* ---------------------------------------------------------------------------
+ * early_console_print_cell - Print the last cell of a boxed row
+ * ---------------------------------------------------------------------------
+ * Pads 'text' to 'width' columns and closes the row.
+ * --------------------------------------------------------------------------- */
+static void early_console_print_cell(const char *text, size_t width)
+{
+    size_t len = 0;
+    while (text[len] != '\0') {
+        len++;
+    }
+
+    early_console_print(text);
+    for (; len < width; len++) {
+        early_console_print(" ");
+    }
+    early_console_print("|\n");
+}
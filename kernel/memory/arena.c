@@ -0,0 +1,229 @@
+/*
+ * ===========================================================================
+ * kernel/memory/arena.c
+ * ===========================================================================
+ *
+ * Arena (Region) Allocator
+ *
+ * An arena hands out memory by bumping a pointer through page runs taken
+ * from the frame allocator (and therefore from the buddy tree when it backs
+ * the frame allocator). Individual allocations are never freed; the whole
+ * arena is reset or destroyed at once. This suits bursts of short-lived
+ * allocations - path components, directory listings, command parsing - that
+ * would otherwise each pay for a kmalloc/kfree round trip and leave holes in
+ * the main heap.
+ *
+ * Chunk Layout (chunk size = PAGE_SIZE * pages):
+ * ┌─────────────────────────────────────────────────────────────────────────┐
+ * │ arena_chunk_t │ allocations ... -> │            unused                  │
+ * └─────────────────────────────────────────────────────────────────────────┘
+ *
+ * The arena descriptor itself lives in the first chunk, right after that
+ * chunk's header, so creating an arena costs a single page run. When the
+ * current chunk is exhausted a new one is linked in front of it; requests
+ * larger than the default chunk get a chunk of their own size.
+ *
+ * arena_reset() keeps only the first chunk, so an arena reused for the same
+ * kind of work settles at one page run and never touches the frame
+ * allocator again.
+ *
+ * Thread Safety:
+ *   An arena belongs to its creator. Callers must serialize access.
+ *
+ * ===========================================================================
+ */
+
+#include "memory.h"
+#include "../../config/os_config.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+/* Alignment of every arena allocation */
+#define ARENA_ALIGNMENT         8
+
+/* Default chunk size in pages when the caller passes 0 */
+#define ARENA_DEFAULT_PAGES     1
+
+/* ---------------------------------------------------------------------------
+ * Structures
+ * --------------------------------------------------------------------------- */
+
+/* Header at the start of every chunk */
+typedef struct arena_chunk {
+    struct arena_chunk *next;   /* Older chunk (NULL for the first one) */
+    size_t pages;               /* Length of this chunk in pages */
+} arena_chunk_t;
+
+struct arena {
+    arena_chunk_t *current;     /* Chunk allocations are bumped from */
+    arena_chunk_t *first;       /* Chunk holding this descriptor */
+    uintptr_t top;              /* Next free byte in current chunk */
+    uintptr_t limit;            /* End of current chunk */
+    size_t chunk_pages;         /* Default size of additional chunks */
+    size_t bytes_used;          /* Bytes handed out since the last reset */
+};
+
+/* ---------------------------------------------------------------------------
+ * Helper: Start bumping from a fresh chunk
+ * --------------------------------------------------------------------------- */
+static void arena_use_chunk(arena_t *arena, arena_chunk_t *chunk, uintptr_t top)
+{
+    arena->current = chunk;
+    arena->top = ALIGN_UP(top, ARENA_ALIGNMENT);
+    arena->limit = (uintptr_t)chunk + chunk->pages * PAGE_SIZE;
+}
+
+/* ---------------------------------------------------------------------------
+ * arena_create - Create an arena
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   chunk_pages - Pages per chunk (0 = ARENA_DEFAULT_PAGES)
+ *
+ * Returns:
+ *   New arena, or NULL if no frames are available
+ * --------------------------------------------------------------------------- */
+arena_t *arena_create(size_t chunk_pages)
+{
+    if (chunk_pages == 0) {
+        chunk_pages = ARENA_DEFAULT_PAGES;
+    }
+
+    arena_chunk_t *chunk = (arena_chunk_t *)frame_alloc_contiguous(chunk_pages);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->pages = chunk_pages;
+
+    arena_t *arena = (arena_t *)ALIGN_UP((uintptr_t)(chunk + 1), ARENA_ALIGNMENT);
+    arena->first = chunk;
+    arena->chunk_pages = chunk_pages;
+    arena->bytes_used = 0;
+    arena_use_chunk(arena, chunk, (uintptr_t)(arena + 1));
+
+    return arena;
+}
+
+/* ---------------------------------------------------------------------------
+ * arena_alloc - Allocate from an arena
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   arena - Arena to allocate from
+ *   size  - Number of bytes
+ *
+ * Returns:
+ *   8-byte aligned pointer, or NULL if a new chunk was needed and no frames
+ *   are available. The memory is NOT zeroed.
+ *
+ * O(1): a bump of the top pointer, plus one frame allocation when the
+ * current chunk runs out.
+ * --------------------------------------------------------------------------- */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+
+    size = ALIGN_UP(size, ARENA_ALIGNMENT);
+
+    if (size > arena->limit - arena->top) {
+        /* Oversized requests get a chunk of their own */
+        size_t needed = ALIGN_UP(sizeof(arena_chunk_t), ARENA_ALIGNMENT) + size;
+        size_t pages = ALIGN_UP(needed, PAGE_SIZE) / PAGE_SIZE;
+        if (pages < arena->chunk_pages) {
+            pages = arena->chunk_pages;
+        }
+
+        arena_chunk_t *chunk = (arena_chunk_t *)frame_alloc_contiguous(pages);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = arena->current;
+        chunk->pages = pages;
+        arena_use_chunk(arena, chunk, (uintptr_t)(chunk + 1));
+    }
+
+    void *ptr = (void *)arena->top;
+    arena->top += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+/* ---------------------------------------------------------------------------
+ * arena_strndup - Copy at most len characters of a string into an arena
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   NUL-terminated copy, or NULL if the arena could not grow
+ * --------------------------------------------------------------------------- */
+char *arena_strndup(arena_t *arena, const char *str, size_t len)
+{
+    if (str == NULL) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    while (n < len && str[n] != '\0') {
+        n++;
+    }
+
+    char *copy = (char *)arena_alloc(arena, n + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        copy[i] = str[i];
+    }
+    copy[n] = '\0';
+    return copy;
+}
+
+/* ---------------------------------------------------------------------------
+ * arena_reset - Free every allocation at once
+ * ---------------------------------------------------------------------------
+ * All chunks except the first are returned to the frame allocator, and the
+ * first one is rewound. Pointers previously returned become invalid.
+ * --------------------------------------------------------------------------- */
+void arena_reset(arena_t *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    arena_chunk_t *chunk = arena->current;
+    while (chunk != arena->first) {
+        arena_chunk_t *next = chunk->next;
+        frame_free_contiguous((uintptr_t)chunk, chunk->pages);
+        chunk = next;
+    }
+
+    arena->bytes_used = 0;
+    arena_use_chunk(arena, arena->first, (uintptr_t)(arena + 1));
+}
+
+/* ---------------------------------------------------------------------------
+ * arena_destroy - Release an arena and all of its chunks
+ * --------------------------------------------------------------------------- */
+void arena_destroy(arena_t *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    arena_chunk_t *chunk = arena->current;
+    while (chunk != NULL) {
+        arena_chunk_t *next = chunk->next;
+        frame_free_contiguous((uintptr_t)chunk, chunk->pages);
+        chunk = next;
+    }
+}
+
+/**
+ * @brief Get the number of bytes allocated since the last reset
+ */
+size_t arena_used(const arena_t *arena)
+{
+    return arena ? arena->bytes_used : 0;
+}
@@ -51,7 +51,8 @@ static bool is_initialized = false;
  *   true on success, false on failure
  *
  * Notes:
- *   - The bitmap_buffer must be at least (mem_size/frame_size + 7)/8 bytes
+ *   - The bitmap_buffer must be at least BITMAP_BUFFER_SIZE(mem_size/frame_size)
+ *     bytes and 4-byte aligned
  *   - All frames start as free (bit = 0)
  * --------------------------------------------------------------------------- */
 bool frame_allocator_init(void *bitmap_buffer, size_t mem_size, size_t frame_size)
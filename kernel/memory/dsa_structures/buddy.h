@@ -77,6 +77,11 @@ typedef struct buddy_stats {
     size_t total_allocations;   /* Total allocation count */
     size_t total_frees;         /* Total free count */
     size_t blocks_per_order[BUDDY_MAX_ORDER + 1];  /* Free blocks per order */
+    int largest_free_order;     /* Order of the largest free block, -1 if none */
+    uint32_t fragmentation;     /* External fragmentation: % of free memory
+                                   in blocks below largest_free_order */
+    uint32_t unusable_index[BUDDY_MAX_ORDER + 1];  /* % of free memory in
+                                   blocks too small for a request of order i */
 } buddy_stats_t;
 
 /* ---------------------------------------------------------------------------
@@ -90,8 +95,9 @@ typedef struct buddy_stats {
  * @param total_size Total size of memory region to manage
  * @return true on success, false on failure
  * 
- * @note The memory region should be aligned to BUDDY_MAX_BLOCK_SIZE for best results
- * @note Some memory is reserved for allocator metadata
+ * @note The memory region should be aligned to BUDDY_MAX_BLOCK_SIZE for best results;
+ *       blocks are then aligned to their own size in absolute terms
+ * @note Some memory at the end of the region is reserved for allocator metadata
  */
 bool buddy_init(void *start, size_t total_size);
 
@@ -163,6 +169,22 @@ size_t buddy_order_to_size(int order);
  */
 void buddy_get_stats(buddy_stats_t *stats);
 
+/**
+ * @brief Check whether an address lies inside the managed region
+ *
+ * @param ptr Address to check
+ * @return true if ptr is within the blocks managed by the allocator
+ */
+bool buddy_contains(const void *ptr);
+
+/**
+ * @brief Check whether the page at an address is currently allocated
+ *
+ * @param ptr Address of any page inside the managed region
+ * @return true if the page is part of an allocated block
+ */
+bool buddy_is_allocated(const void *ptr);
+
 /**
  * @brief Check if the buddy allocator is initialized
  * 
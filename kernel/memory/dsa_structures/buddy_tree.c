@@ -42,6 +42,9 @@ static list_t free_areas[BUDDY_MAX_ORDER + 1];
 static bitmap_t block_bitmap;
 static uint8_t *bitmap_buffer = NULL;
 
+/* Number of blocks on each free list (kept so stats don't walk the lists) */
+static size_t free_counts[BUDDY_MAX_ORDER + 1];
+
 /* Memory region being managed */
 static void *memory_start = NULL;
 static void *memory_end = NULL;
@@ -125,6 +128,11 @@ static size_t get_block_index(void *block)
 
 /**
  * @brief Check if a block's buddy is free and can be merged
+ *
+ * A free larger block cannot contain the buddy (it would also contain the
+ * block being freed), so if the buddy's first page is free it must be the
+ * head of a free block of this order or smaller. The order stored in its
+ * header tells which - no list walk needed.
  */
 static bool is_buddy_free(void *buddy, int order)
 {
@@ -133,27 +141,11 @@ static bool is_buddy_free(void *buddy, int order)
         return false;
     }
 
-    /* Check the bitmap - all sub-blocks must be free */
-    size_t start_idx = get_block_index(buddy);
-    size_t block_count = 1 << order;  /* Number of order-0 blocks */
-
-    for (size_t i = 0; i < block_count; i++) {
-        if (bitmap_test(&block_bitmap, start_idx + i)) {
-            return false;  /* Some part is allocated */
-        }
-    }
-
-    /* Buddy is free - but we need to verify it's actually in the free list
-     * at this order (not split into smaller blocks) */
-    list_node_t *current;
-    list_for_each(current, &free_areas[order]) {
-        buddy_block_t *block = list_entry(current, buddy_block_t, node);
-        if ((void *)block == buddy) {
-            return true;
-        }
+    if (bitmap_test(&block_bitmap, get_block_index(buddy))) {
+        return false;  /* Buddy (or part of it) is allocated */
     }
 
-    return false;
+    return ((buddy_block_t *)buddy)->order == order;
 }
 
 /**
@@ -161,14 +153,9 @@ static bool is_buddy_free(void *buddy, int order)
  */
 static void remove_from_free_list(void *ptr, int order)
 {
-    list_node_t *current;
-    list_for_each(current, &free_areas[order]) {
-        buddy_block_t *block = list_entry(current, buddy_block_t, node);
-        if ((void *)block == ptr) {
-            list_remove(&free_areas[order], &block->node);
-            return;
-        }
-    }
+    buddy_block_t *block = (buddy_block_t *)ptr;
+    list_remove(&free_areas[order], &block->node);
+    free_counts[order]--;
 }
 
 /**
@@ -180,6 +167,7 @@ static void add_to_free_list(void *ptr, int order)
     block->order = order;
     list_node_init(&block->node);
     list_push_back(&free_areas[order], &block->node);
+    free_counts[order]++;
 }
 
 /**
@@ -187,12 +175,7 @@ static void add_to_free_list(void *ptr, int order)
  */
 static void mark_allocated(void *ptr, int order)
 {
-    size_t start_idx = get_block_index(ptr);
-    size_t block_count = 1 << order;
-
-    for (size_t i = 0; i < block_count; i++) {
-        bitmap_set(&block_bitmap, start_idx + i);
-    }
+    bitmap_set_range(&block_bitmap, get_block_index(ptr), (size_t)1 << order);
 }
 
 /**
@@ -200,12 +183,7 @@ static void mark_allocated(void *ptr, int order)
  */
 static void mark_free(void *ptr, int order)
 {
-    size_t start_idx = get_block_index(ptr);
-    size_t block_count = 1 << order;
-
-    for (size_t i = 0; i < block_count; i++) {
-        bitmap_clear(&block_bitmap, start_idx + i);
-    }
+    bitmap_clear_range(&block_bitmap, get_block_index(ptr), (size_t)1 << order);
 }
 
 /* ---------------------------------------------------------------------------
@@ -236,23 +214,24 @@ bool buddy_init(void *start, size_t total_size)
     /* Calculate how many minimum-size blocks we can manage */
     size_t num_blocks = total_size / BUDDY_MIN_BLOCK_SIZE;
     
-    /* Reserve space for the bitmap at the beginning of the region */
-    size_t bitmap_bytes = (num_blocks + 7) / 8;
+    /* Reserve space for the bitmap at the end of the region, so the first
+     * block keeps the caller's alignment */
+    size_t bitmap_bytes = BITMAP_BUFFER_SIZE(num_blocks);
     size_t bitmap_blocks = (bitmap_bytes + BUDDY_MIN_BLOCK_SIZE - 1) / BUDDY_MIN_BLOCK_SIZE;
     
     if (bitmap_blocks >= num_blocks) {
         return false;  /* Not enough space */
     }
 
-    /* Set up the bitmap in the reserved area */
-    bitmap_buffer = (uint8_t *)start;
-    
     /* Adjust the usable memory region */
-    memory_start = (void *)((uintptr_t)start + (bitmap_blocks * BUDDY_MIN_BLOCK_SIZE));
+    memory_start = start;
     num_blocks -= bitmap_blocks;
     total_memory = num_blocks * BUDDY_MIN_BLOCK_SIZE;
     memory_end = (void *)((uintptr_t)memory_start + total_memory);
 
+    /* Set up the bitmap in the reserved area */
+    bitmap_buffer = (uint8_t *)memory_end;
+
     /* Initialize the bitmap */
     if (!bitmap_init(&block_bitmap, num_blocks, bitmap_buffer)) {
         return false;
@@ -261,6 +240,7 @@ bool buddy_init(void *start, size_t total_size)
     /* Initialize all free lists */
     for (int i = 0; i <= BUDDY_MAX_ORDER; i++) {
         list_init(&free_areas[i]);
+        free_counts[i] = 0;
     }
 
     /* Add all memory as free blocks of the largest possible order */
@@ -330,6 +310,7 @@ void *buddy_alloc_order(int order)
 
     /* Remove a block from the free list at current_order */
     list_node_t *node = list_pop_front(&free_areas[current_order]);
+    free_counts[current_order]--;
     buddy_block_t *block = list_entry(node, buddy_block_t, node);
     void *block_addr = (void *)block;
 
@@ -393,6 +374,10 @@ void buddy_free_order(void *ptr, int order)
         return;  /* Not properly aligned for this order */
     }
 
+    if (!bitmap_test(&block_bitmap, get_block_index(ptr))) {
+        return;  /* Already free - ignore the double free */
+    }
+
     /* Mark as free in bitmap */
     mark_free(ptr, order);
 
@@ -460,10 +445,52 @@ void buddy_get_stats(buddy_stats_t *stats)
     stats->total_allocations = total_allocations;
     stats->total_frees = total_frees;
 
-    /* Count free blocks at each order */
+    /* Free blocks at each order, and the largest one available */
+    stats->largest_free_order = -1;
+    for (int i = 0; i <= BUDDY_MAX_ORDER; i++) {
+        stats->blocks_per_order[i] = free_counts[i];
+        if (free_counts[i] > 0) {
+            stats->largest_free_order = i;
+        }
+    }
+
+    /*
+     * Unusable free space index per order: the share of free memory held in
+     * blocks too small to satisfy a request of that order. Computed in pages
+     * so the percentages stay within 32-bit arithmetic.
+     */
+    size_t free_pages = free_memory / BUDDY_MIN_BLOCK_SIZE;
+    size_t small_pages = 0;
+
     for (int i = 0; i <= BUDDY_MAX_ORDER; i++) {
-        stats->blocks_per_order[i] = list_size(&free_areas[i]);
+        stats->unusable_index[i] = free_pages ?
+            (uint32_t)((small_pages * 100) / free_pages) : 0;
+        small_pages += free_counts[i] << i;
+    }
+
+    /* External fragmentation: free memory held in blocks smaller than the
+     * largest free one (0 when everything has coalesced) */
+    stats->fragmentation = stats->largest_free_order < 0 ? 0 :
+        stats->unusable_index[stats->largest_free_order];
+}
+
+/**
+ * @brief Check whether an address lies inside the managed region
+ */
+bool buddy_contains(const void *ptr)
+{
+    return initialized && ptr >= memory_start && ptr < memory_end;
+}
+
+/**
+ * @brief Check whether the page at an address is currently allocated
+ */
+bool buddy_is_allocated(const void *ptr)
+{
+    if (!buddy_contains(ptr)) {
+        return false;
     }
+    return bitmap_test(&block_bitmap, get_block_index((void *)ptr));
 }
 
 /**
@@ -10,29 +10,40 @@
  * enables efficient dynamic memory allocation within the kernel.
  *
  * Design:
- *   - Each free block contains a header with size and linking information
- *   - Headers are stored at the beginning of each block
- *   - The list is ordered by address to facilitate coalescing
- *   - Supports first-fit, best-fit, and worst-fit allocation strategies
+ *   - Each block carries a header and a footer (boundary tags) holding its
+ *     size and free flag, so both physical neighbours are found in O(1)
+ *   - Only free blocks are linked into the (doubly linked) free list
+ *   - The list is kept either in address order or LIFO order (policy)
+ *   - Supports first-fit, next-fit and best-fit allocation (policy)
  *
  * Block Structure:
  *   +------------------+
  *   | Block Header     |  <- sizeof(freelist_block_t)
+ *   | - list_node      |
  *   | - size           |
  *   | - is_free        |
- *   | - list_node      |
  *   +------------------+
  *   | Usable Memory    |  <- Returned to caller
  *   | (size bytes)     |
  *   +------------------+
+ *   | Block Footer     |  <- sizeof(freelist_tag_t), copy of size/is_free
+ *   +------------------+
  *
  * Memory Layout:
- *   [Header][Data][Header][Data][Header][Data]...
+ *   [Header][Data][Footer][Header][Data][Footer]...
+ *
+ * Coalescing on free (O(1) in every case):
+ *   - The previous block's footer sits just before our header
+ *   - The next block's header sits just after our footer
+ *   - A merged block keeps the list position of the free neighbour it
+ *     absorbed, so address order is preserved without a list walk; only a
+ *     block with no free neighbour has to search for its slot
  *
  * ===========================================================================
  */
 
 #include "freelist.h"
+#include "../../drivers/drivers.h"
 
 /* ---------------------------------------------------------------------------
  * Configuration
@@ -41,8 +52,28 @@
 /* Minimum allocation size (prevents tiny fragments) */
 #define MIN_ALLOC_SIZE      16
 
-/* Minimum remaining size after a split (header + MIN_ALLOC_SIZE) */
-#define MIN_SPLIT_SIZE      (sizeof(freelist_block_t) + MIN_ALLOC_SIZE)
+/* Alignment of block sizes and addresses */
+#define FREELIST_ALIGNMENT  8
+
+/* Benchmark: operations between fragmentation samples */
+#define BENCH_SAMPLE_INTERVAL   64
+
+/* ---------------------------------------------------------------------------
+ * Block Footer (boundary tag)
+ * ---------------------------------------------------------------------------
+ * Mirrors the header's size and free flag at the end of the block. Padded
+ * to keep the following header 8-byte aligned.
+ * --------------------------------------------------------------------------- */
+typedef struct freelist_tag {
+    size_t size;        /* Same as the header's size */
+    size_t is_free;     /* Same as the header's is_free */
+} freelist_tag_t;
+
+/* Header + footer bytes per block */
+#define BLOCK_OVERHEAD      (sizeof(freelist_block_t) + sizeof(freelist_tag_t))
+
+/* Minimum remaining size after a split (overhead + MIN_ALLOC_SIZE) */
+#define MIN_SPLIT_SIZE      (BLOCK_OVERHEAD + MIN_ALLOC_SIZE)
 
 /* ---------------------------------------------------------------------------
  * Static Variables
@@ -56,44 +87,156 @@ static void *heap_start = NULL;
 static void *heap_end = NULL;
 static size_t heap_total_size = 0;
 
+/* Policy chosen at init time */
+static freelist_policy_t active_policy = { FREELIST_FIT_FIRST, FREELIST_ORDER_ADDRESS };
+
+/* Next-fit resume point (a free list node, or NULL for the list head) */
+static list_node_t *rover = NULL;
+
 /* Statistics */
 static size_t total_allocations = 0;
 static size_t total_frees = 0;
 static size_t bytes_allocated = 0;
 
 /* ---------------------------------------------------------------------------
- * freelist_init - Initialize the free list allocator
+ * Boundary Tag Helpers
+ * --------------------------------------------------------------------------- */
+
+static inline freelist_tag_t *block_footer(freelist_block_t *block)
+{
+    return (freelist_tag_t *)((char *)block + sizeof(freelist_block_t) + block->size);
+}
+
+static inline void write_footer(freelist_block_t *block)
+{
+    freelist_tag_t *tag = block_footer(block);
+    tag->size = block->size;
+    tag->is_free = block->is_free;
+}
+
+/* Physical successor, or NULL at the end of the heap */
+static inline freelist_block_t *next_block(freelist_block_t *block)
+{
+    char *next = (char *)block + BLOCK_OVERHEAD + block->size;
+    return (next < (char *)heap_end) ? (freelist_block_t *)next : NULL;
+}
+
+/* Physical predecessor if it is free (read from its footer), else NULL */
+static inline freelist_block_t *free_prev_block(freelist_block_t *block)
+{
+    if ((void *)block <= heap_start) {
+        return NULL;
+    }
+
+    freelist_tag_t *tag = (freelist_tag_t *)((char *)block - sizeof(freelist_tag_t));
+    if (!tag->is_free) {
+        return NULL;
+    }
+    return (freelist_block_t *)((char *)block - BLOCK_OVERHEAD - tag->size);
+}
+
+/* ---------------------------------------------------------------------------
+ * Free List Helpers
+ * --------------------------------------------------------------------------- */
+
+static void free_list_remove(freelist_block_t *block)
+{
+    if (rover == &block->node) {
+        rover = block->node.next;
+    }
+    list_remove(&free_list, &block->node);
+}
+
+/* Put 'block' in the list position held by 'old', which leaves the list */
+static void free_list_replace(freelist_block_t *old, freelist_block_t *block)
+{
+    list_node_init(&block->node);
+    list_insert_before(&free_list, &old->node, &block->node);
+    if (rover == &old->node) {
+        rover = &block->node;
+    }
+    list_remove(&free_list, &old->node);
+}
+
+/* Insert a block that has no free neighbour */
+static void free_list_insert(freelist_block_t *block)
+{
+    list_node_init(&block->node);
+
+    if (active_policy.order == FREELIST_ORDER_LIFO) {
+        list_push_front(&free_list, &block->node);
+        return;
+    }
+
+    list_node_t *current;
+    list_for_each(current, &free_list) {
+        if ((void *)current > (void *)block) {
+            list_insert_before(&free_list, current, &block->node);
+            return;
+        }
+    }
+    list_push_back(&free_list, &block->node);
+}
+
+/* ---------------------------------------------------------------------------
+ * freelist_init_policy - Initialize the free list allocator
  * ---------------------------------------------------------------------------
  * Parameters:
- *   start - Start address of the heap memory region
- *   size  - Total size of the heap in bytes
+ *   start  - Start address of the heap memory region
+ *   size   - Total size of the heap in bytes
+ *   policy - Fit and ordering policy (NULL = first-fit, address order)
  *
  * Returns:
  *   true on success, false on failure
  *
  * Notes:
  *   - The entire heap initially becomes one large free block
- *   - The heap must be at least large enough for one header + MIN_ALLOC_SIZE
+ *   - The heap must be at least large enough for one block + MIN_ALLOC_SIZE
  * --------------------------------------------------------------------------- */
-bool freelist_init(void *start, size_t size)
+bool freelist_init_policy(void *start, size_t size, const freelist_policy_t *policy)
 {
+    if (!start) {
+        return false;
+    }
+
+    /* Align the region to FREELIST_ALIGNMENT on both ends */
+    uintptr_t aligned_start = ALIGN_UP((uintptr_t)start, FREELIST_ALIGNMENT);
+    size_t lost = aligned_start - (uintptr_t)start;
+    if (size < lost) {
+        return false;
+    }
+    size = ALIGN_DOWN(size - lost, FREELIST_ALIGNMENT);
+
     /* Validate parameters */
-    if (!start || size < sizeof(freelist_block_t) + MIN_ALLOC_SIZE) {
+    if (size < BLOCK_OVERHEAD + MIN_ALLOC_SIZE) {
+        return false;
+    }
+    if (policy && (policy->fit >= FREELIST_FIT_COUNT ||
+                   policy->order >= FREELIST_ORDER_COUNT)) {
         return false;
     }
 
+    if (policy) {
+        active_policy = *policy;
+    } else {
+        active_policy.fit = FREELIST_FIT_FIRST;
+        active_policy.order = FREELIST_ORDER_ADDRESS;
+    }
+
     /* Initialize the free list */
     list_init(&free_list);
+    rover = NULL;
 
     /* Store heap boundaries */
-    heap_start = start;
-    heap_end = (char *)start + size;
+    heap_start = (void *)aligned_start;
+    heap_end = (char *)heap_start + size;
     heap_total_size = size;
 
     /* Create the initial free block spanning the entire heap */
-    freelist_block_t *initial_block = (freelist_block_t *)start;
-    initial_block->size = size - sizeof(freelist_block_t);
+    freelist_block_t *initial_block = (freelist_block_t *)heap_start;
+    initial_block->size = size - BLOCK_OVERHEAD;
     initial_block->is_free = true;
+    write_footer(initial_block);
     list_node_init(&initial_block->node);
 
     /* Add to free list */
@@ -107,6 +250,16 @@ bool freelist_init(void *start, size_t size)
     return true;
 }
 
+/* ---------------------------------------------------------------------------
+ * freelist_init - Initialize with the default policy
+ * ---------------------------------------------------------------------------
+ * First-fit over an address-ordered free list.
+ * --------------------------------------------------------------------------- */
+bool freelist_init(void *start, size_t size)
+{
+    return freelist_init_policy(start, size, NULL);
+}
+
 /* ---------------------------------------------------------------------------
  * find_best_fit - Find the smallest free block that fits the request
  * ---------------------------------------------------------------------------
@@ -121,17 +274,15 @@ static freelist_block_t *find_best_fit(size_t size)
     list_node_t *current;
     list_for_each(current, &free_list) {
         freelist_block_t *block = list_entry(current, freelist_block_t, node);
-        
-        if (block->is_free && block->size >= size) {
-            /* This block fits - check if it's better than current best */
-            if (block->size < best_size) {
-                best = block;
-                best_size = block->size;
-                
-                /* Perfect fit - no need to look further */
-                if (block->size == size) {
-                    break;
-                }
+
+        if (block->size >= size && block->size < best_size) {
+            /* This block fits and is better than the current best */
+            best = block;
+            best_size = block->size;
+
+            /* Perfect fit - no need to look further */
+            if (block->size == size) {
+                break;
             }
         }
     }
@@ -150,8 +301,8 @@ static freelist_block_t *find_first_fit(size_t size)
     list_node_t *current;
     list_for_each(current, &free_list) {
         freelist_block_t *block = list_entry(current, freelist_block_t, node);
-        
-        if (block->is_free && block->size >= size) {
+
+        if (block->size >= size) {
             return block;
         }
     }
@@ -160,82 +311,110 @@ static freelist_block_t *find_first_fit(size_t size)
 }
 
 /* ---------------------------------------------------------------------------
- * split_block - Split a block if it's significantly larger than needed
+ * find_next_fit - First fit, starting where the previous search ended
  * ---------------------------------------------------------------------------
- * If a block is large enough to be split, this function creates a new
- * free block from the remaining space.
- *
- * Before split:
- *   [Header|-------- Large Block --------]
- *
- * After split:
- *   [Header|Allocated][Header|Free Block]
+ * Spreads allocations across the heap instead of repeatedly scanning past
+ * the small fragments that accumulate at the front of the list.
  * --------------------------------------------------------------------------- */
-static void split_block(freelist_block_t *block, size_t needed_size)
+static freelist_block_t *find_next_fit(size_t size)
 {
-    /* Only split if the remaining space is large enough to be useful */
-    if (block->size <= needed_size + MIN_SPLIT_SIZE) {
-        return;  /* Don't split - would create too small a fragment */
-    }
-
-    /* Calculate where the new block will start */
-    char *new_block_addr = (char *)block + sizeof(freelist_block_t) + needed_size;
-    freelist_block_t *new_block = (freelist_block_t *)new_block_addr;
+    list_node_t *start = rover ? rover : free_list.head;
+    list_node_t *current = start;
 
-    /* Initialize the new block */
-    new_block->size = block->size - needed_size - sizeof(freelist_block_t);
-    new_block->is_free = true;
-    list_node_init(&new_block->node);
+    while (current != NULL) {
+        freelist_block_t *block = list_entry(current, freelist_block_t, node);
+        if (block->size >= size) {
+            return block;
+        }
 
-    /* Shrink the original block */
-    block->size = needed_size;
+        current = current->next ? current->next : free_list.head;
+        if (current == start) {
+            break;  /* Wrapped around */
+        }
+    }
 
-    /* Insert the new block into the free list after the current block */
-    list_insert_after(&free_list, &block->node, &new_block->node);
+    return NULL;
 }
 
 /* ---------------------------------------------------------------------------
- * freelist_alloc - Allocate memory from the heap
+ * take_block - Carve an allocation out of a free block
  * ---------------------------------------------------------------------------
- * Parameters:
- *   size - Number of bytes to allocate
+ * If a block is large enough to be split, the remainder becomes a new free
+ * block that inherits the original's free list position (and the next-fit
+ * rover, so the next search resumes right after this allocation).
  *
- * Returns:
- *   Pointer to allocated memory, or NULL if allocation fails
+ * Before split:
+ *   [Header|-------- Large Block --------|Footer]
  *
- * Notes:
- *   - Uses first-fit strategy by default (faster than best-fit)
- *   - Returned pointer is to the usable memory, not the header
- *   - Allocations are aligned to at least 8 bytes
+ * After split:
+ *   [Header|Allocated|Footer][Header|Free Block|Footer]
  * --------------------------------------------------------------------------- */
-void *freelist_alloc(size_t size)
+static void take_block(freelist_block_t *block, size_t needed_size)
+{
+    if (block->size > needed_size + MIN_SPLIT_SIZE) {
+        /* Calculate where the new block will start */
+        char *new_block_addr = (char *)block + BLOCK_OVERHEAD + needed_size;
+        freelist_block_t *new_block = (freelist_block_t *)new_block_addr;
+
+        /* Initialize the new block */
+        new_block->size = block->size - needed_size - BLOCK_OVERHEAD;
+        new_block->is_free = true;
+        write_footer(new_block);
+
+        free_list_replace(block, new_block);
+        if (active_policy.fit == FREELIST_FIT_NEXT) {
+            rover = &new_block->node;
+        }
+
+        /* Shrink the original block */
+        block->size = needed_size;
+    } else {
+        /* Don't split - would create too small a fragment */
+        free_list_remove(block);
+    }
+
+    /* Mark the block as allocated */
+    block->is_free = false;
+    write_footer(block);
+}
+
+/* ---------------------------------------------------------------------------
+ * alloc_with_fit - Allocate a block using a given fit policy
+ * --------------------------------------------------------------------------- */
+static void *alloc_with_fit(size_t size, freelist_fit_t fit)
 {
     /* Validate request */
-    if (size == 0) {
+    if (size == 0 || heap_start == NULL) {
         return NULL;
     }
 
     /* Align size to 8 bytes for better performance */
-    size = ALIGN_UP(size, 8);
+    size = ALIGN_UP(size, FREELIST_ALIGNMENT);
 
     /* Enforce minimum allocation size */
     if (size < MIN_ALLOC_SIZE) {
         size = MIN_ALLOC_SIZE;
     }
 
-    /* Find a suitable block (using first-fit for speed) */
-    freelist_block_t *block = find_first_fit(size);
-    
+    freelist_block_t *block;
+    switch (fit) {
+        case FREELIST_FIT_NEXT:
+            block = find_next_fit(size);
+            break;
+        case FREELIST_FIT_BEST:
+            block = find_best_fit(size);
+            break;
+        default:
+            block = find_first_fit(size);
+            break;
+    }
+
     if (!block) {
         /* No suitable block found - out of memory */
         return NULL;
     }
 
-    /* Try to split the block if it's much larger than needed */
-    split_block(block, size);
-
-    /* Mark the block as allocated */
-    block->is_free = false;
+    take_block(block, size);
 
     /* Update statistics */
     total_allocations++;
@@ -246,62 +425,33 @@ void *freelist_alloc(size_t size)
 }
 
 /* ---------------------------------------------------------------------------
- * freelist_alloc_best_fit - Allocate using best-fit strategy
+ * freelist_alloc - Allocate memory from the heap
  * ---------------------------------------------------------------------------
- * Same as freelist_alloc but uses best-fit instead of first-fit.
- * Better memory utilization but slower allocation.
+ * Parameters:
+ *   size - Number of bytes to allocate
+ *
+ * Returns:
+ *   Pointer to allocated memory, or NULL if allocation fails
+ *
+ * Notes:
+ *   - Uses the fit policy chosen at init (first-fit by default)
+ *   - Returned pointer is to the usable memory, not the header
+ *   - Allocations are aligned to at least 8 bytes
  * --------------------------------------------------------------------------- */
-void *freelist_alloc_best_fit(size_t size)
+void *freelist_alloc(size_t size)
 {
-    if (size == 0) {
-        return NULL;
-    }
-
-    size = ALIGN_UP(size, 8);
-    if (size < MIN_ALLOC_SIZE) {
-        size = MIN_ALLOC_SIZE;
-    }
-
-    freelist_block_t *block = find_best_fit(size);
-    
-    if (!block) {
-        return NULL;
-    }
-
-    split_block(block, size);
-    block->is_free = false;
-
-    total_allocations++;
-    bytes_allocated += block->size;
-
-    return (void *)((char *)block + sizeof(freelist_block_t));
+    return alloc_with_fit(size, active_policy.fit);
 }
 
 /* ---------------------------------------------------------------------------
- * coalesce_with_next - Merge a block with its next neighbor if both are free
+ * freelist_alloc_best_fit - Allocate using best-fit strategy
  * ---------------------------------------------------------------------------
- * This reduces fragmentation by combining adjacent free blocks.
+ * Same as freelist_alloc but always uses best-fit, whatever the policy.
+ * Better memory utilization but slower allocation.
  * --------------------------------------------------------------------------- */
-static void coalesce_with_next(freelist_block_t *block)
+void *freelist_alloc_best_fit(size_t size)
 {
-    /* Get the next block in memory (not necessarily in the list) */
-    char *next_addr = (char *)block + sizeof(freelist_block_t) + block->size;
-    
-    /* Check if next block is within heap bounds */
-    if (next_addr >= (char *)heap_end) {
-        return;
-    }
-
-    freelist_block_t *next_block = (freelist_block_t *)next_addr;
-
-    /* Check if the next block is free and valid */
-    if (!next_block->is_free) {
-        return;
-    }
-
-    /* Merge: absorb the next block's space and remove it from the free list */
-    block->size += sizeof(freelist_block_t) + next_block->size;
-    list_remove(&free_list, &next_block->node);
+    return alloc_with_fit(size, FREELIST_FIT_BEST);
 }
 
 /* ---------------------------------------------------------------------------
@@ -313,7 +463,7 @@ static void coalesce_with_next(freelist_block_t *block)
  * Notes:
  *   - Freeing NULL is safe and does nothing
  *   - Double-free is detected and ignored
- *   - Adjacent free blocks are coalesced automatically
+ *   - The block is merged with free neighbours on both sides
  * --------------------------------------------------------------------------- */
 void freelist_free(void *ptr)
 {
@@ -336,6 +486,12 @@ void freelist_free(void *ptr)
         return;  /* Already free - ignore */
     }
 
+    /* Header and footer must agree, or this is not a block we handed out */
+    if ((char *)block_footer(block) + sizeof(freelist_tag_t) > (char *)heap_end ||
+        block_footer(block)->size != block->size) {
+        return;
+    }
+
     /* Mark as free */
     block->is_free = true;
 
@@ -343,19 +499,32 @@ void freelist_free(void *ptr)
     total_frees++;
     bytes_allocated -= block->size;
 
-    /* Try to coalesce with the next block */
-    coalesce_with_next(block);
-
-    /*
-     * Note: Coalescing with the previous block would require either:
-     * - A back pointer in each block header
-     * - Walking the entire list to find the previous block
-     * - Using a footer at the end of each block
-     * 
-     * For simplicity, we only coalesce forward here. A more sophisticated
-     * implementation would use boundary tags (header + footer) for O(1)
-     * bidirectional coalescing.
-     */
+    freelist_block_t *prev = free_prev_block(block);
+    freelist_block_t *next = next_block(block);
+    if (next && !next->is_free) {
+        next = NULL;
+    }
+
+    if (next) {
+        /* Absorb the next block; take over its list slot unless prev wins */
+        block->size += BLOCK_OVERHEAD + next->size;
+        if (prev) {
+            free_list_remove(next);
+        } else {
+            free_list_replace(next, block);
+        }
+    }
+
+    if (prev) {
+        /* Grow the previous block over us; it keeps its list slot */
+        prev->size += BLOCK_OVERHEAD + block->size;
+        write_footer(prev);
+    } else {
+        write_footer(block);
+        if (!next) {
+            free_list_insert(block);
+        }
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -371,8 +540,7 @@ void freelist_get_stats(freelist_stats_t *stats)
 
     stats->total_size = heap_total_size;
     stats->bytes_allocated = bytes_allocated;
-    stats->bytes_free = heap_total_size - bytes_allocated - 
-                        (list_size(&free_list) * sizeof(freelist_block_t));
+    stats->bytes_free = 0;
     stats->allocation_count = total_allocations;
     stats->free_count = total_frees;
     stats->free_block_count = 0;
@@ -382,39 +550,228 @@ void freelist_get_stats(freelist_stats_t *stats)
     list_node_t *current;
     list_for_each(current, &free_list) {
         freelist_block_t *block = list_entry(current, freelist_block_t, node);
-        if (block->is_free) {
-            stats->free_block_count++;
-            if (block->size > stats->largest_free_block) {
-                stats->largest_free_block = block->size;
-            }
+        stats->free_block_count++;
+        stats->bytes_free += block->size;
+        if (block->size > stats->largest_free_block) {
+            stats->largest_free_block = block->size;
         }
     }
+
+    /* Scaled down by 16 so the percentage fits in 32-bit arithmetic */
+    size_t free_units = stats->bytes_free >> 4;
+    size_t outside_units = (stats->bytes_free - stats->largest_free_block) >> 4;
+    stats->fragmentation = free_units ?
+        (uint32_t)((outside_units * 100) / free_units) : 0;
 }
 
 /* ---------------------------------------------------------------------------
  * freelist_debug_dump - Dump the heap state for debugging
  * ---------------------------------------------------------------------------
  * This function walks through all blocks (free and allocated) and could
- * print their information. For now, it just validates heap integrity.
+ * print their information. For now, it just validates heap integrity:
+ * header/footer agreement, no two adjacent free blocks, and a free list
+ * holding exactly the free blocks (in address order when so configured).
  *
  * Returns the number of blocks found, or -1 if corruption is detected.
  * --------------------------------------------------------------------------- */
 int freelist_debug_dump(void)
 {
     int block_count = 0;
+    size_t free_blocks = 0;
+    bool prev_free = false;
     char *current_addr = (char *)heap_start;
 
     while (current_addr < (char *)heap_end) {
         freelist_block_t *block = (freelist_block_t *)current_addr;
-        
+
         /* Basic sanity check */
         if (block->size == 0 || block->size > heap_total_size) {
             return -1;  /* Corruption detected */
         }
 
+        freelist_tag_t *tag = block_footer(block);
+        if (tag->size != block->size || (tag->is_free != 0) != (block->is_free != 0)) {
+            return -1;  /* Boundary tags disagree */
+        }
+
+        if (block->is_free) {
+            if (prev_free) {
+                return -1;  /* Missed coalesce */
+            }
+            free_blocks++;
+        }
+        prev_free = block->is_free;
+
         block_count++;
-        current_addr += sizeof(freelist_block_t) + block->size;
+        current_addr += BLOCK_OVERHEAD + block->size;
+    }
+
+    if (current_addr != (char *)heap_end || free_blocks != list_size(&free_list)) {
+        return -1;
+    }
+
+    list_node_t *current;
+    void *last = NULL;
+    list_for_each(current, &free_list) {
+        freelist_block_t *block = list_entry(current, freelist_block_t, node);
+        if (!block->is_free) {
+            return -1;  /* Allocated block on the free list */
+        }
+        if (active_policy.order == FREELIST_ORDER_ADDRESS && (void *)block < last) {
+            return -1;  /* Address order broken */
+        }
+        last = block;
     }
 
     return block_count;
 }
+
+/* ---------------------------------------------------------------------------
+ * Benchmark Support
+ * --------------------------------------------------------------------------- */
+
+/* xorshift32 step for the trace generator */
+static inline uint32_t trace_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* ---------------------------------------------------------------------------
+ * freelist_trace_generate - Build a synthetic allocation trace
+ * ---------------------------------------------------------------------------
+ * The first quarter of the slots churns through small, short-lived objects;
+ * the rest hold medium objects and occasional large buffers that live much
+ * longer. Allocating into an occupied slot frees its old block first.
+ * --------------------------------------------------------------------------- */
+void freelist_trace_generate(freelist_trace_op_t *ops, size_t count,
+                             size_t slots, uint32_t seed)
+{
+    if (!ops || slots < 4 || slots > 0xFFFF) {
+        return;
+    }
+
+    uint32_t state = seed ? seed : 0x9E3779B9u;
+    size_t hot_slots = slots / 4;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t r = trace_random(&state);
+        uint32_t kind = r % 100;
+        uint32_t pick = trace_random(&state);
+
+        if (kind < 30) {
+            /* Free a random slot (a no-op if it is empty) */
+            ops[i].slot = (uint16_t)(pick % slots);
+            ops[i].size = 0;
+        } else if (kind < 80) {
+            ops[i].slot = (uint16_t)(pick % hot_slots);
+            ops[i].size = 16 + (pick >> 16) % 113;
+        } else if (kind < 97) {
+            ops[i].slot = (uint16_t)(hot_slots + pick % (slots - hot_slots));
+            ops[i].size = 128 + (pick >> 16) % 897;
+        } else {
+            ops[i].slot = (uint16_t)(hot_slots + pick % (slots - hot_slots));
+            ops[i].size = 2048 + (pick >> 16) % 14337;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * freelist_benchmark - Replay a trace under every policy
+ * ---------------------------------------------------------------------------
+ * The scratch region holds the slot table followed by the benchmark heap.
+ * Fragmentation sampling is excluded from the timed cycles.
+ * --------------------------------------------------------------------------- */
+size_t freelist_benchmark(void *scratch, size_t scratch_size,
+                          const freelist_trace_op_t *ops, size_t count,
+                          size_t slots, freelist_bench_result_t *results)
+{
+    if (!scratch || !ops || !results || slots == 0) {
+        return 0;
+    }
+
+    uintptr_t base = ALIGN_UP((uintptr_t)scratch, FREELIST_ALIGNMENT);
+    size_t table_bytes = ALIGN_UP(slots * sizeof(void *), FREELIST_ALIGNMENT);
+    if (base - (uintptr_t)scratch + table_bytes + MIN_SPLIT_SIZE > scratch_size) {
+        return 0;
+    }
+
+    void **table = (void **)base;
+    void *bench_heap = (void *)(base + table_bytes);
+    size_t bench_size = scratch_size - (base - (uintptr_t)scratch) - table_bytes;
+    size_t written = 0;
+
+    for (int fit = 0; fit < FREELIST_FIT_COUNT; fit++) {
+        for (int order = 0; order < FREELIST_ORDER_COUNT; order++) {
+            freelist_policy_t policy = { (freelist_fit_t)fit, (freelist_order_t)order };
+            freelist_bench_result_t *res = &results[written];
+            freelist_stats_t stats;
+
+            if (!freelist_init_policy(bench_heap, bench_size, &policy)) {
+                return written;
+            }
+            for (size_t s = 0; s < slots; s++) {
+                table[s] = NULL;
+            }
+
+            res->policy = policy;
+            res->ops = (uint32_t)count;
+            res->failed_allocs = 0;
+            res->peak_fragmentation = 0;
+            res->peak_free_blocks = 0;
+
+            uint64_t cycles = 0;
+            uint64_t start = clock_cycles();
+
+            for (size_t i = 0; i < count; i++) {
+                uint16_t slot = ops[i].slot;
+                if (slot >= slots) {
+                    continue;
+                }
+
+                if (table[slot]) {
+                    freelist_free(table[slot]);
+                    table[slot] = NULL;
+                }
+                if (ops[i].size) {
+                    table[slot] = freelist_alloc(ops[i].size);
+                    if (!table[slot]) {
+                        res->failed_allocs++;
+                    }
+                }
+
+                if (i % BENCH_SAMPLE_INTERVAL == BENCH_SAMPLE_INTERVAL - 1) {
+                    cycles += clock_cycles() - start;
+                    freelist_get_stats(&stats);
+                    if (stats.fragmentation > res->peak_fragmentation) {
+                        res->peak_fragmentation = stats.fragmentation;
+                    }
+                    if (stats.free_block_count > res->peak_free_blocks) {
+                        res->peak_free_blocks = stats.free_block_count;
+                    }
+                    start = clock_cycles();
+                }
+            }
+            cycles += clock_cycles() - start;
+
+            freelist_get_stats(&stats);
+            res->final_fragmentation = stats.fragmentation;
+
+            /* 32-bit average without 64-bit division */
+            uint32_t divisor = (uint32_t)(count ? count : 1);
+            while (cycles >> 32) {
+                cycles >>= 1;
+                divisor = (divisor >> 1) ? (divisor >> 1) : 1;
+            }
+            res->cycles_per_op = (uint32_t)cycles / divisor;
+
+            written++;
+        }
+    }
+
+    return written;
+}
@@ -10,10 +10,12 @@
  * dynamic memory allocation within the kernel heap.
  *
  * Key Features:
- *   - First-fit and best-fit allocation strategies
+ *   - First-fit, next-fit and best-fit allocation policies
+ *   - Free list kept in address order or LIFO order, chosen at init
+ *   - Boundary tags (header + footer) for O(1) coalescing in both directions
  *   - Automatic block splitting for efficient space usage
- *   - Automatic coalescing to reduce fragmentation
  *   - Detailed statistics for debugging and monitoring
+ *   - Trace-replay benchmark comparing policies on the same workload
  *
  * Usage:
  *   char heap_memory[1024 * 1024];  // 1MB heap
@@ -43,10 +45,37 @@
  * --------------------------------------------------------------------------- */
 typedef struct freelist_block {
     list_node_t node;   /* Intrusive list node for linking free blocks */
-    size_t size;        /* Size of usable memory (excluding this header) */
+    size_t size;        /* Size of usable memory (excluding header/footer) */
     bool is_free;       /* true if block is free, false if allocated */
 } freelist_block_t;
 
+/* ---------------------------------------------------------------------------
+ * Allocation Policy
+ * ---------------------------------------------------------------------------
+ * fit:   which free block satisfies a request
+ * order: where a newly freed block goes in the free list. Address order
+ *        keeps first-fit and next-fit packing towards low addresses at the
+ *        cost of a list walk when a block has no free neighbour; LIFO makes
+ *        every free O(1).
+ * --------------------------------------------------------------------------- */
+typedef enum freelist_fit {
+    FREELIST_FIT_FIRST = 0,     /* First block that fits */
+    FREELIST_FIT_NEXT,          /* First fit, resuming where the last ended */
+    FREELIST_FIT_BEST,          /* Smallest block that fits */
+    FREELIST_FIT_COUNT
+} freelist_fit_t;
+
+typedef enum freelist_order {
+    FREELIST_ORDER_ADDRESS = 0, /* Free list sorted by block address */
+    FREELIST_ORDER_LIFO,        /* Most recently freed block first */
+    FREELIST_ORDER_COUNT
+} freelist_order_t;
+
+typedef struct freelist_policy {
+    freelist_fit_t fit;
+    freelist_order_t order;
+} freelist_policy_t;
+
 /* ---------------------------------------------------------------------------
  * Allocator Statistics Structure
  * ---------------------------------------------------------------------------
@@ -61,8 +90,30 @@ typedef struct freelist_stats {
     size_t free_count;          /* Total number of frees made */
     size_t free_block_count;    /* Current number of free blocks */
     size_t largest_free_block;  /* Size of largest contiguous free block */
+    uint32_t fragmentation;     /* % of free bytes outside the largest block */
 } freelist_stats_t;
 
+/* ---------------------------------------------------------------------------
+ * Benchmark Trace and Results
+ * ---------------------------------------------------------------------------
+ * A trace is a sequence of operations on numbered slots: a non-zero size
+ * allocates into the slot, a zero size frees whatever the slot holds.
+ * --------------------------------------------------------------------------- */
+typedef struct freelist_trace_op {
+    uint16_t slot;              /* Slot index (< trace slot count) */
+    uint32_t size;              /* Bytes to allocate, or 0 to free */
+} freelist_trace_op_t;
+
+typedef struct freelist_bench_result {
+    freelist_policy_t policy;
+    uint32_t ops;               /* Operations replayed */
+    uint32_t failed_allocs;     /* Allocations that returned NULL */
+    uint32_t cycles_per_op;     /* Average TSC cycles per operation */
+    uint32_t peak_fragmentation;/* Worst sampled fragmentation (%) */
+    uint32_t final_fragmentation;/* Fragmentation at the end of the trace */
+    size_t peak_free_blocks;    /* Most free blocks seen at a sample */
+} freelist_bench_result_t;
+
 /* ---------------------------------------------------------------------------
  * Initialization
  * --------------------------------------------------------------------------- */
@@ -79,18 +130,31 @@ typedef struct freelist_stats {
  */
 bool freelist_init(void *start, size_t size);
 
+/**
+ * @brief Initialize the free list allocator with a specific policy
+ * 
+ * @param start  Start address of the heap memory region
+ * @param size   Total size of the heap in bytes
+ * @param policy Fit and ordering policy (NULL = first-fit, address order)
+ * @return true on success, false if parameters are invalid
+ * 
+ * freelist_init() is equivalent to passing NULL.
+ */
+bool freelist_init_policy(void *start, size_t size, const freelist_policy_t *policy);
+
 /* ---------------------------------------------------------------------------
  * Allocation Functions
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Allocate memory using first-fit strategy
+ * @brief Allocate memory using the policy chosen at init
  * 
  * @param size Number of bytes to allocate
  * @return Pointer to allocated memory, or NULL if allocation fails
  * 
- * First-fit finds the first block that's large enough. This is fast but
- * may lead to fragmentation at the beginning of the heap.
+ * With the default first-fit policy this finds the first block that's large
+ * enough. This is fast but may lead to fragmentation at the beginning of
+ * the heap.
  */
 void *freelist_alloc(size_t size);
 
@@ -126,12 +190,46 @@ void freelist_free(void *ptr);
  */
 void freelist_get_stats(freelist_stats_t *stats);
 
+/**
+ * @brief Generate a synthetic allocation trace
+ * 
+ * @param ops   Output array of operations
+ * @param count Number of operations to generate
+ * @param slots Number of slots the trace may use (at most 65535)
+ * @param seed  Seed for the deterministic generator (0 = default)
+ * 
+ * Mixes many short-lived small objects, some long-lived medium ones and
+ * the occasional large buffer, which is the pattern that separates the
+ * policies. The same seed always yields the same trace.
+ */
+void freelist_trace_generate(freelist_trace_op_t *ops, size_t count,
+                             size_t slots, uint32_t seed);
+
+/**
+ * @brief Replay a trace under every policy and report the results
+ * 
+ * @param scratch     Memory used as the benchmark heap (and slot table)
+ * @param scratch_size Size of the scratch region in bytes
+ * @param ops         Trace to replay
+ * @param count       Number of operations in the trace
+ * @param slots       Number of slots the trace uses
+ * @param results     Output, FREELIST_FIT_COUNT * FREELIST_ORDER_COUNT entries
+ * @return Number of results written, or 0 if the scratch region is too small
+ * 
+ * @note Re-initializes the allocator for every run; do not use while a
+ *       freelist heap is live.
+ */
+size_t freelist_benchmark(void *scratch, size_t scratch_size,
+                          const freelist_trace_op_t *ops, size_t count,
+                          size_t slots, freelist_bench_result_t *results);
+
 /**
  * @brief Validate heap integrity and count blocks
  * 
  * @return Number of blocks in the heap, or -1 if corruption is detected
  * 
- * This function walks through all blocks and validates their structure.
+ * This function walks through all blocks, checking that every header agrees
+ * with its footer and that the free list holds exactly the free blocks.
  * Useful for detecting memory corruption during debugging.
  */
 int freelist_debug_dump(void);
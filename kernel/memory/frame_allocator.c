@@ -10,13 +10,42 @@
  * by tracking which physical memory frames are available and which are in use.
  *
  * Design:
- *   - Uses a bitmap where each bit represents one physical frame
+ *   - Memory is split into zones: DMA (below DMA_ZONE_LIMIT, reachable by
+ *     ISA DMA) and NORMAL (everything above). Each zone has its own bitmap
+ *     where each bit represents one physical frame
  *   - Bit value 0 = frame is free, 1 = frame is allocated
  *   - Supports frame sizes defined by PAGE_SIZE (typically 4KB)
+ *   - Requests name a zone and walk its fallback list (NORMAL falls back to
+ *     DMA, DMA has no fallback). A zone only serves another zone's request
+ *     while it stays above its watermark, so general allocations cannot
+ *     drain the scarce low frames that DMA users depend on
+ *   - Optionally hands the free memory left after boot to the buddy tree
+ *     (frame_enable_buddy), which then serves multi-page requests in
+ *     O(log n) with coalescing. The region is marked used in its zone's
+ *     bitmap, so the bitmap paths never hand out buddy-owned frames. There
+ *     is a single buddy tree, so it backs one zone (NORMAL when possible)
  *
  * Memory Map (x86 typical):
  *   0x00000000 - 0x000FFFFF: Low memory (BIOS, VGA, etc.) - often unusable
- *   0x00100000 - onwards:    Extended memory - available for use
+ *   0x00100000 - 0x00FFFFFF: Extended memory - DMA zone
+ *   0x01000000 - onwards:    Extended memory - NORMAL zone
+ *
+ * Holes and firmware-reserved ranges reported by the multiboot memory map
+ * are taken out with frame_exclude(), which marks them used and counts them
+ * as reserved rather than allocated.
+ *
+ * Reclaim:
+ *   Caches that hold frames they can give back (the block buffer cache)
+ *   register a reclaimer with frame_register_reclaim(). When a single-frame
+ *   request finds every zone exhausted, the reclaimers are asked for
+ *   FRAME_RECLAIM_BATCH frames each until the retry succeeds. Reclaim does
+ *   not nest: frames a reclaimer allocates itself never trigger it again.
+ *
+ * Locking:
+ *   frame_lock, a leaf spinlock (spinlock.h), guards the zones, the buddy
+ *   tree and the share counts. Reclaimers run without it, since they take
+ *   the kernel lock to walk their caches. Setup (frame_init, frame_reserve,
+ *   frame_exclude, frame_enable_buddy) runs on the BSP alone.
  *
  * Integration:
  *   This allocator is initialized early in kernel_main() with information
@@ -29,8 +58,10 @@
  */
 
 #include "memory.h"
+#include "dsa_structures/buddy.h"
 #include "../../lib/dsa/bitmap.h"
 #include "../../config/os_config.h"
+#include "../scheduler/spinlock.h"
 
 /* ---------------------------------------------------------------------------
  * Configuration and Constants
@@ -42,23 +73,57 @@
 /* Number of bits in the bitmap = max frames we can track */
 #define MAX_FRAMES  (MAX_PHYSICAL_MEMORY_SUPPORTED / PAGE_SIZE)
 
+/* Zone watermark: 1/16 of the zone, capped at 4MB of frames */
+#define ZONE_WATERMARK_DIVISOR          16
+#define ZONE_WATERMARK_MAX              1024
+
+/* Registered reclaimers, and frames asked of each per exhausted request */
+#define FRAME_MAX_RECLAIMERS            4
+#define FRAME_RECLAIM_BATCH             8
+
+/* ---------------------------------------------------------------------------
+ * Zone Descriptor
+ * --------------------------------------------------------------------------- */
+typedef struct zone {
+    const char *name;
+    uintptr_t base;             /* Address of the zone's first frame */
+    uintptr_t end;              /* One past the zone's last byte */
+    size_t frames;              /* Frames in the zone */
+    size_t used;                /* Frames in use (reserved ones included) */
+    size_t reserved;            /* Frames excluded as holes/firmware areas */
+    size_t watermark;           /* Free frames kept back from fallbacks */
+    size_t fallback_allocs;     /* Requests served for another zone */
+    bitmap_t bitmap;            /* One bit per frame in the zone */
+} zone_t;
+
 /* ---------------------------------------------------------------------------
  * Static Variables
  * --------------------------------------------------------------------------- */
 
-/* The bitmap tracking frame allocation */
-static bitmap_t frame_bitmap;
+/* The zones, indexed by frame_zone_t */
+static zone_t zones[FRAME_ZONE_COUNT];
 
-/* Statically allocated bitmap buffer (enough for MAX_FRAMES bits) */
+/* Fallback order per requested zone, terminated by FRAME_ZONE_COUNT */
+static const frame_zone_t zone_fallback[FRAME_ZONE_COUNT][FRAME_ZONE_COUNT + 1] = {
+    [FRAME_ZONE_DMA]    = { FRAME_ZONE_DMA, FRAME_ZONE_COUNT },
+    [FRAME_ZONE_NORMAL] = { FRAME_ZONE_NORMAL, FRAME_ZONE_DMA, FRAME_ZONE_COUNT },
+};
+
+/* Statically allocated bitmap storage, carved into one slice per zone */
 /* For 256MB with 4KB pages = 65536 frames = 8192 bytes (8KB) */
-static uint8_t bitmap_buffer[(MAX_FRAMES + 7) / 8];
+static uint32_t bitmap_buffer[BITMAP_BUFFER_SIZE(MAX_FRAMES) / sizeof(uint32_t) +
+                              FRAME_ZONE_COUNT];
+
+/* Summary levels: one bit per fully used bitmap word (256 bytes at 256MB) */
+static uint32_t bitmap_summary[BITMAP_SUMMARY_SIZE(MAX_FRAMES) / sizeof(uint32_t) +
+                               FRAME_ZONE_COUNT];
+
+/* Extra mappings per frame beyond its owner (copy-on-write sharing, 128KB at 256MB) */
+static uint16_t frame_shares[MAX_FRAMES];
 
 /* Total number of frames being managed */
 static size_t total_frames = 0;
 
-/* Number of frames currently in use */
-static size_t used_frames = 0;
-
 /* Base address of the managed memory region */
 static uintptr_t memory_base = 0;
 
@@ -68,6 +133,358 @@ static uintptr_t memory_end = 0;
 /* Initialization flag */
 static bool initialized = false;
 
+/* Set once frame_enable_buddy() has handed a region to the buddy tree */
+static bool buddy_enabled = false;
+
+/* Frames owned by the buddy tree, including its metadata at the end */
+static uintptr_t buddy_region_start = 0;
+static uintptr_t buddy_region_end = 0;
+
+/* Zone the buddy region lies in */
+static zone_t *buddy_zone = NULL;
+
+/* Callbacks that free cached frames under memory pressure */
+static frame_reclaim_t reclaimers[FRAME_MAX_RECLAIMERS];
+static size_t reclaimer_count = 0;
+
+/* Set while the reclaimers run */
+static bool reclaiming = false;
+
+/* Guards the allocator state above (see Locking) */
+static spinlock_t frame_lock = SPINLOCK_INIT;
+
+/* ---------------------------------------------------------------------------
+ * Zone Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Zone containing an address, or NULL if it is not managed */
+static zone_t *zone_of(uintptr_t addr)
+{
+    for (int i = 0; i < FRAME_ZONE_COUNT; i++) {
+        if (zones[i].frames && addr >= zones[i].base && addr < zones[i].end) {
+            return &zones[i];
+        }
+    }
+    return NULL;
+}
+
+/* Index of the frame at addr inside its zone's bitmap */
+static inline size_t zone_index(const zone_t *zone, uintptr_t addr)
+{
+    return (addr - zone->base) / PAGE_SIZE;
+}
+
+/* Address of a frame index inside a zone */
+static inline uintptr_t zone_addr(const zone_t *zone, size_t index)
+{
+    return zone->base + (uintptr_t)index * PAGE_SIZE;
+}
+
+/* Set up one zone over [base, end) and give it a slice of the bitmap storage */
+static void zone_init(zone_t *zone, const char *name, uintptr_t base, uintptr_t end,
+                      size_t *buffer_words, size_t *summary_words)
+{
+    zone->name = name;
+    zone->base = base;
+    zone->end = end > base ? end : base;
+    zone->frames = (zone->end - zone->base) / PAGE_SIZE;
+    zone->used = 0;
+    zone->reserved = 0;
+    zone->fallback_allocs = 0;
+
+    zone->watermark = zone->frames / ZONE_WATERMARK_DIVISOR;
+    if (zone->watermark > ZONE_WATERMARK_MAX) {
+        zone->watermark = ZONE_WATERMARK_MAX;
+    }
+
+    if (zone->frames == 0) {
+        return;
+    }
+
+    bitmap_init(&zone->bitmap, zone->frames, &bitmap_buffer[*buffer_words]);
+    bitmap_enable_summary(&zone->bitmap, &bitmap_summary[*summary_words]);
+    *buffer_words += BITMAP_BUFFER_SIZE(zone->frames) / sizeof(uint32_t);
+    *summary_words += BITMAP_SUMMARY_SIZE(zone->frames) / sizeof(uint32_t);
+}
+
+/* Mark [start, end) used in every zone it touches; returns frames newly set */
+static size_t zone_mark_range(uintptr_t start, uintptr_t end, bool hole)
+{
+    size_t marked = 0;
+
+    for (int z = 0; z < FRAME_ZONE_COUNT; z++) {
+        zone_t *zone = &zones[z];
+        uintptr_t lo = start > zone->base ? start : zone->base;
+        uintptr_t hi = end < zone->end ? end : zone->end;
+
+        for (uintptr_t addr = lo; addr < hi; addr += PAGE_SIZE) {
+            size_t idx = zone_index(zone, addr);
+            if (!bitmap_test(&zone->bitmap, idx)) {
+                bitmap_set(&zone->bitmap, idx);
+                zone->used++;
+                if (hole) {
+                    zone->reserved++;
+                }
+                marked++;
+            }
+        }
+    }
+
+    return marked;
+}
+
+/* ---------------------------------------------------------------------------
+ * Buddy Region Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Check whether an address belongs to the buddy region */
+static bool in_buddy_region(uintptr_t addr)
+{
+    return buddy_enabled && addr >= buddy_region_start && addr < buddy_region_end;
+}
+
+/* Smallest order whose block holds count frames, or -1 if none does */
+static int frames_to_order(size_t count)
+{
+    int order = 0;
+
+    while (((size_t)1 << order) < count) {
+        if (++order > BUDDY_MAX_ORDER) {
+            return -1;
+        }
+    }
+    return order;
+}
+
+/* Check that every frame in [addr, addr + count pages) is handed out */
+static bool buddy_frames_allocated(uintptr_t addr, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!buddy_is_allocated((void *)(addr + i * PAGE_SIZE))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Return count frames starting at addr to the buddy tree, as the largest
+ * naturally aligned blocks that tile the range. The buddy region starts on a
+ * BUDDY_MAX_BLOCK_SIZE boundary, so absolute alignment is block alignment.
+ * Frames that are already free (or not managed by the tree) are skipped,
+ * mirroring the double-free tolerance of the bitmap path.
+ */
+static void buddy_release_frames(uintptr_t addr, size_t count)
+{
+    while (count > 0) {
+        int order = BUDDY_MAX_ORDER;
+        size_t frames_in_block = (size_t)1 << order;
+
+        while (frames_in_block > count ||
+               (addr & (frames_in_block * PAGE_SIZE - 1)) != 0 ||
+               (order > 0 && !buddy_frames_allocated(addr, frames_in_block))) {
+            order--;
+            frames_in_block >>= 1;
+        }
+
+        if (buddy_is_allocated((void *)addr)) {
+            buddy_free_order((void *)addr, order);
+            buddy_zone->used -= frames_in_block;
+        }
+
+        addr += frames_in_block * PAGE_SIZE;
+        count -= frames_in_block;
+    }
+}
+
+/*
+ * Take a block of the given order from the buddy tree and give back the
+ * frames past count, so callers are charged for exactly what they asked.
+ */
+static uintptr_t buddy_take_frames(size_t count, int order)
+{
+    void *block = buddy_alloc_order(order);
+
+    if (!block) {
+        return 0;
+    }
+
+    uintptr_t addr = (uintptr_t)block;
+    size_t frames_in_block = (size_t)1 << order;
+
+    buddy_zone->used += frames_in_block;
+    if (count < frames_in_block) {
+        buddy_release_frames(addr + count * PAGE_SIZE, frames_in_block - count);
+    }
+    return addr;
+}
+
+/* ---------------------------------------------------------------------------
+ * Per-Zone Allocation
+ * --------------------------------------------------------------------------- */
+
+/* One frame from a zone's bitmap, then from its buddy tree */
+static uintptr_t zone_alloc_single(zone_t *zone)
+{
+    int64_t frame_idx = bitmap_find_first_zero(&zone->bitmap);
+
+    if (frame_idx < 0) {
+        /* Single frames only come from the buddy tree once the bitmap is
+         * exhausted, to keep its large blocks intact */
+        return (buddy_zone == zone) ? buddy_take_frames(1, 0) : 0;
+    }
+
+    bitmap_set(&zone->bitmap, (size_t)frame_idx);
+    zone->used++;
+    return zone_addr(zone, (size_t)frame_idx);
+}
+
+/* A run of frames: buddy tree first, then a bitmap scan */
+static uintptr_t zone_alloc_run(zone_t *zone, size_t count)
+{
+    if (buddy_zone == zone) {
+        int order = frames_to_order(count);
+
+        if (order >= 0) {
+            uintptr_t addr = buddy_take_frames(count, order);
+            if (addr != 0) {
+                return addr;
+            }
+        }
+    }
+
+    int64_t start_idx = bitmap_find_contiguous_zeros(&zone->bitmap, count);
+
+    if (start_idx < 0) {
+        return 0;  /* Not enough contiguous memory */
+    }
+
+    bitmap_set_range(&zone->bitmap, (size_t)start_idx, count);
+    zone->used += count;
+    return zone_addr(zone, (size_t)start_idx);
+}
+
+/*
+ * An aligned run. In buddy mode the request is rounded up to a block at
+ * least as large as the alignment, which is then aligned by construction.
+ * Otherwise only candidate starts on an alignment boundary are probed; when
+ * a used frame is found inside a candidate run, the search resumes at the
+ * next boundary past it.
+ */
+static uintptr_t zone_alloc_aligned(zone_t *zone, size_t count, size_t alignment)
+{
+    if (buddy_zone == zone) {
+        int order = frames_to_order(count);
+        int align_order = frames_to_order(alignment / PAGE_SIZE);
+
+        if (order >= 0 && align_order >= 0) {
+            uintptr_t addr = buddy_take_frames(count,
+                                  order > align_order ? order : align_order);
+            if (addr != 0) {
+                return addr;
+            }
+        }
+    }
+
+    uintptr_t addr = ALIGN_UP(zone->base, alignment);
+
+    while (addr >= zone->base && addr + count * PAGE_SIZE <= zone->end) {
+        size_t start_idx = zone_index(zone, addr);
+        size_t i;
+
+        for (i = 0; i < count; i++) {
+            if (bitmap_test(&zone->bitmap, start_idx + i)) {
+                break;
+            }
+        }
+
+        if (i == count) {
+            bitmap_set_range(&zone->bitmap, start_idx, count);
+            zone->used += count;
+            return addr;
+        }
+
+        /* Skip past the used frame to the next aligned boundary */
+        addr = ALIGN_UP(zone_addr(zone, start_idx + i + 1), alignment);
+    }
+
+    return 0;
+}
+
+/*
+ * Serve a request from the preferred zone or, failing that, its fallbacks.
+ * alignment == 0 means no alignment beyond PAGE_SIZE. frame_lock held.
+ */
+static uintptr_t zone_try_alloc(frame_zone_t preferred, size_t count, size_t alignment)
+{
+    if (!initialized || count == 0 || preferred >= FRAME_ZONE_COUNT) {
+        return 0;
+    }
+
+    for (int i = 0; zone_fallback[preferred][i] != FRAME_ZONE_COUNT; i++) {
+        zone_t *zone = &zones[zone_fallback[preferred][i]];
+
+        if (zone->frames == 0) {
+            continue;
+        }
+
+        /* Another zone's request may not push this zone below its watermark */
+        if (i > 0 && zone->frames - zone->used < count + zone->watermark) {
+            continue;
+        }
+
+        uintptr_t addr;
+        if (alignment) {
+            addr = zone_alloc_aligned(zone, count, alignment);
+        } else if (count == 1) {
+            addr = zone_alloc_single(zone);
+        } else {
+            addr = zone_alloc_run(zone, count);
+        }
+
+        if (addr != 0) {
+            if (i > 0) {
+                zone->fallback_allocs++;
+            }
+            return addr;
+        }
+    }
+
+    return 0;
+}
+
+/* zone_try_alloc() under frame_lock */
+static uintptr_t zone_alloc(frame_zone_t preferred, size_t count, size_t alignment)
+{
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    uintptr_t addr = zone_try_alloc(preferred, count, alignment);
+    spin_unlock_irqrestore(&frame_lock, flags);
+    return addr;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Allocate one frame, reclaiming cached frames if every zone is full
+ * --------------------------------------------------------------------------- */
+static uintptr_t zone_alloc_reclaim(frame_zone_t preferred)
+{
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    uintptr_t addr = zone_try_alloc(preferred, 1, 0);
+    if (addr != 0 || reclaiming) {
+        spin_unlock_irqrestore(&frame_lock, flags);
+        return addr;
+    }
+    reclaiming = true;
+    spin_unlock_irqrestore(&frame_lock, flags);
+
+    for (size_t i = 0; i < reclaimer_count && addr == 0; i++) {
+        if (reclaimers[i](FRAME_RECLAIM_BATCH) > 0) {
+            addr = zone_alloc(preferred, 1, 0);
+        }
+    }
+    reclaiming = false;
+    return addr;
+}
+
 /* ---------------------------------------------------------------------------
  * frame_init - Initialize the physical frame allocator
  * ---------------------------------------------------------------------------
@@ -76,9 +493,10 @@ static bool initialized = false;
  *   mem_size              - Total physical memory size in bytes
  *   start_addr            - Base address of usable memory region
  *
- * This function sets up the bitmap and marks all frames as initially free.
- * The caller should subsequently mark reserved regions (kernel, hardware)
- * as allocated using frame_reserve().
+ * This function splits the region into zones at DMA_ZONE_LIMIT, sets up
+ * their bitmaps and marks all frames as initially free. The caller should
+ * subsequently mark reserved regions (kernel, hardware) as allocated using
+ * frame_reserve(), and holes in the memory map with frame_exclude().
  * --------------------------------------------------------------------------- */
 void frame_init(void *bitmap_buffer_ignored, size_t mem_size, uintptr_t start_addr)
 {
@@ -91,20 +509,33 @@ void frame_init(void *bitmap_buffer_ignored, size_t mem_size, uintptr_t start_ad
     }
 
     /* Store memory region info */
-    memory_base = start_addr;
-    memory_end = start_addr + mem_size;
-    total_frames = mem_size / PAGE_SIZE;
-    used_frames = 0;
+    memory_base = ALIGN_UP(start_addr, PAGE_SIZE);
+    total_frames = (mem_size - (memory_base - start_addr)) / PAGE_SIZE;
 
     /* Cap at maximum supported */
     if (total_frames > MAX_FRAMES) {
         total_frames = MAX_FRAMES;
-        memory_end = memory_base + (total_frames * PAGE_SIZE);
+    }
+    memory_end = memory_base + (total_frames * PAGE_SIZE);
+
+    /* Split at the DMA limit - all frames start as free */
+    uintptr_t dma_end = DMA_ZONE_LIMIT;
+    if (dma_end < memory_base) {
+        dma_end = memory_base;
+    }
+    if (dma_end > memory_end) {
+        dma_end = memory_end;
     }
 
-    /* Initialize the bitmap - all frames start as free */
-    bitmap_init(&frame_bitmap, total_frames, bitmap_buffer);
+    size_t buffer_words = 0;
+    size_t summary_words = 0;
+    zone_init(&zones[FRAME_ZONE_DMA], "DMA", memory_base, dma_end,
+              &buffer_words, &summary_words);
+    zone_init(&zones[FRAME_ZONE_NORMAL], "NORMAL", dma_end, memory_end,
+              &buffer_words, &summary_words);
 
+    buddy_enabled = false;
+    buddy_zone = NULL;
     initialized = true;
 }
 
@@ -114,30 +545,45 @@ void frame_init(void *bitmap_buffer_ignored, size_t mem_size, uintptr_t start_ad
  * Returns:
  *   Physical address of the allocated frame, or 0 if no frames available
  *
- * This function finds the first free frame, marks it as allocated, and
- * returns its physical address. Returns 0 (NULL) on failure.
+ * This function finds the first free frame in the NORMAL zone (falling back
+ * to DMA above its watermark), marks it as allocated, and returns its
+ * physical address. Returns 0 (NULL) on failure.
  *
- * Time complexity: O(n/8) worst case, where n is total number of frames
+ * Time complexity: O(n/1024) worst case, where n is the number of frames in
+ * the zone (one summary word per 1024 frames, then a single BSF)
  * --------------------------------------------------------------------------- */
 uintptr_t frame_alloc(void)
 {
-    if (!initialized) {
-        return 0;  /* Not initialized */
-    }
-
-    /* Find the first free frame */
-    int64_t frame_idx = bitmap_find_first_zero(&frame_bitmap);
-    
-    if (frame_idx < 0) {
-        return 0;  /* Out of memory - no free frames */
-    }
+    return zone_alloc_reclaim(FRAME_ZONE_NORMAL);
+}
 
-    /* Mark the frame as allocated */
-    bitmap_set(&frame_bitmap, (size_t)frame_idx);
-    used_frames++;
+/* ---------------------------------------------------------------------------
+ * frame_alloc_zone - Allocate a single frame from a given zone
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   zone - Preferred zone; its fallback list is tried after it
+ *
+ * Returns:
+ *   Physical address of the frame, or 0 if no frame is available
+ * --------------------------------------------------------------------------- */
+uintptr_t frame_alloc_zone(frame_zone_t zone)
+{
+    return zone_alloc_reclaim(zone);
+}
 
-    /* Calculate and return the physical address */
-    return memory_base + ((uintptr_t)frame_idx * PAGE_SIZE);
+/* ---------------------------------------------------------------------------
+ * frame_register_reclaim - Add a callback that frees cached frames
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if registered, false if the table is full
+ * --------------------------------------------------------------------------- */
+bool frame_register_reclaim(frame_reclaim_t reclaim)
+{
+    if (reclaim == NULL || reclaimer_count >= FRAME_MAX_RECLAIMERS) {
+        return false;
+    }
+    reclaimers[reclaimer_count++] = reclaim;
+    return true;
 }
 
 /* ---------------------------------------------------------------------------
@@ -164,18 +610,27 @@ uintptr_t frame_alloc_at(uintptr_t addr)
         return 0;
     }
 
+    zone_t *zone = zone_of(addr);
+    if (zone == NULL) {
+        return 0;
+    }
+
     /* Calculate frame index */
-    size_t frame_idx = (addr - memory_base) / PAGE_SIZE;
+    size_t frame_idx = zone_index(zone, addr);
+
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
 
     /* Check if already allocated */
-    if (bitmap_test(&frame_bitmap, frame_idx)) {
+    if (bitmap_test(&zone->bitmap, frame_idx)) {
+        spin_unlock_irqrestore(&frame_lock, flags);
         return 0;  /* Already in use */
     }
 
     /* Mark as allocated */
-    bitmap_set(&frame_bitmap, frame_idx);
-    used_frames++;
+    bitmap_set(&zone->bitmap, frame_idx);
+    zone->used++;
 
+    spin_unlock_irqrestore(&frame_lock, flags);
     return addr;
 }
 
@@ -190,25 +645,61 @@ uintptr_t frame_alloc_at(uintptr_t addr)
  *
  * This is useful for DMA buffers and large kernel allocations that require
  * physically contiguous memory.
+ *
+ * Runs of a large page or more are first tried on a LARGE_PAGE_SIZE
+ * boundary (an order-10 block in buddy mode), so they cover as few 4MB
+ * identity pages, and TLB entries, as possible.
  * --------------------------------------------------------------------------- */
 uintptr_t frame_alloc_contiguous(size_t count)
 {
-    if (!initialized || count == 0) {
-        return 0;
+    if (count >= LARGE_PAGE_SIZE / PAGE_SIZE) {
+        uintptr_t addr = zone_alloc(FRAME_ZONE_NORMAL, count, LARGE_PAGE_SIZE);
+        if (addr != 0) {
+            return addr;
+        }
     }
+    return zone_alloc(FRAME_ZONE_NORMAL, count, 0);
+}
 
-    /* Find contiguous free frames */
-    int64_t start_idx = bitmap_find_contiguous_zeros(&frame_bitmap, count);
-    
-    if (start_idx < 0) {
-        return 0;  /* Not enough contiguous memory */
+/* ---------------------------------------------------------------------------
+ * frame_alloc_contiguous_zone - Allocate contiguous frames from a given zone
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   count - Number of contiguous frames needed
+ *   zone  - Preferred zone (FRAME_ZONE_DMA for ISA DMA buffers)
+ *
+ * Returns:
+ *   Physical address of first frame, or 0 if no zone on the fallback list
+ *   has such a run. A run never spans two zones.
+ * --------------------------------------------------------------------------- */
+uintptr_t frame_alloc_contiguous_zone(size_t count, frame_zone_t zone)
+{
+    return zone_alloc(zone, count, 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_alloc_contiguous_aligned - Allocate an aligned run of frames
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   count     - Number of contiguous frames needed
+ *   alignment - Required physical alignment of the first frame (power of 2)
+ *
+ * Returns:
+ *   Physical address of first frame, or 0 if no suitable run exists
+ *
+ * Served from the NORMAL zone (falling back to DMA), see zone_alloc_aligned.
+ * --------------------------------------------------------------------------- */
+uintptr_t frame_alloc_contiguous_aligned(size_t count, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return 0;
     }
 
-    /* Mark all frames as allocated */
-    bitmap_set_range(&frame_bitmap, (size_t)start_idx, count);
-    used_frames += count;
+    if (alignment < PAGE_SIZE) {
+        alignment = PAGE_SIZE;
+    }
 
-    return memory_base + ((uintptr_t)start_idx * PAGE_SIZE);
+    return zone_alloc(FRAME_ZONE_NORMAL, count, alignment);
 }
 
 /* ---------------------------------------------------------------------------
@@ -236,14 +727,72 @@ void frame_free(uintptr_t addr)
         return;  /* Not page-aligned */
     }
 
-    /* Calculate frame index */
-    size_t frame_idx = (addr - memory_base) / PAGE_SIZE;
+    zone_t *zone = zone_of(addr);
+    if (zone == NULL) {
+        return;
+    }
 
-    /* Check if frame is actually allocated (prevent double-free issues) */
-    if (bitmap_test(&frame_bitmap, frame_idx)) {
-        bitmap_clear(&frame_bitmap, frame_idx);
-        used_frames--;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+
+    if (in_buddy_region(addr)) {
+        buddy_release_frames(addr, 1);
+    } else {
+        /* Calculate frame index */
+        size_t frame_idx = zone_index(zone, addr);
+
+        /* Check if frame is actually allocated (prevent double-free issues) */
+        if (bitmap_test(&zone->bitmap, frame_idx)) {
+            bitmap_clear(&zone->bitmap, frame_idx);
+            zone->used--;
+        }
+    }
+
+    spin_unlock_irqrestore(&frame_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_share - Record one more mapping of an allocated frame
+ * ---------------------------------------------------------------------------
+ * Used for pages that several address spaces map copy-on-write. Each extra
+ * mapping is dropped with frame_put(); the frame is freed with the last.
+ * --------------------------------------------------------------------------- */
+void frame_share(uintptr_t addr)
+{
+    size_t index = addr / PAGE_SIZE;
+    if (index >= MAX_FRAMES) {
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (frame_shares[index] == 0xFFFF) {
+        PANIC("frame_share: share count overflow");
+    }
+    frame_shares[index]++;
+    spin_unlock_irqrestore(&frame_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_put - Drop one mapping of a frame, freeing it with the last one
+ * --------------------------------------------------------------------------- */
+void frame_put(uintptr_t addr)
+{
+    size_t index = addr / PAGE_SIZE;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (index < MAX_FRAMES && frame_shares[index] > 0) {
+        frame_shares[index]--;
+        spin_unlock_irqrestore(&frame_lock, flags);
+        return;
     }
+    spin_unlock_irqrestore(&frame_lock, flags);
+    frame_free(addr);
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_mappings - Number of mappings recorded for a frame (1 = sole owner)
+ * --------------------------------------------------------------------------- */
+uint32_t frame_mappings(uintptr_t addr)
+{
+    size_t index = addr / PAGE_SIZE;
+    return (index < MAX_FRAMES) ? 1u + frame_shares[index] : 1u;
 }
 
 /* ---------------------------------------------------------------------------
@@ -264,15 +813,37 @@ void frame_free_contiguous(uintptr_t addr, size_t count)
         return;
     }
 
-    size_t start_idx = (addr - memory_base) / PAGE_SIZE;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+
+    if (in_buddy_region(addr)) {
+        if (count > (buddy_region_end - addr) / PAGE_SIZE) {
+            count = (buddy_region_end - addr) / PAGE_SIZE;
+        }
+        buddy_release_frames(addr, count);
+        count = 0;
+    }
+
+    /* Free each frame, zone by zone */
+    zone_t *zone;
+    while (count > 0 && (zone = zone_of(addr)) != NULL) {
+        size_t start_idx = zone_index(zone, addr);
+        size_t n = zone->frames - start_idx;
+        if (n > count) {
+            n = count;
+        }
 
-    /* Free each frame */
-    for (size_t i = 0; i < count && (start_idx + i) < total_frames; i++) {
-        if (bitmap_test(&frame_bitmap, start_idx + i)) {
-            bitmap_clear(&frame_bitmap, start_idx + i);
-            used_frames--;
+        for (size_t i = 0; i < n; i++) {
+            if (bitmap_test(&zone->bitmap, start_idx + i)) {
+                bitmap_clear(&zone->bitmap, start_idx + i);
+                zone->used--;
+            }
         }
+
+        addr += n * PAGE_SIZE;
+        count -= n;
     }
+
+    spin_unlock_irqrestore(&frame_lock, flags);
 }
 
 /* ---------------------------------------------------------------------------
@@ -310,17 +881,35 @@ void frame_reserve(uintptr_t addr, size_t size)
         return;
     }
 
-    /* Calculate frame indices */
-    size_t start_idx = (start - memory_base) / PAGE_SIZE;
-    size_t end_idx = (end - memory_base) / PAGE_SIZE;
-
     /* Mark frames as allocated */
-    for (size_t i = start_idx; i < end_idx && i < total_frames; i++) {
-        if (!bitmap_test(&frame_bitmap, i)) {
-            bitmap_set(&frame_bitmap, i);
-            used_frames++;
-        }
+    zone_mark_range(start, end, false);
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_exclude - Take a range that is not usable RAM out of the pool
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   addr  - Start address (will be aligned down to page boundary)
+ *   size  - Size in bytes (will be aligned up to page boundary)
+ *
+ * Like frame_reserve(), but the frames are counted as reserved in their
+ * zone's statistics. Used for holes and firmware areas in the memory map.
+ * --------------------------------------------------------------------------- */
+void frame_exclude(uintptr_t addr, size_t size)
+{
+    if (!initialized || size == 0) {
+        return;
+    }
+
+    uintptr_t start = ALIGN_DOWN(addr, PAGE_SIZE);
+    uintptr_t end = ALIGN_UP(addr + size, PAGE_SIZE);
+
+    /* A range running past 4GB wraps; treat it as reaching the top */
+    if (end < start) {
+        end = memory_end;
     }
+
+    zone_mark_range(start, end, true);
 }
 
 /* ---------------------------------------------------------------------------
@@ -342,14 +931,132 @@ bool frame_is_free(uintptr_t addr)
         return false;
     }
 
-    size_t frame_idx = (addr - memory_base) / PAGE_SIZE;
-    return !bitmap_test(&frame_bitmap, frame_idx);
+    if (in_buddy_region(addr)) {
+        return buddy_contains((void *)addr) && !buddy_is_allocated((void *)addr);
+    }
+
+    zone_t *zone = zone_of(addr);
+    return zone && !bitmap_test(&zone->bitmap, zone_index(zone, addr));
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_enable_buddy - Back multi-page allocations with the buddy tree
+ * ---------------------------------------------------------------------------
+ * Finds the largest free run that starts on a BUDDY_MAX_BLOCK_SIZE boundary,
+ * marks it used in its zone's bitmap and passes it to buddy_init(). Zones are
+ * searched in NORMAL's fallback order, so the tree only lands in the DMA zone
+ * when NORMAL has no usable run. Frames in the run are not counted as used
+ * until the buddy tree hands them out, so the statistics functions below
+ * keep reporting real usage (the tree's own bitmap, kept at the end of the
+ * run, is counted as used).
+ * --------------------------------------------------------------------------- */
+bool frame_enable_buddy(void)
+{
+    if (!initialized || buddy_enabled) {
+        return false;
+    }
+
+    size_t block_frames = BUDDY_MAX_BLOCK_SIZE / PAGE_SIZE;
+
+    for (int z = 0; zone_fallback[FRAME_ZONE_NORMAL][z] != FRAME_ZONE_COUNT; z++) {
+        zone_t *zone = &zones[zone_fallback[FRAME_ZONE_NORMAL][z]];
+        size_t best_start = 0;
+        size_t best_count = 0;
+        size_t i = 0;
+
+        while (i < zone->frames) {
+            if (bitmap_test(&zone->bitmap, i)) {
+                i++;
+                continue;
+            }
+
+            /* Free run [i, j); trim its start up to a max-order boundary */
+            size_t j = i;
+            while (j < zone->frames && !bitmap_test(&zone->bitmap, j)) {
+                j++;
+            }
+
+            uintptr_t aligned = ALIGN_UP(zone_addr(zone, i), block_frames * PAGE_SIZE);
+            size_t start = zone_index(zone, aligned);
+
+            if (aligned >= zone->base && start < j && j - start > best_count) {
+                best_start = start;
+                best_count = j - start;
+            }
+            i = j;
+        }
+
+        uintptr_t region = zone_addr(zone, best_start);
+
+        if (best_count < 2 || !buddy_init((void *)region, best_count * PAGE_SIZE)) {
+            continue;
+        }
+
+        buddy_stats_t stats;
+        buddy_get_stats(&stats);
+
+        bitmap_set_range(&zone->bitmap, best_start, best_count);
+        zone->used += best_count - stats.total_memory / PAGE_SIZE;
+
+        buddy_region_start = region;
+        buddy_region_end = region + best_count * PAGE_SIZE;
+        buddy_zone = zone;
+
+        buddy_enabled = true;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check whether the buddy tree is backing the frame allocator
+ */
+bool frame_buddy_enabled(void)
+{
+    return buddy_enabled;
+}
+
+/* ---------------------------------------------------------------------------
+ * frame_get_zone_stats - Get one zone's statistics
+ * ---------------------------------------------------------------------------
+ * Returns false for an unknown zone. Empty zones report zero frames.
+ * --------------------------------------------------------------------------- */
+bool frame_get_zone_stats(frame_zone_t zone, frame_zone_stats_t *stats)
+{
+    if (zone >= FRAME_ZONE_COUNT || stats == NULL) {
+        return false;
+    }
+
+    const zone_t *z = &zones[zone];
+    stats->name = z->name ? z->name : "";
+    stats->start = z->base;
+    stats->end = z->end;
+    stats->total_frames = z->frames;
+    stats->used_frames = z->used;
+    stats->reserved_frames = z->reserved;
+    stats->free_frames = z->frames - z->used;
+    stats->watermark = z->watermark;
+    stats->fallback_allocs = z->fallback_allocs;
+    stats->has_buddy = (buddy_zone == z);
+    return true;
 }
 
 /* ---------------------------------------------------------------------------
  * Statistics Functions
  * --------------------------------------------------------------------------- */
 
+/* Frames in use across all zones */
+static size_t used_frames_total(void)
+{
+    size_t used = 0;
+
+    for (int i = 0; i < FRAME_ZONE_COUNT; i++) {
+        used += zones[i].used;
+    }
+    return used;
+}
+
 /**
  * @brief Get total number of frames being managed
  */
@@ -363,7 +1070,7 @@ size_t frame_total_count(void)
  */
 size_t frame_used_count(void)
 {
-    return used_frames;
+    return used_frames_total();
 }
 
 /**
@@ -371,7 +1078,7 @@ size_t frame_used_count(void)
  */
 size_t frame_free_count(void)
 {
-    return total_frames - used_frames;
+    return total_frames - used_frames_total();
 }
 
 /**
@@ -387,7 +1094,7 @@ size_t frame_total_memory(void)
  */
 size_t frame_used_memory(void)
 {
-    return used_frames * PAGE_SIZE;
+    return used_frames_total() * PAGE_SIZE;
 }
 
 /**
@@ -395,7 +1102,7 @@ size_t frame_used_memory(void)
  */
 size_t frame_free_memory(void)
 {
-    return (total_frames - used_frames) * PAGE_SIZE;
+    return (total_frames - used_frames_total()) * PAGE_SIZE;
 }
 
 /**
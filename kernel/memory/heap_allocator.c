@@ -14,9 +14,10 @@
  * memory allocation.
  *
  * Design:
- *   - Uses a free list data structure (linked list of free blocks)
+ *   - Segregated-fit allocation: free blocks are kept in size-class bins,
+ *     each bin being its own intrusive doubly linked free list
  *   - Each block has a header with size and status information
- *   - First-fit allocation strategy (fast, good enough for kernel use)
+ *   - A bitmap of non-empty bins finds the smallest usable bin in O(1)
  *   - Automatic block splitting when allocating from large blocks
  *   - Automatic coalescing of adjacent free blocks on free
  *
@@ -26,7 +27,13 @@
  * Block Header:
  *   - size: Size of usable data area (not including header)
  *   - is_free: Whether this block is available
- *   - prev/next: Links for the free list (when free) or validation (when allocated)
+ *   - prev/next: Physical neighbours in memory (for coalescing and validation)
+ *
+ * Size-Class Bins:
+ *   - Small bins:  one bin per 8-byte size below HEAP_SMALL_LIMIT (exact fit)
+ *   - Large bins:  one bin per power of two from HEAP_SMALL_LIMIT upwards
+ *   - A free block stores its bin links in its own (unused) data area, so
+ *     the header layout is the same for free and allocated blocks.
  *
  * Alignment:
  *   - All allocations are aligned to 8 bytes for performance
@@ -37,15 +44,43 @@
  *   // use memory...
  *   kfree(ptr);                // Release the memory
  *
+ * Magazine Layer:
+ *   - Blocks up to HEAP_MAG_MAX_SIZE are recycled through magazines: small
+ *     stacks of recently freed blocks of one size class
+ *   - Each task owns a loaded and a previous magazine per class; most
+ *     kmalloc/kfree pairs are a push and a pop on the current task's set
+ *   - A global depot holds spare full and empty magazines, and is the only
+ *     place that talks to the global heap, in batches of HEAP_MAG_ROUNDS/2
+ *   - Magazine sets are not tied to tasks internally; each CPU has the set
+ *     of the task it is running installed
+ *
+ * Allocation Profiler:
+ *   - Optional, switched on at run time with heap_profile_enable()
+ *   - kmalloc hashes its caller's return address into a fixed site table
+ *     and stores the site index in the block header's padding, so kfree
+ *     can charge the bytes back without any lookup
+ *   - The table has a lock of its own, prof_lock, taken only while the
+ *     profiler is on (or a profiled block is freed)
+ *
  * Thread Safety:
- *   This implementation is NOT thread-safe. In a multi-threaded kernel,
- *   callers must hold a lock when calling kmalloc/kfree.
+ *   A magazine hit or miss touches only the magazine set of the task
+ *   running on this CPU, so it runs with local interrupts disabled and no
+ *   lock. heap_lock, a leaf spinlock, guards the shared state: the block
+ *   chain and bins, the depot and the allocator counters. It is taken only
+ *   to allocate or free a heap block and to exchange magazines with the
+ *   depot. Nothing under it takes another lock except prof_lock, so kmalloc
+ *   is safe under the kernel lock and sched_lock alike. The counters bumped
+ *   on the lock-free path are per CPU and summed when read.
  *
  * ===========================================================================
  */
 
 #include "memory.h"
 #include "../../config/os_config.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/smp.h"
+#include "../utils/trace.h"
 
 /* ---------------------------------------------------------------------------
  * Configuration
@@ -63,6 +98,32 @@
 /* Magic number for detecting corruption */
 #define HEAP_MAGIC              0xDEADBEEF
 
+/* Magic number of blocks parked in a magazine (allocated from the heap's
+ * view, free from the caller's) */
+#define HEAP_MAGIC_CACHED       0xCAC4EDB1
+
+/* Largest block size served by the magazine layer */
+#define HEAP_MAG_MAX_SIZE       256
+
+/* One magazine class per 8-byte size from HEAP_MIN_ALLOC_SIZE upwards */
+#define HEAP_MAG_CLASSES        \
+    ((HEAP_MAG_MAX_SIZE - HEAP_MIN_ALLOC_SIZE) / HEAP_ALIGNMENT + 1)
+
+/* Blocks per magazine (sized so a magazine is a 64-byte heap block) */
+#define HEAP_MAG_ROUNDS         14
+
+/* Full magazines the depot keeps per class before flushing to the heap */
+#define HEAP_DEPOT_MAX_FULL     4
+
+/* Sizes below this get an exact-size bin (one per HEAP_ALIGNMENT step) */
+#define HEAP_SMALL_LIMIT        256
+#define HEAP_SMALL_BINS         (HEAP_SMALL_LIMIT / HEAP_ALIGNMENT)
+#define HEAP_SMALL_SHIFT        8       /* log2(HEAP_SMALL_LIMIT) */
+
+/* Total number of bins (small + one per power of two up to 2^31) */
+#define HEAP_BIN_COUNT          64
+#define HEAP_BIN_MAP_WORDS      (HEAP_BIN_COUNT / 32)
+
 /* ---------------------------------------------------------------------------
  * Block Header Structure
  * ---------------------------------------------------------------------------
@@ -76,10 +137,47 @@ typedef struct heap_block {
     uint32_t magic;             /* Magic number for corruption detection */
     size_t size;                /* Size of usable data (excluding header) */
     bool is_free;               /* true if block is available */
+    uint16_t site;              /* Profiler site + 1 (0 = not profiled) */
     struct heap_block *prev;    /* Previous block in memory (for coalescing) */
     struct heap_block *next;    /* Next block in memory (for coalescing) */
 } heap_block_t;
 
+/* ---------------------------------------------------------------------------
+ * Free List Links
+ * ---------------------------------------------------------------------------
+ * Stored in the data area of a free block (HEAP_MIN_ALLOC_SIZE guarantees
+ * room for them). Links blocks of the same size class together.
+ * --------------------------------------------------------------------------- */
+typedef struct heap_free_links {
+    heap_block_t *prev_free;    /* Previous free block in the same bin */
+    heap_block_t *next_free;    /* Next free block in the same bin */
+} heap_free_links_t;
+
+/* ---------------------------------------------------------------------------
+ * Magazine Structures
+ * ---------------------------------------------------------------------------
+ * A magazine is a fixed-capacity stack of free blocks of one size class. A
+ * magazine set holds a task's loaded and previous magazine for each class;
+ * keeping two lets a task alternate between alloc and free bursts without
+ * touching the depot on every boundary.
+ * --------------------------------------------------------------------------- */
+typedef struct heap_magazine {
+    struct heap_magazine *next;         /* Link in a depot list */
+    uint32_t rounds;                    /* Blocks currently held */
+    void *round[HEAP_MAG_ROUNDS];       /* Data pointers of held blocks */
+} heap_magazine_t;
+
+struct heap_magazines {
+    heap_magazine_t *loaded[HEAP_MAG_CLASSES];
+    heap_magazine_t *previous[HEAP_MAG_CLASSES];
+};
+
+typedef struct heap_depot {
+    heap_magazine_t *full;              /* Full magazines ready for exchange */
+    heap_magazine_t *empty;             /* Empty magazines ready for exchange */
+    uint32_t full_count;                /* Length of the full list */
+} heap_depot_t;
+
 /* ---------------------------------------------------------------------------
  * Static Variables
  * --------------------------------------------------------------------------- */
@@ -92,15 +190,46 @@ static size_t heap_size = 0;
 /* First block in the heap */
 static heap_block_t *first_block = NULL;
 
-/* Statistics */
-static size_t total_allocations = 0;
-static size_t total_frees = 0;
+/* Size-class bins and a bitmap of which bins are non-empty */
+static heap_block_t *bins[HEAP_BIN_COUNT];
+static uint32_t bin_map[HEAP_BIN_MAP_WORDS];
+
+/* Statistics (call counts are per CPU, below) */
 static size_t bytes_allocated = 0;
 static size_t peak_usage = 0;
 
+/* Blocks handed out by the global heap (including those in magazines) */
+static size_t live_blocks = 0;
+
+/* Magazine layer: per-class depot and each CPU's running task's set */
+static heap_depot_t depot[HEAP_MAG_CLASSES];
+static heap_magazines_t *current_magazines[SMP_MAX_CPUS];
+
+/* Counters updated without heap_lock, one cache line per CPU */
+typedef struct heap_cpu_stats {
+    heap_magazine_stats_t mag;
+    size_t allocations;
+    size_t frees;
+} __attribute__((aligned(64))) heap_cpu_stats_t;
+
+static heap_cpu_stats_t cpu_stats[SMP_MAX_CPUS];
+
+/* Guards the block chain, bins and depot; a leaf lock (spinlock.h) */
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
+/* Allocation profiler (site 0 collects callers that did not fit) */
+static heap_prof_site_t prof_sites[HEAP_PROF_SITES];
+static uint32_t prof_histogram[HEAP_PROF_BUCKETS];
+static uint32_t prof_sites_used = 0;
+static bool prof_enabled = false;
+static spinlock_t prof_lock = SPINLOCK_INIT;    /* Innermost: under heap_lock */
+
 /* Initialization flag */
 static bool heap_initialized = false;
 
+/* kmalloc with an explicit call site, for the wrappers below it */
+static void *kmalloc_from(size_t size, uintptr_t caller);
+
 /* ---------------------------------------------------------------------------
  * Helper: Align a size up to HEAP_ALIGNMENT
  * --------------------------------------------------------------------------- */
@@ -141,6 +270,127 @@ static inline void *block_end(heap_block_t *block)
     return (void *)((char *)block + sizeof(heap_block_t) + block->size);
 }
 
+/* ---------------------------------------------------------------------------
+ * Helper: Get the free list links stored in a free block
+ * --------------------------------------------------------------------------- */
+static inline heap_free_links_t *block_links(heap_block_t *block)
+{
+    return (heap_free_links_t *)block_to_data(block);
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Map an (aligned) block size to its bin index
+ * --------------------------------------------------------------------------- */
+static inline size_t size_to_bin(size_t size)
+{
+    if (size < HEAP_SMALL_LIMIT) {
+        return size / HEAP_ALIGNMENT;
+    }
+
+    size_t log2 = 31 - (size_t)__builtin_clz((uint32_t)size);
+    size_t bin = HEAP_SMALL_BINS + (log2 - HEAP_SMALL_SHIFT);
+    return (bin < HEAP_BIN_COUNT) ? bin : HEAP_BIN_COUNT - 1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Find the first non-empty bin with index >= bin
+ * ---------------------------------------------------------------------------
+ * Returns HEAP_BIN_COUNT if every bin from 'bin' upwards is empty.
+ * --------------------------------------------------------------------------- */
+static inline size_t next_nonempty_bin(size_t bin)
+{
+    size_t word = bin / 32;
+    if (word >= HEAP_BIN_MAP_WORDS) {
+        return HEAP_BIN_COUNT;
+    }
+
+    uint32_t mask = bin_map[word] & (~0u << (bin % 32));
+    while (mask == 0) {
+        if (++word >= HEAP_BIN_MAP_WORDS) {
+            return HEAP_BIN_COUNT;
+        }
+        mask = bin_map[word];
+    }
+
+    return word * 32 + (size_t)__builtin_ctz(mask);
+}
+
+/* ---------------------------------------------------------------------------
+ * bin_insert - Push a free block onto the front of its size-class bin
+ * --------------------------------------------------------------------------- */
+static void bin_insert(heap_block_t *block)
+{
+    size_t bin = size_to_bin(block->size);
+    heap_free_links_t *links = block_links(block);
+
+    links->prev_free = NULL;
+    links->next_free = bins[bin];
+    if (bins[bin]) {
+        block_links(bins[bin])->prev_free = block;
+    }
+    bins[bin] = block;
+
+    bin_map[bin / 32] |= (1u << (bin % 32));
+}
+
+/* ---------------------------------------------------------------------------
+ * bin_remove - Unlink a free block from its size-class bin
+ * ---------------------------------------------------------------------------
+ * The block's size must not have changed since it was inserted.
+ * --------------------------------------------------------------------------- */
+static void bin_remove(heap_block_t *block)
+{
+    size_t bin = size_to_bin(block->size);
+    heap_free_links_t *links = block_links(block);
+
+    if (links->prev_free) {
+        block_links(links->prev_free)->next_free = links->next_free;
+    } else {
+        bins[bin] = links->next_free;
+    }
+    if (links->next_free) {
+        block_links(links->next_free)->prev_free = links->prev_free;
+    }
+
+    if (bins[bin] == NULL) {
+        bin_map[bin / 32] &= ~(1u << (bin % 32));
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * bin_find - Find a free block of at least 'size' bytes
+ * ---------------------------------------------------------------------------
+ * Small bins hold blocks of exactly one size, so the head of the first
+ * non-empty bin at or above the request's bin always fits. A large bin spans
+ * a power-of-two range, so only the request's own bin needs to be searched;
+ * every block in a higher bin is guaranteed to fit.
+ * --------------------------------------------------------------------------- */
+static heap_block_t *bin_find(size_t size)
+{
+    size_t bin = size_to_bin(size);
+
+    if (bin >= HEAP_SMALL_BINS && bins[bin] != NULL) {
+        for (heap_block_t *block = bins[bin]; block;
+             block = block_links(block)->next_free) {
+            if (!is_valid_block(block)) {
+                PANIC("Heap corruption detected in kmalloc");
+                return NULL;
+            }
+            if (block->size >= size) {
+                return block;
+            }
+        }
+        bin++;
+    }
+
+    bin = next_nonempty_bin(bin);
+    if (bin >= HEAP_BIN_COUNT) {
+        return NULL;
+    }
+
+    return bins[bin];
+}
+
 /* ---------------------------------------------------------------------------
  * heap_init - Initialize the kernel heap allocator
  * ---------------------------------------------------------------------------
@@ -180,14 +430,43 @@ void heap_init(void *start, size_t size)
     first_block->magic = HEAP_MAGIC;
     first_block->size = size - sizeof(heap_block_t);
     first_block->is_free = true;
+    first_block->site = 0;
     first_block->prev = NULL;
     first_block->next = NULL;
 
+    /* Reset the bins and file the initial block */
+    for (size_t i = 0; i < HEAP_BIN_COUNT; i++) {
+        bins[i] = NULL;
+    }
+    for (size_t i = 0; i < HEAP_BIN_MAP_WORDS; i++) {
+        bin_map[i] = 0;
+    }
+    bin_insert(first_block);
+
     /* Reset statistics */
-    total_allocations = 0;
-    total_frees = 0;
     bytes_allocated = 0;
     peak_usage = 0;
+    live_blocks = 0;
+
+    /* Start with an empty depot and no magazine set installed */
+    for (size_t cls = 0; cls < HEAP_MAG_CLASSES; cls++) {
+        depot[cls].full = NULL;
+        depot[cls].empty = NULL;
+        depot[cls].full_count = 0;
+    }
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        current_magazines[cpu] = NULL;
+        cpu_stats[cpu] = (heap_cpu_stats_t){0};
+    }
+
+    /* Profiler table is tied to this heap's blocks */
+    for (size_t i = 0; i < HEAP_PROF_SITES; i++) {
+        prof_sites[i] = (heap_prof_site_t){0};
+    }
+    for (size_t i = 0; i < HEAP_PROF_BUCKETS; i++) {
+        prof_histogram[i] = 0;
+    }
+    prof_sites_used = 0;
 
     heap_initialized = true;
 }
@@ -197,7 +476,8 @@ void heap_init(void *start, size_t size)
  * ---------------------------------------------------------------------------
  * If the block is significantly larger than the requested size, split it
  * into two blocks: one for the allocation and one free block with the
- * remainder.
+ * remainder. The block must already be out of its bin; the remainder is
+ * filed into the bin matching its size.
  *
  * Parameters:
  *   block        - Block to potentially split
@@ -217,6 +497,7 @@ static void split_block(heap_block_t *block, size_t needed_size)
     new_block->magic = HEAP_MAGIC;
     new_block->size = block->size - needed_size - sizeof(heap_block_t);
     new_block->is_free = true;
+    new_block->site = 0;
     new_block->prev = block;
     new_block->next = block->next;
 
@@ -228,72 +509,54 @@ static void split_block(heap_block_t *block, size_t needed_size)
     /* Update the original block */
     block->size = needed_size;
     block->next = new_block;
+
+    bin_insert(new_block);
 }
 
 /* ---------------------------------------------------------------------------
- * kmalloc - Allocate memory from the kernel heap
+ * heap_alloc_block - Allocate from the global heap
  * ---------------------------------------------------------------------------
  * Parameters:
- *   size - Number of bytes to allocate
+ *   size - Number of bytes, already aligned and at least HEAP_MIN_ALLOC_SIZE
  *
  * Returns:
  *   Pointer to allocated memory, or NULL if allocation fails
  *
- * This function uses first-fit allocation: it finds the first free block
- * that is large enough to satisfy the request. This is fast but may lead
- * to fragmentation over time.
+ * Segregated fit: the request is mapped to a size-class bin and the bin
+ * bitmap yields the smallest non-empty bin that can satisfy it, so small
+ * requests cost O(1) regardless of how many blocks are live. Callers must
+ * have interrupts disabled.
  * --------------------------------------------------------------------------- */
-void *kmalloc(size_t size)
+static void *heap_alloc_block(size_t size)
 {
-    if (!heap_initialized || size == 0) {
-        return NULL;
+    /* Segregated-fit search: smallest bin that fits */
+    heap_block_t *block = bin_find(size);
+    if (!block) {
+        return NULL;  /* No suitable block found */
     }
 
-    /* Align the requested size */
-    size = align_size(size);
-
-    /* Enforce minimum allocation size */
-    if (size < HEAP_MIN_ALLOC_SIZE) {
-        size = HEAP_MIN_ALLOC_SIZE;
+    if (!is_valid_block(block) || !block->is_free) {
+        /* Heap corruption detected! */
+        PANIC("Heap corruption detected in kmalloc");
+        return NULL;
     }
 
-    /* First-fit search: find the first block that fits */
-    heap_block_t *block = first_block;
-    
-    while (block) {
-        /* Skip invalid blocks (corruption detection) */
-        if (!is_valid_block(block)) {
-            /* Heap corruption detected! */
-            PANIC("Heap corruption detected in kmalloc");
-            return NULL;
-        }
-
-        /* Check if this block is free and large enough */
-        if (block->is_free && block->size >= size) {
-            /* Found a suitable block */
-            
-            /* Try to split if the block is much larger than needed */
-            split_block(block, size);
-
-            /* Mark as allocated */
-            block->is_free = false;
-
-            /* Update statistics */
-            total_allocations++;
-            bytes_allocated += block->size;
-            if (bytes_allocated > peak_usage) {
-                peak_usage = bytes_allocated;
-            }
+    /* Take the block out of its bin, then trim off any excess */
+    bin_remove(block);
+    split_block(block, size);
 
-            /* Return pointer to usable data area */
-            return block_to_data(block);
-        }
+    /* Mark as allocated */
+    block->is_free = false;
 
-        block = block->next;
+    /* Update statistics */
+    live_blocks++;
+    bytes_allocated += block->size;
+    if (bytes_allocated > peak_usage) {
+        peak_usage = bytes_allocated;
     }
 
-    /* No suitable block found */
-    return NULL;
+    /* Return pointer to usable data area */
+    return block_to_data(block);
 }
 
 /* ---------------------------------------------------------------------------
@@ -321,7 +584,7 @@ void *kmalloc_aligned(size_t size, size_t alignment)
 
     /* Allocate extra space for alignment */
     size_t total_size = size + alignment - 1 + sizeof(void *);
-    void *raw_ptr = kmalloc(total_size);
+    void *raw_ptr = kmalloc_from(total_size, (uintptr_t)__builtin_return_address(0));
     
     if (!raw_ptr) {
         return NULL;
@@ -352,18 +615,12 @@ void kfree_aligned(void *ptr)
 }
 
 /* ---------------------------------------------------------------------------
- * coalesce_forward - Merge a block with the next block if both are free
+ * absorb_next - Grow a block over its physical successor
+ * ---------------------------------------------------------------------------
+ * Pure chain surgery; neither block's bin membership is touched.
  * --------------------------------------------------------------------------- */
-static void coalesce_forward(heap_block_t *block)
+static void absorb_next(heap_block_t *block)
 {
-    if (!block->next || !block->next->is_free) {
-        return;  /* Can't merge */
-    }
-
-    if (!is_valid_block(block->next)) {
-        return;  /* Next block is corrupt */
-    }
-
     heap_block_t *next = block->next;
 
     /* Absorb the next block */
@@ -379,21 +636,503 @@ static void coalesce_forward(heap_block_t *block)
     next->magic = 0;
 }
 
+/* ---------------------------------------------------------------------------
+ * coalesce_forward - Merge a block with the next block if both are free
+ * ---------------------------------------------------------------------------
+ * 'block' itself must not be in a bin; the absorbed neighbour is unlinked
+ * from its bin here.
+ * --------------------------------------------------------------------------- */
+static void coalesce_forward(heap_block_t *block)
+{
+    if (!block->next || !block->next->is_free) {
+        return;  /* Can't merge */
+    }
+
+    if (!is_valid_block(block->next)) {
+        return;  /* Next block is corrupt */
+    }
+
+    bin_remove(block->next);
+    absorb_next(block);
+}
+
 /* ---------------------------------------------------------------------------
  * coalesce_backward - Merge a block with the previous block if both are free
+ * ---------------------------------------------------------------------------
+ * Returns the block that now contains 'block' (the previous block if the
+ * merge happened, otherwise 'block' itself). The result is not in a bin.
  * --------------------------------------------------------------------------- */
-static void coalesce_backward(heap_block_t *block)
+static heap_block_t *coalesce_backward(heap_block_t *block)
 {
     if (!block->prev || !block->prev->is_free) {
-        return;  /* Can't merge */
+        return block;  /* Can't merge */
     }
 
     if (!is_valid_block(block->prev)) {
-        return;  /* Previous block is corrupt */
+        return block;  /* Previous block is corrupt */
     }
 
     /* Let the previous block absorb this one */
-    coalesce_forward(block->prev);
+    heap_block_t *prev = block->prev;
+    bin_remove(prev);
+    absorb_next(prev);
+    return prev;
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_free_block - Return a validated, allocated block to the global heap
+ * ---------------------------------------------------------------------------
+ * Marks the block as free and merges it with adjacent free blocks to reduce
+ * fragmentation. Callers must have interrupts disabled.
+ * --------------------------------------------------------------------------- */
+static void heap_free_block(heap_block_t *block)
+{
+    /* Mark as free */
+    block->is_free = true;
+
+    /* Update statistics */
+    live_blocks--;
+    bytes_allocated -= block->size;
+
+    /* Try to coalesce with adjacent free blocks, then file the result */
+    coalesce_forward(block);
+    block = coalesce_backward(block);
+    bin_insert(block);
+}
+
+/* ---------------------------------------------------------------------------
+ * Magazine Layer Helpers
+ * ---------------------------------------------------------------------------
+ * All helpers run with interrupts disabled. The depot_* ones and
+ * mag_release_round() need heap_lock; mag_alloc() and mag_free() take it
+ * themselves when they have to go to the depot.
+ * --------------------------------------------------------------------------- */
+
+/* The calling CPU's counters */
+static inline heap_cpu_stats_t *this_cpu_stats(void)
+{
+    return &cpu_stats[smp_cpu_id()];
+}
+
+/* Map an aligned block size to its magazine class */
+static inline size_t mag_class(size_t size)
+{
+    return (size - HEAP_MIN_ALLOC_SIZE) / HEAP_ALIGNMENT;
+}
+
+/* Block size served by a magazine class */
+static inline size_t mag_class_size(size_t cls)
+{
+    return HEAP_MIN_ALLOC_SIZE + cls * HEAP_ALIGNMENT;
+}
+
+/* Give a parked block back to the global heap */
+static void mag_release_round(void *data)
+{
+    heap_block_t *block = data_to_block(data);
+
+    block->magic = HEAP_MAGIC;
+    this_cpu_stats()->mag.cached_blocks--;
+    heap_free_block(block);
+}
+
+/* Get an empty magazine from the depot, or carve a new one from the heap */
+static heap_magazine_t *depot_get_empty(size_t cls)
+{
+    heap_magazine_t *mag = depot[cls].empty;
+
+    if (mag) {
+        depot[cls].empty = mag->next;
+    } else {
+        mag = heap_alloc_block(align_size(sizeof(heap_magazine_t)));
+        if (!mag) {
+            return NULL;
+        }
+        this_cpu_stats()->mag.magazines++;
+    }
+
+    mag->next = NULL;
+    mag->rounds = 0;
+    return mag;
+}
+
+/* Park an empty magazine in the depot */
+static void depot_put_empty(size_t cls, heap_magazine_t *mag)
+{
+    mag->next = depot[cls].empty;
+    depot[cls].empty = mag;
+}
+
+/* Park a full magazine in the depot, flushing it if the depot has enough */
+static void depot_put_full(size_t cls, heap_magazine_t *mag)
+{
+    if (depot[cls].full_count >= HEAP_DEPOT_MAX_FULL) {
+        while (mag->rounds > 0) {
+            mag_release_round(mag->round[--mag->rounds]);
+        }
+        this_cpu_stats()->mag.depot_flushes++;
+        depot_put_empty(cls, mag);
+        return;
+    }
+
+    mag->next = depot[cls].full;
+    depot[cls].full = mag;
+    depot[cls].full_count++;
+}
+
+/* Fill an empty magazine with a batch of fresh blocks from the heap */
+static void depot_refill(size_t cls, heap_magazine_t *mag)
+{
+    size_t size = mag_class_size(cls);
+
+    while (mag->rounds < HEAP_MAG_ROUNDS / 2) {
+        void *data = heap_alloc_block(size);
+        if (!data) {
+            break;
+        }
+
+        if (data_to_block(data)->size > HEAP_MAG_MAX_SIZE) {
+            /* Unsplittable remainder made the block too big to park */
+            heap_free_block(data_to_block(data));
+            break;
+        }
+
+        data_to_block(data)->magic = HEAP_MAGIC_CACHED;
+        mag->round[mag->rounds++] = data;
+        this_cpu_stats()->mag.cached_blocks++;
+    }
+    this_cpu_stats()->mag.depot_refills++;
+}
+
+/* Exchange or refill an empty loaded magazine via the depot (heap_lock held) */
+static heap_magazine_t *depot_exchange_empty(heap_magazines_t *mags, size_t cls)
+{
+    heap_magazine_t *loaded = mags->loaded[cls];
+    heap_magazine_t *prev = mags->previous[cls];
+
+    if (depot[cls].full) {
+        /* Exchange the empty previous for a full one from the depot */
+        if (prev) {
+            depot_put_empty(cls, prev);
+        }
+        mags->previous[cls] = loaded;
+        loaded = depot[cls].full;
+        depot[cls].full = loaded->next;
+        depot[cls].full_count--;
+        return loaded;
+    }
+
+    /* Depot is dry: refill the empty loaded magazine from the heap */
+    if (!loaded) {
+        loaded = depot_get_empty(cls);
+        if (!loaded) {
+            return NULL;
+        }
+    }
+    depot_refill(cls, loaded);
+    return loaded;
+}
+
+/* Allocate a block of one class through the given magazine set */
+static void *mag_alloc(heap_magazines_t *mags, size_t cls, heap_cpu_stats_t *stats)
+{
+    heap_magazine_t *loaded = mags->loaded[cls];
+
+    if (!loaded || loaded->rounds == 0) {
+        heap_magazine_t *prev = mags->previous[cls];
+
+        if (prev && prev->rounds > 0) {
+            /* Previous still has blocks: swap it in */
+            mags->previous[cls] = loaded;
+            loaded = prev;
+        } else {
+            spin_lock(&heap_lock);
+            loaded = depot_exchange_empty(mags, cls);
+            spin_unlock(&heap_lock);
+            if (!loaded) {
+                return NULL;
+            }
+        }
+        mags->loaded[cls] = loaded;
+        if (loaded->rounds == 0) {
+            return NULL;
+        }
+    }
+
+    void *data = loaded->round[--loaded->rounds];
+    data_to_block(data)->magic = HEAP_MAGIC;
+    stats->mag.cached_blocks--;
+    return data;
+}
+
+/* Free a block of one class through the given magazine set */
+static bool mag_free(heap_magazines_t *mags, size_t cls, void *data,
+                     heap_cpu_stats_t *stats)
+{
+    heap_magazine_t *loaded = mags->loaded[cls];
+
+    if (!loaded || loaded->rounds == HEAP_MAG_ROUNDS) {
+        heap_magazine_t *prev = mags->previous[cls];
+
+        if (prev && prev->rounds < HEAP_MAG_ROUNDS) {
+            /* Previous has room: swap it in */
+            mags->previous[cls] = loaded;
+            loaded = prev;
+        } else {
+            /* Hand the full previous to the depot, take an empty one */
+            spin_lock(&heap_lock);
+            heap_magazine_t *empty = depot_get_empty(cls);
+            if (empty && prev) {
+                depot_put_full(cls, prev);
+            }
+            spin_unlock(&heap_lock);
+            if (!empty) {
+                return false;
+            }
+            mags->previous[cls] = loaded;
+            loaded = empty;
+        }
+        mags->loaded[cls] = loaded;
+    }
+
+    data_to_block(data)->magic = HEAP_MAGIC_CACHED;
+    loaded->round[loaded->rounds++] = data;
+    stats->mag.cached_blocks++;
+    return true;
+}
+
+/* Return every block parked in the depot to the global heap */
+static void depot_drain(void)
+{
+    for (size_t cls = 0; cls < HEAP_MAG_CLASSES; cls++) {
+        heap_magazine_t *mag;
+
+        while ((mag = depot[cls].full) != NULL) {
+            depot[cls].full = mag->next;
+            while (mag->rounds > 0) {
+                mag_release_round(mag->round[--mag->rounds]);
+            }
+            depot_put_empty(cls, mag);
+        }
+        depot[cls].full_count = 0;
+
+        while ((mag = depot[cls].empty) != NULL) {
+            depot[cls].empty = mag->next;
+            heap_free_block(data_to_block(mag));
+            this_cpu_stats()->mag.magazines--;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Allocation Profiler Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Histogram bucket for a request size: <=16 -> 0, <=32 -> 1, ... */
+static inline size_t prof_bucket(size_t size)
+{
+    if (size <= 16) {
+        return 0;
+    }
+    size_t bucket = (32 - __builtin_clz((uint32_t)(size - 1))) - 4;
+    return bucket < HEAP_PROF_BUCKETS ? bucket : HEAP_PROF_BUCKETS - 1;
+}
+
+/* Find or claim the table entry for a caller (open addressing, entry 0 is
+ * the overflow entry) */
+static size_t prof_site_index(uintptr_t caller)
+{
+    size_t slots = HEAP_PROF_SITES - 1;
+    size_t idx = ((uint32_t)caller * 2654435761u >> 16) % slots;
+
+    for (size_t probe = 0; probe < slots; probe++) {
+        heap_prof_site_t *site = &prof_sites[1 + idx];
+        if (site->caller == caller) {
+            return 1 + idx;
+        }
+        if (site->caller == 0) {
+            site->caller = caller;
+            prof_sites_used++;
+            return 1 + idx;
+        }
+        idx = (idx + 1 == slots) ? 0 : idx + 1;
+    }
+
+    return 0;
+}
+
+/* Attribute a block that was just handed out (interrupts disabled) */
+static void prof_record_alloc(heap_block_t *block, uintptr_t caller, size_t size)
+{
+    if (!prof_enabled) {
+        block->site = 0;
+        return;
+    }
+
+    spin_lock(&prof_lock);
+    size_t idx = prof_site_index(caller);
+    heap_prof_site_t *site = &prof_sites[idx];
+
+    site->allocs++;
+    site->live_bytes += block->size;
+    if (site->live_bytes > site->peak_bytes) {
+        site->peak_bytes = site->live_bytes;
+    }
+    prof_histogram[prof_bucket(size)]++;
+    block->site = (uint16_t)(idx + 1);
+    spin_unlock(&prof_lock);
+}
+
+/* Charge a block resized in place to its site (interrupts disabled) */
+static void prof_record_resize(heap_block_t *block, size_t old_size)
+{
+    if (block->site == 0) {
+        return;
+    }
+
+    spin_lock(&prof_lock);
+    heap_prof_site_t *site = &prof_sites[block->site - 1];
+    site->live_bytes += block->size - old_size;
+    if (site->live_bytes > site->peak_bytes) {
+        site->peak_bytes = site->live_bytes;
+    }
+    spin_unlock(&prof_lock);
+}
+
+/* Charge a freed block back to its site (interrupts disabled) */
+static void prof_record_free(heap_block_t *block)
+{
+    if (block->site == 0) {
+        return;
+    }
+
+    spin_lock(&prof_lock);
+    heap_prof_site_t *site = &prof_sites[block->site - 1];
+    site->frees++;
+    site->live_bytes -= block->size;
+    spin_unlock(&prof_lock);
+    block->site = 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_resize_block - Resize an allocated block without moving it
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   block - Allocated block
+ *   size  - New size, already aligned and at least HEAP_MIN_ALLOC_SIZE
+ *
+ * Returns:
+ *   true if the block now holds at least 'size' bytes, false if it cannot
+ *   grow in place (it is left untouched)
+ *
+ * Growing absorbs the next physical block when it is free and big enough;
+ * in both directions any excess is split off the tail and returned to the
+ * bins. Callers must have interrupts disabled.
+ * --------------------------------------------------------------------------- */
+static bool heap_resize_block(heap_block_t *block, size_t size)
+{
+    size_t old_size = block->size;
+
+    if (size > block->size) {
+        heap_block_t *next = block->next;
+        if (!next || !next->is_free || !is_valid_block(next) ||
+            block->size + sizeof(heap_block_t) + next->size < size) {
+            return false;
+        }
+
+        bin_remove(next);
+        absorb_next(block);
+    }
+
+    split_block(block, size);
+
+    /*
+     * A tail split off while shrinking may sit right before a free block;
+     * merge them (a tail left over after growing never does, since the
+     * block it came from was already coalesced).
+     */
+    heap_block_t *tail = block->next;
+    if (tail && tail->is_free && tail->next && tail->next->is_free) {
+        bin_remove(tail);
+        coalesce_forward(tail);
+        bin_insert(tail);
+    }
+
+    bytes_allocated += block->size - old_size;
+    if (bytes_allocated > peak_usage) {
+        peak_usage = bytes_allocated;
+    }
+    prof_record_resize(block, old_size);
+
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * kmalloc - Allocate memory from the kernel heap
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   size - Number of bytes to allocate
+ *
+ * Returns:
+ *   Pointer to allocated memory, or NULL if allocation fails
+ *
+ * Small requests are served from the current task's magazines when it has
+ * any; everything else goes to the global heap. If the heap is exhausted,
+ * the depot is drained once and the request retried.
+ * --------------------------------------------------------------------------- */
+static void *kmalloc_from(size_t size, uintptr_t caller)
+{
+    if (!heap_initialized || size == 0) {
+        return NULL;
+    }
+
+    /* Align the requested size */
+    size = align_size(size);
+
+    /* Enforce minimum allocation size */
+    if (size < HEAP_MIN_ALLOC_SIZE) {
+        size = HEAP_MIN_ALLOC_SIZE;
+    }
+
+    /* The magazine set is this CPU's running task's: no lock to use it */
+    uint32_t flags = interrupts_save_and_disable();
+    uint32_t cpu = smp_cpu_id();
+    heap_cpu_stats_t *stats = &cpu_stats[cpu];
+    heap_magazines_t *mags = current_magazines[cpu];
+    void *data = NULL;
+
+    if (size <= HEAP_MAG_MAX_SIZE && mags) {
+        data = mag_alloc(mags, mag_class(size), stats);
+        if (data) {
+            stats->mag.hits++;
+        } else {
+            stats->mag.misses++;
+        }
+    }
+
+    if (!data) {
+        spin_lock(&heap_lock);
+        data = heap_alloc_block(size);
+        if (!data) {
+            depot_drain();
+            data = heap_alloc_block(size);
+        }
+        spin_unlock(&heap_lock);
+    }
+
+    if (data) {
+        stats->allocations++;
+        prof_record_alloc(data_to_block(data), caller, size);
+    }
+    TRACE(TRACE_KMALLOC, size, data);
+
+    interrupts_restore(flags);
+    return data;
+}
+
+void *kmalloc(size_t size)
+{
+    return kmalloc_from(size, (uintptr_t)__builtin_return_address(0));
 }
 
 /* ---------------------------------------------------------------------------
@@ -402,8 +1141,8 @@ static void coalesce_backward(heap_block_t *block)
  * Parameters:
  *   ptr - Pointer returned by kmalloc (NULL is safely ignored)
  *
- * This function marks the block as free and attempts to merge it with
- * adjacent free blocks to reduce fragmentation.
+ * Small blocks are parked in the current task's magazines; the rest are
+ * returned to the global heap and coalesced with their free neighbours.
  * --------------------------------------------------------------------------- */
 void kfree(void *ptr)
 {
@@ -417,9 +1156,16 @@ void kfree(void *ptr)
         return;  /* Pointer not from our heap */
     }
 
+    TRACE(TRACE_KFREE, ptr, 0);
+
     /* Get the block header */
     heap_block_t *block = data_to_block(ptr);
 
+    /* Already parked in a magazine - a double free by the caller */
+    if (block->magic == HEAP_MAGIC_CACHED) {
+        return;
+    }
+
     /* Validate the block */
     if (!is_valid_block(block)) {
         /* Invalid block - could be double-free or corruption */
@@ -427,22 +1173,215 @@ void kfree(void *ptr)
         return;
     }
 
-    /* Check for double-free */
-    if (block->is_free) {
-        /* Already free - this is a bug in the calling code */
+    uint32_t flags = interrupts_save_and_disable();
+    uint32_t cpu = smp_cpu_id();
+    heap_cpu_stats_t *stats = &cpu_stats[cpu];
+    heap_magazines_t *mags = current_magazines[cpu];
+
+    if (block->size <= HEAP_MAG_MAX_SIZE && mags && !block->is_free) {
+        /* Into the running task's magazine; heap_lock only if it overflows */
+        stats->frees++;
+        prof_record_free(block);
+        if (!mag_free(mags, mag_class(block->size), ptr, stats)) {
+            spin_lock(&heap_lock);
+            heap_free_block(block);
+            spin_unlock(&heap_lock);
+        }
+    } else {
+        spin_lock(&heap_lock);
+
+        /* Check for double-free (a bug in the calling code): ignore it */
+        if (!block->is_free) {
+            stats->frees++;
+            prof_record_free(block);
+            heap_free_block(block);
+        }
+
+        spin_unlock(&heap_lock);
+    }
+
+    interrupts_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_magazines_create - Allocate an empty magazine set
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   A set with no magazines loaded, or NULL if the heap is exhausted
+ *
+ * Magazines are taken from the depot lazily, the first time a class is used.
+ * --------------------------------------------------------------------------- */
+heap_magazines_t *heap_magazines_create(void)
+{
+    if (!heap_initialized) {
+        return NULL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_magazines_t *mags = heap_alloc_block(align_size(sizeof(heap_magazines_t)));
+
+    if (mags) {
+        for (size_t cls = 0; cls < HEAP_MAG_CLASSES; cls++) {
+            mags->loaded[cls] = NULL;
+            mags->previous[cls] = NULL;
+        }
+    }
+
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return mags;
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_magazines_destroy - Return a magazine set's contents to the depot
+ * ---------------------------------------------------------------------------
+ * Full magazines go back to the depot (which flushes beyond its limit),
+ * partly filled ones are emptied into the heap. If the set is the current
+ * one, the magazine layer is bypassed until another set is installed.
+ * --------------------------------------------------------------------------- */
+void heap_magazines_destroy(heap_magazines_t *mags)
+{
+    if (!mags || !heap_initialized) {
         return;
     }
 
-    /* Mark as free */
-    block->is_free = true;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
 
-    /* Update statistics */
-    total_frees++;
-    bytes_allocated -= block->size;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (current_magazines[cpu] == mags) {
+            current_magazines[cpu] = NULL;
+        }
+    }
 
-    /* Try to coalesce with adjacent free blocks */
-    coalesce_forward(block);
-    coalesce_backward(block);
+    for (size_t cls = 0; cls < HEAP_MAG_CLASSES; cls++) {
+        heap_magazine_t *pair[2] = { mags->loaded[cls], mags->previous[cls] };
+
+        for (int i = 0; i < 2; i++) {
+            heap_magazine_t *mag = pair[i];
+            if (!mag) {
+                continue;
+            }
+
+            if (mag->rounds == HEAP_MAG_ROUNDS) {
+                depot_put_full(cls, mag);
+            } else {
+                while (mag->rounds > 0) {
+                    mag_release_round(mag->round[--mag->rounds]);
+                }
+                depot_put_empty(cls, mag);
+            }
+        }
+    }
+
+    heap_free_block(data_to_block(mags));
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_set_magazines - Select the magazine set used by kmalloc/kfree
+ * ---------------------------------------------------------------------------
+ * Called by the scheduler on every context switch. NULL sends all requests
+ * straight to the global heap.
+ * --------------------------------------------------------------------------- */
+void heap_set_magazines(heap_magazines_t *mags)
+{
+    current_magazines[smp_cpu_id()] = mags;
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_drain_magazines - Return the depot's cached blocks to the heap
+ * ---------------------------------------------------------------------------
+ * Blocks held in per-task magazines stay where they are.
+ * --------------------------------------------------------------------------- */
+void heap_drain_magazines(void)
+{
+    if (!heap_initialized) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    depot_drain();
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+/**
+ * @brief Get magazine layer statistics
+ */
+void heap_get_magazine_stats(heap_magazine_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    *stats = (heap_magazine_stats_t){0};
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        const heap_magazine_stats_t *mag = &cpu_stats[cpu].mag;
+        stats->hits += mag->hits;
+        stats->misses += mag->misses;
+        stats->depot_refills += mag->depot_refills;
+        stats->depot_flushes += mag->depot_flushes;
+        stats->cached_blocks += mag->cached_blocks;
+        stats->magazines += mag->magazines;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_profile_enable - Start or stop the allocation profiler
+ * ---------------------------------------------------------------------------
+ * Blocks allocated while the profiler is off are never attributed, so the
+ * table only ever reflects what happened after the first enable.
+ * --------------------------------------------------------------------------- */
+void heap_profile_enable(bool enable)
+{
+    prof_enabled = enable;
+}
+
+/**
+ * @brief Check whether the profiler is recording
+ */
+bool heap_profile_enabled(void)
+{
+    return prof_enabled;
+}
+
+/* ---------------------------------------------------------------------------
+ * heap_get_profile - Snapshot the profiler table
+ * ---------------------------------------------------------------------------
+ * The copy is taken with interrupts disabled so it is consistent; used
+ * entries are compacted to the front and sorted by live bytes.
+ * --------------------------------------------------------------------------- */
+void heap_get_profile(heap_profile_t *profile)
+{
+    if (!profile) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&prof_lock);
+
+    profile->enabled = prof_enabled;
+    for (size_t i = 0; i < HEAP_PROF_BUCKETS; i++) {
+        profile->histogram[i] = prof_histogram[i];
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < HEAP_PROF_SITES; i++) {
+        if (prof_sites[i].allocs == 0) {
+            continue;
+        }
+
+        /* Insertion sort by live bytes, largest first */
+        size_t pos = used++;
+        while (pos > 0 && profile->sites[pos - 1].live_bytes < prof_sites[i].live_bytes) {
+            profile->sites[pos] = profile->sites[pos - 1];
+            pos--;
+        }
+        profile->sites[pos] = prof_sites[i];
+    }
+    profile->sites_used = (uint32_t)used;
+    for (size_t i = used; i < HEAP_PROF_SITES; i++) {
+        profile->sites[i] = (heap_prof_site_t){0};
+    }
+
+    spin_unlock_irqrestore(&prof_lock, flags);
 }
 
 /* ---------------------------------------------------------------------------
@@ -455,13 +1394,16 @@ void kfree(void *ptr)
  * Returns:
  *   Pointer to resized allocation, or NULL on failure
  *
- * Note: The returned pointer may be different from the input pointer.
+ * The block is resized in place whenever possible: shrinking splits off
+ * the tail, growing absorbs the next physical block if it is free. Only
+ * when that fails is the data copied to a new block, so the returned
+ * pointer may be different from the input pointer.
  * --------------------------------------------------------------------------- */
 void *krealloc(void *ptr, size_t size)
 {
     /* NULL ptr = just allocate */
     if (!ptr) {
-        return kmalloc(size);
+        return kmalloc_from(size, (uintptr_t)__builtin_return_address(0));
     }
 
     /* Size 0 = free */
@@ -473,19 +1415,25 @@ void *krealloc(void *ptr, size_t size)
     /* Get current block */
     heap_block_t *block = data_to_block(ptr);
     
-    if (!is_valid_block(block)) {
+    if (!is_valid_block(block) || block->is_free) {
         return NULL;  /* Invalid block */
     }
 
-    /* If current block is large enough, just return it */
     size = align_size(size);
-    if (block->size >= size) {
-        /* Could split here if block is much larger, but skip for simplicity */
+    if (size < HEAP_MIN_ALLOC_SIZE) {
+        size = HEAP_MIN_ALLOC_SIZE;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    bool resized = heap_resize_block(block, size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+
+    if (resized) {
         return ptr;
     }
 
-    /* Need to allocate a larger block */
-    void *new_ptr = kmalloc(size);
+    /* Need to move to a larger block */
+    void *new_ptr = kmalloc_from(size, (uintptr_t)__builtin_return_address(0));
     
     if (!new_ptr) {
         return NULL;  /* Allocation failed - original still valid */
@@ -525,7 +1473,7 @@ void *kcalloc(size_t count, size_t size)
         return NULL;  /* Overflow */
     }
 
-    void *ptr = kmalloc(total);
+    void *ptr = kmalloc_from(total, (uintptr_t)__builtin_return_address(0));
     
     if (ptr) {
         /* Zero the memory */
@@ -551,7 +1499,7 @@ size_t heap_total_size(void)
 }
 
 /**
- * @brief Get currently allocated bytes
+ * @brief Get currently allocated bytes (blocks parked in magazines included)
  */
 size_t heap_used_size(void)
 {
@@ -563,8 +1511,7 @@ size_t heap_used_size(void)
  */
 size_t heap_free_size(void)
 {
-    return heap_size - bytes_allocated - 
-           ((total_allocations - total_frees) * sizeof(heap_block_t));
+    return heap_size - bytes_allocated - (live_blocks * sizeof(heap_block_t));
 }
 
 /**
@@ -580,7 +1527,11 @@ size_t heap_peak_usage(void)
  */
 size_t heap_allocation_count(void)
 {
-    return total_allocations;
+    size_t count = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        count += cpu_stats[cpu].allocations;
+    }
+    return count;
 }
 
 /**
@@ -588,7 +1539,11 @@ size_t heap_allocation_count(void)
  */
 size_t heap_free_count(void)
 {
-    return total_frees;
+    size_t count = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        count += cpu_stats[cpu].frees;
+    }
+    return count;
 }
 
 /**
@@ -602,7 +1557,8 @@ bool heap_is_initialized(void)
 /**
  * @brief Validate heap integrity (for debugging)
  * 
- * Walks through all blocks and verifies magic numbers and linkage.
+ * Walks through all blocks and verifies magic numbers and linkage, then
+ * checks that the bins hold exactly the free blocks, each in the right bin.
  * Returns the number of blocks if valid, or -1 if corruption is detected.
  */
 int heap_validate(void)
@@ -612,12 +1568,16 @@ int heap_validate(void)
     }
 
     int block_count = 0;
+    int free_count = 0;
+    size_t cached_count = 0;
     heap_block_t *block = first_block;
     heap_block_t *prev = NULL;
 
     while (block) {
-        /* Check magic number */
-        if (!is_valid_block(block)) {
+        /* Check magic number (parked blocks are allocated blocks) */
+        if (block->magic == HEAP_MAGIC_CACHED && !block->is_free) {
+            cached_count++;
+        } else if (!is_valid_block(block)) {
             return -1;  /* Corruption */
         }
 
@@ -631,6 +1591,10 @@ int heap_validate(void)
             return -1;  /* Block extends past heap end */
         }
 
+        if (block->is_free) {
+            free_count++;
+        }
+
         block_count++;
         prev = block;
         block = block->next;
@@ -641,5 +1605,38 @@ int heap_validate(void)
         }
     }
 
+    /* Every binned block must be a valid free block filed by its size */
+    int binned_count = 0;
+    for (size_t bin = 0; bin < HEAP_BIN_COUNT; bin++) {
+        bool map_bit = (bin_map[bin / 32] >> (bin % 32)) & 1u;
+        if (map_bit != (bins[bin] != NULL)) {
+            return -1;  /* Bin bitmap out of sync */
+        }
+
+        heap_block_t *prev_free = NULL;
+        for (block = bins[bin]; block; block = block_links(block)->next_free) {
+            if (!is_valid_block(block) || !block->is_free ||
+                size_to_bin(block->size) != bin ||
+                block_links(block)->prev_free != prev_free) {
+                return -1;  /* Free list corruption */
+            }
+
+            prev_free = block;
+            if (++binned_count > free_count) {
+                return -1;  /* More binned blocks than free blocks */
+            }
+        }
+    }
+
+    if (binned_count != free_count) {
+        return -1;  /* Free block missing from its bin */
+    }
+
+    heap_magazine_stats_t mag;
+    heap_get_magazine_stats(&mag);
+    if (cached_count != mag.cached_blocks) {
+        return -1;  /* Magazine accounting out of sync */
+    }
+
     return block_count;
 }
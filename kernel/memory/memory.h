@@ -6,11 +6,11 @@
  * Memory Management Subsystem Interface
  *
  * This header defines the public API for the kernel's memory management
- * subsystem. It provides two main components:
+ * subsystem. It provides five main components:
  *
  * 1. Physical Frame Allocator
  *    - Manages physical memory at the page (frame) level
- *    - Uses a bitmap to track which frames are free/allocated
+ *    - Splits memory into DMA and NORMAL zones, each tracked by a bitmap
  *    - Provides the foundation for virtual memory
  *
  * 2. Kernel Heap Allocator  
@@ -18,11 +18,25 @@
  *    - Uses a free list for efficient block management
  *    - Supports allocation, freeing, reallocation, and zeroed allocation
  *
+ * 3. Slab Allocator
+ *    - Object caches (kmem_cache_*) for fixed-size kernel objects
+ *    - Carves page runs from the frame allocator into same-size objects
+ *
+ * 4. Arena Allocator
+ *    - Bump-pointer regions (arena_*) for bursts of short-lived allocations
+ *    - Everything in an arena is freed at once by arena_reset/arena_destroy
+ *
+ * 5. Paging
+ *    - Identity-maps physical memory so existing pointers keep working
+ *    - Per-task address spaces (address_space_*) for the mmap window
+ *
  * Usage Order:
  *   1. Call frame_init() early in boot with memory map info
  *   2. Reserve kernel regions with frame_reserve()
  *   3. Call heap_init() with a region for the heap
- *   4. Use kmalloc/kfree for dynamic allocations
+ *      (optionally frame_enable_buddy() once the early regions are taken)
+ *   4. Use kmalloc/kfree for dynamic allocations, kmem_cache_* for objects
+ *   5. Call paging_init() with the top of physical memory
  *
  * ===========================================================================
  */
@@ -38,8 +52,33 @@
  * Manages allocation of physical memory pages (frames). Each frame is
  * PAGE_SIZE bytes (typically 4KB). This allocator tracks which physical
  * frames are in use and provides allocation/deallocation services.
+ *
+ * Memory is divided into zones, each with its own bitmap and watermark.
+ * Requests name a preferred zone and fall back along a fixed order; the
+ * plain frame_alloc* calls prefer NORMAL.
  * =========================================================================== */
 
+/** @brief Physical memory zones, in address order */
+typedef enum frame_zone {
+    FRAME_ZONE_DMA = 0,     /* Below DMA_ZONE_LIMIT (ISA DMA reachable) */
+    FRAME_ZONE_NORMAL,      /* Everything above */
+    FRAME_ZONE_COUNT
+} frame_zone_t;
+
+/** @brief Per-zone statistics */
+typedef struct frame_zone_stats {
+    const char *name;
+    uintptr_t start;            /* First byte of the zone */
+    uintptr_t end;              /* One past the last byte */
+    size_t total_frames;
+    size_t used_frames;         /* Includes reserved frames */
+    size_t reserved_frames;     /* Holes/firmware areas (frame_exclude) */
+    size_t free_frames;
+    size_t watermark;           /* Free frames kept back from other zones */
+    size_t fallback_allocs;     /* Requests served on behalf of other zones */
+    bool has_buddy;             /* The buddy tree lives in this zone */
+} frame_zone_stats_t;
+
 /* ---------------------------------------------------------------------------
  * Initialization
  * --------------------------------------------------------------------------- */
@@ -66,6 +105,13 @@ void frame_init(void *bitmap_buffer, size_t mem_size, uintptr_t start_addr);
  */
 void frame_reserve(uintptr_t addr, size_t size);
 
+/**
+ * @brief Remove a range that is not usable RAM (memory map hole, firmware)
+ * 
+ * Same as frame_reserve(), but counted as reserved in the zone statistics.
+ */
+void frame_exclude(uintptr_t addr, size_t size);
+
 /* ---------------------------------------------------------------------------
  * Single Frame Allocation
  * --------------------------------------------------------------------------- */
@@ -77,6 +123,32 @@ void frame_reserve(uintptr_t addr, size_t size);
  */
 uintptr_t frame_alloc(void);
 
+/**
+ * @brief Allocate a single frame from a zone (or a zone it falls back to)
+ * 
+ * @param zone Preferred zone
+ * @return Physical address of allocated frame, or 0 if out of memory
+ */
+uintptr_t frame_alloc_zone(frame_zone_t zone);
+
+/**
+ * @brief Give cached frames back to the allocator
+ * 
+ * @param wanted Frames the allocator would like freed
+ * @return Frames actually freed
+ */
+typedef size_t (*frame_reclaim_t)(size_t wanted);
+
+/**
+ * @brief Register a reclaimer, run when a single-frame request fails
+ * 
+ * The reclaimer runs in the context of the failing frame_alloc() and must
+ * not sleep.
+ * 
+ * @return true if registered, false if the table is full
+ */
+bool frame_register_reclaim(frame_reclaim_t reclaim);
+
 /**
  * @brief Allocate a specific physical frame
  * 
@@ -92,6 +164,21 @@ uintptr_t frame_alloc_at(uintptr_t addr);
  */
 void frame_free(uintptr_t addr);
 
+/**
+ * @brief Record one more mapping of an allocated frame (copy-on-write)
+ */
+void frame_share(uintptr_t addr);
+
+/**
+ * @brief Drop one mapping of a frame; the last one frees it
+ */
+void frame_put(uintptr_t addr);
+
+/**
+ * @brief Number of mappings of a frame (1 when it is not shared)
+ */
+uint32_t frame_mappings(uintptr_t addr);
+
 /* ---------------------------------------------------------------------------
  * Contiguous Frame Allocation
  * --------------------------------------------------------------------------- */
@@ -106,6 +193,15 @@ void frame_free(uintptr_t addr);
  */
 uintptr_t frame_alloc_contiguous(size_t count);
 
+/**
+ * @brief Allocate contiguous frames from a zone (or a zone it falls back to)
+ * 
+ * @param count Number of contiguous frames needed
+ * @param zone  Preferred zone; FRAME_ZONE_DMA never falls back
+ * @return Physical address of first frame, or 0 if no run is available
+ */
+uintptr_t frame_alloc_contiguous_zone(size_t count, frame_zone_t zone);
+
 /**
  * @brief Free multiple contiguous frames
  * 
@@ -114,6 +210,42 @@ uintptr_t frame_alloc_contiguous(size_t count);
  */
 void frame_free_contiguous(uintptr_t addr, size_t count);
 
+/**
+ * @brief Allocate contiguous frames starting at an aligned physical address
+ * 
+ * @param count     Number of contiguous frames needed
+ * @param alignment Required alignment of the first frame in bytes
+ *                  (power of 2, at least PAGE_SIZE)
+ * @return Physical address of first frame, or 0 if no suitable run exists
+ * 
+ * Free the run with frame_free_contiguous(). Used by the slab allocator so
+ * a slab header can be found by masking an object address.
+ */
+uintptr_t frame_alloc_contiguous_aligned(size_t count, size_t alignment);
+
+/* ---------------------------------------------------------------------------
+ * Buddy-Backed Mode
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Hand the remaining free memory to the buddy allocator
+ * 
+ * @return true if the buddy tree now backs multi-page allocations
+ * 
+ * Call once after boot-time reservations (kernel image, heap). The largest
+ * free run starting on a BUDDY_MAX_BLOCK_SIZE boundary is given to the buddy
+ * tree; contiguous and aligned requests are then served from it in
+ * O(log n), falling back to the bitmap when the tree cannot satisfy them.
+ * frame_reserve() does not reach into the buddy region afterwards.
+ * Enabled at boot when built with FRAME_ALLOCATOR=buddy.
+ */
+bool frame_enable_buddy(void);
+
+/**
+ * @brief Check whether the buddy tree is backing the frame allocator
+ */
+bool frame_buddy_enabled(void);
+
 /* ---------------------------------------------------------------------------
  * Query Functions
  * --------------------------------------------------------------------------- */
@@ -156,6 +288,13 @@ size_t frame_free_memory(void);
 /** @brief Get the base address of managed memory */
 uintptr_t frame_get_base(void);
 
+/**
+ * @brief Get one zone's statistics
+ * 
+ * @return false if zone is not a valid zone
+ */
+bool frame_get_zone_stats(frame_zone_t zone, frame_zone_stats_t *stats);
+
 
 /* ===========================================================================
  * KERNEL HEAP ALLOCATOR (kmalloc/kfree)
@@ -212,7 +351,9 @@ void kfree(void *ptr);
  * @param size New size in bytes (0 = kfree(ptr))
  * @return Pointer to resized allocation, or NULL on failure
  * 
- * If the allocation is moved, the old pointer becomes invalid.
+ * Shrinks in place, and grows in place when the next block is free, so
+ * repeated growth of the most recent allocation does not copy. If the
+ * allocation is moved, the old pointer becomes invalid.
  * If realloc fails, the original allocation remains valid.
  */
 void *krealloc(void *ptr, size_t size);
@@ -279,6 +420,475 @@ size_t heap_free_count(void);
  */
 int heap_validate(void);
 
+/* ---------------------------------------------------------------------------
+ * Magazine Layer
+ * ---------------------------------------------------------------------------
+ * Small blocks freed by a task are kept in that task's magazines and handed
+ * straight back to its next kmalloc of the same size. A shared depot moves
+ * whole magazines between tasks and the global heap in batches.
+ * --------------------------------------------------------------------------- */
+
+/** @brief Opaque per-task (or per-CPU) magazine set */
+typedef struct heap_magazines heap_magazines_t;
+
+/** @brief Magazine layer counters */
+typedef struct heap_magazine_stats {
+    size_t hits;            /* kmalloc calls served from a magazine */
+    size_t misses;          /* Small kmalloc calls that fell through */
+    size_t depot_refills;   /* Batch allocations from the global heap */
+    size_t depot_flushes;   /* Full magazines emptied into the global heap */
+    size_t cached_blocks;   /* Blocks currently parked in magazines */
+    size_t magazines;       /* Magazines in existence */
+} heap_magazine_stats_t;
+
+/**
+ * @brief Allocate an empty magazine set
+ * 
+ * @return New set, or NULL if the heap is exhausted (callers then simply
+ *         run without magazines)
+ */
+heap_magazines_t *heap_magazines_create(void);
+
+/**
+ * @brief Return a set's cached blocks and free the set
+ */
+void heap_magazines_destroy(heap_magazines_t *mags);
+
+/**
+ * @brief Install the magazine set used by kmalloc/kfree (NULL = none)
+ * 
+ * Called by the scheduler when switching tasks.
+ */
+void heap_set_magazines(heap_magazines_t *mags);
+
+/**
+ * @brief Give every block held by the depot back to the global heap
+ */
+void heap_drain_magazines(void);
+
+/** @brief Get magazine layer statistics */
+void heap_get_magazine_stats(heap_magazine_stats_t *stats);
+
+/* ---------------------------------------------------------------------------
+ * Allocation Profiler
+ * ---------------------------------------------------------------------------
+ * When enabled, every kmalloc is attributed to its caller's return address
+ * in a fixed table (no allocation of its own). Each block remembers its
+ * site, so kfree keeps the per-site live byte counts exact. Sites beyond
+ * the table size are pooled in entry 0 (caller 0).
+ * --------------------------------------------------------------------------- */
+
+/** @brief Number of tracked allocation sites (entry 0 is the overflow site) */
+#define HEAP_PROF_SITES         32
+
+/** @brief Size histogram buckets: <=16, <=32, ... <=32K, larger */
+#define HEAP_PROF_BUCKETS       13
+
+/** @brief Per-site counters */
+typedef struct heap_prof_site {
+    uintptr_t caller;       /* Return address of the kmalloc call */
+    uint32_t allocs;        /* Allocations from this site */
+    uint32_t frees;         /* Of those, how many were freed */
+    size_t live_bytes;      /* Bytes currently held */
+    size_t peak_bytes;      /* Most bytes ever held at once */
+} heap_prof_site_t;
+
+/** @brief Profiler snapshot */
+typedef struct heap_profile {
+    bool enabled;
+    uint32_t sites_used;                        /* Entries in use */
+    uint32_t histogram[HEAP_PROF_BUCKETS];      /* Request sizes */
+    heap_prof_site_t sites[HEAP_PROF_SITES];
+} heap_profile_t;
+
+/**
+ * @brief Start or stop attributing allocations
+ *
+ * Stopping keeps the table; frees of profiled blocks are still counted.
+ */
+void heap_profile_enable(bool enable);
+
+/** @brief Check whether the profiler is recording */
+bool heap_profile_enabled(void);
+
+/**
+ * @brief Copy the profiler state, sites sorted by live bytes (largest first)
+ */
+void heap_get_profile(heap_profile_t *profile);
+
+
+/* ===========================================================================
+ * SLAB ALLOCATOR (kmem_cache)
+ * ===========================================================================
+ * Object caches for fixed-size kernel objects. Slabs are whole, naturally
+ * aligned page runs taken from the frame allocator, so objects carry no
+ * per-object header and are packed by type.
+ * =========================================================================== */
+
+/** @brief Opaque object cache handle */
+typedef struct kmem_cache kmem_cache_t;
+
+/** @brief Object constructor, run once per object when its slab is created */
+typedef void (*kmem_ctor_t)(void *obj);
+
+/** @brief Cache usage statistics */
+typedef struct kmem_cache_stats {
+    const char *name;           /* Cache name */
+    size_t object_size;         /* Bytes per object (after alignment) */
+    size_t objects_per_slab;    /* Objects carved from one slab */
+    size_t slab_size;           /* Bytes per slab */
+    size_t slab_count;          /* Slabs currently owned by the cache */
+    size_t active_objects;      /* Objects currently allocated */
+    size_t total_objects;       /* Object capacity of all slabs */
+    size_t total_allocs;        /* Lifetime allocations */
+    size_t total_frees;         /* Lifetime frees */
+    size_t failed_allocs;       /* Allocations that found no memory */
+} kmem_cache_stats_t;
+
+/**
+ * @brief Create an object cache
+ *
+ * @param name  Cache name (not copied; use a string literal)
+ * @param size  Object size in bytes
+ * @param align Object alignment (0 for pointer alignment)
+ * @param ctor  Optional constructor (NULL for none)
+ * @return Cache handle, or NULL on failure
+ *
+ * Objects handed back with kmem_cache_free() should be left in their
+ * constructed state; the allocator never writes into free objects.
+ */
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                kmem_ctor_t ctor);
+
+/**
+ * @brief Destroy a cache and release all of its slabs
+ */
+void kmem_cache_destroy(kmem_cache_t *cache);
+
+/**
+ * @brief Allocate an object from a cache (O(1))
+ *
+ * @return Pointer to the object, or NULL if out of memory
+ */
+void *kmem_cache_alloc(kmem_cache_t *cache);
+
+/**
+ * @brief Return an object to the cache it came from (O(1))
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+/**
+ * @brief Release any empty slabs held by a cache
+ */
+void kmem_cache_shrink(kmem_cache_t *cache);
+
+/**
+ * @brief Get cache statistics
+ *
+ * @return true on success, false if the cache is invalid
+ */
+bool kmem_cache_get_stats(kmem_cache_t *cache, kmem_cache_stats_t *stats);
+
+/** @brief Get the cache in a given slot (NULL if unused), for iteration */
+kmem_cache_t *kmem_cache_get_by_index(size_t index);
+
+/** @brief Get the number of cache slots */
+size_t kmem_cache_slot_count(void);
+
+
+/* ===========================================================================
+ * ARENA ALLOCATOR
+ * ===========================================================================
+ * Bump-pointer regions built from page runs of the frame allocator. There is
+ * no per-allocation free: callers allocate a burst of temporaries and then
+ * drop them all with arena_reset() or arena_destroy().
+ * =========================================================================== */
+
+/** @brief Opaque arena handle */
+typedef struct arena arena_t;
+
+/**
+ * @brief Create an arena
+ * 
+ * @param chunk_pages Pages per chunk (0 = one page)
+ * @return New arena, or NULL if no frames are available
+ */
+arena_t *arena_create(size_t chunk_pages);
+
+/**
+ * @brief Allocate memory from an arena (8-byte aligned, not zeroed)
+ * 
+ * @param arena Arena to allocate from
+ * @param size  Number of bytes
+ * @return Pointer valid until the next arena_reset/arena_destroy, or NULL
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Copy at most len characters of a string into an arena
+ * 
+ * @return NUL-terminated copy, or NULL if the arena could not grow
+ */
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+
+/**
+ * @brief Free every allocation in an arena, keeping its first chunk
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief Release an arena and all of its memory
+ */
+void arena_destroy(arena_t *arena);
+
+/** @brief Get bytes allocated from an arena since its last reset */
+size_t arena_used(const arena_t *arena);
+
+
+/* ===========================================================================
+ * PAGING
+ * ===========================================================================
+ * Two-level x86 page tables. The kernel directory identity-maps physical
+ * memory and the MMIO window, so turning paging on changes no addresses.
+ * A task that maps something gets its own directory: it shares every kernel
+ * page table and owns only the tables of [USER_MMAP_BASE, USER_MMAP_END).
+ * Ranges in that window are handed out as areas with an owner callback, run
+ * when the area is unmapped or the address space is destroyed.
+ * =========================================================================== */
+
+/* Page table entry flags */
+#define PAGE_PRESENT        0x001
+#define PAGE_WRITABLE       0x002
+#define PAGE_USER           0x004
+#define PAGE_WRITE_THROUGH  0x008
+#define PAGE_CACHE_DISABLE  0x010
+#define PAGE_ACCESSED       0x020
+#define PAGE_DIRTY          0x040
+#define PAGE_LARGE          0x080       /* Directory entry maps 4MB (PSE) */
+#define PAGE_COW            0x200       /* Available bit: copy on write fault */
+
+/* vm_area_map_anon: allocate every page now instead of on first touch */
+#define VM_MAP_POPULATE     0x1000
+
+/* mmap protection and sharing flags */
+#define PROT_READ           0x1
+#define PROT_WRITE          0x2
+#define MAP_SHARED          0x1
+#define MAP_PRIVATE         0x2
+#define MAP_ANONYMOUS       0x20        /* Zeroed memory, no file (fd = -1) */
+
+/** @brief Opaque per-task address space */
+typedef struct address_space address_space_t;
+
+/** @brief Called once when a mapped area goes away */
+typedef void (*vm_release_t)(void *owner);
+
+/**
+ * @brief Build the kernel page tables and enable paging
+ * 
+ * @param phys_top One past the highest physical address to identity-map
+ * @return true if paging is on
+ */
+bool paging_init(uintptr_t phys_top);
+
+/** @brief Check if paging has been enabled */
+bool paging_enabled(void);
+
+/**
+ * @brief Create an address space sharing the kernel mappings
+ * 
+ * @return New address space, or NULL if out of memory
+ */
+address_space_t *address_space_create(void);
+
+/**
+ * @brief Release every area and page table of an address space
+ * 
+ * Frames mapped into areas belong to their owners and are not freed.
+ */
+void address_space_destroy(address_space_t *as);
+
+/**
+ * @brief Get the running task's address space
+ * 
+ * @param create Give the task its own address space if it has none
+ * @return Address space, or NULL (kernel space, or out of memory)
+ */
+address_space_t *address_space_current(bool create);
+
+/**
+ * @brief Load an address space into CR3
+ * 
+ * @param as Address space (NULL = kernel directory)
+ */
+void paging_switch(address_space_t *as);
+
+/**
+ * @brief Map one page
+ * 
+ * @param as    Address space (NULL = kernel directory, existing tables only:
+ *              the identity map and the kernel stack window)
+ * @param virt  Page-aligned virtual address
+ * @param phys  Page-aligned physical address
+ * @param flags PAGE_* flags (PAGE_PRESENT is implied)
+ * @return true on success, false if a page table could not be allocated
+ */
+bool paging_map(address_space_t *as, uintptr_t virt, uintptr_t phys, uint32_t flags);
+
+/** @brief Remove the mapping of one page (no-op if not mapped) */
+void paging_unmap(address_space_t *as, uintptr_t virt);
+
+/**
+ * @brief Translate a virtual address
+ * 
+ * @return Physical address, or 0 if not mapped
+ */
+uintptr_t paging_translate(address_space_t *as, uintptr_t virt);
+
+/**
+ * @brief Reserve a free range of the mmap window
+ * 
+ * @param as      Address space to reserve in
+ * @param length  Bytes (rounded up to whole pages)
+ * @param release Run once when the area is released (may be NULL)
+ * @param owner   Argument for release
+ * @return Start address of the range, or 0 if the window is full
+ */
+uintptr_t vm_area_reserve(address_space_t *as, size_t length,
+                          vm_release_t release, void *owner);
+
+/**
+ * @brief Reserve a given range of the mmap window
+ * 
+ * @param start Page-aligned start address inside the window
+ * @return start on success, or 0 if the range is outside the window or
+ *         overlaps another area
+ */
+uintptr_t vm_area_reserve_at(address_space_t *as, uintptr_t start, size_t length,
+                             vm_release_t release, void *owner);
+
+/**
+ * @brief Unmap an area reserved by vm_area_reserve
+ * 
+ * @param as     Address space holding the area
+ * @param start  Start address returned by vm_area_reserve
+ * @param length Length passed to vm_area_reserve (0 = whole area)
+ * @return true on success, false if start/length do not name an area
+ */
+bool vm_area_release(address_space_t *as, uintptr_t start, size_t length);
+
+/**
+ * @brief Map zeroed memory that belongs to the area (copied on clone)
+ * 
+ * Pages are demand-zero: each one gets a frame when it is first written.
+ * 
+ * @param start Page-aligned address in the window, or 0 for any
+ * @param flags PAGE_WRITABLE or 0, plus VM_MAP_POPULATE to allocate every
+ *              page up front (needed before writing through paging_translate)
+ * @return Start address, or 0 if the range is taken or memory ran out
+ */
+uintptr_t vm_area_map_anon(address_space_t *as, uintptr_t start, size_t length, uint32_t flags);
+
+/**
+ * @brief Copy an address space for fork, sharing its pages copy-on-write
+ * 
+ * Only anonymous areas are copied; areas with an owner (shared memory,
+ * I/O rings, file mappings) stay with the original.
+ * 
+ * @param parent Address space to copy (NULL gives an empty one)
+ * @return The copy, or NULL on failure
+ */
+address_space_t *address_space_clone(address_space_t *parent);
+
+/**
+ * @brief Resolve a page fault in the running task's address space
+ * 
+ * @param addr  Faulting address (CR2)
+ * @param error Page fault error code
+ * @return true if the fault was a first touch of anonymous memory or a
+ *         copy-on-write write, and has been fixed
+ */
+bool paging_handle_fault(uintptr_t addr, uint32_t error);
+
+/**
+ * @brief Make a page of the running task usable without taking the fault
+ * 
+ * For kernel code that needs a page's frame (futex keys) rather than just
+ * access to it. Addresses outside the mmap window are always usable.
+ * 
+ * @param write Also break copy-on-write sharing (and the zero page)
+ * @return true if the page is now mapped (and writable, for write)
+ */
+bool paging_fault_in(uintptr_t addr, bool write);
+
+/**
+ * @brief Check that the running task may access a user buffer
+ * 
+ * The whole range must lie in the mmap window and every page must be a
+ * user page (writable, for write) once faulted in. System calls check
+ * their pointers with this before touching them: a kernel address or an
+ * unmapped page is refused instead of being written or faulting in ring 0.
+ * 
+ * @return true if [addr, addr + len) may be accessed
+ */
+bool user_access_ok(const void *addr, size_t len, bool write);
+
+/** @brief memcpy from user memory; false (nothing copied) if not accessible */
+bool copy_from_user(void *dest, const void *user_src, size_t len);
+
+/** @brief memcpy to user memory; false (nothing copied) if not accessible */
+bool copy_to_user(void *user_dest, const void *src, size_t len);
+
+/**
+ * @brief Copy a NUL-terminated string from user memory
+ * 
+ * @param size Size of dest, including the terminator
+ * @return Length of the string, or -1 if inaccessible or too long
+ */
+int copy_string_from_user(char *dest, const char *user_src, size_t size);
+
+/** @brief Pages currently mapped in the mmap window of an address space */
+size_t address_space_mapped_pages(const address_space_t *as);
+
+/** @brief How the kernel map and one address space are paged */
+typedef struct paging_stats {
+    uint32_t enabled;           /* Paging is on */
+    uint32_t pse;               /* Identity map uses 4MB pages */
+    uint32_t large_pages;       /* 4MB mappings (kernel identity map) */
+    uint32_t small_pages;       /* 4KB mappings: kernel tables plus the window */
+    uint32_t table_frames;      /* Page tables behind those 4KB mappings */
+} paging_stats_t;
+
+/**
+ * @brief Count large and small mappings
+ * 
+ * @param as    Address space whose mmap window is included (NULL = none)
+ * @param stats Filled in
+ */
+void paging_get_stats(address_space_t *as, paging_stats_t *stats);
+
+/** @brief Memory statistics copied out by SYS_MEMINFO */
+typedef struct mem_info {
+    uint32_t total_frames;
+    uint32_t free_frames;
+    uint32_t heap_total;        /* Kernel heap bytes */
+    uint32_t heap_used;
+    uint32_t heap_peak;
+    paging_stats_t paging;      /* Kernel map plus the caller's window */
+} mem_info_t;
+
+/**
+ * @brief Move the program break of an address space (sbrk)
+ * 
+ * The first call reserves a demand-zero area of USER_HEAP_SIZE for the
+ * heap, so growing it only moves the break. Shrinking frees every page
+ * wholly above the new break; they read as zero if the heap grows back.
+ * 
+ * @param increment Bytes to add (negative to give memory back)
+ * @return The previous break, or 0 if the heap would leave its area
+ */
+uintptr_t address_space_sbrk(address_space_t *as, int32_t increment);
+
 
 /* ===========================================================================
  * CONVENIENCE MACROS
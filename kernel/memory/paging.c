@@ -0,0 +1,968 @@
+/*
+ * ===========================================================================
+ * kernel/memory/paging.c
+ * ===========================================================================
+ *
+ * Paging and Per-Task Address Spaces
+ *
+ * The kernel has always run on flat physical addresses. Paging keeps that
+ * view: the kernel directory identity-maps physical memory (and the MMIO
+ * window used by the local and I/O APICs), so every existing pointer stays
+ * valid once CR0.PG is set. What paging adds is the mmap window
+ * [USER_MMAP_BASE, USER_MMAP_END), which each address space fills on its own.
+ *
+ * Address Space Layout (one page directory per task that maps anything):
+ * ┌─────────────────────────────────────────────────────────────────────────┐
+ * │ 0 .. RAM top        │ identity map, kernel page tables (shared)         │
+ * │ USER_MMAP_BASE..END │ per-task page tables, areas from vm_area_reserve  │
+ * │ KERNEL_STACK_WINDOW │ task stacks, 4KB pages, guard pages unmapped      │
+ * │ MMIO_WINDOW_BASE..  │ identity map, uncached (shared)                   │
+ * └─────────────────────────────────────────────────────────────────────────┘
+ *
+ * Every kernel page table is built by paging_init(), and a new directory
+ * copies the kernel directory entries, so kernel mappings never need to be
+ * propagated between address spaces. Tasks without their own address space
+ * run on the kernel directory.
+ *
+ * CR0.WP is set, so read-only mappings are enforced in ring 0 as well.
+ *
+ * Large Pages:
+ *   On CPUs with PSE the identity map (RAM and the MMIO window) is built
+ *   from 4MB directory entries instead of page tables, so the kernel heap,
+ *   RAMFS pages and every contiguous buffer are reached through a few TLB
+ *   entries and a one-level walk. The mmap window always uses 4KB pages:
+ *   demand-zero, copy-on-write and per-page unmapping all work on them.
+ *   Large entries are never split, so paging_map() refuses to touch one.
+ *   Task stacks need an unmapped guard page each, so they do not live in
+ *   the identity map at all: the kernel stack window gets (empty) 4KB page
+ *   tables here, and the task code maps each stack's frames into it.
+ *
+ * Copy-on-Write:
+ *   Anonymous areas (vm_area_map_anon) own their frames. address_space_clone()
+ *   gives the copy the same frames: writable pages lose PAGE_WRITABLE and
+ *   gain PAGE_COW in both spaces, and each extra mapping is counted with
+ *   frame_share(). The first write in either space faults into
+ *   paging_handle_fault(), which copies the page (or, for the last mapping
+ *   left, just makes it writable again). Cloning an address space therefore
+ *   costs its page tables, not its memory.
+ *
+ * Demand-Zero:
+ *   vm_area_map_anon() only reserves the range unless VM_MAP_POPULATE is
+ *   given. The first touch of a page faults: a write gets a fresh zeroed
+ *   frame, a read maps the shared zero page (read-only, and PAGE_COW when
+ *   the area is writable, so a later write takes the copy path above). The
+ *   zero page is never counted or freed, so sparse stacks and heaps only
+ *   cost the pages they actually write.
+ *
+ * Program Break:
+ *   The sbrk heap is one demand-zero area of USER_HEAP_SIZE, reserved on
+ *   the first address_space_sbrk() call. The break only moves within it:
+ *   growing costs nothing until the pages are touched, and shrinking hands
+ *   the frames above the new break back to the frame allocator.
+ *
+ * ===========================================================================
+ */
+
+#include "memory.h"
+#include "../scheduler/task.h"
+#include <lib/dsa/list.h>
+#include "../../config/os_config.h"
+
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+#define PAGE_ENTRIES        1024                /* Entries per directory/table */
+#define PAGE_TABLE_SPAN     (PAGE_ENTRIES * PAGE_SIZE)  /* 4MB per table */
+#define PDE_INDEX(addr)     ((uint32_t)(addr) >> 22)
+#define PTE_INDEX(addr)     (((uint32_t)(addr) >> 12) & (PAGE_ENTRIES - 1))
+#define PAGE_FRAME(entry)   ((entry) & ~(uint32_t)(PAGE_SIZE - 1))
+
+#define CR0_WP              (1u << 16)
+#define CR0_PG              (1u << 31)
+#define CR4_PSE             (1u << 4)
+#define CPUID_FEAT_EDX_PSE  (1u << 3)
+#define LARGE_PAGE_FRAME(entry) ((entry) & ~(uint32_t)(PAGE_TABLE_SPAN - 1))
+
+/* Page fault error code bits */
+#define PF_PRESENT          0x1         /* Protection fault, page was present */
+#define PF_WRITE            0x2
+
+/* vm_area_t.flags */
+#define VM_AREA_ANON        0x1         /* Frames belong to the area itself */
+
+/* Shared page behind untouched anonymous memory */
+#define ZERO_FRAME          ((uintptr_t)zero_page)
+
+/* Directory entries owned by each address space */
+#define WINDOW_FIRST_PDE    PDE_INDEX(USER_MMAP_BASE)
+#define WINDOW_LAST_PDE     (PDE_INDEX(USER_MMAP_END) - 1)
+
+/* ---------------------------------------------------------------------------
+ * Structures
+ * --------------------------------------------------------------------------- */
+
+/* A reserved range of the mmap window */
+typedef struct vm_area {
+    list_node_t node;               /* In address_space.areas, by start */
+    uintptr_t start;
+    size_t length;                  /* Whole pages */
+    uint32_t flags;                 /* VM_AREA_* */
+    uint32_t prot;                  /* PTE flags of anonymous pages */
+    vm_release_t release;
+    void *owner;
+} vm_area_t;
+
+struct address_space {
+    uint32_t *directory;            /* One frame */
+    list_t areas;                   /* vm_area_t, sorted by start */
+    size_t mapped_pages;            /* Present PTEs in the window */
+    uintptr_t heap_start;           /* sbrk area, 0 until the first sbrk */
+    uintptr_t brk;                  /* Current program break */
+};
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+/* Kernel page directory (identity map) */
+static uint32_t kernel_directory[PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+
+/* Read-only source of demand-zero pages (identity-mapped, never written) */
+static uint8_t zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+/* Set once CR0.PG is on */
+static bool paging_on = false;
+
+/* Identity map built from 4MB pages */
+static bool large_pages = false;
+
+/* ---------------------------------------------------------------------------
+ * CPU Helpers
+ * --------------------------------------------------------------------------- */
+
+static inline uint32_t read_cr3(void)
+{
+    uint32_t value;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr3(uint32_t value)
+{
+    __asm__ volatile ("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+/* Check CPUID for 4MB page support */
+static bool cpu_has_pse(void)
+{
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+    __asm__ volatile ("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    return (edx & CPUID_FEAT_EDX_PSE) != 0;
+}
+
+static inline void invlpg(uintptr_t addr)
+{
+    __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Directory of an address space (NULL = kernel)
+ * --------------------------------------------------------------------------- */
+static uint32_t *space_directory(address_space_t *as)
+{
+    return as != NULL ? as->directory : kernel_directory;
+}
+
+static bool in_window(uintptr_t virt)
+{
+    return virt >= USER_MMAP_BASE && virt < USER_MMAP_END;
+}
+
+/* Page table entry for an address, or NULL if it has no page table */
+static uint32_t *pte_lookup(address_space_t *as, uintptr_t virt)
+{
+    uint32_t pde = space_directory(as)[PDE_INDEX(virt)];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) {
+        return NULL;
+    }
+    return &((uint32_t *)PAGE_FRAME(pde))[PTE_INDEX(virt)];
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Take a zeroed frame for a page table or directory
+ * --------------------------------------------------------------------------- */
+static uint32_t *alloc_table(void)
+{
+    uintptr_t frame = frame_alloc();
+    if (frame == 0) {
+        return NULL;
+    }
+    memset((void *)frame, 0, PAGE_SIZE);
+    return (uint32_t *)frame;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Identity-map one 4MB table's worth of addresses
+ * ---------------------------------------------------------------------------
+ * One large directory entry with PSE, otherwise a page table.
+ * --------------------------------------------------------------------------- */
+static bool identity_map_table(uintptr_t base, uint32_t flags)
+{
+    if (large_pages) {
+        kernel_directory[PDE_INDEX(base)] = (uint32_t)base | flags | PAGE_LARGE | PAGE_PRESENT;
+        return true;
+    }
+
+    uint32_t *table = alloc_table();
+    if (table == NULL) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < PAGE_ENTRIES; i++) {
+        table[i] = (uint32_t)(base + i * PAGE_SIZE) | flags | PAGE_PRESENT;
+    }
+    kernel_directory[PDE_INDEX(base)] = (uint32_t)(uintptr_t)table | PAGE_PRESENT | PAGE_WRITABLE;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * paging_init - Build the identity map and turn paging on
+ * --------------------------------------------------------------------------- */
+bool paging_init(uintptr_t phys_top)
+{
+    if (!PAGING_ENABLED || paging_on) {
+        return paging_on;
+    }
+
+    /* The identity map must stay below the mmap window */
+    uintptr_t top = ALIGN_UP(phys_top, PAGE_TABLE_SPAN);
+    if (top == 0 || top > USER_MMAP_BASE) {
+        top = USER_MMAP_BASE;
+    }
+
+    memset(kernel_directory, 0, sizeof(kernel_directory));
+
+    large_pages = cpu_has_pse();
+    if (large_pages) {
+        uint32_t cr4;
+        __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+        __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4 | CR4_PSE));
+    }
+
+    for (uintptr_t base = 0; base < top; base += PAGE_TABLE_SPAN) {
+        if (!identity_map_table(base, PAGE_WRITABLE)) {
+            goto fail;
+        }
+    }
+
+    if (!identity_map_table(MMIO_WINDOW_BASE,
+                            PAGE_WRITABLE | PAGE_CACHE_DISABLE | PAGE_WRITE_THROUGH)) {
+        goto fail;
+    }
+
+    /* Built now, so every address space copies (and shares) these tables */
+    for (uintptr_t base = KERNEL_STACK_WINDOW;
+         base < KERNEL_STACK_WINDOW + KERNEL_STACK_WINDOW_SIZE; base += PAGE_TABLE_SPAN) {
+        uint32_t *table = alloc_table();
+        if (table == NULL) {
+            goto fail;
+        }
+        kernel_directory[PDE_INDEX(base)] = (uint32_t)(uintptr_t)table | PAGE_PRESENT | PAGE_WRITABLE;
+    }
+
+    write_cr3((uint32_t)(uintptr_t)kernel_directory);
+
+    uint32_t cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    cr0 |= CR0_PG | CR0_WP;
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0) : "memory");
+
+    paging_on = true;
+    return true;
+
+fail:
+    /* Paging is still off: give the tables back and keep running flat */
+    for (uint32_t i = 0; i < PAGE_ENTRIES; i++) {
+        if ((kernel_directory[i] & PAGE_PRESENT) && !(kernel_directory[i] & PAGE_LARGE)) {
+            frame_free(PAGE_FRAME(kernel_directory[i]));
+        }
+        kernel_directory[i] = 0;
+    }
+    return false;
+}
+
+bool paging_enabled(void)
+{
+    return paging_on;
+}
+
+/* ---------------------------------------------------------------------------
+ * Address Spaces
+ * --------------------------------------------------------------------------- */
+
+address_space_t *address_space_create(void)
+{
+    if (!paging_on) {
+        return NULL;
+    }
+
+    address_space_t *as = KMALLOC(address_space_t);
+    if (as == NULL) {
+        return NULL;
+    }
+
+    as->directory = alloc_table();
+    if (as->directory == NULL) {
+        kfree(as);
+        return NULL;
+    }
+
+    /* Share every kernel table; the window starts out empty */
+    memcpy(as->directory, kernel_directory, sizeof(kernel_directory));
+    for (uint32_t i = WINDOW_FIRST_PDE; i <= WINDOW_LAST_PDE; i++) {
+        as->directory[i] = 0;
+    }
+
+    list_init(&as->areas);
+    as->mapped_pages = 0;
+    as->heap_start = 0;
+    as->brk = 0;
+    return as;
+}
+
+void address_space_destroy(address_space_t *as)
+{
+    if (as == NULL) {
+        return;
+    }
+
+    /* Never free the directory the CPU is using */
+    if (read_cr3() == (uint32_t)(uintptr_t)as->directory) {
+        paging_switch(NULL);
+    }
+
+    while (!list_is_empty(&as->areas)) {
+        vm_area_t *area = list_entry(as->areas.head, vm_area_t, node);
+        vm_area_release(as, area->start, 0);
+    }
+
+    for (uint32_t i = WINDOW_FIRST_PDE; i <= WINDOW_LAST_PDE; i++) {
+        if (as->directory[i] & PAGE_PRESENT) {
+            frame_free(PAGE_FRAME(as->directory[i]));
+        }
+    }
+
+    frame_free((uintptr_t)as->directory);
+    kfree(as);
+}
+
+address_space_t *address_space_current(bool create)
+{
+    task_t *task = task_current();
+    if (task == NULL) {
+        return NULL;
+    }
+
+    if (task->address_space == NULL && create) {
+        task->address_space = address_space_create();
+        if (task->address_space != NULL) {
+            paging_switch(task->address_space);
+        }
+    }
+    return task->address_space;
+}
+
+void paging_switch(address_space_t *as)
+{
+    if (!paging_on) {
+        return;
+    }
+
+    uint32_t dir = (uint32_t)(uintptr_t)space_directory(as);
+    if (read_cr3() != dir) {
+        write_cr3(dir);
+    }
+}
+
+size_t address_space_mapped_pages(const address_space_t *as)
+{
+    return as != NULL ? as->mapped_pages : 0;
+}
+
+void paging_get_stats(address_space_t *as, paging_stats_t *stats)
+{
+    stats->enabled = paging_on;
+    stats->pse = large_pages;
+    stats->large_pages = 0;
+    stats->small_pages = 0;
+    stats->table_frames = 0;
+    if (!paging_on) {
+        return;
+    }
+
+    /* The kernel half: every directory entry outside the mmap window */
+    for (uint32_t i = 0; i < PAGE_ENTRIES; i++) {
+        uint32_t pde = kernel_directory[i];
+        if (!(pde & PAGE_PRESENT) || (i >= WINDOW_FIRST_PDE && i <= WINDOW_LAST_PDE)) {
+            continue;
+        }
+        if (pde & PAGE_LARGE) {
+            stats->large_pages++;
+            continue;
+        }
+        const uint32_t *table = (const uint32_t *)PAGE_FRAME(pde);
+        for (uint32_t j = 0; j < PAGE_ENTRIES; j++) {
+            if (table[j] & PAGE_PRESENT) {
+                stats->small_pages++;
+            }
+        }
+        stats->table_frames++;
+    }
+
+    if (as != NULL) {
+        stats->small_pages += as->mapped_pages;
+        for (uint32_t i = WINDOW_FIRST_PDE; i <= WINDOW_LAST_PDE; i++) {
+            if (as->directory[i] & PAGE_PRESENT) {
+                stats->table_frames++;
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Page Mapping
+ * --------------------------------------------------------------------------- */
+
+bool paging_map(address_space_t *as, uintptr_t virt, uintptr_t phys, uint32_t flags)
+{
+    if (!paging_on) {
+        return false;
+    }
+
+    uint32_t *dir = space_directory(as);
+    uint32_t pde = dir[PDE_INDEX(virt)];
+
+    if (!(pde & PAGE_PRESENT)) {
+        /* Only address spaces grow tables, and only inside their window */
+        if (as == NULL || !in_window(virt)) {
+            return false;
+        }
+        uint32_t *table = alloc_table();
+        if (table == NULL) {
+            return false;
+        }
+        pde = (uint32_t)(uintptr_t)table | PAGE_PRESENT | PAGE_WRITABLE | PAGE_USER;
+        dir[PDE_INDEX(virt)] = pde;
+    } else if (pde & PAGE_LARGE) {
+        return false;  /* Inside a 4MB identity page */
+    }
+
+    uint32_t *table = (uint32_t *)PAGE_FRAME(pde);
+    uint32_t *pte = &table[PTE_INDEX(virt)];
+    if (as != NULL && in_window(virt) && !(*pte & PAGE_PRESENT)) {
+        as->mapped_pages++;
+    }
+    *pte = PAGE_FRAME((uint32_t)phys) | (flags & (PAGE_SIZE - 1)) | PAGE_PRESENT;
+
+    if (read_cr3() == (uint32_t)(uintptr_t)dir) {
+        invlpg(virt);
+    }
+    return true;
+}
+
+void paging_unmap(address_space_t *as, uintptr_t virt)
+{
+    if (!paging_on) {
+        return;
+    }
+
+    uint32_t *dir = space_directory(as);
+    uint32_t pde = dir[PDE_INDEX(virt)];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) {
+        return;
+    }
+
+    uint32_t *pte = &((uint32_t *)PAGE_FRAME(pde))[PTE_INDEX(virt)];
+    if (!(*pte & PAGE_PRESENT)) {
+        return;
+    }
+
+    *pte = 0;
+    if (as != NULL && in_window(virt)) {
+        as->mapped_pages--;
+    }
+    if (read_cr3() == (uint32_t)(uintptr_t)dir) {
+        invlpg(virt);
+    }
+}
+
+uintptr_t paging_translate(address_space_t *as, uintptr_t virt)
+{
+    if (!paging_on) {
+        return virt;
+    }
+
+    uint32_t pde = space_directory(as)[PDE_INDEX(virt)];
+    if (!(pde & PAGE_PRESENT)) {
+        return 0;
+    }
+    if (pde & PAGE_LARGE) {
+        return LARGE_PAGE_FRAME(pde) | (virt & (PAGE_TABLE_SPAN - 1));
+    }
+
+    uint32_t pte = ((uint32_t *)PAGE_FRAME(pde))[PTE_INDEX(virt)];
+    if (!(pte & PAGE_PRESENT)) {
+        return 0;
+    }
+    return PAGE_FRAME(pte) | (virt & (PAGE_SIZE - 1));
+}
+
+/* ---------------------------------------------------------------------------
+ * Areas of the mmap window
+ * --------------------------------------------------------------------------- */
+
+/* Record an area before 'next' (NULL = at the end of the list) */
+static uintptr_t area_insert(address_space_t *as, list_node_t *next, uintptr_t start,
+                             size_t length, vm_release_t release, void *owner)
+{
+    vm_area_t *area = KMALLOC(vm_area_t);
+    if (area == NULL) {
+        return 0;
+    }
+
+    list_node_init(&area->node);
+    area->start = start;
+    area->length = length;
+    area->flags = 0;
+    area->prot = 0;
+    area->release = release;
+    area->owner = owner;
+
+    if (next != NULL) {
+        list_insert_before(&as->areas, next, &area->node);
+    } else {
+        list_push_back(&as->areas, &area->node);
+    }
+    return start;
+}
+
+uintptr_t vm_area_reserve(address_space_t *as, size_t length,
+                          vm_release_t release, void *owner)
+{
+    if (as == NULL || length == 0 || length > USER_MMAP_END - USER_MMAP_BASE) {
+        return 0;
+    }
+    length = ALIGN_UP(length, PAGE_SIZE);
+
+    /* First fit between the existing areas */
+    uintptr_t start = USER_MMAP_BASE;
+    list_node_t *next = as->areas.head;
+    while (next != NULL) {
+        vm_area_t *other = list_entry(next, vm_area_t, node);
+        if (other->start - start >= length) {
+            break;
+        }
+        start = other->start + other->length;
+        next = next->next;
+    }
+
+    if (USER_MMAP_END - start < length) {
+        return 0;  /* Window full */
+    }
+    return area_insert(as, next, start, length, release, owner);
+}
+
+uintptr_t vm_area_reserve_at(address_space_t *as, uintptr_t start, size_t length,
+                             vm_release_t release, void *owner)
+{
+    if (as == NULL || length == 0 || (start & (PAGE_SIZE - 1)) != 0 ||
+        !in_window(start) || USER_MMAP_END - start < length) {
+        return 0;
+    }
+    length = ALIGN_UP(length, PAGE_SIZE);
+
+    /* The range must fall in a gap between the existing areas */
+    list_node_t *next = as->areas.head;
+    while (next != NULL) {
+        vm_area_t *other = list_entry(next, vm_area_t, node);
+        if (other->start >= start + length) {
+            break;
+        }
+        if (other->start + other->length > start) {
+            return 0;  /* Overlaps */
+        }
+        next = next->next;
+    }
+    return area_insert(as, next, start, length, release, owner);
+}
+
+/* Drop an anonymous page's frame (if it has its own) and unmap it */
+static void anon_page_free(address_space_t *as, uintptr_t virt)
+{
+    uint32_t *pte = pte_lookup(as, virt);
+    if (pte != NULL && (*pte & PAGE_PRESENT) && PAGE_FRAME(*pte) != ZERO_FRAME) {
+        frame_put(PAGE_FRAME(*pte));
+    }
+    paging_unmap(as, virt);
+}
+
+bool vm_area_release(address_space_t *as, uintptr_t start, size_t length)
+{
+    if (as == NULL) {
+        return false;
+    }
+
+    for (list_node_t *node = as->areas.head; node != NULL; node = node->next) {
+        vm_area_t *area = list_entry(node, vm_area_t, node);
+        if (area->start != start) {
+            continue;
+        }
+        if (length != 0 && ALIGN_UP(length, PAGE_SIZE) != area->length) {
+            return false;  /* Partial unmaps are not supported */
+        }
+
+        for (uintptr_t virt = area->start; virt < area->start + area->length; virt += PAGE_SIZE) {
+            if (area->flags & VM_AREA_ANON) {
+                anon_page_free(as, virt);
+            } else {
+                paging_unmap(as, virt);
+            }
+        }
+
+        if (area->start == as->heap_start) {
+            as->heap_start = 0;  /* munmap of the heap: the next sbrk starts over */
+            as->brk = 0;
+        }
+        list_remove(&as->areas, &area->node);
+        if (area->release != NULL) {
+            area->release(area->owner);
+        }
+        kfree(area);
+        return true;
+    }
+
+    return false;
+}
+
+/* Area starting at an address, or NULL */
+static vm_area_t *area_find(address_space_t *as, uintptr_t start)
+{
+    for (list_node_t *node = as->areas.head; node != NULL; node = node->next) {
+        vm_area_t *area = list_entry(node, vm_area_t, node);
+        if (area->start == start) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
+/* Area covering an address, or NULL */
+static vm_area_t *area_containing(address_space_t *as, uintptr_t addr)
+{
+    for (list_node_t *node = as->areas.head; node != NULL; node = node->next) {
+        vm_area_t *area = list_entry(node, vm_area_t, node);
+        if (addr < area->start) {
+            break;
+        }
+        if (addr - area->start < area->length) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Anonymous Memory and Copy-on-Write
+ * --------------------------------------------------------------------------- */
+
+uintptr_t vm_area_map_anon(address_space_t *as, uintptr_t start, size_t length, uint32_t flags)
+{
+    start = (start != 0) ? vm_area_reserve_at(as, start, length, NULL, NULL)
+                         : vm_area_reserve(as, length, NULL, NULL);
+    if (start == 0) {
+        return 0;
+    }
+
+    vm_area_t *area = area_find(as, start);
+    area->flags = VM_AREA_ANON;
+    area->prot = PAGE_USER | (flags & PAGE_WRITABLE);
+
+    if (!(flags & VM_MAP_POPULATE)) {
+        return start;  /* Pages arrive on first touch */
+    }
+
+    for (uintptr_t virt = start; virt < start + area->length; virt += PAGE_SIZE) {
+        uintptr_t frame = frame_alloc();
+        if (frame == 0) {
+            vm_area_release(as, start, 0);  /* Frees the pages mapped so far */
+            return 0;
+        }
+        memset((void *)frame, 0, PAGE_SIZE);
+        if (!paging_map(as, virt, frame, area->prot)) {
+            frame_free(frame);
+            vm_area_release(as, start, 0);
+            return 0;
+        }
+    }
+    return start;
+}
+
+uintptr_t address_space_sbrk(address_space_t *as, int32_t increment)
+{
+    if (as == NULL) {
+        return 0;
+    }
+
+    if (as->heap_start == 0) {
+        uintptr_t start = vm_area_map_anon(as, 0, USER_HEAP_SIZE, PAGE_WRITABLE);
+        if (start == 0) {
+            return 0;
+        }
+        as->heap_start = start;
+        as->brk = start;
+    }
+
+    uintptr_t old = as->brk;
+    if (increment >= 0) {
+        if ((uint32_t)increment > as->heap_start + USER_HEAP_SIZE - old) {
+            return 0;
+        }
+        as->brk = old + (uint32_t)increment;
+        return old;
+    }
+
+    uint32_t decrement = 0u - (uint32_t)increment;
+    if (decrement > old - as->heap_start) {
+        return 0;
+    }
+    as->brk = old - decrement;
+
+    for (uintptr_t virt = ALIGN_UP(as->brk, PAGE_SIZE); virt < ALIGN_UP(old, PAGE_SIZE);
+         virt += PAGE_SIZE) {
+        anon_page_free(as, virt);
+    }
+    return old;
+}
+
+address_space_t *address_space_clone(address_space_t *parent)
+{
+    address_space_t *child = address_space_create();
+    if (child == NULL || parent == NULL) {
+        return child;
+    }
+
+    bool ok = true;
+    for (list_node_t *node = parent->areas.head; node != NULL && ok; node = node->next) {
+        vm_area_t *area = list_entry(node, vm_area_t, node);
+        if (!(area->flags & VM_AREA_ANON)) {
+            continue;  /* Owned mappings (shm, rings, files) track one space each */
+        }
+
+        if (area_insert(child, NULL, area->start, area->length, NULL, NULL) == 0) {
+            ok = false;
+            break;
+        }
+        vm_area_t *copy = area_find(child, area->start);
+        copy->flags = VM_AREA_ANON;
+        copy->prot = area->prot;
+
+        for (uintptr_t virt = area->start; virt < area->start + area->length; virt += PAGE_SIZE) {
+            uint32_t *pte = pte_lookup(parent, virt);
+            if (pte == NULL || !(*pte & PAGE_PRESENT)) {
+                continue;
+            }
+            if (*pte & PAGE_WRITABLE) {
+                *pte = (*pte & ~(uint32_t)PAGE_WRITABLE) | PAGE_COW;
+            }
+            if (!paging_map(child, virt, PAGE_FRAME(*pte), *pte & (PAGE_USER | PAGE_COW))) {
+                ok = false;
+                break;
+            }
+            if (PAGE_FRAME(*pte) != ZERO_FRAME) {
+                frame_share(PAGE_FRAME(*pte));
+            }
+        }
+    }
+
+    child->heap_start = parent->heap_start;
+    child->brk = parent->brk;
+
+    /* The parent's pages just became read-only */
+    if (read_cr3() == (uint32_t)(uintptr_t)parent->directory) {
+        write_cr3(read_cr3());
+    }
+
+    if (!ok) {
+        /* Pages left marked COW in the parent just turn writable on a write */
+        address_space_destroy(child);
+        return NULL;
+    }
+    return child;
+}
+
+/* First touch of an anonymous page: map a zeroed frame or the zero page */
+static bool demand_zero_fault(address_space_t *as, uintptr_t page, bool write)
+{
+    vm_area_t *area = area_containing(as, page);
+    if (area == NULL || !(area->flags & VM_AREA_ANON) ||
+        (write && !(area->prot & PAGE_WRITABLE))) {
+        return false;
+    }
+
+    if (!write) {
+        uint32_t flags = (area->prot & PAGE_WRITABLE) ? PAGE_USER | PAGE_COW : PAGE_USER;
+        return paging_map(as, page, ZERO_FRAME, flags);
+    }
+
+    uintptr_t frame = frame_alloc();
+    if (frame == 0) {
+        return false;  /* Out of memory even after reclaim: the fault stays fatal */
+    }
+    memset((void *)frame, 0, PAGE_SIZE);
+    if (!paging_map(as, page, frame, area->prot)) {
+        frame_free(frame);
+        return false;
+    }
+    return true;
+}
+
+bool paging_handle_fault(uintptr_t addr, uint32_t error)
+{
+    if (!paging_on || !in_window(addr)) {
+        return false;
+    }
+
+    address_space_t *as = address_space_current(false);
+    if (as == NULL) {
+        return false;
+    }
+
+    uint32_t *pte = pte_lookup(as, addr);
+    if (pte == NULL || !(*pte & PAGE_PRESENT)) {
+        return demand_zero_fault(as, addr & ~(uintptr_t)(PAGE_SIZE - 1),
+                                 (error & PF_WRITE) != 0);
+    }
+    if (!(error & PF_WRITE) || !(*pte & PAGE_COW)) {
+        return false;
+    }
+
+    uintptr_t frame = PAGE_FRAME(*pte);
+    uint32_t flags = (*pte & (PAGE_SIZE - 1) & ~(uint32_t)PAGE_COW) | PAGE_WRITABLE;
+
+    /* Still shared (or the zero page): give this space its own copy */
+    if (frame == ZERO_FRAME || frame_mappings(frame) > 1) {
+        uintptr_t copy = frame_alloc();
+        if (copy == 0) {
+            return false;  /* Out of memory: the fault stays fatal */
+        }
+        if (frame == ZERO_FRAME) {
+            memset((void *)copy, 0, PAGE_SIZE);
+        } else {
+            memcpy((void *)copy, (void *)frame, PAGE_SIZE);
+            frame_put(frame);
+        }
+        frame = copy;
+    }
+
+    *pte = (uint32_t)frame | flags;
+    invlpg(addr & ~(uintptr_t)(PAGE_SIZE - 1));
+    return true;
+}
+
+bool paging_fault_in(uintptr_t addr, bool write)
+{
+    address_space_t *as = address_space_current(false);
+    if (!paging_on || as == NULL || !in_window(addr)) {
+        return true;  /* Identity-mapped: nothing to fault in */
+    }
+
+    uint32_t *pte = pte_lookup(as, addr);
+    if (pte != NULL && (*pte & PAGE_PRESENT) && (!write || !(*pte & PAGE_COW))) {
+        return true;
+    }
+    return paging_handle_fault(addr, write ? PF_WRITE : 0);
+}
+
+/* ---------------------------------------------------------------------------
+ * User Memory Access
+ * --------------------------------------------------------------------------- */
+
+bool user_access_ok(const void *addr, size_t len, bool write)
+{
+    uintptr_t start = (uintptr_t)addr;
+    if (len == 0) {
+        return true;
+    }
+    if (start < USER_MMAP_BASE || start >= USER_MMAP_END ||
+        len > USER_MMAP_END - start) {
+        return false;  /* Not (entirely) in the user window */
+    }
+
+    address_space_t *as = address_space_current(false);
+    if (!paging_on || as == NULL) {
+        return false;
+    }
+
+    uint32_t need = PAGE_PRESENT | PAGE_USER | (write ? PAGE_WRITABLE : 0);
+    uintptr_t page = start & ~(uintptr_t)(PAGE_SIZE - 1);
+    uintptr_t last = (start + len - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    for (;;) {
+        if (!paging_fault_in(page, write)) {
+            return false;  /* Unmapped, or the area forbids this access */
+        }
+        uint32_t *pte = pte_lookup(as, page);
+        if (pte == NULL || (*pte & need) != need) {
+            return false;
+        }
+        if (page == last) {
+            return true;
+        }
+        page += PAGE_SIZE;
+    }
+}
+
+bool copy_from_user(void *dest, const void *user_src, size_t len)
+{
+    if (!user_access_ok(user_src, len, false)) {
+        return false;
+    }
+    memcpy(dest, user_src, len);
+    return true;
+}
+
+bool copy_to_user(void *user_dest, const void *src, size_t len)
+{
+    if (!user_access_ok(user_dest, len, true)) {
+        return false;
+    }
+    memcpy(user_dest, src, len);
+    return true;
+}
+
+int copy_string_from_user(char *dest, const char *user_src, size_t size)
+{
+    uintptr_t addr = (uintptr_t)user_src;
+    size_t len = 0;
+
+    while (len < size) {
+        /* Check one page at a time: the string may end before the next */
+        size_t chunk = PAGE_SIZE - ((addr + len) & (PAGE_SIZE - 1));
+        if (chunk > size - len) {
+            chunk = size - len;
+        }
+        if (!user_access_ok((const void *)(addr + len), chunk, false)) {
+            return -1;
+        }
+        for (size_t i = 0; i < chunk; i++, len++) {
+            dest[len] = user_src[len];
+            if (dest[len] == '\0') {
+                return (int)len;
+            }
+        }
+    }
+    return -1;  /* No terminator within size bytes */
+}
@@ -0,0 +1,476 @@
+/*
+ * ===========================================================================
+ * kernel/memory/slab.c
+ * ===========================================================================
+ *
+ * Slab Allocator (Object Caches)
+ *
+ * This module provides kmem_cache_* object caches for fixed-size kernel
+ * objects (inodes, trie nodes, hash map entries, task stacks). Each cache
+ * takes whole, naturally aligned runs of pages from the frame allocator and
+ * carves them into equally sized objects.
+ *
+ * Compared to kmalloc this gives:
+ *   - No per-object heap_block_t header
+ *   - No external fragmentation between objects of one type
+ *   - Objects of one type packed together (better cache locality)
+ *   - Optional constructors: objects are constructed once when their slab
+ *     is created and are expected to be handed back in constructed state
+ *
+ * Slab Layout (slab size = PAGE_SIZE << order, aligned to its own size):
+ * ┌─────────────────────────────────────────────────────────────────────────┐
+ * │ kmem_slab_t header │ free index stack │ pad │ obj 0 │ obj 1 │ ... │ obj N │
+ * └─────────────────────────────────────────────────────────────────────────┘
+ *
+ * Because every slab is aligned to its size, the slab owning an object is
+ * found by masking the object address - kmem_cache_free() is O(1).
+ *
+ * The free list is a stack of object indices kept in the slab header rather
+ * than a pointer threaded through the objects, so a free object's contents
+ * (including whatever its constructor set up) are never touched.
+ *
+ * Every slab is on exactly one of its cache's lists:
+ *   - partial: some objects in use (allocation is served from here first)
+ *   - full:    all objects in use
+ *   - empty:   no objects in use (at most one is kept, the rest are released)
+ *
+ * Thread Safety:
+ *   Like kmalloc, this is NOT thread-safe. Callers must serialize access.
+ *
+ * ===========================================================================
+ */
+
+#include "memory.h"
+#include <lib/dsa/list.h>
+#include "../../config/os_config.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+/* Maximum number of caches that can exist at once */
+#define KMEM_MAX_CACHES         32
+
+/* Largest slab is PAGE_SIZE << KMEM_MAX_SLAB_ORDER bytes (128KB) */
+#define KMEM_MAX_SLAB_ORDER     5
+
+/* Pick the smallest order wasting at most 1/KMEM_WASTE_FRACTION of a slab */
+#define KMEM_WASTE_FRACTION     8
+
+/* Minimum object alignment */
+#define KMEM_MIN_ALIGN          sizeof(void *)
+
+/* Magic number stamped into every slab header */
+#define KMEM_SLAB_MAGIC         0x51AB51AB
+
+/* ---------------------------------------------------------------------------
+ * Slab Header
+ * ---------------------------------------------------------------------------
+ * Lives at the start of every slab. free_stack[] follows it directly.
+ * --------------------------------------------------------------------------- */
+typedef struct kmem_slab {
+    list_node_t node;           /* Link in the cache's partial/full/empty list */
+    uint32_t magic;             /* KMEM_SLAB_MAGIC */
+    struct kmem_cache *cache;   /* Owning cache */
+    uint8_t *objects;           /* Address of object 0 */
+    uint16_t in_use;            /* Objects currently allocated */
+    uint16_t free_top;          /* Number of entries in free_stack */
+    uint16_t free_stack[];      /* Indices of free objects */
+} kmem_slab_t;
+
+/* ---------------------------------------------------------------------------
+ * Cache Structure
+ * --------------------------------------------------------------------------- */
+struct kmem_cache {
+    bool in_use;                        /* Slot allocated */
+    const char *name;                   /* Name for statistics/debugging */
+    size_t object_size;                 /* Stride between objects */
+    size_t requested_size;              /* Size passed to kmem_cache_create */
+    size_t align;                       /* Object alignment */
+    size_t slab_order;                  /* Slab = PAGE_SIZE << slab_order */
+    size_t objects_per_slab;            /* Objects carved from one slab */
+    size_t objects_offset;              /* Offset of object 0 in a slab */
+    kmem_ctor_t ctor;                   /* Optional constructor */
+
+    list_t partial;                     /* Slabs with free and used objects */
+    list_t full;                        /* Slabs with no free objects */
+    list_t empty;                       /* Slabs with no used objects */
+
+    /* Statistics */
+    size_t slab_count;
+    size_t active_objects;
+    size_t total_allocs;
+    size_t total_frees;
+    size_t failed_allocs;
+};
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+static kmem_cache_t cache_table[KMEM_MAX_CACHES];
+
+/* ---------------------------------------------------------------------------
+ * Helper: Bytes of slab header needed for a given number of objects
+ * --------------------------------------------------------------------------- */
+static inline size_t slab_header_size(size_t objects)
+{
+    return sizeof(kmem_slab_t) + objects * sizeof(uint16_t);
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Compute how many objects fit in a slab of the given order
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   slab_bytes  - Slab size in bytes
+ *   object_size - Object stride
+ *   align       - Object alignment
+ *   offset_out  - Output: offset of object 0
+ * --------------------------------------------------------------------------- */
+static size_t slab_capacity(size_t slab_bytes, size_t object_size,
+                            size_t align, size_t *offset_out)
+{
+    /* Start from an upper bound and shrink until header + objects fit */
+    size_t count = slab_bytes / object_size;
+
+    while (count > 0) {
+        size_t offset = ALIGN_UP(slab_header_size(count), align);
+        if (offset + count * object_size <= slab_bytes) {
+            *offset_out = offset;
+            return count;
+        }
+        count--;
+    }
+
+    *offset_out = 0;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * slab_create - Get pages for a new slab and carve them into objects
+ * --------------------------------------------------------------------------- */
+static kmem_slab_t *slab_create(kmem_cache_t *cache)
+{
+    size_t pages = (size_t)1 << cache->slab_order;
+    uintptr_t base = frame_alloc_contiguous_aligned(pages, pages * PAGE_SIZE);
+    if (base == 0) {
+        return NULL;
+    }
+
+    kmem_slab_t *slab = (kmem_slab_t *)base;
+    list_node_init(&slab->node);
+    slab->magic = KMEM_SLAB_MAGIC;
+    slab->cache = cache;
+    slab->objects = (uint8_t *)base + cache->objects_offset;
+    slab->in_use = 0;
+    slab->free_top = (uint16_t)cache->objects_per_slab;
+
+    /* Stack is popped from the top, so lower objects are handed out first */
+    for (size_t i = 0; i < cache->objects_per_slab; i++) {
+        slab->free_stack[i] = (uint16_t)(cache->objects_per_slab - 1 - i);
+    }
+
+    if (cache->ctor != NULL) {
+        for (size_t i = 0; i < cache->objects_per_slab; i++) {
+            cache->ctor(slab->objects + i * cache->object_size);
+        }
+    }
+
+    cache->slab_count++;
+    return slab;
+}
+
+/* ---------------------------------------------------------------------------
+ * slab_destroy - Return a slab's pages to the frame allocator
+ * --------------------------------------------------------------------------- */
+static void slab_destroy(kmem_cache_t *cache, kmem_slab_t *slab)
+{
+    slab->magic = 0;
+    frame_free_contiguous((uintptr_t)slab, (size_t)1 << cache->slab_order);
+    cache->slab_count--;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Release every slab on a list
+ * --------------------------------------------------------------------------- */
+static void slab_list_release(kmem_cache_t *cache, list_t *list)
+{
+    list_node_t *node;
+    while ((node = list_pop_front(list)) != NULL) {
+        slab_destroy(cache, list_entry(node, kmem_slab_t, node));
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * kmem_cache_create - Create a cache of fixed-size objects
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   name  - Cache name (not copied; must outlive the cache)
+ *   size  - Object size in bytes
+ *   align - Object alignment (0 = pointer size, otherwise a power of 2)
+ *   ctor  - Optional constructor run on each object when its slab is made
+ *
+ * Returns:
+ *   New cache, or NULL if the parameters are invalid or no slot is free
+ *
+ * The slab order is the smallest one that wastes at most 1/8 of the slab,
+ * capped at KMEM_MAX_SLAB_ORDER.
+ * --------------------------------------------------------------------------- */
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                kmem_ctor_t ctor)
+{
+    if (size == 0) {
+        return NULL;
+    }
+
+    if (align == 0) {
+        align = KMEM_MIN_ALIGN;
+    }
+    if (align & (align - 1)) {
+        return NULL;  /* Not a power of 2 */
+    }
+    if (align < KMEM_MIN_ALIGN) {
+        align = KMEM_MIN_ALIGN;
+    }
+
+    size_t object_size = ALIGN_UP(size, align);
+
+    /* Choose the slab order */
+    size_t order = 0;
+    size_t count = 0;
+    size_t offset = 0;
+    for (; order <= KMEM_MAX_SLAB_ORDER; order++) {
+        size_t slab_bytes = PAGE_SIZE << order;
+        count = slab_capacity(slab_bytes, object_size, align, &offset);
+        if (count == 0) {
+            continue;
+        }
+
+        size_t waste = slab_bytes - count * object_size;
+        if (waste * KMEM_WASTE_FRACTION <= slab_bytes) {
+            break;
+        }
+    }
+    if (order > KMEM_MAX_SLAB_ORDER) {
+        order = KMEM_MAX_SLAB_ORDER;
+        count = slab_capacity(PAGE_SIZE << order, object_size, align, &offset);
+    }
+    if (count == 0) {
+        return NULL;  /* Object too large for any slab */
+    }
+
+    /* Find a free cache slot */
+    kmem_cache_t *cache = NULL;
+    for (size_t i = 0; i < KMEM_MAX_CACHES; i++) {
+        if (!cache_table[i].in_use) {
+            cache = &cache_table[i];
+            break;
+        }
+    }
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->in_use = true;
+    cache->name = name;
+    cache->object_size = object_size;
+    cache->requested_size = size;
+    cache->align = align;
+    cache->slab_order = order;
+    cache->objects_per_slab = count;
+    cache->objects_offset = offset;
+    cache->ctor = ctor;
+
+    list_init(&cache->partial);
+    list_init(&cache->full);
+    list_init(&cache->empty);
+
+    cache->slab_count = 0;
+    cache->active_objects = 0;
+    cache->total_allocs = 0;
+    cache->total_frees = 0;
+    cache->failed_allocs = 0;
+
+    return cache;
+}
+
+/* ---------------------------------------------------------------------------
+ * kmem_cache_destroy - Release a cache and all of its slabs
+ * ---------------------------------------------------------------------------
+ * Any objects still allocated from the cache become invalid.
+ * --------------------------------------------------------------------------- */
+void kmem_cache_destroy(kmem_cache_t *cache)
+{
+    if (cache == NULL || !cache->in_use) {
+        return;
+    }
+
+    slab_list_release(cache, &cache->partial);
+    slab_list_release(cache, &cache->full);
+    slab_list_release(cache, &cache->empty);
+
+    cache->in_use = false;
+}
+
+/* ---------------------------------------------------------------------------
+ * kmem_cache_alloc - Allocate one object from a cache
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   Pointer to the object, or NULL if no slab could be created
+ *
+ * Time complexity: O(1)
+ * --------------------------------------------------------------------------- */
+void *kmem_cache_alloc(kmem_cache_t *cache)
+{
+    if (cache == NULL || !cache->in_use) {
+        return NULL;
+    }
+
+    /* Prefer partially used slabs, then the cached empty one, then new pages */
+    kmem_slab_t *slab;
+    if (!list_is_empty(&cache->partial)) {
+        slab = list_entry(cache->partial.head, kmem_slab_t, node);
+    } else {
+        list_node_t *node = list_pop_front(&cache->empty);
+        if (node != NULL) {
+            slab = list_entry(node, kmem_slab_t, node);
+        } else {
+            slab = slab_create(cache);
+            if (slab == NULL) {
+                cache->failed_allocs++;
+                return NULL;
+            }
+        }
+        list_push_front(&cache->partial, &slab->node);
+    }
+
+    uint16_t index = slab->free_stack[--slab->free_top];
+    slab->in_use++;
+
+    /* Slab just ran out of objects */
+    if (slab->free_top == 0) {
+        list_remove(&cache->partial, &slab->node);
+        list_push_front(&cache->full, &slab->node);
+    }
+
+    cache->active_objects++;
+    cache->total_allocs++;
+
+    return slab->objects + (size_t)index * cache->object_size;
+}
+
+/* ---------------------------------------------------------------------------
+ * kmem_cache_free - Return an object to its cache
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   cache - Cache the object was allocated from
+ *   obj   - Object pointer (NULL is safely ignored)
+ *
+ * Time complexity: O(1)
+ * --------------------------------------------------------------------------- */
+void kmem_cache_free(kmem_cache_t *cache, void *obj)
+{
+    if (cache == NULL || obj == NULL || !cache->in_use) {
+        return;
+    }
+
+    /* Slabs are aligned to their size: mask to find the header */
+    uintptr_t slab_bytes = (uintptr_t)PAGE_SIZE << cache->slab_order;
+    kmem_slab_t *slab = (kmem_slab_t *)ALIGN_DOWN((uintptr_t)obj, slab_bytes);
+
+    if (slab->magic != KMEM_SLAB_MAGIC || slab->cache != cache) {
+        PANIC("kmem_cache_free: object does not belong to this cache");
+        return;
+    }
+
+    size_t offset = (size_t)((uint8_t *)obj - slab->objects);
+    size_t index = offset / cache->object_size;
+    if ((uint8_t *)obj < slab->objects || index >= cache->objects_per_slab ||
+        offset % cache->object_size != 0) {
+        PANIC("kmem_cache_free: misaligned object pointer");
+        return;
+    }
+
+    if (slab->in_use == 0) {
+        return;  /* Double free - ignore, like kfree */
+    }
+
+    bool was_full = (slab->free_top == 0);
+    slab->free_stack[slab->free_top++] = (uint16_t)index;
+    slab->in_use--;
+
+    cache->active_objects--;
+    cache->total_frees++;
+
+    if (slab->in_use == 0) {
+        /* Keep a single empty slab around to absorb alloc/free churn */
+        list_remove(was_full ? &cache->full : &cache->partial, &slab->node);
+        if (list_is_empty(&cache->empty)) {
+            list_push_front(&cache->empty, &slab->node);
+        } else {
+            slab_destroy(cache, slab);
+        }
+    } else if (was_full) {
+        list_remove(&cache->full, &slab->node);
+        list_push_front(&cache->partial, &slab->node);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * kmem_cache_shrink - Release the cache's empty slab (if any)
+ * --------------------------------------------------------------------------- */
+void kmem_cache_shrink(kmem_cache_t *cache)
+{
+    if (cache == NULL || !cache->in_use) {
+        return;
+    }
+
+    slab_list_release(cache, &cache->empty);
+}
+
+/* ---------------------------------------------------------------------------
+ * Statistics
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Fill in usage statistics for a cache
+ */
+bool kmem_cache_get_stats(kmem_cache_t *cache, kmem_cache_stats_t *stats)
+{
+    if (cache == NULL || stats == NULL || !cache->in_use) {
+        return false;
+    }
+
+    stats->name = cache->name;
+    stats->object_size = cache->object_size;
+    stats->objects_per_slab = cache->objects_per_slab;
+    stats->slab_size = (size_t)PAGE_SIZE << cache->slab_order;
+    stats->slab_count = cache->slab_count;
+    stats->active_objects = cache->active_objects;
+    stats->total_objects = cache->slab_count * cache->objects_per_slab;
+    stats->total_allocs = cache->total_allocs;
+    stats->total_frees = cache->total_frees;
+    stats->failed_allocs = cache->failed_allocs;
+
+    return true;
+}
+
+/**
+ * @brief Get the cache in slot 'index' (for iterating over all caches)
+ *
+ * Returns NULL for unused slots and out-of-range indices.
+ */
+kmem_cache_t *kmem_cache_get_by_index(size_t index)
+{
+    if (index >= KMEM_MAX_CACHES || !cache_table[index].in_use) {
+        return NULL;
+    }
+    return &cache_table[index];
+}
+
+/**
+ * @brief Get the number of cache slots (upper bound for get_by_index)
+ */
+size_t kmem_cache_slot_count(void)
+{
+    return KMEM_MAX_CACHES;
+}
@@ -9,8 +9,9 @@
  * encounters an unrecoverable error. It:
  *
  * 1. Disables interrupts to prevent further damage
- * 2. Prints a diagnostic message to the VGA console
- * 3. Halts the CPU permanently
+ * 2. Saves a crash dump for the next boot (kernel/utils/crashdump.h)
+ * 3. Prints a diagnostic message to the VGA console
+ * 4. Halts the CPU permanently
  *
  * panic() should be called sparingly and only for truly unrecoverable errors.
  *
@@ -18,12 +19,14 @@
  */
 
 #include <stdarg.h>
+#include "utils/crashdump.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions
  * --------------------------------------------------------------------------- */
 extern void cpu_halt(void);         /* Halt the CPU (from startup.asm) */
 extern void cpu_cli(void);          /* Disable interrupts */
+extern void serial_panic_flush(void); /* Send queued serial output */
 
 /* ---------------------------------------------------------------------------
  * VGA Constants
@@ -103,6 +106,12 @@ void panic_impl(const char *file, int line, const char *message)
     
     /* Disable interrupts immediately */
     cpu_cli();
+
+    /* Registers, tasks and the rings, before anything else can change them */
+    crashdump_capture(CRASHDUMP_PANIC, file, line, message, NULL);
+
+    /* The THRE interrupt will never run again: push queued log output now */
+    serial_panic_flush();
     
     /* Clear screen with panic color */
     for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
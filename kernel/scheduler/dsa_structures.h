@@ -22,9 +22,25 @@
  *    - Higher priority tasks always run first
  *    - Can cause starvation without aging
  *
+ * 3. Bitmap Multi-Level
+ *    - One FIFO per priority level plus a non-empty bitmask
+ *    - Same ordering as priority-based, FIFO among equal priorities
+ *    - O(1) enqueue, pick and remove
+ *
+ * 4. Fair-Share
+ *    - Red-black tree of ready tasks ordered by weighted virtual runtime
+ *    - Priority sets the share of CPU rather than strict precedence
+ *    - O(log n) enqueue and pick, no starvation
+ *
  * The scheduler can use either policy (configured in os_config.h) or
  * combine them (priority queues within round-robin).
  *
+ * Every ready queue exists once per CPU (SMP_MAX_CPUS); the first argument
+ * picks the CPU's instance. The scheduler calls them with sched_lock held.
+ *
+ * Sleeping tasks are kept separately in a hierarchical timer wheel so the
+ * timer tick only looks at the tasks that are due.
+ *
  * ===========================================================================
  */
 
@@ -44,6 +60,8 @@
  *   SCHED_POLICY_ROUND_ROBIN (0) - FIFO queue with time slicing
  *   SCHED_POLICY_PRIORITY    (1) - Min-heap by priority value
  *   SCHED_POLICY_MLFQ        (2) - Multi-Level Feedback Queue (future)
+ *   SCHED_POLICY_BITMAP      (3) - Per-priority FIFOs with a level bitmap
+ *   SCHED_POLICY_FAIR        (4) - Red-black tree by weighted vruntime
  * --------------------------------------------------------------------------- */
 
 /* Only define if not already defined (avoid redefinition) */
@@ -51,12 +69,22 @@
 #define SCHED_POLICY_ROUND_ROBIN    0
 #define SCHED_POLICY_PRIORITY       1
 #define SCHED_POLICY_MLFQ           2   /* Multi-Level Feedback Queue (future) */
+#define SCHED_POLICY_BITMAP         3
+#define SCHED_POLICY_FAIR           4
 #endif
 
-/* Default scheduling policy */
+/* Default scheduling policy (selected with SCHEDULER= in build_flags.mk) */
 #ifndef SCHEDULER_POLICY
+#if defined(USE_FAIR_SCHEDULER)
+#define SCHEDULER_POLICY    SCHED_POLICY_FAIR
+#elif defined(USE_BITMAP_SCHEDULER)
+#define SCHEDULER_POLICY    SCHED_POLICY_BITMAP
+#elif defined(USE_PRIORITY_SCHEDULER)
+#define SCHEDULER_POLICY    SCHED_POLICY_PRIORITY
+#else
 #define SCHEDULER_POLICY    SCHED_POLICY_ROUND_ROBIN
 #endif
+#endif
 
 /* ---------------------------------------------------------------------------
  * Round-Robin Queue API
@@ -66,60 +94,66 @@
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Initialize the round-robin queue
+ * @brief Initialize every CPU's round-robin queue
  * 
- * @param capacity Maximum number of tasks the queue can hold
+ * @param capacity Maximum number of tasks each queue can hold
  * @return true on success, false on failure (e.g., out of memory)
  */
 bool rr_queue_init(size_t capacity);
 
 /**
- * @brief Destroy the round-robin queue and free resources
+ * @brief Destroy every round-robin queue and free resources
  */
 void rr_queue_destroy(void);
 
 /**
  * @brief Add a task to the back of the queue
  * 
+ * @param cpu CPU whose queue to use
  * @param task Task to enqueue
  * @return true on success, false if queue is full
  */
-bool rr_enqueue(task_t *task);
+bool rr_enqueue(uint32_t cpu, task_t *task);
 
 /**
  * @brief Remove and return the task at the front of the queue
  * 
+ * @param cpu CPU whose queue to use
  * @return Task pointer, or NULL if queue is empty
  */
-task_t *rr_dequeue(void);
+task_t *rr_dequeue(uint32_t cpu);
 
 /**
  * @brief Look at the task at the front without removing it
  * 
+ * @param cpu CPU whose queue to use
  * @return Task pointer, or NULL if queue is empty
  */
-task_t *rr_peek(void);
+task_t *rr_peek(uint32_t cpu);
 
 /**
  * @brief Check if the round-robin queue is empty
  * 
+ * @param cpu CPU whose queue to use
  * @return true if empty, false otherwise
  */
-bool rr_is_empty(void);
+bool rr_is_empty(uint32_t cpu);
 
 /**
  * @brief Check if the round-robin queue is full
  * 
+ * @param cpu CPU whose queue to use
  * @return true if full, false otherwise
  */
-bool rr_is_full(void);
+bool rr_is_full(uint32_t cpu);
 
 /**
  * @brief Get the number of tasks in the queue
  * 
+ * @param cpu CPU whose queue to use
  * @return Number of tasks
  */
-size_t rr_count(void);
+size_t rr_count(uint32_t cpu);
 
 /**
  * @brief Remove a specific task from the queue
@@ -127,10 +161,11 @@ size_t rr_count(void);
  * Searches the queue for the task and removes it.
  * Used when a task blocks or terminates.
  * 
+ * @param cpu CPU whose queue to use
  * @param task Task to remove
  * @return true if found and removed, false otherwise
  */
-bool rr_remove(task_t *task);
+bool rr_remove(uint32_t cpu, task_t *task);
 
 /* ---------------------------------------------------------------------------
  * Priority Queue API
@@ -141,15 +176,15 @@ bool rr_remove(task_t *task);
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Initialize the priority queue
+ * @brief Initialize every CPU's priority queue
  * 
- * @param capacity Maximum number of tasks the queue can hold
+ * @param capacity Maximum number of tasks each queue can hold
  * @return true on success, false on failure
  */
 bool pq_init(size_t capacity);
 
 /**
- * @brief Destroy the priority queue and free resources
+ * @brief Destroy every priority queue and free resources
  */
 void pq_destroy(void);
 
@@ -158,61 +193,310 @@ void pq_destroy(void);
  * 
  * The task is inserted in the correct position based on its priority.
  * 
+ * @param cpu CPU whose queue to use
  * @param task Task to enqueue
  * @return true on success, false if queue is full
  */
-bool pq_enqueue(task_t *task);
+bool pq_enqueue(uint32_t cpu, task_t *task);
 
 /**
  * @brief Remove and return the highest-priority task
  * 
+ * @param cpu CPU whose queue to use
  * @return Task pointer, or NULL if queue is empty
  */
-task_t *pq_dequeue(void);
+task_t *pq_dequeue(uint32_t cpu);
 
 /**
  * @brief Look at the highest-priority task without removing it
  * 
+ * @param cpu CPU whose queue to use
  * @return Task pointer, or NULL if queue is empty
  */
-task_t *pq_peek(void);
+task_t *pq_peek(uint32_t cpu);
 
 /**
  * @brief Check if the priority queue is empty
  * 
+ * @param cpu CPU whose queue to use
  * @return true if empty, false otherwise
  */
-bool pq_is_empty(void);
+bool pq_is_empty(uint32_t cpu);
 
 /**
  * @brief Check if the priority queue is full
  * 
+ * @param cpu CPU whose queue to use
  * @return true if full, false otherwise
  */
-bool pq_is_full(void);
+bool pq_is_full(uint32_t cpu);
 
 /**
  * @brief Get the number of tasks in the priority queue
  * 
+ * @param cpu CPU whose queue to use
  * @return Number of tasks
  */
-size_t pq_count(void);
+size_t pq_count(uint32_t cpu);
 
 /**
  * @brief Remove a specific task from the priority queue
  * 
+ * @param cpu CPU whose queue to use
  * @param task Task to remove
  * @return true if found and removed, false otherwise
  */
-bool pq_remove(task_t *task);
+bool pq_remove(uint32_t cpu, task_t *task);
 
 /**
  * @brief Update a task's position after priority change
  * 
  * Call this after changing a task's priority to maintain heap property.
  * 
+ * @param cpu CPU whose queue to use
+ * @param task Task whose priority was changed
+ */
+void pq_update(uint32_t cpu, task_t *task);
+
+/* ---------------------------------------------------------------------------
+ * Bitmap Queue API
+ * ---------------------------------------------------------------------------
+ * Implements an O(1) multi-level ready queue: one FIFO per priority level
+ * (linked through task->next/prev) and a bitmask of non-empty levels.
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize every CPU's bitmap queue
+ */
+void bq_init(void);
+
+/**
+ * @brief Add a task to the back of its priority level
+ * 
+ * @param cpu CPU whose queue to use
+ * @param task Task to enqueue
+ * @return true on success, false if the task is already queued
+ */
+bool bq_enqueue(uint32_t cpu, task_t *task);
+
+/**
+ * @brief Remove and return the first task of the highest-priority level
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Task pointer, or NULL if queue is empty
+ */
+task_t *bq_dequeue(uint32_t cpu);
+
+/**
+ * @brief Look at the next task without removing it
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Task pointer, or NULL if queue is empty
+ */
+task_t *bq_peek(uint32_t cpu);
+
+/**
+ * @brief Check if the bitmap queue is empty
+ * 
+ * @param cpu CPU whose queue to use
+ * @return true if empty, false otherwise
+ */
+bool bq_is_empty(uint32_t cpu);
+
+/**
+ * @brief Get the number of tasks in the bitmap queue
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Number of tasks
+ */
+size_t bq_count(uint32_t cpu);
+
+/**
+ * @brief Remove a specific task from the bitmap queue
+ * 
+ * @param cpu CPU whose queue to use
+ * @param task Task to remove
+ * @return true if found and removed, false otherwise
+ */
+bool bq_remove(uint32_t cpu, task_t *task);
+
+/**
+ * @brief Move a queued task to the level of its current priority
+ * 
+ * @param cpu CPU whose queue to use
  * @param task Task whose priority was changed
  */
-void pq_update(task_t *task);
+void bq_update(uint32_t cpu, task_t *task);
+
+/* ---------------------------------------------------------------------------
+ * Fair Queue API
+ * ---------------------------------------------------------------------------
+ * Implements the fair policy's run queue: a red-black tree of tasks keyed
+ * by vruntime, with the leftmost node cached. vruntime advances by
+ * (FAIR_WEIGHT_NORMAL / weight) << FAIR_VRUNTIME_SHIFT per tick of CPU.
+ * --------------------------------------------------------------------------- */
+
+/* Fixed-point fraction bits of vruntime */
+#define FAIR_VRUNTIME_SHIFT 10
+
+/**
+ * @brief Initialize every CPU's fair queue
+ * 
+ * @param latency Target latency in ticks (bounds sleeper credit)
+ */
+void fq_init(uint32_t latency);
+
+/**
+ * @brief Change the target latency of every fair queue
+ * 
+ * @param latency Target latency in ticks
+ */
+void fq_set_latency(uint32_t latency);
+
+/**
+ * @brief Add a task to the tree
+ * 
+ * A task whose vruntime lags far behind the queue is lifted to
+ * min_vruntime minus half the target latency first.
+ * 
+ * @param cpu CPU whose queue to use
+ * @param task Task to enqueue
+ * @return true on success, false if the task is already queued
+ */
+bool fq_enqueue(uint32_t cpu, task_t *task);
+
+/**
+ * @brief Remove and return the task with the smallest vruntime
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Task pointer, or NULL if queue is empty
+ */
+task_t *fq_dequeue(uint32_t cpu);
+
+/**
+ * @brief Look at the task with the smallest vruntime
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Task pointer, or NULL if queue is empty
+ */
+task_t *fq_peek(uint32_t cpu);
+
+/**
+ * @brief Remove a specific task from the tree
+ * 
+ * @param cpu CPU whose queue to use
+ * @param task Task to remove
+ * @return true if found and removed, false otherwise
+ */
+bool fq_remove(uint32_t cpu, task_t *task);
+
+/**
+ * @brief Get the number of tasks in the tree
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Number of tasks
+ */
+size_t fq_count(uint32_t cpu);
+
+/**
+ * @brief Get the summed weight of the queued tasks
+ * 
+ * @param cpu CPU whose queue to use
+ * @return Total weight
+ */
+uint32_t fq_total_weight(uint32_t cpu);
+
+/**
+ * @brief Get the weight of a task's priority
+ * 
+ * @param task Task to query
+ * @return Weight (FAIR_WEIGHT_NORMAL = 1024 for TASK_PRIORITY_NORMAL)
+ */
+uint32_t fq_task_weight(const task_t *task);
+
+/**
+ * @brief Charge a running task for CPU ticks
+ * 
+ * Advances its vruntime and the queue's min_vruntime.
+ * 
+ * @param cpu   CPU whose queue to use
+ * @param task  Task that ran (not on the tree)
+ * @param ticks Ticks consumed
+ */
+void fq_charge(uint32_t cpu, task_t *task, uint32_t ticks);
+
+/**
+ * @brief Get the queue's monotonic vruntime floor
+ * 
+ * @param cpu CPU whose queue to use
+ * @return min_vruntime
+ */
+uint64_t fq_min_vruntime(uint32_t cpu);
+
+/* ---------------------------------------------------------------------------
+ * Sleep Wheel API
+ * ---------------------------------------------------------------------------
+ * Implements a hierarchical timer wheel of sleeping tasks keyed by
+ * sleep_until. Each level has 64 slots; level n slots cover 64^n ticks.
+ * All calls must be made with interrupts disabled and sched_lock held.
+ * --------------------------------------------------------------------------- */
+
+/* Number of wheel levels (5 levels x 6 bits = 2^30 ticks of range) */
+#define SLEEP_WHEEL_LEVELS  5
+
+/**
+ * @brief Initialize the sleep wheel
+ * 
+ * @param now Current tick count (first tick the wheel will process)
+ */
+void sleep_wheel_init(uint32_t now);
+
+/**
+ * @brief Add a task to the wheel
+ * 
+ * The task's sleep_until must already be set.
+ * 
+ * @param task Task to insert
+ * @return true on success, false if the task is already on the wheel
+ */
+bool sleep_wheel_insert(task_t *task);
+
+/**
+ * @brief Remove a task from the wheel before it expires
+ * 
+ * @param task Task to remove
+ * @return true if the task was on the wheel, false otherwise
+ */
+bool sleep_wheel_remove(task_t *task);
+
+/**
+ * @brief Advance the wheel to the given tick
+ * 
+ * Takes every task whose sleep_until is at or before now off the wheel
+ * and passes it to expire (the scheduler's wakeup, run under sched_lock).
+ * 
+ * @param now    Current tick count
+ * @param expire Called for each expired task
+ * @return Number of tasks woken
+ */
+size_t sleep_wheel_advance(uint32_t now, void (*expire)(task_t *task));
+
+/**
+ * @brief Get the distance to the wheel's next expiry or cascade
+ * 
+ * Used by tickless idle to decide how long the timer can stay quiet.
+ * 
+ * @param now       Current tick count
+ * @param max_ticks Upper bound on the answer
+ * @return Ticks from now until the next event (0 = due now), or max_ticks
+ */
+uint32_t sleep_wheel_next_event(uint32_t now, uint32_t max_ticks);
+
+/**
+ * @brief Get the number of sleeping tasks on the wheel
+ * 
+ * @return Number of tasks
+ */
+size_t sleep_wheel_count(void);
 
 #endif /* NEXA_SCHEDULER_DSA_H */
@@ -0,0 +1,259 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/dsa_structures/fair_queue.c
+ * ===========================================================================
+ *
+ * Fair-Share Run Queue Implementation (Red-Black Tree by vruntime)
+ *
+ * This file implements the run queue for the fair scheduling policy. Every
+ * task accumulates virtual runtime (vruntime): real CPU ticks scaled by the
+ * inverse of its priority weight, so a heavier (higher-priority) task's
+ * vruntime grows more slowly. The runnable task with the smallest vruntime
+ * is always the one that has received the least of its fair share and runs
+ * next.
+ *
+ * Data Structure: Red-Black Tree keyed by vruntime
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │                      [C: 340]                                            │
+ * │                     /        \                                           │
+ * │              [A: 120]         [D: 900]                                    │
+ * │              /      \                                                    │
+ * │        [B: 100]    [E: 200]                                              │
+ * │           ▲                                                              │
+ * │        leftmost (cached) = next task to run                              │
+ * │                                                                          │
+ * │  - Insert / remove:  O(log n) (at most 3 rotations)                      │
+ * │  - Pick next:        O(1) peek of the cached leftmost node,              │
+ * │                      O(log n) to remove it                               │
+ * │  - Equal vruntimes keep FIFO order                                       │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * Each CPU has its own tree. min_vruntime is a monotonic floor that follows
+ * the smallest vruntime on that CPU. Tasks (re-)entering the queue after sleeping are lifted to
+ * min_vruntime minus half the target latency, so a long sleep earns a
+ * small head start rather than a CPU monopoly.
+ *
+ * ===========================================================================
+ */
+
+#include "../dsa_structures.h"
+
+/* ---------------------------------------------------------------------------
+ * Priority Weights
+ * ---------------------------------------------------------------------------
+ * Each priority step is worth ~25% more CPU than the next one down, with
+ * TASK_PRIORITY_NORMAL at FAIR_WEIGHT_NORMAL. The idle level gets a token
+ * weight. fair_inverse[] holds the per-tick vruntime increment so the tick
+ * path needs no division.
+ * --------------------------------------------------------------------------- */
+
+#define FAIR_WEIGHT_NORMAL  1024
+
+static const uint32_t fair_weight[MAX_PRIORITY_LEVELS] = {
+    2000, 1600, 1280, 1024, 820, 655, 526, 15
+};
+
+#define FAIR_INVERSE(w)     ((FAIR_WEIGHT_NORMAL << FAIR_VRUNTIME_SHIFT) / (w))
+
+static const uint32_t fair_inverse[MAX_PRIORITY_LEVELS] = {
+    FAIR_INVERSE(2000), FAIR_INVERSE(1600), FAIR_INVERSE(1280),
+    FAIR_INVERSE(1024), FAIR_INVERSE(820),  FAIR_INVERSE(655),
+    FAIR_INVERSE(526),  FAIR_INVERSE(15)
+};
+
+/* ---------------------------------------------------------------------------
+ * Fair Queue Structure
+ * --------------------------------------------------------------------------- */
+typedef struct fair_queue {
+    rb_tree_t tree;         /* Runnable tasks ordered by vruntime */
+    uint64_t min_vruntime;  /* Monotonic vruntime floor */
+    uint32_t total_weight;  /* Sum of weights of queued tasks */
+    uint32_t latency;       /* Target latency (ticks) */
+} fair_queue_t;
+
+/* One fair queue per CPU */
+static fair_queue_t fqs[SMP_MAX_CPUS];
+
+/* ---------------------------------------------------------------------------
+ * Internal Helper Functions
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Weight table index for a task
+ */
+static inline uint32_t fair_level(const task_t *task)
+{
+    return (task->priority < MAX_PRIORITY_LEVELS) ?
+           task->priority : (MAX_PRIORITY_LEVELS - 1);
+}
+
+/**
+ * @brief Wrap-safe "a runs before b" for vruntimes
+ */
+static inline bool vruntime_before(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b) < 0;
+}
+
+/**
+ * @brief Tree ordering callback
+ */
+static bool fair_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return vruntime_before(rb_entry(a, task_t, run_node)->vruntime,
+                           rb_entry(b, task_t, run_node)->vruntime);
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API Implementation
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize the fair queue
+ */
+void fq_init(uint32_t latency)
+{
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        rb_tree_init(&fqs[cpu].tree);
+        fqs[cpu].min_vruntime = 0;
+        fqs[cpu].total_weight = 0;
+        fqs[cpu].latency = latency;
+    }
+}
+
+/**
+ * @brief Set the target latency used for sleeper placement
+ */
+void fq_set_latency(uint32_t latency)
+{
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        fqs[cpu].latency = latency;
+    }
+}
+
+/**
+ * @brief Add a runnable task to the tree
+ *
+ * Time Complexity: O(log n)
+ */
+bool fq_enqueue(uint32_t cpu, task_t *task)
+{
+    if (task == NULL || rb_node_is_linked(&task->run_node)) {
+        return false;
+    }
+
+    /* Cap the credit a sleeping or brand-new task can bring back */
+    fair_queue_t *fq = &fqs[cpu];
+    uint64_t credit = ((uint64_t)fq->latency << FAIR_VRUNTIME_SHIFT) >> 1;
+    uint64_t floor = fq->min_vruntime - credit;
+    if (fq->min_vruntime < credit) {
+        floor = 0;
+    }
+    if (vruntime_before(task->vruntime, floor)) {
+        task->vruntime = floor;
+    }
+
+    /* Remember the weight added, in case the priority changes while queued */
+    task->run_weight = fair_weight[fair_level(task)];
+    rb_insert(&fq->tree, &task->run_node, fair_less);
+    fq->total_weight += task->run_weight;
+    return true;
+}
+
+/**
+ * @brief Look at the task with the smallest vruntime
+ *
+ * Time Complexity: O(1)
+ */
+task_t *fq_peek(uint32_t cpu)
+{
+    rb_node_t *first = rb_first(&fqs[cpu].tree);
+    return first ? rb_entry(first, task_t, run_node) : NULL;
+}
+
+/**
+ * @brief Remove a specific task from the tree
+ *
+ * Time Complexity: O(log n)
+ */
+bool fq_remove(uint32_t cpu, task_t *task)
+{
+    if (task == NULL || !rb_node_is_linked(&task->run_node)) {
+        return false;
+    }
+
+    rb_erase(&fqs[cpu].tree, &task->run_node);
+    fqs[cpu].total_weight -= task->run_weight;
+    return true;
+}
+
+/**
+ * @brief Remove and return the task with the smallest vruntime
+ *
+ * Time Complexity: O(log n)
+ */
+task_t *fq_dequeue(uint32_t cpu)
+{
+    task_t *task = fq_peek(cpu);
+    if (task != NULL) {
+        fq_remove(cpu, task);
+    }
+    return task;
+}
+
+/**
+ * @brief Get the number of queued tasks
+ */
+size_t fq_count(uint32_t cpu)
+{
+    return rb_size(&fqs[cpu].tree);
+}
+
+/**
+ * @brief Get the summed weight of the queued tasks
+ */
+uint32_t fq_total_weight(uint32_t cpu)
+{
+    return fqs[cpu].total_weight;
+}
+
+/**
+ * @brief Get a task's weight
+ */
+uint32_t fq_task_weight(const task_t *task)
+{
+    return task ? fair_weight[fair_level(task)] : 0;
+}
+
+/**
+ * @brief Charge a task for ticks of CPU time
+ *
+ * Advances the task's vruntime by its weighted share and moves
+ * min_vruntime forward. The task must not be on the tree.
+ */
+void fq_charge(uint32_t cpu, task_t *task, uint32_t ticks)
+{
+    if (task == NULL) {
+        return;
+    }
+
+    task->vruntime += (uint64_t)fair_inverse[fair_level(task)] * ticks;
+
+    /* min_vruntime = max(min_vruntime, min(running, leftmost)) */
+    uint64_t candidate = task->vruntime;
+    task_t *first = fq_peek(cpu);
+    if (first != NULL && vruntime_before(first->vruntime, candidate)) {
+        candidate = first->vruntime;
+    }
+    if (vruntime_before(fqs[cpu].min_vruntime, candidate)) {
+        fqs[cpu].min_vruntime = candidate;
+    }
+}
+
+/**
+ * @brief Get the current vruntime floor
+ */
+uint64_t fq_min_vruntime(uint32_t cpu)
+{
+    return fqs[cpu].min_vruntime;
+}
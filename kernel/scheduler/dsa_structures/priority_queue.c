@@ -32,171 +32,48 @@
  * │  - Insert: Add at end, bubble up    O(log n)                             │
  * │  - Extract: Remove root, bubble down O(log n)                            │
  * │  - Peek: Return root                O(1)                                 │
- * │  - Remove: Find, swap, bubble       O(n)                                 │
+ * │  - Remove: Swap, bubble             O(log n)                             │
  * └───────────────────────────────────────────────────────────────────────────┘
  *
+ * The heap is generated by DEFINE_HEAP_INDEXED for task_t pointers, so the
+ * comparison is inlined, and each task records its slot in heap_index.
+ * Removing or repositioning a task therefore starts at its slot instead of
+ * searching the array. There is one heap per CPU.
+ *
  * ===========================================================================
  */
 
 #include "../dsa_structures.h"
 #include "../../memory/memory.h"
+#include <lib/dsa/typed_heap.h>
 
 /* ---------------------------------------------------------------------------
- * Priority Queue Structure
- * --------------------------------------------------------------------------- */
-typedef struct priority_queue {
-    task_t **buffer;        /* Array of task pointers */
-    size_t capacity;        /* Maximum number of tasks */
-    size_t size;            /* Current number of tasks */
-} priority_queue_t;
-
-/* Static instance of the priority queue */
-static priority_queue_t pq = {
-    .buffer = NULL,
-    .capacity = 0,
-    .size = 0
-};
-
-/* ---------------------------------------------------------------------------
- * Internal Helper Functions
+ * Heap Specialization
  * --------------------------------------------------------------------------- */
 
-/**
- * @brief Get parent index in the heap
- */
-static inline size_t parent(size_t i)
-{
-    return (i - 1) / 2;
-}
-
-/**
- * @brief Get left child index in the heap
- */
-static inline size_t left_child(size_t i)
-{
-    return 2 * i + 1;
-}
-
-/**
- * @brief Get right child index in the heap
- */
-static inline size_t right_child(size_t i)
-{
-    return 2 * i + 2;
-}
-
-/**
- * @brief Compare two tasks by priority
- * 
- * Returns negative if a has higher priority (lower value),
- * positive if b has higher priority, zero if equal.
+/*
+ * Lower priority value = higher priority. Equal priorities: prefer the task
+ * that has been around longer (lower PID as tie-breaker).
  */
-static int task_compare(task_t *a, task_t *b)
-{
-    if (a == NULL || b == NULL) {
-        return 0;
-    }
-    
-    /* Lower priority value = higher priority */
-    if (a->priority < b->priority) {
-        return -1;  /* a has higher priority */
-    } else if (a->priority > b->priority) {
-        return 1;   /* b has higher priority */
-    }
-    
-    /* If same priority, prefer task that's been waiting longer (lower PID as tie-breaker) */
-    if (a->pid < b->pid) {
-        return -1;
-    } else if (a->pid > b->pid) {
-        return 1;
-    }
-    
-    return 0;
-}
+#define task_before(a, b) \
+    ((a)->priority < (b)->priority || \
+     ((a)->priority == (b)->priority && (a)->pid < (b)->pid))
 
-/**
- * @brief Swap two elements in the buffer
- */
-static void swap(size_t i, size_t j)
-{
-    task_t *temp = pq.buffer[i];
-    pq.buffer[i] = pq.buffer[j];
-    pq.buffer[j] = temp;
-}
+#define task_set_heap_index(task, i)    ((task)->heap_index = (int16_t)(i))
 
-/**
- * @brief Restore heap property by bubbling up
- * 
- * Used after insertion. Moves element up the tree until heap property is satisfied.
- */
-static void heapify_up(size_t index)
-{
-    /*
-     * While we're not at the root and parent has lower priority:
-     * Swap with parent and continue up
-     */
-    while (index > 0) {
-        size_t p = parent(index);
-        
-        /* If parent has higher or equal priority, stop */
-        if (task_compare(pq.buffer[p], pq.buffer[index]) <= 0) {
-            break;
-        }
-        
-        /* Parent has lower priority, swap */
-        swap(index, p);
-        index = p;
-    }
-}
+DEFINE_HEAP_INDEXED(task_heap, task_t *, task_before, task_set_heap_index)
 
-/**
- * @brief Restore heap property by bubbling down
- * 
- * Used after extraction. Moves element down the tree until heap property is satisfied.
- */
-static void heapify_down(size_t index)
-{
-    while (true) {
-        size_t smallest = index;
-        size_t left = left_child(index);
-        size_t right = right_child(index);
-        
-        /* Check if left child has higher priority */
-        if (left < pq.size && 
-            task_compare(pq.buffer[left], pq.buffer[smallest]) < 0) {
-            smallest = left;
-        }
-        
-        /* Check if right child has higher priority */
-        if (right < pq.size && 
-            task_compare(pq.buffer[right], pq.buffer[smallest]) < 0) {
-            smallest = right;
-        }
-        
-        /* If current position is correct, stop */
-        if (smallest == index) {
-            break;
-        }
-        
-        /* Swap and continue down */
-        swap(index, smallest);
-        index = smallest;
-    }
-}
+/* One priority queue per CPU */
+static task_heap_t pqs[SMP_MAX_CPUS];
 
-/**
- * @brief Find a task in the priority queue
- * 
- * @return Index of task, or pq.size if not found
- */
-static size_t find_task(task_t *task)
+/* Slot of a queued task, or pq->size if the task is not in this heap */
+static size_t task_slot(const task_heap_t *pq, task_t *task)
 {
-    for (size_t i = 0; i < pq.size; i++) {
-        if (pq.buffer[i] == task) {
-            return i;
-        }
+    size_t index = (size_t)task->heap_index;
+    if (task->heap_index < 0 || index >= pq->size || pq->items[index] != task) {
+        return pq->size;
     }
-    return pq.size;  /* Not found */
+    return index;
 }
 
 /* ---------------------------------------------------------------------------
@@ -213,26 +90,18 @@ bool pq_init(size_t capacity)
         return false;
     }
 
-    /* Clean up any existing queue */
-    if (pq.buffer != NULL) {
-        pq_destroy();
-    }
-
-    /* Allocate buffer */
-    pq.buffer = (task_t **)kmalloc(capacity * sizeof(task_t *));
-    if (pq.buffer == NULL) {
-        return false;  /* Out of memory */
-    }
+    /* Clean up any existing queues */
+    pq_destroy();
 
-    /* Initialize all slots to NULL */
-    for (size_t i = 0; i < capacity; i++) {
-        pq.buffer[i] = NULL;
+    /* Allocate a buffer per CPU */
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        task_t **storage = (task_t **)kmalloc(capacity * sizeof(task_t *));
+        if (storage == NULL) {
+            pq_destroy();
+            return false;  /* Out of memory */
+        }
+        task_heap_init(&pqs[cpu], storage, capacity);
     }
-
-    /* Initialize queue state */
-    pq.capacity = capacity;
-    pq.size = 0;
-
     return true;
 }
 
@@ -241,12 +110,16 @@ bool pq_init(size_t capacity)
  */
 void pq_destroy(void)
 {
-    if (pq.buffer != NULL) {
-        kfree(pq.buffer);
-        pq.buffer = NULL;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        task_heap_t *pq = &pqs[cpu];
+        for (size_t i = 0; i < pq->size; i++) {
+            pq->items[i]->heap_index = -1;
+        }
+        if (pq->items != NULL) {
+            kfree(pq->items);
+        }
+        task_heap_init(pq, NULL, 0);
     }
-    pq.capacity = 0;
-    pq.size = 0;
 }
 
 /**
@@ -254,26 +127,12 @@ void pq_destroy(void)
  * 
  * Time Complexity: O(log n)
  */
-bool pq_enqueue(task_t *task)
+bool pq_enqueue(uint32_t cpu, task_t *task)
 {
-    /* Validate parameters */
-    if (task == NULL || pq.buffer == NULL) {
+    if (task == NULL || pqs[cpu].items == NULL) {
         return false;
     }
-
-    /* Check if queue is full */
-    if (pq.size >= pq.capacity) {
-        return false;
-    }
-
-    /* Add task at the end */
-    pq.buffer[pq.size] = task;
-    pq.size++;
-
-    /* Restore heap property by bubbling up */
-    heapify_up(pq.size - 1);
-
-    return true;
+    return task_heap_push(&pqs[cpu], task);
 }
 
 /**
@@ -281,28 +140,10 @@ bool pq_enqueue(task_t *task)
  * 
  * Time Complexity: O(log n)
  */
-task_t *pq_dequeue(void)
+task_t *pq_dequeue(uint32_t cpu)
 {
-    /* Check if queue is empty */
-    if (pq.buffer == NULL || pq.size == 0) {
-        return NULL;
-    }
-
-    /* Save the root (highest priority task) */
-    task_t *task = pq.buffer[0];
-
-    /* Move last element to root */
-    pq.size--;
-    if (pq.size > 0) {
-        pq.buffer[0] = pq.buffer[pq.size];
-        pq.buffer[pq.size] = NULL;
-        
-        /* Restore heap property by bubbling down */
-        heapify_down(0);
-    } else {
-        pq.buffer[0] = NULL;
-    }
-
+    task_t *task = NULL;
+    task_heap_pop(&pqs[cpu], &task);
     return task;
 }
 
@@ -311,12 +152,10 @@ task_t *pq_dequeue(void)
  * 
  * Time Complexity: O(1)
  */
-task_t *pq_peek(void)
+task_t *pq_peek(uint32_t cpu)
 {
-    if (pq.buffer == NULL || pq.size == 0) {
-        return NULL;
-    }
-    return pq.buffer[0];
+    task_t **top = task_heap_peek(&pqs[cpu]);
+    return top != NULL ? *top : NULL;
 }
 
 /**
@@ -324,9 +163,9 @@ task_t *pq_peek(void)
  * 
  * Time Complexity: O(1)
  */
-bool pq_is_empty(void)
+bool pq_is_empty(uint32_t cpu)
 {
-    return (pq.buffer == NULL || pq.size == 0);
+    return pqs[cpu].size == 0;
 }
 
 /**
@@ -334,9 +173,9 @@ bool pq_is_empty(void)
  * 
  * Time Complexity: O(1)
  */
-bool pq_is_full(void)
+bool pq_is_full(uint32_t cpu)
 {
-    return (pq.buffer != NULL && pq.size >= pq.capacity);
+    return (pqs[cpu].items != NULL && pqs[cpu].size >= pqs[cpu].capacity);
 }
 
 /**
@@ -344,78 +183,45 @@ bool pq_is_full(void)
  * 
  * Time Complexity: O(1)
  */
-size_t pq_count(void)
+size_t pq_count(uint32_t cpu)
 {
-    return pq.size;
+    return task_heap_count(&pqs[cpu]);
 }
 
 /**
  * @brief Remove a specific task from the priority queue
  * 
- * Time Complexity: O(n) for search + O(log n) for re-heapify
+ * Time Complexity: O(log n)
  */
-bool pq_remove(task_t *task)
+bool pq_remove(uint32_t cpu, task_t *task)
 {
-    /* Validate parameters */
-    if (task == NULL || pq.buffer == NULL || pq.size == 0) {
+    if (task == NULL) {
         return false;
     }
 
-    /* Find the task */
-    size_t index = find_task(task);
-    if (index >= pq.size) {
-        return false;  /* Not found */
-    }
-
-    /* Move last element to this position */
-    pq.size--;
-    if (index < pq.size) {
-        pq.buffer[index] = pq.buffer[pq.size];
-        pq.buffer[pq.size] = NULL;
-
-        /*
-         * Restore heap property.
-         * The replacement element could violate heap property in either direction:
-         * - If it has higher priority than parent, bubble up
-         * - If it has lower priority than children, bubble down
-         */
-        if (index > 0 && task_compare(pq.buffer[index], pq.buffer[parent(index)]) < 0) {
-            heapify_up(index);
-        } else {
-            heapify_down(index);
-        }
-    } else {
-        pq.buffer[index] = NULL;
+    task_heap_t *pq = &pqs[cpu];
+    size_t index = task_slot(pq, task);
+    if (index >= pq->size) {
+        return false;  /* Not queued here */
     }
-
+    task_heap_remove_at(pq, index);
     return true;
 }
 
 /**
  * @brief Update a task's position after priority change
  * 
- * Time Complexity: O(n) for search + O(log n) for re-heapify
+ * Time Complexity: O(log n)
  */
-void pq_update(task_t *task)
+void pq_update(uint32_t cpu, task_t *task)
 {
-    /* Validate parameters */
-    if (task == NULL || pq.buffer == NULL || pq.size == 0) {
+    if (task == NULL) {
         return;
     }
 
-    /* Find the task */
-    size_t index = find_task(task);
-    if (index >= pq.size) {
-        return;  /* Not found */
-    }
-
-    /*
-     * Priority may have increased or decreased.
-     * Try to bubble up first, then bubble down.
-     */
-    if (index > 0 && task_compare(pq.buffer[index], pq.buffer[parent(index)]) < 0) {
-        heapify_up(index);
-    } else {
-        heapify_down(index);
+    task_heap_t *pq = &pqs[cpu];
+    size_t index = task_slot(pq, task);
+    if (index < pq->size) {
+        task_heap_fix(pq, index);
     }
 }
@@ -25,36 +25,36 @@
  * │  Operations:                                                             │
  * │  - Enqueue: Add at tail, advance tail                                    │
  * │  - Dequeue: Remove at head, advance head                                 │
- * │  - Both indices wrap around when reaching capacity                       │
+ * │  - Both indices run freely and are masked (capacity is a power of 2)     │
  * │                                                                          │
  * │  Complexity: O(1) for enqueue/dequeue, O(n) for remove                   │
  * └───────────────────────────────────────────────────────────────────────────┘
  *
+ * The ring is generated by DEFINE_RING for task_t pointers with inline
+ * storage of RR_QUEUE_SLOTS entries, one ring per CPU; rr_queue_init() only
+ * sets the limit.
+ *
  * ===========================================================================
  */
 
 #include "../dsa_structures.h"
-#include "../../memory/memory.h"
+#include <lib/dsa/typed_ring.h>
 
 /* ---------------------------------------------------------------------------
  * Round-Robin Queue Structure
  * --------------------------------------------------------------------------- */
-typedef struct rr_queue {
-    task_t **buffer;        /* Array of task pointers */
-    size_t capacity;        /* Maximum number of tasks */
-    size_t size;            /* Current number of tasks */
-    size_t head;            /* Index of front element */
-    size_t tail;            /* Index of next free slot */
-} rr_queue_t;
 
-/* Static instance of the round-robin queue */
-static rr_queue_t run_queue = {
-    .buffer = NULL,
-    .capacity = 0,
-    .size = 0,
-    .head = 0,
-    .tail = 0
-};
+#define RR_QUEUE_SLOTS  64          /* Power of two */
+
+_Static_assert(RR_QUEUE_SLOTS >= MAX_TASKS, "RR_QUEUE_SLOTS must hold MAX_TASKS");
+
+DEFINE_RING(rr_ring, task_t *, RR_QUEUE_SLOTS)
+
+/* One round-robin queue per CPU */
+static rr_ring_t run_queues[SMP_MAX_CPUS];
+
+/* Tasks allowed in each queue (0 = not initialized) */
+static size_t run_queue_capacity = 0;
 
 /* ---------------------------------------------------------------------------
  * Initialization and Cleanup
@@ -62,38 +62,18 @@ static rr_queue_t run_queue = {
 
 /**
  * @brief Initialize the round-robin queue
- * 
- * Allocates the internal buffer for storing task pointers.
  */
 bool rr_queue_init(size_t capacity)
 {
     /* Validate capacity */
-    if (capacity == 0) {
+    if (capacity == 0 || capacity > RR_QUEUE_SLOTS) {
         return false;
     }
 
-    /* Clean up any existing queue */
-    if (run_queue.buffer != NULL) {
-        rr_queue_destroy();
-    }
-
-    /* Allocate buffer */
-    run_queue.buffer = (task_t **)kmalloc(capacity * sizeof(task_t *));
-    if (run_queue.buffer == NULL) {
-        return false;  /* Out of memory */
-    }
-
-    /* Initialize all slots to NULL */
-    for (size_t i = 0; i < capacity; i++) {
-        run_queue.buffer[i] = NULL;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        rr_ring_init(&run_queues[cpu]);
     }
-
-    /* Initialize queue state */
-    run_queue.capacity = capacity;
-    run_queue.size = 0;
-    run_queue.head = 0;
-    run_queue.tail = 0;
-
+    run_queue_capacity = capacity;
     return true;
 }
 
@@ -102,14 +82,10 @@ bool rr_queue_init(size_t capacity)
  */
 void rr_queue_destroy(void)
 {
-    if (run_queue.buffer != NULL) {
-        kfree(run_queue.buffer);
-        run_queue.buffer = NULL;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        rr_ring_init(&run_queues[cpu]);
     }
-    run_queue.capacity = 0;
-    run_queue.size = 0;
-    run_queue.head = 0;
-    run_queue.tail = 0;
+    run_queue_capacity = 0;
 }
 
 /* ---------------------------------------------------------------------------
@@ -121,28 +97,12 @@ void rr_queue_destroy(void)
  * 
  * Time Complexity: O(1)
  */
-bool rr_enqueue(task_t *task)
+bool rr_enqueue(uint32_t cpu, task_t *task)
 {
-    /* Validate parameters */
-    if (task == NULL || run_queue.buffer == NULL) {
-        return false;
-    }
-
-    /* Check if queue is full */
-    if (run_queue.size >= run_queue.capacity) {
+    if (task == NULL || rr_is_full(cpu)) {
         return false;
     }
-
-    /* Add task at tail position */
-    run_queue.buffer[run_queue.tail] = task;
-
-    /* Advance tail (wrap around if needed) */
-    run_queue.tail = (run_queue.tail + 1) % run_queue.capacity;
-
-    /* Increment size */
-    run_queue.size++;
-
-    return true;
+    return rr_ring_push(&run_queues[cpu], task);
 }
 
 /**
@@ -150,25 +110,10 @@ bool rr_enqueue(task_t *task)
  * 
  * Time Complexity: O(1)
  */
-task_t *rr_dequeue(void)
+task_t *rr_dequeue(uint32_t cpu)
 {
-    /* Check if queue is empty */
-    if (run_queue.buffer == NULL || run_queue.size == 0) {
-        return NULL;
-    }
-
-    /* Get task at head position */
-    task_t *task = run_queue.buffer[run_queue.head];
-
-    /* Clear the slot */
-    run_queue.buffer[run_queue.head] = NULL;
-
-    /* Advance head (wrap around if needed) */
-    run_queue.head = (run_queue.head + 1) % run_queue.capacity;
-
-    /* Decrement size */
-    run_queue.size--;
-
+    task_t *task = NULL;
+    rr_ring_pop(&run_queues[cpu], &task);
     return task;
 }
 
@@ -177,12 +122,10 @@ task_t *rr_dequeue(void)
  * 
  * Time Complexity: O(1)
  */
-task_t *rr_peek(void)
+task_t *rr_peek(uint32_t cpu)
 {
-    if (run_queue.buffer == NULL || run_queue.size == 0) {
-        return NULL;
-    }
-    return run_queue.buffer[run_queue.head];
+    task_t **front = rr_ring_front(&run_queues[cpu]);
+    return front != NULL ? *front : NULL;
 }
 
 /**
@@ -190,9 +133,9 @@ task_t *rr_peek(void)
  * 
  * Time Complexity: O(1)
  */
-bool rr_is_empty(void)
+bool rr_is_empty(uint32_t cpu)
 {
-    return (run_queue.buffer == NULL || run_queue.size == 0);
+    return rr_ring_empty(&run_queues[cpu]);
 }
 
 /**
@@ -200,9 +143,9 @@ bool rr_is_empty(void)
  * 
  * Time Complexity: O(1)
  */
-bool rr_is_full(void)
+bool rr_is_full(uint32_t cpu)
 {
-    return (run_queue.buffer != NULL && run_queue.size >= run_queue.capacity);
+    return rr_ring_count(&run_queues[cpu]) >= run_queue_capacity;
 }
 
 /**
@@ -210,71 +153,33 @@ bool rr_is_full(void)
  * 
  * Time Complexity: O(1)
  */
-size_t rr_count(void)
+size_t rr_count(uint32_t cpu)
 {
-    return run_queue.size;
+    return rr_ring_count(&run_queues[cpu]);
 }
 
 /**
  * @brief Remove a specific task from anywhere in the queue
  * 
  * This is needed when a task blocks or terminates and must be removed
- * from the ready queue regardless of its position.
+ * from the ready queue regardless of its position. The tasks behind it
+ * move up one place, keeping their FIFO order.
  * 
  * Time Complexity: O(n) where n is the number of tasks in queue
  */
-bool rr_remove(task_t *task)
+bool rr_remove(uint32_t cpu, task_t *task)
 {
-    /* Validate parameters */
-    if (task == NULL || run_queue.buffer == NULL || run_queue.size == 0) {
+    if (task == NULL) {
         return false;
     }
 
-    /*
-     * Search for the task in the queue.
-     * We need to iterate from head to tail, accounting for wrap-around.
-     */
-    size_t current = run_queue.head;
-    size_t found_index = run_queue.capacity;  /* Invalid index = not found */
-
-    for (size_t i = 0; i < run_queue.size; i++) {
-        if (run_queue.buffer[current] == task) {
-            found_index = current;
-            break;
+    rr_ring_t *queue = &run_queues[cpu];
+    uint32_t count = rr_ring_count(queue);
+    for (uint32_t i = 0; i < count; i++) {
+        if (*rr_ring_at(queue, i) == task) {
+            rr_ring_remove_at(queue, i);
+            return true;
         }
-        current = (current + 1) % run_queue.capacity;
     }
-
-    /* If not found, return false */
-    if (found_index == run_queue.capacity) {
-        return false;
-    }
-
-    /*
-     * Shift all elements after the found position one position backward.
-     * This maintains the FIFO order of the queue.
-     */
-    size_t i = found_index;
-    size_t next = (i + 1) % run_queue.capacity;
-    
-    while (next != run_queue.tail) {
-        run_queue.buffer[i] = run_queue.buffer[next];
-        i = next;
-        next = (next + 1) % run_queue.capacity;
-    }
-
-    /* Clear the last position and update tail */
-    run_queue.buffer[i] = NULL;
-    
-    /* Move tail back one position */
-    if (run_queue.tail == 0) {
-        run_queue.tail = run_queue.capacity - 1;
-    } else {
-        run_queue.tail--;
-    }
-
-    /* Decrement size */
-    run_queue.size--;
-
-    return true;
+    return false;
 }
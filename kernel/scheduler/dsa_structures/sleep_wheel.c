@@ -0,0 +1,253 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/dsa_structures/sleep_wheel.c
+ * ===========================================================================
+ *
+ * Sleep Queue Implementation (Hierarchical Timer Wheel)
+ *
+ * Sleeping tasks are kept in a hierarchical timer wheel keyed by their
+ * sleep_until tick, so the timer interrupt only touches the slot for the
+ * current tick instead of scanning the whole task table.
+ *
+ * Data Structure: Hierarchical Timer Wheel
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │  SLEEP_WHEEL_LEVELS wheels of 64 slots each. A slot on level n covers    │
+ * │  64^n ticks, so the wheels together span 2^30 ticks.                     │
+ * │                                                                          │
+ * │  Level 0:  [0][1][2] ... [63]     1 tick per slot                        │
+ * │  Level 1:  [0][1][2] ... [63]    64 ticks per slot                       │
+ * │  Level 2:  [0][1][2] ... [63]  4096 ticks per slot                       │
+ * │  ...                                                                     │
+ * │                                                                          │
+ * │  A task is filed on the lowest level whose range covers its remaining   │
+ * │  sleep time. Every time level n wraps around to slot 0, the next slot   │
+ * │  of level n+1 is emptied and its tasks are re-filed one level lower     │
+ * │  ("cascade"). Level 0 slots hold only tasks due on exactly that tick.   │
+ * │                                                                          │
+ * │  Operations:                                                             │
+ * │  - Insert: Pick level and slot, push onto slot list   O(1)               │
+ * │  - Remove: Unlink from slot list                      O(1)               │
+ * │  - Tick:   Expire one level-0 slot, cascade on wrap   O(1) amortized     │
+ * │            (a task cascades at most once per level)                      │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * Tick values wrap at 2^32; all comparisons use signed differences. Sleeps
+ * longer than the wheel span are parked in the top level and re-filed each
+ * time they cascade until they fall within range.
+ *
+ * Thread Safety:
+ *   Callers must hold the scheduler lock with interrupts disabled; the
+ *   timer bottom half and every wakeup already do.
+ *
+ * ===========================================================================
+ */
+
+#include "../dsa_structures.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+#define WHEEL_BITS      6
+#define WHEEL_SLOTS     (1U << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+
+/* Longest delta the wheels can represent directly */
+#define WHEEL_MAX_DELTA ((1U << (WHEEL_BITS * SLEEP_WHEEL_LEVELS)) - 1)
+
+/* ---------------------------------------------------------------------------
+ * Sleep Wheel Structure
+ * --------------------------------------------------------------------------- */
+typedef struct sleep_wheel {
+    list_t slots[SLEEP_WHEEL_LEVELS * WHEEL_SLOTS];
+    uint32_t clock;         /* Next tick to be processed */
+    size_t count;           /* Tasks currently on the wheel */
+} sleep_wheel_t;
+
+/* Static instance of the sleep wheel */
+static sleep_wheel_t wheel;
+
+/* ---------------------------------------------------------------------------
+ * Internal Helper Functions
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Slot index of a tick on a given level
+ */
+static inline uint32_t wheel_index(uint32_t tick, uint32_t level)
+{
+    return (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+}
+
+/**
+ * @brief File a task into the slot matching its remaining sleep time
+ */
+static void wheel_place(task_t *task)
+{
+    uint32_t expires = task->sleep_until;
+    uint32_t delta = expires - wheel.clock;
+    uint32_t level = 0;
+
+    if ((int32_t)delta < 0) {
+        /* Already due: expire on the next processed tick */
+        expires = wheel.clock;
+        delta = 0;
+    } else if (delta > WHEEL_MAX_DELTA) {
+        /* Beyond the wheel span: park at the far end and re-file later */
+        expires = wheel.clock + WHEEL_MAX_DELTA;
+        delta = WHEEL_MAX_DELTA;
+    }
+
+    while (level + 1 < SLEEP_WHEEL_LEVELS &&
+           delta >= (1U << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    uint16_t slot = (uint16_t)(level * WHEEL_SLOTS + wheel_index(expires, level));
+    task->sleep_slot = (int16_t)slot;
+    list_push_back(&wheel.slots[slot], &task->sleep_node);
+}
+
+/**
+ * @brief Empty one slot of a higher level back into the lower levels
+ *
+ * @return Index of the slot that was cascaded (0 means the level wrapped)
+ */
+static uint32_t wheel_cascade(uint32_t level)
+{
+    uint32_t index = wheel_index(wheel.clock, level);
+    list_t *slot = &wheel.slots[level * WHEEL_SLOTS + index];
+
+    list_node_t *node;
+    while ((node = list_pop_front(slot)) != NULL) {
+        wheel_place(list_entry(node, task_t, sleep_node));
+    }
+
+    return index;
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API Implementation
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize the sleep wheel
+ */
+void sleep_wheel_init(uint32_t now)
+{
+    for (uint32_t i = 0; i < SLEEP_WHEEL_LEVELS * WHEEL_SLOTS; i++) {
+        list_init(&wheel.slots[i]);
+    }
+    wheel.clock = now;
+    wheel.count = 0;
+}
+
+/**
+ * @brief Add a sleeping task to the wheel
+ *
+ * Time Complexity: O(1)
+ */
+bool sleep_wheel_insert(task_t *task)
+{
+    if (task == NULL || task->sleep_slot >= 0) {
+        return false;
+    }
+
+    wheel_place(task);
+    wheel.count++;
+    return true;
+}
+
+/**
+ * @brief Remove a task from the wheel before it expires
+ *
+ * Time Complexity: O(1)
+ */
+bool sleep_wheel_remove(task_t *task)
+{
+    if (task == NULL || task->sleep_slot < 0) {
+        return false;
+    }
+
+    list_remove(&wheel.slots[task->sleep_slot], &task->sleep_node);
+    task->sleep_slot = -1;
+    wheel.count--;
+    return true;
+}
+
+/**
+ * @brief Process every tick up to and including now
+ *
+ * Time Complexity: O(1) amortized per tick
+ */
+size_t sleep_wheel_advance(uint32_t now, void (*expire)(task_t *task))
+{
+    size_t woken = 0;
+
+    while ((int32_t)(now - wheel.clock) >= 0) {
+        if (wheel.count == 0) {
+            /* Nothing to expire: skip straight to the present */
+            wheel.clock = now + 1;
+            break;
+        }
+
+        /* On a level-0 wrap, pull the next batch down from above */
+        for (uint32_t level = 1;
+             level < SLEEP_WHEEL_LEVELS && wheel_index(wheel.clock, level - 1) == 0;
+             level++) {
+            if (wheel_cascade(level) != 0) {
+                break;
+            }
+        }
+
+        list_t *slot = &wheel.slots[wheel_index(wheel.clock, 0)];
+        list_node_t *node;
+        while ((node = list_pop_front(slot)) != NULL) {
+            task_t *task = list_entry(node, task_t, sleep_node);
+            task->sleep_slot = -1;
+            wheel.count--;
+            expire(task);
+            woken++;
+        }
+
+        wheel.clock++;
+    }
+
+    return woken;
+}
+
+/**
+ * @brief Ticks from now until the wheel next has work to do
+ *
+ * Scans level 0 forward from the next unprocessed tick. A level-0 wrap is
+ * reported as an event because it may cascade tasks due soon after it.
+ *
+ * Time Complexity: O(max_ticks), at most one level of slots
+ */
+uint32_t sleep_wheel_next_event(uint32_t now, uint32_t max_ticks)
+{
+    if (wheel.count == 0) {
+        return max_ticks;
+    }
+
+    for (uint32_t tick = wheel.clock;
+         (int32_t)(tick - now) < (int32_t)max_ticks; tick++) {
+        uint32_t index = wheel_index(tick, 0);
+        if (index == 0 || !list_is_empty(&wheel.slots[index])) {
+            int32_t delta = (int32_t)(tick - now);
+            return (delta > 0) ? (uint32_t)delta : 0;
+        }
+    }
+
+    return max_ticks;
+}
+
+/**
+ * @brief Get the number of tasks on the wheel
+ *
+ * Time Complexity: O(1)
+ */
+size_t sleep_wheel_count(void)
+{
+    return wheel.count;
+}
@@ -0,0 +1,361 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/process.c
+ * ===========================================================================
+ *
+ * User Processes: exec and fork
+ *
+ * A process is an ordinary task whose code runs in ring 3, inside the mmap
+ * window of its own address space. Traps from ring 3 switch to the task's
+ * kernel stack (TSS.ESP0, set on every context switch), so the stack only
+ * ever holds the kernel's frames and, at its very top, the ring 3 trap frame.
+ *
+ * exec:
+ *   Builds a complete new address space (ELF segments and a user stack)
+ *   before touching the old one, so a failed exec returns -1 to an intact
+ *   caller. It then drops the old address space and "returns" to ring 3
+ *   through a fresh trap frame at the top of the kernel stack.
+ *
+ * fork:
+ *   ┌──────────────────────────────────────────────────────────────────────┐
+ *   │ parent: address_space_clone()  page tables only, pages COW-shared    │
+ *   │         vfs_fd_table_clone()   same open files                       │
+ *   │ child:  trap frame copied to the top of its stack (EAX = 0)          │
+ *   │         first run: task_entry_wrapper -> fork_child_entry -> IRET    │
+ *   └──────────────────────────────────────────────────────────────────────┘
+ *   Pages are copied only when one side writes them (paging_handle_fault),
+ *   so a fork costs one page table copy instead of a copy of the image.
+ *
+ * ===========================================================================
+ */
+
+#include "task.h"
+#include "scheduler.h"
+#include "../memory/memory.h"
+#include "../interrupts/interrupts.h"
+#include "../fs/vfs.h"
+#include "../../config/os_config.h"
+
+/* ---------------------------------------------------------------------------
+ * External Function Declarations
+ * --------------------------------------------------------------------------- */
+
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+extern size_t strlen(const char *s);
+
+/* TSS.ESP0 / SYSENTER_ESP for the running task (kernel/syscall.c) */
+extern void syscall_set_kernel_stack(task_t *task);
+
+/* ---------------------------------------------------------------------------
+ * ELF Definitions (static i386 executables only)
+ * --------------------------------------------------------------------------- */
+#define ELF_MAGIC           0x464C457Fu     /* "\x7FELF" little-endian */
+#define ELF_CLASS_32        1
+#define ELF_DATA_LSB        1
+#define ELF_TYPE_EXEC       2
+#define ELF_MACHINE_386     3
+#define ELF_PT_LOAD         1
+#define ELF_PF_W            0x2
+#define ELF_MAX_PHDRS       16
+
+typedef struct elf32_ehdr {
+    uint32_t magic;
+    uint8_t elf_class;
+    uint8_t data;
+    uint8_t ident_version;
+    uint8_t ident_pad[9];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} elf32_ehdr_t;
+
+typedef struct elf32_phdr {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} elf32_phdr_t;
+
+/* Initial EFLAGS in ring 3: interrupts on (bit 1 is always set) */
+#define USER_EFLAGS         0x202
+
+/* Longest path process_spawn() copies for its task */
+#define SPAWN_PATH_MAX      256
+
+/* ---------------------------------------------------------------------------
+ * user_mode_enter - Load a trap frame and IRET to it (does not return)
+ * ---------------------------------------------------------------------------
+ * Same restore sequence as the ISR stubs, so the frame layout is
+ * interrupt_frame_t.
+ * --------------------------------------------------------------------------- */
+__asm__(
+    ".pushsection .text\n"
+    "user_mode_enter:\n"
+    "    movl 4(%esp), %esp\n"
+    "    popl %gs\n"
+    "    popl %fs\n"
+    "    popl %es\n"
+    "    popl %ds\n"
+    "    popal\n"
+    "    addl $8, %esp\n"                /* int_no, err_code */
+    "    iret\n"
+    ".popsection\n"
+);
+
+extern void user_mode_enter(interrupt_frame_t *frame) __attribute__((noreturn));
+
+/* Trap frame slot at the top of a task's kernel stack */
+static interrupt_frame_t *stack_top_frame(task_t *task)
+{
+    return (interrupt_frame_t *)((uint8_t *)task->stack_base + task->stack_size) - 1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Read exactly size bytes at offset
+ * --------------------------------------------------------------------------- */
+static bool read_exact(int fd, void *buffer, size_t size, size_t offset)
+{
+    return vfs_pread(fd, buffer, size, offset) == (ssize_t)size;
+}
+
+/* ---------------------------------------------------------------------------
+ * load_segment - Map one PT_LOAD segment and read its file bytes
+ * ---------------------------------------------------------------------------
+ * The pages are populated and zeroed by vm_area_map_anon, which also covers
+ * .bss. File bytes go straight into the frames through the kernel's
+ * identity map. The stack is left demand-zero.
+ * --------------------------------------------------------------------------- */
+static bool load_segment(int fd, address_space_t *as, const elf32_phdr_t *ph)
+{
+    uintptr_t end = (uintptr_t)ph->vaddr + ph->memsz;
+    if (ph->filesz > ph->memsz || ph->memsz == 0 || end < ph->vaddr ||
+        ph->vaddr < USER_MMAP_BASE || end > USER_STACK_TOP - USER_STACK_SIZE) {
+        return false;
+    }
+
+    uintptr_t start = ph->vaddr & ~(uintptr_t)(PAGE_SIZE - 1);
+    uint32_t flags = (ph->flags & ELF_PF_W) ? PAGE_WRITABLE : 0;
+    if (vm_area_map_anon(as, start, ALIGN_UP(end, PAGE_SIZE) - start,
+                         flags | VM_MAP_POPULATE) == 0) {
+        return false;  /* Overlaps another segment, or out of memory */
+    }
+
+    size_t done = 0;
+    while (done < ph->filesz) {
+        uintptr_t virt = ph->vaddr + done;
+        size_t chunk = PAGE_SIZE - (virt & (PAGE_SIZE - 1));
+        if (chunk > ph->filesz - done) {
+            chunk = ph->filesz - done;
+        }
+        void *dest = (void *)paging_translate(as, virt);
+        if (!read_exact(fd, dest, chunk, ph->offset + done)) {
+            return false;
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * load_elf - Load an executable into an address space
+ * --------------------------------------------------------------------------- */
+static bool load_elf(const char *path, address_space_t *as, uint32_t *entry)
+{
+    int fd = vfs_open(path);
+    if (fd < 0) {
+        return false;
+    }
+
+    elf32_ehdr_t eh;
+    bool ok = read_exact(fd, &eh, sizeof(eh), 0) &&
+              eh.magic == ELF_MAGIC && eh.elf_class == ELF_CLASS_32 &&
+              eh.data == ELF_DATA_LSB && eh.type == ELF_TYPE_EXEC &&
+              eh.machine == ELF_MACHINE_386 &&
+              eh.phentsize == sizeof(elf32_phdr_t) &&
+              eh.phnum > 0 && eh.phnum <= ELF_MAX_PHDRS &&
+              eh.entry >= USER_MMAP_BASE && eh.entry < USER_STACK_TOP;
+
+    bool loaded = false;
+    for (uint16_t i = 0; ok && i < eh.phnum; i++) {
+        elf32_phdr_t ph;
+        ok = read_exact(fd, &ph, sizeof(ph), eh.phoff + i * sizeof(ph));
+        if (ok && ph.type == ELF_PT_LOAD) {
+            ok = load_segment(fd, as, &ph);
+            loaded = true;
+        }
+    }
+
+    vfs_close(fd);
+    *entry = eh.entry;
+    return ok && loaded;
+}
+
+/* ---------------------------------------------------------------------------
+ * process_exec - Replace the running task's image with an executable
+ * --------------------------------------------------------------------------- */
+int process_exec(const char *path)
+{
+    task_t *task = task_current();
+    if (task == NULL || task->stack_base == NULL || path == NULL) {
+        return -1;
+    }
+
+    address_space_t *as = address_space_create();
+    if (as == NULL) {
+        return -1;  /* Paging is off */
+    }
+
+    uint32_t entry;
+    if (!load_elf(path, as, &entry) ||
+        vm_area_map_anon(as, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_SIZE,
+                         PAGE_WRITABLE) == 0) {
+        address_space_destroy(as);
+        return -1;
+    }
+
+    /* Point of no return: the old image (and anything path pointed into) goes */
+    address_space_t *old = task->address_space;
+    task->address_space = as;
+    paging_switch(as);
+    address_space_destroy(old);
+    task->flags = (task->flags & ~TASK_FLAG_KERNEL) | TASK_FLAG_USER;
+    syscall_set_kernel_stack(task);
+
+    /*
+     * The new trap frame goes where a trap from ring 3 would leave it. The
+     * code running now is deeper in the stack, and nothing above it is
+     * returned to again.
+     */
+    interrupt_frame_t *frame = stack_top_frame(task);
+    memset(frame, 0, sizeof(*frame));
+    frame->gs = USER_DATA_SELECTOR;
+    frame->fs = USER_DATA_SELECTOR;
+    frame->es = USER_DATA_SELECTOR;
+    frame->ds = USER_DATA_SELECTOR;
+    frame->eip = entry;
+    frame->cs = USER_CODE_SELECTOR;
+    frame->eflags = USER_EFLAGS;
+    frame->esp = USER_STACK_TOP - 16;      /* argc = 0, argv = envp = NULL */
+    frame->ss = USER_DATA_SELECTOR;
+    user_mode_enter(frame);
+}
+
+/* ---------------------------------------------------------------------------
+ * fork_child_entry - First run of a forked child
+ * ---------------------------------------------------------------------------
+ * arg is the copy of the parent's trap frame at the top of this stack.
+ * --------------------------------------------------------------------------- */
+static void fork_child_entry(void *arg)
+{
+    user_mode_enter((interrupt_frame_t *)arg);
+}
+
+/* ---------------------------------------------------------------------------
+ * process_fork - Duplicate the calling process
+ * --------------------------------------------------------------------------- */
+int32_t process_fork(interrupt_frame_t *frame)
+{
+    task_t *parent = task_current();
+
+    /*
+     * Only an INT 0x80 frame from ring 3 can be replayed in the child: a
+     * ring 0 task's stack holds pointers into itself, and a SYSENTER frame
+     * has no IRET state.
+     */
+    if (parent == NULL || frame->int_no != SYSCALL_VECTOR || (frame->cs & 3) != 3 ||
+        parent->address_space == NULL) {
+        return -1;
+    }
+
+    address_space_t *as = address_space_clone(parent->address_space);
+    if (as == NULL) {
+        return -1;
+    }
+    vfs_fd_table_t *files = vfs_fd_table_clone(parent->files);
+    if (parent->files != NULL && files == NULL) {
+        address_space_destroy(as);
+        return -1;
+    }
+
+    task_t *child = task_create(parent->name, fork_child_entry, NULL,
+                                parent->base_priority, parent->stack_size);
+    interrupt_frame_t *child_frame = (child != NULL)
+        ? task_reserve_stack_top(child, sizeof(interrupt_frame_t)) : NULL;
+    if (child_frame == NULL) {
+        if (child != NULL) {
+            task_set_state(child, TASK_STATE_ZOMBIE);
+            task_destroy(child);
+        }
+        vfs_fd_table_destroy(files);
+        address_space_destroy(as);
+        return -1;
+    }
+
+    memcpy(child_frame, frame, sizeof(*child_frame));
+    child_frame->eax = 0;                   /* fork() returns 0 in the child */
+
+    child->arg = child_frame;
+    child->address_space = as;
+    child->files = files;
+    child->flags = (child->flags & ~TASK_FLAG_KERNEL) | TASK_FLAG_USER;
+
+    scheduler_add_task(child);
+    return (int32_t)child->pid;
+}
+
+/* ---------------------------------------------------------------------------
+ * process_spawn - Start a new process running an executable
+ * --------------------------------------------------------------------------- */
+static void spawn_entry(void *arg)
+{
+    /* exec never returns on success, so the heap copy is dropped first */
+    char path[SPAWN_PATH_MAX];
+    memcpy(path, arg, strlen((const char *)arg) + 1);
+    kfree(arg);
+
+    process_exec(path);
+    task_exit(-1);
+}
+
+task_t *process_spawn(const char *path, uint8_t priority)
+{
+    size_t len = (path != NULL) ? strlen(path) : 0;
+    if (len == 0 || len >= SPAWN_PATH_MAX) {
+        return NULL;
+    }
+
+    char *copy = kmalloc(len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, path, len + 1);
+
+    /* Name the task after the file */
+    const char *name = path + len;
+    while (name > path && name[-1] != '/') {
+        name--;
+    }
+
+    task_t *task = task_create(name, spawn_entry, copy, priority, 0);
+    if (task == NULL) {
+        kfree(copy);
+        return NULL;
+    }
+    scheduler_add_task(task);
+    return task;
+}
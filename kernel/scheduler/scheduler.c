@@ -20,23 +20,80 @@
  *    - O(log n) scheduling decisions
  *    - Can cause starvation without aging
  *
+ * 3. Bitmap Multi-Level
+ *    - Same order as priority-based, FIFO among equal priorities
+ *    - O(1) scheduling decisions (bit scan of the non-empty level mask)
+ *
+ * 4. Fair-Share
+ *    - Runs the task with the least weighted virtual runtime
+ *    - Slices divide a target latency by weight, never below a minimum
+ *      granularity, so every runnable task runs once per period
+ *    - O(log n) scheduling decisions (red-black tree)
+ *
  * The scheduler is invoked:
  * - On timer interrupts (preemptive scheduling)
  * - When a task blocks, sleeps, or yields
  * - When a task terminates
  *
+ * Latency Accounting:
+ *   Every enqueue stamps the task with clock_cycles(). When schedule()
+ *   switches to it, the ready-to-running delay goes into a log2 histogram
+ *   (bucket i counts samples in [2^i, 2^(i+1)) ns) and into the task's own
+ *   last/max fields. The cost of task_switch_asm itself, measured from just
+ *   before the switch to the point where the next task resumes in schedule(),
+ *   goes into a second histogram.
+ *
+ * Per-CPU Run Queues:
+ *   Each CPU has its own instance of every policy's ready queue, and a
+ *   ready task sits on the queues of task->cpu, the CPU that last ran it.
+ *   schedule() takes from the local queue; a CPU with nothing queued, or
+ *   with at least two fewer tasks than the busiest CPU, first steals one
+ *   task from that CPU. Idle tasks are never queued: a CPU with nothing to
+ *   run or steal falls back to its own. Queueing a task sends a wakeup IPI
+ *   to a halted CPU, preferring the task's own, so idle APs pick it up
+ *   without waiting for their next tick.
+ *
  * Key Data Structures:
  * - Round-Robin Queue: Circular buffer of ready tasks
  * - Priority Queue: Min-heap of ready tasks by priority
+ * - Bitmap Queue: Per-priority FIFOs with a non-empty level mask
+ * - Fair Queue: Red-black tree of ready tasks by vruntime
+ * - Sleep Wheel: Hierarchical timer wheel of sleeping tasks
+ *
+ * Locking:
+ *   sched_lock (a spinlock, taken with interrupts disabled) protects every
+ *   run queue and is held across the context switch. The task that resumes
+ *   releases it in scheduler_finish_switch(), either at the end of
+ *   schedule() or, for a task running for the first time, from its entry
+ *   wrapper. The current and idle tasks are per-CPU (see smp.h).
+ *
+ *   schedule() may be called with the kernel lock held (spinlock.h). It
+ *   takes sched_lock first and only then drops the kernel lock, so a task
+ *   that marked itself blocked under the kernel lock cannot be woken and
+ *   picked by another CPU before its registers are saved. The resuming
+ *   task takes the kernel lock back at its own depth once sched_lock is
+ *   released.
+ *
+ *   Wakeups and the sleep wheel need only sched_lock. A task that marks
+ *   itself blocked under some other lock and drops it before schedule()
+ *   can be woken in between; the waker finds it still current on its CPU
+ *   and sets it back to RUNNING instead of queueing it, so its schedule()
+ *   call returns rather than sleeping through the wakeup, and no other CPU
+ *   can pick it up while its registers are live.
  *
  * ===========================================================================
  */
 
+#include "scheduler.h"
 #include "task.h"
 #include "dsa_structures.h"
+#include "spinlock.h"
+#include "smp.h"
 #include "../memory/memory.h"
 #include "../interrupts/interrupts.h"
 #include "../drivers/drivers.h"
+#include "../utils/trace.h"
+#include "../utils/perf.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions
@@ -49,6 +106,9 @@ extern void cpu_sti(void);              /* Enable interrupts */
 /* From context_switch.asm */
 extern void context_switch(uint32_t **old_sp, uint32_t *new_sp);
 extern void switch_to_task(task_t *new_task);
+
+/* From syscall.c: TSS/SYSENTER stack of the task being switched to */
+extern void syscall_set_kernel_stack(task_t *task);
 extern void task_switch_asm(task_t *old_task, task_t *new_task);
 
 /* From task.c */
@@ -60,11 +120,6 @@ extern bool task_system_is_initialized(void);
  * Scheduler Configuration
  * --------------------------------------------------------------------------- */
 
-/* Scheduling policy (from os_config.h or use default) */
-#ifndef SCHEDULER_POLICY
-#define SCHEDULER_POLICY    SCHED_POLICY_ROUND_ROBIN
-#endif
-
 /* Debug output (enable for scheduler debugging) */
 #ifndef DEBUG_SCHEDULER
 #define DEBUG_SCHEDULER     0
@@ -77,25 +132,72 @@ extern bool task_system_is_initialized(void);
 /* Scheduler state */
 static bool scheduler_initialized = false;
 static bool scheduler_running = false;
-static bool scheduling_in_progress = false;
+static uint32_t aps_running = 0;        /* APs that have joined the scheduler */
+
+/* Protects the run queues; held from pick to the end of the switch */
+static spinlock_t sched_lock = SPINLOCK_INIT;
 
 /* Scheduling policy in use */
 static uint8_t current_policy = SCHEDULER_POLICY;
 
 /* Idle task (runs when no other task is ready) */
-static task_t *idle_task = NULL;
+
+/* Fair policy tunables (ticks) */
+static uint32_t fair_latency = SCHEDULER_FAIR_LATENCY;
+static uint32_t fair_min_granularity = SCHEDULER_FAIR_MIN_GRANULARITY;
 
 /* Statistics */
 static uint32_t context_switch_count = 0;
 static uint32_t schedule_call_count = 0;
 static uint32_t idle_time = 0;
 
+/* Latency histograms (ns, log2 buckets) */
+static uint32_t wakeup_hist[SCHED_LAT_BUCKETS];
+static uint32_t switch_hist[SCHED_LAT_BUCKETS];
+static uint32_t wakeup_max_ns = 0;
+static uint32_t switch_max_ns = 0;
+
 /* ---------------------------------------------------------------------------
  * Forward Declarations
  * --------------------------------------------------------------------------- */
 void schedule(void);
 void scheduler_add_task(task_t *task);
+void scheduler_finish_switch(void);
 void scheduler_remove_task(task_t *task);
+void scheduler_requeue_task(task_t *task);
+uint32_t scheduler_ready_count(void);
+static uint32_t cpu_ready_count(uint32_t cpu);
+static task_t *pick_next_task(cpu_local_t *cpu);
+static void schedule_finish(uint32_t lock_depth);
+static void wake_task_locked(task_t *task);
+
+/* ---------------------------------------------------------------------------
+ * Latency Histograms
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Convert a TSC interval to ns, saturating at 32 bits
+ */
+static uint32_t cycles_to_ns32(uint64_t cycles)
+{
+    uint64_t ns = clock_cycles_to_ns(cycles);
+    return (ns >> 32) ? 0xFFFFFFFFU : (uint32_t)ns;
+}
+
+/**
+ * @brief Count a sample in a log2 histogram
+ */
+static void latency_record(uint32_t *hist, uint32_t *max_ns, uint32_t ns)
+{
+    uint32_t bucket = (ns == 0) ? 0 : 31 - (uint32_t)__builtin_clz(ns);
+    if (bucket >= SCHED_LAT_BUCKETS) {
+        bucket = SCHED_LAT_BUCKETS - 1;
+    }
+    hist[bucket]++;
+    if (ns > *max_ns) {
+        *max_ns = ns;
+    }
+}
 
 /* ---------------------------------------------------------------------------
  * Idle Task Implementation
@@ -110,27 +212,80 @@ void scheduler_remove_task(task_t *task);
  * This task runs at the lowest priority and simply halts the CPU
  * until an interrupt occurs. This saves power and allows the scheduler
  * to run when a higher-priority task becomes ready.
+ * 
+ * With SCHEDULER_TICKLESS_IDLE, when nothing is ready the periodic tick is
+ * replaced by a one-shot timer aimed at the next sleep-wheel event, so an
+ * idle system takes a fraction of the timer interrupts.
  */
 static void idle_task_entry(void *arg)
 {
     UNUSED(arg);
     
+    /* Idle tasks are never queued, so this one stays on its CPU */
+    bool bsp = (smp_cpu_id() == 0);
+    
     while (1) {
-        /*
-         * HLT instruction puts CPU in low-power state until next interrupt.
-         * Interrupts are enabled, so timer/keyboard/etc. will wake us.
-         */
         idle_time++;
-        __asm__ volatile("hlt");
+        
+        /* Finish deferred work left over from a long bottom-half batch */
+        softirq_run();
+        
+        /* Show console text still waiting for its newline (VGA is the BSP's) */
+        if (bsp) {
+            vga_flush();
+        }
+        
+        cpu_cli();
+        
+        if (softirq_has_pending()) {
+            cpu_sti();
+            continue;
+        }
+        
+        if (scheduler_ready_count() == 0) {
+            /*
+             * The BSP's timer drives the tick count, so only it goes
+             * tickless, and only alone: a task sleeping on an AP could file
+             * a deadline before the armed shot.
+             */
+            bool oneshot = false;
+            if (SCHEDULER_TICKLESS_IDLE && bsp && aps_running == 0) {
+                uint32_t ticks = sleep_wheel_next_event(pit_get_ticks(),
+                                                        pit_oneshot_max_ticks());
+                oneshot = pit_start_oneshot(ticks);
+            }
+            
+            /*
+             * HLT puts the CPU in a low-power state until the next
+             * interrupt. STI only takes effect after the following
+             * instruction, so no interrupt can slip in between the checks
+             * above and the halt.
+             */
+            __asm__ volatile("sti; hlt");
+            
+            if (oneshot) {
+                /* Woken by something else: credit the elapsed ticks */
+                cpu_cli();
+                pit_stop_oneshot();
+                cpu_sti();
+            }
+        } else {
+            cpu_sti();
+        }
+        
+        /* Run anything ready here or on another CPU's queue */
+        if (scheduler_ready_count() > 0) {
+            schedule();
+        }
     }
 }
 
 /**
- * @brief Create the idle task
+ * @brief Create a CPU's idle task
  */
-static bool create_idle_task(void)
+static bool create_idle_task(cpu_local_t *cpu)
 {
-    idle_task = task_create(
+    task_t *idle_task = task_create(
         "idle",                     /* Name */
         idle_task_entry,            /* Entry point */
         NULL,                       /* Argument */
@@ -144,10 +299,56 @@ static bool create_idle_task(void)
     
     /* Set idle task flags */
     idle_task->flags |= TASK_FLAG_IDLE;
+    idle_task->cpu = (uint8_t)cpu->id;
+    cpu->idle = idle_task;
     
     return true;
 }
 
+/* ---------------------------------------------------------------------------
+ * Fair-Share Helpers
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Compute a task's slice under the fair policy
+ * 
+ * The period is the target latency, stretched to min_granularity per
+ * runnable task when there are too many tasks to fit. Each task gets the
+ * share of the period matching its share of the total weight.
+ * 
+ * @param task Task about to run on task->cpu (not on the run queue)
+ * @return Slice in ticks
+ */
+static uint32_t fair_time_slice(task_t *task)
+{
+    uint32_t nr_running = (uint32_t)fq_count(task->cpu) + 1;
+    uint32_t period = fair_latency;
+    if (nr_running * fair_min_granularity > period) {
+        period = nr_running * fair_min_granularity;
+    }
+    
+    uint32_t weight = fq_task_weight(task);
+    uint32_t slice = period * weight / (fq_total_weight(task->cpu) + weight);
+    
+    return (slice < fair_min_granularity) ? fair_min_granularity : slice;
+}
+
+/**
+ * @brief Decide whether a newly runnable task should preempt the current one
+ * 
+ * Preempt when the woken task lags the running one by more than the
+ * minimum granularity, so short sleepers get the CPU back promptly.
+ */
+static bool fair_should_preempt(task_t *current, task_t *woken)
+{
+    if (current->flags & TASK_FLAG_IDLE) {
+        return true;
+    }
+    
+    uint64_t gran = (uint64_t)fair_min_granularity << FAIR_VRUNTIME_SHIFT;
+    return (int64_t)(current->vruntime - woken->vruntime) > (int64_t)gran;
+}
+
 /* ---------------------------------------------------------------------------
  * Timer Callback for Preemptive Scheduling
  * ---------------------------------------------------------------------------
@@ -155,11 +356,31 @@ static bool create_idle_task(void)
  * This implements time slicing for preemptive scheduling.
  * --------------------------------------------------------------------------- */
 
+/**
+ * @brief Timer bottom half (SOFTIRQ_TIMER)
+ * 
+ * Wakes sleeping tasks that are due; only their wheel slots are visited,
+ * and ticks missed while the pass was delayed are caught up in one go.
+ * Also flushes the VGA shadow buffer when it runs on the BSP.
+ */
+static void scheduler_timer_softirq(void)
+{
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    sleep_wheel_advance(pit_get_ticks(), wake_task_locked);
+    spin_unlock_irqrestore(&sched_lock, flags);
+    
+    /* Batched console output: at most one tick behind */
+    if (smp_cpu_id() == 0) {
+        vga_flush();
+    }
+}
+
 /**
  * @brief Timer tick callback
  * 
- * Called from interrupt context. Decrements current task's time slice
- * and triggers a reschedule if the time slice is exhausted.
+ * Called from interrupt context on every CPU that runs tasks. Decrements
+ * current task's time slice and triggers a reschedule if the time slice
+ * is exhausted.
  */
 static void scheduler_tick_handler(void)
 {
@@ -172,31 +393,44 @@ static void scheduler_tick_handler(void)
     /* Increment CPU time for current task */
     current->cpu_time++;
     
+    /* Fair policy: charge the weighted tick to the task's vruntime */
+    if (current_policy == SCHED_POLICY_FAIR &&
+        !(current->flags & TASK_FLAG_IDLE)) {
+        spin_lock(&sched_lock);
+        fq_charge(current->cpu, current, 1);
+        spin_unlock(&sched_lock);
+    }
+    
     /* Decrement time slice */
     if (current->time_slice > 0) {
         current->time_slice--;
     }
     
-    /* Check sleeping tasks and wake them if needed */
-    uint32_t current_tick = pit_get_ticks();
-    for (uint32_t i = 0; i < MAX_TASKS; i++) {
-        task_t *task = task_get_by_index(i);
-        if (task != NULL && task->state == TASK_STATE_SLEEPING) {
-            if (current_tick >= task->sleep_until) {
-                task_wakeup(task);
-            }
-        }
+    /* Sleep wheel expiry runs in the SOFTIRQ_TIMER bottom half (BSP tick) */
+    if (smp_cpu_id() == 0) {
+        softirq_raise(SOFTIRQ_TIMER);
     }
     
-    /* Check if preemption is needed */
+    /*
+     * Check if preemption is needed. A tick that lands inside a bottom-half
+     * pass leaves the slice at zero; the next tick preempts instead, so the
+     * pass is not suspended behind another task.
+     */
     if (current->time_slice == 0 && 
-        (current->flags & TASK_FLAG_PREEMPTIBLE)) {
+        (current->flags & TASK_FLAG_PREEMPTIBLE) &&
+        !softirq_in_progress()) {
         /*
          * Time slice exhausted. Set time slice for next round and reschedule.
          * Note: We don't call schedule() directly from interrupt context.
          * Instead, we rely on the scheduler being called after the interrupt.
          */
-        current->time_slice = SCHEDULER_TIME_SLICE;
+        if (current_policy == SCHED_POLICY_FAIR) {
+            spin_lock(&sched_lock);
+            current->time_slice = fair_time_slice(current);
+            spin_unlock(&sched_lock);
+        } else {
+            current->time_slice = SCHEDULER_TIME_SLICE;
+        }
         
         /* In preemptive mode, we schedule from the timer interrupt */
         if (SCHEDULER_PREEMPTIVE) {
@@ -230,6 +464,9 @@ bool scheduler_init(void)
         }
     }
     
+    /* Bring up the other CPUs and their per-CPU slots */
+    smp_init();
+    
     /* Initialize the round-robin queue */
     if (!rr_queue_init(MAX_TASKS)) {
         return false;
@@ -241,15 +478,25 @@ bool scheduler_init(void)
         return false;
     }
     
-    /* Create the idle task */
-    if (!create_idle_task()) {
-        pq_destroy();
-        rr_queue_destroy();
-        return false;
+    /* Initialize the bitmap and fair queues (static storage, cannot fail) */
+    bq_init();
+    fq_init(fair_latency);
+    
+    /* Sleeping tasks are filed from the current tick onwards */
+    sleep_wheel_init(pit_get_ticks());
+    
+    /* Create an idle task for every CPU that came up */
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_local_t *cpu = smp_get_cpu(i);
+        if (cpu->online && !create_idle_task(cpu)) {
+            pq_destroy();
+            rr_queue_destroy();
+            return false;
+        }
     }
     
-    /* Add idle task to the appropriate queue based on policy */
-    scheduler_add_task(idle_task);
+    /* Start the deferred-work worker (non-fatal: queueing just fails) */
+    workqueue_init();
     
     /* Reset statistics */
     context_switch_count = 0;
@@ -257,6 +504,7 @@ bool scheduler_init(void)
     idle_time = 0;
     
     /* Register timer callback for preemptive scheduling */
+    softirq_register(SOFTIRQ_TIMER, scheduler_timer_softirq);
     pit_register_callback(scheduler_tick_handler);
     
     scheduler_initialized = true;
@@ -275,27 +523,25 @@ void scheduler_start(void)
         PANIC("Scheduler not initialized");
     }
     
-    /* Find the first task to run */
-    task_t *first_task = NULL;
-    
-    if (current_policy == SCHED_POLICY_PRIORITY) {
-        first_task = pq_peek();
-    } else {
-        first_task = rr_peek();
-    }
+    /*
+     * Take the first task off the queue under sched_lock, as schedule()
+     * would. The task's entry wrapper drops the lock and enables
+     * interrupts; in_scheduler keeps a tick before that from rescheduling.
+     */
+    cpu_cli();
+    spin_lock(&sched_lock);
+    cpu_local_t *cpu = smp_this_cpu();
+    cpu->in_scheduler = true;
     
-    if (first_task == NULL) {
-        first_task = idle_task;
-    }
+    task_t *first_task = pick_next_task(cpu);
     
     /* Mark scheduler as running */
     scheduler_running = true;
     
     /* Set first task as current and switch to it */
     first_task->state = TASK_STATE_RUNNING;
-    
-    /* Enable interrupts before switching to first task */
-    cpu_sti();
+    first_task->cpu = (uint8_t)cpu->id;
+    first_task->ready_stamp = 0;
     
     /* Switch to the first task (never returns) */
     switch_to_task(first_task);
@@ -304,6 +550,42 @@ void scheduler_start(void)
     PANIC("scheduler_start returned unexpectedly");
 }
 
+/**
+ * @brief Run tasks on the calling application processor
+ * 
+ * Waits for scheduler_start() on the BSP, then starts this CPU's tick and
+ * switches to its idle task, whose loop steals work from the other CPUs.
+ * Does not return unless the CPU has no idle task or no tick of its own.
+ */
+void scheduler_ap_start(void)
+{
+    while (!__atomic_load_n(&scheduler_running, __ATOMIC_ACQUIRE)) {
+        __asm__ volatile("pause");
+    }
+    
+    cpu_cli();
+    cpu_local_t *cpu = smp_this_cpu();
+    task_t *idle = cpu->idle;
+    if (idle == NULL || !pit_uses_lapic_timer()) {
+        return;
+    }
+    
+    /* As scheduler_start(): the idle task's entry wrapper drops the lock */
+    spin_lock(&sched_lock);
+    cpu->in_scheduler = true;
+    idle->state = TASK_STATE_RUNNING;
+    __atomic_add_fetch(&aps_running, 1, __ATOMIC_RELAXED);
+    
+    task_fpu_switch(idle);
+    syscall_set_kernel_stack(idle);
+    pit_start_cpu_tick();
+    
+    /* Switch to the idle task (never returns) */
+    switch_to_task(idle);
+    
+    PANIC("scheduler_ap_start returned unexpectedly");
+}
+
 /**
  * @brief Stop the scheduler
  */
@@ -318,27 +600,96 @@ void scheduler_stop(void)
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Add a task to the scheduler's ready queue
+ * @brief Wake a halted CPU that can run a newly queued task (sched_lock held)
+ * 
+ * Tries the task's own CPU first; any other CPU in its idle task can steal
+ * the task. Nothing is sent when the calling CPU is idle itself, since it
+ * checks the queues again on its way out of the interrupt.
+ * 
+ * @param home CPU whose queue the task went on
+ */
+static void kick_idle_cpu(uint32_t home)
+{
+    if (aps_running == 0) {
+        return;
+    }
+    
+    uint32_t self = smp_cpu_id();
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        uint32_t id = (home + i) % SMP_MAX_CPUS;
+        cpu_local_t *cpu = smp_get_cpu(id);
+        if (!cpu->online || cpu->idle == NULL || cpu->current != cpu->idle) {
+            continue;
+        }
+        if (id != self) {
+            smp_wakeup_cpu(id);
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Put a task on task->cpu's ready queue (sched_lock held)
  * 
  * @param task Task to add
  */
-void scheduler_add_task(task_t *task)
+static void enqueue_task(task_t *task)
 {
-    if (task == NULL) {
+    /* Idle tasks only run when their CPU finds nothing else */
+    if (task->flags & TASK_FLAG_IDLE) {
         return;
     }
     
+    /* Start the wakeup-to-run latency measurement */
+    task->ready_stamp = clock_cycles();
+    
     /* Add to appropriate queue based on policy */
+    uint32_t cpu = task->cpu;
     switch (current_policy) {
         case SCHED_POLICY_PRIORITY:
-            pq_enqueue(task);
+            pq_enqueue(cpu, task);
+            break;
+            
+        case SCHED_POLICY_BITMAP:
+            bq_enqueue(cpu, task);
             break;
             
+        case SCHED_POLICY_FAIR: {
+            fq_enqueue(cpu, task);
+            
+            /* Wakeup preemption: cut that CPU's running task's slice short */
+            task_t *current = smp_get_cpu(cpu)->current;
+            if (current != NULL && current != task &&
+                current->state == TASK_STATE_RUNNING &&
+                fair_should_preempt(current, task)) {
+                current->time_slice = 0;
+            }
+            break;
+        }
+            
         case SCHED_POLICY_ROUND_ROBIN:
         default:
-            rr_enqueue(task);
+            rr_enqueue(cpu, task);
             break;
     }
+    
+    kick_idle_cpu(cpu);
+}
+
+/**
+ * @brief Add a task to the scheduler's ready queue
+ * 
+ * @param task Task to add
+ */
+void scheduler_add_task(task_t *task)
+{
+    if (task == NULL) {
+        return;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    enqueue_task(task);
+    spin_unlock_irqrestore(&sched_lock, flags);
 }
 
 /**
@@ -352,42 +703,224 @@ void scheduler_remove_task(task_t *task)
         return;
     }
     
-    /* Remove from both queues (task might be in either) */
-    rr_remove(task);
-    pq_remove(task);
+    /* Remove from every queue of its CPU (task might be in any of them) */
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    rr_remove(task->cpu, task);
+    pq_remove(task->cpu, task);
+    bq_remove(task->cpu, task);
+    fq_remove(task->cpu, task);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief Reposition a queued task after its priority changed
+ * 
+ * @param task Task whose priority was modified
+ */
+void scheduler_requeue_task(task_t *task)
+{
+    if (task == NULL) {
+        return;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    if (task->state != TASK_STATE_READY) {
+        spin_unlock_irqrestore(&sched_lock, flags);
+        return;
+    }
+    
+    switch (current_policy) {
+        case SCHED_POLICY_PRIORITY:
+            pq_update(task->cpu, task);
+            break;
+            
+        case SCHED_POLICY_BITMAP:
+            bq_update(task->cpu, task);
+            break;
+            
+        case SCHED_POLICY_FAIR:
+            /* Re-insert so the new weight is accounted for */
+            if (fq_remove(task->cpu, task)) {
+                fq_enqueue(task->cpu, task);
+            }
+            break;
+            
+        case SCHED_POLICY_ROUND_ROBIN:
+        default:
+            /* Round-robin ignores priority */
+            break;
+    }
+    spin_unlock_irqrestore(&sched_lock, flags);
 }
 
 /* ---------------------------------------------------------------------------
- * Main Scheduling Function
+ * Wakeups and Timeouts
+ * ---------------------------------------------------------------------------
+ * The sleep wheel is covered by sched_lock, so neither waking a task nor
+ * filing its timeout takes the kernel lock.
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Pick the next task to run
+ * @brief Make a sleeping or blocked task runnable (sched_lock held)
  * 
- * Selects the next task based on the current scheduling policy.
+ * A task that is still its CPU's current one has not switched out yet:
+ * it goes back to RUNNING rather than onto a queue (see Locking above).
+ */
+static void wake_task_locked(task_t *task)
+{
+    if (task->state != TASK_STATE_SLEEPING && task->state != TASK_STATE_BLOCKED) {
+        return;
+    }
+    
+    /* Woken early: drop the pending timeout */
+    sleep_wheel_remove(task);
+    task->sleep_until = 0;
+    
+    if (smp_get_cpu(task->cpu)->current == task) {
+        task->state = TASK_STATE_RUNNING;
+        return;
+    }
+    
+    task->state = TASK_STATE_READY;
+    enqueue_task(task);
+}
+
+/**
+ * @brief Wake a sleeping or blocked task
  * 
- * @return Pointer to next task, or idle_task if no tasks are ready
+ * @param task Task to wake (no-op in any other state)
  */
-static task_t *pick_next_task(void)
+void scheduler_wake_task(task_t *task)
 {
-    task_t *next = NULL;
+    if (task == NULL) {
+        return;
+    }
     
-    switch (current_policy) {
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    wake_task_locked(task);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief File a task's timeout on the sleep wheel
+ * 
+ * @param task Task whose sleep_until is set; it should already be marked
+ *             SLEEPING or BLOCKED, so an early expiry is not lost
+ */
+void scheduler_timeout_add(task_t *task)
+{
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    sleep_wheel_insert(task);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief Take a task's timeout off the sleep wheel (no-op if none)
+ */
+void scheduler_timeout_cancel(task_t *task)
+{
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    sleep_wheel_remove(task);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Main Scheduling Function
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Take the next task from a policy's ready queue
+ * 
+ * @param policy Policy whose queue to dequeue from
+ * @param cpu    CPU whose queue to dequeue from
+ * @return Pointer to the task, or NULL if that queue is empty
+ */
+static task_t *dequeue_task(uint8_t policy, uint32_t cpu)
+{
+    switch (policy) {
         case SCHED_POLICY_PRIORITY:
             /* Get highest-priority task */
-            next = pq_dequeue();
-            break;
+            return pq_dequeue(cpu);
+            
+        case SCHED_POLICY_BITMAP:
+            /* Get first task of the highest non-empty level */
+            return bq_dequeue(cpu);
+            
+        case SCHED_POLICY_FAIR:
+            /* Get the task with the least virtual runtime */
+            return fq_dequeue(cpu);
             
         case SCHED_POLICY_ROUND_ROBIN:
         default:
             /* Get next task in FIFO order */
-            next = rr_dequeue();
-            break;
+            return rr_dequeue(cpu);
+    }
+}
+
+/**
+ * @brief Take a task from the busiest other CPU (sched_lock held)
+ * 
+ * Steals when this CPU has nothing queued, or when the busiest CPU has at
+ * least two more tasks waiting, so a task does not bounce between CPUs
+ * whose queues differ by one. Under the fair policy the task keeps its
+ * lag: its vruntime moves from the source queue's floor to this one's.
+ * 
+ * @param cpu CPU looking for work
+ * @return Stolen task, now owned by cpu, or NULL
+ */
+static task_t *steal_task(cpu_local_t *cpu)
+{
+    uint32_t local = cpu_ready_count(cpu->id);
+    uint32_t busiest = cpu->id;
+    uint32_t most = 0;
+    
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if (i == cpu->id || !smp_get_cpu(i)->online) {
+            continue;
+        }
+        uint32_t count = cpu_ready_count(i);
+        if (count > most) {
+            most = count;
+            busiest = i;
+        }
+    }
+    
+    if (most == 0 || (local != 0 && most <= local + 1)) {
+        return NULL;
+    }
+    
+    task_t *task = dequeue_task(current_policy, busiest);
+    if (task == NULL) {
+        return NULL;
+    }
+    
+    if (current_policy == SCHED_POLICY_FAIR) {
+        task->vruntime = task->vruntime - fq_min_vruntime(busiest) +
+                         fq_min_vruntime(cpu->id);
+    }
+    task->cpu = (uint8_t)cpu->id;
+    return task;
+}
+
+/**
+ * @brief Pick the next task to run on a CPU (sched_lock held)
+ * 
+ * Takes a stolen task if the queues are out of balance, otherwise the
+ * local queue's next task under the current policy.
+ * 
+ * @return Pointer to next task, or the CPU's idle task if none is ready
+ */
+static task_t *pick_next_task(cpu_local_t *cpu)
+{
+    task_t *next = steal_task(cpu);
+    
+    if (next == NULL) {
+        next = dequeue_task(current_policy, cpu->id);
     }
     
     /* If no task is ready, use the idle task */
     if (next == NULL) {
-        next = idle_task;
+        next = cpu->idle;
     }
     
     return next;
@@ -401,24 +934,29 @@ static task_t *pick_next_task(void)
  */
 void schedule(void)
 {
-    /* Prevent recursive scheduling */
-    if (scheduling_in_progress) {
+    /* Check if scheduler is running */
+    if (!scheduler_running || !scheduler_initialized) {
         return;
     }
     
-    /* Check if scheduler is running */
-    if (!scheduler_running || !scheduler_initialized) {
+    /* Disable interrupts during scheduling */
+    uint32_t flags = interrupts_save_and_disable();
+    
+    /* Prevent recursive scheduling on this CPU */
+    cpu_local_t *cpu = smp_this_cpu();
+    if (cpu->in_scheduler) {
+        interrupts_restore(flags);
         return;
     }
     
-    scheduling_in_progress = true;
+    /* Under the caller's kernel lock, if any: see Locking above */
+    spin_lock(&sched_lock);
+    cpu->in_scheduler = true;
     schedule_call_count++;
     
-    /* Disable interrupts during scheduling */
-    cpu_cli();
-    
     task_t *current = task_current();
     task_t *next = NULL;
+    TRACE(TRACE_SCHEDULE, current ? current->pid : 0, scheduler_ready_count());
     
     /* Handle current task */
     if (current != NULL && current->state == TASK_STATE_RUNNING) {
@@ -427,45 +965,111 @@ void schedule(void)
          * Put it back in the ready queue.
          */
         current->state = TASK_STATE_READY;
-        scheduler_add_task(current);
+        enqueue_task(current);
     }
     
     /* Pick the next task to run */
-    next = pick_next_task();
+    next = pick_next_task(cpu);
+    
+    /* Wakers now wait on sched_lock until the switch is done */
+    uint32_t lock_depth = kernel_lock_release();
     
     /* If same task, just return */
     if (next == current) {
         if (current != NULL) {
             current->state = TASK_STATE_RUNNING;
+            current->ready_stamp = 0;
         }
-        scheduling_in_progress = false;
-        cpu_sti();
+        schedule_finish(lock_depth);
         return;
     }
     
     /* Update statistics */
     context_switch_count++;
+    cpu->context_switches++;
+    
+    /* Record how long next waited between becoming ready and running */
+    uint64_t now = clock_cycles();
+    if (next->ready_stamp != 0) {
+        uint32_t latency = cycles_to_ns32(now - next->ready_stamp);
+        latency_record(wakeup_hist, &wakeup_max_ns, latency);
+        next->latency_last_ns = latency;
+        if (latency > next->latency_max_ns) {
+            next->latency_max_ns = latency;
+        }
+        next->ready_stamp = 0;
+    }
+    next->run_count++;
     
     /* Set next task as running */
     next->state = TASK_STATE_RUNNING;
+    next->cpu = (uint8_t)cpu->id;
     
     /* Reset time slice for next task if needed */
-    if (next->time_slice == 0) {
+    if (current_policy == SCHED_POLICY_FAIR) {
+        next->time_slice = fair_time_slice(next);
+    } else if (next->time_slice == 0) {
         next->time_slice = SCHEDULER_TIME_SLICE;
     }
     
     /* Perform the context switch */
     if (current != NULL) {
         /* Save current context, switch to next */
+        task_fpu_switch(next);
+        paging_switch(next->address_space);
+        syscall_set_kernel_stack(next);
+        TRACE(TRACE_SWITCH, current->pid, next->pid);
+        PERF_SWITCH(current);
+        cpu->switch_start = clock_cycles();
         task_switch_asm(current, next);
+        
+        /* Back in this task, possibly on another CPU: charge the switch */
+        cpu = smp_this_cpu();
+        if (cpu->switch_start != 0) {
+            latency_record(switch_hist, &switch_max_ns,
+                           cycles_to_ns32(clock_cycles() - cpu->switch_start));
+            cpu->switch_start = 0;
+        }
     } else {
         /* No current task (first switch), just load next */
+        task_fpu_switch(next);
+        paging_switch(next->address_space);
+        syscall_set_kernel_stack(next);
+        TRACE(TRACE_SWITCH, 0, next->pid);
+        PERF_SWITCH(NULL);
         switch_to_task(next);
     }
     
     /* Execution continues here when this task is scheduled again */
-    scheduling_in_progress = false;
-    cpu_sti();
+    schedule_finish(lock_depth);
+}
+
+/**
+ * @brief Drop sched_lock and retake the kernel lock levels this task held
+ * 
+ * Interrupts stay disabled while the task holds the kernel lock; its
+ * caller restores them along with its last level.
+ */
+static void schedule_finish(uint32_t lock_depth)
+{
+    smp_this_cpu()->in_scheduler = false;
+    spin_unlock(&sched_lock);
+    kernel_lock_reacquire(lock_depth);
+    if (lock_depth == 0) {
+        cpu_sti();
+    }
+}
+
+/**
+ * @brief Complete a context switch in the task that now runs
+ * 
+ * Drops sched_lock and enables interrupts. Called by a new task's entry
+ * wrapper, which never returns through schedule(); a new task starts
+ * without the kernel lock.
+ */
+void scheduler_finish_switch(void)
+{
+    schedule_finish(0);
 }
 
 /* ---------------------------------------------------------------------------
@@ -509,23 +1113,88 @@ uint8_t scheduler_get_policy(void)
  */
 void scheduler_set_policy(uint8_t policy)
 {
-    if (policy <= SCHED_POLICY_MLFQ) {
-        current_policy = policy;
+    if (policy > SCHED_POLICY_FAIR || policy == current_policy) {
+        return;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    
+    /* Carry the waiting tasks over to the new policy's queue */
+    uint8_t old_policy = current_policy;
+    current_policy = policy;
+    
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        task_t *task;
+        while ((task = dequeue_task(old_policy, cpu)) != NULL) {
+            enqueue_task(task);
+        }
+    }
+    
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief Set the fair policy's target latency and minimum granularity
+ * 
+ * @param latency         Period in which every runnable task runs (ticks)
+ * @param min_granularity Shortest slice handed out (ticks)
+ */
+void scheduler_set_fair_tunables(uint32_t latency, uint32_t min_granularity)
+{
+    if (latency == 0 || min_granularity == 0) {
+        return;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    fair_latency = latency;
+    fair_min_granularity = min_granularity;
+    fq_set_latency(latency);
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief Get the number of tasks on one CPU's ready queue
+ */
+static uint32_t cpu_ready_count(uint32_t cpu)
+{
+    switch (current_policy) {
+        case SCHED_POLICY_PRIORITY:
+            return pq_count(cpu);
+            
+        case SCHED_POLICY_BITMAP:
+            return bq_count(cpu);
+            
+        case SCHED_POLICY_FAIR:
+            return fq_count(cpu);
+            
+        case SCHED_POLICY_ROUND_ROBIN:
+        default:
+            return rr_count(cpu);
     }
 }
 
 /**
  * @brief Get the number of ready tasks
  * 
- * @return Number of tasks in ready queue
+ * @return Number of tasks in the ready queues of all CPUs
  */
 uint32_t scheduler_ready_count(void)
 {
-    if (current_policy == SCHED_POLICY_PRIORITY) {
-        return pq_count();
-    } else {
-        return rr_count();
+    uint32_t count = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        count += cpu_ready_count(cpu);
     }
+    return count;
+}
+
+/**
+ * @brief Get the number of sleeping tasks
+ * 
+ * @return Number of tasks waiting on the sleep wheel
+ */
+uint32_t scheduler_sleeping_count(void)
+{
+    return (uint32_t)sleep_wheel_count();
 }
 
 /**
@@ -538,6 +1207,71 @@ uint32_t scheduler_get_context_switches(void)
     return context_switch_count;
 }
 
+/**
+ * @brief Get the latency histograms
+ * 
+ * @param stats Filled with a snapshot of both histograms
+ */
+void scheduler_get_latency_stats(scheduler_latency_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    
+    uint32_t flags = spin_lock_irqsave(&sched_lock);
+    for (uint32_t i = 0; i < SCHED_LAT_BUCKETS; i++) {
+        stats->wakeup_hist[i] = wakeup_hist[i];
+        stats->switch_hist[i] = switch_hist[i];
+    }
+    stats->wakeup_max_ns = wakeup_max_ns;
+    stats->switch_max_ns = switch_max_ns;
+    stats->clock_khz = clock_get_khz();
+    spin_unlock_irqrestore(&sched_lock, flags);
+}
+
+/**
+ * @brief Snapshot per-task scheduling statistics
+ * 
+ * @param info      Array to fill
+ * @param max_tasks Capacity of the array
+ * @return Number of entries written
+ */
+uint32_t scheduler_get_task_info(scheduler_task_info_t *info, uint32_t max_tasks)
+{
+    if (info == NULL) {
+        return 0;
+    }
+    
+    uint32_t count = 0;
+    uint32_t flags = kernel_lock_irqsave();
+    for (uint32_t i = 0; i < MAX_TASKS && count < max_tasks; i++) {
+        task_t *task = task_get_by_index(i);
+        if (task == NULL || task->state == TASK_STATE_UNUSED) {
+            continue;
+        }
+        
+        scheduler_task_info_t *out = &info[count++];
+        out->pid = task->pid;
+        out->state = (uint8_t)task->state;
+        out->priority = task->priority;
+        out->reserved = 0;
+        out->cpu_time = task->cpu_time;
+        out->run_count = task->run_count;
+        out->latency_last_ns = task->latency_last_ns;
+        out->latency_max_ns = task->latency_max_ns;
+        
+        uint32_t n = 0;
+        while (n < sizeof(out->name) - 1 && task->name[n] != '\0') {
+            out->name[n] = task->name[n];
+            n++;
+        }
+        out->name[n] = '\0';
+    }
+    kernel_unlock_irqrestore(flags);
+    
+    return count;
+}
+
 /**
  * @brief Get schedule call count
  * 
@@ -565,5 +1299,5 @@ uint32_t scheduler_get_idle_time(void)
  */
 task_t *scheduler_get_idle_task(void)
 {
-    return idle_task;
+    return smp_this_cpu()->idle;
 }
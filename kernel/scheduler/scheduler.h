@@ -16,6 +16,8 @@
  * Supported Scheduling Policies:
  * - Round-Robin: FIFO with time slicing
  * - Priority: Lower priority value = runs first
+ * - Bitmap: Priority order with O(1) per-level FIFOs
+ * - Fair: Weighted virtual runtime on a red-black tree
  *
  * Usage:
  *   1. Call scheduler_init() to initialize
@@ -37,6 +39,49 @@
 #define SCHED_POLICY_ROUND_ROBIN    0   /* First-in-first-out with time slicing */
 #define SCHED_POLICY_PRIORITY       1   /* Min priority value runs first */
 #define SCHED_POLICY_MLFQ           2   /* Multi-Level Feedback Queue (future) */
+#define SCHED_POLICY_BITMAP         3   /* Priority order, O(1) level bitmap */
+#define SCHED_POLICY_FAIR           4   /* Least weighted vruntime runs first */
+
+/* ---------------------------------------------------------------------------
+ * Latency Statistics
+ * ---------------------------------------------------------------------------
+ * Log2 histograms in nanoseconds: bucket i counts samples in [2^i, 2^(i+1)),
+ * bucket 0 also holds zero. All values are 0 if the TSC is uncalibrated.
+ * --------------------------------------------------------------------------- */
+#define SCHED_LAT_BUCKETS           32
+
+typedef struct scheduler_latency_stats {
+    uint32_t wakeup_hist[SCHED_LAT_BUCKETS];   /* Ready -> running delay */
+    uint32_t switch_hist[SCHED_LAT_BUCKETS];   /* task_switch_asm cost */
+    uint32_t wakeup_max_ns;
+    uint32_t switch_max_ns;
+    uint32_t clock_khz;                        /* TSC rate (0 = uncalibrated) */
+} scheduler_latency_stats_t;
+
+/* Per-task view of the scheduler (see scheduler_get_task_info) */
+typedef struct scheduler_task_info {
+    uint32_t pid;
+    uint8_t state;                  /* task_state_t */
+    uint8_t priority;
+    uint16_t reserved;
+    uint32_t cpu_time;              /* Ticks */
+    uint32_t run_count;             /* Times scheduled in */
+    uint32_t latency_last_ns;
+    uint32_t latency_max_ns;
+    char name[16];                  /* Truncated task name */
+} scheduler_task_info_t;
+
+/* ---------------------------------------------------------------------------
+ * Work Queue Types
+ * --------------------------------------------------------------------------- */
+typedef void (*work_fn_t)(void *arg);
+
+typedef struct workqueue_stats {
+    uint32_t queued;        /* Items accepted */
+    uint32_t executed;      /* Items run by the worker */
+    uint32_t dropped;       /* Items rejected because the ring was full */
+    uint32_t high_water;    /* Deepest the ring has been */
+} workqueue_stats_t;
 
 /* ---------------------------------------------------------------------------
  * Scheduler Initialization
@@ -63,10 +108,20 @@ bool scheduler_init(void);
  * Prerequisites:
  * - scheduler_init() must have been called
  * - At least one task should be created (idle task always exists)
- * - Interrupts should be enabled before calling this
+ * 
+ * Interrupts are turned on by the first task as it starts running.
  */
 void scheduler_start(void);
 
+/**
+ * @brief Run tasks on the calling application processor
+ * 
+ * Called by each AP once it is up. Waits for scheduler_start(), then
+ * runs the CPU's idle task, which steals work from the other CPUs.
+ * Returns only if the CPU cannot take part (no idle task or LAPIC tick).
+ */
+void scheduler_ap_start(void);
+
 /**
  * @brief Stop the scheduler
  * 
@@ -107,6 +162,48 @@ void scheduler_add_task(task_t *task);
  */
 void scheduler_remove_task(task_t *task);
 
+/**
+ * @brief Release the scheduler lock after a context switch
+ * 
+ * Internal: called by a new task's first entry, which never returns
+ * through schedule().
+ */
+void scheduler_finish_switch(void);
+
+/**
+ * @brief Reposition a queued task after its priority changed
+ * 
+ * @param task Task whose priority was modified (no-op unless READY)
+ */
+void scheduler_requeue_task(task_t *task);
+
+/**
+ * @brief Make a sleeping or blocked task runnable (task_wakeup())
+ * 
+ * Takes only the scheduler lock. A task woken between marking itself
+ * blocked and calling schedule() simply keeps running.
+ * 
+ * @param task Task to wake (no-op unless SLEEPING or BLOCKED)
+ */
+void scheduler_wake_task(task_t *task);
+
+/**
+ * @brief Put a task's sleep_until deadline on the sleep wheel
+ * 
+ * Mark the task SLEEPING or BLOCKED first: a deadline that expires before
+ * it calls schedule() then just cancels the sleep.
+ * 
+ * @param task Task to time out
+ */
+void scheduler_timeout_add(task_t *task);
+
+/**
+ * @brief Remove a task's pending timeout, if any
+ * 
+ * @param task Task whose timeout to cancel
+ */
+void scheduler_timeout_cancel(task_t *task);
+
 /* ---------------------------------------------------------------------------
  * Scheduler Configuration
  * --------------------------------------------------------------------------- */
@@ -135,12 +232,25 @@ uint8_t scheduler_get_policy(void);
 /**
  * @brief Set the scheduling policy
  * 
- * Changes how tasks are selected for execution.
+ * Changes how tasks are selected for execution. Tasks already waiting
+ * in the old policy's ready queue are moved to the new one.
  * 
- * @param policy SCHED_POLICY_ROUND_ROBIN or SCHED_POLICY_PRIORITY
+ * @param policy SCHED_POLICY_ROUND_ROBIN, SCHED_POLICY_PRIORITY,
+ *               SCHED_POLICY_BITMAP or SCHED_POLICY_FAIR
  */
 void scheduler_set_policy(uint8_t policy);
 
+/**
+ * @brief Tune the fair policy
+ * 
+ * Slices are latency * weight / total_weight, but never shorter than
+ * min_granularity; with many tasks the period grows to keep that floor.
+ * 
+ * @param latency         Target latency in ticks (default SCHEDULER_FAIR_LATENCY)
+ * @param min_granularity Minimum slice in ticks (default SCHEDULER_FAIR_MIN_GRANULARITY)
+ */
+void scheduler_set_fair_tunables(uint32_t latency, uint32_t min_granularity);
+
 /* ---------------------------------------------------------------------------
  * Scheduler Statistics
  * --------------------------------------------------------------------------- */
@@ -152,6 +262,13 @@ void scheduler_set_policy(uint8_t policy);
  */
 uint32_t scheduler_ready_count(void);
 
+/**
+ * @brief Get the number of sleeping tasks
+ * 
+ * @return Number of tasks waiting on the sleep wheel
+ */
+uint32_t scheduler_sleeping_count(void);
+
 /**
  * @brief Get the total number of context switches
  * 
@@ -159,6 +276,22 @@ uint32_t scheduler_ready_count(void);
  */
 uint32_t scheduler_get_context_switches(void);
 
+/**
+ * @brief Get the wakeup latency and context switch cost histograms
+ * 
+ * @param stats Receives a consistent snapshot
+ */
+void scheduler_get_latency_stats(scheduler_latency_stats_t *stats);
+
+/**
+ * @brief Copy per-task scheduling statistics
+ * 
+ * @param info      Array to fill (live tasks in task-table order)
+ * @param max_tasks Capacity of info
+ * @return Number of entries written
+ */
+uint32_t scheduler_get_task_info(scheduler_task_info_t *info, uint32_t max_tasks);
+
 /**
  * @brief Get the total number of schedule() calls
  * 
@@ -180,4 +313,41 @@ uint32_t scheduler_get_idle_time(void);
  */
 task_t *scheduler_get_idle_task(void);
 
+/* ---------------------------------------------------------------------------
+ * Work Queue (workqueue.c)
+ * ---------------------------------------------------------------------------
+ * Deferred work run by the "kworker" task. Unlike softirqs and tasklets,
+ * work items may block.
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Create the worker task (called by scheduler_init)
+ * 
+ * @return true on success, false if the task could not be created
+ */
+bool workqueue_init(void);
+
+/**
+ * @brief Queue a function to run in the worker task
+ * 
+ * Safe from any context, including IRQ top halves and bottom halves.
+ * 
+ * @param fn  Function to run
+ * @param arg Argument passed to fn
+ * @return true if queued, false if the queue is full or not initialized
+ */
+bool workqueue_queue(work_fn_t fn, void *arg);
+
+/**
+ * @brief Get the number of queued items not yet run
+ */
+uint32_t workqueue_pending(void);
+
+/**
+ * @brief Get work queue statistics
+ * 
+ * @param stats Receives a snapshot
+ */
+void workqueue_get_stats(workqueue_stats_t *stats);
+
 #endif /* NEXA_SCHEDULER_H */
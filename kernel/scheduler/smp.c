@@ -0,0 +1,717 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/smp.c
+ * ===========================================================================
+ *
+ * Multiprocessor Bring-Up
+ *
+ * The boot processor finds the other CPUs in the Intel MultiProcessor
+ * Specification configuration table and wakes them one at a time through
+ * its local APIC.
+ *
+ * AP Startup Sequence:
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │  BSP                                   AP                                │
+ * │  copy trampoline to                                                      │
+ * │  SMP_TRAMPOLINE_ADDR, fill in                                            │
+ * │  GDTR / stack / entry                                                    │
+ * │  INIT IPI ──────────────────────────►  reset, wait for SIPI              │
+ * │  wait 10ms                                                               │
+ * │  STARTUP IPI (vector = addr >> 12) ─►  real mode at addr:                │
+ * │  (sent twice, 200us apart)               lgdt, set CR0.PE, far jump      │
+ * │                                          32-bit: load segments + stack   │
+ * │                                          call smp_ap_main()              │
+ * │                                          lidt, BSP's CR4/CR3/CR0         │
+ * │                                          LAPIC, TSS, FPU                 │
+ * │  wait for cpu->online  ◄─────────────  mark online                       │
+ * │  ...                                                                     │
+ * │  scheduler_start()  ─────────────────►  scheduler_ap_start(): own LAPIC  │
+ * │                                          tick, run the idle task, steal  │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * The trampoline is shared, so APs are started strictly one after another.
+ *
+ * An AP takes part in scheduling only when ticks come from the LAPIC timer
+ * (timer.c), since the PIT interrupts the BSP alone. Otherwise it stays
+ * parked with interrupts off. Device interrupts and the sleep wheel stay on
+ * the BSP; APs get work from the run queues and the wakeup IPI.
+ *
+ * Kernel Lock:
+ *   The recursive lock that replaced cli for shared kernel state (see
+ *   spinlock.h). The owning CPU is implied by kernel_lock_depth != 0 in its
+ *   cpu_local_t; the word itself is an ordinary spinlock.
+ *
+ * ===========================================================================
+ */
+
+#include "smp.h"
+#include "spinlock.h"
+#include "scheduler.h"
+#include "task.h"
+#include "../memory/memory.h"
+#include "../drivers/drivers.h"
+#include "../interrupts/interrupts.h"
+
+/* ---------------------------------------------------------------------------
+ * External Functions (from startup.asm)
+ * --------------------------------------------------------------------------- */
+extern void outb(uint16_t port, uint8_t value);
+
+/* From syscall.c: load this CPU's TSS and SYSENTER MSRs */
+extern void syscall_cpu_init(void);
+
+/* ---------------------------------------------------------------------------
+ * Local APIC Registers (offsets from the MMIO base)
+ * --------------------------------------------------------------------------- */
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_ICR_LOW       0x300
+#define LAPIC_REG_ICR_HIGH      0x310
+
+#define LAPIC_ICR_FIXED         0x00004000  /* Fixed delivery, level assert */
+#define LAPIC_ICR_INIT          0x00004500  /* INIT, level assert */
+#define LAPIC_ICR_STARTUP       0x00004600  /* STARTUP, level assert */
+#define LAPIC_ICR_PENDING       0x00001000  /* Delivery status: send pending */
+
+#define LAPIC_DEFAULT_BASE      0xFEE00000
+#define MSR_APIC_BASE           0x1B
+#define CPUID_FEAT_EDX_APIC     (1U << 9)
+
+/* ---------------------------------------------------------------------------
+ * MP Specification Structures
+ * --------------------------------------------------------------------------- */
+#define MP_ENTRY_PROCESSOR      0
+#define MP_ENTRY_BUS            1
+#define MP_ENTRY_IOAPIC         2
+#define MP_ENTRY_IO_INTERRUPT   3
+#define MP_PROC_ENABLED         0x01
+#define MP_PROC_BSP             0x02
+#define MP_IOAPIC_ENABLED       0x01
+#define MP_INT_TYPE_INT         0       /* Vectored interrupt (vs NMI/SMI/ExtINT) */
+#define MP_FEATURE2_IMCR        0x80    /* features[1]: boots in PIC mode */
+#define MP_MAX_BUSES            32
+
+typedef struct __attribute__((packed)) mp_floating {
+    char signature[4];              /* "_MP_" */
+    uint32_t config_table;          /* Physical address of the config table */
+    uint8_t length;                 /* In 16-byte units */
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t default_config;         /* Non-zero: no table, default layout */
+    uint8_t features[4];
+} mp_floating_t;
+
+typedef struct __attribute__((packed)) mp_config {
+    char signature[4];              /* "PCMP" */
+    uint16_t length;                /* Base table length in bytes */
+    uint8_t spec_rev;
+    uint8_t checksum;
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_address;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} mp_config_t;
+
+typedef struct __attribute__((packed)) mp_processor {
+    uint8_t type;                   /* MP_ENTRY_PROCESSOR */
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;                  /* MP_PROC_* */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} mp_processor_t;
+
+typedef struct __attribute__((packed)) mp_bus {
+    uint8_t type;                   /* MP_ENTRY_BUS */
+    uint8_t bus_id;
+    char bus_type[6];               /* "ISA   ", "PCI   ", ... */
+} mp_bus_t;
+
+typedef struct __attribute__((packed)) mp_ioapic {
+    uint8_t type;                   /* MP_ENTRY_IOAPIC */
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;                  /* MP_IOAPIC_ENABLED */
+    uint32_t address;
+} mp_ioapic_t;
+
+typedef struct __attribute__((packed)) mp_io_interrupt {
+    uint8_t type;                   /* MP_ENTRY_IO_INTERRUPT */
+    uint8_t int_type;               /* MP_INT_TYPE_* */
+    uint16_t flags;                 /* Polarity (bits 0-1), trigger (bits 2-3) */
+    uint8_t source_bus;
+    uint8_t source_irq;
+    uint8_t dest_apic;
+    uint8_t dest_pin;
+} mp_io_interrupt_t;
+
+/* ---------------------------------------------------------------------------
+ * AP Trampoline
+ * ---------------------------------------------------------------------------
+ * Copied to SMP_TRAMPOLINE_ADDR before each startup. The 16-bit part runs
+ * with CS = SMP_TRAMPOLINE_ADDR >> 4, so data is addressed relative to the
+ * start label; after the far jump everything is flat 32-bit. Selectors
+ * 0x08/0x10 are the kernel code/data segments from boot/gdt.asm.
+ * --------------------------------------------------------------------------- */
+#define SMP_STR_(x)             #x
+#define SMP_STR(x)              SMP_STR_(x)
+#define TRAMPOLINE_ABS(label)   "(" SMP_STR(SMP_TRAMPOLINE_ADDR) " + " #label " - smp_trampoline_start)"
+
+__asm__(
+    ".pushsection .text\n"
+    ".code16\n"
+    ".global smp_trampoline_start\n"
+    "smp_trampoline_start:\n"
+    "    cli\n"
+    "    cld\n"
+    "    movw %cs, %ax\n"
+    "    movw %ax, %ds\n"
+    "    lgdtl smp_trampoline_gdtr - smp_trampoline_start\n"
+    "    movl %cr0, %eax\n"
+    "    orl $1, %eax\n"
+    "    movl %eax, %cr0\n"
+    "    ljmpl $0x08, $" TRAMPOLINE_ABS(smp_trampoline_pm) "\n"
+    ".code32\n"
+    "smp_trampoline_pm:\n"
+    "    movw $0x10, %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %es\n"
+    "    movw %ax, %fs\n"
+    "    movw %ax, %gs\n"
+    "    movw %ax, %ss\n"
+    "    movl " TRAMPOLINE_ABS(smp_trampoline_stack) ", %esp\n"
+    "    call *" TRAMPOLINE_ABS(smp_trampoline_entry) "\n"
+    "1:  cli\n"
+    "    hlt\n"
+    "    jmp 1b\n"
+    "    .balign 4\n"
+    ".global smp_trampoline_gdtr\n"
+    "smp_trampoline_gdtr:\n"
+    "    .word 0\n"
+    "    .long 0\n"
+    "    .word 0\n"
+    ".global smp_trampoline_stack\n"
+    "smp_trampoline_stack:\n"
+    "    .long 0\n"
+    ".global smp_trampoline_entry\n"
+    "smp_trampoline_entry:\n"
+    "    .long 0\n"
+    ".global smp_trampoline_end\n"
+    "smp_trampoline_end:\n"
+    ".popsection\n"
+);
+
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_gdtr[];
+extern uint8_t smp_trampoline_stack[];
+extern uint8_t smp_trampoline_entry[];
+extern uint8_t smp_trampoline_end[];
+
+/* Descriptor-table register image (sgdt/sidt/lgdt/lidt operand) */
+typedef struct __attribute__((packed)) table_register {
+    uint16_t limit;
+    uint32_t base;
+} table_register_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+static cpu_local_t cpus[SMP_MAX_CPUS];
+static uint8_t apic_to_cpu[256];        /* Local APIC ID -> logical CPU */
+
+static uint32_t cpu_count = 1;          /* CPUs listed by firmware */
+static volatile uint32_t online_count = 1;
+
+static volatile uint32_t *lapic = NULL; /* Local APIC MMIO base */
+
+/* IDT and control registers loaded by each AP (copied from the BSP) */
+static table_register_t ap_idtr;
+static uint32_t ap_cr0;
+static uint32_t ap_cr3;
+static uint32_t ap_cr4;
+
+/* The kernel lock (see spinlock.h); its owner is the CPU with depth > 0 */
+static spinlock_t kernel_lock_word = SPINLOCK_INIT;
+
+/* ---------------------------------------------------------------------------
+ * Internal Helper Functions
+ * --------------------------------------------------------------------------- */
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic[reg / 4] = value;
+}
+
+/**
+ * @brief Busy-wait for a number of microseconds
+ */
+static void smp_delay_us(uint32_t us)
+{
+    uint32_t mhz = clock_get_khz() / 1000;
+
+    if (mhz == 0) {
+        /* No calibrated TSC: a port 0x80 write takes about 1us */
+        for (uint32_t i = 0; i < us; i++) {
+            outb(0x80, 0);
+        }
+        return;
+    }
+
+    uint64_t end = clock_cycles() + (uint64_t)mhz * us;
+    while (clock_cycles() < end) {
+        __asm__ volatile("pause");
+    }
+}
+
+/**
+ * @brief Send an IPI and wait for the APIC to accept it
+ */
+static void lapic_send_ipi(uint8_t apic_id, uint32_t command)
+{
+    lapic_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, command);
+
+    for (uint32_t spins = 0; spins < 100000; spins++) {
+        if (!(lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)) {
+            break;
+        }
+        __asm__ volatile("pause");
+    }
+}
+
+/**
+ * @brief Sum a byte range (MP structures checksum to zero)
+ */
+static uint8_t mp_checksum(const void *data, uint32_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum = (uint8_t)(sum + bytes[i]);
+    }
+    return sum;
+}
+
+/**
+ * @brief Read a 16-bit word from the BIOS data area
+ *
+ * The address goes through a register so the compiler does not treat the
+ * fixed low address as an out-of-bounds object access.
+ */
+static uint16_t bda_read16(uintptr_t addr)
+{
+    __asm__("" : "+r"(addr));
+    return *(volatile uint16_t *)addr;
+}
+
+/**
+ * @brief Look for the MP floating pointer in one physical range
+ */
+static mp_floating_t *mp_scan(uintptr_t start, uint32_t length)
+{
+    for (uintptr_t addr = start; addr + sizeof(mp_floating_t) <= start + length;
+         addr += 16) {
+        mp_floating_t *mpf = (mp_floating_t *)addr;
+        if (mpf->signature[0] == '_' && mpf->signature[1] == 'M' &&
+            mpf->signature[2] == 'P' && mpf->signature[3] == '_' &&
+            mpf->length == 1 && mp_checksum(mpf, 16) == 0) {
+            return mpf;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find the MP floating pointer where the specification allows it
+ *
+ * First KB of the EBDA, last KB of base memory, then the BIOS ROM.
+ */
+static mp_floating_t *mp_find(void)
+{
+    mp_floating_t *mpf;
+
+    uintptr_t ebda = (uintptr_t)bda_read16(0x40E) << 4;
+    if (ebda != 0 && (mpf = mp_scan(ebda, 1024)) != NULL) {
+        return mpf;
+    }
+
+    uintptr_t base_kb = bda_read16(0x413);
+    if (base_kb >= 1 && (mpf = mp_scan(base_kb * 1024 - 1024, 1024)) != NULL) {
+        return mpf;
+    }
+
+    return mp_scan(0xF0000, 0x10000);
+}
+
+/**
+ * @brief Find the MP configuration table, checked
+ */
+static mp_config_t *mp_config_find(mp_floating_t **floating)
+{
+    mp_floating_t *mpf = mp_find();
+    if (mpf == NULL || mpf->default_config != 0 || mpf->config_table == 0) {
+        return NULL;
+    }
+
+    mp_config_t *config = (mp_config_t *)(uintptr_t)mpf->config_table;
+    if (config->signature[0] != 'P' || config->signature[1] != 'C' ||
+        config->signature[2] != 'M' || config->signature[3] != 'P' ||
+        mp_checksum(config, config->length) != 0) {
+        return NULL;
+    }
+
+    if (floating != NULL) {
+        *floating = mpf;
+    }
+    return config;
+}
+
+/**
+ * @brief Fill the per-CPU table from the MP configuration table
+ *
+ * @return true if the table described at least one processor
+ */
+static bool mp_enumerate(void)
+{
+    mp_config_t *config = mp_config_find(NULL);
+    if (config == NULL) {
+        return false;
+    }
+
+    if (config->lapic_address != 0) {
+        lapic = (volatile uint32_t *)(uintptr_t)config->lapic_address;
+    }
+
+    /* Slot 0 is always the BSP; APs fill the rest in table order */
+    uint32_t count = 1;
+    bool found_bsp = false;
+    uint8_t *entry = (uint8_t *)(config + 1);
+    uint8_t *end = (uint8_t *)config + config->length;
+
+    for (uint16_t i = 0; i < config->entry_count && entry < end; i++) {
+        if (*entry != MP_ENTRY_PROCESSOR) {
+            entry += 8;     /* Bus, I/O APIC and interrupt entries */
+            continue;
+        }
+
+        mp_processor_t *proc = (mp_processor_t *)entry;
+        entry += sizeof(mp_processor_t);
+
+        if (!(proc->flags & MP_PROC_ENABLED)) {
+            continue;
+        }
+
+        cpu_local_t *cpu;
+        if (proc->flags & MP_PROC_BSP) {
+            cpu = &cpus[0];
+            found_bsp = true;
+        } else if (count < SMP_MAX_CPUS) {
+            cpu = &cpus[count];
+            cpu->id = count++;
+        } else {
+            continue;       /* More CPUs than slots */
+        }
+
+        cpu->apic_id = proc->apic_id;
+        cpu->present = true;
+        apic_to_cpu[proc->apic_id] = (uint8_t)cpu->id;
+    }
+
+    if (!found_bsp) {
+        return false;
+    }
+
+    cpu_count = count;
+    return true;
+}
+
+/**
+ * @brief C entry point of an application processor
+ *
+ * Called from the trampoline on the AP's boot stack.
+ */
+static void smp_ap_main(void)
+{
+    /* The BSP's interrupt table, paging and FPU/SSE control bits */
+    __asm__ volatile("lidt %0" :: "m"(ap_idtr));
+    __asm__ volatile("mov %0, %%cr4" :: "r"(ap_cr4));
+    __asm__ volatile("mov %0, %%cr3" :: "r"(ap_cr3));
+    __asm__ volatile("mov %0, %%cr0" :: "r"(ap_cr0) : "memory");
+
+    /* Counted first, so smp_this_cpu() stops assuming the BSP */
+    __asm__ volatile("lock incl %0" : "+m"(online_count) :: "memory");
+    cpu_local_t *cpu = &cpus[apic_to_cpu[lapic_read(LAPIC_REG_ID) >> 24]];
+
+    apic_ap_init();
+    syscall_cpu_init();
+    task_fpu_cpu_init();
+    __atomic_store_n(&cpu->online, true, __ATOMIC_RELEASE);
+
+    scheduler_ap_start();
+
+    /* Park: see the note at the top of this file */
+    while (1) {
+        __asm__ volatile("cli; hlt");
+    }
+}
+
+/**
+ * @brief Start one application processor
+ *
+ * @return true if it reported in
+ */
+static bool smp_start_ap(cpu_local_t *cpu)
+{
+    cpu->boot_stack = kmalloc(SMP_AP_STACK_SIZE);
+    if (cpu->boot_stack == NULL) {
+        return false;
+    }
+
+    /* Install the trampoline and its parameters */
+    uint8_t *trampoline = (uint8_t *)SMP_TRAMPOLINE_ADDR;
+    uint32_t size = (uint32_t)(smp_trampoline_end - smp_trampoline_start);
+    for (uint32_t i = 0; i < size; i++) {
+        trampoline[i] = smp_trampoline_start[i];
+    }
+
+    table_register_t gdtr;
+    __asm__ volatile("sgdt %0" : "=m"(gdtr));
+    uint32_t stack_top = (uint32_t)(uintptr_t)cpu->boot_stack + SMP_AP_STACK_SIZE;
+    uint32_t entry = (uint32_t)(uintptr_t)smp_ap_main;
+
+    *(table_register_t *)(trampoline + (smp_trampoline_gdtr - smp_trampoline_start)) = gdtr;
+    *(uint32_t *)(trampoline + (smp_trampoline_stack - smp_trampoline_start)) = stack_top & ~0xFU;
+    *(uint32_t *)(trampoline + (smp_trampoline_entry - smp_trampoline_start)) = entry;
+    __asm__ volatile("" ::: "memory");
+
+    /* INIT, then up to two STARTUPs (the second is ignored if the first worked) */
+    lapic_send_ipi(cpu->apic_id, LAPIC_ICR_INIT);
+    smp_delay_us(10000);
+
+    for (uint32_t attempt = 0; attempt < 2 && !cpu->online; attempt++) {
+        lapic_send_ipi(cpu->apic_id, LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE_ADDR >> 12));
+        smp_delay_us(200);
+    }
+
+    /* Give it up to 100ms to reach smp_ap_main() */
+    for (uint32_t waited = 0; waited < 1000 && !cpu->online; waited++) {
+        smp_delay_us(100);
+    }
+
+    return cpu->online;
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API Implementation
+ * --------------------------------------------------------------------------- */
+
+bool smp_ioapic_config(smp_ioapic_config_t *out)
+{
+    mp_floating_t *mpf;
+    mp_config_t *config = mp_config_find(&mpf);
+    if (config == NULL) {
+        return false;
+    }
+
+    /* ISA IRQs are wired straight through unless the table says otherwise */
+    for (uint8_t irq = 0; irq < 16; irq++) {
+        out->isa_pin[irq] = irq;
+        out->isa_flags[irq] = 0;
+    }
+    out->address = 0;
+    out->imcr = (mpf->features[1] & MP_FEATURE2_IMCR) != 0;
+
+    bool isa_bus[MP_MAX_BUSES] = { false };
+    uint8_t *entry = (uint8_t *)(config + 1);
+    uint8_t *end = (uint8_t *)config + config->length;
+
+    /* Entries are sorted by type, so buses and I/O APICs come first */
+    for (uint16_t i = 0; i < config->entry_count && entry < end; i++) {
+        if (*entry == MP_ENTRY_PROCESSOR) {
+            entry += sizeof(mp_processor_t);
+            continue;
+        }
+
+        if (*entry == MP_ENTRY_BUS) {
+            mp_bus_t *bus = (mp_bus_t *)entry;
+            if (bus->bus_id < MP_MAX_BUSES) {
+                isa_bus[bus->bus_id] = bus->bus_type[0] == 'I' &&
+                                       bus->bus_type[1] == 'S' &&
+                                       bus->bus_type[2] == 'A';
+            }
+        } else if (*entry == MP_ENTRY_IOAPIC) {
+            mp_ioapic_t *ioapic = (mp_ioapic_t *)entry;
+            if ((ioapic->flags & MP_IOAPIC_ENABLED) && out->address == 0) {
+                out->address = ioapic->address;
+                out->id = ioapic->apic_id;
+            }
+        } else if (*entry == MP_ENTRY_IO_INTERRUPT) {
+            mp_io_interrupt_t *irq = (mp_io_interrupt_t *)entry;
+            if (irq->int_type == MP_INT_TYPE_INT && irq->source_irq < 16 &&
+                irq->source_bus < MP_MAX_BUSES && isa_bus[irq->source_bus] &&
+                out->address != 0 && irq->dest_apic == out->id) {
+                out->isa_pin[irq->source_irq] = irq->dest_pin;
+                out->isa_flags[irq->source_irq] = irq->flags;
+            }
+        }
+        entry += 8;
+    }
+
+    return out->address != 0;
+}
+
+
+uint32_t smp_init(void)
+{
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        cpus[i].id = i;
+        cpus[i].present = false;
+        cpus[i].online = false;
+        cpus[i].boot_stack = NULL;
+    }
+    cpus[0].present = true;
+    cpus[0].online = true;
+    cpu_count = 1;
+    online_count = 1;
+
+    /* Local APIC present? */
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_FEAT_EDX_APIC)) {
+        return 1;
+    }
+
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(MSR_APIC_BASE));
+    lapic = (volatile uint32_t *)(uintptr_t)(lo & 0xFFFFF000);
+    if (lapic == NULL) {
+        lapic = (volatile uint32_t *)LAPIC_DEFAULT_BASE;
+    }
+    cpus[0].apic_id = (uint8_t)(ebx >> 24);
+
+    if (!mp_enumerate() || !SMP_ENABLED) {
+        return 1;
+    }
+
+    __asm__ volatile("sidt %0" : "=m"(ap_idtr));
+    __asm__ volatile("mov %%cr0, %0" : "=r"(ap_cr0));
+    __asm__ volatile("mov %%cr3, %0" : "=r"(ap_cr3));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(ap_cr4));
+
+    for (uint32_t i = 1; i < cpu_count; i++) {
+        if (cpus[i].present) {
+            smp_start_ap(&cpus[i]);
+        }
+    }
+
+    return online_count;
+}
+
+cpu_local_t *smp_this_cpu(void)
+{
+    /* Only the BSP runs kernel code until an AP has come online */
+    if (online_count == 1) {
+        return &cpus[0];
+    }
+    return &cpus[apic_to_cpu[lapic_read(LAPIC_REG_ID) >> 24]];
+}
+
+cpu_local_t *smp_get_cpu(uint32_t id)
+{
+    return (id < SMP_MAX_CPUS) ? &cpus[id] : NULL;
+}
+
+uint32_t smp_cpu_id(void)
+{
+    return smp_this_cpu()->id;
+}
+
+uint32_t smp_cpu_count(void)
+{
+    return cpu_count;
+}
+
+uint32_t smp_online_count(void)
+{
+    return online_count;
+}
+
+bool smp_lapic_present(void)
+{
+    return lapic != NULL;
+}
+
+void smp_wakeup_cpu(uint32_t id)
+{
+    if (id >= SMP_MAX_CPUS || lapic == NULL || !cpus[id].online) {
+        return;
+    }
+    lapic_send_ipi(cpus[id].apic_id, LAPIC_ICR_FIXED | APIC_WAKEUP_VECTOR);
+}
+
+/* ---------------------------------------------------------------------------
+ * Kernel Lock
+ * --------------------------------------------------------------------------- */
+
+void kernel_lock(void)
+{
+    cpu_local_t *cpu = smp_this_cpu();
+    if (cpu->kernel_lock_depth++ == 0) {
+        spin_lock(&kernel_lock_word);
+    }
+}
+
+void kernel_unlock(void)
+{
+    cpu_local_t *cpu = smp_this_cpu();
+    if (cpu->kernel_lock_depth == 0) {
+        return;     /* Unbalanced unlock */
+    }
+    if (--cpu->kernel_lock_depth == 0) {
+        spin_unlock(&kernel_lock_word);
+    }
+}
+
+uint32_t kernel_lock_irqsave(void)
+{
+    uint32_t flags = interrupts_save_and_disable();
+    kernel_lock();
+    return flags;
+}
+
+void kernel_unlock_irqrestore(uint32_t flags)
+{
+    kernel_unlock();
+    interrupts_restore(flags);
+}
+
+uint32_t kernel_lock_release(void)
+{
+    cpu_local_t *cpu = smp_this_cpu();
+    uint32_t depth = cpu->kernel_lock_depth;
+
+    cpu->kernel_lock_depth = 0;
+    if (depth != 0) {
+        spin_unlock(&kernel_lock_word);
+    }
+    return depth;
+}
+
+void kernel_lock_reacquire(uint32_t depth)
+{
+    if (depth != 0) {
+        spin_lock(&kernel_lock_word);
+        smp_this_cpu()->kernel_lock_depth = depth;
+    }
+}
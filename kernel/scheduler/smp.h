@@ -0,0 +1,126 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/smp.h
+ * ===========================================================================
+ *
+ * Multiprocessor Support and Per-CPU Data
+ *
+ * smp_init() enumerates the processors listed in the BIOS MP configuration
+ * table and starts every application processor (AP) with the INIT/SIPI
+ * sequence through the local APIC. Each CPU gets a cpu_local_t slot holding
+ * its current task, idle task and scheduler bookkeeping. Once
+ * scheduler_start() runs on the BSP, every AP with a LAPIC tick runs tasks
+ * from the per-CPU run queues (scheduler.c); smp_wakeup_cpu() ends the HLT
+ * of an idle one when work is queued.
+ *
+ * CPU Identification:
+ *   smp_this_cpu() maps the local APIC ID of the running CPU to its slot.
+ *   While only the bootstrap processor (BSP) is online it returns slot 0
+ *   without touching the APIC, so uniprocessor paths pay nothing.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_SMP_H
+#define NEXA_SMP_H
+
+#include "../../config/os_config.h"
+
+struct task;
+
+/* ---------------------------------------------------------------------------
+ * Per-CPU Data
+ * --------------------------------------------------------------------------- */
+typedef struct cpu_local {
+    uint32_t id;                    /* Logical CPU number (0 = BSP) */
+    uint8_t apic_id;                /* Local APIC ID */
+    bool present;                   /* Listed by firmware */
+    bool online;                    /* Running kernel code */
+    bool in_scheduler;              /* Inside schedule() (recursion guard) */
+    uint32_t kernel_lock_depth;     /* Kernel lock nesting (0 = not held) */
+
+    struct task *current;           /* Task running on this CPU */
+    struct task *idle;              /* Task run when nothing is ready */
+
+    uint32_t context_switches;      /* Switches performed on this CPU */
+    uint64_t switch_start;          /* Cycle count at the last switch-out */
+
+    struct task *fpu_owner;         /* Task whose state is in this FPU */
+    bool fpu_ts_set;                /* Cached CR0.TS */
+    void *boot_stack;               /* AP startup stack (NULL for the BSP) */
+} cpu_local_t;
+
+/* ---------------------------------------------------------------------------
+ * I/O APIC Configuration (from the MP table)
+ * --------------------------------------------------------------------------- */
+typedef struct smp_ioapic_config {
+    uint32_t address;               /* MMIO base of the first I/O APIC */
+    uint8_t id;                     /* Its APIC ID */
+    bool imcr;                      /* Firmware booted in PIC mode (IMCR) */
+    uint8_t isa_pin[16];            /* ISA IRQ -> I/O APIC input */
+    uint16_t isa_flags[16];         /* MP polarity (bits 0-1) / trigger (2-3) */
+} smp_ioapic_config_t;
+
+/* ---------------------------------------------------------------------------
+ * SMP API
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Enumerate processors and start the application processors
+ *
+ * Needs the TSC clock (pit_init) and the kernel heap. Falls back to a
+ * single CPU when there is no local APIC or MP table.
+ *
+ * @return Number of CPUs online
+ */
+uint32_t smp_init(void);
+
+/**
+ * @brief Per-CPU data of the calling CPU
+ */
+cpu_local_t *smp_this_cpu(void);
+
+/**
+ * @brief Per-CPU data by logical CPU number
+ *
+ * @return Slot, or NULL if id is out of range
+ */
+cpu_local_t *smp_get_cpu(uint32_t id);
+
+/**
+ * @brief Logical number of the calling CPU
+ */
+uint32_t smp_cpu_id(void);
+
+/**
+ * @brief Number of CPUs listed by firmware
+ */
+uint32_t smp_cpu_count(void);
+
+/**
+ * @brief Number of CPUs running kernel code
+ */
+uint32_t smp_online_count(void);
+
+/**
+ * @brief Check if a local APIC was found
+ */
+bool smp_lapic_present(void);
+
+/**
+ * @brief Send a wakeup IPI to a CPU (ends its HLT)
+ *
+ * @param id Logical CPU number; ignored if that CPU is not online
+ */
+void smp_wakeup_cpu(uint32_t id);
+
+/**
+ * @brief Read the I/O APIC and ISA routing from the MP table
+ *
+ * Independent of smp_init(), so interrupt setup can run before it.
+ *
+ * @return true if the table lists an enabled I/O APIC
+ */
+bool smp_ioapic_config(smp_ioapic_config_t *config);
+
+#endif /* NEXA_SMP_H */
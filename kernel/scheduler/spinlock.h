@@ -0,0 +1,182 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/spinlock.h
+ * ===========================================================================
+ *
+ * Spinlocks
+ *
+ * Busy-wait locks for short critical sections shared between CPUs. Disabling
+ * interrupts only keeps the local CPU out; a spinlock also keeps every other
+ * CPU out. Use the _irqsave variants for data an interrupt handler touches,
+ * otherwise an IRQ on the holding CPU would spin on the lock forever.
+ *
+ * Implementation:
+ *   Test-and-test-and-set on a single word. Waiters spin on a plain read
+ *   (with PAUSE) and only retry the locked XCHG once the word reads free,
+ *   so a contended lock does not bounce its cache line on every iteration.
+ *
+ * Spinlocks are not recursive and must not be held across anything that
+ * can block.
+ *
+ * Kernel Lock:
+ *   Shared kernel state that used to be guarded by disabling interrupts
+ *   and has no lock of its own yet (the task table, device top halves, the
+ *   block layer and buffer cache, pipes, message queues, poll, the VFS) is
+ *   guarded by one recursive lock instead. kernel_lock_irqsave() is a
+ *   drop-in for interrupts_save_and_disable(): it nests on the CPU that
+ *   holds it, so code that called other cli-protected code keeps working.
+ *   schedule() drops every level before switching and takes them back when
+ *   the task resumes, so sleeping with the lock held is allowed.
+ *
+ *   The timer tick, softirq dispatch, wakeups and the sleep wheel (all
+ *   under sched_lock), wait queues, futexes and the sync primitives do not
+ *   take it, so blocking and waking do not serialise across CPUs.
+ *
+ * Lock Order:
+ *   kernel lock -> sync_lock / futex bucket locks -> wait queue locks ->
+ *   sched_lock -> leaf locks (heap, frames, perf, profiler). Nothing taken
+ *   under one of these may take a lock to its left.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_SPINLOCK_H
+#define NEXA_SPINLOCK_H
+
+#include "../../config/os_config.h"
+#include "../interrupts/interrupts.h"
+
+/* ---------------------------------------------------------------------------
+ * Spinlock Structure
+ * --------------------------------------------------------------------------- */
+typedef struct spinlock {
+    volatile uint32_t locked;       /* 0 = free, 1 = held */
+} spinlock_t;
+
+#define SPINLOCK_INIT               { 0 }
+
+/* ---------------------------------------------------------------------------
+ * Spinlock API
+ * --------------------------------------------------------------------------- */
+
+/*
+ * spin_lock_init - Initialize a lock in the released state
+ */
+static inline void spin_lock_init(spinlock_t *lock)
+{
+    lock->locked = 0;
+}
+
+/*
+ * spin_trylock - Acquire a lock without waiting
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   true if the lock was acquired
+ */
+static inline bool spin_trylock(spinlock_t *lock)
+{
+    uint32_t old = 1;
+    __asm__ volatile("xchgl %0, %1"
+                     : "+r"(old), "+m"(lock->locked)
+                     :
+                     : "memory");
+    return old == 0;
+}
+
+/*
+ * spin_lock - Acquire a lock, spinning until it is free
+ */
+static inline void spin_lock(spinlock_t *lock)
+{
+    while (!spin_trylock(lock)) {
+        while (lock->locked) {
+            __asm__ volatile("pause");
+        }
+    }
+}
+
+/*
+ * spin_unlock - Release a lock
+ * ---------------------------------------------------------------------------
+ * x86 does not reorder stores with earlier loads or stores, so a compiler
+ * barrier followed by a plain store is a release.
+ */
+static inline void spin_unlock(spinlock_t *lock)
+{
+    __asm__ volatile("" ::: "memory");
+    lock->locked = 0;
+}
+
+/*
+ * spin_is_locked - Check if a lock is currently held by anyone
+ */
+static inline bool spin_is_locked(const spinlock_t *lock)
+{
+    return lock->locked != 0;
+}
+
+/*
+ * spin_lock_irqsave - Disable local interrupts, then acquire a lock
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   The previous EFLAGS, for spin_unlock_irqrestore()
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t *lock)
+{
+    uint32_t flags = interrupts_save_and_disable();
+    spin_lock(lock);
+    return flags;
+}
+
+/*
+ * spin_unlock_irqrestore - Release a lock and restore interrupt state
+ */
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+{
+    spin_unlock(lock);
+    interrupts_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Kernel Lock API (smp.c)
+ * --------------------------------------------------------------------------- */
+
+/*
+ * kernel_lock - Acquire the kernel lock, or nest if this CPU holds it
+ * ---------------------------------------------------------------------------
+ * Interrupts must be disabled.
+ */
+void kernel_lock(void);
+
+/*
+ * kernel_unlock - Drop one level of the kernel lock
+ */
+void kernel_unlock(void);
+
+/*
+ * kernel_lock_irqsave - Disable local interrupts, then take the kernel lock
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   The previous EFLAGS, for kernel_unlock_irqrestore()
+ */
+uint32_t kernel_lock_irqsave(void);
+
+/*
+ * kernel_unlock_irqrestore - Drop one level and restore interrupt state
+ */
+void kernel_unlock_irqrestore(uint32_t flags);
+
+/*
+ * kernel_lock_release - Drop every level held by this CPU (schedule())
+ * ---------------------------------------------------------------------------
+ * Returns:
+ *   The depth released, for kernel_lock_reacquire()
+ */
+uint32_t kernel_lock_release(void);
+
+/*
+ * kernel_lock_reacquire - Take the kernel lock back at a saved depth
+ */
+void kernel_lock_reacquire(uint32_t depth);
+
+#endif /* NEXA_SPINLOCK_H */
@@ -0,0 +1,787 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/sync.c
+ * ===========================================================================
+ *
+ * Wait Queue, Mutex, Semaphore and Condition Variable Implementation
+ *
+ * Every primitive is built on the wait queue: a list of wait entries that
+ * live on the sleeping tasks' own stacks, so waiting never allocates.
+ *
+ * Data Structure: Wait Queue with Prioritized Wakeup
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │  waiters:  [A prio 3] <-> [B prio 1] <-> [C prio 1] <-> [D prio 5]         │
+ * │                              ▲                                           │
+ * │                  wake_one picks B: best priority, earliest arrival       │
+ * │                                                                          │
+ * │  - Wait:      O(1) append, task -> TASK_STATE_BLOCKED                    │
+ * │  - Wake one:  O(n) scan for the best waiter (n = waiters, usually tiny)  │
+ * │  - Handoff:   the waker grants the resource (mutex owner, semaphore      │
+ * │               unit) before waking, and dequeues the entry itself         │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * Priority Inheritance:
+ *   A task blocking in mutex_lock() records the mutex in blocked_on and
+ *   re-evaluates the owner's priority; if the owner is itself blocked on a
+ *   mutex, the walk continues with that mutex's owner (up to
+ *   SYNC_PI_MAX_DEPTH links). Effective priority is always recomputed from
+ *   base_priority and the waiters of the mutexes still held, so boosts
+ *   unwind correctly when mutexes are released in any order.
+ *
+ * Thread Safety:
+ *   A wait queue's list is guarded by its own spinlock. Mutexes,
+ *   semaphores and condition variables (their internal queues included)
+ *   and the priority-inheritance state are guarded by sync_lock. Both come
+ *   after the kernel lock and before sched_lock in the lock order, so
+ *   callers that keep their wait condition under the kernel lock work as
+ *   before, and nothing here needs the kernel lock itself. All of them
+ *   are taken with interrupts disabled.
+ *
+ *   A sleeper marks itself blocked under the lock that guards its entry,
+ *   drops it and calls schedule(). A wakeup in that window just keeps it
+ *   running (see Locking in scheduler.c), and it re-checks its entry.
+ *
+ * ===========================================================================
+ */
+
+#include "sync.h"
+#include "scheduler.h"
+#include "dsa_structures.h"
+#include "spinlock.h"
+#include "../interrupts/interrupts.h"
+#include "../drivers/drivers.h"
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+/* Longest owner chain followed when propagating an inherited priority */
+#define SYNC_PI_MAX_DEPTH   8
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+/* Mutex, semaphore and condition variable state, and priority inheritance */
+static spinlock_t sync_lock = SPINLOCK_INIT;
+
+/* ---------------------------------------------------------------------------
+ * Internal Helper Functions
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Check if the caller can actually sleep
+ */
+static inline bool sync_can_block(void)
+{
+    return task_current() != NULL && scheduler_is_running();
+}
+
+/*
+ * The wq_* helpers below run under whichever lock covers the queue: its
+ * own lock, or sync_lock for the queues inside the sync primitives.
+ */
+
+/**
+ * @brief Append an entry to a queue
+ */
+static void wq_enqueue(wait_queue_t *wq, wait_entry_t *entry)
+{
+    entry->queue = wq;
+    entry->woken = false;
+    entry->notify = NULL;
+    list_push_back(&wq->waiters, &entry->node);
+}
+
+/**
+ * @brief Take an entry off whatever queue it is on
+ */
+static void wq_unlink(wait_entry_t *entry)
+{
+    if (entry->queue != NULL) {
+        list_remove(&entry->queue->waiters, &entry->node);
+        entry->queue = NULL;
+    }
+}
+
+/**
+ * @brief Find the waiter with the best priority (earliest among equals)
+ */
+static wait_entry_t *wq_best(wait_queue_t *wq)
+{
+    wait_entry_t *best = NULL;
+
+    for (list_node_t *node = wq->waiters.head; node != NULL; node = node->next) {
+        wait_entry_t *entry = list_entry(node, wait_entry_t, node);
+        if (entry->notify != NULL) {
+            continue;
+        }
+        if (best == NULL || entry->task->priority < best->task->priority) {
+            best = entry;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Run every callback entry on a queue
+ */
+static void wq_notify(wait_queue_t *wq)
+{
+    for (list_node_t *node = wq->waiters.head; node != NULL; node = node->next) {
+        wait_entry_t *entry = list_entry(node, wait_entry_t, node);
+        if (entry->notify != NULL) {
+            entry->notify(entry);
+        }
+    }
+}
+
+/**
+ * @brief Dequeue an entry, mark it granted and make its task runnable
+ */
+static task_t *wq_wake(wait_entry_t *entry)
+{
+    task_t *task = entry->task;
+
+    wq_unlink(entry);
+    entry->woken = true;
+    task_wakeup(task);
+
+    return task;
+}
+
+/**
+ * @brief Block the calling task until something wakes it
+ *
+ * Called and returns with lock (covering the entry's queue) held and
+ * interrupts disabled. The entry stays queued across a spurious wakeup;
+ * callers re-check their condition.
+ */
+static void sync_sleep(wait_entry_t *entry, spinlock_t *lock)
+{
+    entry->task->state = TASK_STATE_BLOCKED;
+    spin_unlock(lock);
+    schedule();
+    interrupts_disable();
+    spin_lock(lock);
+}
+
+/**
+ * @brief Sleep on a wait queue once, optionally dropping an outer lock
+ *
+ * Interrupts disabled; outer (if any) held on entry and return. Marked
+ * blocked before the timeout is filed, so an early expiry is not lost.
+ *
+ * @return true if woken through the queue
+ */
+static bool wq_sleep(wait_queue_t *wq, spinlock_t *outer, uint32_t ticks)
+{
+    wait_entry_t entry;
+    entry.task = task_current();
+
+    spin_lock(&wq->lock);
+    wq_enqueue(wq, &entry);
+    entry.task->state = TASK_STATE_BLOCKED;
+    spin_unlock(&wq->lock);
+
+    bool timed = (ticks != WAIT_FOREVER);
+    if (timed) {
+        /* A queue wakeup takes the task off the wheel */
+        entry.task->sleep_until = pit_get_ticks() + ticks;
+        scheduler_timeout_add(entry.task);
+    }
+    if (outer != NULL) {
+        spin_unlock(outer);
+    }
+
+    schedule();
+    interrupts_disable();
+
+    if (timed) {
+        scheduler_timeout_cancel(entry.task);
+    }
+    if (outer != NULL) {
+        spin_lock(outer);
+    }
+
+    /* Still queued if woken by something other than this queue */
+    spin_lock(&wq->lock);
+    wq_unlink(&entry);
+    spin_unlock(&wq->lock);
+    return entry.woken;
+}
+
+/**
+ * @brief Wake every task entry on a queue (queue lock held)
+ */
+static uint32_t wq_wake_all(wait_queue_t *wq)
+{
+    uint32_t woken = 0;
+    wq_notify(wq);
+    list_node_t *node = wq->waiters.head;
+    while (node != NULL) {
+        list_node_t *next = node->next;
+        wait_entry_t *entry = list_entry(node, wait_entry_t, node);
+        if (entry->notify == NULL) {
+            wq_wake(entry);
+            woken++;
+        }
+        node = next;
+    }
+    return woken;
+}
+
+/**
+ * @brief Set a task's effective priority, fixing up its ready queue position
+ */
+static void pi_set_priority(task_t *task, uint8_t priority)
+{
+    if (task->priority != priority) {
+        task->priority = priority;
+        scheduler_requeue_task(task);
+    }
+}
+
+/**
+ * @brief Re-evaluate priorities along a chain of mutex owners
+ */
+static void pi_propagate(task_t *owner)
+{
+    for (uint32_t depth = 0; owner != NULL && depth < SYNC_PI_MAX_DEPTH; depth++) {
+        uint8_t priority = sync_effective_priority(owner);
+        if (priority == owner->priority) {
+            break;
+        }
+        pi_set_priority(owner, priority);
+        owner = (owner->blocked_on != NULL) ? owner->blocked_on->owner : NULL;
+    }
+}
+
+/**
+ * @brief Make a task the owner of a mutex
+ */
+static void mutex_take(mutex_t *mutex, task_t *task)
+{
+    mutex->owner = task;
+    list_push_back(&task->held_mutexes, &mutex->held_node);
+}
+
+/**
+ * @brief Acquire a mutex under sync_lock, sleeping as needed
+ */
+static void mutex_acquire_locked(mutex_t *mutex, task_t *self, wait_entry_t *entry)
+{
+    if (mutex->owner == NULL) {
+        mutex_take(mutex, self);
+        return;
+    }
+
+    wq_enqueue(&mutex->waiters, entry);
+    self->blocked_on = mutex;
+    pi_propagate(mutex->owner);
+
+    /* mutex_unlock() hands ownership over before waking us */
+    while (mutex->owner != self) {
+        sync_sleep(entry, &sync_lock);
+    }
+}
+
+/**
+ * @brief Release a mutex under sync_lock
+ *
+ * @return true if the new owner should preempt the caller
+ */
+static bool mutex_release_locked(mutex_t *mutex, task_t *self)
+{
+    list_remove(&self->held_mutexes, &mutex->held_node);
+
+    wait_entry_t *entry = wq_best(&mutex->waiters);
+    task_t *next = NULL;
+
+    if (entry != NULL) {
+        /* Direct handoff: the waiter owns the mutex before it runs */
+        next = entry->task;
+        next->blocked_on = NULL;
+        mutex_take(mutex, next);
+        pi_set_priority(next, sync_effective_priority(next));
+        wq_wake(entry);
+    } else {
+        mutex->owner = NULL;
+    }
+
+    /* Drop whatever this mutex's waiters lent us */
+    pi_set_priority(self, sync_effective_priority(self));
+
+    return next != NULL && next->priority < self->priority;
+}
+
+/* ---------------------------------------------------------------------------
+ * Wait Queue API
+ * --------------------------------------------------------------------------- */
+
+void wait_queue_init(wait_queue_t *wq)
+{
+    if (wq != NULL) {
+        list_init(&wq->waiters);
+        spin_lock_init(&wq->lock);
+    }
+}
+
+bool wait_queue_empty(const wait_queue_t *wq)
+{
+    return wq == NULL || list_is_empty(&wq->waiters);
+}
+
+void wait_queue_wait(wait_queue_t *wq)
+{
+    if (wq == NULL) {
+        return;
+    }
+
+    if (!sync_can_block()) {
+        /* No task to put to sleep: wait for the next interrupt instead */
+        __asm__ volatile("sti; hlt; cli");
+        return;
+    }
+
+    uint32_t flags = interrupts_save_and_disable();
+    wq_sleep(wq, NULL, WAIT_FOREVER);
+    interrupts_restore(flags);
+}
+
+bool wait_queue_wait_timeout(wait_queue_t *wq, uint32_t ticks)
+{
+    if (wq == NULL || ticks == 0) {
+        return false;
+    }
+
+    if (!sync_can_block()) {
+        __asm__ volatile("sti; hlt; cli");
+        return false;
+    }
+
+    uint32_t flags = interrupts_save_and_disable();
+    bool woken = wq_sleep(wq, NULL, ticks);
+    interrupts_restore(flags);
+    return woken;
+}
+
+bool wait_queue_wait_unlock(wait_queue_t *wq, spinlock_t *lock, uint32_t ticks)
+{
+    if (wq == NULL || lock == NULL || ticks == 0) {
+        return false;
+    }
+
+    if (!sync_can_block()) {
+        spin_unlock(lock);
+        __asm__ volatile("sti; hlt; cli");
+        spin_lock(lock);
+        return false;
+    }
+
+    return wq_sleep(wq, lock, ticks);
+}
+
+void wait_queue_add(wait_queue_t *wq, wait_entry_t *entry)
+{
+    if (wq == NULL || entry == NULL) {
+        return;
+    }
+    entry->task = task_current();
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    wq_enqueue(wq, entry);
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void wait_queue_add_callback(wait_queue_t *wq, wait_entry_t *entry,
+                             void (*notify)(wait_entry_t *entry))
+{
+    if (wq == NULL || entry == NULL || notify == NULL) {
+        return;
+    }
+    entry->task = NULL;
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    wq_enqueue(wq, entry);
+    entry->notify = notify;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+bool wait_queue_remove(wait_entry_t *entry)
+{
+    if (entry == NULL) {
+        return false;
+    }
+
+    /* A waker may dequeue it meanwhile; hangup is serialised by the caller */
+    wait_queue_t *wq = entry->queue;
+    if (wq != NULL) {
+        uint32_t flags = spin_lock_irqsave(&wq->lock);
+        if (entry->queue == wq) {
+            wq_unlink(entry);
+        }
+        spin_unlock_irqrestore(&wq->lock, flags);
+    }
+    return entry->woken;
+}
+
+bool wait_entries_sleep(uint32_t ticks)
+{
+    if (ticks == 0) {
+        return false;
+    }
+
+    if (!sync_can_block()) {
+        __asm__ volatile("sti; hlt; cli");
+        return ticks == WAIT_FOREVER;
+    }
+
+    task_t *self = task_current();
+    bool timed = (ticks != WAIT_FOREVER);
+    uint32_t deadline = pit_get_ticks() + ticks;
+
+    self->state = TASK_STATE_BLOCKED;
+    if (timed) {
+        self->sleep_until = deadline;
+        scheduler_timeout_add(self);
+    }
+    schedule();
+    interrupts_disable();
+
+    if (timed) {
+        scheduler_timeout_cancel(self);
+        return (int32_t)(pit_get_ticks() - deadline) < 0;
+    }
+    return true;
+}
+
+task_t *wait_queue_wake_one(wait_queue_t *wq)
+{
+    if (wq == NULL) {
+        return NULL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    wq_notify(wq);
+    wait_entry_t *entry = wq_best(wq);
+    task_t *task = (entry != NULL) ? wq_wake(entry) : NULL;
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    return task;
+}
+
+uint32_t wait_queue_wake_all(wait_queue_t *wq)
+{
+    if (wq == NULL) {
+        return 0;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    uint32_t woken = wq_wake_all(wq);
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    return woken;
+}
+
+void wait_queue_hangup(wait_queue_t *wq)
+{
+    if (wq == NULL) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    wq_wake_all(wq);
+    list_node_t *node;
+    while ((node = wq->waiters.head) != NULL) {
+        wq_unlink(list_entry(node, wait_entry_t, node));
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Mutex API
+ * --------------------------------------------------------------------------- */
+
+void mutex_init(mutex_t *mutex)
+{
+    if (mutex == NULL) {
+        return;
+    }
+    mutex->owner = NULL;
+    wait_queue_init(&mutex->waiters);
+    list_node_init(&mutex->held_node);
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    task_t *self = task_current();
+    if (mutex == NULL || self == NULL) {
+        return;     /* Single-threaded boot: nothing to exclude */
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+
+    if (mutex->owner == self) {
+        PANIC("mutex_lock: mutex already held by caller");
+    }
+    if (mutex->owner != NULL && !scheduler_is_running()) {
+        PANIC("mutex_lock: contended before the scheduler runs");
+    }
+
+    wait_entry_t entry;
+    entry.task = self;
+    mutex_acquire_locked(mutex, self, &entry);
+
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+bool mutex_trylock(mutex_t *mutex)
+{
+    task_t *self = task_current();
+    if (mutex == NULL || self == NULL) {
+        return mutex != NULL;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+    bool acquired = (mutex->owner == NULL);
+    if (acquired) {
+        mutex_take(mutex, self);
+    }
+    spin_unlock_irqrestore(&sync_lock, flags);
+
+    return acquired;
+}
+
+bool mutex_unlock(mutex_t *mutex)
+{
+    task_t *self = task_current();
+    if (mutex == NULL) {
+        return false;
+    }
+    if (self == NULL) {
+        return true;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+
+    if (mutex->owner != self) {
+        spin_unlock_irqrestore(&sync_lock, flags);
+        return false;
+    }
+
+    bool preempt = mutex_release_locked(mutex, self);
+    spin_unlock_irqrestore(&sync_lock, flags);
+
+    /* Hand the CPU to the new owner too if it outranks us now */
+    if (preempt) {
+        schedule();
+    }
+    return true;
+}
+
+bool mutex_is_held(const mutex_t *mutex)
+{
+    return mutex != NULL && mutex->owner != NULL && mutex->owner == task_current();
+}
+
+/* ---------------------------------------------------------------------------
+ * Semaphore API
+ * --------------------------------------------------------------------------- */
+
+void sem_init(semaphore_t *sem, uint32_t count)
+{
+    if (sem == NULL) {
+        return;
+    }
+    sem->count = count;
+    wait_queue_init(&sem->waiters);
+}
+
+void sem_wait(semaphore_t *sem)
+{
+    if (sem == NULL) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+
+    if (sem->count > 0) {
+        sem->count--;
+    } else if (!sync_can_block()) {
+        /* Boot context: wait for an interrupt handler to post */
+        while (sem->count == 0) {
+            spin_unlock(&sync_lock);
+            __asm__ volatile("sti; hlt; cli");
+            spin_lock(&sync_lock);
+        }
+        sem->count--;
+    } else {
+        wait_entry_t entry;
+        entry.task = task_current();
+        wq_enqueue(&sem->waiters, &entry);
+
+        /* sem_post() hands us the unit directly; count is never raised */
+        while (!entry.woken) {
+            sync_sleep(&entry, &sync_lock);
+        }
+    }
+
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+bool sem_trywait(semaphore_t *sem)
+{
+    if (sem == NULL) {
+        return false;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+    bool taken = (sem->count > 0);
+    if (taken) {
+        sem->count--;
+    }
+    spin_unlock_irqrestore(&sync_lock, flags);
+
+    return taken;
+}
+
+void sem_post(semaphore_t *sem)
+{
+    if (sem == NULL) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+    wait_entry_t *entry = wq_best(&sem->waiters);
+    if (entry != NULL) {
+        wq_wake(entry);
+    } else {
+        sem->count++;
+    }
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+uint32_t sem_count(const semaphore_t *sem)
+{
+    return (sem != NULL) ? sem->count : 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Condition Variable API
+ * --------------------------------------------------------------------------- */
+
+void cond_init(condvar_t *cond)
+{
+    if (cond == NULL) {
+        return;
+    }
+    wait_queue_init(&cond->waiters);
+    cond->mutex = NULL;
+}
+
+void cond_wait(condvar_t *cond, mutex_t *mutex)
+{
+    task_t *self = task_current();
+    if (cond == NULL || mutex == NULL) {
+        return;
+    }
+    if (self == NULL || !scheduler_is_running()) {
+        __asm__ volatile("sti; hlt; cli");
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+
+    if (mutex->owner != self) {
+        PANIC("cond_wait: mutex not held by caller");
+    }
+
+    wait_entry_t entry;
+    entry.task = self;
+    wq_enqueue(&cond->waiters, &entry);
+    cond->mutex = mutex;
+
+    mutex_release_locked(mutex, self);
+
+    /*
+     * cond_signal() either hands us the mutex and wakes us, or moves the
+     * entry onto the mutex's queue, where mutex_unlock() later does. Either
+     * way we only return once we own the mutex again.
+     */
+    while (mutex->owner != self) {
+        sync_sleep(&entry, &sync_lock);
+    }
+
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+/**
+ * @brief Move one waiter from the condition onto its mutex
+ */
+static bool cond_signal_locked(condvar_t *cond)
+{
+    wait_entry_t *entry = wq_best(&cond->waiters);
+    if (entry == NULL) {
+        return false;
+    }
+
+    mutex_t *mutex = cond->mutex;
+    task_t *task = entry->task;
+    wq_unlink(entry);
+
+    if (mutex->owner == NULL) {
+        mutex_take(mutex, task);
+        entry->woken = true;
+        task_wakeup(task);
+    } else {
+        /* Wait morphing: no point waking it just to block on the mutex */
+        wq_enqueue(&mutex->waiters, entry);
+        task->blocked_on = mutex;
+        pi_propagate(mutex->owner);
+    }
+
+    return true;
+}
+
+void cond_signal(condvar_t *cond)
+{
+    if (cond == NULL) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+    cond_signal_locked(cond);
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+void cond_broadcast(condvar_t *cond)
+{
+    if (cond == NULL) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sync_lock);
+    while (cond_signal_locked(cond)) {
+        /* First waiter may get a free mutex; the rest queue behind it */
+    }
+    spin_unlock_irqrestore(&sync_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Priority Inheritance Support
+ * --------------------------------------------------------------------------- */
+
+uint8_t sync_effective_priority(const task_t *task)
+{
+    uint8_t best = task->base_priority;
+
+    for (list_node_t *held = task->held_mutexes.head; held != NULL; held = held->next) {
+        mutex_t *mutex = list_entry(held, mutex_t, held_node);
+        wait_entry_t *top = wq_best(&mutex->waiters);
+        if (top != NULL && top->task->priority < best) {
+            best = top->task->priority;
+        }
+    }
+
+    return best;
+}
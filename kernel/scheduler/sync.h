@@ -0,0 +1,330 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/sync.h
+ * ===========================================================================
+ *
+ * Blocking Synchronization Primitives
+ *
+ * Wait queues, mutexes, counting semaphores and condition variables. Waiting
+ * tasks are moved to TASK_STATE_BLOCKED and take no CPU time until woken.
+ *
+ * Direct Handoff:
+ *   A released mutex or posted semaphore unit is given straight to the
+ *   highest-priority waiter (FIFO among equals) before it is woken, so a
+ *   task that arrives in the meantime cannot barge in and the woken task
+ *   never has to retry.
+ *
+ * Priority Inheritance:
+ *   While a mutex has waiters, its owner runs at the best priority among
+ *   them (following chains of owners that are themselves blocked on other
+ *   mutexes). The owner drops back to base_priority, or to whatever its
+ *   remaining mutexes still require, when it unlocks.
+ *
+ * Context Rules:
+ *   - wait_queue_wake_*(), sem_post() and sem_trywait() are safe from IRQ
+ *     and bottom-half context
+ *   - Everything that can block must be called from a task
+ *   - Callback entries (wait_queue_add_callback) are told about every wake
+ *     of their queue and stay queued; they never receive a handoff. They
+ *     run under the queue's lock and may only take locks to its right in
+ *     the lock order (spinlock.h), such as another queue's wake
+ *   - Before the scheduler runs (no current task), mutexes are no-ops and
+ *     waits halt until the next interrupt, so early boot code can share
+ *     paths with task code
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_SYNC_H
+#define NEXA_SYNC_H
+
+#include "../../config/os_config.h"
+#include "../../lib/dsa/list.h"
+#include "task.h"
+#include "spinlock.h"
+
+/* ---------------------------------------------------------------------------
+ * Wait Queue
+ * --------------------------------------------------------------------------- */
+typedef struct wait_queue {
+    list_t waiters;             /* wait_entry_t, in arrival order */
+    spinlock_t lock;            /* Guards waiters (leaf, above sched_lock) */
+} wait_queue_t;
+
+/* One waiting task; lives on the waiter's stack while it sleeps */
+typedef struct wait_entry {
+    list_node_t node;           /* Link in wait_queue_t::waiters */
+    task_t *task;               /* Sleeping task */
+    wait_queue_t *queue;        /* Queue the entry is on (NULL = none) */
+    bool woken;                 /* Set by the waker (resource handed over) */
+    void (*notify)(struct wait_entry *entry);   /* Callback entry (no task) */
+} wait_entry_t;
+
+#define WAIT_QUEUE_INIT(name)   { { NULL, NULL, 0 }, SPINLOCK_INIT }
+
+/* ---------------------------------------------------------------------------
+ * Mutex (priority inheritance)
+ * --------------------------------------------------------------------------- */
+typedef struct mutex {
+    task_t *owner;              /* Holding task (NULL = unlocked) */
+    wait_queue_t waiters;       /* Tasks blocked in mutex_lock() */
+    list_node_t held_node;      /* Link in owner->held_mutexes */
+} mutex_t;
+
+/* ---------------------------------------------------------------------------
+ * Counting Semaphore
+ * --------------------------------------------------------------------------- */
+typedef struct semaphore {
+    uint32_t count;             /* Available units */
+    wait_queue_t waiters;       /* Tasks blocked in sem_wait() */
+} semaphore_t;
+
+/* ---------------------------------------------------------------------------
+ * Condition Variable
+ * --------------------------------------------------------------------------- */
+typedef struct condvar {
+    wait_queue_t waiters;       /* Tasks blocked in cond_wait() */
+    mutex_t *mutex;             /* Mutex the current waiters released */
+} condvar_t;
+
+/* ---------------------------------------------------------------------------
+ * Wait Queue API
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize an empty wait queue
+ */
+void wait_queue_init(wait_queue_t *wq);
+
+/**
+ * @brief Check if any task is waiting
+ */
+bool wait_queue_empty(const wait_queue_t *wq);
+
+/**
+ * @brief Sleep on a wait queue until woken
+ *
+ * Must be called with the kernel lock held, after checking the wait
+ * condition; returns with it held. Callers loop:
+ *
+ *     flags = kernel_lock_irqsave();
+ *     while (!condition) wait_queue_wait(&wq);
+ *     kernel_unlock_irqrestore(flags);
+ *
+ * Conditions guarded by a spinlock use wait_queue_wait_unlock() instead.
+ *
+ * @param wq Queue to sleep on
+ */
+void wait_queue_wait(wait_queue_t *wq);
+
+/**
+ * @brief Sleep on a wait queue, dropping a spinlock while asleep
+ *
+ * For conditions guarded by a spinlock rather than the kernel lock. Call
+ * with lock held and interrupts disabled, after checking the condition.
+ * The task is queued before lock is released, so a waker that changes the
+ * condition under lock and then wakes the queue is never missed. Returns
+ * with lock held again.
+ *
+ * @param wq    Queue to sleep on
+ * @param lock  Spinlock guarding the condition (not wq's own)
+ * @param ticks Timer ticks to wait at most (WAIT_FOREVER = no limit)
+ * @return true if woken through the queue, false on timeout
+ */
+bool wait_queue_wait_unlock(wait_queue_t *wq, spinlock_t *lock, uint32_t ticks);
+
+/**
+ * @brief Sleep on a wait queue until woken or a timeout expires
+ *
+ * Same calling rules as wait_queue_wait(). The task also sits on the sleep
+ * wheel, so whichever comes first - a wakeup or the deadline - makes it
+ * runnable. Before the scheduler runs this waits for one interrupt.
+ *
+ * @param wq    Queue to sleep on
+ * @param ticks Timer ticks to wait at most (0 returns at once)
+ * @return true if woken through the queue, false on timeout
+ */
+bool wait_queue_wait_timeout(wait_queue_t *wq, uint32_t ticks);
+
+/**
+ * @brief Queue the calling task on a wait queue without sleeping
+ *
+ * For waiting on several queues at once: add an entry (on the caller's
+ * stack) to each queue, sleep with wait_entries_sleep(), then remove every
+ * entry. Must be called with the kernel lock held.
+ *
+ * @param wq    Queue to watch
+ * @param entry Caller-owned entry, not on any queue
+ */
+void wait_queue_add(wait_queue_t *wq, wait_entry_t *entry);
+
+/**
+ * @brief Watch a wait queue with a callback instead of a task
+ *
+ * The callback runs, under the queue's lock and possibly from IRQ
+ * context, on every wake_one/wake_all of the queue, and the entry stays
+ * queued until wait_queue_remove(). The callback must not change 'wq'.
+ * The queues that have callbacks (poll sources) are all woken under the
+ * kernel lock, which the callback may rely on.
+ *
+ * @param wq     Queue to watch
+ * @param entry  Caller-owned entry, not on any queue
+ * @param notify Function told about each wake
+ */
+void wait_queue_add_callback(wait_queue_t *wq, wait_entry_t *entry,
+                             void (*notify)(wait_entry_t *entry));
+
+/**
+ * @brief Take an entry added with wait_queue_add() off its queue
+ *
+ * Safe if a waker already dequeued it. Kernel lock held.
+ *
+ * @return true if the entry was woken through its queue
+ */
+bool wait_queue_remove(wait_entry_t *entry);
+
+/**
+ * @brief Sleep until any entry added with wait_queue_add() is woken
+ *
+ * Kernel lock held on entry and return. Callers re-check their
+ * conditions afterwards, as with wait_queue_wait().
+ *
+ * @param ticks Timer ticks to wait at most (WAIT_FOREVER = no limit)
+ * @return false if the timeout expired first
+ */
+bool wait_entries_sleep(uint32_t ticks);
+
+#define WAIT_FOREVER            0xFFFFFFFFu
+
+/**
+ * @brief Wake the highest-priority waiter
+ *
+ * @return The woken task, or NULL if the queue was empty
+ */
+task_t *wait_queue_wake_one(wait_queue_t *wq);
+
+/**
+ * @brief Wake every waiter
+ *
+ * @return Number of tasks woken
+ */
+uint32_t wait_queue_wake_all(wait_queue_t *wq);
+
+/**
+ * @brief Wake every waiter and empty the queue before it is freed
+ *
+ * For objects that go away while callback entries (epoll items) may still
+ * watch them: the callbacks see one last wake, then every entry is taken
+ * off, so a later wait_queue_remove() on one of them does not touch the
+ * freed queue.
+ */
+void wait_queue_hangup(wait_queue_t *wq);
+
+/* ---------------------------------------------------------------------------
+ * Mutex API
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize an unlocked mutex
+ */
+void mutex_init(mutex_t *mutex);
+
+/**
+ * @brief Acquire a mutex, blocking while another task holds it
+ *
+ * The owner inherits the caller's priority while the caller waits.
+ * Locking a mutex the caller already holds is a bug and panics.
+ */
+void mutex_lock(mutex_t *mutex);
+
+/**
+ * @brief Acquire a mutex only if it is free
+ *
+ * @return true if acquired
+ */
+bool mutex_trylock(mutex_t *mutex);
+
+/**
+ * @brief Release a mutex, handing it to the best waiter
+ *
+ * @return false if the caller does not own the mutex
+ */
+bool mutex_unlock(mutex_t *mutex);
+
+/**
+ * @brief Check if the calling task holds a mutex
+ */
+bool mutex_is_held(const mutex_t *mutex);
+
+/* ---------------------------------------------------------------------------
+ * Semaphore API
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize a semaphore with count units
+ */
+void sem_init(semaphore_t *sem, uint32_t count);
+
+/**
+ * @brief Take a unit, blocking until one is available
+ */
+void sem_wait(semaphore_t *sem);
+
+/**
+ * @brief Take a unit only if one is available
+ *
+ * @return true if a unit was taken
+ */
+bool sem_trywait(semaphore_t *sem);
+
+/**
+ * @brief Release a unit (handed directly to a waiter if there is one)
+ */
+void sem_post(semaphore_t *sem);
+
+/**
+ * @brief Get the number of available units
+ */
+uint32_t sem_count(const semaphore_t *sem);
+
+/* ---------------------------------------------------------------------------
+ * Condition Variable API
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize a condition variable
+ */
+void cond_init(condvar_t *cond);
+
+/**
+ * @brief Atomically release mutex and wait; reacquires it before returning
+ *
+ * Like any condition variable, re-check the predicate after waking.
+ */
+void cond_wait(condvar_t *cond, mutex_t *mutex);
+
+/**
+ * @brief Wake one waiter
+ *
+ * If the mutex is held, the waiter moves straight onto the mutex's wait
+ * queue instead of waking only to block again.
+ */
+void cond_signal(condvar_t *cond);
+
+/**
+ * @brief Wake every waiter
+ */
+void cond_broadcast(condvar_t *cond);
+
+/* ---------------------------------------------------------------------------
+ * Priority Inheritance Support
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Best (lowest) priority a task must run at
+ *
+ * min(base_priority, priority of every waiter on a mutex it holds).
+ */
+uint8_t sync_effective_priority(const task_t *task);
+
+#endif /* NEXA_SYNC_H */
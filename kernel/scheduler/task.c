@@ -14,7 +14,27 @@
  * - Scheduling metadata (priority, state, time accounting)
  *
  * The implementation uses a fixed-size task table where each slot is either
- * UNUSED (free) or contains an active task.
+ * UNUSED (free) or contains an active task. Free slots are chained on a
+ * free list, so finding a slot is O(1).
+ *
+ * Default-sized stacks come from a pool, each with a guard page below it.
+ * With paging on, a stack is a slot of the kernel stack window: its pages
+ * are mapped 4KB at a time and the guard page never is, so running off the
+ * bottom of the stack faults on the spot (a double fault, handled on its
+ * own TSS stack, since the #PF frame cannot be pushed either). A slot keeps
+ * its frames once populated: unmapping them would need a TLB shootdown on
+ * every CPU. With paging off, stacks are frame runs whose guard page is
+ * filled with a pattern that is checked when the stack is returned, and at
+ * most TASK_STACK_POOL_MAX released stacks are kept. Either way spawning
+ * and reaping tasks does not touch the heap.
+ *
+ * FPU/SSE state is switched lazily. Every context switch to a task that
+ * does not own the FPU sets CR0.TS; the task's first FPU or SSE instruction
+ * then raises #NM, and only then is the previous owner's state saved with
+ * FXSAVE and the new task's restored with FXRSTOR. Tasks that never touch
+ * the FPU never pay for it. The owner is tracked per CPU; once more than one
+ * CPU is online a task's registers are saved when it is switched out, since
+ * it may next run on a CPU whose FPU does not hold them.
  *
  * ===========================================================================
  */
@@ -22,17 +42,27 @@
 #include "task.h"
 #include "../memory/memory.h"
 #include "../drivers/drivers.h"
+#include "../interrupts/interrupts.h"
+#include "dsa_structures.h"
+#include "sync.h"
+#include "smp.h"
+#include "spinlock.h"
 
 /* ---------------------------------------------------------------------------
  * External Functions (from assembly)
  * --------------------------------------------------------------------------- */
-extern void cpu_cli(void);          /* Disable interrupts */
-extern void cpu_sti(void);          /* Enable interrupts */
 
 /* Forward declaration of scheduler functions */
 extern void schedule(void);
 extern void scheduler_add_task(task_t *task);
 extern void scheduler_remove_task(task_t *task);
+extern void scheduler_requeue_task(task_t *task);
+extern void scheduler_wake_task(task_t *task);
+extern void scheduler_timeout_add(task_t *task);
+extern void scheduler_finish_switch(void);
+
+/* VFS: close a descriptor table (kernel/fs/vfs.c) */
+extern void vfs_fd_table_destroy(struct vfs_fd_table *table);
 
 /* ---------------------------------------------------------------------------
  * Static Variables
@@ -41,9 +71,6 @@ extern void scheduler_remove_task(task_t *task);
 /* Task table - holds all TCBs */
 static task_t task_table[MAX_TASKS];
 
-/* Current running task */
-static task_t *current_task = NULL;
-
 /* Next available PID */
 static uint32_t next_pid = 0;
 
@@ -53,23 +80,290 @@ static uint32_t active_task_count = 0;
 /* Flag indicating task system is initialized */
 static bool task_system_initialized = false;
 
+/* Free TCB slots, linked through task->next */
+static task_t *free_task_list = NULL;
+
+/* ---------------------------------------------------------------------------
+ * Task Stack Pool
+ * ---------------------------------------------------------------------------
+ * Stack layout (TASK_STACK_SIZE + one guard page), either a slot of the
+ * kernel stack window or a frame run:
+ *
+ *   [ guard page | stack .......................... ]
+ *   ^ slot start ^ stack_base                       ^ initial ESP
+ *
+ * Free stacks are linked through their first word.
+ * --------------------------------------------------------------------------- */
+#define STACK_POOL_PAGES        (TASK_STACK_SIZE / PAGE_SIZE + 1)
+#define STACK_SLOT_SIZE         (STACK_POOL_PAGES * PAGE_SIZE)
+#define STACK_WINDOW_SLOTS      (KERNEL_STACK_WINDOW_SIZE / STACK_SLOT_SIZE)
+#define STACK_GUARD_PATTERN     0x57ACC0DEU
+#define STACK_GUARD_CHECK_WORDS 64      /* Top of the guard, nearest the stack */
+
+typedef struct stack_pool {
+    void *free_list;        /* Idle stacks */
+    uint32_t free_count;    /* Stacks on free_list */
+    uint32_t total;         /* Stacks currently backed by frames */
+    uint32_t slots;         /* Window slots handed out (paging on) */
+} stack_pool_t;
+
+static stack_pool_t stack_pool;
+
+/* Lazy FPU state (the owner and cached CR0.TS live in cpu_local_t) */
+static bool fpu_available = false;      /* FPU enabled by fpu_init() */
+static bool fpu_has_fxsr = false;       /* FXSAVE/FXRSTOR supported */
+static bool fpu_has_sse = false;        /* MXCSR present */
+
+/* CR0/CR4 bits used by the lazy FPU code */
+#define CR0_MP          (1U << 1)       /* Monitor coprocessor (WAIT traps on TS) */
+#define CR0_EM          (1U << 2)       /* Emulate FPU */
+#define CR0_TS          (1U << 3)       /* Task switched */
+#define CR0_NE          (1U << 5)       /* Native FPU error reporting */
+#define CR4_OSFXSR      (1U << 9)       /* FXSAVE/FXRSTOR and SSE enabled */
+#define CR4_OSXMMEXCPT  (1U << 10)      /* Unmasked SSE exceptions raise #XM */
+
+/* CPUID leaf 1 EDX feature bits */
+#define CPUID_EDX_FPU   (1U << 0)
+#define CPUID_EDX_FXSR  (1U << 24)
+#define CPUID_EDX_SSE   (1U << 25)
+
+/* MXCSR reset value: all exceptions masked, round to nearest */
+#define MXCSR_DEFAULT   0x1F80
+
 /* ---------------------------------------------------------------------------
  * Internal Helper Functions
  * --------------------------------------------------------------------------- */
 
+static inline uint32_t read_cr0(void)
+{
+    uint32_t value;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint32_t value)
+{
+    __asm__ volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+/**
+ * @brief Detect and enable the FPU, leaving CR0.TS set
+ * 
+ * CPUID is assumed present (any 486DX4 or later CPU).
+ */
+static void fpu_init(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+    if (!(edx & CPUID_EDX_FPU)) {
+        fpu_available = false;
+        return;
+    }
+
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+
+    fpu_has_fxsr = (edx & CPUID_EDX_FXSR) != 0;
+    if (fpu_has_fxsr) {
+        uint32_t cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        fpu_has_sse = (edx & CPUID_EDX_SSE) != 0;
+        if (fpu_has_sse) {
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
+    }
+
+    __asm__ volatile("fninit");
+
+    cpu_local_t *cpu = smp_this_cpu();
+    cpu->fpu_owner = NULL;
+    fpu_available = true;
+    cpu->fpu_ts_set = true;
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+/**
+ * @brief Save a task's FPU registers into its fpu_state
+ */
+static void fpu_save(task_t *task)
+{
+    if (fpu_has_fxsr) {
+        __asm__ volatile("fxsave %0" : "=m"(task->fpu_state));
+    } else {
+        __asm__ volatile("fnsave %0" : "=m"(task->fpu_state));
+    }
+    task->flags |= TASK_FLAG_FPU_USED;
+}
+
 /**
- * @brief Find a free slot in the task table
+ * @brief Take a free slot from the task table
+ * 
+ * Time Complexity: O(1)
  * 
  * @return Pointer to free task slot, or NULL if table is full
  */
 static task_t *find_free_task_slot(void)
 {
-    for (uint32_t i = 0; i < MAX_TASKS; i++) {
-        if (task_table[i].state == TASK_STATE_UNUSED) {
-            return &task_table[i];
+    uint32_t flags = kernel_lock_irqsave();
+    task_t *task = free_task_list;
+    if (task != NULL) {
+        free_task_list = task->next;
+        task->next = NULL;
+        task->state = TASK_STATE_CREATING;
+    }
+    kernel_unlock_irqrestore(flags);
+    return task;
+}
+
+/**
+ * @brief Return an UNUSED slot to the free list
+ */
+static void release_task_slot(task_t *task)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    task->next = free_task_list;
+    free_task_list = task;
+    kernel_unlock_irqrestore(flags);
+}
+
+/**
+ * @brief Check if an address lies in the kernel stack window
+ */
+static bool task_stack_in_window(uintptr_t addr)
+{
+    return addr >= KERNEL_STACK_WINDOW &&
+           addr < KERNEL_STACK_WINDOW + STACK_WINDOW_SLOTS * STACK_SLOT_SIZE;
+}
+
+/**
+ * @brief Populate a fresh slot of the kernel stack window
+ * 
+ * Every frame is taken before anything is mapped, so a failure leaves no
+ * PTE behind (and nothing for another CPU's TLB to hold on to).
+ * 
+ * @return Stack base (just above the unmapped guard page), or NULL
+ */
+static void *stack_window_grow(void)
+{
+    uintptr_t frames[STACK_POOL_PAGES - 1];
+    uint32_t count = 0;
+    while (count < STACK_POOL_PAGES - 1) {
+        frames[count] = frame_alloc();
+        if (frames[count] == 0) {
+            break;
         }
+        count++;
     }
-    return NULL;
+
+    uint32_t slot = STACK_WINDOW_SLOTS;
+    if (count == STACK_POOL_PAGES - 1) {
+        uint32_t flags = kernel_lock_irqsave();
+        if (stack_pool.slots < STACK_WINDOW_SLOTS) {
+            slot = stack_pool.slots++;
+        }
+        kernel_unlock_irqrestore(flags);
+    }
+    if (slot == STACK_WINDOW_SLOTS) {
+        while (count > 0) {
+            frame_free(frames[--count]);
+        }
+        return NULL;
+    }
+
+    uintptr_t stack = KERNEL_STACK_WINDOW + slot * STACK_SLOT_SIZE + PAGE_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!paging_map(NULL, stack + i * PAGE_SIZE, frames[i], PAGE_WRITABLE)) {
+            PANIC("Kernel stack window has no page table");
+        }
+    }
+
+    __atomic_add_fetch(&stack_pool.total, 1, __ATOMIC_RELAXED);
+    return (void *)stack;
+}
+
+/**
+ * @brief Allocate a fresh pool stack
+ * 
+ * @return Stack base (just above the guard page), or NULL if out of frames
+ */
+static void *stack_pool_grow(void)
+{
+    if (paging_enabled()) {
+        return stack_window_grow();
+    }
+
+    uintptr_t run = frame_alloc_contiguous(STACK_POOL_PAGES);
+    if (run == 0) {
+        return NULL;
+    }
+
+    uint32_t *guard = (uint32_t *)run;
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++) {
+        guard[i] = STACK_GUARD_PATTERN;
+    }
+
+    __atomic_add_fetch(&stack_pool.total, 1, __ATOMIC_RELAXED);
+    return (void *)(run + PAGE_SIZE);
+}
+
+/**
+ * @brief Get a default-sized stack
+ * 
+ * Time Complexity: O(1) when the pool has an idle stack
+ */
+static void *stack_pool_alloc(void)
+{
+    uint32_t flags = kernel_lock_irqsave();
+    void *stack = stack_pool.free_list;
+    if (stack != NULL) {
+        stack_pool.free_list = *(void **)stack;
+        stack_pool.free_count--;
+    }
+    kernel_unlock_irqrestore(flags);
+
+    return (stack != NULL) ? stack : stack_pool_grow();
+}
+
+/**
+ * @brief Return a default-sized stack to the pool
+ * 
+ * Window stacks always go back on the free list. A frame-run stack is
+ * checked first: panics if the task overran it into the guard page.
+ */
+static void stack_pool_free(void *stack)
+{
+    bool windowed = task_stack_in_window((uintptr_t)stack);
+    if (!windowed) {
+        uint32_t *guard_top = (uint32_t *)stack - STACK_GUARD_CHECK_WORDS;
+        for (uint32_t i = 0; i < STACK_GUARD_CHECK_WORDS; i++) {
+            if (guard_top[i] != STACK_GUARD_PATTERN) {
+                PANIC("Task stack overflow: guard page overwritten");
+            }
+        }
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    if (windowed || stack_pool.free_count < TASK_STACK_POOL_MAX) {
+        *(void **)stack = stack_pool.free_list;
+        stack_pool.free_list = stack;
+        stack_pool.free_count++;
+        stack = NULL;
+    } else {
+        stack_pool.total--;
+    }
+    kernel_unlock_irqrestore(flags);
+
+    if (stack != NULL) {
+        frame_free_contiguous((uintptr_t)stack - PAGE_SIZE, STACK_POOL_PAGES);
+    }
+}
+
+bool task_stack_guard_hit(uintptr_t addr)
+{
+    return task_stack_in_window(addr) &&
+           (addr - KERNEL_STACK_WINDOW) % STACK_SLOT_SIZE < PAGE_SIZE;
 }
 
 /**
@@ -79,7 +373,7 @@ static task_t *find_free_task_slot(void)
  */
 static uint32_t allocate_pid(void)
 {
-    return next_pid++;
+    return __atomic_fetch_add(&next_pid, 1, __ATOMIC_RELAXED);
 }
 
 /**
@@ -109,13 +403,13 @@ static void safe_strncpy(char *dest, const char *src, size_t n)
 static void task_entry_wrapper(void)
 {
     /*
-     * Interrupts were disabled during context switch.
-     * Re-enable them now that we're in the task's context.
+     * The switch that got us here never returns through schedule():
+     * release the scheduler lock and re-enable interrupts from here.
      */
-    cpu_sti();
+    scheduler_finish_switch();
 
     /* Get current task and call its entry point */
-    task_t *task = current_task;
+    task_t *task = task_current();
     
     if (task != NULL && task->entry_point != NULL) {
         /* Clear the first-run flag */
@@ -135,9 +429,10 @@ static void task_entry_wrapper(void)
  * Creates a fake stack frame that looks like the task was interrupted,
  * so context_switch can "resume" it.
  * 
- * @param task Task to set up stack for
+ * @param task     Task to set up stack for
+ * @param reserved Bytes at the top of the stack to leave untouched
  */
-static void setup_task_stack(task_t *task)
+static void setup_task_stack(task_t *task, size_t reserved)
 {
     /*
      * Initial stack layout (growing downward, low address at top):
@@ -162,7 +457,7 @@ static void setup_task_stack(task_t *task)
      */
 
     /* Calculate the top of the stack (highest valid address) */
-    uint32_t *stack_top = (uint32_t *)((uint8_t *)task->stack_base + task->stack_size);
+    uint32_t *stack_top = (uint32_t *)((uint8_t *)task->stack_base + task->stack_size - reserved);
     
     /* Align stack to 16 bytes (required by some calling conventions) */
     stack_top = (uint32_t *)((uintptr_t)stack_top & ~0xF);
@@ -204,15 +499,31 @@ bool task_system_init(void)
         return true;  /* Already initialized */
     }
 
-    /* Clear all task slots */
-    for (uint32_t i = 0; i < MAX_TASKS; i++) {
+    /* Clear all task slots and chain them in table order */
+    free_task_list = NULL;
+    for (uint32_t i = MAX_TASKS; i-- > 0; ) {
         task_init(&task_table[i]);
+        release_task_slot(&task_table[i]);
     }
 
     /* Reset counters */
     next_pid = 0;
     active_task_count = 0;
-    current_task = NULL;
+    smp_this_cpu()->current = NULL;
+
+    /* Enable the FPU for lazy switching */
+    fpu_init();
+
+    /* Pre-populate the stack pool so early spawns never hit the allocator */
+    while (stack_pool.total < TASK_STACK_POOL_PREFILL) {
+        void *stack = stack_pool_grow();
+        if (stack == NULL) {
+            break;
+        }
+        *(void **)stack = stack_pool.free_list;
+        stack_pool.free_list = stack;
+        stack_pool.free_count++;
+    }
 
     task_system_initialized = true;
     return true;
@@ -240,14 +551,33 @@ void task_init(task_t *task)
     task->base_priority = TASK_PRIORITY_DEFAULT;
     task->flags = 0;
     task->time_slice = SCHEDULER_TIME_SLICE;
+    task->queue_level = TASK_QUEUE_LEVEL_NONE;
+    task->cpu = 0;
+    task->heap_index = -1;
+    task->vruntime = 0;
+    rb_node_clear(&task->run_node);
+    task->run_weight = 0;
 
     task->cpu_time = 0;
     task->start_time = 0;
     task->sleep_until = 0;
+    list_node_init(&task->sleep_node);
+    task->sleep_slot = -1;
+    task->ready_stamp = 0;
+    task->run_count = 0;
+    task->latency_last_ns = 0;
+    task->latency_max_ns = 0;
+
+    task->blocked_on = NULL;
+    list_init(&task->held_mutexes);
 
     task->entry_point = NULL;
     task->arg = NULL;
 
+    task->magazines = NULL;
+    task->address_space = NULL;
+    task->files = NULL;
+
     task->exit_code = 0;
 
     task->next = NULL;
@@ -272,15 +602,12 @@ task_t *task_create(const char *name,
         return NULL;
     }
 
-    /* Find a free task slot */
+    /* Take a free task slot (marked CREATING) */
     task_t *task = find_free_task_slot();
     if (task == NULL) {
         return NULL;  /* Task table full */
     }
 
-    /* Mark as creating (prevents race conditions) */
-    task->state = TASK_STATE_CREATING;
-
     /* Set up task identification */
     task->pid = allocate_pid();
     if (name != NULL) {
@@ -333,9 +660,14 @@ task_t *task_create(const char *name,
     /* Align stack size to page boundary */
     stack_size = ALIGN_UP(stack_size, PAGE_SIZE);
     
-    task->stack_base = kmalloc(stack_size);
+    if (stack_size == TASK_STACK_SIZE) {
+        task->stack_base = stack_pool_alloc();
+    } else {
+        task->stack_base = kmalloc(stack_size);
+    }
     if (task->stack_base == NULL) {
         task->state = TASK_STATE_UNUSED;
+        release_task_slot(task);
         return NULL;  /* Out of memory */
     }
     task->stack_size = stack_size;
@@ -344,36 +676,77 @@ task_t *task_create(const char *name,
     task->entry_point = entry_point;
     task->arg = arg;
 
+    /* Small kmalloc/kfree churn is recycled through the task's magazines */
+    task->magazines = heap_magazines_create();
+
     /* Initialize time accounting */
     task->cpu_time = 0;
     task->start_time = pit_get_ticks();
     task->sleep_until = 0;
+    task->perf_generation = 0;
 
     /* Set up the initial stack frame */
-    setup_task_stack(task);
+    setup_task_stack(task, 0);
+
+    /* Queue it on the creating CPU; idle CPUs steal from there */
+    task->cpu = (uint8_t)smp_cpu_id();
 
     /* Task is now ready to run */
     task->state = TASK_STATE_READY;
-    active_task_count++;
+    __atomic_add_fetch(&active_task_count, 1, __ATOMIC_RELAXED);
 
     return task;
 }
 
+/**
+ * @brief Reserve the top of a new task's stack for its entry point
+ */
+void *task_reserve_stack_top(task_t *task, size_t bytes)
+{
+    if (task == NULL || !(task->flags & TASK_FLAG_FIRST_RUN) ||
+        bytes > task->stack_size - TASK_MIN_STACK_SIZE / 2) {
+        return NULL;
+    }
+
+    setup_task_stack(task, bytes);
+    return (uint8_t *)task->stack_base + task->stack_size - bytes;
+}
+
 /**
  * @brief Terminate the current task
  */
 void task_exit(int32_t exit_code)
 {
-    /* Disable interrupts during state change */
-    cpu_cli();
+    task_t *task = task_current();
+
+    /* Pass on any mutexes the task still holds instead of orphaning waiters */
+    while (task != NULL && !list_is_empty(&task->held_mutexes)) {
+        mutex_unlock(list_entry(task->held_mutexes.head, mutex_t, held_node));
+    }
+
+    /* Drop its mappings now; the kernel stack is identity-mapped everywhere */
+    if (task != NULL && task->address_space != NULL) {
+        /* Detach first so a preemption in between reloads the kernel's */
+        address_space_t *as = task->address_space;
+        task->address_space = NULL;
+        address_space_destroy(as);
+    }
+
+    /* Close its descriptors */
+    if (task != NULL && task->files != NULL) {
+        struct vfs_fd_table *files = task->files;
+        task->files = NULL;
+        vfs_fd_table_destroy(files);
+    }
 
-    task_t *task = current_task;
     if (task == NULL) {
         /* No current task - shouldn't happen */
-        cpu_sti();
         return;
     }
 
+    /* Held into schedule(), so no CPU can pick the zombie up mid-change */
+    kernel_lock_irqsave();
+
     /* Store exit code */
     task->exit_code = exit_code;
 
@@ -384,14 +757,17 @@ void task_exit(int32_t exit_code)
     /* Remove from scheduler queues */
     scheduler_remove_task(task);
 
+    /* Its FPU registers no longer need saving */
+    cpu_local_t *cpu = smp_this_cpu();
+    if (cpu->fpu_owner == task) {
+        cpu->fpu_owner = NULL;
+    }
+
     /* Decrement active task count */
     if (active_task_count > 0) {
-        active_task_count--;
+        __atomic_sub_fetch(&active_task_count, 1, __ATOMIC_RELAXED);
     }
 
-    /* Re-enable interrupts and schedule next task */
-    cpu_sti();
-    
     /* This will never return - scheduler will pick another task */
     schedule();
     
@@ -418,12 +794,29 @@ void task_destroy(task_t *task)
 
     /* Free the stack */
     if (task->stack_base != NULL) {
-        kfree(task->stack_base);
+        if (task->stack_size == TASK_STACK_SIZE) {
+            stack_pool_free(task->stack_base);
+        } else {
+            kfree(task->stack_base);
+        }
         task->stack_base = NULL;
     }
 
-    /* Reset the task structure */
+    /* Hand cached heap blocks back to the shared depot */
+    heap_magazines_destroy(task->magazines);
+    task->magazines = NULL;
+
+    /* Unmap its areas (dropping their owners' references) */
+    address_space_destroy(task->address_space);
+    task->address_space = NULL;
+
+    /* Close any descriptors it still has open */
+    vfs_fd_table_destroy(task->files);
+    task->files = NULL;
+
+    /* Reset the task structure and recycle the slot */
     task_init(task);
+    release_task_slot(task);
 }
 
 /**
@@ -431,7 +824,7 @@ void task_destroy(task_t *task)
  */
 task_t *task_current(void)
 {
-    return current_task;
+    return smp_this_cpu()->current;
 }
 
 /**
@@ -443,7 +836,8 @@ task_t *task_current(void)
  */
 void task_set_current(task_t *task)
 {
-    current_task = task;
+    smp_this_cpu()->current = task;
+    heap_set_magazines(task ? task->magazines : NULL);
 }
 
 /**
@@ -476,7 +870,9 @@ void task_set_priority(task_t *task, uint8_t priority)
         if (priority >= MAX_PRIORITY_LEVELS) {
             priority = MAX_PRIORITY_LEVELS - 1;
         }
-        task->priority = priority;
+        task->base_priority = priority;
+        task->priority = sync_effective_priority(task);
+        scheduler_requeue_task(task);
     }
 }
 
@@ -545,20 +941,21 @@ void task_yield(void)
  */
 void task_sleep(uint32_t ticks)
 {
-    if (current_task == NULL || ticks == 0) {
+    task_t *task = task_current();
+    if (task == NULL || ticks == 0) {
         return;
     }
 
-    /* Disable interrupts during state change */
-    cpu_cli();
+    /* Marked asleep before the deadline is filed: an early expiry is seen */
+    uint32_t flags = interrupts_save_and_disable();
 
     /* Calculate wake-up time */
-    current_task->sleep_until = pit_get_ticks() + ticks;
-    current_task->state = TASK_STATE_SLEEPING;
+    task->sleep_until = pit_get_ticks() + ticks;
+    task->state = TASK_STATE_SLEEPING;
+    scheduler_timeout_add(task);
 
-    /* Re-enable interrupts and schedule another task */
-    cpu_sti();
     schedule();
+    interrupts_restore(flags);
 }
 
 /**
@@ -570,15 +967,8 @@ void task_wakeup(task_t *task)
         return;
     }
 
-    /* Only wake sleeping or blocked tasks */
-    if (task->state == TASK_STATE_SLEEPING || 
-        task->state == TASK_STATE_BLOCKED) {
-        task->state = TASK_STATE_READY;
-        task->sleep_until = 0;
-        
-        /* Re-add to scheduler ready queue */
-        scheduler_add_task(task);
-    }
+    /* Only sleeping or blocked tasks; sched_lock alone covers the change */
+    scheduler_wake_task(task);
 }
 
 /**
@@ -606,3 +996,109 @@ bool task_system_is_initialized(void)
 {
     return task_system_initialized;
 }
+
+/* ---------------------------------------------------------------------------
+ * Lazy FPU Context
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Prepare the FPU for a switch to next
+ * 
+ * Called by the scheduler with interrupts disabled, just before the
+ * register switch.
+ */
+void task_fpu_switch(task_t *next)
+{
+    if (!fpu_available) {
+        return;
+    }
+
+    cpu_local_t *cpu = smp_this_cpu();
+
+    /*
+     * With several CPUs online the outgoing task may resume elsewhere, so
+     * its registers cannot stay behind in this FPU.
+     */
+    task_t *prev = cpu->current;
+    if (smp_online_count() > 1 && prev != NULL && prev != next &&
+        cpu->fpu_owner == prev) {
+        if (cpu->fpu_ts_set) {
+            __asm__ volatile("clts");
+            cpu->fpu_ts_set = false;
+        }
+        fpu_save(prev);
+        cpu->fpu_owner = NULL;
+    }
+
+    bool want_ts = (next != cpu->fpu_owner);
+    if (want_ts == cpu->fpu_ts_set) {
+        return;     /* Avoid the CR0 write when nothing changes */
+    }
+
+    if (want_ts) {
+        write_cr0(read_cr0() | CR0_TS);
+    } else {
+        __asm__ volatile("clts");
+    }
+    cpu->fpu_ts_set = want_ts;
+}
+
+/**
+ * @brief Enable the FPU on an application processor
+ */
+void task_fpu_cpu_init(void)
+{
+    fpu_init();
+}
+
+/**
+ * @brief Handle a Device Not Available (#NM) trap
+ */
+bool task_fpu_handle_trap(void)
+{
+    if (!fpu_available) {
+        return false;
+    }
+
+    uint32_t flags = interrupts_save_and_disable();
+
+    cpu_local_t *cpu = smp_this_cpu();
+    __asm__ volatile("clts");
+    cpu->fpu_ts_set = false;
+
+    task_t *task = cpu->current;
+    if (cpu->fpu_owner != task) {
+        /* Save the previous owner's registers */
+        if (cpu->fpu_owner != NULL) {
+            fpu_save(cpu->fpu_owner);
+        }
+
+        /* Load the current task's, or start it from a clean state */
+        if (task != NULL && (task->flags & TASK_FLAG_FPU_USED)) {
+            if (fpu_has_fxsr) {
+                __asm__ volatile("fxrstor %0" : : "m"(task->fpu_state));
+            } else {
+                __asm__ volatile("frstor %0" : : "m"(task->fpu_state));
+            }
+        } else {
+            __asm__ volatile("fninit");
+            if (fpu_has_sse) {
+                uint32_t mxcsr = MXCSR_DEFAULT;
+                __asm__ volatile("ldmxcsr %0" : : "m"(mxcsr));
+            }
+        }
+
+        cpu->fpu_owner = task;
+    }
+
+    interrupts_restore(flags);
+    return true;
+}
+
+/**
+ * @brief Get the task whose state is live in the FPU registers
+ */
+task_t *task_fpu_owner(void)
+{
+    return smp_this_cpu()->fpu_owner;
+}
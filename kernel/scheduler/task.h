@@ -35,11 +35,14 @@
 #define NEXA_TASK_H
 
 #include "../../config/os_config.h"
+#include "../../lib/dsa/list.h"
+#include "../../lib/dsa/rbtree.h"
 
 /* ---------------------------------------------------------------------------
  * Forward Declarations
  * --------------------------------------------------------------------------- */
 struct task;
+struct mutex;
 typedef struct task task_t;
 
 /* ---------------------------------------------------------------------------
@@ -76,17 +79,24 @@ typedef enum task_state {
 /* Default priority for new tasks */
 #define TASK_PRIORITY_DEFAULT       TASK_PRIORITY_NORMAL
 
+/* queue_level value of a task that is not on the bitmap ready queue */
+#define TASK_QUEUE_LEVEL_NONE       0xFF
+
 /* ---------------------------------------------------------------------------
  * Task Flags
  * ---------------------------------------------------------------------------
  * Bit flags for special task behaviors and states.
  * --------------------------------------------------------------------------- */
 #define TASK_FLAG_KERNEL        (1 << 0)    /* Kernel task (ring 0) */
-#define TASK_FLAG_USER          (1 << 1)    /* User task (ring 3) - future */
+#define TASK_FLAG_USER          (1 << 1)    /* User process (ring 3, process.c) */
 #define TASK_FLAG_PREEMPTIBLE   (1 << 2)    /* Can be preempted */
 #define TASK_FLAG_IDLE          (1 << 3)    /* Idle task (lowest priority) */
 #define TASK_FLAG_FIRST_RUN     (1 << 4)    /* Task hasn't run yet */
 #define TASK_FLAG_NEEDS_CLEANUP (1 << 5)    /* Resources need cleanup */
+#define TASK_FLAG_FPU_USED      (1 << 6)    /* fpu_state holds saved context */
+
+/* Size of the FXSAVE/FXRSTOR area (FNSAVE needs only the first 108 bytes) */
+#define TASK_FPU_STATE_SIZE     512
 
 /* ---------------------------------------------------------------------------
  * CPU Register Context
@@ -168,12 +178,24 @@ struct task {
      * base_priority: Original priority (used after temporary boosts)
      * flags:         Task behavior flags
      * time_slice:    Remaining time slice in ticks
+     * queue_level:   Bitmap ready-queue level the task is linked on
+     * cpu:           CPU that last ran it; a ready task is on its queues
+     * heap_index:    Slot in the priority heap (-1 = not queued)
+     * vruntime:      Weighted CPU time (fair policy)
+     * run_node:      Link in the fair policy's vruntime tree
+     * run_weight:    Weight the task was queued with (fair policy)
      */
     task_state_t state;             /* Current task state */
     uint8_t priority;               /* Current priority (0-7) */
     uint8_t base_priority;          /* Base priority level */
     uint16_t flags;                 /* Task flags (TASK_FLAG_*) */
     uint32_t time_slice;            /* Remaining time slice (ticks) */
+    uint8_t queue_level;            /* TASK_QUEUE_LEVEL_NONE if not queued */
+    uint8_t cpu;                    /* Run queue owner (changed under sched_lock) */
+    int16_t heap_index;             /* Priority heap slot (-1 = not queued) */
+    uint64_t vruntime;              /* Virtual runtime (ticks << FAIR_VRUNTIME_SHIFT) */
+    rb_node_t run_node;             /* Fair run-queue linkage */
+    uint32_t run_weight;            /* Weight while on the fair run queue */
 
     /*
      * Time Accounting
@@ -181,10 +203,30 @@ struct task {
      * cpu_time:      Total CPU time used by this task (in ticks)
      * start_time:    System tick when task was created
      * sleep_until:   System tick when sleeping task should wake
+     * sleep_node:    Link in the sleep wheel slot holding the task
+     * sleep_slot:    Index of that slot (-1 = not on the wheel)
+     * ready_stamp:   clock_cycles() when the task last became ready
+     * run_count:     Number of times the task was switched to
+     * latency_*_ns:  Ready-to-running delay (last and worst seen)
      */
     uint32_t cpu_time;              /* Total CPU ticks consumed */
     uint32_t start_time;            /* Creation time (tick count) */
     uint32_t sleep_until;           /* Wake-up time for sleeping tasks */
+    list_node_t sleep_node;         /* Sleep wheel linkage */
+    int16_t sleep_slot;             /* Sleep wheel slot (-1 = none) */
+    uint64_t ready_stamp;           /* TSC at enqueue (0 = not stamped) */
+    uint32_t run_count;             /* Times scheduled in */
+    uint32_t latency_last_ns;       /* Most recent wakeup-to-run latency */
+    uint32_t latency_max_ns;        /* Worst wakeup-to-run latency */
+
+    /*
+     * Synchronization
+     * ---------------
+     * blocked_on:    Mutex the task is waiting for (priority inheritance)
+     * held_mutexes:  Mutexes the task owns (mutex_t::held_node)
+     */
+    struct mutex *blocked_on;       /* NULL unless blocked in mutex_lock() */
+    list_t held_mutexes;            /* Owned mutexes */
 
     /*
      * Task Entry Point
@@ -195,6 +237,22 @@ struct task {
     void (*entry_point)(void *);    /* Task entry function */
     void *arg;                      /* Argument to entry function */
 
+    /*
+     * Memory
+     * ------
+     * magazines:     Per-task kmalloc magazine set (NULL = use global heap)
+     * address_space: Page directory for the mmap window (NULL = kernel's)
+     */
+    struct heap_magazines *magazines;
+    struct address_space *address_space;
+
+    /*
+     * Files
+     * -----
+     * files:         Descriptor table (NULL until the task opens a file)
+     */
+    struct vfs_fd_table *files;
+
     /*
      * Exit Information
      * ----------------
@@ -210,6 +268,25 @@ struct task {
      */
     task_t *next;                   /* Next task in queue */
     task_t *prev;                   /* Previous task in queue (if doubly-linked) */
+
+    /*
+     * Performance Counters
+     * --------------------
+     * perf_counts:     Hardware counts charged while running, per counter of
+     *                  the perf session (kernel/utils/perf.c)
+     * perf_generation: Session the counts belong to; stale counts are reset
+     */
+    uint64_t perf_counts[PERF_MAX_COUNTERS];
+    uint32_t perf_generation;
+
+    /*
+     * FPU/SSE Context
+     * ---------------
+     * fpu_state:     FXSAVE image, valid while TASK_FLAG_FPU_USED is set and
+     *                the task does not own the FPU. Saved and restored
+     *                lazily from the #NM handler, never on a plain switch.
+     */
+    uint8_t fpu_state[TASK_FPU_STATE_SIZE] __attribute__((aligned(16)));
 };
 
 /* ---------------------------------------------------------------------------
@@ -279,6 +356,20 @@ task_t *task_create(const char *name,
                     uint8_t priority,
                     size_t stack_size);
 
+/**
+ * @brief Reserve the top of a new task's stack for its entry point
+ * 
+ * Rebuilds the first-run frame below the reserved bytes, so the entry
+ * point can find data placed there (fork puts the child's trap frame at
+ * the top, where a trap from ring 3 would have left it). Only valid before
+ * the task first runs.
+ * 
+ * @param task  Task from task_create() that has not run yet
+ * @param bytes Bytes to reserve (a multiple of 16 keeps the stack aligned)
+ * @return Start of the reserved bytes, or NULL if not possible
+ */
+void *task_reserve_stack_top(task_t *task, size_t bytes);
+
 /**
  * @brief Terminate the calling task
  * 
@@ -329,6 +420,9 @@ task_state_t task_get_state(task_t *task);
 /**
  * @brief Set a task's priority
  * 
+ * Sets base_priority; the effective priority stays boosted while a
+ * higher-priority task waits on a mutex this task holds.
+ * 
  * @param task     Task to modify
  * @param priority New priority (0-7)
  */
@@ -395,4 +489,101 @@ void task_sleep(uint32_t ticks);
  */
 void task_wakeup(task_t *task);
 
+/*
+ * Lazy FPU Context
+ */
+
+/**
+ * @brief Prepare the FPU for a switch to next
+ * 
+ * Sets CR0.TS unless next already owns the FPU registers, so the first
+ * FPU/SSE instruction of any other task traps with #NM.
+ * 
+ * @param next Task about to run
+ */
+void task_fpu_switch(task_t *next);
+
+/**
+ * @brief Enable the FPU on the calling CPU
+ * 
+ * The BSP's is set up by the task system; each AP calls this on the way
+ * up, leaving CR0.TS set and no owner.
+ */
+void task_fpu_cpu_init(void);
+
+/**
+ * @brief Handle a Device Not Available (#NM) trap
+ * 
+ * Clears CR0.TS, saves the previous owner's registers and loads (or
+ * initializes) the current task's.
+ * 
+ * @return true if handled, false if the FPU is not usable
+ */
+bool task_fpu_handle_trap(void);
+
+/**
+ * @brief Get the task whose state is live in the FPU registers
+ * 
+ * @return Owning task, or NULL if no task owns the FPU
+ */
+task_t *task_fpu_owner(void);
+
+/**
+ * @brief Check if an address falls in a task stack's guard page
+ * 
+ * Only window stacks (paging on) have an unmapped guard to fault on.
+ * 
+ * @param addr Faulting address (CR2)
+ * @return true if the fault is a kernel stack overflow
+ */
+bool task_stack_guard_hit(uintptr_t addr);
+
+/*
+ * User Processes (process.c)
+ *
+ * A process is a task that runs in ring 3 on an image loaded by exec into
+ * its own address space; its kernel stack only holds traps from ring 3.
+ */
+
+/* Ring 3 selectors (GDT entries 3 and 4, RPL 3) */
+#define USER_CODE_SELECTOR  0x1B
+#define USER_DATA_SELECTOR  0x23
+
+/* User stack: the top of the mmap window */
+#define USER_STACK_SIZE     (64 * 1024)
+#define USER_STACK_TOP      USER_MMAP_END
+
+struct interrupt_frame;
+
+/**
+ * @brief Replace the running task's image with an ELF file and enter it
+ * 
+ * Loads a static i386 executable (ET_EXEC, segments in the mmap window,
+ * no two segments sharing a page) into a new address space, maps the user
+ * stack, drops the old address space and switches to ring 3.
+ * 
+ * @param path VFS path of the executable
+ * @return Only returns on failure (-1), with the old image intact
+ */
+int process_exec(const char *path);
+
+/**
+ * @brief Duplicate the calling process
+ * 
+ * The child gets a copy-on-write clone of the address space, the same open
+ * files, and a copy of the trap frame so it resumes after the fork()
+ * syscall with a return value of 0.
+ * 
+ * @param frame INT 0x80 frame of the caller (must come from ring 3)
+ * @return Child PID, or -1 on error
+ */
+int32_t process_fork(struct interrupt_frame *frame);
+
+/**
+ * @brief Start a new process running an executable
+ * 
+ * @return The process's task (already on the run queue), or NULL on error
+ */
+task_t *process_spawn(const char *path, uint8_t priority);
+
 #endif /* NEXA_TASK_H */
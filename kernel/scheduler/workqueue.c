@@ -0,0 +1,178 @@
+/*
+ * ===========================================================================
+ * kernel/scheduler/workqueue.c
+ * ===========================================================================
+ *
+ * Kernel Work Queue
+ *
+ * Deferred work that may take a while or needs to block runs in a kernel
+ * worker task ("kworker") instead of interrupt or softirq context. Any
+ * context, including IRQ top halves, can hand it a function and an argument
+ * with workqueue_queue(); the worker runs the items in FIFO order.
+ *
+ * Data Structure: Fixed Ring of Work Items
+ * ┌───────────────────────────────────────────────────────────────────────────┐
+ * │   tail (worker)                head (producers)                          │
+ * │     ▼                            ▼                                       │
+ * │   [ fn,arg ][ fn,arg ][ fn,arg ][        free        ]                    │
+ * │                                                                          │
+ * │  - Queue:  O(1), kernel lock held for a few stores                       │
+ * │  - Worker: drains every queued item before blocking again, so a          │
+ * │            burst of work costs one wakeup                                │
+ * │  - Full:   workqueue_queue() fails; the caller keeps the work            │
+ * └───────────────────────────────────────────────────────────────────────────┘
+ *
+ * ===========================================================================
+ */
+
+#include "task.h"
+#include "scheduler.h"
+#include "spinlock.h"
+#include "../interrupts/interrupts.h"
+
+/* ---------------------------------------------------------------------------
+ * Work Queue Structure
+ * --------------------------------------------------------------------------- */
+typedef struct work_item {
+    work_fn_t fn;
+    void *arg;
+} work_item_t;
+
+typedef struct workqueue {
+    work_item_t items[WORKQUEUE_SIZE];
+    volatile uint32_t head;     /* Next slot to fill */
+    volatile uint32_t tail;     /* Next slot to run */
+    task_t *worker;             /* kworker task */
+    workqueue_stats_t stats;
+} workqueue_t;
+
+/* Static instance of the work queue */
+static workqueue_t wq;
+
+/* ---------------------------------------------------------------------------
+ * Worker Task
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Worker task entry point
+ *
+ * Runs queued items until the ring is empty, then blocks until
+ * workqueue_queue() wakes it.
+ */
+static void workqueue_worker(void *arg)
+{
+    UNUSED(arg);
+
+    while (1) {
+        uint32_t flags = kernel_lock_irqsave();
+
+        if (wq.tail == wq.head) {
+            /*
+             * Nothing to do: block; a producer's task_wakeup() requeues us.
+             * schedule() drops the kernel lock only once our stack is saved.
+             */
+            wq.worker->state = TASK_STATE_BLOCKED;
+            schedule();
+            kernel_unlock_irqrestore(flags);
+            continue;
+        }
+
+        work_item_t item = wq.items[wq.tail & (WORKQUEUE_SIZE - 1)];
+        wq.tail++;
+        kernel_unlock_irqrestore(flags);
+
+        item.fn(item.arg);
+        wq.stats.executed++;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API Implementation
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Create the worker task
+ *
+ * @return true on success, false if the task could not be created
+ */
+bool workqueue_init(void)
+{
+    wq.head = 0;
+    wq.tail = 0;
+    wq.stats.queued = 0;
+    wq.stats.executed = 0;
+    wq.stats.dropped = 0;
+    wq.stats.high_water = 0;
+
+    wq.worker = task_create("kworker", workqueue_worker, NULL,
+                            TASK_PRIORITY_HIGH, 0);
+    if (wq.worker == NULL) {
+        return false;
+    }
+
+    scheduler_add_task(wq.worker);
+    return true;
+}
+
+/**
+ * @brief Queue a function to run in the worker task
+ *
+ * Safe from any context, including IRQ top halves.
+ *
+ * Time Complexity: O(1)
+ */
+bool workqueue_queue(work_fn_t fn, void *arg)
+{
+    if (fn == NULL || wq.worker == NULL) {
+        return false;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+
+    uint32_t depth = wq.head - wq.tail;
+    if (depth >= WORKQUEUE_SIZE) {
+        wq.stats.dropped++;
+        kernel_unlock_irqrestore(flags);
+        return false;
+    }
+
+    work_item_t *item = &wq.items[wq.head & (WORKQUEUE_SIZE - 1)];
+    item->fn = fn;
+    item->arg = arg;
+    wq.head++;
+
+    wq.stats.queued++;
+    if (depth + 1 > wq.stats.high_water) {
+        wq.stats.high_water = depth + 1;
+    }
+
+    /* Only the first item of a batch has to wake the worker */
+    if (wq.worker->state == TASK_STATE_BLOCKED) {
+        task_wakeup(wq.worker);
+    }
+
+    kernel_unlock_irqrestore(flags);
+    return true;
+}
+
+/**
+ * @brief Get the number of items waiting to run
+ */
+uint32_t workqueue_pending(void)
+{
+    return wq.head - wq.tail;
+}
+
+/**
+ * @brief Get work queue statistics
+ */
+void workqueue_get_stats(workqueue_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    uint32_t flags = kernel_lock_irqsave();
+    *stats = wq.stats;
+    kernel_unlock_irqrestore(flags);
+}
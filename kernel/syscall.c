@@ -18,7 +18,24 @@
  *   EDI = argument 5
  *   EAX = return value
  *
- * Syscall invocation: INT 0x80
+ * Syscall invocation: INT 0x80, or SYSENTER where the CPU has it
+ *
+ * SYSENTER convention (user side in userland/lib/syscall_wrappers.c):
+ *   EAX, EBX, ESI, EDI as above
+ *   ECX = user ESP, with argument 2 at [ECX] and argument 3 at [ECX + 4]
+ *   EDX = user EIP to return to
+ *   EBP, EBX, ESI and EDI are preserved; EAX = return value
+ *   SYSENTER loads the kernel CS/SS and the ESP from the MSRs, so the entry
+ *   stub only stores the registers the handlers read and skips the segment
+ *   reloads and the IRET of the interrupt gate.
+ *
+ * User Pointers:
+ *   Every buffer, path and argument block passed in is checked with
+ *   user_access_ok() (or copied with copy_from_user()/copy_to_user())
+ *   before a handler touches it. The range must lie in the user window and
+ *   be mapped for the access, so a kernel address or an unmapped page
+ *   fails with -1 (EFAULT) instead of being written or faulting in ring 0.
+ *   Kernel code calls the VFS and IPC functions directly, not through here.
  *
  * ===========================================================================
  */
@@ -27,7 +44,15 @@
 #include "drivers/drivers.h"
 #include "scheduler/scheduler.h"
 #include "scheduler/task.h"
+#include "scheduler/smp.h"
 #include "memory/memory.h"
+#include "fs/vfs.h"
+#include "ipc/poll.h"
+#include "utils/bench.h"
+#include "utils/trace.h"
+#include "utils/profile.h"
+#include "utils/perf.h"
+#include "utils/logging.h"
 #include "../config/os_config.h"
 
 /* ---------------------------------------------------------------------------
@@ -40,15 +65,39 @@ extern void idt_set_gate(uint8_t vector, uint32_t handler, uint16_t selector, ui
 /* Syscall stub from assembly */
 extern uint32_t syscall_stub_addr;
 
-/* VFS functions (when available) */
-extern int vfs_open(const char *path);
-extern ssize_t vfs_read(int fd, void *buffer, size_t size);
-extern ssize_t vfs_write(int fd, const void *buffer, size_t size);
-extern int vfs_close(int fd);
-
 /* String functions */
 extern size_t strlen(const char *s);
 
+/* Futexes (kernel/ipc/futex.c) */
+extern int futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout);
+extern int futex_wake(volatile uint32_t *addr, uint32_t count);
+
+/* Batched system call rings (kernel/io_ring.c) */
+extern uintptr_t io_ring_setup(uint32_t entries);
+extern int io_ring_enter(uintptr_t user_addr, uint32_t min_complete, uint32_t timeout);
+extern int io_ring_destroy(uintptr_t user_addr);
+
+/* ---------------------------------------------------------------------------
+ * SYSENTER Configuration
+ * --------------------------------------------------------------------------- */
+#define MSR_SYSENTER_CS     0x174
+#define MSR_SYSENTER_ESP    0x175
+#define MSR_SYSENTER_EIP    0x176
+
+#define CPUID_EDX_SEP       (1u << 11)
+
+/* SYSEXIT returns to SYSENTER_CS + 16 (code) and + 24 (stack), at RPL 3 */
+#define GDT_USER_CODE       0x00CFFA000000FFFFull   /* Flat, DPL 3, code */
+#define GDT_USER_DATA       0x00CFF2000000FFFFull   /* Flat, DPL 3, data */
+
+/* null, kernel code/data, user code/data, one TSS per CPU, the #DF TSS */
+#define USER_GDT_ENTRIES    (6 + SMP_MAX_CPUS)
+#define TSS_SELECTOR(cpu)   (0x28 + 8 * (cpu))
+#define DF_TSS_SELECTOR     TSS_SELECTOR(SMP_MAX_CPUS)
+#define GDT_TSS_ACCESS      0x89    /* Present, DPL 0, 32-bit available TSS */
+#define IDT_GATE_TASK       0x85    /* Present, DPL 0, task gate */
+#define DF_STACK_SIZE       (2 * PAGE_SIZE)
+
 /* ---------------------------------------------------------------------------
  * System Call Numbers
  * ---------------------------------------------------------------------------
@@ -67,10 +116,84 @@ extern size_t strlen(const char *s);
 #define SYS_EXECVE      11      /* Execute a program */
 #define SYS_CHDIR       12      /* Change directory */
 #define SYS_TIME        13      /* Get time */
+#define SYS_MMAP        90      /* Map a file into the address space */
+#define SYS_MUNMAP      91      /* Remove a mapping */
 #define SYS_GETPID      20      /* Get process ID */
 #define SYS_SLEEP       35      /* Sleep for ticks */
 #define SYS_YIELD       158     /* Yield CPU */
 #define SYS_SBRK        45      /* Extend heap (simplified) */
+#define SYS_PIPE        42      /* Create a pipe */
+#define SYS_READV       145     /* Scatter read into several buffers */
+#define SYS_WRITEV      146     /* Gather write from several buffers */
+#define SYS_PREAD       180     /* Read at an offset, position unchanged */
+#define SYS_PWRITE      181     /* Write at an offset, position unchanged */
+#define SYS_GETDENTS    141     /* Read a batch of directory entries */
+#define SYS_FUTEX       240     /* Wait on / wake a user-space word */
+#define SYS_POLL        168     /* Wait for keyboard / IPC readiness */
+
+/* NexaKernel-specific system calls */
+#define SYS_MEMPROF     200     /* Heap allocation profiler */
+#define SYS_SCHEDSTAT   201     /* Scheduler latency and task statistics */
+#define SYS_IORING      202     /* Batched submission/completion rings */
+#define SYS_EPOLL       203     /* Interest sets with a ready list */
+#define SYS_SPLICE      204     /* Move data between descriptors in the kernel */
+#define SYS_BENCH       205     /* Run in-kernel microbenchmarks */
+#define SYS_TRACE       206     /* Control and dump the trace rings */
+#define SYS_PROFILE     207     /* Sampling profiler */
+#define SYS_PERF        208     /* Hardware performance counters */
+#define SYS_MEMINFO     209     /* Frame, heap and paging statistics */
+#define SYS_DMESG       210     /* Read the kernel log */
+#define SYS_IRQSTAT     211     /* Per-handler IRQ time */
+
+/* SYS_MEMPROF operations (EBX) */
+#define MEMPROF_READ    0       /* Copy heap_profile_t to ECX (EDX bytes) */
+#define MEMPROF_ENABLE  1       /* Start attributing allocations */
+#define MEMPROF_DISABLE 2       /* Stop attributing allocations */
+
+/* SYS_SCHEDSTAT operations (EBX) */
+#define SCHEDSTAT_LATENCY 0     /* Copy scheduler_latency_stats_t to ECX */
+#define SCHEDSTAT_TASKS   1     /* Copy scheduler_task_info_t[] to ECX */
+
+/* SYS_TRACE operations (EBX) */
+#define TRACE_OP_SET    0       /* Enable the categories in ECX, returns the old mask */
+#define TRACE_OP_DUMP   1       /* Print the rings over serial, returns records */
+#define TRACE_OP_CLEAR  2       /* Drop every record */
+
+/* SYS_PROFILE operations (EBX) */
+#define PROFILE_OP_START 0      /* Reset the histogram and start sampling */
+#define PROFILE_OP_STOP  1      /* Stop sampling */
+#define PROFILE_OP_DUMP  2      /* Print the histogram over serial, returns entries */
+
+/* SYS_PERF operations (EBX) */
+#define PERF_OP_INFO        0   /* Copy perf_info_t to ECX (EDX bytes) */
+#define PERF_OP_START       1   /* Count the EDX events in the uint32_t array at ECX */
+#define PERF_OP_STOP        2   /* End the session */
+#define PERF_OP_READ_SYSTEM 3   /* Copy all-CPU perf_counts_t to ECX (EDX bytes) */
+#define PERF_OP_READ_TASK   4   /* Copy task ESI's perf_counts_t to ECX (EDX bytes) */
+
+/* SYS_FUTEX operations (ECX) */
+#define FUTEX_WAIT      0       /* Sleep while *EBX == EDX, at most ESI ticks */
+#define FUTEX_WAKE      1       /* Wake up to EDX tasks sleeping on EBX */
+
+/* SYS_IORING operations (EBX) */
+#define IORING_SETUP    0       /* Create a ring with ECX SQ entries */
+#define IORING_ENTER    1       /* Submit ring ECX, wait for EDX results */
+#define IORING_DESTROY  2       /* Unmap ring ECX */
+
+/* SYS_EPOLL operations (EBX) */
+#define EPOLL_OP_CREATE 0       /* New instance */
+#define EPOLL_OP_CTL    1       /* ECX = instance, EDX = kepoll_ctl_t * */
+#define EPOLL_OP_WAIT   2       /* ECX = instance, EDX = events, ESI = max, EDI = ticks */
+#define EPOLL_OP_CLOSE  3       /* ECX = instance */
+
+/* SYS_EPOLL / EPOLL_OP_CTL argument block (user side mirrors this) */
+typedef struct {
+    int32_t op;                 /* EPOLL_CTL_ADD, _MOD, _DEL */
+    int32_t source;             /* POLL_SRC_* */
+    int32_t id;
+    uint32_t events;            /* POLL* bits, EPOLLET */
+    uint32_t data;              /* Cookie returned by EPOLL_OP_WAIT */
+} kepoll_ctl_t;
 
 /* Maximum syscall number supported */
 #define SYS_MAX         256
@@ -82,6 +205,12 @@ extern size_t strlen(const char *s);
 #define STDOUT_FD       1       /* Standard output (screen) */
 #define STDERR_FD       2       /* Standard error (screen) */
 
+/* SYS_OPEN flags (ECX) */
+#define O_DIRECTORY     0x10000 /* Open a directory for getdents */
+
+/* Longest path (with the NUL) accepted by open and execve */
+#define SYSCALL_PATH_MAX 256
+
 /* ---------------------------------------------------------------------------
  * Syscall Handler Function Type
  * ---------------------------------------------------------------------------
@@ -95,6 +224,7 @@ typedef int32_t (*syscall_fn_t)(interrupt_frame_t *frame);
  * --------------------------------------------------------------------------- */
 static int32_t sys_exit_handler(interrupt_frame_t *frame);
 static int32_t sys_fork_handler(interrupt_frame_t *frame);
+static int32_t sys_execve_handler(interrupt_frame_t *frame);
 static int32_t sys_read_handler(interrupt_frame_t *frame);
 static int32_t sys_write_handler(interrupt_frame_t *frame);
 static int32_t sys_open_handler(interrupt_frame_t *frame);
@@ -103,6 +233,28 @@ static int32_t sys_getpid_handler(interrupt_frame_t *frame);
 static int32_t sys_sleep_handler(interrupt_frame_t *frame);
 static int32_t sys_yield_handler(interrupt_frame_t *frame);
 static int32_t sys_sbrk_handler(interrupt_frame_t *frame);
+static int32_t sys_memprof_handler(interrupt_frame_t *frame);
+static int32_t sys_schedstat_handler(interrupt_frame_t *frame);
+static int32_t sys_bench_handler(interrupt_frame_t *frame);
+static int32_t sys_trace_handler(interrupt_frame_t *frame);
+static int32_t sys_profile_handler(interrupt_frame_t *frame);
+static int32_t sys_perf_handler(interrupt_frame_t *frame);
+static int32_t sys_meminfo_handler(interrupt_frame_t *frame);
+static int32_t sys_dmesg_handler(interrupt_frame_t *frame);
+static int32_t sys_irqstat_handler(interrupt_frame_t *frame);
+static int32_t sys_futex_handler(interrupt_frame_t *frame);
+static int32_t sys_poll_handler(interrupt_frame_t *frame);
+static int32_t sys_epoll_handler(interrupt_frame_t *frame);
+static int32_t sys_pipe_handler(interrupt_frame_t *frame);
+static int32_t sys_splice_handler(interrupt_frame_t *frame);
+static int32_t sys_ioring_handler(interrupt_frame_t *frame);
+static int32_t sys_mmap_handler(interrupt_frame_t *frame);
+static int32_t sys_munmap_handler(interrupt_frame_t *frame);
+static int32_t sys_readv_handler(interrupt_frame_t *frame);
+static int32_t sys_writev_handler(interrupt_frame_t *frame);
+static int32_t sys_pread_handler(interrupt_frame_t *frame);
+static int32_t sys_pwrite_handler(interrupt_frame_t *frame);
+static int32_t sys_getdents_handler(interrupt_frame_t *frame);
 
 /* ---------------------------------------------------------------------------
  * System Call Table
@@ -118,10 +270,33 @@ static syscall_fn_t syscall_table[SYS_MAX] = {
     [SYS_WRITE]  = sys_write_handler,   /* 4: write */
     [SYS_OPEN]   = sys_open_handler,    /* 5: open */
     [SYS_CLOSE]  = sys_close_handler,   /* 6: close */
+    [SYS_EXECVE] = sys_execve_handler,  /* 11: execve */
     [SYS_GETPID] = sys_getpid_handler,  /* 20: getpid */
     [SYS_SLEEP]  = sys_sleep_handler,   /* 35: sleep */
+    [SYS_PIPE]   = sys_pipe_handler,    /* 42: pipe */
     [SYS_SBRK]   = sys_sbrk_handler,    /* 45: sbrk */
+    [SYS_MMAP]   = sys_mmap_handler,    /* 90: mmap */
+    [SYS_MUNMAP] = sys_munmap_handler,  /* 91: munmap */
+    [SYS_READV]  = sys_readv_handler,   /* 145: readv */
+    [SYS_WRITEV] = sys_writev_handler,  /* 146: writev */
+    [SYS_PREAD]  = sys_pread_handler,   /* 180: pread */
+    [SYS_PWRITE] = sys_pwrite_handler,  /* 181: pwrite */
+    [SYS_GETDENTS] = sys_getdents_handler, /* 141: getdents */
+    [SYS_FUTEX]  = sys_futex_handler,   /* 240: futex */
+    [SYS_POLL]   = sys_poll_handler,    /* 168: poll */
     [SYS_YIELD]  = sys_yield_handler,   /* 158: yield */
+    [SYS_MEMPROF] = sys_memprof_handler, /* 200: memprof */
+    [SYS_SCHEDSTAT] = sys_schedstat_handler, /* 201: schedstat */
+    [SYS_IORING] = sys_ioring_handler,  /* 202: ioring */
+    [SYS_EPOLL]  = sys_epoll_handler,   /* 203: epoll */
+    [SYS_SPLICE] = sys_splice_handler,  /* 204: splice */
+    [SYS_BENCH]  = sys_bench_handler,   /* 205: bench */
+    [SYS_TRACE]  = sys_trace_handler,   /* 206: trace */
+    [SYS_PROFILE] = sys_profile_handler, /* 207: profile */
+    [SYS_PERF]   = sys_perf_handler,    /* 208: perf */
+    [SYS_MEMINFO] = sys_meminfo_handler, /* 209: meminfo */
+    [SYS_DMESG]  = sys_dmesg_handler,   /* 210: dmesg */
+    [SYS_IRQSTAT] = sys_irqstat_handler, /* 211: irqstat */
 };
 
 /* ---------------------------------------------------------------------------
@@ -130,6 +305,9 @@ static syscall_fn_t syscall_table[SYS_MAX] = {
 static uint32_t syscall_count = 0;
 static uint32_t syscall_errors = 0;
 
+/* Set once the SYSENTER MSRs point at sysenter_entry */
+static bool sysenter_enabled = false;
+
 /* ---------------------------------------------------------------------------
  * sys_exit_handler - Terminate the current process
  * ---------------------------------------------------------------------------
@@ -156,36 +334,38 @@ static int32_t sys_exit_handler(interrupt_frame_t *frame)
 }
 
 /* ---------------------------------------------------------------------------
- * sys_fork_handler - Create a new process (simplified)
+ * sys_fork_handler - Create a new process
  * ---------------------------------------------------------------------------
- * Creates a copy of the current process.
+ * Creates a copy of the current process (see process.c): the address space
+ * is shared copy-on-write and the open files are shared.
+ *
+ * Only valid from ring 3 through INT 0x80, whose frame the child resumes.
  *
  * Returns:
  *   In parent: PID of child process
  *   In child: 0
  *   On error: -1
- *
- * Note: This is a simplified implementation. Full fork() requires:
- * - Copying address space
- * - Copying file descriptor table
- * - Setting up separate stacks
  * --------------------------------------------------------------------------- */
 static int32_t sys_fork_handler(interrupt_frame_t *frame)
 {
-    (void)frame;  /* Unused for now */
-    
-    /* TODO: Implement full fork semantics */
-    /* For now, return error as fork is complex to implement properly */
-    
-    /* A minimal implementation would:
-     * 1. Create new task structure
-     * 2. Copy parent's stack and registers
-     * 3. Set child's return value to 0
-     * 4. Add child to scheduler
-     * 5. Return child PID to parent
-     */
-    
-    return -1;  /* ENOSYS - not implemented */
+    return process_fork(frame);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_execve_handler - Replace the current process image
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = path of a static ELF executable
+ *
+ * Returns: Does not return on success; -1 if the file could not be loaded
+ * --------------------------------------------------------------------------- */
+static int32_t sys_execve_handler(interrupt_frame_t *frame)
+{
+    char path[SYSCALL_PATH_MAX];
+    if (copy_string_from_user(path, (const char *)frame->ebx, sizeof(path)) < 0) {
+        return -1;  /* EFAULT */
+    }
+    return process_exec(path);
 }
 
 /* ---------------------------------------------------------------------------
@@ -208,6 +388,9 @@ static int32_t sys_read_handler(interrupt_frame_t *frame)
     if (buffer == NULL || count == 0) {
         return -1;  /* EINVAL */
     }
+    if (!user_access_ok(buffer, count, true)) {
+        return -1;  /* EFAULT */
+    }
     
     /* Handle standard input (keyboard) */
     if (fd == STDIN_FD) {
@@ -236,9 +419,33 @@ static int32_t sys_read_handler(interrupt_frame_t *frame)
         return (int32_t)bytes_read;
     }
     
-    /* For other file descriptors, use VFS (if available) */
-    /* TODO: Check if VFS is initialized */
-    return -1;  /* EBADF - bad file descriptor */
+    /* Stdout and stderr are write-only */
+    if (fd == STDOUT_FD || fd == STDERR_FD) {
+        return -1;  /* EBADF */
+    }
+    
+    return vfs_read(fd, buffer, count);
+}
+
+/* ---------------------------------------------------------------------------
+ * console_write - Print a buffer for stdout or stderr
+ * ---------------------------------------------------------------------------
+ * Also used for console writes submitted through an I/O ring.
+ * --------------------------------------------------------------------------- */
+void console_write(int fd, const char *buffer, size_t count)
+{
+    /* Set error color for stderr */
+    if (fd == STDERR_FD) {
+        vga_set_color(VGA_ENTRY_COLOR(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK));
+    }
+    
+    /* Render the whole buffer in one pass */
+    vga_write(buffer, count);
+    
+    /* Reset color after stderr */
+    if (fd == STDERR_FD) {
+        vga_set_color(VGA_ENTRY_COLOR(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK));
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -261,30 +468,315 @@ static int32_t sys_write_handler(interrupt_frame_t *frame)
     if (buffer == NULL) {
         return -1;  /* EINVAL */
     }
+    if (!user_access_ok(buffer, count, false)) {
+        return -1;  /* EFAULT */
+    }
     
     /* Handle standard output and error (VGA screen) */
     if (fd == STDOUT_FD || fd == STDERR_FD) {
-        /* Set error color for stderr */
-        if (fd == STDERR_FD) {
-            vga_set_color(VGA_ENTRY_COLOR(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK));
+        console_write(fd, buffer, count);
+        return (int32_t)count;
+    }
+    
+    if (fd == STDIN_FD) {
+        return -1;  /* EBADF */
+    }
+    
+    return vfs_write(fd, buffer, count);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_pipe_handler - Create a pipe
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = int[2] to receive the read end ([0]) and write end ([1])
+ *
+ * Returns: 0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_pipe_handler(interrupt_frame_t *frame)
+{
+    int fds[2];
+    if (vfs_pipe(fds) < 0) {
+        return -1;
+    }
+    if (!copy_to_user((void *)frame->ebx, fds, sizeof(fds))) {
+        vfs_close(fds[0]);
+        vfs_close(fds[1]);
+        return -1;  /* EFAULT */
+    }
+    return 0;
+}
+
+/* splice output routines for the console descriptors */
+static void splice_to_console(const char *data, size_t len, void *ctx)
+{
+    console_write((int)(uintptr_t)ctx, data, len);
+}
+
+static void splice_to_serial(const char *data, size_t len, void *ctx)
+{
+    UNUSED(ctx);
+    serial_write(data, len);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_splice_handler - Move data between descriptors without a user buffer
+ * ---------------------------------------------------------------------------
+ * Also serves as sendfile(). With stdout or stderr as the target, the
+ * source's pages go straight to the screen (or COM1 with
+ * VFS_SPLICE_SERIAL).
+ *
+ * Parameters:
+ *   EBX = source descriptor (file or pipe read end)
+ *   ECX = target descriptor (file, pipe write end, stdout, stderr)
+ *   EDX = most bytes to move
+ *   ESI = flags (VFS_SPLICE_SERIAL)
+ *
+ * Returns: Bytes moved (0 at end of input), -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_splice_handler(interrupt_frame_t *frame)
+{
+    int in_fd = (int)frame->ebx;
+    int out_fd = (int)frame->ecx;
+    size_t count = (size_t)frame->edx;
+
+    if (in_fd == STDIN_FD || in_fd == STDOUT_FD || in_fd == STDERR_FD || out_fd == STDIN_FD) {
+        return -1;  /* EINVAL */
+    }
+
+    if (out_fd == STDOUT_FD || out_fd == STDERR_FD) {
+        if (frame->esi & VFS_SPLICE_SERIAL) {
+            return vfs_splice_emit(in_fd, count, splice_to_serial, NULL);
         }
-        
-        /* Write each character to screen */
-        for (size_t i = 0; i < count; i++) {
-            vga_putchar(buffer[i]);
+        return vfs_splice_emit(in_fd, count, splice_to_console, (void *)(uintptr_t)out_fd);
+    }
+    return vfs_splice(in_fd, out_fd, count);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_mmap_handler - Map a file or zeroed memory into the caller's address space
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = file descriptor (-1 with MAP_ANONYMOUS)
+ *   ECX = length in bytes
+ *   EDX = protection (PROT_READ, PROT_WRITE)
+ *   ESI = flags (MAP_SHARED, MAP_PRIVATE, MAP_ANONYMOUS)
+ *   EDI = file offset (multiple of PAGE_SIZE; 0 with MAP_ANONYMOUS)
+ *
+ * Returns: Start address of the mapping, or -1 on error
+ *
+ * Anonymous mappings are private and demand-zero; a fork copies them
+ * copy-on-write, so MAP_SHARED is refused for them.
+ * --------------------------------------------------------------------------- */
+static int32_t sys_mmap_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    size_t length = (size_t)frame->ecx;
+    int prot = (int)frame->edx;
+    int flags = (int)frame->esi;
+    size_t offset = (size_t)frame->edi;
+
+    if (flags & MAP_ANONYMOUS) {
+        if (fd != -1 || offset != 0 || length == 0 || (flags & MAP_SHARED) ||
+            !(prot & PROT_READ)) {
+            return -1;
         }
-        
-        /* Reset color after stderr */
-        if (fd == STDERR_FD) {
-            vga_set_color(VGA_ENTRY_COLOR(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK));
+        uintptr_t start = vm_area_map_anon(address_space_current(true), 0, length,
+                                           (prot & PROT_WRITE) ? PAGE_WRITABLE : 0);
+        return (start != 0) ? (int32_t)start : -1;
+    }
+    
+    void *addr = vfs_mmap(fd, length, prot, flags, offset);
+    if (addr == NULL) {
+        return -1;
+    }
+    return (int32_t)(uintptr_t)addr;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_munmap_handler - Remove a mapping made by mmap
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = start address returned by mmap
+ *   ECX = length passed to mmap (whole mappings only)
+ *
+ * Returns: 0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_munmap_handler(interrupt_frame_t *frame)
+{
+    return vfs_munmap((void *)frame->ebx, (size_t)frame->ecx);
+}
+
+/* ---------------------------------------------------------------------------
+ * copy_iov_from_user - Copy an iovec array in and check every buffer in it
+ * --------------------------------------------------------------------------- */
+static bool copy_iov_from_user(struct iovec *iov, const struct iovec *user_iov,
+                               int iovcnt, bool write)
+{
+    if (!copy_from_user(iov, user_iov, (size_t)iovcnt * sizeof(struct iovec))) {
+        return false;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_base != NULL &&
+            !user_access_ok(iov[i].iov_base, iov[i].iov_len, write)) {
+            return false;
         }
-        
-        return (int32_t)count;
     }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_readv_handler - Read into several buffers
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = file descriptor
+ *   ECX = struct iovec array pointer
+ *   EDX = number of entries (at most VFS_IOV_MAX)
+ *
+ * Returns: Total bytes read, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_readv_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    struct iovec iov[VFS_IOV_MAX];
+    int iovcnt = (int)frame->edx;
+    
+    if (frame->ecx == 0 || iovcnt < 0 || iovcnt > VFS_IOV_MAX) {
+        return -1;  /* EINVAL */
+    }
+    
+    /* Console input is line-based: only plain read() supports it */
+    if (fd == STDIN_FD || fd == STDOUT_FD || fd == STDERR_FD) {
+        return -1;  /* EBADF */
+    }
+    
+    if (!copy_iov_from_user(iov, (const struct iovec *)frame->ecx, iovcnt, true)) {
+        return -1;  /* EFAULT */
+    }
+    return vfs_readv(fd, iov, iovcnt);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_writev_handler - Write several buffers in one call
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = file descriptor
+ *   ECX = struct iovec array pointer
+ *   EDX = number of entries (at most VFS_IOV_MAX)
+ *
+ * Returns: Total bytes written, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_writev_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    struct iovec iov[VFS_IOV_MAX];
+    int iovcnt = (int)frame->edx;
+    
+    if (frame->ecx == 0 || iovcnt < 0 || iovcnt > VFS_IOV_MAX) {
+        return -1;  /* EINVAL */
+    }
+    if (!copy_iov_from_user(iov, (const struct iovec *)frame->ecx, iovcnt, false)) {
+        return -1;  /* EFAULT */
+    }
+    
+    if (fd == STDOUT_FD || fd == STDERR_FD) {
+        size_t total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            if (iov[i].iov_base == NULL && iov[i].iov_len != 0) {
+                return -1;  /* EINVAL */
+            }
+            console_write(fd, (const char *)iov[i].iov_base, iov[i].iov_len);
+            total += iov[i].iov_len;
+        }
+        return (int32_t)total;
+    }
+    
+    if (fd == STDIN_FD) {
+        return -1;  /* EBADF */
+    }
+    
+    return vfs_writev(fd, iov, iovcnt);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_pread_handler - Read at an offset without moving the file position
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = file descriptor
+ *   ECX = buffer pointer
+ *   EDX = count (bytes to read)
+ *   ESI = file offset
+ *
+ * Returns: Number of bytes read, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_pread_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    void *buffer = (void *)frame->ecx;
+    size_t count = (size_t)frame->edx;
+    size_t offset = (size_t)frame->esi;
+    
+    /* Standard streams are not seekable */
+    if (fd == STDIN_FD || fd == STDOUT_FD || fd == STDERR_FD) {
+        return -1;  /* ESPIPE */
+    }
+    if (!user_access_ok(buffer, count, true)) {
+        return -1;  /* EFAULT */
+    }
+    
+    return vfs_pread(fd, buffer, count, offset);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_pwrite_handler - Write at an offset without moving the file position
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = file descriptor
+ *   ECX = buffer pointer
+ *   EDX = count (bytes to write)
+ *   ESI = file offset
+ *
+ * Returns: Number of bytes written, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_pwrite_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    const void *buffer = (const void *)frame->ecx;
+    size_t count = (size_t)frame->edx;
+    size_t offset = (size_t)frame->esi;
+    
+    /* Standard streams are not seekable */
+    if (fd == STDIN_FD || fd == STDOUT_FD || fd == STDERR_FD) {
+        return -1;  /* ESPIPE */
+    }
+    if (!user_access_ok(buffer, count, false)) {
+        return -1;  /* EFAULT */
+    }
+    
+    return vfs_pwrite(fd, buffer, count, offset);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_getdents_handler - Read directory entries from a directory descriptor
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = descriptor from open(path, O_DIRECTORY)
+ *   ECX = vfs_dirent_t array
+ *   EDX = number of records the array holds
+ *
+ * Returns: Records stored (0 at the end of the directory), or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_getdents_handler(interrupt_frame_t *frame)
+{
+    int fd = (int)frame->ebx;
+    vfs_dirent_t *entries = (vfs_dirent_t *)frame->ecx;
+    size_t count = (size_t)frame->edx;
     
-    /* For other file descriptors, use VFS (if available) */
-    /* TODO: Implement VFS write */
-    return -1;  /* EBADF - bad file descriptor */
+    if (count > ((size_t)-1) / sizeof(vfs_dirent_t) ||
+        !user_access_ok(entries, count * sizeof(vfs_dirent_t), true)) {
+        return -1;  /* EFAULT */
+    }
+    return vfs_getdents(fd, entries, count);
 }
 
 /* ---------------------------------------------------------------------------
@@ -292,23 +784,30 @@ static int32_t sys_write_handler(interrupt_frame_t *frame)
  * ---------------------------------------------------------------------------
  * Parameters:
  *   EBX = pathname pointer
- *   ECX = flags (O_RDONLY, O_WRONLY, O_RDWR, etc.)
+ *   ECX = flags (O_RDONLY, O_WRONLY, O_RDWR, etc.; O_DIRECTORY for getdents)
  *   EDX = mode (permissions, for O_CREAT)
  *
  * Returns: File descriptor on success, -1 on error
  * --------------------------------------------------------------------------- */
 static int32_t sys_open_handler(interrupt_frame_t *frame)
 {
-    const char *pathname = (const char *)frame->ebx;
-    /* int flags = (int)frame->ecx; */
+    const char *user_path = (const char *)frame->ebx;
+    int flags = (int)frame->ecx;
     /* int mode = (int)frame->edx; */
+    char pathname[SYSCALL_PATH_MAX];
     
     /* Validate pathname */
-    if (pathname == NULL) {
+    if (user_path == NULL) {
         return -1;  /* EINVAL */
     }
+    if (copy_string_from_user(pathname, user_path, sizeof(pathname)) < 0) {
+        return -1;  /* EFAULT */
+    }
     
     /* Use VFS to open file */
+    if (flags & O_DIRECTORY) {
+        return vfs_opendir(pathname);
+    }
     return vfs_open(pathname);
 }
 
@@ -384,69 +883,841 @@ static int32_t sys_yield_handler(interrupt_frame_t *frame)
 }
 
 /* ---------------------------------------------------------------------------
- * sys_sbrk_handler - Extend heap (simplified brk/sbrk)
+ * sys_sbrk_handler - Move the program break
  * ---------------------------------------------------------------------------
  * Parameters:
- *   EBX = increment (bytes to add to heap)
+ *   EBX = increment (bytes to add to the heap; negative gives memory back)
  *
  * Returns: Previous break value, or -1 on error
  *
- * Note: This is a simplified implementation. Real sbrk needs per-process
- * heap tracking.
+ * The heap lives in the caller's address space (see address_space_sbrk),
+ * so sbrk(0) reports the break and forked children inherit a copy.
  * --------------------------------------------------------------------------- */
 static int32_t sys_sbrk_handler(interrupt_frame_t *frame)
 {
-    (void)frame;  /* Unused for now */
-    
-    /* TODO: Implement per-process heap management */
-    /* For now, userland should use a fixed memory region */
-    
-    return -1;  /* ENOMEM */
+    address_space_t *as = address_space_current(true);
+    uintptr_t old = address_space_sbrk(as, (int32_t)frame->ebx);
+    if (old == 0) {
+        return -1;  /* ENOMEM */
+    }
+    return (int32_t)old;
 }
 
 /* ---------------------------------------------------------------------------
- * syscall_handler - Main syscall dispatcher (called from assembly)
+ * sys_memprof_handler - Control and read the heap allocation profiler
  * ---------------------------------------------------------------------------
- * This function is called by the syscall stub in isr_stubs.asm.
- * It extracts the syscall number from EAX and dispatches to the
- * appropriate handler.
- *
  * Parameters:
- *   frame - Pointer to the interrupt frame with saved registers
+ *   EBX = operation (MEMPROF_READ, MEMPROF_ENABLE, MEMPROF_DISABLE)
+ *   ECX = buffer for MEMPROF_READ
+ *   EDX = buffer size; the snapshot is truncated to fit
  *
- * Returns: Result code (placed in EAX by assembly stub)
+ * Returns: Bytes copied for MEMPROF_READ, 0 for the others, -1 on error
  * --------------------------------------------------------------------------- */
-int32_t syscall_handler(interrupt_frame_t *frame)
+static int32_t sys_memprof_handler(interrupt_frame_t *frame)
 {
-    uint32_t syscall_num = frame->eax;
-    int32_t result = -1;  /* Default: error */
-    
-    syscall_count++;
-    
-    /* Validate syscall number */
-    if (syscall_num >= SYS_MAX) {
-        syscall_errors++;
-        return -1;  /* ENOSYS - invalid syscall number */
+    uint32_t op = frame->ebx;
+
+    if (op == MEMPROF_ENABLE || op == MEMPROF_DISABLE) {
+        heap_profile_enable(op == MEMPROF_ENABLE);
+        return 0;
     }
-    
-    /* Get handler from table */
-    syscall_fn_t handler = syscall_table[syscall_num];
-    
-    if (handler == NULL) {
-        syscall_errors++;
-        return -1;  /* ENOSYS - syscall not implemented */
+    if (op != MEMPROF_READ) {
+        return -1;  /* EINVAL */
     }
-    
-    /* Call the handler */
-    result = handler(frame);
-    
-    return result;
-}
 
-/* ---------------------------------------------------------------------------
- * syscall_init - Initialize the syscall subsystem
- * ---------------------------------------------------------------------------
- * Registers INT 0x80 handler with the IDT.
+    char *buffer = (char *)frame->ecx;
+    size_t count = (size_t)frame->edx;
+    if (buffer == NULL || count == 0) {
+        return -1;  /* EINVAL */
+    }
+
+    heap_profile_t profile;
+    heap_get_profile(&profile);
+
+    if (count > sizeof(heap_profile_t)) {
+        count = sizeof(heap_profile_t);
+    }
+    if (!copy_to_user(buffer, &profile, count)) {
+        return -1;  /* EFAULT */
+    }
+
+    return (int32_t)count;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_schedstat_handler - Read scheduler latency and per-task statistics
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (SCHEDSTAT_LATENCY, SCHEDSTAT_TASKS)
+ *   ECX = buffer
+ *   EDX = buffer size; SCHEDSTAT_LATENCY is truncated to fit,
+ *         SCHEDSTAT_TASKS copies as many whole entries as fit
+ *
+ * Returns: Bytes copied, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_schedstat_handler(interrupt_frame_t *frame)
+{
+    uint32_t op = frame->ebx;
+    char *buffer = (char *)frame->ecx;
+    size_t count = (size_t)frame->edx;
+
+    if (buffer == NULL || count == 0) {
+        return -1;  /* EINVAL */
+    }
+
+    if (op == SCHEDSTAT_TASKS) {
+        if (!user_access_ok(buffer, count, true)) {
+            return -1;  /* EFAULT */
+        }
+        uint32_t entries = scheduler_get_task_info(
+            (scheduler_task_info_t *)buffer,
+            (uint32_t)(count / sizeof(scheduler_task_info_t)));
+        return (int32_t)(entries * sizeof(scheduler_task_info_t));
+    }
+    if (op != SCHEDSTAT_LATENCY) {
+        return -1;  /* EINVAL */
+    }
+
+    scheduler_latency_stats_t stats;
+    scheduler_get_latency_stats(&stats);
+
+    if (count > sizeof(scheduler_latency_stats_t)) {
+        count = sizeof(scheduler_latency_stats_t);
+    }
+    if (!copy_to_user(buffer, &stats, count)) {
+        return -1;  /* EFAULT */
+    }
+
+    return (int32_t)count;
+}
+
+/* Collects results into the caller's array while it has room */
+typedef struct {
+    bench_result_t *out;
+    uint32_t max;
+    uint32_t used;
+} bench_copy_t;
+
+static void bench_copy_result(const bench_result_t *result, void *ctx)
+{
+    bench_copy_t *copy = (bench_copy_t *)ctx;
+    if (copy->used < copy->max) {
+        copy->out[copy->used++] = *result;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_bench_handler - Run in-kernel microbenchmarks
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = name prefix of the benchmarks to run (NULL = all)
+ *   ECX = bench_result_t array
+ *   EDX = array size in bytes; results past the last whole entry are dropped
+ *
+ * Returns: Bytes copied, or -1 on error (including a run already in progress)
+ * --------------------------------------------------------------------------- */
+static int32_t sys_bench_handler(interrupt_frame_t *frame)
+{
+    char filter[BENCH_NAME_MAX];
+    bench_copy_t copy = {
+        .out = (bench_result_t *)frame->ecx,
+        .max = (uint32_t)(frame->edx / sizeof(bench_result_t)),
+        .used = 0,
+    };
+
+    if (copy.out == NULL || copy.max == 0) {
+        return -1;  /* EINVAL */
+    }
+    if (!user_access_ok(copy.out, copy.max * sizeof(bench_result_t), true)) {
+        return -1;  /* EFAULT */
+    }
+    if (frame->ebx != 0 &&
+        copy_string_from_user(filter, (const char *)frame->ebx, sizeof(filter)) < 0) {
+        return -1;  /* EFAULT */
+    }
+    if (bench_run_all(frame->ebx != 0 ? filter : NULL, bench_copy_result, &copy) < 0) {
+        return -1;  /* EBUSY */
+    }
+    return (int32_t)(copy.used * sizeof(bench_result_t));
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_trace_handler - Control and dump the tracepoint rings
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (TRACE_OP_SET, TRACE_OP_DUMP, TRACE_OP_CLEAR)
+ *   ECX = category mask for TRACE_OP_SET (bit n = TRACE_CAT_n)
+ *
+ * Returns: Previous mask, records dumped, or 0; -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_trace_handler(interrupt_frame_t *frame)
+{
+    switch (frame->ebx) {
+        case TRACE_OP_SET:
+            return (int32_t)trace_set_mask(frame->ecx);
+        case TRACE_OP_DUMP:
+            return (int32_t)trace_dump();
+        case TRACE_OP_CLEAR:
+            trace_clear();
+            return 0;
+        default:
+            return -1;  /* EINVAL */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_profile_handler - Control and dump the sampling profiler
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (PROFILE_OP_START, PROFILE_OP_STOP, PROFILE_OP_DUMP)
+ *
+ * Returns: Histogram entries dumped, or 0; -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_profile_handler(interrupt_frame_t *frame)
+{
+    switch (frame->ebx) {
+        case PROFILE_OP_START:
+            profile_start();
+            return 0;
+        case PROFILE_OP_STOP:
+            profile_stop();
+            return 0;
+        case PROFILE_OP_DUMP:
+            return (int32_t)profile_dump();
+        default:
+            return -1;  /* EINVAL */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_perf_handler - Program and read the hardware performance counters
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (PERF_OP_*)
+ *   ECX = event array (PERF_OP_START) or output buffer
+ *   EDX = event count (PERF_OP_START) or buffer size; output is truncated
+ *   ESI = PID for PERF_OP_READ_TASK
+ *
+ * Returns: Bytes copied, or 0; -1 on error (no PMU, no session, bad event)
+ * --------------------------------------------------------------------------- */
+static int32_t sys_perf_handler(interrupt_frame_t *frame)
+{
+    uint32_t op = frame->ebx;
+
+    if (op == PERF_OP_START) {
+        const uint32_t *user_events = (const uint32_t *)frame->ecx;
+        uint32_t count = frame->edx;
+        uint32_t events[PERF_MAX_COUNTERS];
+        if (user_events == NULL || count == 0 || count > PERF_MAX_COUNTERS) {
+            return -1;  /* EINVAL */
+        }
+        if (!copy_from_user(events, user_events, count * sizeof(uint32_t))) {
+            return -1;  /* EFAULT */
+        }
+        return perf_start(events, count) ? 0 : -1;
+    }
+    if (op == PERF_OP_STOP) {
+        perf_stop();
+        return 0;
+    }
+
+    char *buffer = (char *)frame->ecx;
+    size_t count = (size_t)frame->edx;
+    if (buffer == NULL || count == 0) {
+        return -1;  /* EINVAL */
+    }
+
+    perf_info_t info;
+    perf_counts_t counts;
+    const char *src;
+    size_t size;
+
+    switch (op) {
+        case PERF_OP_INFO:
+            perf_get_info(&info);
+            src = (const char *)&info;
+            size = sizeof(info);
+            break;
+        case PERF_OP_READ_SYSTEM:
+            if (!perf_read_system(&counts)) {
+                return -1;
+            }
+            src = (const char *)&counts;
+            size = sizeof(counts);
+            break;
+        case PERF_OP_READ_TASK:
+            if (!perf_read_task(task_get_by_pid(frame->esi), &counts)) {
+                return -1;  /* ESRCH, or no session */
+            }
+            src = (const char *)&counts;
+            size = sizeof(counts);
+            break;
+        default:
+            return -1;  /* EINVAL */
+    }
+
+    if (count > size) {
+        count = size;
+    }
+    if (!copy_to_user(buffer, src, count)) {
+        return -1;  /* EFAULT */
+    }
+    return (int32_t)count;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_meminfo_handler - Read frame, heap and paging statistics
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = buffer for a mem_info_t
+ *   ECX = buffer size; the snapshot is truncated to fit
+ *
+ * Returns: Bytes copied, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_meminfo_handler(interrupt_frame_t *frame)
+{
+    char *buffer = (char *)frame->ebx;
+    size_t count = (size_t)frame->ecx;
+    if (buffer == NULL || count == 0) {
+        return -1;  /* EINVAL */
+    }
+
+    mem_info_t info;
+    info.total_frames = frame_total_count();
+    info.free_frames = frame_free_count();
+    info.heap_total = heap_total_size();
+    info.heap_used = heap_used_size();
+    info.heap_peak = heap_peak_usage();
+    paging_get_stats(address_space_current(false), &info.paging);
+
+    if (count > sizeof(info)) {
+        count = sizeof(info);
+    }
+    if (!copy_to_user(buffer, &info, count)) {
+        return -1;  /* EFAULT */
+    }
+    return (int32_t)count;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_dmesg_handler - Read the records still held in the kernel log
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = buffer for the log text (one line per record, oldest first)
+ *   ECX = buffer size; the newest records that fit are kept
+ *
+ * Returns: Bytes copied, excluding the terminating NUL, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_dmesg_handler(interrupt_frame_t *frame)
+{
+    char *buffer = (char *)frame->ebx;
+    size_t count = (size_t)frame->ecx;
+    if (buffer == NULL || count == 0) {
+        return -1;  /* EINVAL */
+    }
+    if (!user_access_ok(buffer, count, true)) {
+        return -1;  /* EFAULT */
+    }
+    return (int32_t)log_snapshot(buffer, count);
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_irqstat_handler - Read the time spent in each IRQ handler
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = irq_handler_info_t array, one entry per registered handler
+ *   ECX = array size in bytes; handlers past the last whole entry are dropped
+ *
+ * Returns: Bytes copied, or -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_irqstat_handler(interrupt_frame_t *frame)
+{
+    irq_handler_info_t *out = (irq_handler_info_t *)frame->ebx;
+    uint32_t max = (uint32_t)(frame->ecx / sizeof(irq_handler_info_t));
+    if (out == NULL || max == 0) {
+        return -1;  /* EINVAL */
+    }
+    if (!user_access_ok(out, max * sizeof(irq_handler_info_t), true)) {
+        return -1;  /* EFAULT */
+    }
+
+    uint32_t used = 0;
+    irq_handler_stats_t stats;
+    for (uint8_t irq = 0; irq < IRQ_COUNT; irq++) {
+        for (uint32_t i = 0; used < max && irq_get_handler_stats(irq, i, &stats); i++) {
+            irq_handler_info_t *info = &out[used++];
+            info->irq = irq;
+            info->calls = stats.calls;
+            info->handled = stats.handled;
+            info->timed = stats.timed;
+            info->min_cycles = stats.min_cycles;
+            info->avg_cycles = stats.avg_cycles;
+            info->max_cycles = stats.max_cycles;
+            info->unhandled = irq_get_unhandled_count(irq);
+            for (int b = 0; b < IRQ_LAT_BUCKETS; b++) {
+                info->histogram[b] = stats.histogram[b];
+            }
+            size_t len = 0;
+            for (; stats.name != NULL && stats.name[len] != '\0' &&
+                   len < sizeof(info->name) - 1; len++) {
+                info->name[len] = stats.name[len];
+            }
+            info->name[len] = '\0';
+        }
+    }
+    return (int32_t)(used * sizeof(irq_handler_info_t));
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_futex_handler - Wait on or wake a user-space word
+ * ---------------------------------------------------------------------------
+ * User locks and channels update the word with atomics and only enter the
+ * kernel to block on it or to wake the tasks blocked on it.
+ *
+ * Parameters:
+ *   EBX = address of the 32-bit word (4-byte aligned)
+ *   ECX = operation (FUTEX_WAIT, FUTEX_WAKE)
+ *   EDX = FUTEX_WAIT: value the caller last saw; FUTEX_WAKE: most to wake
+ *   ESI = FUTEX_WAIT: timeout in ticks, 0xFFFFFFFF = none
+ *
+ * Returns: WAIT: 0 when woken or the word changed, -1 on timeout;
+ *          WAKE: tasks woken; -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_futex_handler(interrupt_frame_t *frame)
+{
+    volatile uint32_t *addr = (volatile uint32_t *)frame->ebx;
+
+    if (!user_access_ok((const void *)addr, sizeof(uint32_t), false)) {
+        return -1;  /* EFAULT */
+    }
+
+    switch (frame->ecx) {
+        case FUTEX_WAIT:
+            return futex_wait(addr, frame->edx, frame->esi);
+        case FUTEX_WAKE:
+            return futex_wake(addr, frame->edx);
+        default:
+            return -1;  /* EINVAL */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_poll_handler - Wait until a keyboard or IPC source is ready
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = array of kpollfd_t (source, id, events; revents filled in)
+ *   ECX = number of entries (at most POLL_MAX_ENTRIES)
+ *   EDX = most ticks to wait, 0 = just check, 0xFFFFFFFF = no limit
+ *
+ * Returns: number of ready entries (0 on timeout), -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_poll_handler(interrupt_frame_t *frame)
+{
+    kpollfd_t *user_fds = (kpollfd_t *)frame->ebx;
+    uint32_t count = frame->ecx;
+    kpollfd_t fds[POLL_MAX_ENTRIES];
+
+    if (count > POLL_MAX_ENTRIES) {
+        return -1;  /* EINVAL */
+    }
+    if (!copy_from_user(fds, user_fds, count * sizeof(kpollfd_t))) {
+        return -1;  /* EFAULT */
+    }
+
+    int ready = kpoll(fds, count, frame->edx);
+    if (ready >= 0 && !copy_to_user(user_fds, fds, count * sizeof(kpollfd_t))) {
+        return -1;  /* EFAULT */
+    }
+    return ready;
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_epoll_handler - Interest sets with a ready list
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (EPOLL_OP_CREATE, _CTL, _WAIT, _CLOSE)
+ *   ECX = instance (all but CREATE)
+ *   EDX = CTL: kepoll_ctl_t *; WAIT: kepoll_event_t array
+ *   ESI = WAIT: entries in the array
+ *   EDI = WAIT: most ticks to wait, 0xFFFFFFFF = no limit
+ *
+ * Returns: CREATE: instance; WAIT: events stored; CTL/CLOSE: 0; -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_epoll_handler(interrupt_frame_t *frame)
+{
+    int epfd = (int)frame->ecx;
+
+    switch (frame->ebx) {
+        case EPOLL_OP_CREATE:
+            return epoll_create();
+        case EPOLL_OP_CTL: {
+            kepoll_ctl_t ctl;
+            if (!copy_from_user(&ctl, (const void *)frame->edx, sizeof(ctl))) {
+                return -1;  /* EFAULT */
+            }
+            kepoll_event_t event = { ctl.events, ctl.data };
+            return epoll_ctl(epfd, ctl.op, ctl.source, ctl.id, &event);
+        }
+        case EPOLL_OP_WAIT:
+            if (frame->esi > ((size_t)-1) / sizeof(kepoll_event_t) ||
+                !user_access_ok((void *)frame->edx, frame->esi * sizeof(kepoll_event_t), true)) {
+                return -1;  /* EFAULT */
+            }
+            return epoll_wait(epfd, (kepoll_event_t *)frame->edx, frame->esi, frame->edi);
+        case EPOLL_OP_CLOSE:
+            return epoll_close(epfd);
+        default:
+            return -1;  /* EINVAL */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * sys_ioring_handler - Batched submission and completion rings
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   EBX = operation (IORING_SETUP, IORING_ENTER, IORING_DESTROY)
+ *   ECX = SETUP: SQ entries (power of two); otherwise the ring address
+ *   EDX = ENTER: completions to wait for (0 = just submit)
+ *   ESI = ENTER: most ticks to wait, 0xFFFFFFFF = no limit
+ *
+ * Returns: SETUP: ring address; ENTER: requests submitted; DESTROY: 0;
+ *          -1 on error
+ * --------------------------------------------------------------------------- */
+static int32_t sys_ioring_handler(interrupt_frame_t *frame)
+{
+    switch (frame->ebx) {
+        case IORING_SETUP: {
+            uintptr_t ring = io_ring_setup(frame->ecx);
+            return (ring != 0) ? (int32_t)ring : -1;
+        }
+        case IORING_ENTER:
+            return io_ring_enter(frame->ecx, frame->edx, frame->esi);
+        case IORING_DESTROY:
+            return io_ring_destroy(frame->ecx);
+        default:
+            return -1;  /* EINVAL */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall_handler - Main syscall dispatcher (called from assembly)
+ * ---------------------------------------------------------------------------
+ * This function is called by the syscall stub in isr_stubs.asm.
+ * It extracts the syscall number from EAX and dispatches to the
+ * appropriate handler.
+ *
+ * Parameters:
+ *   frame - Pointer to the interrupt frame with saved registers
+ *
+ * Returns: Result code (placed in EAX by assembly stub)
+ * --------------------------------------------------------------------------- */
+int32_t syscall_handler(interrupt_frame_t *frame)
+{
+    uint32_t syscall_num = frame->eax;
+    int32_t result = -1;  /* Default: error */
+    
+    syscall_count++;
+    
+    /* Validate syscall number */
+    if (syscall_num >= SYS_MAX) {
+        syscall_errors++;
+        return -1;  /* ENOSYS - invalid syscall number */
+    }
+    
+    /* Get handler from table */
+    syscall_fn_t handler = syscall_table[syscall_num];
+    
+    if (handler == NULL) {
+        syscall_errors++;
+        return -1;  /* ENOSYS - syscall not implemented */
+    }
+    
+    /* Call the handler */
+    TRACE(TRACE_SYSCALL_ENTER, syscall_num, frame->ebx);
+    result = handler(frame);
+    TRACE(TRACE_SYSCALL_EXIT, syscall_num, result);
+    
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * sysenter_handler - Load the stack arguments of a SYSENTER call
+ * ---------------------------------------------------------------------------
+ * Arguments 2 and 3 are on the user stack (frame->esp), which may be any
+ * value the caller put in ECX: it is read with copy_from_user(), so a
+ * kernel or unmapped address fails the call instead of being read.
+ *
+ * Returns: Result code (placed in EAX by sysenter_entry)
+ * --------------------------------------------------------------------------- */
+int32_t sysenter_handler(interrupt_frame_t *frame)
+{
+    uint32_t args[2];
+    if (!copy_from_user(args, (const void *)frame->esp, sizeof(args))) {
+        return -1;  /* EFAULT */
+    }
+    frame->ecx = args[0];
+    frame->edx = args[1];
+    return syscall_handler(frame);
+}
+
+/* ---------------------------------------------------------------------------
+ * sysenter_entry - SYSENTER fast path
+ * ---------------------------------------------------------------------------
+ * Builds just enough of an interrupt_frame_t (eax, ebx, ecx, edx, esi, edi,
+ * ebp, and the user EIP and ESP) for the handlers and calls
+ * sysenter_handler(). The segment slots and the rest of the CPU-pushed
+ * slots are left unwritten; int_no is 0 so handlers that need an IRET
+ * frame (fork) can tell this frame apart. User data segments are flat, so
+ * DS/ES need no reload either. SYSENTER reloads the kernel ESP from its
+ * MSR every time, so the exit path just reads the user EIP and ESP back
+ * instead of unwinding the frame.
+ *
+ * Stack on the call (growing down):
+ *   unused (ss), esp = user ESP, unused (eflags, cs), eip = user EIP,
+ *   unused (err_code), int_no = 0, eax, ecx, edx (filled in by
+ *   sysenter_handler), ebx, unused (esp_dummy), ebp, esi, edi,
+ *   4 unused segment slots  <- frame
+ * --------------------------------------------------------------------------- */
+__asm__(
+    ".pushsection .text\n"
+    ".global sysenter_entry\n"
+    "sysenter_entry:\n"
+    "    subl $4, %esp\n"              /* ss */
+    "    pushl %ecx\n"                 /* esp: user ESP */
+    "    subl $8, %esp\n"              /* eflags, cs */
+    "    pushl %edx\n"                 /* eip: user EIP */
+    "    subl $4, %esp\n"              /* err_code */
+    "    pushl $0\n"                   /* int_no: not an INT 0x80 frame */
+    "    pushl %eax\n"
+    "    subl $8, %esp\n"              /* ecx, edx: arguments 2 and 3 */
+    "    pushl %ebx\n"
+    "    subl $4, %esp\n"              /* esp_dummy */
+    "    pushl %ebp\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    subl $16, %esp\n"             /* ds, es, fs, gs */
+    "    pushl %esp\n"
+    "    call sysenter_handler\n"
+    "    addl $20, %esp\n"             /* Argument and segment slots */
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebp\n"
+    "    addl $4, %esp\n"
+    "    popl %ebx\n"
+    "    movl 20(%esp), %edx\n"        /* SYSEXIT: EIP from EDX (eip slot) */
+    "    movl 32(%esp), %ecx\n"        /*          ESP from ECX (esp slot) */
+    "    sti\n"                        /* Takes effect after SYSEXIT */
+    "    sysexit\n"
+    ".popsection\n"
+);
+
+extern void sysenter_entry(void);
+
+/* Double fault handler, run as the #DF task (interrupts/isr.c) */
+extern void isr_double_fault_task(void);
+
+static inline void wrmsr(uint32_t msr, uint32_t value)
+{
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"(value), "d"(0));
+}
+
+/* Descriptor-table register image (sgdt/lgdt operand) */
+typedef struct __attribute__((packed)) {
+    uint16_t limit;
+    uint32_t base;
+} gdt_register_t;
+
+/*
+ * 32-bit Task State Segment. In a CPU's own TSS only ss0:esp0 is set up: it
+ * is the stack a trap from ring 3 switches to. Tasks are switched in
+ * software; the one hardware task switch is the #DF task gate, which saves
+ * the faulting state into the CPU's TSS and loads the double-fault TSS.
+ * Each CPU loads its own, since esp0 follows the task running there.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t prev_task;
+    uint32_t esp0;
+    uint32_t ss0;
+    uint32_t esp1, ss1, esp2, ss2;  /* Unused rings */
+    uint32_t cr3;
+    uint32_t eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint16_t trap;
+    uint16_t iomap_base;            /* Past the limit: no I/O bitmap */
+} tss_t;
+
+/* Boot GDT plus the ring 3 segments (where SYSEXIT expects them) and the TSSs */
+static uint64_t user_gdt[USER_GDT_ENTRIES] __attribute__((aligned(8)));
+static tss_t tss[SMP_MAX_CPUS] __attribute__((aligned(16)));
+
+/*
+ * The #DF task. Shared by every CPU (the IDT is); a second CPU faulting
+ * while one is already in it finds the TSS busy and resets the machine.
+ */
+static tss_t df_tss __attribute__((aligned(16)));
+static uint8_t df_stack[DF_STACK_SIZE] __attribute__((aligned(16)));
+
+/* TSS descriptor for the GDT */
+static uint64_t tss_descriptor(const tss_t *t)
+{
+    uint64_t base = (uint32_t)(uintptr_t)t;
+    return (sizeof(tss_t) - 1) |
+           ((base & 0xFFFFFF) << 16) |
+           ((uint64_t)GDT_TSS_ACCESS << 40) |
+           ((base >> 24) << 56);
+}
+
+/* ---------------------------------------------------------------------------
+ * user_segments_init - Install the ring 3 segments and the TSS
+ * ---------------------------------------------------------------------------
+ * The boot GDT only has the kernel segments, so it is copied into a larger
+ * table with the user code/data descriptors at kernel CS + 16/24 (the
+ * offsets SYSEXIT uses) and one TSS per CPU after them. The existing
+ * selectors keep their values, so nothing needs reloading. The BSP loads
+ * TSS 0; APs load theirs in syscall_cpu_init().
+ * --------------------------------------------------------------------------- */
+static void user_segments_init(uint16_t kernel_cs)
+{
+    gdt_register_t gdtr;
+    __asm__ volatile("sgdt %0" : "=m"(gdtr));
+
+    uint32_t entries = (gdtr.limit + 1u) / sizeof(uint64_t);
+    if (entries > USER_GDT_ENTRIES) {
+        entries = USER_GDT_ENTRIES;
+    }
+    const uint64_t *boot_gdt = (const uint64_t *)(uintptr_t)gdtr.base;
+    for (uint32_t i = 0; i < entries; i++) {
+        user_gdt[i] = boot_gdt[i];
+    }
+    user_gdt[(kernel_cs + 16) / 8] = GDT_USER_CODE;
+    user_gdt[(kernel_cs + 24) / 8] = GDT_USER_DATA;
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        tss[cpu].ss0 = kernel_cs + 8;   /* Kernel data */
+        tss[cpu].iomap_base = sizeof(tss_t);
+        user_gdt[TSS_SELECTOR(cpu) / 8] = tss_descriptor(&tss[cpu]);
+    }
+    user_gdt[DF_TSS_SELECTOR / 8] = tss_descriptor(&df_tss);
+
+    gdtr.limit = sizeof(user_gdt) - 1;
+    gdtr.base = (uint32_t)(uintptr_t)user_gdt;
+    __asm__ volatile("lgdt %0" :: "m"(gdtr));
+    __asm__ volatile("ltr %w0" :: "r"(TSS_SELECTOR(0)));
+}
+
+/* ---------------------------------------------------------------------------
+ * double_fault_init - Route #DF through a task gate
+ * ---------------------------------------------------------------------------
+ * A kernel stack overflow faults on the unmapped guard page with ESP
+ * already inside it, so the CPU cannot push the #PF frame and escalates to
+ * #DF, which an interrupt gate could not push either. The task gate loads
+ * a fresh stack (and the kernel directory: paging_init() has run) first.
+ * --------------------------------------------------------------------------- */
+static void double_fault_init(uint16_t kernel_cs)
+{
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+
+    df_tss.cr3 = cr3;
+    df_tss.eip = (uint32_t)(uintptr_t)isr_double_fault_task;
+    df_tss.eflags = 0x2;                /* Interrupts off */
+    df_tss.esp = (uint32_t)(uintptr_t)(df_stack + DF_STACK_SIZE);
+    df_tss.cs = kernel_cs;
+    df_tss.ss = df_tss.ds = df_tss.es = df_tss.fs = df_tss.gs = kernel_cs + 8;
+    df_tss.iomap_base = sizeof(tss_t);
+
+    idt_set_gate(ISR_DOUBLE_FAULT, 0, DF_TSS_SELECTOR, IDT_GATE_TASK);
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall_fault_state - Registers of the task that double faulted
+ * ---------------------------------------------------------------------------
+ * The #DF task switch saved them in the faulting CPU's TSS.
+ * --------------------------------------------------------------------------- */
+void syscall_fault_state(interrupt_frame_t *frame)
+{
+    const tss_t *t = &tss[smp_cpu_id()];
+
+    frame->gs = t->gs;
+    frame->fs = t->fs;
+    frame->es = t->es;
+    frame->ds = t->ds;
+    frame->edi = t->edi;
+    frame->esi = t->esi;
+    frame->ebp = t->ebp;
+    frame->ebx = t->ebx;
+    frame->edx = t->edx;
+    frame->ecx = t->ecx;
+    frame->eax = t->eax;
+    frame->eip = t->eip;
+    frame->cs = t->cs;
+    frame->eflags = t->eflags;
+    frame->esp = t->esp;
+    frame->ss = t->ss;
+}
+
+/* ---------------------------------------------------------------------------
+ * sysenter_supported - Check CPUID for a working SYSENTER
+ * ---------------------------------------------------------------------------
+ * Early Pentium Pro parts (family 6, model < 3, stepping < 3) report SEP
+ * but do not implement it.
+ * --------------------------------------------------------------------------- */
+static bool sysenter_supported(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+    if (!(edx & CPUID_EDX_SEP)) {
+        return false;
+    }
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* ---------------------------------------------------------------------------
+ * sysenter_init - Program the SYSENTER MSRs
+ * --------------------------------------------------------------------------- */
+static void sysenter_init(uint16_t kernel_cs)
+{
+    if (!sysenter_supported()) {
+        return;  /* INT 0x80 only */
+    }
+
+    wrmsr(MSR_SYSENTER_CS, kernel_cs);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)(uintptr_t)sysenter_entry);
+    wrmsr(MSR_SYSENTER_ESP, tss[smp_cpu_id()].esp0);
+    sysenter_enabled = true;
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall_set_kernel_stack - Point syscalls and traps at a task's stack
+ * ---------------------------------------------------------------------------
+ * Called by the scheduler for the task it switches to, so a SYSENTER or a
+ * trap from ring 3 lands on that task's own stack (a task blocked in a
+ * syscall keeps its frame while others enter).
+ * --------------------------------------------------------------------------- */
+void syscall_set_kernel_stack(task_t *task)
+{
+    if (task == NULL || task->stack_base == NULL) {
+        return;
+    }
+
+    tss_t *cpu_tss = &tss[smp_cpu_id()];
+    cpu_tss->esp0 = (uint32_t)(uintptr_t)task->stack_base + task->stack_size;
+    if (sysenter_enabled) {
+        wrmsr(MSR_SYSENTER_ESP, cpu_tss->esp0);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall_init - Initialize the syscall subsystem
+ * ---------------------------------------------------------------------------
+ * Registers INT 0x80 handler with the IDT, and the SYSENTER entry point
+ * if the CPU has one.
  * Must be called after idt_init() but before enabling interrupts.
  * --------------------------------------------------------------------------- */
 void syscall_init(void)
@@ -470,6 +1741,27 @@ void syscall_init(void)
         KERNEL_CS,                  /* Kernel code segment */
         IDT_GATE_INTERRUPT_USER     /* Allow user mode access */
     );
+
+    /* Ring 3 segments and TSS, then the fast path where the CPU has one */
+    user_segments_init(KERNEL_CS);
+    double_fault_init(KERNEL_CS);
+    syscall_set_kernel_stack(task_current());
+    sysenter_init(KERNEL_CS);
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall_cpu_init - Give an application processor its TSS and SYSENTER
+ * ---------------------------------------------------------------------------
+ * The GDT, IDT and SYSENTER MSR values are the BSP's (syscall_init() ran
+ * there); the task register and the MSRs themselves are per CPU.
+ * --------------------------------------------------------------------------- */
+void syscall_cpu_init(void)
+{
+    __asm__ volatile("ltr %w0" :: "r"(TSS_SELECTOR(smp_cpu_id())));
+
+    if (sysenter_enabled) {
+        sysenter_init(KERNEL_CS);
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -0,0 +1,707 @@
+/*
+ * ===========================================================================
+ * kernel/utils/bench.c
+ * ===========================================================================
+ *
+ * In-Kernel Microbenchmarks
+ *
+ * Times registered benchmarks with the TSC and reports cycles per
+ * operation (see bench.h for the output format). Each sample is one call
+ * to the benchmark's run() callback, divided by its operation count, so the
+ * cost of reading the TSC is spread over a batch. Interrupts stay enabled:
+ * a timer tick that lands in a sample shows up in p99 rather than in the
+ * median.
+ *
+ * When the PMU is free, bench_run_all() starts a perf session for
+ * instructions, cycles, branch misses and LLC misses (as many as there are
+ * counters) and sums them over the timed samples on the running CPU, so
+ * the counts include any peer task the benchmark switches to.
+ *
+ * Built-in benchmarks:
+ *   kmalloc_64        kmalloc(64) + kfree
+ *   kmalloc_churn     free and reallocate one of 32 live blocks, 16-2048 bytes
+ *   frame_alloc       frame_alloc + frame_free of one frame
+ *   frame_contig_16k  four contiguous frames (buddy tree when enabled)
+ *   freelist_16k      the same size from the standalone free list allocator
+ *   ctx_switch        task_yield round trip with a peer task
+ *   syscall_getpid    INT 0x80 round trip (from ring 0, no stack switch)
+ *   msgq_pingpong     send + blocking receive through a peer task
+ *   vfs_open_close    open + close of a RAMFS file
+ *   ramfs_read_4k     pread of 4 KB from a RAMFS file
+ *   ramfs_write_4k    pwrite of 4 KB to a RAMFS file
+ *   hashmap_get       lookup among 256 keys
+ *   trie_search       the same keys in a trie
+ *
+ * ===========================================================================
+ */
+
+#include <lib/cstd/stdio.h>
+#include <lib/dsa/hashmap.h>
+#include <lib/dsa/trie.h>
+#include "../memory/memory.h"
+#include "../memory/dsa_structures/freelist.h"
+#include "../drivers/drivers.h"
+#include "../scheduler/scheduler.h"
+#include "../scheduler/task.h"
+#include "../fs/vfs.h"
+#include "bench.h"
+#include "perf.h"
+
+/* Message queues (kernel/ipc/message_queue.c) */
+extern void msgq_init(void);
+extern bool msgq_is_initialized(void);
+extern int msgq_create(uint32_t key);
+extern int msgq_destroy(int qid);
+extern int msgq_send(int qid, const void *data, size_t size, uint32_t type);
+extern ssize_t msgq_receive_timeout(int qid, void *buffer, size_t size, uint32_t type,
+                                    uint32_t timeout);
+
+#define MSGQ_WAIT_FOREVER   0xFFFFFFFFu
+
+#define SYS_GETPID          20
+
+/* ---------------------------------------------------------------------------
+ * Harness State
+ * --------------------------------------------------------------------------- */
+static const bench_t *benches[BENCH_MAX];
+static uint32_t bench_count = 0;
+static bool builtins_registered = false;
+static bool bench_running = false;
+
+static uint32_t samples[BENCH_SAMPLES];
+
+/* Hardware events, in priority order for CPUs with few counters */
+static const uint32_t wanted_events[] = {
+    PERF_EVENT_INSTRUCTIONS, PERF_EVENT_CYCLES,
+    PERF_EVENT_BRANCH_MISSES, PERF_EVENT_LLC_MISSES,
+};
+#define WANTED_EVENTS   (sizeof(wanted_events) / sizeof(wanted_events[0]))
+
+static uint32_t perf_events[PERF_MAX_COUNTERS];
+static uint32_t perf_count = 0;         /* 0 = not counting */
+static uint64_t perf_totals[PERF_MAX_COUNTERS];
+
+static void register_builtins(void);
+
+/* ---------------------------------------------------------------------------
+ * bench_register - Add a benchmark to the table
+ * --------------------------------------------------------------------------- */
+bool bench_register(const bench_t *bench)
+{
+    if (bench == NULL || bench->run == NULL || bench->ops == 0 ||
+        bench_count >= BENCH_MAX) {
+        return false;
+    }
+    benches[bench_count++] = bench;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Measurement
+ * --------------------------------------------------------------------------- */
+
+static void sort_samples(uint32_t *values, uint32_t count)
+{
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t value = values[i];
+        uint32_t j = i;
+        while (j > 0 && values[j - 1] > value) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+    }
+}
+
+/* n / d with one 64/32 DIV; 0 if d is 0 or the quotient would overflow */
+static uint32_t div64_32(uint64_t n, uint32_t d)
+{
+    if (d == 0 || (uint32_t)(n >> 32) >= d) {
+        return 0;
+    }
+    uint32_t quot, rem;
+    __asm__("divl %4"
+            : "=a"(quot), "=d"(rem)
+            : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+    return quot;
+}
+
+/* khz * 1000 / cycles_per_op */
+static uint32_t ops_per_second(uint32_t cycles_per_op)
+{
+    return div64_32((uint64_t)clock_get_khz() * 1000, cycles_per_op);
+}
+
+/* Claim the PMU for the run if it is there and free */
+static void perf_begin(void)
+{
+    perf_info_t info;
+    perf_get_info(&info);
+
+    perf_count = 0;
+    for (uint32_t i = 0; i < WANTED_EVENTS; i++) {
+        if (perf_count < info.counters && perf_count < PERF_MAX_COUNTERS &&
+            (info.events & (1u << wanted_events[i]))) {
+            perf_events[perf_count++] = wanted_events[i];
+        }
+    }
+    if (perf_count != 0 && !perf_start(perf_events, perf_count)) {
+        perf_count = 0;
+    }
+}
+
+/* Total of one event over the last benchmark's samples; false if not counted */
+static bool perf_total(uint32_t event, uint64_t *total)
+{
+    for (uint32_t i = 0; i < perf_count; i++) {
+        if (perf_events[i] == event) {
+            *total = perf_totals[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void perf_fill(bench_result_t *result)
+{
+    uint32_t ops = BENCH_SAMPLES * result->ops;
+    uint64_t insns, cycles, misses;
+
+    result->perf_events = 0;
+    result->instructions = 0;
+    result->ipc_milli = 0;
+    result->llc_misses_per_kop = 0;
+    result->branch_misses_per_kop = 0;
+
+    if (perf_total(PERF_EVENT_INSTRUCTIONS, &insns)) {
+        result->perf_events |= 1u << PERF_EVENT_INSTRUCTIONS;
+        result->instructions = div64_32(insns, ops);
+        if (perf_total(PERF_EVENT_CYCLES, &cycles)) {
+            result->perf_events |= 1u << PERF_EVENT_CYCLES;
+            while (cycles >> 32) {
+                cycles >>= 1;
+                insns >>= 1;
+            }
+            result->ipc_milli = div64_32(insns * 1000, (uint32_t)cycles);
+        }
+    }
+    if (perf_total(PERF_EVENT_LLC_MISSES, &misses)) {
+        result->perf_events |= 1u << PERF_EVENT_LLC_MISSES;
+        result->llc_misses_per_kop = div64_32(misses * 1000, ops);
+    }
+    if (perf_total(PERF_EVENT_BRANCH_MISSES, &misses)) {
+        result->perf_events |= 1u << PERF_EVENT_BRANCH_MISSES;
+        result->branch_misses_per_kop = div64_32(misses * 1000, ops);
+    }
+}
+
+static bool bench_measure(const bench_t *bench, bench_result_t *result)
+{
+    if (bench->setup != NULL && !bench->setup()) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < BENCH_WARMUP; i++) {
+        bench->run(bench->ops);
+    }
+    for (uint32_t i = 0; i < perf_count; i++) {
+        perf_totals[i] = 0;
+    }
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint64_t before[PERF_MAX_COUNTERS];
+        uint64_t after[PERF_MAX_COUNTERS];
+        bool counted = perf_count != 0 && perf_read_local(before);
+
+        uint64_t start = clock_cycles();
+        bench->run(bench->ops);
+        uint64_t elapsed = clock_cycles() - start;
+
+        if (counted && perf_read_local(after)) {
+            for (uint32_t c = 0; c < perf_count; c++) {
+                perf_totals[c] += after[c] - before[c];
+            }
+        }
+        uint32_t cycles = (elapsed >> 32) ? 0xFFFFFFFFu : (uint32_t)elapsed;
+        samples[i] = cycles / bench->ops;
+    }
+
+    if (bench->teardown != NULL) {
+        bench->teardown();
+    }
+
+    sort_samples(samples, BENCH_SAMPLES);
+
+    uint32_t n = 0;
+    while (bench->name[n] != '\0' && n < BENCH_NAME_MAX - 1) {
+        result->name[n] = bench->name[n];
+        n++;
+    }
+    result->name[n] = '\0';
+    result->ops = bench->ops;
+    result->samples = BENCH_SAMPLES;
+    result->min_cycles = samples[0];
+    result->median_cycles = samples[BENCH_SAMPLES / 2];
+    result->p99_cycles = samples[(BENCH_SAMPLES * 99 + 99) / 100 - 1];
+    result->ops_per_sec = ops_per_second(result->median_cycles);
+    perf_fill(result);
+    return true;
+}
+
+static bool name_matches(const char *name, const char *filter)
+{
+    if (filter == NULL) {
+        return true;
+    }
+    while (*filter != '\0') {
+        if (*name++ != *filter++) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * bench_run_all - Run the matching benchmarks
+ * --------------------------------------------------------------------------- */
+int bench_run_all(const char *filter, bench_emit_t emit, void *ctx)
+{
+    if (bench_running) {
+        return -1;
+    }
+    bench_running = true;
+
+    if (!builtins_registered) {
+        builtins_registered = true;
+        register_builtins();
+    }
+
+    perf_begin();
+
+    int count = 0;
+    for (uint32_t i = 0; i < bench_count; i++) {
+        bench_result_t result;
+        if (!name_matches(benches[i]->name, filter) || !bench_measure(benches[i], &result)) {
+            continue;
+        }
+        if (emit != NULL) {
+            emit(&result, ctx);
+        }
+        count++;
+    }
+
+    if (perf_count != 0) {
+        perf_stop();
+        perf_count = 0;
+    }
+    bench_running = false;
+    return count;
+}
+
+void bench_print(const bench_result_t *result, void *ctx)
+{
+    UNUSED(ctx);
+    uint32_t events = result->perf_events;
+
+    kprintf("BENCH name=%s ops=%u samples=%u min=%u median=%u p99=%u ops_per_sec=%u",
+            result->name, result->ops, result->samples, result->min_cycles,
+            result->median_cycles, result->p99_cycles, result->ops_per_sec);
+    if (events & (1u << PERF_EVENT_INSTRUCTIONS)) {
+        kprintf(" insns=%u", result->instructions);
+    }
+    if (events & (1u << PERF_EVENT_CYCLES)) {
+        kprintf(" ipc_milli=%u", result->ipc_milli);
+    }
+    if (events & (1u << PERF_EVENT_LLC_MISSES)) {
+        kprintf(" llc_miss_per_kop=%u", result->llc_misses_per_kop);
+    }
+    if (events & (1u << PERF_EVENT_BRANCH_MISSES)) {
+        kprintf(" br_miss_per_kop=%u", result->branch_misses_per_kop);
+    }
+    kprintf("\n");
+}
+
+void bench_report(const char *filter)
+{
+    kprintf("BENCH-START version=%s khz=%u\n", NEXAKERNEL_VERSION_STRING, clock_get_khz());
+    int count = bench_run_all(filter, bench_print, NULL);
+    kprintf("BENCH-DONE count=%d\n", count);
+}
+
+/* ===========================================================================
+ * Built-in Benchmarks
+ * =========================================================================== */
+
+/* ---------------------------------------------------------------------------
+ * Heap and Frame Allocators
+ * --------------------------------------------------------------------------- */
+
+static void run_kmalloc_64(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        kfree(kmalloc(64));
+    }
+}
+
+#define CHURN_LIVE          32
+
+static void *churn_blocks[CHURN_LIVE];
+static uint32_t churn_seed;
+
+static size_t churn_size(void)
+{
+    churn_seed = churn_seed * 1103515245u + 12345u;
+    return (size_t)16 << ((churn_seed >> 16) % 8);     /* 16..2048 */
+}
+
+static bool setup_kmalloc_churn(void)
+{
+    churn_seed = 1;
+    for (uint32_t i = 0; i < CHURN_LIVE; i++) {
+        churn_blocks[i] = kmalloc(churn_size());
+    }
+    return true;
+}
+
+static void run_kmalloc_churn(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t slot = (churn_seed >> 8) % CHURN_LIVE;
+        kfree(churn_blocks[slot]);
+        churn_blocks[slot] = kmalloc(churn_size());
+    }
+}
+
+static void teardown_kmalloc_churn(void)
+{
+    for (uint32_t i = 0; i < CHURN_LIVE; i++) {
+        kfree(churn_blocks[i]);
+        churn_blocks[i] = NULL;
+    }
+}
+
+static void run_frame_alloc(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        uintptr_t frame = frame_alloc();
+        if (frame != 0) {
+            frame_free(frame);
+        }
+    }
+}
+
+#define CONTIG_FRAMES       4
+
+static void run_frame_contig(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        uintptr_t run = frame_alloc_contiguous(CONTIG_FRAMES);
+        if (run != 0) {
+            frame_free_contiguous(run, CONTIG_FRAMES);
+        }
+    }
+}
+
+#define FREELIST_ARENA      (256 * 1024)
+
+static void *freelist_arena;
+
+static bool setup_freelist(void)
+{
+    freelist_arena = kmalloc(FREELIST_ARENA);
+    if (freelist_arena == NULL) {
+        return false;
+    }
+    if (!freelist_init(freelist_arena, FREELIST_ARENA)) {
+        kfree(freelist_arena);
+        return false;
+    }
+    return true;
+}
+
+static void run_freelist(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        void *block = freelist_alloc(CONTIG_FRAMES * PAGE_SIZE);
+        if (block != NULL) {
+            freelist_free(block);
+        }
+    }
+}
+
+static void teardown_freelist(void)
+{
+    kfree(freelist_arena);
+    freelist_arena = NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Scheduler, System Calls and IPC
+ * ---------------------------------------------------------------------------
+ * The round-trip benchmarks run against a peer task at the caller's
+ * priority. The peer sets peer_done just before it exits.
+ * --------------------------------------------------------------------------- */
+static volatile bool peer_stop;
+static volatile bool peer_done;
+
+static bool peer_start(void (*entry)(void *))
+{
+    if (!scheduler_is_running() || task_current() == NULL) {
+        return false;
+    }
+    peer_stop = false;
+    peer_done = false;
+    task_t *peer = task_create("bench-peer", entry, NULL,
+                               task_get_priority(task_current()), 0);
+    if (peer == NULL) {
+        return false;
+    }
+    scheduler_add_task(peer);
+    return true;
+}
+
+static void peer_wait_done(void)
+{
+    while (!peer_done) {
+        task_yield();
+    }
+}
+
+static void yield_peer(void *arg)
+{
+    UNUSED(arg);
+    while (!peer_stop) {
+        task_yield();
+    }
+    peer_done = true;
+    task_exit(0);
+}
+
+static bool setup_ctx_switch(void)
+{
+    return peer_start(yield_peer);
+}
+
+static void run_ctx_switch(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        task_yield();
+    }
+}
+
+static void teardown_ctx_switch(void)
+{
+    peer_stop = true;
+    peer_wait_done();
+}
+
+static void run_syscall_getpid(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        int32_t result;
+        __asm__ volatile("int $0x80" : "=a"(result) : "a"(SYS_GETPID) : "memory");
+    }
+}
+
+#define MSGQ_PING_KEY       0xBE4C0001u
+#define MSGQ_PONG_KEY       0xBE4C0002u
+#define MSGQ_STOP           0xFFFFFFFFu
+
+static int ping_qid = -1;
+static int pong_qid = -1;
+
+static void msgq_peer(void *arg)
+{
+    UNUSED(arg);
+    uint32_t value;
+    while (msgq_receive_timeout(ping_qid, &value, sizeof(value), 0, MSGQ_WAIT_FOREVER) > 0 &&
+           value != MSGQ_STOP) {
+        msgq_send(pong_qid, &value, sizeof(value), 1);
+    }
+    peer_done = true;
+    task_exit(0);
+}
+
+static bool setup_msgq(void)
+{
+    if (!msgq_is_initialized()) {
+        msgq_init();
+    }
+    ping_qid = msgq_create(MSGQ_PING_KEY);
+    pong_qid = msgq_create(MSGQ_PONG_KEY);
+    if (ping_qid >= 0 && pong_qid >= 0 && peer_start(msgq_peer)) {
+        return true;
+    }
+    if (ping_qid >= 0) {
+        msgq_destroy(ping_qid);
+    }
+    if (pong_qid >= 0) {
+        msgq_destroy(pong_qid);
+    }
+    return false;
+}
+
+static void run_msgq(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t value = i;
+        msgq_send(ping_qid, &value, sizeof(value), 1);
+        msgq_receive_timeout(pong_qid, &value, sizeof(value), 0, MSGQ_WAIT_FOREVER);
+    }
+}
+
+static void teardown_msgq(void)
+{
+    uint32_t stop = MSGQ_STOP;
+    msgq_send(ping_qid, &stop, sizeof(stop), 1);
+    peer_wait_done();
+    msgq_destroy(ping_qid);
+    msgq_destroy(pong_qid);
+}
+
+/* ---------------------------------------------------------------------------
+ * RAMFS
+ * --------------------------------------------------------------------------- */
+#define BENCH_FILE          "/bench.dat"
+#define BENCH_IO_SIZE       4096
+
+static uint8_t io_buffer[BENCH_IO_SIZE];
+static int bench_fd = -1;
+
+static bool setup_file(void)
+{
+    if (!vfs_is_initialized()) {
+        return false;
+    }
+    vfs_create(BENCH_FILE);
+    bench_fd = vfs_open(BENCH_FILE);
+    if (bench_fd < 0) {
+        vfs_unlink(BENCH_FILE);
+        return false;
+    }
+    vfs_pwrite(bench_fd, io_buffer, BENCH_IO_SIZE, 0);
+    return true;
+}
+
+static void teardown_file(void)
+{
+    vfs_close(bench_fd);
+    bench_fd = -1;
+    vfs_unlink(BENCH_FILE);
+}
+
+static void run_open_close(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        int fd = vfs_open(BENCH_FILE);
+        if (fd >= 0) {
+            vfs_close(fd);
+        }
+    }
+}
+
+static void run_ramfs_read(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        vfs_pread(bench_fd, io_buffer, BENCH_IO_SIZE, 0);
+    }
+}
+
+static void run_ramfs_write(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        vfs_pwrite(bench_fd, io_buffer, BENCH_IO_SIZE, 0);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Lookup Structures
+ * --------------------------------------------------------------------------- */
+#define LOOKUP_KEYS         256
+
+static char lookup_keys[LOOKUP_KEYS][16];
+static hashmap_t lookup_map;
+static trie_t lookup_trie;
+
+static void make_lookup_keys(void)
+{
+    for (uint32_t i = 0; i < LOOKUP_KEYS; i++) {
+        ksnprintf(lookup_keys[i], sizeof(lookup_keys[i]), "bench/key-%u", i);
+    }
+}
+
+static bool setup_hashmap(void)
+{
+    make_lookup_keys();
+    if (!hashmap_init(&lookup_map, LOOKUP_KEYS)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < LOOKUP_KEYS; i++) {
+        if (!hashmap_put(&lookup_map, lookup_keys[i], lookup_keys[i])) {
+            hashmap_destroy(&lookup_map);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_hashmap(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        hashmap_get(&lookup_map, lookup_keys[(i * 37) % LOOKUP_KEYS]);
+    }
+}
+
+static void teardown_hashmap(void)
+{
+    hashmap_destroy(&lookup_map);
+}
+
+static bool setup_trie(void)
+{
+    make_lookup_keys();
+    trie_init(&lookup_trie);
+    for (uint32_t i = 0; i < LOOKUP_KEYS; i++) {
+        trie_insert(&lookup_trie, lookup_keys[i], lookup_keys[i]);
+    }
+    return true;
+}
+
+static void run_trie(uint32_t ops)
+{
+    for (uint32_t i = 0; i < ops; i++) {
+        trie_search(&lookup_trie, lookup_keys[(i * 37) % LOOKUP_KEYS]);
+    }
+}
+
+static void teardown_trie(void)
+{
+    for (uint32_t i = 0; i < LOOKUP_KEYS; i++) {
+        trie_remove(&lookup_trie, lookup_keys[i]);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Built-in Table
+ * --------------------------------------------------------------------------- */
+static const bench_t builtin_benches[] = {
+    { "kmalloc_64",       256, NULL,                run_kmalloc_64,    NULL },
+    { "kmalloc_churn",    256, setup_kmalloc_churn, run_kmalloc_churn, teardown_kmalloc_churn },
+    { "frame_alloc",      64,  NULL,                run_frame_alloc,   NULL },
+    { "frame_contig_16k", 64,  NULL,                run_frame_contig,  NULL },
+    { "freelist_16k",     64,  setup_freelist,      run_freelist,      teardown_freelist },
+    { "ctx_switch",       32,  setup_ctx_switch,    run_ctx_switch,    teardown_ctx_switch },
+    { "syscall_getpid",   256, NULL,                run_syscall_getpid, NULL },
+    { "msgq_pingpong",    32,  setup_msgq,          run_msgq,          teardown_msgq },
+    { "vfs_open_close",   64,  setup_file,          run_open_close,    teardown_file },
+    { "ramfs_read_4k",    64,  setup_file,          run_ramfs_read,    teardown_file },
+    { "ramfs_write_4k",   64,  setup_file,          run_ramfs_write,   teardown_file },
+    { "hashmap_get",      256, setup_hashmap,       run_hashmap,       teardown_hashmap },
+    { "trie_search",      256, setup_trie,          run_trie,          teardown_trie },
+};
+
+static void register_builtins(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(builtin_benches); i++) {
+        bench_register(&builtin_benches[i]);
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * ===========================================================================
+ * kernel/utils/bench.h
+ * ===========================================================================
+ *
+ * In-Kernel Microbenchmark Interface
+ *
+ * A benchmark is a run() callback that performs 'ops' operations. The
+ * harness times BENCH_SAMPLES calls to it with the TSC, after
+ * BENCH_WARMUP untimed ones, and reports cycles per operation as min,
+ * median and p99, plus operations per second at the median.
+ *
+ * Results are printed one per line in a form scripts can parse:
+ *
+ *   BENCH name=kmalloc_64 ops=256 samples=100 min=41 median=44 p99=97 ops_per_sec=68181818
+ *
+ * framed by a "BENCH-START" line (version, TSC kHz) and a "BENCH-DONE"
+ * line. Where the CPU has performance counters (perf.h) and no other perf
+ * session is running, the line goes on with the counted events:
+ *
+ *   ... insns=212 ipc_milli=1840 llc_miss_per_kop=3 br_miss_per_kop=11
+ *
+ * Booting with "bench" on the kernel command line runs every benchmark
+ * and then exits QEMU (make bench).
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_BENCH_H
+#define NEXA_BENCH_H
+
+#include "../../config/os_config.h"
+
+#define BENCH_MAX           32      /* Registered benchmarks */
+#define BENCH_NAME_MAX      24      /* Result name bytes, with the NUL */
+#define BENCH_WARMUP        8       /* Untimed samples before measuring */
+#define BENCH_SAMPLES       100     /* Timed samples per benchmark */
+
+typedef struct bench {
+    const char *name;
+    uint32_t ops;                   /* Operations per run() call */
+    bool (*setup)(void);            /* Optional; false skips the benchmark */
+    void (*run)(uint32_t ops);
+    void (*teardown)(void);         /* Optional; called if setup succeeded */
+} bench_t;
+
+/* Per-operation cycles (shared with user space by SYS_BENCH) */
+typedef struct bench_result {
+    char name[BENCH_NAME_MAX];
+    uint32_t ops;                   /* Operations per sample */
+    uint32_t samples;
+    uint32_t min_cycles;
+    uint32_t median_cycles;
+    uint32_t p99_cycles;
+    uint32_t ops_per_sec;           /* At the median (0 = TSC uncalibrated) */
+
+    /* Hardware counters over all samples; valid per bit of perf_events */
+    uint32_t perf_events;           /* Bit n = PERF_EVENT n was counted */
+    uint32_t instructions;          /* Per operation */
+    uint32_t ipc_milli;             /* Instructions per 1000 cycles (bit 0, cycles) */
+    uint32_t llc_misses_per_kop;    /* Per 1000 operations */
+    uint32_t branch_misses_per_kop; /* Per 1000 operations */
+} bench_result_t;
+
+/* Called with each result as soon as its benchmark finishes */
+typedef void (*bench_emit_t)(const bench_result_t *result, void *ctx);
+
+/* Add a benchmark (the descriptor must stay valid); false if the table is full */
+bool bench_register(const bench_t *bench);
+
+/*
+ * Run every benchmark whose name starts with 'filter' (NULL = all) in
+ * registration order. Returns the number run, or -1 if a run is already
+ * in progress. The built-in benchmarks are registered on the first call.
+ */
+int bench_run_all(const char *filter, bench_emit_t emit, void *ctx);
+
+/* bench_emit_t that prints the machine-readable result line */
+void bench_print(const bench_result_t *result, void *ctx);
+
+/* Run everything with bench_print between BENCH-START and BENCH-DONE lines */
+void bench_report(const char *filter);
+
+#endif /* NEXA_BENCH_H */
@@ -0,0 +1,364 @@
+/*
+ * ===========================================================================
+ * kernel/utils/crashdump.c
+ * ===========================================================================
+ *
+ * Crash Dumps
+ *
+ * The dump is one fixed-layout crashdump_t written straight into the crash
+ * dump area: a header (magic, version, body size and an FNV-1a checksum of
+ * the body) followed by the body. The magic is written last, so a capture
+ * cut short leaves nothing that looks valid, and the checksum rejects an
+ * area the firmware or the boot loader scribbled over during the reboot.
+ *
+ * Capture only copies: it takes no lock (the crashing code may hold any of
+ * them) and allocates nothing. The backtrace follows the saved EBP chain
+ * (the kernel is built with -fno-omit-frame-pointer for it) and stops at
+ * the first frame that is not mapped or does not move up the stack, so a
+ * corrupt stack ends the walk instead of faulting again.
+ *
+ * ===========================================================================
+ */
+
+#include <lib/cstd/stdio.h>
+#include "crashdump.h"
+#include "trace.h"
+#include "logging.h"
+#include "../memory/memory.h"
+#include "../scheduler/scheduler.h"
+#include "../scheduler/task.h"
+#include "../scheduler/smp.h"
+#include "../drivers/drivers.h"
+
+/* From lib/cstd */
+extern void *memset(void *s, int c, size_t n);
+
+/* Crash dump area (config/memory_layout.ld) */
+extern char _crashdump_start[];
+extern char _crashdump_end[];
+
+#define CRASHDUMP_MAGIC         0x504D4443      /* "CDMP" */
+#define CRASHDUMP_VERSION       1
+
+#define CRASHDUMP_BACKTRACE     16
+#define CRASHDUMP_TRACE_PER_CPU 64
+#define CRASHDUMP_LOG_BYTES     16384
+
+/* ---------------------------------------------------------------------------
+ * Dump Layout
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                  /* Bytes of body */
+    uint32_t checksum;              /* FNV-1a of body */
+} crashdump_header_t;
+
+typedef struct {
+    uint32_t reason;                /* CRASHDUMP_PANIC or CRASHDUMP_EXCEPTION */
+    uint32_t cpu;
+    uint32_t pid;                   /* 0 if no task was running */
+    uint32_t ticks;
+    uint64_t tsc;
+    uint32_t tsc_khz;
+    int32_t line;
+    char message[96];
+    char file[64];
+
+    interrupt_frame_t regs;         /* For a panic: ebp, esp, eip, cs, eflags */
+    uint32_t cr0, cr2, cr3, cr4;
+    uint32_t backtrace_count;
+    uint32_t backtrace[CRASHDUMP_BACKTRACE];
+
+    uint32_t task_count;
+    scheduler_task_info_t tasks[MAX_TASKS];
+
+    uint32_t frames_total;
+    uint32_t frames_free;
+    uint32_t heap_total;
+    uint32_t heap_used;
+    uint32_t heap_peak;
+    uint32_t heap_allocations;
+
+    uint32_t trace_count;
+    trace_record_t trace[SMP_MAX_CPUS * CRASHDUMP_TRACE_PER_CPU];
+
+    uint32_t log_len;
+    char log[CRASHDUMP_LOG_BYTES];
+} crashdump_body_t;
+
+typedef struct {
+    crashdump_header_t header;
+    crashdump_body_t body;
+} crashdump_t;
+
+static volatile uint32_t crashdump_taken = 0;
+
+/* ---------------------------------------------------------------------------
+ * Internal Helpers
+ * --------------------------------------------------------------------------- */
+
+static crashdump_t *crashdump_area(void)
+{
+    if ((size_t)(_crashdump_end - _crashdump_start) < sizeof(crashdump_t)) {
+        return NULL;
+    }
+    return (crashdump_t *)_crashdump_start;
+}
+
+static uint32_t crashdump_checksum(const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    uint32_t hash = 0x811C9DC5u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 0x01000193u;
+    }
+    return hash;
+}
+
+static void copy_string(char *dest, const char *src, size_t size)
+{
+    size_t n = 0;
+    if (src != NULL) {
+        while (n < size - 1 && src[n] != '\0') {
+            dest[n] = src[n];
+            n++;
+        }
+    }
+    dest[n] = '\0';
+}
+
+/* A stack frame (saved EBP and return address) can be read without faulting */
+static bool frame_readable(uint32_t ebp)
+{
+    if (ebp < PAGE_SIZE || (ebp & 3) != 0 || ebp > 0xFFFFFFFFu - 8) {
+        return false;
+    }
+    return paging_translate(NULL, ebp) != 0 && paging_translate(NULL, ebp + 7) != 0;
+}
+
+static uint32_t walk_stack(uint32_t ebp, uint32_t *out, uint32_t max)
+{
+    uint32_t count = 0;
+
+    while (count < max && frame_readable(ebp)) {
+        const uint32_t *stack = (const uint32_t *)(uintptr_t)ebp;
+        if (stack[1] == 0) {
+            break;
+        }
+        out[count++] = stack[1];
+        if (stack[0] <= ebp) {
+            break;
+        }
+        ebp = stack[0];
+    }
+    return count;
+}
+
+static void read_control_registers(crashdump_body_t *body)
+{
+    __asm__ volatile("mov %%cr0, %0" : "=r"(body->cr0));
+    __asm__ volatile("mov %%cr2, %0" : "=r"(body->cr2));
+    __asm__ volatile("mov %%cr3, %0" : "=r"(body->cr3));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(body->cr4));
+}
+
+/* ---------------------------------------------------------------------------
+ * crashdump_capture - Snapshot the machine into the crash dump area
+ * --------------------------------------------------------------------------- */
+void crashdump_capture(uint32_t reason, const char *file, int line,
+                       const char *message, const interrupt_frame_t *frame)
+{
+    crashdump_t *dump = crashdump_area();
+    if (dump == NULL || __atomic_exchange_n(&crashdump_taken, 1, __ATOMIC_ACQUIRE) != 0) {
+        return;
+    }
+
+    /* Stop tracing so the rings hold the events leading up to the crash */
+    trace_set_mask(0);
+
+    dump->header.magic = 0;
+    crashdump_body_t *body = &dump->body;
+    memset(body, 0, sizeof(*body));
+
+    task_t *task = task_current();
+    body->reason = reason;
+    body->cpu = smp_this_cpu()->id;
+    body->pid = (task != NULL) ? task->pid : 0;
+    body->ticks = pit_get_ticks();
+    body->tsc = clock_cycles();
+    body->tsc_khz = clock_get_khz();
+    body->line = line;
+    copy_string(body->message, message, sizeof(body->message));
+    copy_string(body->file, file, sizeof(body->file));
+
+    if (frame != NULL) {
+        body->regs = *frame;
+    } else {
+        uint32_t cs, eflags;
+        __asm__ volatile("mov %%cs, %0" : "=r"(cs));
+        __asm__ volatile("pushfl; popl %0" : "=r"(eflags));
+        body->regs.ebp = (uint32_t)(uintptr_t)__builtin_frame_address(0);
+        body->regs.esp = body->regs.ebp;
+        body->regs.eip = (uint32_t)(uintptr_t)__builtin_return_address(0);
+        body->regs.cs = cs;
+        body->regs.eflags = eflags;
+    }
+    read_control_registers(body);
+    body->backtrace_count = walk_stack(body->regs.ebp, body->backtrace, CRASHDUMP_BACKTRACE);
+
+    body->task_count = scheduler_get_task_info(body->tasks, MAX_TASKS);
+
+    body->frames_total = frame_total_count();
+    body->frames_free = frame_free_count();
+    body->heap_total = heap_total_size();
+    body->heap_used = heap_used_size();
+    body->heap_peak = heap_peak_usage();
+    body->heap_allocations = heap_allocation_count();
+
+    body->trace_count = trace_snapshot(body->trace, CRASHDUMP_TRACE_PER_CPU);
+    body->log_len = log_snapshot(body->log, sizeof(body->log));
+
+    dump->header.version = CRASHDUMP_VERSION;
+    dump->header.size = sizeof(*body);
+    dump->header.checksum = crashdump_checksum(body, sizeof(*body));
+    __asm__ volatile("" ::: "memory");
+    dump->header.magic = CRASHDUMP_MAGIC;
+}
+
+/* ---------------------------------------------------------------------------
+ * Export
+ * --------------------------------------------------------------------------- */
+
+static void export_log(const crashdump_body_t *body)
+{
+    char line[160];
+    uint32_t start = 0;
+    uint32_t len = body->log_len;
+
+    if (len >= sizeof(body->log)) {
+        len = sizeof(body->log) - 1;
+    }
+    for (uint32_t i = 0; i <= len; i++) {
+        if (i < len && body->log[i] != '\n') {
+            continue;
+        }
+        if (i > start) {
+            uint32_t n = i - start;
+            if (n > sizeof(line) - 12) {
+                n = sizeof(line) - 12;
+            }
+            ksnprintf(line, sizeof(line), "CRASH log ");
+            for (uint32_t j = 0; j < n; j++) {
+                line[10 + j] = body->log[start + j];
+            }
+            line[10 + n] = '\n';
+            line[11 + n] = '\0';
+            serial_write_string(line);
+        }
+        start = i + 1;
+    }
+}
+
+static void export_trace(const crashdump_body_t *body)
+{
+    char line[80];
+    uint32_t count = body->trace_count;
+
+    if (count > SMP_MAX_CPUS * CRASHDUMP_TRACE_PER_CPU) {
+        count = SMP_MAX_CPUS * CRASHDUMP_TRACE_PER_CPU;
+    }
+
+    ksnprintf(line, sizeof(line), "TRACE-START khz=%u cpus=%u slots=%u\n",
+              body->tsc_khz, SMP_MAX_CPUS, CRASHDUMP_TRACE_PER_CPU);
+    serial_write_string(line);
+    for (uint32_t i = 0; i < count; i++) {
+        const trace_record_t *rec = &body->trace[i];
+        ksnprintf(line, sizeof(line), "TRACE %u %08x%08x %s %x %x\n",
+                  rec->cpu, (uint32_t)(rec->tsc >> 32), (uint32_t)rec->tsc,
+                  trace_event_name(rec->event), rec->arg0, rec->arg1);
+        serial_write_string(line);
+    }
+    ksnprintf(line, sizeof(line), "TRACE-DONE records=%u lost=0\n", count);
+    serial_write_string(line);
+}
+
+/* ---------------------------------------------------------------------------
+ * crashdump_export - Print the previous boot's dump over serial
+ * --------------------------------------------------------------------------- */
+bool crashdump_export(void)
+{
+    crashdump_t *dump = crashdump_area();
+    if (dump == NULL || dump->header.magic != CRASHDUMP_MAGIC) {
+        return false;
+    }
+
+    crashdump_body_t *body = &dump->body;
+    bool valid = dump->header.version == CRASHDUMP_VERSION &&
+                 dump->header.size == sizeof(*body) &&
+                 dump->header.checksum == crashdump_checksum(body, sizeof(*body));
+    dump->header.magic = 0;
+    if (!valid) {
+        serial_write_string("CRASH-START invalid\nCRASH-DONE\n");
+        return false;
+    }
+
+    const interrupt_frame_t *r = &body->regs;
+    char line[160];
+
+    ksnprintf(line, sizeof(line), "CRASH-START reason=%s cpu=%u pid=%u ticks=%u\n",
+              body->reason == CRASHDUMP_EXCEPTION ? "exception" : "panic",
+              body->cpu, body->pid, body->ticks);
+    serial_write_string(line);
+
+    body->message[sizeof(body->message) - 1] = '\0';
+    body->file[sizeof(body->file) - 1] = '\0';
+    ksnprintf(line, sizeof(line), "CRASH message %s\n", body->message);
+    serial_write_string(line);
+    if (body->reason == CRASHDUMP_EXCEPTION) {
+        ksnprintf(line, sizeof(line), "CRASH exception int=%u err=%x\n", r->int_no, r->err_code);
+    } else {
+        ksnprintf(line, sizeof(line), "CRASH location %s:%d\n", body->file, body->line);
+    }
+    serial_write_string(line);
+
+    ksnprintf(line, sizeof(line), "CRASH regs eax=%08x ebx=%08x ecx=%08x edx=%08x\n",
+              r->eax, r->ebx, r->ecx, r->edx);
+    serial_write_string(line);
+    ksnprintf(line, sizeof(line), "CRASH regs esi=%08x edi=%08x ebp=%08x esp=%08x\n",
+              r->esi, r->edi, r->ebp, r->esp);
+    serial_write_string(line);
+    ksnprintf(line, sizeof(line), "CRASH regs eip=%08x cs=%04x eflags=%08x\n",
+              r->eip, r->cs, r->eflags);
+    serial_write_string(line);
+    ksnprintf(line, sizeof(line), "CRASH regs cr0=%08x cr2=%08x cr3=%08x cr4=%08x\n",
+              body->cr0, body->cr2, body->cr3, body->cr4);
+    serial_write_string(line);
+
+    uint32_t frames = body->backtrace_count;
+    for (uint32_t i = 0; i < frames && i < CRASHDUMP_BACKTRACE; i++) {
+        ksnprintf(line, sizeof(line), "CRASH backtrace %u %08x\n", i, body->backtrace[i]);
+        serial_write_string(line);
+    }
+
+    for (uint32_t i = 0; i < body->task_count && i < MAX_TASKS; i++) {
+        scheduler_task_info_t *t = &body->tasks[i];
+        t->name[sizeof(t->name) - 1] = '\0';
+        ksnprintf(line, sizeof(line),
+                  "CRASH task pid=%u state=%u prio=%u cpu_time=%u runs=%u name=%s\n",
+                  t->pid, t->state, t->priority, t->cpu_time, t->run_count, t->name);
+        serial_write_string(line);
+    }
+
+    ksnprintf(line, sizeof(line),
+              "CRASH memory frames=%u free=%u heap=%u used=%u peak=%u allocs=%u\n",
+              body->frames_total, body->frames_free, body->heap_total,
+              body->heap_used, body->heap_peak, body->heap_allocations);
+    serial_write_string(line);
+
+    export_log(body);
+    export_trace(body);
+
+    serial_write_string("CRASH-DONE\n");
+    return true;
+}
@@ -0,0 +1,47 @@
+/*
+ * ===========================================================================
+ * kernel/utils/crashdump.h
+ * ===========================================================================
+ *
+ * Crash Dumps
+ *
+ * A panic or a fatal CPU exception leaves the VGA screen as its only
+ * record, and that is gone once the machine restarts. Before printing it,
+ * crashdump_capture() copies the registers, a stack backtrace, the task
+ * table, the newest trace and log records and the allocator counters into
+ * the crash dump area: conventional memory below the kernel
+ * (_crashdump_start in config/memory_layout.ld) that neither the loader
+ * nor the frame allocator touches, so it survives a warm reboot.
+ *
+ * The next boot calls crashdump_export() right after serial_init(). A
+ * dump with a valid checksum is printed over serial and then invalidated:
+ *
+ *   CRASH-START reason=<panic|exception> cpu=<n> pid=<n> ticks=<n>
+ *   CRASH ...                  (registers, backtrace, tasks, memory, log)
+ *   TRACE-START/TRACE/TRACE-DONE  (as trace_dump(), for trace_to_chrome.py)
+ *   CRASH-DONE
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_CRASHDUMP_H
+#define NEXA_CRASHDUMP_H
+
+#include "../../config/os_config.h"
+#include "../interrupts/interrupts.h"
+
+#define CRASHDUMP_PANIC         1
+#define CRASHDUMP_EXCEPTION     2
+
+/*
+ * Snapshot the machine into the crash dump area. frame is the exception
+ * frame, or NULL for a panic (the caller's registers are recorded then).
+ * Only the first call of a crash does anything; interrupts must be off.
+ */
+void crashdump_capture(uint32_t reason, const char *file, int line,
+                       const char *message, const interrupt_frame_t *frame);
+
+/* Print and invalidate the dump left by the previous boot; false if none */
+bool crashdump_export(void);
+
+#endif /* NEXA_CRASHDUMP_H */
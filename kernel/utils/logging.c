@@ -13,37 +13,244 @@
  *   log_info("Kernel started, version %d.%d", major, minor);
  *   log_error("Failed to allocate memory!");
  *
+ * Log Ring:
+ *   A log call formats its message on the caller's stack, then copies it
+ *   into a record in the running CPU's ring with a timestamp, level and a
+ *   global sequence number, and returns. Each ring has one producer (its
+ *   CPU, with interrupts off for the copy) and one consumer (the drain), so
+ *   the copy takes no lock; only waking a sleeping drain takes the kernel
+ *   lock. A low-priority "klogd" task drains the rings to the consoles in
+ *   sequence order; before it exists, log calls drain inline.
+ *
+ *   A full ring overwrites its oldest record. Records keep their sequence
+ *   number in the slot, so a reader can tell a record that was overwritten
+ *   while it was being copied and skip it. Records stay in the ring after
+ *   being drained, which is what log_dump() (the shell's dmesg) shows.
+ *
  * ===========================================================================
  */
 
 #include <lib/cstd/stdio.h>
 #include <stdarg.h>
+#include "logging.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/scheduler.h"
+#include "../scheduler/smp.h"
+#include "../scheduler/sync.h"
+#include "../drivers/drivers.h"
+
+extern void *memcpy(void *dest, const void *src, size_t n);
 
 /* ---------------------------------------------------------------------------
  * Log Level Definitions
  * --------------------------------------------------------------------------- */
 typedef enum {
-    LOG_LEVEL_DEBUG = 0,
-    LOG_LEVEL_INFO  = 1,
-    LOG_LEVEL_WARN  = 2,
-    LOG_LEVEL_ERROR = 3
+    LEVEL_DEBUG = LOG_LEVEL_DEBUG,
+    LEVEL_INFO  = LOG_LEVEL_INFO,
+    LEVEL_WARN  = LOG_LEVEL_WARN,
+    LEVEL_ERROR = LOG_LEVEL_ERROR
 } log_level_t;
 
+static const char *const level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
 /* Current minimum log level (messages below this are suppressed) */
-static log_level_t current_log_level = LOG_LEVEL_INFO;
+static log_level_t current_log_level = LEVEL_INFO;
+
+/* ---------------------------------------------------------------------------
+ * Log Ring Structures
+ * --------------------------------------------------------------------------- */
+#define LOG_TEXT_MAX        116     /* Message bytes per record (with NUL) */
+
+typedef struct {
+    volatile uint32_t seq;          /* Sequence number; 0 while being written */
+    uint32_t ticks;                 /* pit_get_ticks() when logged */
+    uint8_t level;
+    uint8_t cpu;
+    uint16_t len;                   /* Bytes in text, excluding the NUL */
+    char text[LOG_TEXT_MAX];
+} log_record_t;
+
+typedef struct {
+    log_record_t slots[LOG_RING_SLOTS];
+    volatile uint32_t head;         /* Records written (producer) */
+    volatile uint32_t drained;      /* Records sent to the consoles (consumer) */
+} log_ring_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+static log_ring_t log_rings[SMP_MAX_CPUS];
+static volatile uint32_t log_seq = 0;           /* Last sequence number issued */
+static uint32_t log_lost = 0;                   /* Overwritten before draining */
+
+static spinlock_t drain_lock = SPINLOCK_INIT;   /* One consumer at a time */
+static task_t *drain_task = NULL;
+static wait_queue_t drain_wait = WAIT_QUEUE_INIT(drain_wait);
+static volatile bool drain_sleeping = false;
 
 /* ---------------------------------------------------------------------------
- * Internal Helper
+ * Internal Helpers
  * --------------------------------------------------------------------------- */
 
+#define log_barrier()   __asm__ volatile("" ::: "memory")
+
+/* Copy a record out; false if it was overwritten (or is being written) */
+static bool log_read_record(log_ring_t *ring, uint32_t index, log_record_t *out)
+{
+    log_record_t *slot = &ring->slots[index & (LOG_RING_SLOTS - 1)];
+    uint32_t seq = slot->seq;
+    log_barrier();
+    if (seq == 0 || ring->head - index > LOG_RING_SLOTS) {
+        return false;
+    }
+    
+    memcpy(out, slot, sizeof(*out));
+    log_barrier();
+    
+    /* Reject it if the producer lapped us during the copy */
+    return slot->seq == seq && ring->head - index <= LOG_RING_SLOTS;
+}
+
+/* "[    12.340] [INFO] message" */
+static void log_format_record(const log_record_t *rec, char *buf, size_t size)
+{
+    uint32_t secs = rec->ticks / SCHEDULER_TICK_HZ;
+    uint32_t msecs = (rec->ticks % SCHEDULER_TICK_HZ) * (1000 / SCHEDULER_TICK_HZ);
+    ksnprintf(buf, size, "[%5u.%03u] [%s] %s", secs, msecs,
+              level_names[rec->level & 3], rec->text);
+}
+
+/* Oldest undrained record over all rings; -1 if there is none */
+static int log_next_ring(log_record_t *rec)
+{
+    int best = -1;
+    uint32_t best_seq = 0;
+    
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        log_ring_t *ring = &log_rings[cpu];
+        while (ring->drained != ring->head) {
+            /* Skip whatever the producer has already overwritten */
+            if (ring->head - ring->drained > LOG_RING_SLOTS) {
+                uint32_t oldest = ring->head - LOG_RING_SLOTS;
+                log_lost += oldest - ring->drained;
+                ring->drained = oldest;
+            }
+            
+            log_record_t candidate;
+            if (!log_read_record(ring, ring->drained, &candidate)) {
+                log_lost++;
+                ring->drained++;
+                continue;
+            }
+            if (best < 0 || (int32_t)(candidate.seq - best_seq) < 0) {
+                best = cpu;
+                best_seq = candidate.seq;
+                *rec = candidate;
+            }
+            break;
+        }
+    }
+    
+    return best;
+}
+
+/* Send everything queued to the consoles; the caller must own drain_lock */
+static void log_drain_locked(void)
+{
+    log_record_t rec;
+    char line[LOG_TEXT_MAX + 24];
+    int cpu;
+    
+    while ((cpu = log_next_ring(&rec)) >= 0) {
+        log_rings[cpu].drained++;
+        log_format_record(&rec, line, sizeof(line));
+        kprintf("%s\n", line);
+    }
+}
+
+static bool log_pending(void)
+{
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (log_rings[cpu].drained != log_rings[cpu].head) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* klogd: low-priority task that pushes records to the consoles */
+static void log_drain_entry(void *arg)
+{
+    UNUSED(arg);
+    
+    while (1) {
+        log_flush();
+        
+        /* Announce the sleep before the last check; log_write() checks after */
+        uint32_t flags = kernel_lock_irqsave();
+        while (1) {
+            drain_sleeping = true;
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (log_pending()) {
+                break;
+            }
+            wait_queue_wait(&drain_wait);
+        }
+        drain_sleeping = false;
+        kernel_unlock_irqrestore(flags);
+    }
+}
+
 /**
- * @brief Core logging function with level prefix
+ * @brief Core logging function: format, then copy into this CPU's ring
  */
-static void log_write(const char *prefix, const char *fmt, va_list ap)
+static void log_write(log_level_t level, const char *fmt, va_list ap)
 {
-    kprintf("[%s] ", prefix);
-    kvprintf(fmt, ap);
-    kprintf("\n");
+    char text[LOG_TEXT_MAX];
+    int len = kvsnprintf(text, sizeof(text), fmt, ap);
+    if (len < 0) {
+        len = 0;
+    } else if (len >= LOG_TEXT_MAX) {
+        len = LOG_TEXT_MAX - 1;
+    }
+    
+    uint32_t flags = interrupts_save_and_disable();
+    
+    cpu_local_t *cpu = smp_this_cpu();
+    log_ring_t *ring = &log_rings[cpu->id];
+    uint32_t index = ring->head;
+    log_record_t *slot = &ring->slots[index & (LOG_RING_SLOTS - 1)];
+    
+    slot->seq = 0;
+    log_barrier();
+    slot->ticks = pit_get_ticks();
+    slot->level = (uint8_t)level;
+    slot->cpu = (uint8_t)cpu->id;
+    slot->len = (uint16_t)len;
+    memcpy(slot->text, text, (size_t)len + 1);
+    log_barrier();
+    slot->seq = __sync_add_and_fetch(&log_seq, 1);
+    log_barrier();
+    ring->head = index + 1;
+    
+    interrupts_restore(flags);
+    
+    /* Only a sleeping klogd costs the kernel lock */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (drain_sleeping) {
+        flags = kernel_lock_irqsave();
+        if (drain_sleeping) {
+            drain_sleeping = false;
+            wait_queue_wake_one(&drain_wait);
+        }
+        kernel_unlock_irqrestore(flags);
+    }
+    
+    /* Nobody to hand the record to yet: print it now */
+    if (drain_task == NULL) {
+        log_flush();
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -55,7 +262,195 @@ static void log_write(const char *prefix, const char *fmt, va_list ap)
  */
 void log_init(void)
 {
-    current_log_level = LOG_LEVEL_INFO;
+    current_log_level = LEVEL_INFO;
+}
+
+/**
+ * @brief Start the klogd task that drains the log rings
+ */
+bool log_start_drain(void)
+{
+    if (drain_task != NULL) {
+        return true;
+    }
+    
+    task_t *task = task_create("klogd", log_drain_entry, NULL,
+                               TASK_PRIORITY_LOW, 0);
+    if (task == NULL) {
+        return false;
+    }
+    
+    drain_task = task;
+    scheduler_add_task(task);
+    return true;
+}
+
+/**
+ * @brief Push every queued record to the consoles now
+ */
+void log_flush(void)
+{
+    /* Someone else is draining; they will pick our records up */
+    if (!spin_trylock(&drain_lock)) {
+        return;
+    }
+    log_drain_locked();
+    spin_unlock(&drain_lock);
+}
+
+/* Visit every record still held in the rings, oldest first */
+static void log_walk(void (*visit)(const log_record_t *rec, void *ctx), void *ctx)
+{
+    /* Each ring's cursor starts at its oldest record still held */
+    uint32_t cursor[SMP_MAX_CPUS];
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        uint32_t head = log_rings[cpu].head;
+        cursor[cpu] = head > LOG_RING_SLOTS ? head - LOG_RING_SLOTS : 0;
+    }
+    
+    while (1) {
+        int best = -1;
+        log_record_t rec;
+        
+        for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+            log_ring_t *ring = &log_rings[cpu];
+            while (cursor[cpu] != ring->head) {
+                log_record_t candidate;
+                if (!log_read_record(ring, cursor[cpu], &candidate)) {
+                    cursor[cpu]++;
+                    continue;
+                }
+                if (best < 0 || (int32_t)(candidate.seq - rec.seq) < 0) {
+                    best = cpu;
+                    rec = candidate;
+                }
+                break;
+            }
+        }
+        
+        if (best < 0) {
+            break;
+        }
+        cursor[best]++;
+        visit(&rec, ctx);
+    }
+}
+
+static void log_dump_visit(const log_record_t *rec, void *ctx)
+{
+    void (*emit)(const char *line) = *(void (**)(const char *))ctx;
+    char line[LOG_TEXT_MAX + 24];
+    
+    log_format_record(rec, line, sizeof(line));
+    emit(line);
+    emit("\n");
+}
+
+/**
+ * @brief Print the records still held in the rings, oldest first
+ */
+void log_dump(void (*emit)(const char *line))
+{
+    if (emit == NULL) {
+        return;
+    }
+    log_walk(log_dump_visit, &emit);
+}
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t skip;            /* Bytes of old lines to leave out */
+    size_t total;           /* Bytes of all lines (first pass) */
+    size_t used;
+} log_snapshot_t;
+
+/* Formatted line plus newline; returns its length */
+static size_t log_snapshot_line(const log_record_t *rec, char *line, size_t size)
+{
+    log_format_record(rec, line, size - 1);
+    size_t len = 0;
+    while (line[len] != '\0') {
+        len++;
+    }
+    line[len++] = '\n';
+    return len;
+}
+
+static void log_snapshot_count(const log_record_t *rec, void *ctx)
+{
+    log_snapshot_t *snap = ctx;
+    char line[LOG_TEXT_MAX + 24];
+    snap->total += log_snapshot_line(rec, line, sizeof(line));
+}
+
+static void log_snapshot_copy(const log_record_t *rec, void *ctx)
+{
+    log_snapshot_t *snap = ctx;
+    char line[LOG_TEXT_MAX + 24];
+    size_t len = log_snapshot_line(rec, line, sizeof(line));
+    
+    if (snap->skip > 0) {
+        snap->skip = (len < snap->skip) ? snap->skip - len : 0;
+        return;
+    }
+    if (snap->used + len < snap->size) {
+        memcpy(snap->buf + snap->used, line, len);
+        snap->used += len;
+    }
+}
+
+/**
+ * @brief Copy the newest records that fit into buf as text, oldest first
+ */
+size_t log_snapshot(char *buf, size_t size)
+{
+    if (buf == NULL || size == 0) {
+        return 0;
+    }
+    
+    log_snapshot_t snap = { buf, size, 0, 0, 0 };
+    log_walk(log_snapshot_count, &snap);
+    if (snap.total >= size) {
+        snap.skip = snap.total - (size - 1);
+    }
+    log_walk(log_snapshot_copy, &snap);
+    
+    buf[snap.used] = '\0';
+    return snap.used;
+}
+
+/**
+ * @brief Count records overwritten before they reached the consoles
+ */
+uint32_t log_get_lost_count(void)
+{
+    return log_lost;
+}
+
+/**
+ * @brief Decide whether a rate-limited call site may log now
+ */
+bool log_ratelimit(log_ratelimit_t *rl, const char *site)
+{
+    uint32_t now = pit_get_ticks();
+    
+    if (rl->count == 0 || now - rl->window_start >= LOG_RATELIMIT_INTERVAL) {
+        uint32_t missed = rl->missed;
+        rl->window_start = now;
+        rl->count = 0;
+        rl->missed = 0;
+        if (missed > 0) {
+            log_warn("%s: %u messages suppressed", site, missed);
+        }
+    }
+    
+    if (rl->count >= LOG_RATELIMIT_BURST) {
+        rl->missed++;
+        return false;
+    }
+    rl->count++;
+    return true;
 }
 
 /**
@@ -73,10 +468,10 @@ void log_set_level(int level)
  */
 void log_info(const char *fmt, ...)
 {
-    if (current_log_level <= LOG_LEVEL_INFO) {
+    if (current_log_level <= LEVEL_INFO) {
         va_list ap;
         va_start(ap, fmt);
-        log_write("INFO", fmt, ap);
+        log_write(LEVEL_INFO, fmt, ap);
         va_end(ap);
     }
 }
@@ -86,10 +481,10 @@ void log_info(const char *fmt, ...)
  */
 void log_warn(const char *fmt, ...)
 {
-    if (current_log_level <= LOG_LEVEL_WARN) {
+    if (current_log_level <= LEVEL_WARN) {
         va_list ap;
         va_start(ap, fmt);
-        log_write("WARN", fmt, ap);
+        log_write(LEVEL_WARN, fmt, ap);
         va_end(ap);
     }
 }
@@ -99,10 +494,10 @@ void log_warn(const char *fmt, ...)
  */
 void log_error(const char *fmt, ...)
 {
-    if (current_log_level <= LOG_LEVEL_ERROR) {
+    if (current_log_level <= LEVEL_ERROR) {
         va_list ap;
         va_start(ap, fmt);
-        log_write("ERROR", fmt, ap);
+        log_write(LEVEL_ERROR, fmt, ap);
         va_end(ap);
     }
 }
@@ -112,10 +507,10 @@ void log_error(const char *fmt, ...)
  */
 void log_debug(const char *fmt, ...)
 {
-    if (current_log_level <= LOG_LEVEL_DEBUG) {
+    if (current_log_level <= LEVEL_DEBUG) {
         va_list ap;
         va_start(ap, fmt);
-        log_write("DEBUG", fmt, ap);
+        log_write(LEVEL_DEBUG, fmt, ap);
         va_end(ap);
     }
 }
@@ -6,6 +6,8 @@
  * Kernel Logging Facility Interface
  *
  * Provides a centralized logging mechanism with different severity levels.
+ * Messages go into a per-CPU ring and reach the consoles from the klogd
+ * task, so a log call never waits for VGA or the serial line.
  *
  * Usage:
  *   #include <kernel/utils/logging.h>
@@ -20,6 +22,8 @@
 #ifndef NEXA_LOGGING_H
 #define NEXA_LOGGING_H
 
+#include "../../config/os_config.h"
+
 /* ---------------------------------------------------------------------------
  * Log Level Constants
  * --------------------------------------------------------------------------- */
@@ -28,6 +32,31 @@
 #define LOG_LEVEL_WARN   2
 #define LOG_LEVEL_ERROR  3
 
+/* ---------------------------------------------------------------------------
+ * Rate Limiting
+ * ---------------------------------------------------------------------------
+ * Each call site of a *_ratelimited macro gets its own state: at most
+ * LOG_RATELIMIT_BURST messages per LOG_RATELIMIT_INTERVAL ticks, then a
+ * single "N messages suppressed" line once the window has passed.
+ * --------------------------------------------------------------------------- */
+typedef struct log_ratelimit {
+    uint32_t window_start;      /* Tick the current window began */
+    uint32_t count;             /* Messages let through in this window */
+    uint32_t missed;            /* Messages dropped in this window */
+} log_ratelimit_t;
+
+#define LOG_RATELIMITED(fn, ...)                                    \
+    do {                                                            \
+        static log_ratelimit_t _log_rl;                             \
+        if (log_ratelimit(&_log_rl, __func__)) {                    \
+            fn(__VA_ARGS__);                                        \
+        }                                                           \
+    } while (0)
+
+#define log_info_ratelimited(...)   LOG_RATELIMITED(log_info, __VA_ARGS__)
+#define log_warn_ratelimited(...)   LOG_RATELIMITED(log_warn, __VA_ARGS__)
+#define log_error_ratelimited(...)  LOG_RATELIMITED(log_error, __VA_ARGS__)
+
 /* ---------------------------------------------------------------------------
  * Public API
  * --------------------------------------------------------------------------- */
@@ -37,6 +66,48 @@
  */
 void log_init(void);
 
+/**
+ * @brief Start the klogd task that drains the log rings
+ *
+ * Until it runs, log calls print their record before returning.
+ *
+ * @return true on success, false if the task could not be created
+ */
+bool log_start_drain(void);
+
+/**
+ * @brief Push every queued record to the consoles now
+ */
+void log_flush(void);
+
+/**
+ * @brief Print the records still held in the rings (dmesg), oldest first
+ * @param emit Called with each formatted line, then with "\n"
+ */
+void log_dump(void (*emit)(const char *line));
+
+/**
+ * @brief Copy the newest records that fit into buf as dmesg text
+ *
+ * Takes no lock, so it is safe on the crash path.
+ *
+ * @return Bytes written, excluding the terminating NUL
+ */
+size_t log_snapshot(char *buf, size_t size);
+
+/**
+ * @brief Count records overwritten before they reached the consoles
+ */
+uint32_t log_get_lost_count(void);
+
+/**
+ * @brief Decide whether a rate-limited call site may log now
+ * @param rl   Per-call-site state (zero-initialized)
+ * @param site Call site name, used in the "suppressed" message
+ * @return true if the message should be logged
+ */
+bool log_ratelimit(log_ratelimit_t *rl, const char *site);
+
 /**
  * @brief Set the minimum log level
  * @param level One of LOG_LEVEL_* constants
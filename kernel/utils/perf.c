@@ -0,0 +1,340 @@
+/*
+ * ===========================================================================
+ * kernel/utils/perf.c
+ * ===========================================================================
+ *
+ * Hardware Performance Counters
+ *
+ * Counter i of a session is general-purpose counter i: IA32_PERFEVTSELi
+ * selects the event (counting in rings 0 and 3) and IA32_PMCi counts it.
+ * Counters are never stopped or saved on a context switch. Instead each CPU
+ * remembers the value it read at its previous switch, and perf_switch()
+ * adds the difference to the outgoing task and to the CPU's total. That
+ * costs one RDPMC per counter per switch and no MSR writes.
+ *
+ * perf_start() and perf_stop() only change the session and bump
+ * perf_generation. Each CPU compares the generation at its next switch (or
+ * read) and reprograms its own MSRs, so no cross-CPU interrupt is needed.
+ * A task's counts are likewise reset lazily when its generation is stale.
+ *
+ * ===========================================================================
+ */
+
+#include "perf.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/task.h"
+#include "../scheduler/smp.h"
+#include "../scheduler/spinlock.h"
+
+/* ---------------------------------------------------------------------------
+ * CPUID and MSRs
+ * --------------------------------------------------------------------------- */
+#define CPUID_PERFMON_LEAF          0x0A
+
+#define MSR_IA32_PMC0               0xC1
+#define MSR_IA32_PERFEVTSEL0        0x186
+#define MSR_IA32_PERF_GLOBAL_CTRL   0x38F   /* Version 2 and later */
+
+#define EVTSEL_USR                  (1u << 16)
+#define EVTSEL_OS                   (1u << 17)
+#define EVTSEL_EN                   (1u << 22)
+
+/* Event select and unit mask of each architectural event */
+static const uint8_t event_codes[PERF_EVENT_COUNT][2] = {
+    [PERF_EVENT_CYCLES]         = { 0x3C, 0x00 },
+    [PERF_EVENT_INSTRUCTIONS]   = { 0xC0, 0x00 },
+    [PERF_EVENT_REF_CYCLES]     = { 0x3C, 0x01 },
+    [PERF_EVENT_LLC_REFERENCES] = { 0x2E, 0x4F },
+    [PERF_EVENT_LLC_MISSES]     = { 0x2E, 0x41 },
+    [PERF_EVENT_BRANCHES]       = { 0xC4, 0x00 },
+    [PERF_EVENT_BRANCH_MISSES]  = { 0xC5, 0x00 },
+};
+
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+                         uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                             : "a"(leaf), "c"(0));
+}
+
+static inline void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi)
+{
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"(lo), "d"(hi));
+}
+
+static inline uint64_t rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* ---------------------------------------------------------------------------
+ * State
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t generation;                    /* Session the MSRs are set up for */
+    uint64_t last[PERF_MAX_COUNTERS];       /* Counter values at the previous switch */
+    uint64_t total[PERF_MAX_COUNTERS];      /* Counts charged on this CPU */
+} perf_cpu_t;
+
+static perf_info_t pmu;
+static uint64_t counter_mask;               /* (1 << width) - 1 */
+
+static spinlock_t perf_lock = SPINLOCK_INIT;
+static bool session_active = false;
+static uint32_t session_count = 0;
+static uint32_t session_events[PERF_MAX_COUNTERS];
+
+static perf_cpu_t perf_cpus[SMP_MAX_CPUS];
+
+volatile uint32_t perf_generation = 0;
+
+/* ---------------------------------------------------------------------------
+ * perf_init - Detect architectural performance monitoring
+ * --------------------------------------------------------------------------- */
+void perf_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    pmu.version = 0;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < CPUID_PERFMON_LEAF) {
+        return;
+    }
+
+    cpuid(CPUID_PERFMON_LEAF, &eax, &ebx, &ecx, &edx);
+    uint32_t version = eax & 0xFF;
+    uint32_t counters = (eax >> 8) & 0xFF;
+    uint32_t width = (eax >> 16) & 0xFF;
+    uint32_t vector_length = (eax >> 24) & 0xFF;
+    if (version == 0 || counters == 0 || width < 32 || width > 64) {
+        return;
+    }
+
+    pmu.events = 0;
+    for (uint32_t i = 0; i < PERF_EVENT_COUNT && i < vector_length; i++) {
+        if (!(ebx & (1u << i))) {
+            pmu.events |= 1u << i;
+        }
+    }
+    pmu.counters = counters;
+    pmu.width = width;
+    pmu.version = version;
+    counter_mask = (width == 64) ? ~0ULL : (1ULL << width) - 1;
+}
+
+bool perf_available(void)
+{
+    return pmu.version != 0;
+}
+
+void perf_get_info(perf_info_t *info)
+{
+    *info = pmu;
+}
+
+/* ---------------------------------------------------------------------------
+ * Per-CPU Accounting (perf_lock held, interrupts off)
+ * --------------------------------------------------------------------------- */
+
+/* Load this CPU's MSRs for the current session, or clear them */
+static void program_local(perf_cpu_t *cpu)
+{
+    uint32_t used = (pmu.counters < PERF_MAX_COUNTERS) ? pmu.counters : PERF_MAX_COUNTERS;
+
+    if (pmu.version >= 2) {
+        wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, 0, 0);
+    }
+    for (uint32_t i = 0; i < used; i++) {
+        wrmsr(MSR_IA32_PERFEVTSEL0 + i, 0, 0);
+        wrmsr(MSR_IA32_PMC0 + i, 0, 0);
+        cpu->last[i] = 0;
+        cpu->total[i] = 0;
+    }
+
+    if (session_active) {
+        for (uint32_t i = 0; i < session_count; i++) {
+            const uint8_t *code = event_codes[session_events[i]];
+            wrmsr(MSR_IA32_PERFEVTSEL0 + i,
+                  code[0] | ((uint32_t)code[1] << 8) | EVTSEL_USR | EVTSEL_OS | EVTSEL_EN, 0);
+        }
+        if (pmu.version >= 2) {
+            wrmsr(MSR_IA32_PERF_GLOBAL_CTRL, (1u << session_count) - 1, 0);
+        }
+    }
+
+    cpu->generation = perf_generation;
+}
+
+/* Charge the counts since the last call on this CPU to 'task' (may be NULL) */
+static void account_local(task_t *task)
+{
+    perf_cpu_t *cpu = &perf_cpus[smp_this_cpu()->id];
+
+    if (cpu->generation != perf_generation) {
+        program_local(cpu);
+        return;
+    }
+    if (!session_active) {
+        return;
+    }
+
+    if (task != NULL && task->perf_generation != perf_generation) {
+        for (uint32_t i = 0; i < PERF_MAX_COUNTERS; i++) {
+            task->perf_counts[i] = 0;
+        }
+        task->perf_generation = perf_generation;
+    }
+
+    for (uint32_t i = 0; i < session_count; i++) {
+        uint64_t now = rdpmc(i);
+        uint64_t delta = (now - cpu->last[i]) & counter_mask;
+        cpu->last[i] = now;
+        cpu->total[i] += delta;
+        if (task != NULL) {
+            task->perf_counts[i] += delta;
+        }
+    }
+}
+
+/* Copy the session header into 'counts' */
+static void counts_header(perf_counts_t *counts)
+{
+    counts->count = session_count;
+    for (uint32_t i = 0; i < PERF_MAX_COUNTERS; i++) {
+        counts->events[i] = (i < session_count) ? session_events[i] : 0;
+        counts->values[i] = 0;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * perf_switch - Context switch hook (see PERF_SWITCH)
+ * --------------------------------------------------------------------------- */
+void perf_switch(task_t *prev)
+{
+    /* Nothing to charge and nothing to reprogram: skip the lock */
+    if (!session_active && perf_cpus[smp_this_cpu()->id].generation == perf_generation) {
+        return;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    account_local(prev);
+    spin_unlock_irqrestore(&perf_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Session Control
+ * --------------------------------------------------------------------------- */
+bool perf_start(const uint32_t *events, uint32_t count)
+{
+    if (!perf_available() || count == 0 || count > PERF_MAX_COUNTERS ||
+        count > pmu.counters) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (events[i] >= PERF_EVENT_COUNT || !(pmu.events & (1u << events[i]))) {
+            return false;
+        }
+    }
+
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    if (session_active) {
+        spin_unlock_irqrestore(&perf_lock, flags);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        session_events[i] = events[i];
+    }
+    session_count = count;
+    session_active = true;
+    perf_generation++;
+
+    /* Start here now rather than at this CPU's next switch */
+    program_local(&perf_cpus[smp_this_cpu()->id]);
+    spin_unlock_irqrestore(&perf_lock, flags);
+    return true;
+}
+
+void perf_stop(void)
+{
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    if (session_active) {
+        session_active = false;
+        perf_generation++;
+        program_local(&perf_cpus[smp_this_cpu()->id]);
+    }
+    spin_unlock_irqrestore(&perf_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * Reading
+ * --------------------------------------------------------------------------- */
+bool perf_read_system(perf_counts_t *counts)
+{
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    if (!session_active) {
+        spin_unlock_irqrestore(&perf_lock, flags);
+        return false;
+    }
+
+    account_local(task_current());
+    counts_header(counts);
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (perf_cpus[cpu].generation != perf_generation) {
+            continue;
+        }
+        for (uint32_t i = 0; i < session_count; i++) {
+            counts->values[i] += perf_cpus[cpu].total[i];
+        }
+    }
+
+    spin_unlock_irqrestore(&perf_lock, flags);
+    return true;
+}
+
+bool perf_read_task(task_t *task, perf_counts_t *counts)
+{
+    if (task == NULL) {
+        return false;
+    }
+
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    if (!session_active) {
+        spin_unlock_irqrestore(&perf_lock, flags);
+        return false;
+    }
+
+    if (task == task_current()) {
+        account_local(task);
+    }
+    counts_header(counts);
+    if (task->perf_generation == perf_generation) {
+        for (uint32_t i = 0; i < session_count; i++) {
+            counts->values[i] = task->perf_counts[i];
+        }
+    }
+
+    spin_unlock_irqrestore(&perf_lock, flags);
+    return true;
+}
+
+bool perf_read_local(uint64_t *values)
+{
+    uint32_t flags = spin_lock_irqsave(&perf_lock);
+    if (!session_active) {
+        spin_unlock_irqrestore(&perf_lock, flags);
+        return false;
+    }
+
+    perf_cpu_t *cpu = &perf_cpus[smp_this_cpu()->id];
+    if (cpu->generation != perf_generation) {
+        program_local(cpu);
+    }
+    for (uint32_t i = 0; i < session_count; i++) {
+        values[i] = rdpmc(i);
+    }
+
+    spin_unlock_irqrestore(&perf_lock, flags);
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * ===========================================================================
+ * kernel/utils/perf.h
+ * ===========================================================================
+ *
+ * Hardware Performance Counters
+ *
+ * perf_start() programs up to PERF_MAX_COUNTERS of the CPU's architectural
+ * general-purpose counters (Intel architectural performance monitoring,
+ * detected through CPUID leaf 0xA) to count the chosen events in both
+ * rings. Every context switch charges the counts since the previous switch
+ * to the outgoing task and to its CPU, so one session gives per-task and
+ * system-wide totals at the same time.
+ *
+ * Only one session runs at a time. CPUs without architectural perfmon
+ * (including most emulators) report perf_available() == false and every
+ * other call fails.
+ *
+ * Usage:
+ *   static const uint32_t events[] = { PERF_EVENT_INSTRUCTIONS, PERF_EVENT_CYCLES };
+ *
+ *   perf_start(events, 2);
+ *   ...
+ *   perf_counts_t counts;
+ *   perf_read_task(task_current(), &counts);
+ *   perf_stop();
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_PERF_H
+#define NEXA_PERF_H
+
+#include "../../config/os_config.h"
+
+struct task;
+
+/* ---------------------------------------------------------------------------
+ * Architectural Events (CPUID.0AH:EBX bit n clear = event n supported)
+ * --------------------------------------------------------------------------- */
+#define PERF_EVENT_CYCLES           0   /* Unhalted core cycles */
+#define PERF_EVENT_INSTRUCTIONS     1   /* Instructions retired */
+#define PERF_EVENT_REF_CYCLES       2   /* Unhalted reference cycles */
+#define PERF_EVENT_LLC_REFERENCES   3   /* Last-level cache references */
+#define PERF_EVENT_LLC_MISSES       4   /* Last-level cache misses */
+#define PERF_EVENT_BRANCHES         5   /* Branch instructions retired */
+#define PERF_EVENT_BRANCH_MISSES    6   /* Mispredicted branches retired */
+#define PERF_EVENT_COUNT            7
+
+/* PMU description (shared with user space by SYS_PERF) */
+typedef struct perf_info {
+    uint32_t version;               /* Architectural perfmon version (0 = none) */
+    uint32_t counters;              /* General-purpose counters per CPU */
+    uint32_t width;                 /* Counter width in bits */
+    uint32_t events;                /* Bit n set = PERF_EVENT n supported */
+} perf_info_t;
+
+/* Accumulated counts (shared with user space by SYS_PERF) */
+typedef struct perf_counts {
+    uint32_t count;                         /* Counters in the session */
+    uint32_t events[PERF_MAX_COUNTERS];     /* PERF_EVENT_* of each counter */
+    uint64_t values[PERF_MAX_COUNTERS];
+} perf_counts_t;
+
+/* Bumped by every perf_start()/perf_stop(); 0 until the first session */
+extern volatile uint32_t perf_generation;
+
+void perf_switch(struct task *prev);
+
+/* Charge the running counts to 'prev' before switching away from it */
+#define PERF_SWITCH(prev)                                                   \
+    do {                                                                    \
+        if (__builtin_expect(perf_generation != 0, 0)) {                    \
+            perf_switch(prev);                                              \
+        }                                                                   \
+    } while (0)
+
+/* Detect the PMU from CPUID on the boot CPU */
+void perf_init(void);
+
+bool perf_available(void);
+void perf_get_info(perf_info_t *info);
+
+/*
+ * Start counting 'count' events, one per counter, on every CPU (each CPU
+ * reprograms itself at its next context switch). Fails if a session is
+ * already running, an event is unsupported, or there are too few counters.
+ */
+bool perf_start(const uint32_t *events, uint32_t count);
+
+/* End the session; the counters stop at each CPU's next switch */
+void perf_stop(void);
+
+/* Totals since perf_start() over every CPU; the other CPUs lag by at most a switch */
+bool perf_read_system(perf_counts_t *counts);
+
+/* Totals charged to one task since perf_start() */
+bool perf_read_task(struct task *task, perf_counts_t *counts);
+
+/*
+ * Raw free-running counter values on the calling CPU, in session order,
+ * for measuring a short stretch of code by difference (the bench harness).
+ * The caller must not migrate between the two reads.
+ */
+bool perf_read_local(uint64_t *values);
+
+#endif /* NEXA_PERF_H */
@@ -0,0 +1,150 @@
+/*
+ * ===========================================================================
+ * kernel/utils/profile.c
+ * ===========================================================================
+ *
+ * Sampling Profiler
+ *
+ * The histogram is an open-addressed table of PROFILE_SLOTS (pid, eip,
+ * mode) keys with a sample count each; a count of zero marks a free slot.
+ * Only the timer interrupt writes it, and only the BSP's timer samples,
+ * under prof_lock (the tick does not take the kernel lock). Control calls
+ * from task context take prof_lock around their updates.
+ *
+ * A sample whose key finds no free slot within PROFILE_MAX_PROBE probes
+ * is counted as dropped rather than lengthening every later lookup.
+ * Ticks skipped by tickless idle take no sample, so idle time is
+ * under-counted relative to busy time.
+ *
+ * ===========================================================================
+ */
+
+#include <lib/cstd/stdio.h>
+#include "profile.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/spinlock.h"
+#include "../scheduler/task.h"
+#include "../drivers/drivers.h"
+
+/* From lib/cstd */
+extern void *memset(void *s, int c, size_t n);
+
+#define PROFILE_MAX_PROBE   16
+
+/* ---------------------------------------------------------------------------
+ * Histogram Structures
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t eip;
+    uint16_t pid;
+    uint16_t user;                  /* Interrupted in ring 3 */
+    uint32_t count;                 /* 0 = free slot */
+} profile_slot_t;
+
+static profile_slot_t profile_table[PROFILE_SLOTS];
+static uint32_t profile_samples;
+static uint32_t profile_dropped;
+
+volatile uint32_t profile_running = 0;
+
+/* Histogram and counters (leaf lock) */
+static spinlock_t prof_lock = SPINLOCK_INIT;
+
+static inline uint32_t profile_hash(uint32_t eip, uint32_t pid)
+{
+    uint32_t h = (eip >> 1) ^ (pid * 0x9E3779B1u);
+    h *= 0x85EBCA6Bu;
+    return (h ^ (h >> 16)) & (PROFILE_SLOTS - 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * profile_sample - Count one sample (timer interrupt)
+ * --------------------------------------------------------------------------- */
+void profile_sample(uint32_t eip, uint32_t cs)
+{
+    task_t *task = task_current();
+    uint16_t pid = (task != NULL) ? (uint16_t)task->pid : 0;
+    uint16_t user = (cs & 3) != 0;
+    uint32_t index = profile_hash(eip, pid);
+
+    spin_lock(&prof_lock);
+    profile_samples++;
+
+    for (uint32_t probe = 0; probe < PROFILE_MAX_PROBE; probe++) {
+        profile_slot_t *slot = &profile_table[(index + probe) & (PROFILE_SLOTS - 1)];
+
+        if (slot->count == 0) {
+            slot->eip = eip;
+            slot->pid = pid;
+            slot->user = user;
+            slot->count = 1;
+            spin_unlock(&prof_lock);
+            return;
+        }
+        if (slot->eip == eip && slot->pid == pid && slot->user == user) {
+            slot->count++;
+            spin_unlock(&prof_lock);
+            return;
+        }
+    }
+
+    profile_dropped++;
+    spin_unlock(&prof_lock);
+}
+
+/* ---------------------------------------------------------------------------
+ * profile_start - Reset the histogram and start sampling
+ * --------------------------------------------------------------------------- */
+void profile_start(void)
+{
+    uint32_t flags = spin_lock_irqsave(&prof_lock);
+
+    memset(profile_table, 0, sizeof(profile_table));
+    profile_samples = 0;
+    profile_dropped = 0;
+    profile_running = 1;
+
+    spin_unlock_irqrestore(&prof_lock, flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * profile_stop - Stop sampling
+ * --------------------------------------------------------------------------- */
+void profile_stop(void)
+{
+    profile_running = 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * profile_dump - Print the histogram over serial
+ * --------------------------------------------------------------------------- */
+uint32_t profile_dump(void)
+{
+    char line[64];
+    uint32_t entries = 0;
+
+    /* Freeze the table so the counts are consistent with the totals */
+    uint32_t was_running = profile_running;
+    profile_running = 0;
+
+    ksnprintf(line, sizeof(line), "PROFILE-START hz=%u samples=%u dropped=%u\n",
+              pit_get_frequency(), profile_samples, profile_dropped);
+    serial_write_string(line);
+
+    for (uint32_t i = 0; i < PROFILE_SLOTS; i++) {
+        profile_slot_t *slot = &profile_table[i];
+        if (slot->count == 0) {
+            continue;
+        }
+        ksnprintf(line, sizeof(line), "PROFILE %u %08x %s %u\n",
+                  slot->pid, slot->eip, slot->user ? "u" : "k", slot->count);
+        serial_write_string(line);
+        entries++;
+    }
+
+    ksnprintf(line, sizeof(line), "PROFILE-DONE entries=%u\n", entries);
+    serial_write_string(line);
+
+    profile_running = was_running;
+    return entries;
+}
@@ -0,0 +1,57 @@
+/*
+ * ===========================================================================
+ * kernel/utils/profile.h
+ * ===========================================================================
+ *
+ * Sampling Profiler
+ *
+ * While running, every timer tick records where it interrupted: the EIP
+ * from the interrupt frame and the PID of the running task. Samples are
+ * counted in a fixed histogram of (pid, eip) pairs, so a long run costs
+ * no more memory than a short one, and nothing in the profiled code has
+ * to be instrumented.
+ *
+ * The resolution is the scheduler tick (SCHEDULER_TICK_HZ samples per
+ * second of CPU time). profile_dump() prints the histogram over serial;
+ * scripts/profile_symbolize.py maps the addresses to functions in
+ * build/kernel.elf and emits folded stacks for flame graphs.
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_PROFILE_H
+#define NEXA_PROFILE_H
+
+#include "../../config/os_config.h"
+
+/* Nonzero between profile_start() and profile_stop(); read by the tick */
+extern volatile uint32_t profile_running;
+
+void profile_sample(uint32_t eip, uint32_t cs);
+
+/* Record one sample from the timer interrupt's frame */
+#define PROFILE_TICK(frame)                                                 \
+    do {                                                                    \
+        if (__builtin_expect(profile_running, 0)) {                         \
+            profile_sample((frame)->eip, (frame)->cs);                      \
+        }                                                                   \
+    } while (0)
+
+/* Empty the histogram and start sampling */
+void profile_start(void);
+
+/* Stop sampling; the histogram is kept for profile_dump() */
+void profile_stop(void);
+
+/*
+ * Print the histogram over serial, paused while it is read:
+ *
+ *   PROFILE-START hz=<samples per second> samples=<n> dropped=<n>
+ *   PROFILE <pid> <eip hex> <u|k> <count>
+ *   PROFILE-DONE entries=<n>
+ *
+ * 'u' marks samples taken in user mode. Returns the number of entries.
+ */
+uint32_t profile_dump(void);
+
+#endif /* NEXA_PROFILE_H */
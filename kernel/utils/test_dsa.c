@@ -5,6 +5,9 @@
 #include <lib/dsa/tree.h>
 #include <lib/dsa/trie.h>
 #include <lib/dsa/hashmap.h>
+#include <lib/dsa/rbtree.h>
+#include <lib/dsa/typed_heap.h>
+#include <lib/dsa/typed_ring.h>
 #include <stddef.h>
 
 /*
@@ -18,6 +21,7 @@
  */
 
 extern int kprintf(const char *format, ...); // Placeholder
+extern int ksnprintf(char *buf, size_t size, const char *fmt, ...);
 
 void test_list(void) {
     list_t list;
@@ -81,10 +85,250 @@ void test_heap(void) {
     dsa_heap_destroy(&h);
 }
 
+struct rb_item {
+    int key;
+    rb_node_t node;
+};
+
+static bool rb_item_less(const rb_node_t *a, const rb_node_t *b) {
+    return rb_entry(a, struct rb_item, node)->key < rb_entry(b, struct rb_item, node)->key;
+}
+
+void test_rbtree(void) {
+    rb_tree_t tree;
+    rb_tree_init(&tree);
+
+    struct rb_item items[7];
+    int keys[7] = {40, 10, 70, 20, 60, 30, 50};
+    for (int i = 0; i < 7; i++) {
+        items[i].key = keys[i];
+        rb_node_clear(&items[i].node);
+        rb_insert(&tree, &items[i].node, rb_item_less);
+    }
+
+    if (rb_size(&tree) != 7) kprintf("RB-tree size error\n");
+    if (tree.root->color != RB_BLACK) kprintf("RB-tree root color error\n");
+
+    // In-order walk must be sorted: 10, 20, ..., 70
+    int expected = 10;
+    for (rb_node_t *n = rb_first(&tree); n; n = rb_next(n)) {
+        if (rb_entry(n, struct rb_item, node)->key != expected) kprintf("RB-tree order error\n");
+        expected += 10;
+    }
+
+    rb_erase(&tree, &items[1].node);  // 10 (leftmost)
+    rb_erase(&tree, &items[0].node);  // 40 (root)
+    if (rb_node_is_linked(&items[0].node)) kprintf("RB-tree erase error\n");
+    if (rb_entry(rb_first(&tree), struct rb_item, node)->key != 20) kprintf("RB-tree leftmost error\n");
+    if (rb_size(&tree) != 5) kprintf("RB-tree size error after erase\n");
+}
+
+void test_trie(void) {
+    trie_t trie;
+    trie_init(&trie);
+
+    // Shared prefixes force path splits; "/var/log" is a prefix of other keys
+    static const char *paths[] = {"/", "/var/log", "/var/log/messages", "/var/log/kern.log", "/var/lib", "/usr"};
+    for (int i = 0; i < 6; i++) {
+        if (!trie_insert(&trie, paths[i], (void *)(paths[i]))) kprintf("Trie insert error\n");
+    }
+    if (trie_size(&trie) != 6) kprintf("Trie size error\n");
+    for (int i = 0; i < 6; i++) {
+        if (trie_search(&trie, paths[i]) != (void *)paths[i]) kprintf("Trie search error\n");
+    }
+    if (trie_search(&trie, "/var") != NULL) kprintf("Trie false positive\n");
+
+    // Enough children under one node to grow through every node size
+    char key[4] = {'/', 'x', 0, 0};
+    for (int c = 1; c < 256; c++) {
+        key[2] = (char)c;
+        trie_insert(&trie, key, (void *)(uintptr_t)c);
+    }
+    key[2] = (char)200;
+    if (trie_search(&trie, key) != (void *)200) kprintf("Trie node256 error\n");
+    for (int c = 1; c < 256; c++) {
+        key[2] = (char)c;
+        if (!trie_remove(&trie, key)) kprintf("Trie remove error\n");
+    }
+
+    if (!trie_remove(&trie, "/var/log")) kprintf("Trie remove error\n");
+    if (trie_search(&trie, "/var/log/messages") != (void *)paths[2]) kprintf("Trie collapse error\n");
+    if (trie_size(&trie) != 5) kprintf("Trie size error after remove\n");
+}
+
+// Short keys stay inline in the slot; every fourth one is long enough for the heap
+static void hashmap_test_key(char *buf, size_t size, int i) {
+    if (i % 4 == 3) {
+        ksnprintf(buf, size, "/a/long/hashmap/test/key/%d", i);
+    } else {
+        ksnprintf(buf, size, "key%d", i);
+    }
+}
+
+void test_hashmap(void) {
+    hashmap_t map;
+    char key[40];
+
+    // 48 keys fill a 64-slot table to 3/4; a fixed seed makes runs repeatable
+    if (!hashmap_init_with(&map, 48, hashmap_hash_bytes, 1)) {
+        kprintf("Hashmap init error\n");
+        return;
+    }
+    if (map.table.capacity != 64) kprintf("Hashmap capacity error\n");
+
+    for (int i = 0; i < 48; i++) {
+        hashmap_test_key(key, sizeof(key), i);
+        if (!hashmap_put(&map, key, (void *)(uintptr_t)(i + 1))) kprintf("Hashmap put error\n");
+    }
+    if (map.old.slots != NULL) kprintf("Hashmap resized early\n");
+
+    // Overwriting keeps the size; missing keys are not found
+    hashmap_put(&map, "key0", (void *)100);
+    if (map.size != 48) kprintf("Hashmap overwrite size error\n");
+    if (hashmap_get(&map, "key0") != (void *)100) kprintf("Hashmap overwrite error\n");
+    if (hashmap_get(&map, "key48") != NULL) kprintf("Hashmap false positive\n");
+    hashmap_put(&map, "key0", (void *)1);
+
+    // The 49th key starts a resize; 64 old slots take four operations to move
+    hashmap_test_key(key, sizeof(key), 48);
+    hashmap_put(&map, key, (void *)49);
+    if (map.old.slots == NULL || map.table.capacity != 128) kprintf("Hashmap resize error\n");
+
+    // Remove, overwrite and insert while keys are split across both tables
+    hashmap_test_key(key, sizeof(key), 7);
+    hashmap_remove(&map, key);
+    hashmap_test_key(key, sizeof(key), 11);
+    hashmap_put(&map, key, (void *)200);
+    hashmap_test_key(key, sizeof(key), 49);
+    hashmap_put(&map, key, (void *)50);
+    if (map.old.slots == NULL) kprintf("Hashmap migration ended early\n");
+    if (map.size != 49) kprintf("Hashmap size error during migration\n");
+
+    for (int i = 0; i < 50; i++) {
+        hashmap_test_key(key, sizeof(key), i);
+        void *expected = (void *)(uintptr_t)(i + 1);
+        if (i == 7) expected = NULL;
+        if (i == 11) expected = (void *)200;
+        if (hashmap_get(&map, key) != expected) kprintf("Hashmap get error\n");
+    }
+    if (map.old.slots != NULL) kprintf("Hashmap migration did not finish\n");
+
+    // Remove everything (the long keys free their heap copies)
+    for (int i = 0; i < 50; i++) {
+        hashmap_test_key(key, sizeof(key), i);
+        hashmap_remove(&map, key);
+    }
+    if (map.size != 0 || map.table.used != 0) kprintf("Hashmap remove error\n");
+    hashmap_test_key(key, sizeof(key), 3);
+    if (hashmap_get(&map, key) != NULL) kprintf("Hashmap get after remove error\n");
+
+    hashmap_destroy(&map);
+}
+
+#define INT_LESS(a, b) ((a) < (b))
+DEFINE_HEAP(int_heap, int, INT_LESS)
+
+struct heap_item {
+    int key;
+    int index;                      // Slot in the heap, HEAP_NOT_QUEUED if none
+};
+
+#define ITEM_LESS(a, b) ((a)->key < (b)->key)
+#define ITEM_SET_INDEX(item, i) ((item)->index = (i))
+DEFINE_HEAP_INDEXED(item_heap, struct heap_item *, ITEM_LESS, ITEM_SET_INDEX)
+
+void test_typed_heap(void) {
+    int storage[8];
+    int_heap_t h;
+    int_heap_init(&h, storage, 8);
+
+    int keys[8] = {50, 20, 80, 10, 70, 30, 60, 40};
+    for (int i = 0; i < 8; i++) {
+        if (!int_heap_push(&h, keys[i])) kprintf("Typed heap push error\n");
+    }
+    if (int_heap_push(&h, 5)) kprintf("Typed heap overfull\n");
+    if (*int_heap_peek(&h) != 10) kprintf("Typed heap peek error\n");
+
+    int out, expected = 10;
+    while (int_heap_pop(&h, &out)) {
+        if (out != expected) kprintf("Typed heap order error\n");
+        expected += 10;
+    }
+    if (expected != 90 || int_heap_peek(&h) != NULL) kprintf("Typed heap pop error\n");
+
+    // Indexed: items know their slot, so a key change or removal needs no search
+    struct heap_item items[6];
+    struct heap_item *slots[6];
+    item_heap_t ih;
+    item_heap_init(&ih, slots, 6);
+    for (int i = 0; i < 6; i++) {
+        items[i].key = (i + 1) * 10;
+        item_heap_push(&ih, &items[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+        if (slots[items[i].index] != &items[i]) kprintf("Typed heap index error\n");
+    }
+
+    items[5].key = 5;                           // 60 -> 5: to the root
+    item_heap_fix(&ih, (size_t)items[5].index);
+    items[0].key = 45;                          // 10 -> 45: down
+    item_heap_fix(&ih, (size_t)items[0].index);
+    item_heap_remove_at(&ih, (size_t)items[2].index);   // 30
+    if (items[2].index != HEAP_NOT_QUEUED) kprintf("Typed heap remove error\n");
+
+    int order[5] = {5, 20, 40, 45, 50};
+    struct heap_item *item;
+    for (int i = 0; i < 5; i++) {
+        if (!item_heap_pop(&ih, &item)) {
+            kprintf("Typed heap pop error\n");
+            break;
+        }
+        if (item->key != order[i]) kprintf("Typed heap fix error\n");
+        if (item->index != HEAP_NOT_QUEUED) kprintf("Typed heap index not cleared\n");
+    }
+    if (item_heap_count(&ih) != 0) kprintf("Typed heap count error\n");
+}
+
+DEFINE_RING(int_ring, int, 4)
+
+void test_typed_ring(void) {
+    int_ring_t r;
+    int_ring_init(&r);
+
+    // Start just below the wrap so tail - head has to survive it
+    r.head = r.tail = 0xFFFFFFFEu;
+    for (int i = 1; i <= 4; i++) {
+        if (!int_ring_push(&r, i)) kprintf("Typed ring push error\n");
+    }
+    if (!int_ring_full(&r) || int_ring_push(&r, 5)) kprintf("Typed ring overfull\n");
+    if (int_ring_count(&r) != 4) kprintf("Typed ring count error\n");
+    if (*int_ring_front(&r) != 1 || *int_ring_back(&r) != 4) kprintf("Typed ring ends error\n");
+
+    int_ring_remove_at(&r, 1);                  // 1 3 4
+    if (*int_ring_at(&r, 1) != 3 || int_ring_count(&r) != 3) kprintf("Typed ring remove error\n");
+
+    int out = 0;
+    int_ring_pop(&r, &out);
+    if (out != 1) kprintf("Typed ring pop error\n");
+    int_ring_push(&r, 5);                       // 3 4 5
+    int order[3] = {3, 4, 5};
+    for (int i = 0; i < 3; i++) {
+        if (!int_ring_pop(&r, &out) || out != order[i]) kprintf("Typed ring order error\n");
+    }
+    if (!int_ring_empty(&r) || int_ring_front(&r) != NULL || int_ring_pop(&r, NULL)) {
+        kprintf("Typed ring empty error\n");
+    }
+}
+
 void test_dsa_all(void) {
     test_list();
     test_queue();
     test_heap();
+    test_rbtree();
+    test_trie();
+    test_hashmap();
+    test_typed_heap();
+    test_typed_ring();
     // Add others...
     kprintf("DSA Tests Completed.\n");
 }
@@ -0,0 +1,173 @@
+/*
+ * ===========================================================================
+ * kernel/utils/trace.c
+ * ===========================================================================
+ *
+ * Static Tracepoints and Trace Rings
+ *
+ * Each CPU owns a ring of TRACE_RING_SLOTS binary records. A tracepoint
+ * that passes the mask test (trace.h) calls trace_record(), which fills the
+ * next slot of its CPU's ring with interrupts off and bumps the free-running
+ * head; there is one producer per ring, so no lock is taken. Old records
+ * are overwritten, and trace_dump() reports how many were lost that way.
+ *
+ * The dump is text over serial, one record per line, which
+ * scripts/trace_to_chrome.py turns into Chrome trace JSON (chrome://tracing
+ * or Perfetto): IRQs and system calls become slices, the rest instants.
+ *
+ * ===========================================================================
+ */
+
+#include <lib/cstd/stdio.h>
+#include "trace.h"
+#include "../interrupts/interrupts.h"
+#include "../scheduler/smp.h"
+#include "../drivers/drivers.h"
+
+/* ---------------------------------------------------------------------------
+ * Trace Ring Structures
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    trace_record_t records[TRACE_RING_SLOTS];
+    volatile uint32_t head;         /* Records written (free-running) */
+} trace_ring_t;
+
+static trace_ring_t trace_rings[SMP_MAX_CPUS];
+
+uint32_t trace_mask = 0;
+
+/* Names printed by trace_dump(), by category then index */
+#define TRACE_EVENTS_PER_CAT    2
+
+static const char *const event_names[TRACE_CAT_COUNT][TRACE_EVENTS_PER_CAT] = {
+    [TRACE_CAT_SCHED]   = { "schedule", "switch" },
+    [TRACE_CAT_IRQ]     = { "irq_enter", "irq_exit" },
+    [TRACE_CAT_SYSCALL] = { "syscall_enter", "syscall_exit" },
+    [TRACE_CAT_HEAP]    = { "kmalloc", "kfree" },
+    [TRACE_CAT_IPC]     = { "msgq_send", "msgq_receive" },
+};
+
+/* ---------------------------------------------------------------------------
+ * trace_record - Append one event to this CPU's ring
+ * --------------------------------------------------------------------------- */
+void trace_record(uint16_t event, uint32_t arg0, uint32_t arg1)
+{
+    uint32_t flags = interrupts_save_and_disable();
+
+    uint32_t cpu = smp_this_cpu()->id;
+    trace_ring_t *ring = &trace_rings[cpu];
+    trace_record_t *rec = &ring->records[ring->head & (TRACE_RING_SLOTS - 1)];
+
+    rec->tsc = clock_cycles();
+    rec->event = event;
+    rec->cpu = (uint8_t)cpu;
+    rec->reserved = 0;
+    rec->arg0 = arg0;
+    rec->arg1 = arg1;
+    ring->head++;
+
+    interrupts_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * trace_set_mask - Choose the enabled categories
+ * --------------------------------------------------------------------------- */
+uint32_t trace_set_mask(uint32_t mask)
+{
+    uint32_t old = trace_mask;
+    trace_mask = mask & TRACE_MASK_ALL;
+    return old;
+}
+
+/* ---------------------------------------------------------------------------
+ * trace_clear - Empty every ring
+ * --------------------------------------------------------------------------- */
+void trace_clear(void)
+{
+    uint32_t flags = interrupts_save_and_disable();
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        trace_rings[cpu].head = 0;
+    }
+    interrupts_restore(flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * trace_event_name - Name of an event id ("unknown" if it has none)
+ * --------------------------------------------------------------------------- */
+const char *trace_event_name(uint16_t event)
+{
+    uint32_t cat = event >> 8;
+    uint32_t index = event & 0xFF;
+    if (cat >= TRACE_CAT_COUNT || index >= TRACE_EVENTS_PER_CAT ||
+        event_names[cat][index] == NULL) {
+        return "unknown";
+    }
+    return event_names[cat][index];
+}
+
+/* ---------------------------------------------------------------------------
+ * trace_dump - Print the rings over serial
+ * --------------------------------------------------------------------------- */
+uint32_t trace_dump(void)
+{
+    char line[80];
+    uint32_t printed = 0;
+    uint32_t lost = 0;
+
+    /* Stop recording so the dump neither races nor traces itself */
+    uint32_t saved_mask = trace_set_mask(0);
+
+    ksnprintf(line, sizeof(line), "TRACE-START khz=%u cpus=%u slots=%u\n",
+              clock_get_khz(), smp_cpu_count(), TRACE_RING_SLOTS);
+    serial_write_string(line);
+
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        trace_ring_t *ring = &trace_rings[cpu];
+        uint32_t head = ring->head;
+        uint32_t first = 0;
+        if (head > TRACE_RING_SLOTS) {
+            first = head - TRACE_RING_SLOTS;
+            lost += first;
+        }
+
+        for (uint32_t i = first; i != head; i++) {
+            trace_record_t *rec = &ring->records[i & (TRACE_RING_SLOTS - 1)];
+            ksnprintf(line, sizeof(line), "TRACE %u %08x%08x %s %x %x\n",
+                      rec->cpu, (uint32_t)(rec->tsc >> 32), (uint32_t)rec->tsc,
+                      trace_event_name(rec->event), rec->arg0, rec->arg1);
+            serial_write_string(line);
+            printed++;
+        }
+    }
+
+    ksnprintf(line, sizeof(line), "TRACE-DONE records=%u lost=%u\n", printed, lost);
+    serial_write_string(line);
+
+    trace_set_mask(saved_mask);
+    return printed;
+}
+
+/* ---------------------------------------------------------------------------
+ * trace_snapshot - Copy the newest records of every ring
+ * ---------------------------------------------------------------------------
+ * For the crash path: takes no lock and leaves the rings as they are.
+ * --------------------------------------------------------------------------- */
+uint32_t trace_snapshot(trace_record_t *out, uint32_t per_cpu)
+{
+    uint32_t copied = 0;
+
+    if (per_cpu > TRACE_RING_SLOTS) {
+        per_cpu = TRACE_RING_SLOTS;
+    }
+
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        trace_ring_t *ring = &trace_rings[cpu];
+        uint32_t head = ring->head;
+        uint32_t first = (head > per_cpu) ? head - per_cpu : 0;
+
+        for (uint32_t i = first; i != head; i++) {
+            out[copied++] = ring->records[i & (TRACE_RING_SLOTS - 1)];
+        }
+    }
+    return copied;
+}
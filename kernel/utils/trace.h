@@ -0,0 +1,111 @@
+/*
+ * ===========================================================================
+ * kernel/utils/trace.h
+ * ===========================================================================
+ *
+ * Static Tracepoints
+ *
+ * TRACE(event, a, b) records a fixed-size binary event (TSC, CPU, event id
+ * and two arguments) in the running CPU's trace ring. Every event belongs
+ * to a category, and trace_mask has one bit per category; a disabled
+ * tracepoint costs one load, one test and a not-taken branch.
+ *
+ * The rings are flight recorders: a full ring overwrites its oldest
+ * records, so after a latency spike the events leading up to it are still
+ * there. trace_dump() prints them over serial for scripts/trace_to_chrome.py.
+ *
+ * Usage:
+ *   #include "../utils/trace.h"
+ *
+ *   TRACE(TRACE_IRQ_ENTER, irq, 0);
+ *
+ * ===========================================================================
+ */
+
+#ifndef NEXA_TRACE_H
+#define NEXA_TRACE_H
+
+#include "../../config/os_config.h"
+
+/* ---------------------------------------------------------------------------
+ * Categories (bits of trace_mask)
+ * --------------------------------------------------------------------------- */
+#define TRACE_CAT_SCHED     0
+#define TRACE_CAT_IRQ       1
+#define TRACE_CAT_SYSCALL   2
+#define TRACE_CAT_HEAP      3
+#define TRACE_CAT_IPC       4
+#define TRACE_CAT_COUNT     5
+
+#define TRACE_MASK_ALL      ((1u << TRACE_CAT_COUNT) - 1)
+
+/* ---------------------------------------------------------------------------
+ * Events: category in the high byte, index within it in the low byte
+ * --------------------------------------------------------------------------- */
+#define TRACE_EVENT(cat, n)     (((cat) << 8) | (n))
+
+#define TRACE_SCHEDULE          TRACE_EVENT(TRACE_CAT_SCHED, 0)     /* current pid, ready tasks */
+#define TRACE_SWITCH            TRACE_EVENT(TRACE_CAT_SCHED, 1)     /* from pid, to pid */
+#define TRACE_IRQ_ENTER         TRACE_EVENT(TRACE_CAT_IRQ, 0)       /* irq, 0 */
+#define TRACE_IRQ_EXIT          TRACE_EVENT(TRACE_CAT_IRQ, 1)       /* irq, 0 */
+#define TRACE_SYSCALL_ENTER     TRACE_EVENT(TRACE_CAT_SYSCALL, 0)   /* number, arg 1 */
+#define TRACE_SYSCALL_EXIT      TRACE_EVENT(TRACE_CAT_SYSCALL, 1)   /* number, result */
+#define TRACE_KMALLOC           TRACE_EVENT(TRACE_CAT_HEAP, 0)      /* size, pointer */
+#define TRACE_KFREE             TRACE_EVENT(TRACE_CAT_HEAP, 1)      /* pointer, 0 */
+#define TRACE_MSGQ_SEND         TRACE_EVENT(TRACE_CAT_IPC, 0)       /* qid, size */
+#define TRACE_MSGQ_RECEIVE      TRACE_EVENT(TRACE_CAT_IPC, 1)       /* qid, result */
+
+/* One ring entry (20 bytes) */
+typedef struct trace_record {
+    uint64_t tsc;
+    uint16_t event;
+    uint8_t cpu;
+    uint8_t reserved;
+    uint32_t arg0;
+    uint32_t arg1;
+} trace_record_t;
+
+/* Enabled categories; read inline by every tracepoint */
+extern uint32_t trace_mask;
+
+void trace_record(uint16_t event, uint32_t arg0, uint32_t arg1);
+
+#define TRACE(event, a, b)                                                  \
+    do {                                                                    \
+        if (__builtin_expect(trace_mask & (1u << ((event) >> 8)), 0)) {     \
+            trace_record((event), (uint32_t)(a), (uint32_t)(b));            \
+        }                                                                   \
+    } while (0)
+
+/* ---------------------------------------------------------------------------
+ * Control
+ * --------------------------------------------------------------------------- */
+
+/* Enable exactly the categories in mask; returns the previous mask */
+uint32_t trace_set_mask(uint32_t mask);
+
+/* Drop every recorded event */
+void trace_clear(void);
+
+/*
+ * Print every ring over serial, oldest first per CPU, with tracing paused:
+ *
+ *   TRACE-START khz=<tsc kHz> cpus=<n> slots=<per cpu>
+ *   TRACE <cpu> <tsc, 16 hex digits> <event name> <arg0 hex> <arg1 hex>
+ *   TRACE-DONE records=<n> lost=<overwritten>
+ *
+ * Returns the number of records printed.
+ */
+uint32_t trace_dump(void);
+
+/* Name of an event id as printed by trace_dump() */
+const char *trace_event_name(uint16_t event);
+
+/*
+ * Copy up to per_cpu of the newest records of each ring into out, oldest
+ * first per CPU, without pausing tracing. out must hold
+ * SMP_MAX_CPUS * per_cpu records. Returns the number copied.
+ */
+uint32_t trace_snapshot(trace_record_t *out, uint32_t per_cpu);
+
+#endif /* NEXA_TRACE_H */
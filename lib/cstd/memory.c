@@ -9,12 +9,146 @@
  * for use by the kernel and userland applications. These are freestanding
  * implementations that do not rely on an external C library.
  *
+ * Copy and Fill Strategy:
+ *   Below MEM_STRING_MIN bytes a plain byte loop wins over the startup cost
+ *   of a string instruction. Larger blocks use the string instructions:
+ *   "rep movsb"/"rep stosb" when the CPU has enhanced fast strings (ERMS),
+ *   otherwise a byte head that aligns the destination, "rep movsd"/"rep
+ *   stosd" for the body and a byte tail. Blocks of MEM_NONTEMPORAL_MIN
+ *   bytes or more are written with MOVNTI (SSE2) so that bulk copies do not
+ *   flush the cache. MOVNTI stores from general registers, so no FPU/SSE
+ *   state is touched and the routines stay safe in IRQ handlers and with
+ *   CR0.TS set. mem_init() picks the variants from CPUID; until it runs
+ *   the dword path is used, which works on any CPU.
+ *
+ * Overlapping moves to a higher address copy backwards with the direction
+ * flag set for the "rep movsd" body, and clear it again before returning.
+ *
  * ===========================================================================
  */
 
 #include "memory.h"
 #include "../../config/os_config.h"
 
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+
+#define MEM_STRING_MIN          32              /* Bytes before rep movs/stos pays off */
+#define MEM_NONTEMPORAL_MIN     (256 * 1024)    /* Bytes before bypassing the cache */
+
+#define CPUID_EDX_SSE2          (1U << 26)      /* Leaf 1 */
+#define CPUID_EBX_ERMS          (1U << 9)       /* Leaf 7, subleaf 0 */
+
+/* Word access to byte buffers */
+typedef uint32_t __attribute__((may_alias)) mem_word_t;
+
+/* ---------------------------------------------------------------------------
+ * Static Variables
+ * --------------------------------------------------------------------------- */
+
+static bool mem_erms = false;       /* rep movsb/stosb are fast for any size */
+static bool mem_movnti = false;     /* MOVNTI available */
+
+/* ---------------------------------------------------------------------------
+ * CPU Feature Selection
+ * --------------------------------------------------------------------------- */
+
+static inline void mem_cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *edx)
+{
+    uint32_t ecx = 0;
+    __asm__ volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "+c"(ecx), "=d"(*edx) : "a"(leaf));
+}
+
+/**
+ * @brief Choose the copy and fill variants for the running CPU
+ */
+void mem_init(void)
+{
+    uint32_t max_leaf, ebx, edx, unused;
+    mem_cpuid(0, &max_leaf, &ebx, &edx);
+
+    uint32_t eax;
+    mem_cpuid(1, &eax, &ebx, &edx);
+    mem_movnti = (edx & CPUID_EDX_SSE2) != 0;
+
+    if (max_leaf >= 7) {
+        mem_cpuid(7, &unused, &ebx, &edx);
+        mem_erms = (ebx & CPUID_EBX_ERMS) != 0;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * --------------------------------------------------------------------------- */
+
+/* Copy low-to-high with string instructions (n >= MEM_STRING_MIN) */
+static inline void copy_string(uint8_t *d, const uint8_t *s, size_t n)
+{
+    if (mem_erms) {
+        __asm__ volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+        return;
+    }
+
+    size_t head = (0 - (uintptr_t)d) & 3;
+    size_t words = (n - head) >> 2;
+    size_t tail = (n - head) & 3;
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+    __asm__ volatile("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(tail) : : "memory");
+}
+
+/* Copy low-to-high with cache-bypassing stores (n >= MEM_NONTEMPORAL_MIN) */
+static void copy_nontemporal(uint8_t *d, const uint8_t *s, size_t n)
+{
+    while ((uintptr_t)d & 3) {
+        *d++ = *s++;
+        n--;
+    }
+
+    mem_word_t *dw = (mem_word_t *)d;
+    const mem_word_t *sw = (const mem_word_t *)s;
+    for (; n >= 16; n -= 16, dw += 4, sw += 4) {
+        uint32_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+        __asm__ volatile("movnti %1, %0" : "=m"(dw[0]) : "r"(w0));
+        __asm__ volatile("movnti %1, %0" : "=m"(dw[1]) : "r"(w1));
+        __asm__ volatile("movnti %1, %0" : "=m"(dw[2]) : "r"(w2));
+        __asm__ volatile("movnti %1, %0" : "=m"(dw[3]) : "r"(w3));
+    }
+    /* Weakly ordered stores must land before anyone reads the copy */
+    __asm__ volatile("sfence" : : : "memory");
+
+    d = (uint8_t *)dw;
+    s = (const uint8_t *)sw;
+    while (n--) {
+        *d++ = *s++;
+    }
+}
+
+/* Fill with cache-bypassing stores (n >= MEM_NONTEMPORAL_MIN) */
+static void fill_nontemporal(uint8_t *p, uint8_t c, size_t n)
+{
+    while ((uintptr_t)p & 3) {
+        *p++ = c;
+        n--;
+    }
+
+    uint32_t word = c * 0x01010101U;
+    mem_word_t *pw = (mem_word_t *)p;
+    for (; n >= 16; n -= 16, pw += 4) {
+        __asm__ volatile("movnti %1, %0" : "=m"(pw[0]) : "r"(word));
+        __asm__ volatile("movnti %1, %0" : "=m"(pw[1]) : "r"(word));
+        __asm__ volatile("movnti %1, %0" : "=m"(pw[2]) : "r"(word));
+        __asm__ volatile("movnti %1, %0" : "=m"(pw[3]) : "r"(word));
+    }
+    __asm__ volatile("sfence" : : : "memory");
+
+    p = (uint8_t *)pw;
+    while (n--) {
+        *p++ = c;
+    }
+}
+
 /* ---------------------------------------------------------------------------
  * Memory Copy Functions
  * --------------------------------------------------------------------------- */
@@ -24,10 +158,17 @@
  */
 void *memcpy(void *dst, const void *src, size_t n)
 {
-    char *d = (char *)dst;
-    const char *s = (const char *)src;
-    while (n--) {
-        *d++ = *s++;
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (n >= MEM_NONTEMPORAL_MIN && mem_movnti) {
+        copy_nontemporal(d, s, n);
+    } else if (n >= MEM_STRING_MIN) {
+        copy_string(d, s, n);
+    } else {
+        while (n--) {
+            *d++ = *s++;
+        }
     }
     return dst;
 }
@@ -37,18 +178,35 @@ void *memcpy(void *dst, const void *src, size_t n)
  */
 void *memmove(void *dst, const void *src, size_t n)
 {
-    char *d = (char *)dst;
-    const char *s = (const char *)src;
-    if (d < s) {
-        while (n--) {
-            *d++ = *s++;
-        }
-    } else {
-        d += n;
-        s += n;
-        while (n--) {
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    /* Low-to-high is safe unless the destination starts inside the source */
+    if (d <= s || d >= s + n) {
+        return memcpy(dst, src, n);
+    }
+
+    d += n;
+    s += n;
+    if (n >= MEM_STRING_MIN) {
+        size_t tail = n & 3;
+        while (tail--) {
             *--d = *--s;
         }
+
+        /* Point at the last dword and walk down */
+        size_t words = n >> 2;
+        d -= 4;
+        s -= 4;
+        __asm__ volatile("std\n\t"
+                         "rep movsl\n\t"
+                         "cld"
+                         : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+        return dst;
+    }
+
+    while (n--) {
+        *--d = *--s;
     }
     return dst;
 }
@@ -62,9 +220,25 @@ void *memmove(void *dst, const void *src, size_t n)
  */
 void *memset(void *s, int c, size_t n)
 {
-    unsigned char *p = (unsigned char *)s;
-    while (n--) {
-        *p++ = (unsigned char)c;
+    uint8_t *p = (uint8_t *)s;
+    uint8_t byte = (uint8_t)c;
+
+    if (n >= MEM_NONTEMPORAL_MIN && mem_movnti) {
+        fill_nontemporal(p, byte, n);
+    } else if (n >= MEM_STRING_MIN && mem_erms) {
+        __asm__ volatile("rep stosb" : "+D"(p), "+c"(n) : "a"(byte) : "memory");
+    } else if (n >= MEM_STRING_MIN) {
+        size_t head = (0 - (uintptr_t)p) & 3;
+        size_t words = (n - head) >> 2;
+        size_t tail = (n - head) & 3;
+        uint32_t word = byte * 0x01010101U;
+        __asm__ volatile("rep stosb" : "+D"(p), "+c"(head) : "a"(word) : "memory");
+        __asm__ volatile("rep stosl" : "+D"(p), "+c"(words) : "a"(word) : "memory");
+        __asm__ volatile("rep stosb" : "+D"(p), "+c"(tail) : "a"(word) : "memory");
+    } else {
+        while (n--) {
+            *p++ = byte;
+        }
     }
     return s;
 }
@@ -100,10 +274,23 @@ int memcmp(const void *s1, const void *s2, size_t n)
 void *memchr(const void *s, int c, size_t n)
 {
     const unsigned char *p = (const unsigned char *)s;
-    while (n--) {
+    for (; n > 0 && ((uintptr_t)p & 3); n--, p++) {
+        if (*p == (unsigned char)c)
+            return (void *)p;
+    }
+
+    /* Four bytes at a time: a match becomes a zero byte after the XOR */
+    uint32_t pattern = (unsigned char)c * 0x01010101U;
+    const mem_word_t *w = (const mem_word_t *)p;
+    for (; n >= 4; n -= 4, w++) {
+        uint32_t x = *w ^ pattern;
+        if ((x - 0x01010101U) & ~x & 0x80808080U)
+            break;
+    }
+
+    for (p = (const unsigned char *)w; n > 0; n--, p++) {
         if (*p == (unsigned char)c)
             return (void *)p;
-        p++;
     }
     return NULL;
 }
@@ -27,6 +27,16 @@
 
 #include "../../config/os_config.h"
 
+/* ---------------------------------------------------------------------------
+ * Initialization
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Select the copy and fill variants for the running CPU (CPUID)
+ * @note Call once at boot; the functions work, more slowly, before that
+ */
+void mem_init(void);
+
 /* ---------------------------------------------------------------------------
  * Memory Copy Functions
  * --------------------------------------------------------------------------- */
@@ -20,124 +20,207 @@
  * ---------------------------------------------------------------------------
  * These functions must be provided by the kernel's drivers
  * --------------------------------------------------------------------------- */
-extern void vga_putchar(char c);
-extern void vga_write_string(const char *s);
-extern void serial_putchar(char c);
+extern void vga_write(const char *str, size_t len);
+extern void serial_write(const char *str, size_t len);
 
 /* ---------------------------------------------------------------------------
- * Internal Helper Functions
+ * Output Sinks
+ * ---------------------------------------------------------------------------
+ * The formatter writes through a sink: either the console or a caller
+ * buffer (which is always NUL-terminated and never overrun). Console
+ * output is collected into a small chunk and handed to the drivers a whole
+ * chunk at a time, so each driver takes its lock and moves its cursor once
+ * per chunk instead of once per character.
  * --------------------------------------------------------------------------- */
+#define OUT_CHUNK_SIZE      64
 
-/**
- * @brief Output a single character
- */
-static void putchar_internal(char c)
+typedef struct {
+    char *buf;              /* NULL = console */
+    size_t size;            /* Buffer size including the terminator */
+    size_t pos;             /* Characters produced so far */
+    size_t fill;            /* Console: bytes waiting in chunk */
+    char chunk[OUT_CHUNK_SIZE];
+} out_sink_t;
+
+static void out_flush(out_sink_t *out)
 {
-    vga_putchar(c);
-    serial_putchar(c);
+    if (out->buf == NULL && out->fill > 0) {
+        vga_write(out->chunk, out->fill);
+        serial_write(out->chunk, out->fill);
+        out->fill = 0;
+    }
 }
 
-/**
- * @brief Output a string
- */
-static void puts_internal(const char *s)
+static inline void out_char(out_sink_t *out, char c)
+{
+    if (out->buf == NULL) {
+        if (out->fill == OUT_CHUNK_SIZE) {
+            out_flush(out);
+        }
+        out->chunk[out->fill++] = c;
+    } else if (out->pos + 1 < out->size) {
+        out->buf[out->pos] = c;
+    }
+    out->pos++;
+}
+
+static void out_mem(out_sink_t *out, const char *s, size_t len)
+{
+    if (out->buf != NULL) {
+        /* Copy what fits, count the rest */
+        size_t room = out->pos + 1 < out->size ? out->size - 1 - out->pos : 0;
+        size_t n = len < room ? len : room;
+        for (size_t i = 0; i < n; i++) {
+            out->buf[out->pos + i] = s[i];
+        }
+        out->pos += len;
+        return;
+    }
+    
+    while (len > 0) {
+        if (out->fill == OUT_CHUNK_SIZE) {
+            out_flush(out);
+        }
+        size_t n = OUT_CHUNK_SIZE - out->fill;
+        if (n > len) {
+            n = len;
+        }
+        for (size_t i = 0; i < n; i++) {
+            out->chunk[out->fill + i] = s[i];
+        }
+        out->fill += n;
+        out->pos += n;
+        s += n;
+        len -= n;
+    }
+}
+
+static void out_pad(out_sink_t *out, char c, int count)
 {
-    while (*s) {
-        putchar_internal(*s++);
+    while (count-- > 0) {
+        out_char(out, c);
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * Number Conversion
+ * ---------------------------------------------------------------------------
+ * Digits are generated backwards from the end of a 12-byte buffer.
+ * Decimal takes two digits per step from a 00..99 pair table (one divide
+ * by the constant 100, which the compiler turns into a multiply); hex
+ * takes one nibble per step with a shift and a table lookup.
+ * --------------------------------------------------------------------------- */
+#define NUM_BUF_SIZE        12
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
 /**
- * @brief Convert unsigned integer to string
- * @param value Value to convert
- * @param buf Buffer to write to (must have space for result)
- * @param base Numeric base (10 or 16)
- * @param uppercase Use uppercase hex digits
- * @return Pointer to start of number string in buffer
+ * @brief Convert to decimal; returns the first digit, buf+NUM_BUF_SIZE the end
  */
-static char *utoa_internal(uint32_t value, char *buf, int base, int uppercase)
+static char *utoa_dec(uint32_t value, char *buf)
 {
-    static const char digits_lower[] = "0123456789abcdef";
-    static const char digits_upper[] = "0123456789ABCDEF";
-    const char *digits = uppercase ? digits_upper : digits_lower;
+    char *ptr = buf + NUM_BUF_SIZE;
     
-    char *ptr = buf + 32;  /* Start from end of buffer */
-    *ptr = '\0';
-    
-    if (value == 0) {
-        *--ptr = '0';
-        return ptr;
+    while (value >= 100) {
+        uint32_t q = value / 100;
+        const char *pair = &digit_pairs[(value - q * 100) * 2];
+        *--ptr = pair[1];
+        *--ptr = pair[0];
+        value = q;
     }
-    
-    while (value > 0) {
-        *--ptr = digits[value % base];
-        value /= base;
+    if (value >= 10) {
+        *--ptr = digit_pairs[value * 2 + 1];
+        *--ptr = digit_pairs[value * 2];
+    } else {
+        *--ptr = (char)('0' + value);
     }
     
     return ptr;
 }
 
 /**
- * @brief Convert signed integer to string
+ * @brief Convert to hexadecimal; returns the first digit
  */
-static char *itoa_internal(int32_t value, char *buf)
+static char *utoa_hex(uint32_t value, char *buf, const char *digits)
 {
-    char *ptr;
-    int negative = 0;
+    char *ptr = buf + NUM_BUF_SIZE;
     
-    if (value < 0) {
-        negative = 1;
-        value = -value;
-    }
+    do {
+        *--ptr = digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
     
-    ptr = utoa_internal((uint32_t)value, buf, 10, 0);
+    return ptr;
+}
+
+/**
+ * @brief Emit a converted number, left-padded to width
+ */
+static void out_number(out_sink_t *out, const char *digits, const char *end,
+                       bool negative, int width, char pad_char)
+{
+    int len = (int)(end - digits) + (negative ? 1 : 0);
     
+    if (negative && pad_char == '0') {
+        /* Sign goes before zero padding: -0042 */
+        out_char(out, '-');
+        negative = false;
+    }
+    out_pad(out, pad_char, width - len);
     if (negative) {
-        *--ptr = '-';
+        out_char(out, '-');
     }
-    
-    return ptr;
+    out_mem(out, digits, (size_t)(end - digits));
 }
 
 /* ---------------------------------------------------------------------------
- * Public API Implementation
+ * Formatter
  * --------------------------------------------------------------------------- */
 
 /**
- * @brief Kernel vprintf - formatted output with va_list
+ * @brief Format into an output sink (the console or a buffer)
+ * @return Number of characters produced
  */
-int kvprintf(const char *fmt, va_list ap)
+static int format_internal(out_sink_t *out, const char *fmt, va_list ap)
 {
-    int count = 0;
-    char numbuf[36];
-    char c;
-    const char *s;
-    char *numstr;
-    int32_t ival;
-    uint32_t uval;
-    void *pval;
-    int width;
-    char pad_char;
-    int len;
+    char numbuf[NUM_BUF_SIZE];
+    char *end = numbuf + NUM_BUF_SIZE;
     
     while (*fmt) {
-        if (*fmt != '%') {
-            putchar_internal(*fmt++);
-            count++;
+        /* Copy the literal run up to the next conversion in one go */
+        const char *run = fmt;
+        while (*fmt && *fmt != '%') {
+            fmt++;
+        }
+        if (fmt != run) {
+            out_mem(out, run, (size_t)(fmt - run));
             continue;
         }
         
         fmt++;  /* Skip '%' */
         
         /* Check for zero padding */
-        pad_char = ' ';
+        char pad_char = ' ';
         if (*fmt == '0') {
             pad_char = '0';
             fmt++;
         }
         
         /* Parse width */
-        width = 0;
+        int width = 0;
         while (*fmt >= '0' && *fmt <= '9') {
             width = width * 10 + (*fmt - '0');
             fmt++;
@@ -146,108 +229,136 @@ int kvprintf(const char *fmt, va_list ap)
         /* Process format specifier */
         switch (*fmt) {
             case 'd':
-            case 'i':
-                ival = va_arg(ap, int32_t);
-                numstr = itoa_internal(ival, numbuf);
-                len = 0;
-                for (const char *p = numstr; *p; p++) len++;
-                while (width > len) {
-                    putchar_internal(pad_char);
-                    count++;
-                    width--;
-                }
-                puts_internal(numstr);
-                count += len;
+            case 'i': {
+                int32_t ival = va_arg(ap, int32_t);
+                uint32_t mag = ival < 0 ? 0u - (uint32_t)ival : (uint32_t)ival;
+                out_number(out, utoa_dec(mag, numbuf), end, ival < 0, width, pad_char);
                 break;
+            }
                 
             case 'u':
-                uval = va_arg(ap, uint32_t);
-                numstr = utoa_internal(uval, numbuf, 10, 0);
-                len = 0;
-                for (const char *p = numstr; *p; p++) len++;
-                while (width > len) {
-                    putchar_internal(pad_char);
-                    count++;
-                    width--;
-                }
-                puts_internal(numstr);
-                count += len;
+                out_number(out, utoa_dec(va_arg(ap, uint32_t), numbuf), end,
+                           false, width, pad_char);
                 break;
                 
             case 'x':
-                uval = va_arg(ap, uint32_t);
-                numstr = utoa_internal(uval, numbuf, 16, 0);
-                len = 0;
-                for (const char *p = numstr; *p; p++) len++;
-                while (width > len) {
-                    putchar_internal(pad_char);
-                    count++;
-                    width--;
-                }
-                puts_internal(numstr);
-                count += len;
+                out_number(out, utoa_hex(va_arg(ap, uint32_t), numbuf, hex_lower), end,
+                           false, width, pad_char);
                 break;
                 
             case 'X':
-                uval = va_arg(ap, uint32_t);
-                numstr = utoa_internal(uval, numbuf, 16, 1);
-                len = 0;
-                for (const char *p = numstr; *p; p++) len++;
-                while (width > len) {
-                    putchar_internal(pad_char);
-                    count++;
-                    width--;
-                }
-                puts_internal(numstr);
-                count += len;
+                out_number(out, utoa_hex(va_arg(ap, uint32_t), numbuf, hex_upper), end,
+                           false, width, pad_char);
                 break;
                 
-            case 'p':
-                pval = va_arg(ap, void *);
-                puts_internal("0x");
-                count += 2;
-                numstr = utoa_internal((uint32_t)(uintptr_t)pval, numbuf, 16, 0);
-                len = 0;
-                for (const char *p = numstr; *p; p++) len++;
+            case 'p': {
                 /* Pad to 8 hex digits for pointers */
-                while (8 > len) {
-                    putchar_internal('0');
-                    count++;
-                    len++;
-                }
-                puts_internal(numstr);
-                for (const char *p = numstr; *p; p++) count++;
+                uintptr_t pval = (uintptr_t)va_arg(ap, void *);
+                out_mem(out, "0x", 2);
+                out_number(out, utoa_hex((uint32_t)pval, numbuf, hex_lower), end,
+                           false, 8, '0');
                 break;
+            }
                 
             case 'c':
-                c = (char)va_arg(ap, int);
-                putchar_internal(c);
-                count++;
+                out_char(out, (char)va_arg(ap, int));
                 break;
                 
-            case 's':
-                s = va_arg(ap, const char *);
+            case 's': {
+                const char *s = va_arg(ap, const char *);
                 if (s == NULL) s = "(null)";
-                puts_internal(s);
-                while (*s++) count++;
+                size_t len = 0;
+                while (s[len]) len++;
+                out_mem(out, s, len);
                 break;
+            }
                 
             case '%':
-                putchar_internal('%');
-                count++;
+                out_char(out, '%');
                 break;
                 
+            case '\0':
+                /* Lone '%' at the end of the format */
+                out_char(out, '%');
+                continue;
+                
             default:
                 /* Unknown format, print as-is */
-                putchar_internal('%');
-                putchar_internal(*fmt);
-                count += 2;
+                out_char(out, '%');
+                out_char(out, *fmt);
                 break;
         }
         
         fmt++;
     }
     
+    out_flush(out);
+    return (int)out->pos;
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API Implementation
+ * --------------------------------------------------------------------------- */
+
+/**
+ * @brief Kernel vprintf - formatted output with va_list
+ */
+int kvprintf(const char *fmt, va_list ap)
+{
+    out_sink_t out;
+    out.buf = NULL;
+    out.size = 0;
+    out.pos = 0;
+    out.fill = 0;
+    return format_internal(&out, fmt, ap);
+}
+
+/**
+ * @brief Kernel vsnprintf - formatted output into a buffer
+ */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap)
+{
+    if (buf == NULL || size == 0) {
+        return 0;
+    }
+    
+    out_sink_t out;
+    out.buf = buf;
+    out.size = size;
+    out.pos = 0;
+    out.fill = 0;
+    int count = format_internal(&out, fmt, ap);
+    buf[out.pos < size ? out.pos : size - 1] = '\0';
+    return count;
+}
+
+/**
+ * @brief Kernel sprintf - formatted output to string buffer
+ */
+int ksprintf(char *buf, const char *fmt, ...)
+{
+    va_list ap;
+    int count;
+    
+    va_start(ap, fmt);
+    count = kvsnprintf(buf, (size_t)-1 >> 1, fmt, ap);
+    va_end(ap);
+    
+    return count;
+}
+
+/**
+ * @brief Kernel snprintf - formatted output with length limit
+ */
+int ksnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list ap;
+    int count;
+    
+    va_start(ap, fmt);
+    count = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    
     return count;
 }
 
@@ -271,7 +382,9 @@ int kprintf(const char *fmt, ...)
  */
 int kputchar(int c)
 {
-    putchar_internal((char)c);
+    char ch = (char)c;
+    vga_write(&ch, 1);
+    serial_write(&ch, 1);
     return c;
 }
 
@@ -281,7 +394,6 @@ int kputchar(int c)
 int kputs(const char *s)
 {
     if (s == NULL) return -1;
-    puts_internal(s);
-    putchar_internal('\n');
+    kprintf("%s\n", s);
     return 0;
 }
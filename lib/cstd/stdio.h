@@ -56,6 +56,16 @@ int kprintf(const char *fmt, ...);
  */
 int kvprintf(const char *fmt, va_list ap);
 
+/**
+ * @brief Kernel vsnprintf - formatted output into a buffer, with va_list
+ * @param buf Destination buffer (always NUL-terminated if size > 0)
+ * @param size Buffer size including the terminator
+ * @param fmt Format string
+ * @param ap Variable argument list
+ * @return Number of characters that would have been written
+ */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list ap);
+
 /**
  * @brief Kernel sprintf - formatted output to string buffer
  * @param buf Destination buffer
@@ -9,12 +9,38 @@
  * for use by the kernel and userland applications. These are freestanding
  * implementations that do not rely on an external C library.
  *
+ * Word-at-a-Time Scanning:
+ *   strlen, strchr and strcmp read aligned 32-bit words once the pointer is
+ *   aligned, and test four bytes at once with the "has zero byte" trick:
+ *   (w - 0x01010101) & ~w & 0x80808080 is non-zero exactly when some byte
+ *   of w is zero. XOR with the wanted byte repeated turns a match into a
+ *   zero byte. An aligned word never straddles a page, so reading past the
+ *   terminator inside its word cannot fault.
+ *
+ * Substring Search:
+ *   strstr uses the Two-Way algorithm (Crochemore-Perrin): a critical
+ *   factorization of the needle lets it scan in linear time with constant
+ *   space, so long needles on long lines never cost O(n*m).
+ *
  * ===========================================================================
  */
 
 #include "string.h"
+#include "memory.h"
 #include "../../config/os_config.h"
 
+/* ---------------------------------------------------------------------------
+ * Word Helpers
+ * --------------------------------------------------------------------------- */
+
+#define WORD_ONES       0x01010101U
+#define WORD_HIGHS      0x80808080U
+#define WORD_HAS_ZERO(w)    ((((w) - WORD_ONES) & ~(w) & WORD_HIGHS) != 0)
+#define WORD_ALIGNED(p)     (((uintptr_t)(p) & (sizeof(uint32_t) - 1)) == 0)
+
+/* Word access to byte strings */
+typedef uint32_t __attribute__((may_alias)) str_word_t;
+
 /* ---------------------------------------------------------------------------
  * String Length Functions
  * --------------------------------------------------------------------------- */
@@ -24,10 +50,20 @@
  */
 size_t strlen(const char *s)
 {
-    size_t len = 0;
-    while (s[len])
-        len++;
-    return len;
+    const char *p = s;
+    for (; !WORD_ALIGNED(p); p++) {
+        if (*p == '\0')
+            return (size_t)(p - s);
+    }
+
+    const str_word_t *w = (const str_word_t *)p;
+    while (!WORD_HAS_ZERO(*w))
+        w++;
+
+    p = (const char *)w;
+    while (*p)
+        p++;
+    return (size_t)(p - s);
 }
 
 /**
@@ -35,10 +71,8 @@ size_t strlen(const char *s)
  */
 size_t strnlen(const char *s, size_t maxlen)
 {
-    size_t len = 0;
-    while (len < maxlen && s[len])
-        len++;
-    return len;
+    const char *end = memchr(s, '\0', maxlen);
+    return end != NULL ? (size_t)(end - s) : maxlen;
 }
 
 char *strcpy(char *dst, const char *src) {
@@ -61,6 +95,25 @@ char *strncpy(char *dst, const char *src, size_t n) {
 }
 
 int strcmp(const char *s1, const char *s2) {
+    /* Equal words without a terminator can be skipped whole */
+    if (((uintptr_t)s1 & 3) == ((uintptr_t)s2 & 3)) {
+        while (!WORD_ALIGNED(s1)) {
+            if (*s1 == '\0' || *s1 != *s2)
+                goto bytes;
+            s1++;
+            s2++;
+        }
+        const str_word_t *w1 = (const str_word_t *)s1;
+        const str_word_t *w2 = (const str_word_t *)s2;
+        while (*w1 == *w2 && !WORD_HAS_ZERO(*w1)) {
+            w1++;
+            w2++;
+        }
+        s1 = (const char *)w1;
+        s2 = (const char *)w2;
+    }
+
+bytes:
     while (*s1 && (*s1 == *s2)) {
         s1++;
         s2++;
@@ -110,10 +163,21 @@ char *strncat(char *dst, const char *src, size_t n)
  */
 char *strchr(const char *s, int c)
 {
-    while (*s) {
+    for (; !WORD_ALIGNED(s); s++) {
+        if (*s == (char)c)
+            return (char *)s;
+        if (*s == '\0')
+            return NULL;
+    }
+
+    uint32_t pattern = (uint8_t)c * WORD_ONES;
+    const str_word_t *w = (const str_word_t *)s;
+    while (!WORD_HAS_ZERO(*w) && !WORD_HAS_ZERO(*w ^ pattern))
+        w++;
+
+    for (s = (const char *)w; *s; s++) {
         if (*s == (char)c)
             return (char *)s;
-        s++;
     }
     return (c == '\0') ? (char *)s : NULL;
 }
@@ -132,27 +196,106 @@ char *strrchr(const char *s, int c)
     return (c == '\0') ? (char *)s : (char *)last;
 }
 
+/*
+ * Maximal suffix of the needle under one byte order (reversed with 'flip').
+ * Returns the suffix start and stores its period.
+ */
+static size_t two_way_max_suffix(const unsigned char *x, size_t m, size_t *period, bool flip)
+{
+    size_t ms = (size_t)-1;     /* Wraps so that ms + k starts at k - 1 */
+    size_t j = 0, k = 1, p = 1;
+
+    while (j + k < m) {
+        unsigned char a = x[j + k];
+        unsigned char b = x[ms + k];
+        if (flip ? a > b : a < b) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (a == b) {
+            if (k != p) {
+                k++;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            ms = j++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return ms + 1;
+}
+
+/* Two-Way search of needle (length m >= 2) in haystack (length n >= m) */
+static char *two_way(const unsigned char *h, size_t n, const unsigned char *x, size_t m)
+{
+    size_t period, period_rev;
+    size_t split = two_way_max_suffix(x, m, &period, false);
+    size_t split_rev = two_way_max_suffix(x, m, &period_rev, true);
+    if (split_rev > split) {
+        split = split_rev;
+        period = period_rev;
+    }
+
+    size_t j = 0;
+    if (memcmp(x, x + period, split) == 0) {
+        /* Periodic needle: remember how much of the last match still holds */
+        size_t memory = 0;
+        while (j <= n - m) {
+            size_t i = split > memory ? split : memory;
+            while (i < m && x[i] == h[i + j])
+                i++;
+            if (i < m) {
+                j += i - split + 1;
+                memory = 0;
+                continue;
+            }
+            i = split;
+            while (i > memory && x[i - 1] == h[i - 1 + j])
+                i--;
+            if (i <= memory)
+                return (char *)h + j;
+            j += period;
+            memory = m - period;
+        }
+    } else {
+        period = (split > m - split ? split : m - split) + 1;
+        while (j <= n - m) {
+            size_t i = split;
+            while (i < m && x[i] == h[i + j])
+                i++;
+            if (i < m) {
+                j += i - split + 1;
+                continue;
+            }
+            i = split;
+            while (i > 0 && x[i - 1] == h[i - 1 + j])
+                i--;
+            if (i == 0)
+                return (char *)h + j;
+            j += period;
+        }
+    }
+    return NULL;
+}
+
 /**
  * @brief Find first occurrence of a substring
  */
 char *strstr(const char *haystack, const char *needle)
 {
-    if (*needle == '\0')
+    if (needle[0] == '\0')
         return (char *)haystack;
+    if (needle[1] == '\0')
+        return strchr(haystack, needle[0]);
 
-    while (*haystack) {
-        const char *h = haystack;
-        const char *n = needle;
-        
-        while (*h && *n && *h == *n) {
-            h++;
-            n++;
-        }
-        
-        if (*n == '\0')
-            return (char *)haystack;
-        
-        haystack++;
-    }
-    return NULL;
+    size_t m = strlen(needle);
+    size_t n = strnlen(haystack, m);
+    if (n < m)
+        return NULL;
+    n += strlen(haystack + n);
+
+    return two_way((const unsigned char *)haystack, n, (const unsigned char *)needle, m);
 }
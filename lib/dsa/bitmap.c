@@ -13,9 +13,24 @@
  * memory frames are available and which are in use. For N frames, we need
  * only N/8 bytes of storage.
  *
+ * Storage:
+ *   Bits are stored little-endian in 32-bit words (bit i lives in word i/32,
+ *   bit i%32), which on x86 is the same layout as byte i/8, bit i%8. All
+ *   searches work a word at a time and use BSF (__builtin_ctz) to locate a
+ *   bit inside a word. Padding bits past size_bits in the last word are kept
+ *   set, so they always look "used" and never need special casing in the
+ *   zero searches.
+ *
+ * Acceleration:
+ *   - next_free hint: every word below it is known to be full, so zero
+ *     searches start there instead of at word 0
+ *   - optional summary level: one bit per word, set when the word is full;
+ *     finding a free bit then costs one summary scan plus one BSF
+ *
  * Time Complexity:
  *   - set/clear/test: O(1)
- *   - find_first_zero/set: O(N/8) worst case, where N is number of bits
+ *   - find_first_zero: O(N/1024) with the summary, O(N/32) without
+ *   - find_first_set/contiguous/count: O(N/32) word operations
  *
  * ===========================================================================
  */
@@ -23,21 +38,64 @@
 #include "bitmap.h"
 
 /* ---------------------------------------------------------------------------
- * Local helper: memset implementation
+ * Word Access
  * ---------------------------------------------------------------------------
- * We provide our own memset since we're in a freestanding environment
- * without standard library support.
+ * The buffer is handed to us as raw bytes; may_alias keeps word access to it
+ * well-defined under strict aliasing.
  * --------------------------------------------------------------------------- */
-static void *bitmap_memset(void *dest, int value, size_t count)
+typedef uint32_t __attribute__((__may_alias__)) bitmap_word_t;
+
+#define WORD_FULL       0xFFFFFFFFu
+
+static inline bitmap_word_t *bitmap_words(const bitmap_t *bitmap)
+{
+    return (bitmap_word_t *)bitmap->buffer;
+}
+
+/* Mask of the valid bits in the last word (all ones if it is complete) */
+static inline uint32_t last_word_mask(const bitmap_t *bitmap)
+{
+    size_t tail = bitmap->size_bits % BITMAP_WORD_BITS;
+    return tail ? ((1u << tail) - 1) : WORD_FULL;
+}
+
+/* Population count without relying on libgcc (no POPCNT on i686) */
+static inline size_t popcount32(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    v = (v + (v >> 4)) & 0x0F0F0F0Fu;
+    return (size_t)((v * 0x01010101u) >> 24);
+}
+
+/* Mask with bits [lo, hi) set, 0 <= lo < hi <= 32 */
+static inline uint32_t range_mask(size_t lo, size_t hi)
 {
-    unsigned char *ptr = (unsigned char *)dest;
-    unsigned char byte_val = (unsigned char)value;
-    
-    while (count--) {
-        *ptr++ = byte_val;
+    uint32_t upper = (hi >= BITMAP_WORD_BITS) ? WORD_FULL : ((1u << hi) - 1);
+    return upper & ~((1u << lo) - 1);
+}
+
+/* Number of words in the summary level */
+static inline size_t summary_word_count(const bitmap_t *bitmap)
+{
+    return (bitmap->size_words + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helper: Refresh the summary bit for one storage word
+ * --------------------------------------------------------------------------- */
+static inline void summary_update(bitmap_t *bitmap, size_t word_idx)
+{
+    if (!bitmap->summary) {
+        return;
+    }
+
+    uint32_t bit = 1u << (word_idx % BITMAP_WORD_BITS);
+    if (bitmap_words(bitmap)[word_idx] == WORD_FULL) {
+        bitmap->summary[word_idx / BITMAP_WORD_BITS] |= bit;
+    } else {
+        bitmap->summary[word_idx / BITMAP_WORD_BITS] &= ~bit;
     }
-    
-    return dest;
 }
 
 /* ---------------------------------------------------------------------------
@@ -52,7 +110,8 @@ static void *bitmap_memset(void *dest, int value, size_t count)
  *   true on success, false if invalid parameters
  *
  * Notes:
- *   - The buffer must be at least (size_bits + 7) / 8 bytes
+ *   - The buffer must be 4-byte aligned and BITMAP_BUFFER_SIZE(size_bits)
+ *     bytes long (whole 32-bit words)
  *   - All bits are initialized to 0 (free/available)
  *   - The caller is responsible for providing valid buffer memory
  * --------------------------------------------------------------------------- */
@@ -67,9 +126,54 @@ bool bitmap_init(bitmap_t *bitmap, size_t size_bits, void *buffer)
     bitmap->buffer = (uint8_t *)buffer;
     bitmap->size_bits = size_bits;
     bitmap->size_bytes = (size_bits + 7) / 8;  /* Ceiling division */
+    bitmap->size_words = (size_bits + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    bitmap->next_free = 0;
+    bitmap->summary = NULL;
 
     /* Clear all bits to zero (all resources initially free) */
-    bitmap_memset(bitmap->buffer, 0, bitmap->size_bytes);
+    bitmap_word_t *words = bitmap_words(bitmap);
+    for (size_t i = 0; i < bitmap->size_words; i++) {
+        words[i] = 0;
+    }
+
+    /* Padding bits past the end permanently read as "used" */
+    words[bitmap->size_words - 1] = ~last_word_mask(bitmap);
+
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * bitmap_enable_summary - Attach and build the summary level
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   bitmap  - Pointer to initialized bitmap
+ *   summary - Buffer of BITMAP_SUMMARY_SIZE(size_bits) bytes
+ *
+ * Returns:
+ *   true on success, false if invalid parameters
+ * --------------------------------------------------------------------------- */
+bool bitmap_enable_summary(bitmap_t *bitmap, void *summary)
+{
+    if (!bitmap || !bitmap->buffer || !summary) {
+        return false;
+    }
+
+    size_t summary_words = summary_word_count(bitmap);
+    bitmap->summary = (uint32_t *)summary;
+
+    for (size_t i = 0; i < summary_words; i++) {
+        bitmap->summary[i] = 0;
+    }
+
+    /* Summary bits for words that don't exist also read as "full" */
+    size_t tail = bitmap->size_words % BITMAP_WORD_BITS;
+    if (tail) {
+        bitmap->summary[summary_words - 1] = ~((1u << tail) - 1);
+    }
+
+    for (size_t i = 0; i < bitmap->size_words; i++) {
+        summary_update(bitmap, i);
+    }
 
     return true;
 }
@@ -83,7 +187,7 @@ bool bitmap_init(bitmap_t *bitmap, size_t size_bits, void *buffer)
  *
  * Notes:
  *   - Out-of-bounds indices are silently ignored for safety
- *   - Uses bitwise OR to set without affecting other bits in the byte
+ *   - Uses bitwise OR to set without affecting other bits in the word
  * --------------------------------------------------------------------------- */
 void bitmap_set(bitmap_t *bitmap, size_t index)
 {
@@ -91,12 +195,14 @@ void bitmap_set(bitmap_t *bitmap, size_t index)
     if (!bitmap || index >= bitmap->size_bits) {
         return;
     }
-    
+
     /*
-     * Set the bit at position (index % 8) in byte (index / 8)
-     * Example: index=13 -> byte[1] |= (1 << 5) -> sets bit 5 of byte 1
+     * Set the bit at position (index % 32) in word (index / 32)
+     * Example: index=45 -> word[1] |= (1 << 13) -> sets bit 13 of word 1
      */
-    bitmap->buffer[index / 8] |= (1 << (index % 8));
+    size_t word_idx = index / BITMAP_WORD_BITS;
+    bitmap_words(bitmap)[word_idx] |= (1u << (index % BITMAP_WORD_BITS));
+    summary_update(bitmap, word_idx);
 }
 
 /* ---------------------------------------------------------------------------
@@ -109,6 +215,7 @@ void bitmap_set(bitmap_t *bitmap, size_t index)
  * Notes:
  *   - Out-of-bounds indices are silently ignored for safety
  *   - Uses bitwise AND with inverted mask to clear without affecting others
+ *   - Pulls the next-free hint back if the freed bit lies below it
  * --------------------------------------------------------------------------- */
 void bitmap_clear(bitmap_t *bitmap, size_t index)
 {
@@ -116,12 +223,14 @@ void bitmap_clear(bitmap_t *bitmap, size_t index)
     if (!bitmap || index >= bitmap->size_bits) {
         return;
     }
-    
-    /*
-     * Clear the bit at position (index % 8) in byte (index / 8)
-     * Example: index=13 -> byte[1] &= ~(1 << 5) -> clears bit 5 of byte 1
-     */
-    bitmap->buffer[index / 8] &= ~(1 << (index % 8));
+
+    size_t word_idx = index / BITMAP_WORD_BITS;
+    bitmap_words(bitmap)[word_idx] &= ~(1u << (index % BITMAP_WORD_BITS));
+    summary_update(bitmap, word_idx);
+
+    if (word_idx < bitmap->next_free) {
+        bitmap->next_free = word_idx;
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -141,12 +250,9 @@ bool bitmap_test(const bitmap_t *bitmap, size_t index)
     if (!bitmap || index >= bitmap->size_bits) {
         return false;
     }
-    
-    /*
-     * Test the bit at position (index % 8) in byte (index / 8)
-     * Returns non-zero (true) if bit is set, zero (false) otherwise
-     */
-    return (bitmap->buffer[index / 8] & (1 << (index % 8))) != 0;
+
+    return (bitmap_words(bitmap)[index / BITMAP_WORD_BITS] &
+            (1u << (index % BITMAP_WORD_BITS))) != 0;
 }
 
 /* ---------------------------------------------------------------------------
@@ -159,42 +265,59 @@ bool bitmap_test(const bitmap_t *bitmap, size_t index)
  *   Index of first zero bit (>= 0), or -1 if all bits are set (no free resources)
  *
  * Algorithm:
- *   1. Scan bytes looking for any that aren't 0xFF (all bits set)
- *   2. When found, scan individual bits within that byte
- *   3. Return the global bit index
+ *   1. Start at the next-free hint (all earlier words are full)
+ *   2. With a summary: BSF over inverted summary words finds the first word
+ *      that isn't full; without one, scan words until one isn't 0xFFFFFFFF
+ *   3. BSF over the inverted word gives the bit; advance the hint
  *
  * Performance:
- *   - Best case O(1): first byte has a zero bit
- *   - Worst case O(N/8): must scan all bytes
+ *   - With summary: one summary word covers 1024 bits
+ *   - Without summary: one comparison per 32 bits
  * --------------------------------------------------------------------------- */
-int64_t bitmap_find_first_zero(const bitmap_t *bitmap)
+int64_t bitmap_find_first_zero(bitmap_t *bitmap)
 {
     if (!bitmap) {
         return -1;
     }
 
-    /* Scan each byte in the bitmap */
-    for (size_t byte_idx = 0; byte_idx < bitmap->size_bytes; byte_idx++) {
-        /* Skip bytes that are fully allocated (all bits set) */
-        if (bitmap->buffer[byte_idx] != 0xFF) {
-            /* Found a byte with at least one zero bit - find which one */
-            for (int bit_idx = 0; bit_idx < 8; bit_idx++) {
-                if (!(bitmap->buffer[byte_idx] & (1 << bit_idx))) {
-                    /* Calculate the global bit index */
-                    size_t global_index = (byte_idx * 8) + bit_idx;
-                    
-                    /* Verify we haven't exceeded the actual bit count */
-                    /* (last byte might have unused bits) */
-                    if (global_index < bitmap->size_bits) {
-                        return (int64_t)global_index;
-                    }
-                }
+    bitmap_word_t *words = bitmap_words(bitmap);
+    size_t word_idx = bitmap->next_free;
+
+    if (bitmap->summary) {
+        size_t summary_words = summary_word_count(bitmap);
+        size_t s = word_idx / BITMAP_WORD_BITS;
+        uint32_t free_mask = 0;
+
+        if (s < summary_words) {
+            /* Ignore summary bits for words below the hint */
+            free_mask = ~bitmap->summary[s] & ~((1u << (word_idx % BITMAP_WORD_BITS)) - 1);
+            while (free_mask == 0 && ++s < summary_words) {
+                free_mask = ~bitmap->summary[s];
             }
         }
+
+        if (free_mask == 0) {
+            bitmap->next_free = bitmap->size_words;
+            return -1;
+        }
+
+        word_idx = s * BITMAP_WORD_BITS + (size_t)__builtin_ctz(free_mask);
+    } else {
+        while (word_idx < bitmap->size_words && words[word_idx] == WORD_FULL) {
+            word_idx++;
+        }
+
+        if (word_idx >= bitmap->size_words) {
+            bitmap->next_free = bitmap->size_words;
+            return -1;
+        }
     }
 
-    /* All bits are set - no free resources */
-    return -1;
+    bitmap->next_free = word_idx;
+
+    /* Padding bits are set, so the zero bit is always a real one */
+    size_t bit = (size_t)__builtin_ctz(~words[word_idx]);
+    return (int64_t)(word_idx * BITMAP_WORD_BITS + bit);
 }
 
 /* ---------------------------------------------------------------------------
@@ -215,22 +338,19 @@ int64_t bitmap_find_first_set(const bitmap_t *bitmap)
         return -1;
     }
 
-    /* Scan each byte in the bitmap */
-    for (size_t byte_idx = 0; byte_idx < bitmap->size_bytes; byte_idx++) {
-        /* Skip bytes that are empty (no bits set) */
-        if (bitmap->buffer[byte_idx] != 0x00) {
-            /* Found a byte with at least one set bit - find which one */
-            for (int bit_idx = 0; bit_idx < 8; bit_idx++) {
-                if (bitmap->buffer[byte_idx] & (1 << bit_idx)) {
-                    /* Calculate the global bit index */
-                    size_t global_index = (byte_idx * 8) + bit_idx;
-                    
-                    /* Verify we haven't exceeded the actual bit count */
-                    if (global_index < bitmap->size_bits) {
-                        return (int64_t)global_index;
-                    }
-                }
-            }
+    const bitmap_word_t *words = bitmap_words(bitmap);
+    size_t last = bitmap->size_words - 1;
+
+    for (size_t word_idx = 0; word_idx <= last; word_idx++) {
+        uint32_t word = words[word_idx];
+
+        /* Don't report the padding bits of the last word */
+        if (word_idx == last) {
+            word &= last_word_mask(bitmap);
+        }
+
+        if (word != 0) {
+            return (int64_t)(word_idx * BITMAP_WORD_BITS + (size_t)__builtin_ctz(word));
         }
     }
 
@@ -248,7 +368,9 @@ int64_t bitmap_find_first_set(const bitmap_t *bitmap)
  * Returns:
  *   Index of first bit in the contiguous range, or -1 if not found
  *
- * This is useful for allocating contiguous memory blocks.
+ * Words that are all zero extend the current run by 32 bits at once and
+ * full words reset it at once; mixed words are walked run by run with BSF
+ * instead of bit by bit. The search starts at the next-free hint.
  * --------------------------------------------------------------------------- */
 int64_t bitmap_find_contiguous_zeros(const bitmap_t *bitmap, size_t count)
 {
@@ -256,27 +378,54 @@ int64_t bitmap_find_contiguous_zeros(const bitmap_t *bitmap, size_t count)
         return -1;
     }
 
+    const bitmap_word_t *words = bitmap_words(bitmap);
     size_t consecutive = 0;
     size_t start_index = 0;
 
-    for (size_t i = 0; i < bitmap->size_bits; i++) {
-        if (!bitmap_test(bitmap, i)) {
-            /* Found a zero bit */
+    for (size_t word_idx = bitmap->next_free; word_idx < bitmap->size_words; word_idx++) {
+        uint32_t word = words[word_idx];
+
+        if (word == 0) {
             if (consecutive == 0) {
-                start_index = i;  /* Mark start of potential range */
+                start_index = word_idx * BITMAP_WORD_BITS;
             }
-            consecutive++;
-            
+            consecutive += BITMAP_WORD_BITS;
             if (consecutive >= count) {
                 return (int64_t)start_index;
             }
-        } else {
-            /* Found a set bit - reset counter */
+            continue;
+        }
+
+        if (word == WORD_FULL) {
             consecutive = 0;
+            continue;
+        }
+
+        /* Mixed word: alternate between runs of zeros and runs of ones */
+        size_t bit = 0;
+        while (bit < BITMAP_WORD_BITS) {
+            uint32_t rest = word >> bit;
+
+            if ((rest & 1u) == 0) {
+                /* Run of zeros up to the next set bit (or end of word) */
+                size_t run = rest ? (size_t)__builtin_ctz(rest) : BITMAP_WORD_BITS - bit;
+                if (consecutive == 0) {
+                    start_index = word_idx * BITMAP_WORD_BITS + bit;
+                }
+                consecutive += run;
+                if (consecutive >= count) {
+                    return (int64_t)start_index;
+                }
+                bit += run;
+            } else {
+                /* Run of ones - breaks any run in progress */
+                bit += (size_t)__builtin_ctz(~rest);
+                consecutive = 0;
+            }
         }
     }
 
-    /* Couldn't find enough contiguous zeros */
+    /* Couldn't find enough contiguous zeros (padding bits are set) */
     return -1;
 }
 
@@ -288,16 +437,30 @@ int64_t bitmap_find_contiguous_zeros(const bitmap_t *bitmap, size_t count)
  *   start  - Starting bit index
  *   count  - Number of bits to set
  *
- * This is an optimization for bulk allocation operations.
+ * Each word touched by the range is updated with a single masked store.
  * --------------------------------------------------------------------------- */
 void bitmap_set_range(bitmap_t *bitmap, size_t start, size_t count)
 {
-    if (!bitmap) {
+    if (!bitmap || start >= bitmap->size_bits || count == 0) {
         return;
     }
 
-    for (size_t i = 0; i < count && (start + i) < bitmap->size_bits; i++) {
-        bitmap_set(bitmap, start + i);
+    if (count > bitmap->size_bits - start) {
+        count = bitmap->size_bits - start;
+    }
+
+    bitmap_word_t *words = bitmap_words(bitmap);
+    size_t end = start + count;
+
+    while (start < end) {
+        size_t word_idx = start / BITMAP_WORD_BITS;
+        size_t word_base = word_idx * BITMAP_WORD_BITS;
+        size_t lo = start - word_base;
+        size_t hi = (end - word_base < BITMAP_WORD_BITS) ? end - word_base : BITMAP_WORD_BITS;
+
+        words[word_idx] |= range_mask(lo, hi);
+        summary_update(bitmap, word_idx);
+        start = word_base + hi;
     }
 }
 
@@ -309,16 +472,34 @@ void bitmap_set_range(bitmap_t *bitmap, size_t start, size_t count)
  *   start  - Starting bit index
  *   count  - Number of bits to clear
  *
- * This is an optimization for bulk deallocation operations.
+ * Each word touched by the range is updated with a single masked store.
  * --------------------------------------------------------------------------- */
 void bitmap_clear_range(bitmap_t *bitmap, size_t start, size_t count)
 {
-    if (!bitmap) {
+    if (!bitmap || start >= bitmap->size_bits || count == 0) {
         return;
     }
 
-    for (size_t i = 0; i < count && (start + i) < bitmap->size_bits; i++) {
-        bitmap_clear(bitmap, start + i);
+    if (count > bitmap->size_bits - start) {
+        count = bitmap->size_bits - start;
+    }
+
+    bitmap_word_t *words = bitmap_words(bitmap);
+    size_t end = start + count;
+
+    if (start / BITMAP_WORD_BITS < bitmap->next_free) {
+        bitmap->next_free = start / BITMAP_WORD_BITS;
+    }
+
+    while (start < end) {
+        size_t word_idx = start / BITMAP_WORD_BITS;
+        size_t word_base = word_idx * BITMAP_WORD_BITS;
+        size_t lo = start - word_base;
+        size_t hi = (end - word_base < BITMAP_WORD_BITS) ? end - word_base : BITMAP_WORD_BITS;
+
+        words[word_idx] &= ~range_mask(lo, hi);
+        summary_update(bitmap, word_idx);
+        start = word_base + hi;
     }
 }
 
@@ -331,7 +512,7 @@ void bitmap_clear_range(bitmap_t *bitmap, size_t start, size_t count)
  * Returns:
  *   Number of bits that are set to 1
  *
- * Uses the Brian Kernighan algorithm for efficient bit counting.
+ * Uses a branch-free SWAR popcount per 32-bit word.
  * --------------------------------------------------------------------------- */
 size_t bitmap_count_set(const bitmap_t *bitmap)
 {
@@ -339,28 +520,16 @@ size_t bitmap_count_set(const bitmap_t *bitmap)
         return 0;
     }
 
+    const bitmap_word_t *words = bitmap_words(bitmap);
+    size_t last = bitmap->size_words - 1;
     size_t count = 0;
 
-    for (size_t byte_idx = 0; byte_idx < bitmap->size_bytes; byte_idx++) {
-        uint8_t byte_val = bitmap->buffer[byte_idx];
-        
-        /* Brian Kernighan's algorithm: count bits by clearing them one at a time */
-        while (byte_val) {
-            byte_val &= (byte_val - 1);  /* Clear the least significant set bit */
-            count++;
-        }
+    for (size_t word_idx = 0; word_idx < last; word_idx++) {
+        count += popcount32(words[word_idx]);
     }
 
-    /* Account for padding bits in the last byte that shouldn't be counted */
-    size_t padding_bits = (bitmap->size_bytes * 8) - bitmap->size_bits;
-    if (padding_bits > 0) {
-        uint8_t last_byte = bitmap->buffer[bitmap->size_bytes - 1];
-        for (size_t i = bitmap->size_bits % 8; i < 8; i++) {
-            if (last_byte & (1 << i)) {
-                count--;  /* Don't count padding bits */
-            }
-        }
-    }
+    /* Padding bits in the last word shouldn't be counted */
+    count += popcount32(words[last] & last_word_mask(bitmap));
 
     return count;
 }
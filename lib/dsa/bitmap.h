@@ -42,8 +42,22 @@ typedef struct bitmap {
     uint8_t *buffer;      /* Pointer to the bit storage array */
     size_t size_bits;     /* Total number of bits being tracked */
     size_t size_bytes;    /* Size of buffer in bytes = ceil(size_bits/8) */
+    size_t size_words;    /* Number of 32-bit words = ceil(size_bits/32) */
+    size_t next_free;     /* Hint: every word below this one is full */
+    uint32_t *summary;    /* Optional: one bit per word, set = word full */
 } bitmap_t;
 
+/* Bits per storage word */
+#define BITMAP_WORD_BITS        32
+
+/* Bytes of storage needed for a bitmap of 'bits' bits (whole 32-bit words) */
+#define BITMAP_BUFFER_SIZE(bits) \
+    ((((bits) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS) * sizeof(uint32_t))
+
+/* Bytes of storage needed for the summary level of a 'bits'-bit bitmap */
+#define BITMAP_SUMMARY_SIZE(bits) \
+    BITMAP_BUFFER_SIZE(((bits) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+
 /* ---------------------------------------------------------------------------
  * Core Operations
  * --------------------------------------------------------------------------- */
@@ -53,13 +67,28 @@ typedef struct bitmap {
  * 
  * @param bitmap    Pointer to bitmap structure to initialize
  * @param size_bits Number of bits to track
- * @param buffer    Pre-allocated buffer (must be >= (size_bits+7)/8 bytes)
+ * @param buffer    Pre-allocated, 4-byte aligned buffer of at least
+ *                  BITMAP_BUFFER_SIZE(size_bits) bytes
  * @return true on success, false if parameters are invalid
  * 
  * @note All bits are initialized to 0 (free/clear state)
  */
 bool bitmap_init(bitmap_t *bitmap, size_t size_bits, void *buffer);
 
+/**
+ * @brief Attach a summary level to an initialized bitmap
+ * 
+ * @param bitmap  Pointer to initialized bitmap
+ * @param summary 4-byte aligned buffer of at least
+ *                BITMAP_SUMMARY_SIZE(bitmap->size_bits) bytes
+ * @return true on success, false if parameters are invalid
+ * 
+ * The summary keeps one bit per storage word, set when that word is full.
+ * bitmap_find_first_zero() then skips 32 full words per summary word, which
+ * keeps searches short even when nearly every bit is set.
+ */
+bool bitmap_enable_summary(bitmap_t *bitmap, void *summary);
+
 /**
  * @brief Set a bit to 1 (mark as used/allocated)
  * 
@@ -100,8 +129,10 @@ bool bitmap_test(const bitmap_t *bitmap, size_t index);
  * @return Index of first zero bit, or -1 if all bits are set
  * 
  * This is the primary allocation function - finds the first free resource.
+ * Starts at the next-free hint (and uses the summary level, if enabled);
+ * the hint is advanced to the word where the zero bit was found.
  */
-int64_t bitmap_find_first_zero(const bitmap_t *bitmap);
+int64_t bitmap_find_first_zero(bitmap_t *bitmap);
 
 /**
  * @brief Find the first set bit
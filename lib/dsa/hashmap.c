@@ -4,139 +4,363 @@
  * Hash Map Implementation
  *
  * This file implements the hash map operations: initialization, insertion (put),
- * retrieval (get), removal, and destruction. It uses the DJB2 hash algorithm
- * for string hashing.
+ * retrieval (get), removal, and destruction. Keys are hashed with the map's
+ * seeded hash function, xxHash32 unless the map was given another.
+ *
+ * Slots live in one power-of-two array and a key is stored at or after its
+ * home slot (hash & mask). Robin Hood insertion lets a key that has probed
+ * further take the slot of one that is closer to home, which keeps probe
+ * lengths short and lets a lookup stop as soon as it meets a slot closer to
+ * home than its own probe. Removal shifts the following run back by one
+ * instead of leaving tombstones.
+ *
+ * Incremental resize: above 3/4 load a table of twice the size becomes the
+ * insert target and the old one is kept. Each put, get or remove then moves
+ * HASHMAP_MIGRATE_STEP old slots over, marking them "moved" so that lookups
+ * in the old table still probe past them. The old table is freed once the
+ * last slot has moved, long before the new one can fill up.
  */
 
 #include "hashmap.h"
+#include "../../kernel/memory/memory.h"
 
-extern void *kmalloc(size_t size);
-extern void kfree(void *ptr);
 extern size_t strlen(const char *s);
-extern char *strcpy(char *dest, const char *src);
-extern int strcmp(const char *s1, const char *s2);
+extern int memcmp(const void *s1, const void *s2, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
 void *memset(void *s, int c, size_t n);
+extern uint64_t clock_cycles(void);
 
-// Simple DJB2 hash function
-uint32_t hashmap_hash_string(const char *str) {
-    uint32_t hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+#define HASHMAP_MIN_CAPACITY    8
+#define HASHMAP_MIGRATE_STEP    16          /* Old slots moved per operation */
+
+/* hashmap_slot_t.hash values below this are markers, not hashes */
+#define SLOT_EMPTY              0
+#define SLOT_MOVED              1
+#define SLOT_FIRST_HASH         2
+
+/* ---------------------------------------------------------------------------
+ * Hash Functions
+ * --------------------------------------------------------------------------- */
+
+#define XXH_PRIME1  2654435761U
+#define XXH_PRIME2  2246822519U
+#define XXH_PRIME3  3266489917U
+#define XXH_PRIME4  668265263U
+#define XXH_PRIME5  374761393U
+
+/* Unaligned little-endian word reads (x86 allows them) */
+typedef uint32_t __attribute__((may_alias, aligned(1))) hash_word_t;
+
+static inline uint32_t rotl32(uint32_t x, unsigned r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh_round(uint32_t acc, uint32_t input) {
+    return rotl32(acc + input * XXH_PRIME2, 13) * XXH_PRIME1;
+}
+
+// xxHash32: four lanes of 4-byte words per 16-byte stripe, then the tail
+uint32_t hashmap_hash_bytes(const void *key, size_t len, uint32_t seed) {
+    const uint8_t *p = (const uint8_t *)key;
+    const uint8_t *end = p + len;
+    uint32_t hash;
+
+    if (len >= 16) {
+        uint32_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint32_t v2 = seed + XXH_PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH_PRIME1;
+        do {
+            v1 = xxh_round(v1, ((const hash_word_t *)p)[0]);
+            v2 = xxh_round(v2, ((const hash_word_t *)p)[1]);
+            v3 = xxh_round(v3, ((const hash_word_t *)p)[2]);
+            v4 = xxh_round(v4, ((const hash_word_t *)p)[3]);
+            p += 16;
+        } while (end - p >= 16);
+        hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        hash = seed + XXH_PRIME5;
+    }
+
+    hash += (uint32_t)len;
+    for (; end - p >= 4; p += 4) {
+        hash = rotl32(hash + *(const hash_word_t *)p * XXH_PRIME3, 17) * XXH_PRIME4;
     }
+    for (; p < end; p++) {
+        hash = rotl32(hash + *p * XXH_PRIME5, 11) * XXH_PRIME1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= XXH_PRIME2;
+    hash ^= hash >> 13;
+    hash *= XXH_PRIME3;
+    hash ^= hash >> 16;
     return hash;
 }
 
-static char *strdup(const char *s) {
-    size_t len = strlen(s) + 1;
-    char *new_s = (char *)kmalloc(len);
-    if (new_s) {
-        strcpy(new_s, s);
+uint32_t hashmap_hash_fnv1a(const void *key, size_t len, uint32_t seed) {
+    const uint8_t *p = (const uint8_t *)key;
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
     }
-    return new_s;
+    return hash;
 }
 
-bool hashmap_init(hashmap_t *map, size_t bucket_count) {
-    if (!map || bucket_count == 0) return false;
+uint32_t hashmap_hash_string(const char *str) {
+    return hashmap_hash_bytes(str, strlen(str), 0);
+}
 
-    map->buckets = (hashmap_entry_t **)kmalloc(bucket_count * sizeof(hashmap_entry_t *));
-    if (!map->buckets) return false;
+/* ---------------------------------------------------------------------------
+ * Slots and Tables
+ * --------------------------------------------------------------------------- */
 
-    memset(map->buckets, 0, bucket_count * sizeof(hashmap_entry_t *));
-    map->bucket_count = bucket_count;
-    map->size = 0;
+static uint32_t slot_hash(const hashmap_t *map, const char *key, size_t len) {
+    uint32_t hash = map->hash(key, len, map->seed);
+    return hash < SLOT_FIRST_HASH ? hash + SLOT_FIRST_HASH : hash;
+}
 
+static const char *slot_key(const hashmap_slot_t *slot) {
+    return slot->key_len < HASHMAP_INLINE_KEY ? slot->key.inline_key : slot->key.heap_key;
+}
+
+static void slot_free_key(hashmap_slot_t *slot) {
+    if (slot->key_len >= HASHMAP_INLINE_KEY) {
+        kfree(slot->key.heap_key);
+    }
+}
+
+/* Probe distance of the occupant of slot i from its home */
+static inline size_t slot_distance(const hashmap_table_t *t, size_t i, uint32_t hash) {
+    return (i - hash) & (t->capacity - 1);
+}
+
+static bool table_alloc(hashmap_table_t *t, size_t capacity) {
+    t->slots = (hashmap_slot_t *)kmalloc(capacity * sizeof(hashmap_slot_t));
+    if (!t->slots) return false;
+
+    memset(t->slots, 0, capacity * sizeof(hashmap_slot_t));
+    t->capacity = capacity;
+    t->used = 0;
     return true;
 }
 
-void hashmap_destroy(hashmap_t *map) {
-    if (!map) return;
+static void table_free(hashmap_table_t *t) {
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (t->slots[i].hash >= SLOT_FIRST_HASH) {
+            slot_free_key(&t->slots[i]);
+        }
+    }
+    kfree(t->slots);
+    t->slots = NULL;
+    t->capacity = 0;
+    t->used = 0;
+}
+
+static hashmap_slot_t *table_find(const hashmap_table_t *t, uint32_t hash,
+                                  const char *key, size_t len) {
+    if (!t->slots) return NULL;
+
+    size_t mask = t->capacity - 1;
+    size_t i = hash & mask;
+    for (size_t dist = 0; dist <= mask; dist++, i = (i + 1) & mask) {
+        hashmap_slot_t *slot = &t->slots[i];
+        if (slot->hash == SLOT_EMPTY) return NULL;
+        if (slot->hash == SLOT_MOVED) continue;
+        if (slot_distance(t, i, slot->hash) < dist) return NULL;  // Would have been placed here
+        if (slot->hash == hash && slot->key_len == len &&
+            memcmp(slot_key(slot), key, len) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* Robin Hood insert of a key known to be absent (the table has a free slot) */
+static void table_insert(hashmap_table_t *t, hashmap_slot_t entry) {
+    size_t mask = t->capacity - 1;
+    size_t i = entry.hash & mask;
+    size_t dist = 0;
+
+    for (;;) {
+        hashmap_slot_t *slot = &t->slots[i];
+        if (slot->hash == SLOT_EMPTY) {
+            *slot = entry;
+            t->used++;
+            return;
+        }
 
-    for (size_t i = 0; i < map->bucket_count; i++) {
-        hashmap_entry_t *entry = map->buckets[i];
-        while (entry) {
-            hashmap_entry_t *next = entry->next;
-            kfree(entry->key);
-            kfree(entry);
-            entry = next;
+        size_t slot_dist = slot_distance(t, i, slot->hash);
+        if (slot_dist < dist) {
+            // Take from the rich: the closer-to-home occupant moves on
+            hashmap_slot_t displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+            dist = slot_dist;
         }
+        i = (i + 1) & mask;
+        dist++;
     }
-    kfree(map->buckets);
-    map->buckets = NULL;
+}
+
+/* Remove a slot of the insert table by shifting the run after it back */
+static void table_delete(hashmap_table_t *t, hashmap_slot_t *slot) {
+    size_t mask = t->capacity - 1;
+    size_t i = (size_t)(slot - t->slots);
+
+    for (;;) {
+        size_t next = (i + 1) & mask;
+        hashmap_slot_t *follower = &t->slots[next];
+        if (follower->hash == SLOT_EMPTY || slot_distance(t, next, follower->hash) == 0) {
+            break;
+        }
+        t->slots[i] = *follower;
+        i = next;
+    }
+    t->slots[i].hash = SLOT_EMPTY;
+    t->used--;
+}
+
+/* Move up to 'steps' slots of the old table into the insert table */
+static void hashmap_migrate(hashmap_t *map, size_t steps) {
+    while (map->old.slots && steps-- > 0) {
+        hashmap_slot_t *slot = &map->old.slots[map->migrate_pos++];
+        if (slot->hash >= SLOT_FIRST_HASH) {
+            table_insert(&map->table, *slot);
+        }
+        slot->hash = SLOT_MOVED;
+
+        if (map->migrate_pos == map->old.capacity) {
+            map->old.capacity = 0;      // Nothing left that owns a key
+            kfree(map->old.slots);
+            map->old.slots = NULL;
+        }
+    }
+}
+
+/* Make room for one more key, starting a resize above 3/4 load */
+static bool hashmap_reserve(hashmap_t *map) {
+    hashmap_table_t *t = &map->table;
+    if ((t->used + 1) * 4 <= t->capacity * 3) return true;
+
+    hashmap_migrate(map, (size_t)-1);  // A resize is still running: finish it
+
+    hashmap_table_t bigger;
+    if (!table_alloc(&bigger, t->capacity * 2)) {
+        return t->used + 1 < t->capacity;  // Keep going at a higher load
+    }
+    map->old = *t;
+    map->table = bigger;
+    map->migrate_pos = 0;
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API
+ * --------------------------------------------------------------------------- */
+
+bool hashmap_init(hashmap_t *map, size_t bucket_count) {
+    // A per-map seed keeps crafted key sets from colliding in every map
+    uint32_t seed = (uint32_t)clock_cycles() ^ ((uint32_t)(uintptr_t)map * XXH_PRIME1);
+    return hashmap_init_with(map, bucket_count, hashmap_hash_bytes, seed);
+}
+
+bool hashmap_init_with(hashmap_t *map, size_t bucket_count,
+                       hashmap_hash_fn_t hash, uint32_t seed) {
+    if (!map || bucket_count == 0 || !hash) return false;
+
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    while (capacity * 3 < bucket_count * 4) {
+        capacity *= 2;
+    }
+
+    map->old.slots = NULL;
+    map->old.capacity = 0;
+    map->old.used = 0;
+    map->migrate_pos = 0;
+    map->size = 0;
+    map->hash = hash;
+    map->seed = seed;
+    return table_alloc(&map->table, capacity);
+}
+
+void hashmap_destroy(hashmap_t *map) {
+    if (!map) return;
+
+    if (map->old.slots) table_free(&map->old);
+    if (map->table.slots) table_free(&map->table);
     map->size = 0;
 }
 
 bool hashmap_put(hashmap_t *map, const char *key, void *value) {
-    if (!map || !key) return false;
+    if (!map || !key || !map->table.slots) return false;
 
-    uint32_t hash = hashmap_hash_string(key);
-    size_t index = hash % map->bucket_count;
+    hashmap_migrate(map, HASHMAP_MIGRATE_STEP);
 
-    hashmap_entry_t *entry = map->buckets[index];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            entry->value = value; // Update existing
-            return true;
-        }
-        entry = entry->next;
+    size_t len = strlen(key);
+    uint32_t hash = slot_hash(map, key, len);
+
+    hashmap_slot_t *slot = table_find(&map->table, hash, key, len);
+    if (!slot) slot = table_find(&map->old, hash, key, len);
+    if (slot) {
+        slot->value = value; // Update existing
+        return true;
     }
 
-    // Create new entry
-    hashmap_entry_t *new_entry = (hashmap_entry_t *)kmalloc(sizeof(hashmap_entry_t));
-    if (!new_entry) return false;
+    if (!hashmap_reserve(map)) return false;
 
-    new_entry->key = strdup(key);
-    if (!new_entry->key) {
-        kfree(new_entry);
-        return false;
+    hashmap_slot_t entry;
+    entry.hash = hash;
+    entry.key_len = (uint32_t)len;
+    entry.value = value;
+    if (len < HASHMAP_INLINE_KEY) {
+        memcpy(entry.key.inline_key, key, len + 1);
+    } else {
+        entry.key.heap_key = (char *)kmalloc(len + 1);
+        if (!entry.key.heap_key) return false;
+        memcpy(entry.key.heap_key, key, len + 1);
     }
-    new_entry->value = value;
-    new_entry->next = map->buckets[index];
-    map->buckets[index] = new_entry;
-    map->size++;
 
+    table_insert(&map->table, entry);
+    map->size++;
     return true;
 }
 
 void *hashmap_get(hashmap_t *map, const char *key) {
-    if (!map || !key) return NULL;
+    if (!map || !key || !map->table.slots) return NULL;
 
-    uint32_t hash = hashmap_hash_string(key);
-    size_t index = hash % map->bucket_count;
+    hashmap_migrate(map, HASHMAP_MIGRATE_STEP);
 
-    hashmap_entry_t *entry = map->buckets[index];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return entry->value;
-        }
-        entry = entry->next;
-    }
+    size_t len = strlen(key);
+    uint32_t hash = slot_hash(map, key, len);
 
-    return NULL;
+    hashmap_slot_t *slot = table_find(&map->table, hash, key, len);
+    if (!slot) slot = table_find(&map->old, hash, key, len);
+    return slot ? slot->value : NULL;
 }
 
 void hashmap_remove(hashmap_t *map, const char *key) {
-    if (!map || !key) return;
-
-    uint32_t hash = hashmap_hash_string(key);
-    size_t index = hash % map->bucket_count;
-
-    hashmap_entry_t *entry = map->buckets[index];
-    hashmap_entry_t *prev = NULL;
-
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                map->buckets[index] = entry->next;
-            }
-            kfree(entry->key);
-            kfree(entry);
-            map->size--;
-            return;
-        }
-        prev = entry;
-        entry = entry->next;
+    if (!map || !key || !map->table.slots) return;
+
+    hashmap_migrate(map, HASHMAP_MIGRATE_STEP);
+
+    size_t len = strlen(key);
+    uint32_t hash = slot_hash(map, key, len);
+
+    hashmap_slot_t *slot = table_find(&map->table, hash, key, len);
+    if (slot) {
+        slot_free_key(slot);
+        table_delete(&map->table, slot);
+        map->size--;
+        return;
+    }
+
+    // Old slots are only marked: shifting would disturb the migration scan
+    slot = table_find(&map->old, hash, key, len);
+    if (slot) {
+        slot_free_key(slot);
+        slot->hash = SLOT_MOVED;
+        map->size--;
     }
 }
@@ -11,24 +11,55 @@
  * Generic Hash Map Interface
  *
  * This header defines a generic hash map (dictionary) that maps string keys to
- * void pointers. It uses chaining (linked lists) to resolve hash collisions.
+ * void pointers. It uses open addressing with Robin Hood probing: every slot
+ * keeps the full hash of its key, so keys are only compared when the hashes
+ * match. Keys shorter than HASHMAP_INLINE_KEY are stored in the slot itself.
+ *
+ * Growing never rehashes the whole table at once: a table twice the size is
+ * allocated, and each later operation moves a few slots of the old one.
+ *
+ * Keys are hashed with a seeded hash chosen per map: xxHash32 by default
+ * (four bytes per step, good mixing for keys that differ in one digit), or
+ * any other hashmap_hash_fn_t. hashmap_init() seeds each map from the TSC.
  */
 
-typedef struct hashmap_entry {
-    char *key;
+/* Hash of len bytes (no terminator needed) under a seed */
+typedef uint32_t (*hashmap_hash_fn_t)(const void *key, size_t len, uint32_t seed);
+
+#define HASHMAP_INLINE_KEY  20      /* Keys shorter than this live in the slot */
+
+typedef struct hashmap_slot {
+    uint32_t hash;                  /* Full key hash; 0 = empty, 1 = moved out */
+    uint32_t key_len;
     void *value;
-    struct hashmap_entry *next;
-} hashmap_entry_t;
+    union {
+        char inline_key[HASHMAP_INLINE_KEY];
+        char *heap_key;             /* key_len >= HASHMAP_INLINE_KEY */
+    } key;
+} hashmap_slot_t;
+
+typedef struct hashmap_table {
+    hashmap_slot_t *slots;
+    size_t capacity;                /* Power of two (0 = no table) */
+    size_t used;
+} hashmap_table_t;
 
 typedef struct hashmap {
-    hashmap_entry_t **buckets;
-    size_t bucket_count;
+    hashmap_table_t table;          /* Inserts go here */
+    hashmap_table_t old;            /* Being migrated into table while growing */
+    size_t migrate_pos;             /* Next old slot to move */
     size_t size;
+    hashmap_hash_fn_t hash;
+    uint32_t seed;
 } hashmap_t;
 
-/* Initialize a hash map */
+/* Initialize a hash map (bucket_count = expected number of keys) */
 bool hashmap_init(hashmap_t *map, size_t bucket_count);
 
+/* Initialize a hash map with a given hash function and seed */
+bool hashmap_init_with(hashmap_t *map, size_t bucket_count,
+                       hashmap_hash_fn_t hash, uint32_t seed);
+
 /* Destroy the hash map */
 void hashmap_destroy(hashmap_t *map);
 
@@ -41,7 +72,13 @@ void *hashmap_get(hashmap_t *map, const char *key);
 /* Remove a key */
 void hashmap_remove(hashmap_t *map, const char *key);
 
-/* Simple string hash function */
+/* xxHash32 of len bytes (the default map hash) */
+uint32_t hashmap_hash_bytes(const void *key, size_t len, uint32_t seed);
+
+/* FNV-1a of len bytes: byte-serial, cheap for very short keys */
+uint32_t hashmap_hash_fnv1a(const void *key, size_t len, uint32_t seed);
+
+/* xxHash32 of a NUL-terminated string with seed 0 */
 uint32_t hashmap_hash_string(const char *str);
 
 #endif /* NEXA_HASHMAP_H */
@@ -0,0 +1,281 @@
+/*
+ * lib/dsa/rbtree.c
+ *
+ * Intrusive Red-Black Tree Implementation
+ *
+ * Classic parent-pointer red-black tree with NULL leaves. Insertion walks
+ * down with the caller's comparator, links the node red and repairs the
+ * red-red violations on the way up. Erasure splices the node (or its
+ * in-order successor) out and repairs the black height with the usual
+ * four sibling cases. Both repairs do at most three rotations.
+ *
+ * A cleared node has its parent pointing at itself, so membership can be
+ * tested without any extra field.
+ */
+
+#include "rbtree.h"
+
+static inline bool is_red(const rb_node_t *node) {
+    return node != NULL && node->color == RB_RED;
+}
+
+static inline bool is_black(const rb_node_t *node) {
+    return node == NULL || node->color == RB_BLACK;
+}
+
+/* Point whatever referenced old_child (parent link or root) at new_child */
+static void replace_child(rb_tree_t *tree, rb_node_t *parent,
+                          rb_node_t *old_child, rb_node_t *new_child) {
+    if (parent == NULL) {
+        tree->root = new_child;
+    } else if (parent->left == old_child) {
+        parent->left = new_child;
+    } else {
+        parent->right = new_child;
+    }
+}
+
+static void rotate_left(rb_tree_t *tree, rb_node_t *node) {
+    rb_node_t *pivot = node->right;
+
+    node->right = pivot->left;
+    if (pivot->left) pivot->left->parent = node;
+
+    pivot->parent = node->parent;
+    replace_child(tree, node->parent, node, pivot);
+
+    pivot->left = node;
+    node->parent = pivot;
+}
+
+static void rotate_right(rb_tree_t *tree, rb_node_t *node) {
+    rb_node_t *pivot = node->left;
+
+    node->left = pivot->right;
+    if (pivot->right) pivot->right->parent = node;
+
+    pivot->parent = node->parent;
+    replace_child(tree, node->parent, node, pivot);
+
+    pivot->right = node;
+    node->parent = pivot;
+}
+
+void rb_tree_init(rb_tree_t *tree) {
+    if (!tree) return;
+    tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->size = 0;
+}
+
+void rb_node_clear(rb_node_t *node) {
+    if (!node) return;
+    node->parent = node;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+}
+
+bool rb_node_is_linked(const rb_node_t *node) {
+    return node != NULL && node->parent != node;
+}
+
+void rb_insert(rb_tree_t *tree, rb_node_t *node, rb_less_t less) {
+    if (!tree || !node || !less) return;
+
+    /* Ordinary BST descent; equal keys go right */
+    rb_node_t *parent = NULL;
+    rb_node_t **link = &tree->root;
+    bool leftmost = true;
+
+    while (*link) {
+        parent = *link;
+        if (less(node, parent)) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+
+    if (leftmost) tree->leftmost = node;
+    tree->size++;
+
+    /* Repair red-red violations */
+    while (is_red(node->parent)) {
+        rb_node_t *p = node->parent;
+        rb_node_t *g = p->parent;
+
+        if (p == g->left) {
+            rb_node_t *uncle = g->right;
+            if (is_red(uncle)) {
+                p->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                g->color = RB_RED;
+                node = g;
+                continue;
+            }
+            if (node == p->right) {
+                rotate_left(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->color = RB_BLACK;
+            g->color = RB_RED;
+            rotate_right(tree, g);
+        } else {
+            rb_node_t *uncle = g->left;
+            if (is_red(uncle)) {
+                p->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                g->color = RB_RED;
+                node = g;
+                continue;
+            }
+            if (node == p->left) {
+                rotate_right(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->color = RB_BLACK;
+            g->color = RB_RED;
+            rotate_left(tree, g);
+        }
+    }
+
+    tree->root->color = RB_BLACK;
+}
+
+/* Restore black height after removing a black node; child may be NULL */
+static void erase_fixup(rb_tree_t *tree, rb_node_t *child, rb_node_t *parent) {
+    while (child != tree->root && is_black(child)) {
+        if (child == parent->left) {
+            rb_node_t *sibling = parent->right;
+            if (is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (is_black(sibling->left) && is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (is_black(sibling->right)) {
+                sibling->left->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->right->color = RB_BLACK;
+            rotate_left(tree, parent);
+        } else {
+            rb_node_t *sibling = parent->left;
+            if (is_red(sibling)) {
+                sibling->color = RB_BLACK;
+                parent->color = RB_RED;
+                rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (is_black(sibling->left) && is_black(sibling->right)) {
+                sibling->color = RB_RED;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (is_black(sibling->left)) {
+                sibling->right->color = RB_BLACK;
+                sibling->color = RB_RED;
+                rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->color = parent->color;
+            parent->color = RB_BLACK;
+            sibling->left->color = RB_BLACK;
+            rotate_right(tree, parent);
+        }
+        child = tree->root;
+    }
+
+    if (child) child->color = RB_BLACK;
+}
+
+void rb_erase(rb_tree_t *tree, rb_node_t *node) {
+    if (!tree || !rb_node_is_linked(node)) return;
+
+    if (tree->leftmost == node) tree->leftmost = rb_next(node);
+
+    rb_node_t *child;
+    rb_node_t *parent;
+    uint8_t removed_color;
+
+    if (node->left == NULL || node->right == NULL) {
+        /* At most one child: splice the node itself out */
+        child = node->left ? node->left : node->right;
+        parent = node->parent;
+        removed_color = node->color;
+
+        if (child) child->parent = parent;
+        replace_child(tree, parent, node, child);
+    } else {
+        /* Two children: move the in-order successor into node's place */
+        rb_node_t *succ = node->right;
+        while (succ->left) succ = succ->left;
+
+        child = succ->right;
+        removed_color = succ->color;
+
+        if (succ->parent == node) {
+            parent = succ;
+        } else {
+            parent = succ->parent;
+            parent->left = child;
+            if (child) child->parent = parent;
+
+            succ->right = node->right;
+            succ->right->parent = succ;
+        }
+
+        succ->left = node->left;
+        succ->left->parent = succ;
+        succ->parent = node->parent;
+        succ->color = node->color;
+        replace_child(tree, node->parent, node, succ);
+    }
+
+    if (removed_color == RB_BLACK) erase_fixup(tree, child, parent);
+
+    tree->size--;
+    rb_node_clear(node);
+}
+
+rb_node_t *rb_first(const rb_tree_t *tree) {
+    return tree ? tree->leftmost : NULL;
+}
+
+rb_node_t *rb_next(const rb_node_t *node) {
+    if (!node) return NULL;
+
+    if (node->right) {
+        node = node->right;
+        while (node->left) node = node->left;
+        return (rb_node_t *)node;
+    }
+
+    while (node->parent && node == node->parent->right) node = node->parent;
+    return node->parent;
+}
+
+size_t rb_size(const rb_tree_t *tree) {
+    return tree ? tree->size : 0;
+}
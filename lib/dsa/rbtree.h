@@ -0,0 +1,70 @@
+#ifndef NEXA_RBTREE_H
+#define NEXA_RBTREE_H
+
+#include "../../config/os_config.h"
+
+/*
+ * lib/dsa/rbtree.h
+ *
+ * Intrusive Red-Black Tree Interface
+ *
+ * A self-balancing binary search tree with O(log n) insert and erase. Nodes
+ * are embedded in the caller's structures (like list_node_t), so the tree
+ * never allocates. Ordering is supplied by a "less than" callback at insert
+ * time; equal keys are inserted to the right, which keeps FIFO order among
+ * them. The leftmost (smallest) node is cached so rb_first() is O(1).
+ */
+
+#define RB_RED      0
+#define RB_BLACK    1
+
+typedef struct rb_node {
+    struct rb_node *parent;
+    struct rb_node *left;
+    struct rb_node *right;
+    uint8_t color;
+} rb_node_t;
+
+typedef struct rb_tree {
+    rb_node_t *root;
+    rb_node_t *leftmost;    // Cached smallest node (NULL if empty)
+    size_t size;
+} rb_tree_t;
+
+/* Returns true if a orders before b */
+typedef bool (*rb_less_t)(const rb_node_t *a, const rb_node_t *b);
+
+/* Initialize an empty tree */
+void rb_tree_init(rb_tree_t *tree);
+
+/* Mark a node as not linked into any tree */
+void rb_node_clear(rb_node_t *node);
+
+/* Check if a node is currently linked into a tree */
+bool rb_node_is_linked(const rb_node_t *node);
+
+/* Insert a node (O(log n)) */
+void rb_insert(rb_tree_t *tree, rb_node_t *node, rb_less_t less);
+
+/* Remove a linked node (O(log n)); the node is cleared afterwards */
+void rb_erase(rb_tree_t *tree, rb_node_t *node);
+
+/* Smallest node, or NULL if empty (O(1)) */
+rb_node_t *rb_first(const rb_tree_t *tree);
+
+/* In-order successor, or NULL if node is the largest */
+rb_node_t *rb_next(const rb_node_t *node);
+
+/* Number of linked nodes */
+size_t rb_size(const rb_tree_t *tree);
+
+/* Get the containing structure of an embedded node */
+#define rb_entry(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+/* Provide offsetof if not available */
+#ifndef offsetof
+#define offsetof(type, member) ((size_t) &((type *)0)->member)
+#endif
+
+#endif /* NEXA_RBTREE_H */
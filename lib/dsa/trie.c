@@ -4,94 +4,617 @@
  * Trie Implementation
  *
  * This file implements Trie operations: insertion, search, and removal.
- * It manages a tree of nodes where each edge represents a character in the key string.
+ * It is an adaptive radix tree: each inner node holds a compressed path
+ * prefix and between 1 and 256 children, using the smallest of four layouts
+ * that fits. Keys are stored with their terminating NUL, so no key is a
+ * prefix of another and every key ends in its own leaf.
+ *
+ * Leaves are marked by setting the low bit of the child pointer.
  */
 
 #include "trie.h"
+#include "../../kernel/memory/memory.h"
+
+extern size_t strlen(const char *s);
+void *memset(void *s, int c, size_t n);
+
+typedef struct trie_node4 {
+    trie_node_t n;
+    uint8_t keys[4];                    // Sorted
+    trie_node_t *children[4];
+} trie_node4_t;
+
+typedef struct trie_node16 {
+    trie_node_t n;
+    uint8_t keys[16];                   // Sorted
+    trie_node_t *children[16];
+} trie_node16_t;
+
+typedef struct trie_node48 {
+    trie_node_t n;
+    uint8_t index[256];                 // Key byte -> slot + 1 (0 = none)
+    trie_node_t *children[48];
+} trie_node48_t;
+
+typedef struct trie_node256 {
+    trie_node_t n;
+    trie_node_t *children[256];
+} trie_node256_t;
+
+typedef struct trie_leaf {
+    void *data;
+    uint32_t key_len;                   // Including the NUL
+    uint8_t key[];
+} trie_leaf_t;
+
+#define IS_LEAF(x)      (((uintptr_t)(x)) & 1)
+#define SET_LEAF(x)     ((trie_node_t *)((uintptr_t)(x) | 1))
+#define LEAF_RAW(x)     ((trie_leaf_t *)((uintptr_t)(x) & ~(uintptr_t)1))
+
+#define MIN(a, b)       ((a) < (b) ? (a) : (b))
 
-extern void *kmalloc(size_t size);
-extern void kfree(void *ptr);
-void *memset(void *s, int c, size_t n); // Assuming we have this or need to include it
+// Each node size gets its own slab cache, shared by every trie and created
+// on first use. Leaves vary in length and come from kmalloc.
+static kmem_cache_t *node_caches[5];
+static const size_t node_sizes[5] = {
+    0,
+    sizeof(trie_node4_t),
+    sizeof(trie_node16_t),
+    sizeof(trie_node48_t),
+    sizeof(trie_node256_t),
+};
+static const char *const node_names[5] = {
+    NULL, "trie_node4", "trie_node16", "trie_node48", "trie_node256",
+};
 
-static trie_node_t *create_node(void) {
-    trie_node_t *node = (trie_node_t *)kmalloc(sizeof(trie_node_t));
+static trie_node_t *alloc_node(uint8_t type) {
+    if (!node_caches[type]) {
+        node_caches[type] = kmem_cache_create(node_names[type], node_sizes[type], 0, NULL);
+        if (!node_caches[type]) return NULL;
+    }
+
+    trie_node_t *node = (trie_node_t *)kmem_cache_alloc(node_caches[type]);
     if (node) {
-        node->data = NULL;
-        node->is_terminal = false;
-        memset(node->children, 0, sizeof(node->children));
+        memset(node, 0, node_sizes[type]);
+        node->type = type;
     }
     return node;
 }
 
-void trie_init(trie_t *trie) {
-    if (!trie) return;
-    trie->root = create_node();
+static void free_node(trie_node_t *node) {
+    kmem_cache_free(node_caches[node->type], node);
 }
 
-bool trie_insert(trie_t *trie, const char *key, void *data) {
-    if (!trie || !trie->root || !key) return false;
+static trie_leaf_t *make_leaf(const uint8_t *key, uint32_t key_len, void *data) {
+    trie_leaf_t *leaf = (trie_leaf_t *)kmalloc(sizeof(trie_leaf_t) + key_len);
+    if (leaf) {
+        leaf->data = data;
+        leaf->key_len = key_len;
+        for (uint32_t i = 0; i < key_len; i++) leaf->key[i] = key[i];
+    }
+    return leaf;
+}
+
+static bool leaf_matches(const trie_leaf_t *leaf, const uint8_t *key, uint32_t key_len) {
+    if (leaf->key_len != key_len) return false;
+    for (uint32_t i = 0; i < key_len; i++) {
+        if (leaf->key[i] != key[i]) return false;
+    }
+    return true;
+}
+
+static void copy_header(trie_node_t *dest, const trie_node_t *src) {
+    dest->num_children = src->num_children;
+    dest->prefix_len = src->prefix_len;
+    for (uint32_t i = 0; i < MIN(src->prefix_len, (uint32_t)TRIE_MAX_PREFIX); i++) {
+        dest->prefix[i] = src->prefix[i];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Child lookup
+ * --------------------------------------------------------------------------- */
+
+static trie_node_t **find_child(trie_node_t *node, uint8_t c) {
+    switch (node->type) {
+        case TRIE_NODE4: {
+            trie_node4_t *n = (trie_node4_t *)node;
+            for (int i = 0; i < node->num_children; i++) {
+                if (n->keys[i] == c) return &n->children[i];
+            }
+            break;
+        }
+        case TRIE_NODE16: {
+            // 16 key bytes share a cache line: a linear scan beats a search
+            trie_node16_t *n = (trie_node16_t *)node;
+            for (int i = 0; i < node->num_children; i++) {
+                if (n->keys[i] == c) return &n->children[i];
+            }
+            break;
+        }
+        case TRIE_NODE48: {
+            trie_node48_t *n = (trie_node48_t *)node;
+            if (n->index[c]) return &n->children[n->index[c] - 1];
+            break;
+        }
+        case TRIE_NODE256: {
+            trie_node256_t *n = (trie_node256_t *)node;
+            if (n->children[c]) return &n->children[c];
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Leftmost leaf below a node (any leaf works for prefix checks)
+static trie_leaf_t *minimum(const trie_node_t *node) {
+    while (node && !IS_LEAF(node)) {
+        switch (node->type) {
+            case TRIE_NODE4:
+                node = ((const trie_node4_t *)node)->children[0];
+                break;
+            case TRIE_NODE16:
+                node = ((const trie_node16_t *)node)->children[0];
+                break;
+            case TRIE_NODE48: {
+                const trie_node48_t *n = (const trie_node48_t *)node;
+                int i = 0;
+                while (!n->index[i]) i++;
+                node = n->children[n->index[i] - 1];
+                break;
+            }
+            case TRIE_NODE256: {
+                const trie_node256_t *n = (const trie_node256_t *)node;
+                int i = 0;
+                while (!n->children[i]) i++;
+                node = n->children[i];
+                break;
+            }
+            default:
+                return NULL;
+        }
+    }
+    return node ? LEAF_RAW(node) : NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Prefix comparison
+ * --------------------------------------------------------------------------- */
+
+// Bytes of the inline prefix that match the key (optimistic: stops at
+// TRIE_MAX_PREFIX, the rest is verified against the leaf)
+static uint32_t check_prefix(const trie_node_t *node, const uint8_t *key,
+                             uint32_t key_len, uint32_t depth) {
+    uint32_t max = MIN(MIN(node->prefix_len, (uint32_t)TRIE_MAX_PREFIX), key_len - depth);
+    uint32_t i;
+    for (i = 0; i < max; i++) {
+        if (node->prefix[i] != key[depth + i]) return i;
+    }
+    return i;
+}
 
-    trie_node_t *current = trie->root;
-    while (*key) {
-        unsigned char index = (unsigned char)*key;
-        if (!current->children[index]) {
-            current->children[index] = create_node();
-            if (!current->children[index]) return false; // Allocation failed
+// Exact length of the matching prefix, reading past the inline bytes from a leaf
+static uint32_t prefix_mismatch(const trie_node_t *node, const uint8_t *key,
+                                uint32_t key_len, uint32_t depth) {
+    uint32_t max = MIN(MIN((uint32_t)TRIE_MAX_PREFIX, node->prefix_len), key_len - depth);
+    uint32_t i;
+    for (i = 0; i < max; i++) {
+        if (node->prefix[i] != key[depth + i]) return i;
+    }
+
+    if (node->prefix_len > TRIE_MAX_PREFIX) {
+        const trie_leaf_t *leaf = minimum(node);
+        max = MIN(leaf->key_len, key_len) - depth;
+        for (; i < max; i++) {
+            if (leaf->key[depth + i] != key[depth + i]) return i;
         }
-        current = current->children[index];
-        key++;
     }
-    current->data = data;
-    current->is_terminal = true;
+    return i;
+}
+
+static uint32_t common_prefix(const trie_leaf_t *a, const trie_leaf_t *b, uint32_t depth) {
+    uint32_t max = MIN(a->key_len, b->key_len) - depth;
+    uint32_t i;
+    for (i = 0; i < max; i++) {
+        if (a->key[depth + i] != b->key[depth + i]) return i;
+    }
+    return i;
+}
+
+/* ---------------------------------------------------------------------------
+ * Adding children (growing nodes as they fill)
+ * --------------------------------------------------------------------------- */
+
+static bool add_child(trie_node_t *node, trie_node_t **ref, uint8_t c, trie_node_t *child);
+
+static bool add_child256(trie_node256_t *n, uint8_t c, trie_node_t *child) {
+    n->n.num_children++;
+    n->children[c] = child;
     return true;
 }
 
-void *trie_search(trie_t *trie, const char *key) {
-    if (!trie || !trie->root || !key) return NULL;
+static bool add_child48(trie_node48_t *n, trie_node_t **ref, uint8_t c, trie_node_t *child) {
+    if (n->n.num_children < 48) {
+        int pos = 0;
+        while (n->children[pos]) pos++;
+        n->children[pos] = child;
+        n->index[c] = (uint8_t)(pos + 1);
+        n->n.num_children++;
+        return true;
+    }
+
+    trie_node256_t *grown = (trie_node256_t *)alloc_node(TRIE_NODE256);
+    if (!grown) return false;
+    for (int i = 0; i < 256; i++) {
+        if (n->index[i]) grown->children[i] = n->children[n->index[i] - 1];
+    }
+    copy_header(&grown->n, &n->n);
+    *ref = &grown->n;
+    free_node(&n->n);
+    return add_child256(grown, c, child);
+}
 
-    trie_node_t *current = trie->root;
-    while (*key) {
-        unsigned char index = (unsigned char)*key;
-        if (!current->children[index]) {
-            return NULL;
+static bool add_child16(trie_node16_t *n, trie_node_t **ref, uint8_t c, trie_node_t *child) {
+    if (n->n.num_children < 16) {
+        int pos = 0;
+        while (pos < n->n.num_children && n->keys[pos] < c) pos++;
+        for (int i = n->n.num_children; i > pos; i--) {
+            n->keys[i] = n->keys[i - 1];
+            n->children[i] = n->children[i - 1];
         }
-        current = current->children[index];
-        key++;
+        n->keys[pos] = c;
+        n->children[pos] = child;
+        n->n.num_children++;
+        return true;
     }
 
-    return current->is_terminal ? current->data : NULL;
+    trie_node48_t *grown = (trie_node48_t *)alloc_node(TRIE_NODE48);
+    if (!grown) return false;
+    for (int i = 0; i < n->n.num_children; i++) {
+        grown->children[i] = n->children[i];
+        grown->index[n->keys[i]] = (uint8_t)(i + 1);
+    }
+    copy_header(&grown->n, &n->n);
+    *ref = &grown->n;
+    free_node(&n->n);
+    return add_child48(grown, ref, c, child);
+}
+
+static bool add_child4(trie_node4_t *n, trie_node_t **ref, uint8_t c, trie_node_t *child) {
+    if (n->n.num_children < 4) {
+        int pos = 0;
+        while (pos < n->n.num_children && n->keys[pos] < c) pos++;
+        for (int i = n->n.num_children; i > pos; i--) {
+            n->keys[i] = n->keys[i - 1];
+            n->children[i] = n->children[i - 1];
+        }
+        n->keys[pos] = c;
+        n->children[pos] = child;
+        n->n.num_children++;
+        return true;
+    }
+
+    trie_node16_t *grown = (trie_node16_t *)alloc_node(TRIE_NODE16);
+    if (!grown) return false;
+    for (int i = 0; i < 4; i++) {
+        grown->keys[i] = n->keys[i];
+        grown->children[i] = n->children[i];
+    }
+    copy_header(&grown->n, &n->n);
+    *ref = &grown->n;
+    free_node(&n->n);
+    return add_child16(grown, ref, c, child);
 }
 
-static bool has_children(trie_node_t *node) {
-    for (int i = 0; i < TRIE_ALPHABET_SIZE; i++) {
-        if (node->children[i]) return true;
+static bool add_child(trie_node_t *node, trie_node_t **ref, uint8_t c, trie_node_t *child) {
+    switch (node->type) {
+        case TRIE_NODE4:   return add_child4((trie_node4_t *)node, ref, c, child);
+        case TRIE_NODE16:  return add_child16((trie_node16_t *)node, ref, c, child);
+        case TRIE_NODE48:  return add_child48((trie_node48_t *)node, ref, c, child);
+        case TRIE_NODE256: return add_child256((trie_node256_t *)node, c, child);
     }
     return false;
 }
 
-static bool remove_recursive(trie_node_t *node, const char *key) {
-    if (*key == '\0') {
-        if (node->is_terminal) {
-            node->is_terminal = false;
-            node->data = NULL;
-            return !has_children(node); // Return true if node should be deleted
+/* ---------------------------------------------------------------------------
+ * Insertion
+ * --------------------------------------------------------------------------- */
+
+// Returns 1 if a new key was added, 0 if an existing key was updated, -1 on
+// allocation failure
+static int insert_recursive(trie_node_t *node, trie_node_t **ref, const uint8_t *key,
+                            uint32_t key_len, void *data, uint32_t depth) {
+    if (!node) {
+        trie_leaf_t *leaf = make_leaf(key, key_len, data);
+        if (!leaf) return -1;
+        *ref = SET_LEAF(leaf);
+        return 1;
+    }
+
+    if (IS_LEAF(node)) {
+        trie_leaf_t *existing = LEAF_RAW(node);
+        if (leaf_matches(existing, key, key_len)) {
+            existing->data = data;
+            return 0;
+        }
+
+        // Split the leaf: a node4 holding both, with their common bytes as prefix
+        trie_leaf_t *leaf = make_leaf(key, key_len, data);
+        if (!leaf) return -1;
+        trie_node4_t *split = (trie_node4_t *)alloc_node(TRIE_NODE4);
+        if (!split) {
+            kfree(leaf);
+            return -1;
+        }
+
+        uint32_t common = common_prefix(existing, leaf, depth);
+        split->n.prefix_len = common;
+        for (uint32_t i = 0; i < MIN(common, (uint32_t)TRIE_MAX_PREFIX); i++) {
+            split->n.prefix[i] = key[depth + i];
         }
-        return false;
+        depth += common;
+        add_child4(split, ref, existing->key[depth], node);
+        add_child4(split, ref, leaf->key[depth], SET_LEAF(leaf));
+        *ref = &split->n;
+        return 1;
     }
 
-    unsigned char index = (unsigned char)*key;
-    if (!node->children[index]) return false;
+    if (node->prefix_len) {
+        uint32_t match = prefix_mismatch(node, key, key_len, depth);
+        if (match < node->prefix_len) {
+            // The key leaves this node's compressed path: split the path
+            trie_leaf_t *leaf = make_leaf(key, key_len, data);
+            if (!leaf) return -1;
+            trie_node4_t *split = (trie_node4_t *)alloc_node(TRIE_NODE4);
+            if (!split) {
+                kfree(leaf);
+                return -1;
+            }
+
+            split->n.prefix_len = match;
+            for (uint32_t i = 0; i < MIN(match, (uint32_t)TRIE_MAX_PREFIX); i++) {
+                split->n.prefix[i] = node->prefix[i];
+            }
 
-    if (remove_recursive(node->children[index], key + 1)) {
-        kfree(node->children[index]);
-        node->children[index] = NULL;
-        return !node->is_terminal && !has_children(node);
+            // The old node keeps whatever follows the mismatching byte
+            if (node->prefix_len <= TRIE_MAX_PREFIX) {
+                add_child4(split, ref, node->prefix[match], node);
+                node->prefix_len -= match + 1;
+                for (uint32_t i = 0; i < MIN(node->prefix_len, (uint32_t)TRIE_MAX_PREFIX); i++) {
+                    node->prefix[i] = node->prefix[match + 1 + i];
+                }
+            } else {
+                const trie_leaf_t *min = minimum(node);
+                add_child4(split, ref, min->key[depth + match], node);
+                node->prefix_len -= match + 1;
+                for (uint32_t i = 0; i < MIN(node->prefix_len, (uint32_t)TRIE_MAX_PREFIX); i++) {
+                    node->prefix[i] = min->key[depth + match + 1 + i];
+                }
+            }
+
+            add_child4(split, ref, key[depth + match], SET_LEAF(leaf));
+            *ref = &split->n;
+            return 1;
+        }
+        depth += node->prefix_len;
     }
 
-    return false;
+    trie_node_t **child = find_child(node, key[depth]);
+    if (child) {
+        return insert_recursive(*child, child, key, key_len, data, depth + 1);
+    }
+
+    trie_leaf_t *leaf = make_leaf(key, key_len, data);
+    if (!leaf) return -1;
+    if (!add_child(node, ref, key[depth], SET_LEAF(leaf))) {
+        kfree(leaf);
+        return -1;
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Removal (shrinking nodes as they empty)
+ * --------------------------------------------------------------------------- */
+
+static void remove_child256(trie_node256_t *n, trie_node_t **ref, uint8_t c) {
+    n->children[c] = NULL;
+    n->n.num_children--;
+
+    // Shrink with some hysteresis so one add/remove pair cannot thrash
+    if (n->n.num_children == 37) {
+        trie_node48_t *small = (trie_node48_t *)alloc_node(TRIE_NODE48);
+        if (!small) return;
+        copy_header(&small->n, &n->n);
+        int pos = 0;
+        for (int i = 0; i < 256; i++) {
+            if (n->children[i]) {
+                small->children[pos] = n->children[i];
+                small->index[i] = (uint8_t)(pos + 1);
+                pos++;
+            }
+        }
+        *ref = &small->n;
+        free_node(&n->n);
+    }
+}
+
+static void remove_child48(trie_node48_t *n, trie_node_t **ref, uint8_t c) {
+    int pos = n->index[c] - 1;
+    n->index[c] = 0;
+    n->children[pos] = NULL;
+    n->n.num_children--;
+
+    if (n->n.num_children == 12) {
+        trie_node16_t *small = (trie_node16_t *)alloc_node(TRIE_NODE16);
+        if (!small) return;
+        copy_header(&small->n, &n->n);
+        int count = 0;
+        for (int i = 0; i < 256; i++) {
+            if (n->index[i]) {
+                small->keys[count] = (uint8_t)i;
+                small->children[count] = n->children[n->index[i] - 1];
+                count++;
+            }
+        }
+        *ref = &small->n;
+        free_node(&n->n);
+    }
+}
+
+static void remove_child16(trie_node16_t *n, trie_node_t **ref, trie_node_t **slot) {
+    int pos = (int)(slot - n->children);
+    for (int i = pos; i + 1 < n->n.num_children; i++) {
+        n->keys[i] = n->keys[i + 1];
+        n->children[i] = n->children[i + 1];
+    }
+    n->n.num_children--;
+
+    if (n->n.num_children == 3) {
+        trie_node4_t *small = (trie_node4_t *)alloc_node(TRIE_NODE4);
+        if (!small) return;
+        copy_header(&small->n, &n->n);
+        for (int i = 0; i < 3; i++) {
+            small->keys[i] = n->keys[i];
+            small->children[i] = n->children[i];
+        }
+        *ref = &small->n;
+        free_node(&n->n);
+    }
+}
+
+static void remove_child4(trie_node4_t *n, trie_node_t **ref, trie_node_t **slot) {
+    int pos = (int)(slot - n->children);
+    for (int i = pos; i + 1 < n->n.num_children; i++) {
+        n->keys[i] = n->keys[i + 1];
+        n->children[i] = n->children[i + 1];
+    }
+    n->n.num_children--;
+
+    // A single remaining child absorbs this node into its prefix
+    if (n->n.num_children == 1) {
+        trie_node_t *child = n->children[0];
+        if (!IS_LEAF(child)) {
+            uint32_t prefix = n->n.prefix_len;
+            if (prefix < TRIE_MAX_PREFIX) {
+                n->n.prefix[prefix] = n->keys[0];
+            }
+            prefix++;
+            for (uint32_t i = 0; prefix < TRIE_MAX_PREFIX && i < child->prefix_len; i++, prefix++) {
+                n->n.prefix[prefix] = child->prefix[i];
+            }
+            for (uint32_t i = 0; i < MIN(prefix, (uint32_t)TRIE_MAX_PREFIX); i++) {
+                child->prefix[i] = n->n.prefix[i];
+            }
+            child->prefix_len += n->n.prefix_len + 1;
+        }
+        *ref = child;
+        free_node(&n->n);
+    }
+}
+
+static void remove_child(trie_node_t *node, trie_node_t **ref, uint8_t c, trie_node_t **slot) {
+    switch (node->type) {
+        case TRIE_NODE4:   remove_child4((trie_node4_t *)node, ref, slot); break;
+        case TRIE_NODE16:  remove_child16((trie_node16_t *)node, ref, slot); break;
+        case TRIE_NODE48:  remove_child48((trie_node48_t *)node, ref, c); break;
+        case TRIE_NODE256: remove_child256((trie_node256_t *)node, ref, c); break;
+    }
+}
+
+static trie_leaf_t *remove_recursive(trie_node_t *node, trie_node_t **ref, const uint8_t *key,
+                                     uint32_t key_len, uint32_t depth) {
+    if (!node) return NULL;
+
+    if (IS_LEAF(node)) {
+        trie_leaf_t *leaf = LEAF_RAW(node);
+        if (leaf_matches(leaf, key, key_len)) {
+            *ref = NULL;
+            return leaf;
+        }
+        return NULL;
+    }
+
+    if (node->prefix_len) {
+        uint32_t match = check_prefix(node, key, key_len, depth);
+        if (match != MIN((uint32_t)TRIE_MAX_PREFIX, node->prefix_len)) return NULL;
+        depth += node->prefix_len;
+        if (depth >= key_len) return NULL;
+    }
+
+    trie_node_t **child = find_child(node, key[depth]);
+    if (!child) return NULL;
+
+    if (IS_LEAF(*child)) {
+        trie_leaf_t *leaf = LEAF_RAW(*child);
+        if (!leaf_matches(leaf, key, key_len)) return NULL;
+        remove_child(node, ref, key[depth], child);
+        return leaf;
+    }
+    return remove_recursive(*child, child, key, key_len, depth + 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * Public API
+ * --------------------------------------------------------------------------- */
+
+void trie_init(trie_t *trie) {
+    if (!trie) return;
+    trie->root = NULL;
+    trie->size = 0;
+}
+
+bool trie_insert(trie_t *trie, const char *key, void *data) {
+    if (!trie || !key) return false;
+
+    uint32_t key_len = (uint32_t)strlen(key) + 1;
+    int added = insert_recursive(trie->root, &trie->root, (const uint8_t *)key, key_len, data, 0);
+    if (added < 0) return false; // Allocation failed
+    if (added) trie->size++;
+    return true;
+}
+
+void *trie_search(trie_t *trie, const char *key) {
+    if (!trie || !key) return NULL;
+
+    const uint8_t *bytes = (const uint8_t *)key;
+    uint32_t key_len = (uint32_t)strlen(key) + 1;
+    trie_node_t *node = trie->root;
+    uint32_t depth = 0;
+
+    while (node) {
+        if (IS_LEAF(node)) {
+            // Skipped prefix bytes are only verified here
+            trie_leaf_t *leaf = LEAF_RAW(node);
+            return leaf_matches(leaf, bytes, key_len) ? leaf->data : NULL;
+        }
+
+        if (node->prefix_len) {
+            uint32_t match = check_prefix(node, bytes, key_len, depth);
+            if (match != MIN((uint32_t)TRIE_MAX_PREFIX, node->prefix_len)) return NULL;
+            depth += node->prefix_len;
+            if (depth >= key_len) return NULL;
+        }
+
+        trie_node_t **child = find_child(node, bytes[depth]);
+        node = child ? *child : NULL;
+        depth++;
+    }
+    return NULL;
 }
 
 bool trie_remove(trie_t *trie, const char *key) {
-    if (!trie || !trie->root || !key) return false;
-    return remove_recursive(trie->root, key); // Note: Root is never deleted
+    if (!trie || !key) return false;
+
+    uint32_t key_len = (uint32_t)strlen(key) + 1;
+    trie_leaf_t *leaf = remove_recursive(trie->root, &trie->root, (const uint8_t *)key, key_len, 0);
+    if (!leaf) return false;
+
+    kfree(leaf);
+    trie->size--;
+    return true;
+}
+
+size_t trie_size(const trie_t *trie) {
+    return trie ? trie->size : 0;
 }
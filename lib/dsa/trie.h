@@ -11,18 +11,34 @@
  *
  * This header defines a generic Trie data structure, optimized for string keys.
  * It is useful for tasks like file indexing, autocomplete, or symbol tables.
+ *
+ * The trie is an adaptive radix tree (ART): inner nodes grow through four
+ * sizes (4, 16, 48 and 256 children) as needed, and chains of single-child
+ * nodes are collapsed into a prefix stored in the node below them. Memory use
+ * follows the number of distinct key bytes instead of 256 pointers per byte,
+ * and a lookup visits one small node per branching point.
  */
 
-#define TRIE_ALPHABET_SIZE 256
+/* Prefix bytes kept inline per node; longer prefixes are checked at the leaf */
+#define TRIE_MAX_PREFIX 10
+
+/* Inner node types */
+#define TRIE_NODE4      1
+#define TRIE_NODE16     2
+#define TRIE_NODE48     3
+#define TRIE_NODE256    4
 
+/* Header shared by every inner node type */
 typedef struct trie_node {
-    struct trie_node *children[TRIE_ALPHABET_SIZE];
-    void *data; // NULL if not a terminal node (or if no data associated)
-    bool is_terminal;
+    uint8_t type;                       // TRIE_NODE*
+    uint16_t num_children;
+    uint32_t prefix_len;                // Full length of the compressed path
+    uint8_t prefix[TRIE_MAX_PREFIX];    // First bytes of that path
 } trie_node_t;
 
 typedef struct trie {
-    trie_node_t *root;
+    trie_node_t *root;                  // Inner node or tagged leaf, NULL if empty
+    size_t size;                        // Number of keys stored
 } trie_t;
 
 /* Initialize a trie */
@@ -37,4 +53,7 @@ void *trie_search(trie_t *trie, const char *key);
 /* Remove a key */
 bool trie_remove(trie_t *trie, const char *key);
 
+/* Number of keys stored */
+size_t trie_size(const trie_t *trie);
+
 #endif /* NEXA_TRIE_H */
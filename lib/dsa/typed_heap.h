@@ -0,0 +1,144 @@
+#ifndef NEXA_TYPED_HEAP_H
+#define NEXA_TYPED_HEAP_H
+
+#include "../../config/os_config.h"
+
+/*
+ * lib/dsa/typed_heap.h
+ *
+ * Type-Specialized Binary Heap
+ *
+ * DEFINE_HEAP(name, type, less) generates a binary min-heap of 'type'
+ * values with the comparison inlined: less(a, b) is any expression or
+ * macro that is true when a must come out before b. Unlike heap_t there is
+ * no void * boxing and no call through a comparator pointer per sift.
+ *
+ * DEFINE_HEAP_INDEXED(name, type, less, set_index) also calls
+ * set_index(item, i) whenever an item lands in slot i (and with
+ * HEAP_NOT_QUEUED when it leaves), so the items can carry their own
+ * position and name##_remove_at()/name##_fix() need no search.
+ *
+ * Generated (all static inline, storage supplied by the caller):
+ *   name##_t                                   heap handle
+ *   void  name##_init(h, type *storage, size_t capacity)
+ *   bool  name##_push(h, type item)            false if full
+ *   bool  name##_pop(h, type *out)             false if empty
+ *   type *name##_peek(h)                       NULL if empty
+ *   void  name##_remove_at(h, size_t i)
+ *   void  name##_fix(h, size_t i)              after item i's key changed
+ *   size_t name##_count(h)
+ */
+
+#define HEAP_NOT_QUEUED     (-1)
+
+/* set_index for heaps whose items do not track their slot */
+#define HEAP_NO_INDEX(item, i)  ((void)0)
+
+#define DEFINE_HEAP(name, type, less) \
+    DEFINE_HEAP_INDEXED(name, type, less, HEAP_NO_INDEX)
+
+#define DEFINE_HEAP_INDEXED(name, type, less, set_index)                        \
+typedef struct name {                                                           \
+    type *items;                                                                \
+    size_t size;                                                                \
+    size_t capacity;                                                            \
+} name##_t;                                                                     \
+                                                                                \
+static inline void name##_init(name##_t *h, type *storage, size_t capacity)     \
+{                                                                               \
+    h->items = storage;                                                         \
+    h->size = 0;                                                                \
+    h->capacity = capacity;                                                     \
+}                                                                               \
+                                                                                \
+static inline size_t name##_count(const name##_t *h)                            \
+{                                                                               \
+    return h->size;                                                             \
+}                                                                               \
+                                                                                \
+/* Move the item at i towards the root while it beats its parent */           \
+static inline void name##_sift_up(name##_t *h, size_t i)                        \
+{                                                                               \
+    type item = h->items[i];                                                    \
+    while (i > 0) {                                                             \
+        size_t parent = (i - 1) / 2;                                            \
+        if (!(less(item, h->items[parent]))) {                                  \
+            break;                                                              \
+        }                                                                       \
+        h->items[i] = h->items[parent];                                         \
+        set_index(h->items[i], (int)i);                                         \
+        i = parent;                                                             \
+    }                                                                           \
+    h->items[i] = item;                                                         \
+    set_index(item, (int)i);                                                    \
+}                                                                               \
+                                                                                \
+/* Move the item at i towards the leaves while a child beats it */            \
+static inline void name##_sift_down(name##_t *h, size_t i)                      \
+{                                                                               \
+    type item = h->items[i];                                                    \
+    for (;;) {                                                                  \
+        size_t child = 2 * i + 1;                                               \
+        if (child >= h->size) {                                                 \
+            break;                                                              \
+        }                                                                       \
+        if (child + 1 < h->size && less(h->items[child + 1], h->items[child])) {\
+            child++;                                                            \
+        }                                                                       \
+        if (!(less(h->items[child], item))) {                                   \
+            break;                                                              \
+        }                                                                       \
+        h->items[i] = h->items[child];                                          \
+        set_index(h->items[i], (int)i);                                         \
+        i = child;                                                              \
+    }                                                                           \
+    h->items[i] = item;                                                         \
+    set_index(item, (int)i);                                                    \
+}                                                                               \
+                                                                                \
+static inline void name##_fix(name##_t *h, size_t i)                            \
+{                                                                               \
+    if (i > 0 && less(h->items[i], h->items[(i - 1) / 2])) {                    \
+        name##_sift_up(h, i);                                                   \
+    } else {                                                                    \
+        name##_sift_down(h, i);                                                 \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline bool name##_push(name##_t *h, type item)                          \
+{                                                                               \
+    if (h->size >= h->capacity) {                                               \
+        return false;                                                           \
+    }                                                                           \
+    h->items[h->size++] = item;                                                 \
+    name##_sift_up(h, h->size - 1);                                             \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+static inline type *name##_peek(name##_t *h)                                    \
+{                                                                               \
+    return h->size > 0 ? &h->items[0] : NULL;                                   \
+}                                                                               \
+                                                                                \
+static inline void name##_remove_at(name##_t *h, size_t i)                      \
+{                                                                               \
+    set_index(h->items[i], HEAP_NOT_QUEUED);                                    \
+    if (--h->size > i) {                                                        \
+        h->items[i] = h->items[h->size];                                        \
+        name##_fix(h, i);                                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline bool name##_pop(name##_t *h, type *out)                           \
+{                                                                               \
+    if (h->size == 0) {                                                         \
+        return false;                                                           \
+    }                                                                           \
+    if (out != NULL) {                                                          \
+        *out = h->items[0];                                                     \
+    }                                                                           \
+    name##_remove_at(h, 0);                                                     \
+    return true;                                                                \
+}
+
+#endif /* NEXA_TYPED_HEAP_H */
@@ -0,0 +1,104 @@
+#ifndef NEXA_TYPED_RING_H
+#define NEXA_TYPED_RING_H
+
+#include "../../config/os_config.h"
+
+/*
+ * lib/dsa/typed_ring.h
+ *
+ * Type-Specialized Ring Buffer
+ *
+ * DEFINE_RING(name, type, cap) generates a FIFO of at most 'cap' values of
+ * 'type', stored inline in the ring. 'cap' must be a power of two: head and
+ * tail run freely and are reduced with a mask instead of '%', and
+ * tail - head is the item count even after the counters wrap. Unlike
+ * queue_t there is no void * boxing and no allocation.
+ *
+ * Generated (all static inline):
+ *   name##_t                                   ring with inline storage
+ *   void   name##_init(r)
+ *   bool   name##_push(r, type item)           false if full
+ *   bool   name##_pop(r, type *out)            false if empty (out may be NULL)
+ *   type  *name##_front(r) / name##_back(r)    oldest / newest, NULL if empty
+ *   type  *name##_at(r, uint32_t i)            i-th item from the front
+ *   void   name##_remove_at(r, uint32_t i)     keeps the order of the rest
+ *   uint32_t name##_count(r), bool name##_empty(r), bool name##_full(r)
+ */
+
+#define DEFINE_RING(name, type, cap)                                            \
+_Static_assert(((cap) & ((cap) - 1)) == 0 && (cap) > 0,                         \
+               #name ": capacity must be a power of two");                      \
+                                                                                \
+typedef struct name {                                                           \
+    type items[cap];                                                            \
+    uint32_t head;                  /* Oldest item (free-running) */            \
+    uint32_t tail;                  /* Next free slot (free-running) */         \
+} name##_t;                                                                     \
+                                                                                \
+static inline void name##_init(name##_t *r)                                     \
+{                                                                               \
+    r->head = 0;                                                                \
+    r->tail = 0;                                                                \
+}                                                                               \
+                                                                                \
+static inline uint32_t name##_count(const name##_t *r)                          \
+{                                                                               \
+    return r->tail - r->head;                                                   \
+}                                                                               \
+                                                                                \
+static inline bool name##_empty(const name##_t *r)                              \
+{                                                                               \
+    return r->tail == r->head;                                                  \
+}                                                                               \
+                                                                                \
+static inline bool name##_full(const name##_t *r)                               \
+{                                                                               \
+    return r->tail - r->head == (cap);                                          \
+}                                                                               \
+                                                                                \
+static inline type *name##_at(name##_t *r, uint32_t i)                          \
+{                                                                               \
+    return &r->items[(r->head + i) & ((cap) - 1)];                              \
+}                                                                               \
+                                                                                \
+static inline type *name##_front(name##_t *r)                                   \
+{                                                                               \
+    return name##_empty(r) ? NULL : name##_at(r, 0);                            \
+}                                                                               \
+                                                                                \
+static inline type *name##_back(name##_t *r)                                    \
+{                                                                               \
+    return name##_empty(r) ? NULL : &r->items[(r->tail - 1) & ((cap) - 1)];     \
+}                                                                               \
+                                                                                \
+static inline bool name##_push(name##_t *r, type item)                          \
+{                                                                               \
+    if (name##_full(r)) {                                                       \
+        return false;                                                           \
+    }                                                                           \
+    r->items[r->tail++ & ((cap) - 1)] = item;                                   \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+static inline bool name##_pop(name##_t *r, type *out)                           \
+{                                                                               \
+    if (name##_empty(r)) {                                                      \
+        return false;                                                           \
+    }                                                                           \
+    if (out != NULL) {                                                          \
+        *out = r->items[r->head & ((cap) - 1)];                                 \
+    }                                                                           \
+    r->head++;                                                                  \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+static inline void name##_remove_at(name##_t *r, uint32_t i)                    \
+{                                                                               \
+    uint32_t count = name##_count(r);                                           \
+    for (; i + 1 < count; i++) {                                                \
+        *name##_at(r, i) = *name##_at(r, i + 1);                                \
+    }                                                                           \
+    r->tail--;                                                                  \
+}
+
+#endif /* NEXA_TYPED_RING_H */
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+# ===========================================================================
+# scripts/profile_symbolize.py
+# ===========================================================================
+#
+# Symbolize a NexaKernel profile dump
+#
+# Reads a serial log containing the output of the shell's "profile dump"
+# (PROFILE-START / PROFILE / PROFILE-DONE lines, see kernel/utils/profile.h),
+# maps each sampled EIP to the kernel function containing it using the
+# symbol table of build/kernel.elf, and prints one of:
+#
+#   folded stacks "pid 3;schedule 42" (default), for flamegraph.pl or
+#   speedscope; the two levels are task and function
+#
+#   a flat table of the hottest functions (--top N)
+#
+# Usage:
+#   ./scripts/profile_symbolize.py serial.log > profile.folded
+#   ./scripts/profile_symbolize.py --top 20 serial.log
+#   ./scripts/profile_symbolize.py --elf build/kernel.elf < serial.log
+#
+# Environment:
+#   NM   nm to use (default: nm; i686-elf-nm for cross toolchains)
+#
+# ===========================================================================
+
+import argparse
+import bisect
+import collections
+import os
+import subprocess
+import sys
+
+
+def load_symbols(elf):
+    nm = os.environ.get("NM", "nm")
+    out = subprocess.run([nm, "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[1] in "TtWw":
+            addrs.append(int(fields[0], 16))
+            names.append(fields[2])
+    return addrs, names
+
+
+def parse(lines):
+    hz, samples, dropped = 0, 0, 0
+    entries = []
+    for line in lines:
+        fields = line.strip().split()
+        if not fields:
+            continue
+        if fields[0] == "PROFILE-START":
+            opts = dict(f.split("=", 1) for f in fields[1:] if "=" in f)
+            hz = int(opts.get("hz", "0"))
+            samples = int(opts.get("samples", "0"))
+            dropped = int(opts.get("dropped", "0"))
+            entries = []
+        elif fields[0] == "PROFILE" and len(fields) == 5:
+            pid, eip, mode, count = fields[1:]
+            entries.append((int(pid), int(eip, 16), mode, int(count)))
+    return hz, samples, dropped, entries
+
+
+def symbolize(addrs, names, eip, mode):
+    if mode == "u":
+        return "[user]"
+    i = bisect.bisect_right(addrs, eip) - 1
+    return names[i] if i >= 0 else "0x%08x" % eip
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolize a NexaKernel profile dump")
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("--elf", default="build/kernel.elf", help="kernel image with symbols")
+    parser.add_argument("--top", type=int, metavar="N", help="print the N hottest functions")
+    args = parser.parse_args()
+
+    source = open(args.log, errors="replace") if args.log else sys.stdin
+    hz, samples, dropped, entries = parse(source)
+    if not entries:
+        sys.exit("no PROFILE records found")
+    addrs, names = load_symbols(args.elf)
+
+    folded = collections.Counter()
+    flat = collections.Counter()
+    for pid, eip, mode, count in entries:
+        func = symbolize(addrs, names, eip, mode)
+        folded["pid %d;%s" % (pid, func)] += count
+        flat[func] += count
+
+    if args.top:
+        print("%u samples at %u Hz, %u dropped" % (samples, hz, dropped))
+        print("%8s %6s  %s" % ("samples", "%", "function"))
+        for func, count in flat.most_common(args.top):
+            print("%8u %5.1f%%  %s" % (count, 100.0 * count / max(samples, 1), func))
+    else:
+        for stack, count in sorted(folded.items()):
+            print("%s %u" % (stack, count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# ===========================================================================
+# scripts/trace_to_chrome.py
+# ===========================================================================
+#
+# Convert a NexaKernel trace dump into Chrome trace JSON
+#
+# Reads a serial log containing the output of the shell's "trace dump"
+# (TRACE-START / TRACE / TRACE-DONE lines, see kernel/utils/trace.h) and
+# writes a JSON file that chrome://tracing and ui.perfetto.dev can open.
+#
+# One timeline row per task: switch events tell which pid runs on each
+# CPU. IRQs and system calls become slices, everything else an instant.
+#
+# Usage:
+#   ./scripts/trace_to_chrome.py serial.log > trace.json
+#   ./scripts/trace_to_chrome.py < serial.log > trace.json
+#
+# ===========================================================================
+
+import json
+import sys
+
+SLICES = {
+    "irq_enter": ("B", "irq"),
+    "irq_exit": ("E", "irq"),
+    "syscall_enter": ("B", "syscall"),
+    "syscall_exit": ("E", "syscall"),
+}
+
+ARG_NAMES = {
+    "schedule": ("pid", "ready"),
+    "switch": ("from", "to"),
+    "irq_enter": ("irq", None),
+    "irq_exit": ("irq", None),
+    "syscall_enter": ("nr", "arg1"),
+    "syscall_exit": ("nr", "result"),
+    "kmalloc": ("size", "ptr"),
+    "kfree": ("ptr", None),
+    "msgq_send": ("qid", "size"),
+    "msgq_receive": ("qid", "result"),
+}
+
+
+def parse(lines):
+    khz = 0
+    records = []
+    for line in lines:
+        fields = line.strip().split()
+        if not fields:
+            continue
+        if fields[0] == "TRACE-START":
+            opts = dict(f.split("=", 1) for f in fields[1:] if "=" in f)
+            khz = int(opts.get("khz", "0"))
+            records = []
+        elif fields[0] == "TRACE" and len(fields) == 6:
+            cpu, tsc, event, arg0, arg1 = fields[1:]
+            records.append((int(tsc, 16), int(cpu), event, int(arg0, 16), int(arg1, 16)))
+    records.sort()
+    return khz, records
+
+
+def convert(khz, records):
+    # Without a calibrated TSC, show raw cycles as microseconds
+    cycles_per_us = khz / 1000.0 if khz else 1.0
+    base = records[0][0] if records else 0
+    running = {}        # cpu -> pid
+    events = []
+
+    for tsc, cpu, event, arg0, arg1 in records:
+        if event == "switch":
+            running[cpu] = arg1
+        names = ARG_NAMES.get(event, ("arg0", "arg1"))
+        args = {names[0]: arg0}
+        if names[1] is not None:
+            args[names[1]] = arg1
+
+        phase, name = SLICES.get(event, ("i", event))
+        if phase != "i":
+            name = "%s %d" % (name, arg0)
+        entry = {
+            "name": name,
+            "cat": event.split("_")[0],
+            "ph": phase,
+            "ts": (tsc - base) / cycles_per_us,
+            "pid": cpu,
+            "tid": running.get(cpu, 0),
+            "args": args,
+        }
+        if phase == "i":
+            entry["s"] = "t"
+        events.append(entry)
+
+    for cpu in sorted({r[1] for r in records}):
+        events.append({"name": "process_name", "ph": "M", "pid": cpu,
+                       "args": {"name": "CPU %d" % cpu}})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    source = open(sys.argv[1], errors="replace") if len(sys.argv) > 1 else sys.stdin
+    khz, records = parse(source)
+    if not records:
+        sys.exit("no TRACE records found")
+    json.dump(convert(khz, records), sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
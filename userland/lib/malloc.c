@@ -0,0 +1,557 @@
+/*
+ * ===========================================================================
+ * userland/lib/malloc.c
+ * ===========================================================================
+ *
+ * User-Space Memory Allocator (malloc, free, calloc, realloc)
+ *
+ * Small requests (up to MALLOC_SMALL_MAX bytes) are rounded up to one of
+ * a fixed set of size classes and carved out of spans: SPAN_SIZE-aligned
+ * blocks taken from the sbrk heap, each holding objects of a single class.
+ * A span's header lives at its start, so free() finds it by masking the
+ * pointer, and small objects carry no header of their own.
+ *
+ * Larger requests get their own anonymous mmap, with a short header that
+ * records the mapping length; free() unmaps them straight away.
+ *
+ * Layers (fast path first):
+ *
+ *   thread cache   per-class stack of free objects, no lock, no syscall
+ *        |         refilled / flushed in batches of half its limit
+ *   central bins   per-class list of spans with free objects (malloc_lock)
+ *        |
+ *   span heap      whole free spans; free spans at the top of the heap are
+ *                  given back with a negative sbrk
+ *
+ * NexaKernel runs one thread per user address space, so this_cache()
+ * returns a single cache. It is the only place that changes once tasks
+ * can share an address space. The central layers already take
+ * malloc_lock (a futex-backed umutex) and are ready for that.
+ *
+ * ===========================================================================
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---------------------------------------------------------------------------
+ * From syscall_wrappers.c
+ * --------------------------------------------------------------------------- */
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define MAP_PRIVATE     0x2
+#define MAP_ANONYMOUS   0x20
+#define MAP_FAILED      ((void *)-1)
+
+typedef struct {
+    volatile unsigned int state;
+} umutex_t;
+
+#define UMUTEX_INIT     { 0 }
+
+extern void *sbrk(int increment);
+extern void *mmap(size_t length, int prot, int flags, int fd, size_t offset);
+extern int munmap(void *addr, size_t length);
+extern int write(int fd, const void *buf, size_t count);
+extern void exit(int status);
+extern void umutex_lock(umutex_t *m);
+extern void umutex_unlock(umutex_t *m);
+
+/* ---------------------------------------------------------------------------
+ * Configuration
+ * --------------------------------------------------------------------------- */
+#define MALLOC_ALIGN        16
+#define MALLOC_SMALL_MAX    8192            /* Larger requests are mmapped */
+#define SPAN_SIZE           0x10000         /* 64KB, also the span alignment */
+#define SPAN_HEADER         32              /* sizeof(span_t), rounded to MALLOC_ALIGN */
+#define TCACHE_MAX          32              /* Objects cached per class at most */
+#define TCACHE_BYTES        32768           /* ...and bytes cached per class */
+#define TRIM_KEEP_SPANS     1               /* Free top-of-heap spans kept for reuse */
+
+#define SPAN_MAGIC          0x5350414Eu     /* "SPAN" */
+#define LARGE_MAGIC         0x4C415247u     /* "LARG" */
+#define PAGE_SIZE           4096
+
+#define ALIGN_UP(x, a)      (((x) + (a) - 1) & ~((uintptr_t)(a) - 1))
+
+/* Object sizes of the small classes */
+static const uint16_t class_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 256, 320, 384, 512, 640, 768,
+    1024, 1280, 1536, 2048, 3072, 4096, 6144, 8192,
+};
+
+#define NUM_CLASSES         (sizeof(class_sizes) / sizeof(class_sizes[0]))
+
+/* ---------------------------------------------------------------------------
+ * Structures
+ * --------------------------------------------------------------------------- */
+
+/* Free object: the first word links it into a free list */
+typedef struct free_object {
+    struct free_object *next;
+} free_object_t;
+
+#define SPAN_STATE_FREE     0               /* On free_spans, no class */
+#define SPAN_STATE_PARTIAL  1               /* On partial[class], has free objects */
+#define SPAN_STATE_FULL     2               /* On no list */
+
+typedef struct span {
+    uint32_t magic;
+    uint16_t size_class;
+    uint16_t state;                         /* SPAN_STATE_* */
+    uint32_t live;                          /* Objects handed out (incl. cached) */
+    uint32_t bump;                          /* Offset of the first never-used byte */
+    free_object_t *free_list;               /* Objects returned to this span */
+    struct span *prev;
+    struct span *next;
+} span_t;
+
+_Static_assert(sizeof(span_t) <= SPAN_HEADER, "span header overlaps the first object");
+
+/* Header in front of a large block; the user pointer follows it */
+typedef struct large_header {
+    uint32_t magic;
+    uint32_t length;                        /* Whole mapping, for munmap */
+    uint32_t reserved[2];                   /* Keeps the payload 16-aligned */
+} large_header_t;
+
+typedef struct thread_cache {
+    free_object_t *head[NUM_CLASSES];
+    uint32_t count[NUM_CLASSES];
+} thread_cache_t;
+
+/* ---------------------------------------------------------------------------
+ * State
+ * --------------------------------------------------------------------------- */
+static umutex_t malloc_lock = UMUTEX_INIT;
+
+static span_t *partial[NUM_CLASSES];        /* Spans with free objects, per class */
+static span_t *free_spans;                  /* Empty spans, any class may take one */
+static uintptr_t heap_lo;                   /* First span (0 before the first sbrk) */
+static uintptr_t heap_hi;                   /* End of the last span */
+
+static thread_cache_t thread_cache;
+
+static thread_cache_t *this_cache(void)
+{
+    return &thread_cache;
+}
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * --------------------------------------------------------------------------- */
+static void malloc_abort(const char *message)
+{
+    size_t len = 0;
+    while (message[len] != '\0') {
+        len++;
+    }
+    write(2, "malloc: ", 8);
+    write(2, message, len);
+    write(2, "\n", 1);
+    exit(127);
+}
+
+static void mem_set(void *dest, int value, size_t n)
+{
+    uint8_t *d = dest;
+    while (n--) {
+        *d++ = (uint8_t)value;
+    }
+}
+
+static void mem_copy(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    while (n--) {
+        *d++ = *s++;
+    }
+}
+
+/* Smallest class that fits size (size <= MALLOC_SMALL_MAX) */
+static uint32_t size_to_class(size_t size)
+{
+    if (size <= 128) {
+        return (size == 0) ? 0 : (uint32_t)((size + 15) / 16 - 1);
+    }
+    uint32_t cls = 8;
+    while (class_sizes[cls] < size) {
+        cls++;
+    }
+    return cls;
+}
+
+/* Objects a thread cache keeps for a class before flushing */
+static uint32_t cache_limit(uint32_t cls)
+{
+    uint32_t limit = TCACHE_BYTES / class_sizes[cls];
+    if (limit > TCACHE_MAX) {
+        limit = TCACHE_MAX;
+    }
+    return (limit < 2) ? 2 : limit;
+}
+
+static int is_small(const void *ptr)
+{
+    return (uintptr_t)ptr >= heap_lo && (uintptr_t)ptr < heap_hi;
+}
+
+static span_t *span_of(const void *ptr)
+{
+    span_t *span = (span_t *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1));
+    if (span->magic != SPAN_MAGIC || span->state == SPAN_STATE_FREE) {
+        malloc_abort("free of an invalid pointer");
+    }
+    return span;
+}
+
+/* ---------------------------------------------------------------------------
+ * Span Lists (malloc_lock held)
+ * --------------------------------------------------------------------------- */
+static void list_push(span_t **head, span_t *span)
+{
+    span->prev = NULL;
+    span->next = *head;
+    if (*head != NULL) {
+        (*head)->prev = span;
+    }
+    *head = span;
+}
+
+static void list_unlink(span_t **head, span_t *span)
+{
+    if (span->prev != NULL) {
+        span->prev->next = span->next;
+    } else {
+        *head = span->next;
+    }
+    if (span->next != NULL) {
+        span->next->prev = span->prev;
+    }
+    span->prev = span->next = NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Span Heap (malloc_lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Take a free span, growing the heap by one span if there is none */
+static span_t *span_alloc(void)
+{
+    span_t *span = free_spans;
+    if (span != NULL) {
+        list_unlink(&free_spans, span);
+        return span;
+    }
+
+    /* The first span (or one after a foreign sbrk) needs padding to align */
+    uintptr_t brk = (uintptr_t)sbrk(0);
+    if (brk == (uintptr_t)-1) {
+        return NULL;
+    }
+    uintptr_t start = ALIGN_UP(brk, SPAN_SIZE);
+    if (sbrk((int)(start - brk + SPAN_SIZE)) == (void *)-1) {
+        return NULL;
+    }
+
+    if (heap_lo == 0) {
+        heap_lo = start;
+    }
+    heap_hi = start + SPAN_SIZE;
+
+    span = (span_t *)start;
+    span->magic = SPAN_MAGIC;
+    return span;
+}
+
+/* Give free spans at the top of the heap back to the kernel, keeping 'keep' */
+static void heap_trim(uint32_t keep)
+{
+    uint32_t run = 0;
+    for (uintptr_t s = heap_hi; s > heap_lo; s -= SPAN_SIZE) {
+        span_t *span = (span_t *)(s - SPAN_SIZE);
+        if (span->magic != SPAN_MAGIC || span->state != SPAN_STATE_FREE) {
+            break;
+        }
+        run++;
+    }
+
+    /* Only while nobody else has moved the break past the heap */
+    while (run > keep && (uintptr_t)sbrk(0) == heap_hi) {
+        span_t *top = (span_t *)(heap_hi - SPAN_SIZE);
+        list_unlink(&free_spans, top);
+        top->magic = 0;
+        if (sbrk(-SPAN_SIZE) == (void *)-1) {
+            top->magic = SPAN_MAGIC;
+            list_push(&free_spans, top);
+            return;
+        }
+        heap_hi -= SPAN_SIZE;
+        run--;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Central Bins (malloc_lock held)
+ * --------------------------------------------------------------------------- */
+
+/* Take one object of a class, or NULL when out of memory */
+static void *central_alloc(uint32_t cls)
+{
+    span_t *span = partial[cls];
+    if (span == NULL) {
+        span = span_alloc();
+        if (span == NULL) {
+            return NULL;
+        }
+        span->size_class = (uint16_t)cls;
+        span->state = SPAN_STATE_PARTIAL;
+        span->live = 0;
+        span->bump = SPAN_HEADER;
+        span->free_list = NULL;
+        list_push(&partial[cls], span);
+    }
+
+    void *object;
+    if (span->free_list != NULL) {
+        object = span->free_list;
+        span->free_list = span->free_list->next;
+    } else {
+        object = (uint8_t *)span + span->bump;
+        span->bump += class_sizes[cls];
+    }
+    span->live++;
+
+    if (span->free_list == NULL && span->bump + class_sizes[cls] > SPAN_SIZE) {
+        list_unlink(&partial[cls], span);
+        span->state = SPAN_STATE_FULL;
+    }
+    return object;
+}
+
+/* Return one object to its span */
+static void central_free(void *object)
+{
+    span_t *span = span_of(object);
+    uint32_t cls = span->size_class;
+
+    ((free_object_t *)object)->next = span->free_list;
+    span->free_list = object;
+    span->live--;
+
+    if (span->state == SPAN_STATE_FULL) {
+        span->state = SPAN_STATE_PARTIAL;
+        list_push(&partial[cls], span);
+    }
+    if (span->live == 0) {
+        list_unlink(&partial[cls], span);
+        span->state = SPAN_STATE_FREE;
+        list_push(&free_spans, span);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Thread Cache
+ * --------------------------------------------------------------------------- */
+
+/* Move up to n objects of a class from the cache to the central bins */
+static void cache_flush(thread_cache_t *cache, uint32_t cls, uint32_t n)
+{
+    umutex_lock(&malloc_lock);
+    while (n-- > 0 && cache->head[cls] != NULL) {
+        free_object_t *object = cache->head[cls];
+        cache->head[cls] = object->next;
+        cache->count[cls]--;
+        central_free(object);
+    }
+    heap_trim(TRIM_KEEP_SPANS);
+    umutex_unlock(&malloc_lock);
+}
+
+/* Fill half the cache for a class and return one more object */
+static void *cache_refill(thread_cache_t *cache, uint32_t cls)
+{
+    uint32_t batch = cache_limit(cls) / 2;
+
+    umutex_lock(&malloc_lock);
+    void *result = central_alloc(cls);
+    for (uint32_t i = 0; result != NULL && i < batch; i++) {
+        free_object_t *object = central_alloc(cls);
+        if (object == NULL) {
+            break;
+        }
+        object->next = cache->head[cls];
+        cache->head[cls] = object;
+        cache->count[cls]++;
+    }
+    umutex_unlock(&malloc_lock);
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * Large Blocks
+ * --------------------------------------------------------------------------- */
+static void *large_alloc(size_t size)
+{
+    if (size > 0xFFFFFFFFu - sizeof(large_header_t) - PAGE_SIZE) {
+        return NULL;
+    }
+    size_t length = ALIGN_UP(size + sizeof(large_header_t), PAGE_SIZE);
+
+    large_header_t *header = mmap(length, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (header == MAP_FAILED) {
+        return NULL;
+    }
+    header->magic = LARGE_MAGIC;
+    header->length = (uint32_t)length;
+    return header + 1;
+}
+
+static large_header_t *large_header(void *ptr)
+{
+    large_header_t *header = (large_header_t *)ptr - 1;
+    if (((uintptr_t)header & (PAGE_SIZE - 1)) != 0 || header->magic != LARGE_MAGIC) {
+        malloc_abort("free of an invalid pointer");
+    }
+    return header;
+}
+
+/* ===========================================================================
+ * Public Interface
+ * =========================================================================== */
+
+/* ---------------------------------------------------------------------------
+ * malloc - Allocate size bytes, aligned to 16
+ * ---------------------------------------------------------------------------
+ * Returns: The block, or NULL when out of memory. malloc(0) returns a
+ * unique pointer that may be passed to free().
+ * --------------------------------------------------------------------------- */
+void *malloc(size_t size)
+{
+    if (size > MALLOC_SMALL_MAX) {
+        return large_alloc(size);
+    }
+
+    uint32_t cls = size_to_class(size);
+    thread_cache_t *cache = this_cache();
+    free_object_t *object = cache->head[cls];
+    if (object != NULL) {
+        cache->head[cls] = object->next;
+        cache->count[cls]--;
+        return object;
+    }
+    return cache_refill(cache, cls);
+}
+
+/* ---------------------------------------------------------------------------
+ * free - Release a block from malloc, calloc or realloc (NULL is ignored)
+ * --------------------------------------------------------------------------- */
+void free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (!is_small(ptr)) {
+        large_header_t *header = large_header(ptr);
+        header->magic = 0;
+        munmap(header, header->length);
+        return;
+    }
+
+    uint32_t cls = span_of(ptr)->size_class;
+    thread_cache_t *cache = this_cache();
+    free_object_t *object = ptr;
+    object->next = cache->head[cls];
+    cache->head[cls] = object;
+    cache->count[cls]++;
+
+    if (cache->count[cls] > cache_limit(cls)) {
+        cache_flush(cache, cls, cache_limit(cls) / 2);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * malloc_usable_size - Bytes the block can hold (at least what was asked)
+ * --------------------------------------------------------------------------- */
+size_t malloc_usable_size(void *ptr)
+{
+    if (ptr == NULL) {
+        return 0;
+    }
+    if (is_small(ptr)) {
+        return class_sizes[span_of(ptr)->size_class];
+    }
+    return large_header(ptr)->length - sizeof(large_header_t);
+}
+
+/* ---------------------------------------------------------------------------
+ * calloc - Allocate a zeroed array of count elements of size bytes
+ * --------------------------------------------------------------------------- */
+void *calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > 0xFFFFFFFFu / size) {
+        return NULL;  /* Overflow */
+    }
+
+    size_t total = count * size;
+    void *ptr = malloc(total);
+    if (ptr != NULL && total <= MALLOC_SMALL_MAX) {
+        mem_set(ptr, 0, total);  /* Fresh mappings are already zero */
+    }
+    return ptr;
+}
+
+/* ---------------------------------------------------------------------------
+ * realloc - Resize a block, moving it if it does not fit
+ * ---------------------------------------------------------------------------
+ * Returns: The (possibly moved) block, or NULL with the old block intact
+ * --------------------------------------------------------------------------- */
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    size_t usable = malloc_usable_size(ptr);
+    if (size <= usable) {
+        /* Keep it, unless a small block would fit a much smaller class */
+        if (!is_small(ptr) || size > usable / 2 || usable <= 128) {
+            return ptr;
+        }
+    }
+
+    void *moved = malloc(size);
+    if (moved == NULL) {
+        return NULL;
+    }
+    mem_copy(moved, ptr, (size < usable) ? size : usable);
+    free(ptr);
+    return moved;
+}
+
+/* ---------------------------------------------------------------------------
+ * malloc_trim - Flush the thread cache and give free heap back to the kernel
+ * ---------------------------------------------------------------------------
+ * Unlike the trimming free() does, this keeps no spare span.
+ * --------------------------------------------------------------------------- */
+void malloc_trim(void)
+{
+    thread_cache_t *cache = this_cache();
+    for (uint32_t cls = 0; cls < NUM_CLASSES; cls++) {
+        if (cache->count[cls] != 0) {
+            cache_flush(cache, cls, cache->count[cls]);
+        }
+    }
+
+    umutex_lock(&malloc_lock);
+    heap_trim(0);
+    umutex_unlock(&malloc_lock);
+}
@@ -9,7 +9,7 @@
  * functions like write(), exit(), and open() by triggering INT 0x80 to
  * transition into kernel mode.
  *
- * System Call Convention:
+ * System Call Convention (INT 0x80):
  *   EAX = syscall number
  *   EBX = argument 1
  *   ECX = argument 2
@@ -18,6 +18,9 @@
  *   EDI = argument 5
  *   EAX = return value
  *
+ * On CPUs with SYSENTER the wrappers use it instead (see sysenter_call
+ * below), which avoids the cost of an interrupt gate on every call.
+ *
  * ===========================================================================
  */
 
@@ -32,16 +35,93 @@
 #define SYS_WRITE       4
 #define SYS_OPEN        5
 #define SYS_CLOSE       6
+#define SYS_EXECVE      11
 #define SYS_GETPID      20
 #define SYS_SLEEP       35
 #define SYS_SBRK        45
+#define SYS_PIPE        42
+#define SYS_MMAP        90
+#define SYS_MUNMAP      91
+#define SYS_READV       145
+#define SYS_WRITEV      146
+#define SYS_PREAD       180
+#define SYS_PWRITE      181
+#define SYS_GETDENTS    141
 #define SYS_YIELD       158
+#define SYS_FUTEX       240
+#define SYS_POLL        168
+#define SYS_IORING      202
+#define SYS_EPOLL       203
+#define SYS_SPLICE      204
+
+/* ---------------------------------------------------------------------------
+ * sysenter_call - Enter the kernel through SYSENTER
+ * ---------------------------------------------------------------------------
+ * int sysenter_call(int num, int arg1, int arg2, int arg3, int arg4, int arg5)
+ *
+ * ECX and EDX carry the return ESP/EIP, so arguments 2 and 3 go on the
+ * stack at [ECX] and [ECX + 4] (must match kernel/syscall.c).
+ * --------------------------------------------------------------------------- */
+__asm__(
+    ".text\n"
+    "sysenter_call:\n"
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    movl 20(%esp), %eax\n"         /* num */
+    "    movl 24(%esp), %ebx\n"         /* arg1 */
+    "    movl 36(%esp), %esi\n"         /* arg4 */
+    "    movl 40(%esp), %edi\n"         /* arg5 */
+    "    pushl 32(%esp)\n"              /* arg3 */
+    "    pushl 32(%esp)\n"              /* arg2 (shifted by the push above) */
+    "    movl %esp, %ecx\n"
+    "    movl $1f, %edx\n"
+    "    sysenter\n"
+    "1:  addl $8, %esp\n"
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    ret\n"
+);
+
+int sysenter_call(int num, int arg1, int arg2, int arg3, int arg4, int arg5);
+
+/* ---------------------------------------------------------------------------
+ * use_sysenter - Whether the fast path is available (checked once)
+ * ---------------------------------------------------------------------------
+ * Needs CPUID.SEP (early Pentium Pro parts report it falsely) and ring 3,
+ * since SYSEXIT always returns to user mode.
+ * --------------------------------------------------------------------------- */
+static int use_sysenter(void)
+{
+    static int cached = -1;
+
+    if (cached < 0) {
+        unsigned int eax = 1, ebx, ecx, edx, cs;
+        __asm__ volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+        __asm__ volatile ("movl %%cs, %0" : "=r" (cs));
+
+        unsigned int family = (eax >> 8) & 0xF;
+        unsigned int model = (eax >> 4) & 0xF;
+        unsigned int stepping = eax & 0xF;
+        cached = (edx & (1u << 11)) != 0 &&
+                 !(family == 6 && model < 3 && stepping < 3) &&
+                 (cs & 3) == 3;
+    }
+    return cached;
+}
 
 /* ---------------------------------------------------------------------------
  * syscall0 - System call with no arguments
  * --------------------------------------------------------------------------- */
 static inline int syscall0(int num)
 {
+    if (use_sysenter()) {
+        return sysenter_call(num, 0, 0, 0, 0, 0);
+    }
+
     int result;
     __asm__ volatile (
         "int $0x80"
@@ -57,6 +137,10 @@ static inline int syscall0(int num)
  * --------------------------------------------------------------------------- */
 static inline int syscall1(int num, int arg1)
 {
+    if (use_sysenter()) {
+        return sysenter_call(num, arg1, 0, 0, 0, 0);
+    }
+
     int result;
     __asm__ volatile (
         "int $0x80"
@@ -72,6 +156,10 @@ static inline int syscall1(int num, int arg1)
  * --------------------------------------------------------------------------- */
 static inline int syscall2(int num, int arg1, int arg2)
 {
+    if (use_sysenter()) {
+        return sysenter_call(num, arg1, arg2, 0, 0, 0);
+    }
+
     int result;
     __asm__ volatile (
         "int $0x80"
@@ -87,6 +175,10 @@ static inline int syscall2(int num, int arg1, int arg2)
  * --------------------------------------------------------------------------- */
 static inline int syscall3(int num, int arg1, int arg2, int arg3)
 {
+    if (use_sysenter()) {
+        return sysenter_call(num, arg1, arg2, arg3, 0, 0);
+    }
+
     int result;
     __asm__ volatile (
         "int $0x80"
@@ -97,6 +189,78 @@ static inline int syscall3(int num, int arg1, int arg2, int arg3)
     return result;
 }
 
+/* ---------------------------------------------------------------------------
+ * syscall4 - System call with four arguments
+ * --------------------------------------------------------------------------- */
+static inline int syscall4(int num, int arg1, int arg2, int arg3, int arg4)
+{
+    if (use_sysenter()) {
+        return sysenter_call(num, arg1, arg2, arg3, arg4, 0);
+    }
+
+    int result;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a" (result)
+        : "a" (num), "b" (arg1), "c" (arg2), "d" (arg3), "S" (arg4)
+        : "memory"
+    );
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * syscall5 - System call with five arguments
+ * --------------------------------------------------------------------------- */
+static inline int syscall5(int num, int arg1, int arg2, int arg3, int arg4, int arg5)
+{
+    if (use_sysenter()) {
+        return sysenter_call(num, arg1, arg2, arg3, arg4, arg5);
+    }
+
+    int result;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a" (result)
+        : "a" (num), "b" (arg1), "c" (arg2), "d" (arg3), "S" (arg4), "D" (arg5)
+        : "memory"
+    );
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * mmap protection/flags (must match kernel/memory/memory.h)
+ * --------------------------------------------------------------------------- */
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define MAP_SHARED      0x1
+#define MAP_PRIVATE     0x2
+#define MAP_ANONYMOUS   0x20    /* Zeroed memory; pass fd = -1, offset = 0 */
+#define MAP_FAILED      ((void *)-1)
+
+/* ---------------------------------------------------------------------------
+ * Directories (must match vfs_dirent_t in kernel/fs/vfs.h)
+ * --------------------------------------------------------------------------- */
+#define O_DIRECTORY     0x10000
+#define DIRENT_NAME_MAX 256
+
+#define DT_FILE         0
+#define DT_DIR          1
+
+struct dirent {
+    unsigned int d_ino;
+    unsigned short d_type;          /* DT_FILE or DT_DIR */
+    unsigned short d_namlen;
+    char d_name[DIRENT_NAME_MAX];
+};
+
+/* ---------------------------------------------------------------------------
+ * I/O Vector (must match the kernel's struct iovec)
+ * --------------------------------------------------------------------------- */
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+
 /* ===========================================================================
  * User-Space System Call Wrappers
  * =========================================================================== */
@@ -126,10 +290,33 @@ void exit(int status)
  *   In parent: PID of child
  *   In child: 0
  *   On error: -1
+ *
+ * Always uses INT 0x80: the child resumes from the interrupt frame, which
+ * SYSENTER does not build.
  * --------------------------------------------------------------------------- */
 int fork(void)
 {
-    return syscall0(SYS_FORK);
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_FORK)
+        : "memory"
+    );
+    return ret;
+}
+
+/* ---------------------------------------------------------------------------
+ * exec - Replace the running process with a program
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   path - Path of a static ELF executable
+ *
+ * Returns: Does not return on success; -1 on error
+ * --------------------------------------------------------------------------- */
+int exec(const char *path)
+{
+    return syscall1(SYS_EXECVE, (int)path);
 }
 
 /* ---------------------------------------------------------------------------
@@ -162,6 +349,140 @@ int write(int fd, const void *buf, size_t count)
     return syscall3(SYS_WRITE, fd, (int)buf, (int)count);
 }
 
+/* ---------------------------------------------------------------------------
+ * readv - Read into several buffers in one call
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fd     - File descriptor
+ *   iov    - Buffers, filled in order
+ *   iovcnt - Number of buffers (at most 16)
+ *
+ * Returns: Total bytes read, or -1 on error
+ * --------------------------------------------------------------------------- */
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    return syscall3(SYS_READV, fd, (int)iov, iovcnt);
+}
+
+/* ---------------------------------------------------------------------------
+ * writev - Write several buffers in one call
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fd     - File descriptor
+ *   iov    - Buffers, written back to back
+ *   iovcnt - Number of buffers (at most 16)
+ *
+ * Returns: Total bytes written, or -1 on error
+ * --------------------------------------------------------------------------- */
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    return syscall3(SYS_WRITEV, fd, (int)iov, iovcnt);
+}
+
+/* ---------------------------------------------------------------------------
+ * pread - Read at an offset without moving the file position
+ * ---------------------------------------------------------------------------
+ * Returns: Number of bytes read, or -1 on error
+ * --------------------------------------------------------------------------- */
+int pread(int fd, void *buf, size_t count, size_t offset)
+{
+    return syscall4(SYS_PREAD, fd, (int)buf, (int)count, (int)offset);
+}
+
+/* ---------------------------------------------------------------------------
+ * pwrite - Write at an offset without moving the file position
+ * ---------------------------------------------------------------------------
+ * Returns: Number of bytes written, or -1 on error
+ * --------------------------------------------------------------------------- */
+int pwrite(int fd, const void *buf, size_t count, size_t offset)
+{
+    return syscall4(SYS_PWRITE, fd, (int)buf, (int)count, (int)offset);
+}
+
+/* ---------------------------------------------------------------------------
+ * getdents - Read the next entries of a directory
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fd      - Descriptor from open(path, O_DIRECTORY)
+ *   entries - Array of count records
+ *
+ * Returns: Records stored (0 at the end), or -1 on error
+ * --------------------------------------------------------------------------- */
+int getdents(int fd, struct dirent *entries, size_t count)
+{
+    return syscall3(SYS_GETDENTS, fd, (int)entries, (int)count);
+}
+
+/* ---------------------------------------------------------------------------
+ * mmap - Map a file, or zeroed memory, into the address space
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   length - Bytes to map
+ *   prot   - PROT_READ, optionally | PROT_WRITE (files: needs MAP_SHARED)
+ *   flags  - MAP_SHARED or MAP_PRIVATE, plus MAP_ANONYMOUS for memory
+ *   fd     - Open file descriptor (-1 with MAP_ANONYMOUS)
+ *   offset - File offset (multiple of 4096; 0 with MAP_ANONYMOUS)
+ *
+ * Returns: Start of the mapping, or MAP_FAILED on error
+ * --------------------------------------------------------------------------- */
+void *mmap(size_t length, int prot, int flags, int fd, size_t offset)
+{
+    return (void *)syscall5(SYS_MMAP, fd, (int)length, prot, flags, (int)offset);
+}
+
+/* ---------------------------------------------------------------------------
+ * munmap - Remove a whole mapping made by mmap
+ * ---------------------------------------------------------------------------
+ * Returns: 0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+int munmap(void *addr, size_t length)
+{
+    return syscall2(SYS_MUNMAP, (int)addr, (int)length);
+}
+
+/* ---------------------------------------------------------------------------
+ * pipe - Create a pipe
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fds - Receives the read end (fds[0]) and the write end (fds[1])
+ *
+ * Returns: 0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+int pipe(int fds[2])
+{
+    return syscall1(SYS_PIPE, (int)fds);
+}
+
+/* splice flags (must match kernel/fs/vfs.h) */
+#define SPLICE_F_SERIAL     0x1     /* stdout/stderr target: COM1 instead of the screen */
+
+/* ---------------------------------------------------------------------------
+ * splice - Move data between descriptors without a user buffer
+ * ---------------------------------------------------------------------------
+ * A file spliced into a pipe lends its pages; a file or pipe spliced to
+ * stdout goes to the screen straight from those pages.
+ *
+ * Parameters:
+ *   in_fd  - File or pipe read end
+ *   out_fd - File, pipe write end, STDOUT or STDERR
+ *   count  - Most bytes to move
+ *   flags  - SPLICE_F_SERIAL
+ *
+ * Returns: Bytes moved (0 at end of input), or -1 on error
+ * --------------------------------------------------------------------------- */
+int splice(int in_fd, int out_fd, size_t count, unsigned int flags)
+{
+    return syscall4(SYS_SPLICE, in_fd, out_fd, (int)count, (int)flags);
+}
+
+/* ---------------------------------------------------------------------------
+ * sendfile - Copy a file to another descriptor from its current position
+ * --------------------------------------------------------------------------- */
+int sendfile(int out_fd, int in_fd, size_t count)
+{
+    return splice(in_fd, out_fd, count, 0);
+}
+
 /* ---------------------------------------------------------------------------
  * open - Open a file
  * ---------------------------------------------------------------------------
@@ -223,10 +544,329 @@ int yield(void)
 }
 
 /* ---------------------------------------------------------------------------
- * sbrk - Extend process heap
+ * poll sources and events (must match kernel/ipc/poll.h)
+ * --------------------------------------------------------------------------- */
+#define POLLIN              0x0001
+#define POLLOUT             0x0004
+#define POLLERR             0x0008
+#define POLLHUP             0x0010
+#define POLLNVAL            0x0020
+
+#define POLL_SRC_KEYBOARD   0
+#define POLL_SRC_MSGQ       1
+#define POLL_SRC_SERIAL     2
+#define POLL_SRC_FILE       3
+#define POLL_WAIT_FOREVER   0xFFFFFFFFu
+
+struct pollfd {
+    int source;                 /* POLL_SRC_* */
+    int id;                     /* Queue ID for POLL_SRC_MSGQ */
+    unsigned short events;      /* Requested POLL* bits */
+    unsigned short revents;     /* Returned POLL* bits */
+};
+
+/* ---------------------------------------------------------------------------
+ * poll - Wait until the keyboard or a message queue is ready
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   fds     - Sources to watch (at most 16); revents filled in
+ *   nfds    - Number of entries
+ *   timeout - Ticks to wait at most (0 = just check, POLL_WAIT_FOREVER)
+ *
+ * Returns: Number of ready entries, 0 on timeout, -1 on error
+ * --------------------------------------------------------------------------- */
+int poll(struct pollfd *fds, unsigned int nfds, unsigned int timeout)
+{
+    return syscall3(SYS_POLL, (int)fds, (int)nfds, (int)timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll (must match kernel/syscall.c and kernel/ipc/poll.h)
+ * --------------------------------------------------------------------------- */
+#define EPOLLET             0x8000
+
+#define EPOLL_CTL_ADD       1
+#define EPOLL_CTL_DEL       2
+#define EPOLL_CTL_MOD       3
+
+#define EPOLL_OP_CREATE     0
+#define EPOLL_OP_CTL        1
+#define EPOLL_OP_WAIT       2
+#define EPOLL_OP_CLOSE      3
+
+struct epoll_event {
+    unsigned int events;        /* POLL* bits (plus EPOLLET for epoll_ctl) */
+    unsigned int data;          /* Cookie handed back by epoll_wait */
+};
+
+/* ---------------------------------------------------------------------------
+ * epoll_create - Create an interest set
+ * ---------------------------------------------------------------------------
+ * Returns: Instance descriptor, or -1 on error
+ * --------------------------------------------------------------------------- */
+int epoll_create(void)
+{
+    return syscall1(SYS_EPOLL, EPOLL_OP_CREATE);
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_ctl - Add, change or remove a watched source
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   epfd   - Instance from epoll_create()
+ *   op     - EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL
+ *   source - POLL_SRC_*
+ *   id     - Queue ID or file descriptor (unused for keyboard/serial)
+ *   event  - Events and cookie (may be NULL for EPOLL_CTL_DEL)
+ *
+ * Returns: 0 on success, -1 on error
+ * --------------------------------------------------------------------------- */
+int epoll_ctl(int epfd, int op, int source, int id, const struct epoll_event *event)
+{
+    struct {
+        int op;
+        int source;
+        int id;
+        unsigned int events;
+        unsigned int data;
+    } ctl = { op, source, id, event ? event->events : 0, event ? event->data : 0 };
+
+    return syscall3(SYS_EPOLL, EPOLL_OP_CTL, epfd, (int)&ctl);
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_wait - Wait for ready sources
+ * ---------------------------------------------------------------------------
+ * Returns: Number of events stored, 0 on timeout, -1 on error
+ * --------------------------------------------------------------------------- */
+int epoll_wait(int epfd, struct epoll_event *events, unsigned int max, unsigned int timeout)
+{
+    return syscall5(SYS_EPOLL, EPOLL_OP_WAIT, epfd, (int)events, (int)max, (int)timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * epoll_close - Destroy an interest set
+ * --------------------------------------------------------------------------- */
+int epoll_close(int epfd)
+{
+    return syscall2(SYS_EPOLL, EPOLL_OP_CLOSE, epfd);
+}
+
+/* ---------------------------------------------------------------------------
+ * futex operations (must match kernel/syscall.c)
+ * --------------------------------------------------------------------------- */
+#define FUTEX_WAIT          0
+#define FUTEX_WAKE          1
+#define FUTEX_WAIT_FOREVER  0xFFFFFFFFu
+
+/* ---------------------------------------------------------------------------
+ * futex_wait - Sleep while a word holds an expected value
+ * ---------------------------------------------------------------------------
+ * Returns at once if *addr no longer equals expected, so the caller can
+ * check its condition, then wait, without losing a wake in between.
+ *
+ * Parameters:
+ *   addr     - 4-byte aligned word (may be in shared memory)
+ *   expected - Value last seen in *addr
+ *   timeout  - Ticks to sleep at most (FUTEX_WAIT_FOREVER = no limit)
+ *
+ * Returns: 0 when woken or the word changed, -1 on timeout or error
+ * --------------------------------------------------------------------------- */
+int futex_wait(volatile unsigned int *addr, unsigned int expected, unsigned int timeout)
+{
+    return syscall4(SYS_FUTEX, (int)addr, FUTEX_WAIT, (int)expected, (int)timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * futex_wake - Wake tasks sleeping on a word
+ * ---------------------------------------------------------------------------
+ * Returns: Number of tasks woken, or -1 on error
+ * --------------------------------------------------------------------------- */
+int futex_wake(volatile unsigned int *addr, unsigned int count)
+{
+    return syscall3(SYS_FUTEX, (int)addr, FUTEX_WAKE, (int)count);
+}
+
+/* ---------------------------------------------------------------------------
+ * umutex - Mutex that only enters the kernel under contention
+ * ---------------------------------------------------------------------------
+ * State: 0 = unlocked, 1 = locked, 2 = locked and maybe waited on. An
+ * uncontended lock/unlock pair is two atomic operations and no syscall.
+ * --------------------------------------------------------------------------- */
+typedef struct {
+    volatile unsigned int state;
+} umutex_t;
+
+#define UMUTEX_INIT     { 0 }
+
+void umutex_lock(umutex_t *m)
+{
+    unsigned int c = 0;
+    if (__atomic_compare_exchange_n(&m->state, &c, 1, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    /* Contended: mark it waited on and sleep until it is handed back */
+    if (c != 2) {
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+    while (c != 0) {
+        futex_wait(&m->state, 2, FUTEX_WAIT_FOREVER);
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+int umutex_trylock(umutex_t *m)
+{
+    unsigned int c = 0;
+    return __atomic_compare_exchange_n(&m->state, &c, 1, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void umutex_unlock(umutex_t *m)
+{
+    if (__atomic_exchange_n(&m->state, 0, __ATOMIC_RELEASE) == 2) {
+        futex_wake(&m->state, 1);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * I/O rings (must match kernel/io_ring.c and kernel/syscall.c)
+ * ---------------------------------------------------------------------------
+ * Queue requests with io_ring_get_sqe(), hand the batch over with one
+ * io_ring_submit(), then read the results with io_ring_peek_cqe() and
+ * io_ring_cqe_seen(). Requests that can not finish yet (sleeps, receives on
+ * an empty queue) stay in the kernel and complete on a later submit.
+ * --------------------------------------------------------------------------- */
+#define IORING_SETUP    0
+#define IORING_ENTER    1
+#define IORING_DESTROY  2
+
+#define IORING_OP_NOP           0
+#define IORING_OP_READ          1
+#define IORING_OP_WRITE         2
+#define IORING_OP_MSGQ_SEND     3
+#define IORING_OP_MSGQ_RECEIVE  4
+#define IORING_OP_SLEEP         5
+
+#define IORING_OFFSET_CURRENT   0xFFFFFFFFu
+#define IORING_NO_WAIT          0
+#define IORING_WAIT_FOREVER     0xFFFFFFFFu
+
+struct io_sqe {
+    unsigned char opcode;
+    unsigned char flags;
+    unsigned short reserved;
+    int fd;                             /* Descriptor or queue ID */
+    unsigned int addr;
+    unsigned int len;
+    unsigned int offset;                /* Or IORING_OFFSET_CURRENT */
+    unsigned int arg;                   /* Message type */
+    unsigned int timeout;               /* Ticks (sleep length for SLEEP) */
+    unsigned int user_data;
+};
+
+struct io_cqe {
+    unsigned int user_data;
+    int result;
+};
+
+struct io_ring {
+    unsigned int magic;
+    unsigned int sq_entries;
+    unsigned int cq_entries;
+    unsigned int sqe_offset;
+    unsigned int cqe_offset;
+    volatile unsigned int sq_head;
+    volatile unsigned int sq_tail;
+    volatile unsigned int cq_head;
+    volatile unsigned int cq_tail;
+};
+
+/* ---------------------------------------------------------------------------
+ * io_ring_setup - Create a ring with entries (power of two) request slots
+ * ---------------------------------------------------------------------------
+ * Returns: The mapped ring, or NULL on error
+ * --------------------------------------------------------------------------- */
+struct io_ring *io_ring_setup(unsigned int entries)
+{
+    int ring = syscall2(SYS_IORING, IORING_SETUP, (int)entries);
+    return (ring == -1) ? NULL : (struct io_ring *)ring;
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_get_sqe - Next free request slot, or NULL if the SQ is full
+ * ---------------------------------------------------------------------------
+ * The slot is queued at once; fill it in before the next io_ring_submit().
+ * --------------------------------------------------------------------------- */
+struct io_sqe *io_ring_get_sqe(struct io_ring *ring)
+{
+    unsigned int head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned int tail = ring->sq_tail;
+    if (tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+
+    struct io_sqe *sqes = (struct io_sqe *)((char *)ring + ring->sqe_offset);
+    struct io_sqe *sqe = &sqes[tail & (ring->sq_entries - 1)];
+    char *bytes = (char *)sqe;
+    for (size_t i = 0; i < sizeof(*sqe); i++) {
+        bytes[i] = 0;
+    }
+    __atomic_store_n(&ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_submit - Hand queued requests to the kernel in one call
+ * ---------------------------------------------------------------------------
+ * Parameters:
+ *   min_complete - Wait until this many completions are unread
+ *   timeout      - Ticks to wait at most (IORING_WAIT_FOREVER = no limit)
+ *
+ * Returns: Number of requests the kernel took, or -1 on error
+ * --------------------------------------------------------------------------- */
+int io_ring_submit(struct io_ring *ring, unsigned int min_complete, unsigned int timeout)
+{
+    return syscall4(SYS_IORING, IORING_ENTER, (int)ring, (int)min_complete, (int)timeout);
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_peek_cqe - Oldest unread completion, or NULL if there is none
+ * --------------------------------------------------------------------------- */
+struct io_cqe *io_ring_peek_cqe(struct io_ring *ring)
+{
+    unsigned int head = ring->cq_head;
+    if (head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    struct io_cqe *cqes = (struct io_cqe *)((char *)ring + ring->cqe_offset);
+    return &cqes[head & (ring->cq_entries - 1)];
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_cqe_seen - Release the completion returned by io_ring_peek_cqe
+ * --------------------------------------------------------------------------- */
+void io_ring_cqe_seen(struct io_ring *ring)
+{
+    __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------------------
+ * io_ring_destroy - Unmap a ring (requests still pending are dropped)
+ * --------------------------------------------------------------------------- */
+int io_ring_destroy(struct io_ring *ring)
+{
+    return syscall2(SYS_IORING, IORING_DESTROY, (int)ring);
+}
+
+/* ---------------------------------------------------------------------------
+ * sbrk - Move the program break
  * ---------------------------------------------------------------------------
  * Parameters:
- *   increment - Bytes to add to heap
+ *   increment - Bytes to add to the heap (negative returns memory)
  *
  * Returns: Previous break value, or -1 on error
  * --------------------------------------------------------------------------- */
@@ -27,8 +27,187 @@
 #define SYS_EXIT        1
 #define SYS_READ        3
 #define SYS_WRITE       4
+#define SYS_OPEN        5
+#define SYS_CLOSE       6
 #define SYS_GETPID      20
+#define SYS_GETDENTS    141
 #define SYS_YIELD       158
+#define SYS_MEMPROF     200
+#define SYS_SCHEDSTAT   201
+#define SYS_SPLICE      204
+#define SYS_BENCH       205
+#define SYS_TRACE       206
+#define SYS_PROFILE     207
+#define SYS_PERF        208
+#define SYS_MEMINFO     209
+#define SYS_DMESG       210
+#define SYS_IRQSTAT     211
+
+/* SYS_MEMPROF operations */
+#define MEMPROF_READ    0
+#define MEMPROF_ENABLE  1
+#define MEMPROF_DISABLE 2
+
+/* Heap profiler snapshot (must match heap_profile_t in kernel/memory/memory.h) */
+#define MEMPROF_SITES   32
+#define MEMPROF_BUCKETS 13
+
+typedef struct memprof_site {
+    uint32_t caller;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t live_bytes;
+    uint32_t peak_bytes;
+} memprof_site_t;
+
+typedef struct memprof {
+    bool enabled;
+    uint32_t sites_used;
+    uint32_t histogram[MEMPROF_BUCKETS];
+    memprof_site_t sites[MEMPROF_SITES];
+} memprof_t;
+
+/* SYS_SCHEDSTAT operations */
+#define SCHEDSTAT_LATENCY 0
+#define SCHEDSTAT_TASKS   1
+
+/* Scheduler statistics (must match kernel/scheduler/scheduler.h) */
+#define SCHEDSTAT_BUCKETS   32
+#define SCHEDSTAT_MAX_TASKS 64
+
+typedef struct schedstat_latency {
+    uint32_t wakeup_hist[SCHEDSTAT_BUCKETS];
+    uint32_t switch_hist[SCHEDSTAT_BUCKETS];
+    uint32_t wakeup_max_ns;
+    uint32_t switch_max_ns;
+    uint32_t clock_khz;
+} schedstat_latency_t;
+
+typedef struct schedstat_task {
+    uint32_t pid;
+    uint8_t state;
+    uint8_t priority;
+    uint16_t reserved;
+    uint32_t cpu_time;
+    uint32_t run_count;
+    uint32_t latency_last_ns;
+    uint32_t latency_max_ns;
+    char name[16];
+} schedstat_task_t;
+
+/* Benchmark results (must match bench_result_t in kernel/utils/bench.h) */
+#define BENCH_NAME_MAX  24
+#define BENCH_MAX       32
+
+typedef struct bench_result {
+    char name[BENCH_NAME_MAX];
+    uint32_t ops;
+    uint32_t samples;
+    uint32_t min_cycles;
+    uint32_t median_cycles;
+    uint32_t p99_cycles;
+    uint32_t ops_per_sec;
+    uint32_t perf_events;
+    uint32_t instructions;
+    uint32_t ipc_milli;
+    uint32_t llc_misses_per_kop;
+    uint32_t branch_misses_per_kop;
+} bench_result_t;
+
+/* SYS_TRACE operations and categories (must match kernel/utils/trace.h) */
+#define TRACE_OP_SET    0
+#define TRACE_OP_DUMP   1
+#define TRACE_OP_CLEAR  2
+
+static const char *const trace_categories[] = {
+    "sched", "irq", "syscall", "heap", "ipc"
+};
+#define TRACE_CAT_COUNT ((int)(sizeof(trace_categories) / sizeof(trace_categories[0])))
+
+/* SYS_PROFILE operations */
+#define PROFILE_OP_START 0
+#define PROFILE_OP_STOP  1
+#define PROFILE_OP_DUMP  2
+
+/* SYS_PERF operations, events and records (must match kernel/utils/perf.h) */
+#define PERF_OP_INFO        0
+#define PERF_OP_START       1
+#define PERF_OP_STOP        2
+#define PERF_OP_READ_SYSTEM 3
+#define PERF_OP_READ_TASK   4
+
+#define PERF_MAX_COUNTERS   4
+#define PERF_EVENT_CYCLES   0
+
+static const char *const perf_event_names[] = {
+    "cycles", "instructions", "ref-cycles", "llc-refs", "llc-misses",
+    "branches", "branch-misses"
+};
+#define PERF_EVENT_COUNT ((int)(sizeof(perf_event_names) / sizeof(perf_event_names[0])))
+
+typedef struct perf_info {
+    uint32_t version;
+    uint32_t counters;
+    uint32_t width;
+    uint32_t events;
+} perf_info_t;
+
+typedef struct perf_counts {
+    uint32_t count;
+    uint32_t events[PERF_MAX_COUNTERS];
+    uint64_t values[PERF_MAX_COUNTERS];
+} perf_counts_t;
+
+/* Memory statistics (must match mem_info_t in kernel/memory/memory.h) */
+typedef struct mem_info {
+    uint32_t total_frames;
+    uint32_t free_frames;
+    uint32_t heap_total;
+    uint32_t heap_used;
+    uint32_t heap_peak;
+    uint32_t paging_enabled;
+    uint32_t pse;
+    uint32_t large_pages;
+    uint32_t small_pages;
+    uint32_t table_frames;
+} mem_info_t;
+
+/* IRQ handler time (must match irq_handler_info_t in kernel/interrupts/interrupts.h) */
+#define IRQ_LAT_BUCKETS 16              /* Bucket i: < 2^(i + 9) cycles; last: the rest */
+#define IRQSTAT_MAX     32
+
+typedef struct irq_handler_info {
+    uint32_t irq;
+    uint32_t calls;
+    uint32_t handled;
+    uint32_t timed;
+    uint32_t min_cycles;
+    uint32_t avg_cycles;
+    uint32_t max_cycles;
+    uint32_t unhandled;
+    uint32_t histogram[IRQ_LAT_BUCKETS];
+    char name[16];
+} irq_handler_info_t;
+
+/* Directory entries (must match vfs_dirent_t in kernel/fs/vfs.h) */
+#define O_DIRECTORY     0x10000
+#define DT_DIR          1
+
+typedef struct shell_dirent {
+    uint32_t inode;
+    uint16_t type;
+    uint16_t name_len;
+    char name[256];
+} shell_dirent_t;
+
+/* Entries fetched per getdents call by ls */
+#define LS_BATCH        8
+
+/* Bytes per splice call by cat */
+#define CAT_CHUNK       16384
+
+/* Kernel log text fetched by dmesg (the newest records that fit) */
+#define DMESG_BUF_SIZE  16384
 
 /* Standard file descriptors */
 #define STDIN   0
@@ -80,6 +259,18 @@ static inline int syscall3(int num, int arg1, int arg2, int arg3)
     return result;
 }
 
+static inline int syscall4(int num, int arg1, int arg2, int arg3, int arg4)
+{
+    int result;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a" (result)
+        : "a" (num), "b" (arg1), "c" (arg2), "d" (arg3), "S" (arg4)
+        : "memory"
+    );
+    return result;
+}
+
 /* Wrapper functions */
 static void shell_exit(int status)
 {
@@ -97,11 +288,73 @@ static int shell_write(int fd, const void *buf, size_t count)
     return syscall3(SYS_WRITE, fd, (int)buf, (int)count);
 }
 
+static int shell_open(const char *path, int flags)
+{
+    return syscall3(SYS_OPEN, (int)path, flags, 0);
+}
+
+static int shell_close(int fd)
+{
+    return syscall1(SYS_CLOSE, fd);
+}
+
+static int shell_getdents(int fd, shell_dirent_t *entries, size_t count)
+{
+    return syscall3(SYS_GETDENTS, fd, (int)entries, (int)count);
+}
+
+/* Move up to count bytes from in_fd to out_fd inside the kernel */
+static int shell_splice(int in_fd, int out_fd, size_t count)
+{
+    return syscall4(SYS_SPLICE, in_fd, out_fd, (int)count, 0);
+}
+
 static int shell_getpid(void)
 {
     return syscall0(SYS_GETPID);
 }
 
+static int shell_memprof(int op, void *buf, size_t size)
+{
+    return syscall3(SYS_MEMPROF, op, (int)buf, (int)size);
+}
+
+static int shell_schedstat(int op, void *buf, size_t size)
+{
+    return syscall3(SYS_SCHEDSTAT, op, (int)buf, (int)size);
+}
+
+static int shell_trace(int op, uint32_t mask)
+{
+    return syscall3(SYS_TRACE, op, (int)mask, 0);
+}
+
+static int shell_profile(int op)
+{
+    return syscall3(SYS_PROFILE, op, 0, 0);
+}
+
+static int shell_perf(int op, void *arg, size_t size, int pid)
+{
+    return syscall4(SYS_PERF, op, (int)arg, (int)size, pid);
+}
+
+static int shell_dmesg(char *buf, size_t size)
+{
+    return syscall3(SYS_DMESG, (int)buf, (int)size, 0);
+}
+
+static int shell_irqstat(irq_handler_info_t *handlers, size_t size)
+{
+    return syscall3(SYS_IRQSTAT, (int)handlers, (int)size, 0);
+}
+
+/* Run the kernel benchmarks whose names start with filter (NULL = all) */
+static int shell_bench(const char *filter, bench_result_t *results, size_t size)
+{
+    return syscall3(SYS_BENCH, (int)filter, (int)results, (int)size);
+}
+
 /* ---------------------------------------------------------------------------
  * String Utilities
  * --------------------------------------------------------------------------- */
@@ -197,6 +450,31 @@ static void print_number(int num)
     }
 }
 
+/* 64-bit decimal by shift-and-subtract (no libgcc division here) */
+static void print_u64(uint64_t num)
+{
+    char buf[21];
+    int i = 20;
+
+    buf[i] = '\0';
+    do {
+        uint64_t quot = 0;
+        uint32_t rem = 0;
+        for (int bit = 63; bit >= 0; bit--) {
+            rem = (rem << 1) | (uint32_t)((num >> bit) & 1);
+            quot <<= 1;
+            if (rem >= 10) {
+                rem -= 10;
+                quot |= 1;
+            }
+        }
+        buf[--i] = (char)('0' + rem);
+        num = quot;
+    } while (num != 0);
+
+    print(&buf[i]);
+}
+
 static void print_hex(uint32_t num)
 {
     const char hex_chars[] = "0123456789ABCDEF";
@@ -308,7 +586,14 @@ static void cmd_help(int argc, char **argv)
     println("  echo [text]    - Print text to the screen");
     println("  ps             - List running processes");
     println("  mem            - Display memory statistics");
-    println("  ls             - List files in current directory");
+    println("  memprof [on|off] - Heap allocation sites and sizes");
+    println("  bench [name]   - Kernel microbenchmarks (cycles/op)");
+    println("  trace on [cat..]|off|dump|clear - Kernel tracepoints");
+    println("  profile start|stop|dump - Sample kernel hot spots");
+    println("  perf [start [ev..]|stop|stat [pid]] - Hardware counters");
+    println("  dmesg          - Kernel log records, oldest first");
+    println("  irqstat        - Time in each IRQ handler (cycles)");
+    println("  ls [dir]       - List files (default: /)");
     println("  cat [file]     - Display file contents");
     println("  pwd            - Print current directory");
     println("  whoami         - Print current user");
@@ -347,26 +632,81 @@ static void cmd_echo(int argc, char **argv)
     println("");
 }
 
-/* ps - List running processes */
+/* ps - List processes with scheduling latency */
 static void cmd_ps(int argc, char **argv)
 {
     (void)argc;
     (void)argv;
     
+    static const char *state_names[] = {
+        "UNUSED  ", "CREATING", "READY   ", "RUNNING ",
+        "BLOCKED ", "SLEEPING", "DONE    ", "ZOMBIE  "
+    };
+    static schedstat_task_t tasks[SCHEDSTAT_MAX_TASKS];
+    
+    int bytes = shell_schedstat(SCHEDSTAT_TASKS, tasks, sizeof(tasks));
+    if (bytes <= 0) {
+        println("ps: not supported by this kernel");
+        return;
+    }
+    
+    int self = shell_getpid();
     println("");
-    println("  PID   STATE       NAME");
-    println("  ---   -----       ----");
+    println("  PID  STATE     PRI  CPU     RUNS    LAT(us)  MAX(us)  NAME");
+    for (int i = 0; i < bytes / (int)sizeof(schedstat_task_t); i++) {
+        schedstat_task_t *t = &tasks[i];
+        print("  ");
+        print_number((int)t->pid);
+        print("\t ");
+        print(t->state < 8 ? state_names[t->state] : "?       ");
+        print("  ");
+        print_number(t->priority);
+        print("    ");
+        print_number((int)t->cpu_time);
+        print("\t  ");
+        print_number((int)t->run_count);
+        print("\t  ");
+        print_number((int)(t->latency_last_ns / 1000));
+        print("\t   ");
+        print_number((int)(t->latency_max_ns / 1000));
+        print("\t    ");
+        print(t->name);
+        println((int)t->pid == self ? " *" : "");
+    }
     
-    /* Get our own PID */
-    int pid = shell_getpid();
-    print("  ");
-    print_number(pid);
-    println("     RUNNING     shell");
+    static schedstat_latency_t lat;
+    if (shell_schedstat(SCHEDSTAT_LATENCY, &lat, sizeof(lat)) != (int)sizeof(lat)) {
+        println("");
+        return;
+    }
+    if (lat.clock_khz == 0) {
+        println("");
+        println("  (latency histograms need a calibrated TSC)");
+        println("");
+        return;
+    }
     
-    /* TODO: Add syscall to enumerate all processes */
-    /* For now, just show shell process */
     println("");
-    println("  (Full process listing requires SYS_PS syscall)");
+    println("  Latency (ns >= : wakeup-to-run / context switch)");
+    for (int i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+        if (lat.wakeup_hist[i] == 0 && lat.switch_hist[i] == 0) {
+            continue;
+        }
+        print("    ");
+        print_u64(i == 0 ? 0 : (1u << i));
+        print("\t: ");
+        print_number((int)lat.wakeup_hist[i]);
+        print(" / ");
+        print_number((int)lat.switch_hist[i]);
+        println("");
+    }
+    print("  Max wakeup ");
+    print_number((int)(lat.wakeup_max_ns / 1000));
+    print(" us, max switch ");
+    print_number((int)(lat.switch_max_ns / 1000));
+    print(" us, TSC ");
+    print_number((int)(lat.clock_khz / 1000));
+    println(" MHz");
     println("");
 }
 
@@ -376,34 +716,447 @@ static void cmd_mem(int argc, char **argv)
     (void)argc;
     (void)argv;
     
+    mem_info_t info;
+    if (syscall3(SYS_MEMINFO, (int)&info, sizeof(info), 0) != (int)sizeof(info)) {
+        println("mem: SYS_MEMINFO failed");
+        return;
+    }
+
     println("");
     println("  Memory Statistics");
     println("  -----------------");
     println("");
-    
-    /* TODO: Add syscall to get memory info */
-    println("  Total RAM:        4 MB (configured)");
-    println("  Frame Size:       4 KB");
-    println("  RAMFS Max Size:   4 MB");
+
+    print("  Frames:           ");
+    print_number((int)(info.total_frames - info.free_frames));
+    print(" used / ");
+    print_number((int)info.total_frames);
+    print(" (");
+    print_number((int)(info.total_frames / 256));
+    println(" MB)");
+
+    print("  Kernel Heap:      ");
+    print_number((int)(info.heap_used / 1024));
+    print(" KB used / ");
+    print_number((int)(info.heap_total / 1024));
+    print(" KB, peak ");
+    print_number((int)(info.heap_peak / 1024));
+    println(" KB");
+
+    if (!info.paging_enabled) {
+        println("  Paging:           off (flat physical addresses)");
+        println("");
+        return;
+    }
+
+    /* Address space each kind of mapping covers, in KB */
+    uint32_t large_kb = info.large_pages * 4096;
+    uint32_t small_kb = info.small_pages * 4;
+    print("  Large Pages:      ");
+    print_number((int)info.large_pages);
+    print(" x 4 MB = ");
+    print_number((int)(large_kb / 1024));
+    println(info.pse ? " MB" : " MB (no PSE)");
+    print("  Small Pages:      ");
+    print_number((int)info.small_pages);
+    print(" x 4 KB = ");
+    print_number((int)small_kb);
+    print(" KB in ");
+    print_number((int)info.table_frames);
+    println(" page tables");
+    if (large_kb + small_kb != 0) {
+        print("  Large Coverage:   ");
+        print_number((int)(large_kb * 100 / (large_kb + small_kb)));
+        println("%");
+    }
+    println("");
+}
+
+/* memprof - Heap allocation profiler [on|off] */
+static void cmd_memprof(int argc, char **argv)
+{
+    if (argc > 1) {
+        bool on = str_cmp(argv[1], "on") == 0;
+        if (!on && str_cmp(argv[1], "off") != 0) {
+            println("Usage: memprof [on|off]");
+            return;
+        }
+        shell_memprof(on ? MEMPROF_ENABLE : MEMPROF_DISABLE, NULL, 0);
+        println(on ? "Heap profiler enabled" : "Heap profiler disabled");
+        return;
+    }
+
+    static memprof_t prof;
+    if (shell_memprof(MEMPROF_READ, &prof, sizeof(prof)) != (int)sizeof(prof)) {
+        println("memprof: not supported by this kernel");
+        return;
+    }
+
     println("");
-    println("  (Detailed stats require SYS_MEMINFO syscall)");
+    print("  Heap Profiler (");
+    print(prof.enabled ? "on" : "off, use 'memprof on'");
+    println(")");
+    println("  Site        Live      Peak      Allocs    Frees");
+    for (uint32_t i = 0; i < prof.sites_used && i < MEMPROF_SITES; i++) {
+        memprof_site_t *site = &prof.sites[i];
+        print("  ");
+        if (site->caller) {
+            print_hex(site->caller);
+        } else {
+            print("(other)   ");
+        }
+        print("  ");
+        print_number((int)site->live_bytes);
+        print("\t    ");
+        print_number((int)site->peak_bytes);
+        print("\t      ");
+        print_number((int)site->allocs);
+        print("\t");
+        print_number((int)site->frees);
+        println("");
+    }
+
+    println("");
+    println("  Request sizes (bytes <= : count)");
+    uint32_t limit = 16;
+    for (int i = 0; i < MEMPROF_BUCKETS; i++, limit <<= 1) {
+        if (prof.histogram[i] == 0) {
+            continue;
+        }
+        print("    ");
+        if (i == MEMPROF_BUCKETS - 1) {
+            print("larger");
+        } else {
+            print_number((int)limit);
+        }
+        print(" : ");
+        print_number((int)prof.histogram[i]);
+        println("");
+    }
     println("");
 }
 
-/* ls - List files */
-static void cmd_ls(int argc, char **argv)
+/* bench - Run kernel microbenchmarks [name prefix] */
+static void cmd_bench(int argc, char **argv)
+{
+    static bench_result_t results[BENCH_MAX];
+
+    println("");
+    println("  Running kernel benchmarks...");
+    int bytes = shell_bench(argc > 1 ? argv[1] : NULL, results, sizeof(results));
+    if (bytes < 0) {
+        println("bench: not supported or already running");
+        return;
+    }
+
+    println("  Benchmark           Min       Median    P99       Ops/s   (cycles/op)");
+    for (int i = 0; i < bytes / (int)sizeof(bench_result_t); i++) {
+        bench_result_t *r = &results[i];
+        print("  ");
+        print(r->name);
+        for (size_t pad = str_len(r->name); pad < 20; pad++) {
+            print(" ");
+        }
+        print_number((int)r->min_cycles);
+        print("\t    ");
+        print_number((int)r->median_cycles);
+        print("\t      ");
+        print_number((int)r->p99_cycles);
+        print("\t");
+        print_number((int)r->ops_per_sec);
+        if (r->perf_events & (1u << PERF_EVENT_CYCLES)) {
+            /* IPC with three decimals */
+            uint32_t frac = r->ipc_milli % 1000;
+            print("  ipc ");
+            print_number((int)(r->ipc_milli / 1000));
+            print(frac < 100 ? (frac < 10 ? ".00" : ".0") : ".");
+            print_number((int)frac);
+        }
+        println("");
+    }
+    println("");
+}
+
+/* trace - Enable tracepoint categories, or dump the rings over serial */
+static void cmd_trace(int argc, char **argv)
+{
+    const char *op = (argc > 1) ? argv[1] : "";
+
+    if (str_cmp(op, "on") == 0) {
+        uint32_t mask = 0;
+        for (int i = 2; i < argc; i++) {
+            int cat = 0;
+            while (cat < TRACE_CAT_COUNT && str_cmp(argv[i], trace_categories[cat]) != 0) {
+                cat++;
+            }
+            if (cat == TRACE_CAT_COUNT) {
+                print("trace: unknown category ");
+                println(argv[i]);
+                return;
+            }
+            mask |= 1u << cat;
+        }
+        if (mask == 0) {
+            mask = (1u << TRACE_CAT_COUNT) - 1;
+        }
+        shell_trace(TRACE_OP_SET, mask);
+        println("Tracing enabled");
+    } else if (str_cmp(op, "off") == 0) {
+        shell_trace(TRACE_OP_SET, 0);
+        println("Tracing disabled");
+    } else if (str_cmp(op, "dump") == 0) {
+        int records = shell_trace(TRACE_OP_DUMP, 0);
+        if (records < 0) {
+            println("trace: not supported by this kernel");
+            return;
+        }
+        print("Dumped ");
+        print_number(records);
+        println(" records to serial (scripts/trace_to_chrome.py converts them)");
+    } else if (str_cmp(op, "clear") == 0) {
+        shell_trace(TRACE_OP_CLEAR, 0);
+        println("Trace rings cleared");
+    } else {
+        println("Usage: trace on [sched|irq|syscall|heap|ipc ...] | off | dump | clear");
+    }
+}
+
+/* profile - Sample the interrupted EIP on every timer tick */
+static void cmd_profile(int argc, char **argv)
+{
+    const char *op = (argc > 1) ? argv[1] : "";
+
+    if (str_cmp(op, "start") == 0) {
+        if (shell_profile(PROFILE_OP_START) < 0) {
+            println("profile: not supported by this kernel");
+            return;
+        }
+        println("Profiling started");
+    } else if (str_cmp(op, "stop") == 0) {
+        shell_profile(PROFILE_OP_STOP);
+        println("Profiling stopped");
+    } else if (str_cmp(op, "dump") == 0) {
+        int entries = shell_profile(PROFILE_OP_DUMP);
+        if (entries < 0) {
+            println("profile: not supported by this kernel");
+            return;
+        }
+        print("Dumped ");
+        print_number(entries);
+        println(" sample sites to serial (scripts/profile_symbolize.py reads them)");
+    } else {
+        println("Usage: profile start | stop | dump");
+    }
+}
+
+/* perf - Hardware performance counters, system-wide or for one task */
+static void cmd_perf(int argc, char **argv)
+{
+    const char *op = (argc > 1) ? argv[1] : "";
+    perf_info_t info;
+
+    if (shell_perf(PERF_OP_INFO, &info, sizeof(info), 0) < 0 || info.version == 0) {
+        println("perf: no architectural performance counters on this CPU");
+        return;
+    }
+
+    if (str_cmp(op, "start") == 0) {
+        uint32_t events[PERF_MAX_COUNTERS];
+        int count = 0;
+        for (int i = 2; i < argc; i++) {
+            int ev = 0;
+            while (ev < PERF_EVENT_COUNT && str_cmp(argv[i], perf_event_names[ev]) != 0) {
+                ev++;
+            }
+            if (ev == PERF_EVENT_COUNT) {
+                print("perf: unknown event ");
+                println(argv[i]);
+                return;
+            }
+            if (count == PERF_MAX_COUNTERS) {
+                println("perf: too many events");
+                return;
+            }
+            events[count++] = (uint32_t)ev;
+        }
+        if (count == 0) {
+            /* cycles, instructions, then misses while counters last */
+            static const uint32_t defaults[] = { 0, 1, 6, 4 };
+            for (int i = 0; i < 4 && count < (int)info.counters; i++) {
+                if (info.events & (1u << defaults[i])) {
+                    events[count++] = defaults[i];
+                }
+            }
+        }
+        if (shell_perf(PERF_OP_START, events, (size_t)count, 0) < 0) {
+            println("perf: cannot start (unsupported event, or a session is running)");
+            return;
+        }
+        println("Counting started");
+    } else if (str_cmp(op, "stop") == 0) {
+        shell_perf(PERF_OP_STOP, NULL, 0, 0);
+        println("Counting stopped");
+    } else if (str_cmp(op, "stat") == 0) {
+        perf_counts_t counts;
+        int pid = -1;
+        if (argc > 2) {
+            pid = 0;
+            for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++) {
+                pid = pid * 10 + (*p - '0');
+            }
+        }
+        int result = (pid < 0)
+            ? shell_perf(PERF_OP_READ_SYSTEM, &counts, sizeof(counts), 0)
+            : shell_perf(PERF_OP_READ_TASK, &counts, sizeof(counts), pid);
+        if (result < 0) {
+            println("perf: no session running (perf start), or no such task");
+            return;
+        }
+        println("");
+        if (pid < 0) {
+            println("  All CPUs:");
+        } else {
+            print("  PID ");
+            print_number(pid);
+            println(":");
+        }
+        for (uint32_t i = 0; i < counts.count; i++) {
+            print("  ");
+            print(perf_event_names[counts.events[i]]);
+            for (size_t pad = str_len(perf_event_names[counts.events[i]]); pad < 16; pad++) {
+                print(" ");
+            }
+            print_u64(counts.values[i]);
+            println("");
+        }
+        println("");
+    } else if (op[0] == '\0') {
+        print("Architectural perfmon v");
+        print_number((int)info.version);
+        print(", ");
+        print_number((int)info.counters);
+        print(" counters x ");
+        print_number((int)info.width);
+        println(" bits. Events:");
+        for (int ev = 0; ev < PERF_EVENT_COUNT; ev++) {
+            if (info.events & (1u << ev)) {
+                print("  ");
+                println(perf_event_names[ev]);
+            }
+        }
+    } else {
+        println("Usage: perf [start [event..] | stop | stat [pid]]");
+    }
+}
+
+/* dmesg - Print the records still held in the kernel log */
+static void cmd_dmesg(int argc, char **argv)
 {
+    static char log[DMESG_BUF_SIZE];
     (void)argc;
     (void)argv;
-    
+
+    int bytes = shell_dmesg(log, sizeof(log));
+    if (bytes < 0) {
+        println("dmesg: SYS_DMESG failed");
+        return;
+    }
+    shell_write(STDOUT, log, (size_t)bytes);
+}
+
+/* irqstat - Calls, min/avg/max cycles and a histogram per IRQ handler */
+static void cmd_irqstat(int argc, char **argv)
+{
+    static irq_handler_info_t handlers[IRQSTAT_MAX];
+    (void)argc;
+    (void)argv;
+
+    int bytes = shell_irqstat(handlers, sizeof(handlers));
+    if (bytes < 0) {
+        println("irqstat: SYS_IRQSTAT failed");
+        return;
+    }
+
+    println("");
+    println("  IRQ Handler    Calls     Min       Avg       Max   (cycles)");
+    for (int i = 0; i < bytes / (int)sizeof(irq_handler_info_t); i++) {
+        irq_handler_info_t *h = &handlers[i];
+        print("  ");
+        print_number((int)h->irq);
+        print(h->irq < 10 ? "   " : "  ");
+        print(h->name);
+        print("\t");
+        print_u64(h->calls);
+        print("\t");
+        if (h->timed == 0) {
+            println("-");
+            continue;
+        }
+        print_u64(h->min_cycles);
+        print("\t");
+        print_u64(h->avg_cycles);
+        print("\t");
+        print_u64(h->max_cycles);
+        print("\n       <cycles:count>");
+        for (int b = 0; b < IRQ_LAT_BUCKETS; b++) {
+            if (h->histogram[b] == 0) {
+                continue;
+            }
+            if (b == IRQ_LAT_BUCKETS - 1) {
+                print(" more:");
+            } else {
+                print(" <");
+                print_u64(1u << (b + 9));
+                print(":");
+            }
+            print_u64(h->histogram[b]);
+        }
+        println("");
+        if (h->unhandled != 0 && (i + 1 == bytes / (int)sizeof(irq_handler_info_t) ||
+                                  handlers[i + 1].irq != h->irq)) {
+            print("       unhandled: ");
+            print_u64(h->unhandled);
+            println("");
+        }
+    }
     println("");
-    println("  Directory listing: /");
+}
+
+/* ls - List files */
+static void cmd_ls(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "/";
+
+    println("");
+    print("  Directory listing: ");
+    println(path);
     println("  -------------------");
     println("");
-    
-    /* TODO: Add syscall to list directory */
-    println("  (File listing requires SYS_READDIR syscall)");
-    println("  (RAMFS is initialized but no files created yet)");
+
+    int fd = shell_open(path, O_DIRECTORY);
+    if (fd < 0) {
+        println("  (No such directory)");
+        println("");
+        return;
+    }
+
+    /* Stream the directory a batch at a time */
+    shell_dirent_t entries[LS_BATCH];
+    int total = 0;
+    int count;
+    while ((count = shell_getdents(fd, entries, LS_BATCH)) > 0) {
+        for (int i = 0; i < count; i++) {
+            print("  ");
+            print(entries[i].name);
+            println(entries[i].type == DT_DIR ? "/" : "");
+        }
+        total += count;
+    }
+    shell_close(fd);
+
+    if (total == 0) {
+        println("  (empty)");
+    }
     println("");
 }
 
@@ -423,8 +1176,17 @@ static void cmd_cat(int argc, char **argv)
     println("  ---------------");
     println("");
     
-    /* TODO: Use open/read/close syscalls */
-    println("  (File reading requires SYS_OPEN/SYS_READ syscalls)");
+    int fd = shell_open(filename, 0);
+    if (fd < 0) {
+        println("  (No such file)");
+        println("");
+        return;
+    }
+
+    /* The file's pages go straight to the screen, no buffer in between */
+    while (shell_splice(fd, STDOUT, CAT_CHUNK) > 0) {
+    }
+    shell_close(fd);
     println("");
 }
 
@@ -501,6 +1263,13 @@ static const command_t commands[] = {
     { "echo",    cmd_echo,    "Print text" },
     { "ps",      cmd_ps,      "List processes" },
     { "mem",     cmd_mem,     "Memory statistics" },
+    { "memprof", cmd_memprof, "Heap allocation profiler [on|off]" },
+    { "bench",   cmd_bench,   "Kernel microbenchmarks [name]" },
+    { "trace",   cmd_trace,   "Kernel tracepoints on|off|dump|clear" },
+    { "profile", cmd_profile, "Sampling profiler start|stop|dump" },
+    { "perf",    cmd_perf,    "Hardware counters [start|stop|stat]" },
+    { "dmesg",   cmd_dmesg,   "Kernel log" },
+    { "irqstat", cmd_irqstat, "IRQ handler time" },
     { "ls",      cmd_ls,      "List files" },
     { "cat",     cmd_cat,     "Display file contents" },
     { "pwd",     cmd_pwd,     "Print current directory" },